@@ -0,0 +1,287 @@
+#include "AudioMixer.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define AUDIO_MIXER_SSE
+#endif
+
+// 32.32 fixed point
+static const double FixedOne = 4294967296.0;
+
+// --------------------------------------------------------
+// SoundEffect
+// --------------------------------------------------------
+
+SoundEffect::SoundEffect(AudioMixer* mixer, const float* samples, int frames, int channels, int sampleRate)
+{
+	this->mixer = mixer;
+	this->sampleRate = sampleRate;
+	frameCount = frames;
+
+	this->samples.resize(frames + 1, 0.0f);
+	for (int i = 0; i < frames; i++)
+	{
+		float sum = 0;
+		for (int c = 0; c < channels; c++)
+			sum += samples[i * channels + c];
+		this->samples[i] = sum / channels;
+	}
+}
+
+bool SoundEffect::Play()
+{
+	return mixer->Play(this, 1.0f, 0.0f, 0.0f);
+}
+
+bool SoundEffect::Play(float volume, float pitch, float pan)
+{
+	return mixer->Play(this, volume, pitch, pan);
+}
+
+// --------------------------------------------------------
+// AudioMixer
+// --------------------------------------------------------
+
+AudioMixer::AudioMixer(int sampleRate, int voiceCount)
+	: commandHead(0), commandTail(0),
+	blocks(0), voiceBlocks(0), commandCount(0),
+	dropped(0), stolen(0), peakVoices(0), activeVoices(0)
+{
+	this->sampleRate = sampleRate;
+	masterVolume = 1.0f;
+	started = 0;
+
+	Voice idle = {};
+	voices.resize(voiceCount, idle);
+}
+
+AudioMixerStats AudioMixer::GetStats()
+{
+	AudioMixerStats stats;
+	stats.Blocks = blocks.load(std::memory_order_relaxed);
+	stats.VoiceBlocks = voiceBlocks.load(std::memory_order_relaxed);
+	stats.Commands = commandCount.load(std::memory_order_relaxed);
+	stats.Dropped = dropped.load(std::memory_order_relaxed);
+	stats.Stolen = stolen.load(std::memory_order_relaxed);
+	stats.PeakVoices = peakVoices.load(std::memory_order_relaxed);
+	return stats;
+}
+
+// --------------------------------------------------------
+// Game thread side
+// --------------------------------------------------------
+
+bool AudioMixer::Push(const Command& command)
+{
+	uint32_t tail = commandTail.load(std::memory_order_relaxed);
+	uint32_t head = commandHead.load(std::memory_order_acquire);
+	if (tail - head == CommandCapacity)
+	{
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	// The audio thread can't see this slot until tail moves
+	commands[tail % CommandCapacity] = command;
+	commandTail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+bool AudioMixer::Play(const SoundEffect* sound, float volume, float pitch, float pan)
+{
+	Command command = { CommandPlay, sound, volume, pitch, pan };
+	return Push(command);
+}
+
+bool AudioMixer::StopAll()
+{
+	Command command = { CommandStopAll, 0, 0, 0, 0 };
+	return Push(command);
+}
+
+bool AudioMixer::SetMasterVolume(float volume)
+{
+	Command command = { CommandMasterVolume, 0, volume, 0, 0 };
+	return Push(command);
+}
+
+// --------------------------------------------------------
+// Audio thread side
+// --------------------------------------------------------
+
+void AudioMixer::RunCommands()
+{
+	uint32_t head = commandHead.load(std::memory_order_relaxed);
+	uint32_t tail = commandTail.load(std::memory_order_acquire);
+	for (; head != tail; head++)
+	{
+		const Command& command = commands[head % CommandCapacity];
+		switch (command.Type)
+		{
+		case CommandPlay:
+			StartVoice(command);
+			break;
+		case CommandStopAll:
+			for (size_t v = 0; v < voices.size(); v++)
+				voices[v].Active = false;
+			break;
+		case CommandMasterVolume:
+			masterVolume = command.Volume;
+			break;
+		}
+		commandCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Frees the slots for the game thread
+	commandHead.store(head, std::memory_order_release);
+}
+
+void AudioMixer::StartVoice(const Command& command)
+{
+	const SoundEffect* sound = command.Sound;
+	if (sound->GetFrameCount() == 0 || voices.empty())
+		return;
+
+	// A free voice, or else the oldest
+	Voice* voice = 0;
+	for (size_t v = 0; v < voices.size() && !voice; v++)
+	{
+		if (!voices[v].Active)
+			voice = &voices[v];
+	}
+	if (!voice)
+	{
+		voice = &voices[0];
+		for (size_t v = 1; v < voices.size(); v++)
+		{
+			if (voices[v].Started < voice->Started)
+				voice = &voices[v];
+		}
+		stolen.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	double rate = (double)sound->GetSampleRate() / sampleRate * pow(2.0, (double)command.Pitch);
+
+	// Equal power, so a sound keeps its loudness across the pan
+	float pan = command.Pan < -1.0f ? -1.0f : (command.Pan > 1.0f ? 1.0f : command.Pan);
+	float angle = (pan + 1.0f) * 0.785398163f;
+
+	voice->Samples = sound->GetSamples();
+	voice->End = (uint64_t)sound->GetFrameCount() << 32;
+	voice->Position = 0;
+	voice->Step = (uint64_t)(rate * FixedOne);
+	if (voice->Step == 0)
+		voice->Step = 1;
+	voice->Gain[0] = command.Volume * cosf(angle);
+	voice->Gain[1] = command.Volume * sinf(angle);
+	voice->Started = started++;
+	voice->Active = true;
+}
+
+// --------------------------------------------------------
+// Adds up to frames of voice into output, resampling as it
+// goes, and retires it once it runs out
+// --------------------------------------------------------
+void AudioMixer::MixVoice(Voice& voice, float* output, int frames)
+{
+	uint64_t left = (voice.End - voice.Position + voice.Step - 1) / voice.Step;
+	int count = left < (uint64_t)frames ? (int)left : frames;
+
+	const float* samples = voice.Samples;
+	float gainLeft = voice.Gain[0] * masterVolume;
+	float gainRight = voice.Gain[1] * masterVolume;
+	uint64_t position = voice.Position;
+	uint64_t step = voice.Step;
+	int i = 0;
+
+#ifdef AUDIO_MIXER_SSE
+	const __m128 gains = _mm_setr_ps(gainLeft, gainRight, gainLeft, gainRight);
+
+	if (step == ((uint64_t)1 << 32) && (uint32_t)position == 0)
+	{
+		// Same rate - no interpolation, samples are consecutive
+		const float* source = samples + (position >> 32);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 sample = _mm_loadu_ps(source + i);
+			__m128 low = _mm_mul_ps(_mm_unpacklo_ps(sample, sample), gains);
+			__m128 high = _mm_mul_ps(_mm_unpackhi_ps(sample, sample), gains);
+			_mm_storeu_ps(output + i * 2, _mm_add_ps(_mm_loadu_ps(output + i * 2), low));
+			_mm_storeu_ps(output + i * 2 + 4, _mm_add_ps(_mm_loadu_ps(output + i * 2 + 4), high));
+		}
+		position += (uint64_t)i << 32;
+	}
+	else
+	{
+		// The fractions are the low 32 bits, which wrap the same
+		// way 32 bit lanes do.  The top 24 of them convert to
+		// float exactly.
+		const uint32_t stepLow = (uint32_t)step;
+		const __m128i laneSteps = _mm_setr_epi32(0, (int)stepLow, (int)(stepLow * 2), (int)(stepLow * 3));
+		const __m128 fractionScale = _mm_set1_ps(1.0f / 16777216.0f);
+
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i fixedFraction = _mm_add_epi32(_mm_set1_epi32((int)(uint32_t)position), laneSteps);
+			__m128 fraction = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(fixedFraction, 8)), fractionScale);
+
+			const float* s0 = samples + (position >> 32);
+			const float* s1 = samples + ((position + step) >> 32);
+			const float* s2 = samples + ((position + step * 2) >> 32);
+			const float* s3 = samples + ((position + step * 3) >> 32);
+			__m128 a = _mm_setr_ps(s0[0], s1[0], s2[0], s3[0]);
+			__m128 b = _mm_setr_ps(s0[1], s1[1], s2[1], s3[1]);
+			__m128 sample = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), fraction));
+
+			__m128 low = _mm_mul_ps(_mm_unpacklo_ps(sample, sample), gains);
+			__m128 high = _mm_mul_ps(_mm_unpackhi_ps(sample, sample), gains);
+			_mm_storeu_ps(output + i * 2, _mm_add_ps(_mm_loadu_ps(output + i * 2), low));
+			_mm_storeu_ps(output + i * 2 + 4, _mm_add_ps(_mm_loadu_ps(output + i * 2 + 4), high));
+
+			position += step * 4;
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		const float* s = samples + (position >> 32);
+		float fraction = (float)((uint32_t)position >> 8) * (1.0f / 16777216.0f);
+		float sample = s[0] + (s[1] - s[0]) * fraction;
+		output[i * 2] += sample * gainLeft;
+		output[i * 2 + 1] += sample * gainRight;
+		position += step;
+	}
+
+	voice.Position = position;
+	if (voice.Position >= voice.End)
+		voice.Active = false;
+}
+
+void AudioMixer::Mix(float* output, int frames)
+{
+	memset(output, 0, sizeof(float) * 2 * frames);
+
+	for (int start = 0; start < frames; start += AudioBlockFrames)
+	{
+		int count = frames - start < AudioBlockFrames ? frames - start : AudioBlockFrames;
+		RunCommands();
+
+		int active = 0;
+		for (size_t v = 0; v < voices.size(); v++)
+		{
+			if (!voices[v].Active)
+				continue;
+			MixVoice(voices[v], output + start * 2, count);
+			active++;
+		}
+
+		blocks.fetch_add(1, std::memory_order_relaxed);
+		voiceBlocks.fetch_add(active, std::memory_order_relaxed);
+		if (active > peakVoices.load(std::memory_order_relaxed))
+			peakVoices.store(active, std::memory_order_relaxed);
+		activeVoices.store(active, std::memory_order_relaxed);
+	}
+}
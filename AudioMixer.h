@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Software audio mixer for the game's sound effects
+//
+//  - A fixed pool of voices, nothing allocated once it's
+//    made.  Playing with every voice busy takes over the one
+//    that's been playing longest.
+//  - The game thread never touches the voices.  Play and
+//    the rest push a command onto a single producer, single
+//    consumer ring with no locks; Mix takes them off at the
+//    start of each block.
+//  - Mix runs on the audio thread (see AudioOutput), filling
+//    interleaved stereo floats in blocks of AudioBlockFrames.
+//    Each voice is resampled to the mixer's rate with linear
+//    interpolation, four frames at a time with SSE where
+//    there is SSE.
+// --------------------------------------------------------
+
+const int AudioBlockFrames = 256;
+
+class AudioMixer;
+
+// --------------------------------------------------------
+// Samples to play, kept mono - effects are placed with pan.
+// Works like DirectXTK's SoundEffect, minus the XAudio2.
+//
+// Must outlive anything still playing it, so only delete
+// one once the audio thread has stopped.
+// --------------------------------------------------------
+class SoundEffect {
+public:
+	// Interleaved samples in -1 to 1, copied.  Stereo is
+	// averaged down to mono.
+	SoundEffect(AudioMixer* mixer, const float* samples, int frames, int channels, int sampleRate);
+
+	// volume - 0 to 1 and up
+	// pitch  - In octaves, -1 to 1
+	// pan    - -1 is all left, 1 all right
+	// False if the command ring was full and it was dropped.
+	bool Play();
+	bool Play(float volume, float pitch, float pan);
+
+	int GetFrameCount() const { return frameCount; }
+	int GetSampleRate() const { return sampleRate; }
+	const float* GetSamples() const { return samples.data(); }
+
+private:
+	AudioMixer* mixer;
+	std::vector<float> samples;		// frameCount of them, plus one of silence to interpolate into
+	int frameCount;
+	int sampleRate;
+};
+
+struct AudioMixerStats {
+	long long Blocks;
+	long long VoiceBlocks;		// One voice mixed through one block
+	long long Commands;
+	int Dropped;				// Commands the ring had no room for
+	int Stolen;					// Voices taken over while still playing
+	int PeakVoices;
+};
+
+class AudioMixer {
+public:
+	AudioMixer(int sampleRate = 48000, int voiceCount = 32);
+
+	int GetSampleRate() { return sampleRate; }
+
+	// Game thread only
+	bool Play(const SoundEffect* sound, float volume, float pitch, float pan);
+	bool StopAll();
+	bool SetMasterVolume(float volume);
+
+	// Audio thread only.  Fills frames of interleaved stereo,
+	// any number of them - blocks are cut to fit.
+	void Mix(float* output, int frames);
+
+	// Safe from any thread, though the numbers may be from
+	// partway through a block
+	AudioMixerStats GetStats();
+	int GetActiveVoices() { return activeVoices.load(std::memory_order_relaxed); }
+
+private:
+	enum CommandType {
+		CommandPlay,
+		CommandStopAll,
+		CommandMasterVolume
+	};
+
+	struct Command {
+		CommandType Type;
+		const SoundEffect* Sound;
+		float Volume;
+		float Pitch;
+		float Pan;
+	};
+
+	struct Voice {
+		const float* Samples;
+		uint64_t End;			// Frame count, 32.32 fixed point
+		uint64_t Position;
+		uint64_t Step;			// Source frames per output frame
+		float Gain[2];			// Left and right, volume and pan together
+		uint64_t Started;		// Order it started in, for stealing
+		bool Active;
+	};
+
+	int sampleRate;
+	float masterVolume;
+	std::vector<Voice> voices;
+	uint64_t started;
+
+	// Command ring.  Only the game thread moves tail, only the
+	// audio thread moves head.
+	static const uint32_t CommandCapacity = 64;
+	Command commands[CommandCapacity];
+	std::atomic<uint32_t> commandHead;
+	std::atomic<uint32_t> commandTail;
+
+	bool Push(const Command& command);
+	void RunCommands();
+	void StartVoice(const Command& command);
+	void MixVoice(Voice& voice, float* output, int frames);
+
+	// Written by the audio thread, read by anyone
+	std::atomic<long long> blocks;
+	std::atomic<long long> voiceBlocks;
+	std::atomic<long long> commandCount;
+	std::atomic<int> dropped;
+	std::atomic<int> stolen;
+	std::atomic<int> peakVoices;
+	std::atomic<int> activeVoices;
+};
@@ -0,0 +1,148 @@
+#include "AudioSink.h"
+
+void ConvertAudioToInt16(const float* samples, int count, short* output)
+{
+	for (int i = 0; i < count; i++)
+	{
+		float sample = samples[i];
+		sample = sample < -1.0f ? -1.0f : (sample > 1.0f ? 1.0f : sample);
+		output[i] = (short)(sample * 32767.0f);
+	}
+}
+
+// --------------------------------------------------------
+// NullAudioSink
+// --------------------------------------------------------
+
+NullAudioSink::NullAudioSink(int sampleRate, bool realTime)
+{
+	this->sampleRate = sampleRate;
+	this->realTime = realTime;
+	framesWritten = 0;
+	start = std::chrono::steady_clock::now();
+}
+
+bool NullAudioSink::Write(const float* /*samples*/, int frames)
+{
+	framesWritten += frames;
+
+	// Until the last of them would have been played
+	if (realTime)
+		std::this_thread::sleep_until(start + std::chrono::microseconds(framesWritten * 1000000 / sampleRate));
+	return true;
+}
+
+// --------------------------------------------------------
+// WaveFileAudioSink
+// --------------------------------------------------------
+
+WaveFileAudioSink::WaveFileAudioSink(const std::string& path, int sampleRate)
+	: file(path, std::ios::binary)
+{
+	this->sampleRate = sampleRate;
+	framesWritten = 0;
+	if (file)
+		WriteHeader();
+}
+
+WaveFileAudioSink::~WaveFileAudioSink()
+{
+	Close();
+}
+
+void WaveFileAudioSink::WriteInt32(uint32_t value)
+{
+	char bytes[4] = { (char)value, (char)(value >> 8), (char)(value >> 16), (char)(value >> 24) };
+	file.write(bytes, 4);
+}
+
+void WaveFileAudioSink::WriteInt16(uint16_t value)
+{
+	char bytes[2] = { (char)value, (char)(value >> 8) };
+	file.write(bytes, 2);
+}
+
+// RIFF header and the fmt chunk, then the data chunk's
+// header - sizes as of what's been written so far
+void WaveFileAudioSink::WriteHeader()
+{
+	const int channels = 2;
+	const int bytesPerFrame = channels * 2;
+	uint32_t dataBytes = (uint32_t)(framesWritten * bytesPerFrame);
+
+	file.write("RIFF", 4);
+	WriteInt32(36 + dataBytes);
+	file.write("WAVE", 4);
+
+	file.write("fmt ", 4);
+	WriteInt32(16);
+	WriteInt16(1);		// PCM
+	WriteInt16(channels);
+	WriteInt32(sampleRate);
+	WriteInt32(sampleRate * bytesPerFrame);
+	WriteInt16(bytesPerFrame);
+	WriteInt16(16);
+
+	file.write("data", 4);
+	WriteInt32(dataBytes);
+}
+
+bool WaveFileAudioSink::Write(const float* samples, int frames)
+{
+	if (!file.is_open())
+		return false;
+
+	converted.resize(frames * 2);
+	ConvertAudioToInt16(samples, frames * 2, converted.data());
+
+	// WAV is little endian, as is everything this runs on
+	file.write((const char*)converted.data(), converted.size() * sizeof(short));
+	if (!file.good())
+		return false;
+	framesWritten += frames;
+	return true;
+}
+
+void WaveFileAudioSink::Close()
+{
+	if (!file.is_open())
+		return;
+
+	file.seekp(0);
+	WriteHeader();
+	file.close();
+}
+
+// --------------------------------------------------------
+// AudioOutput
+// --------------------------------------------------------
+
+AudioOutput::AudioOutput(AudioMixer* mixer, AudioSink* sink)
+	: quit(false), mixMicroseconds(0), blockCount(0)
+{
+	this->mixer = mixer;
+	this->sink = sink;
+	worker = std::thread(&AudioOutput::WorkerLoop, this);
+}
+
+AudioOutput::~AudioOutput()
+{
+	quit = true;
+	worker.join();
+}
+
+void AudioOutput::WorkerLoop()
+{
+	float block[AudioBlockFrames * 2];
+	while (!quit)
+	{
+		auto start = std::chrono::steady_clock::now();
+		mixer->Mix(block, AudioBlockFrames);
+		auto end = std::chrono::steady_clock::now();
+		mixMicroseconds.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count(), std::memory_order_relaxed);
+		blockCount.fetch_add(1, std::memory_order_relaxed);
+
+		if (!sink->Write(block, AudioBlockFrames))
+			break;
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AudioMixer.h"
+
+// --------------------------------------------------------
+// Where mixed audio goes, and the thread that takes it
+// there.  WaveOutSink (Windows only) plays it; the ones here
+// throw it away or write it to a WAV file.
+// --------------------------------------------------------
+
+class AudioSink {
+public:
+	virtual ~AudioSink() {}
+
+	// Interleaved stereo.  Blocks for as long as the sink
+	// needs to take them, which paces whoever is mixing.
+	virtual bool Write(const float* samples, int frames) = 0;
+};
+
+// --------------------------------------------------------
+// Takes anything.  Real time paces the writes as if they
+// were being played; otherwise they return straight away.
+// --------------------------------------------------------
+class NullAudioSink : public AudioSink {
+public:
+	NullAudioSink(int sampleRate, bool realTime);
+
+	bool Write(const float* samples, int frames);
+
+	long long GetFramesWritten() { return framesWritten; }
+
+private:
+	int sampleRate;
+	bool realTime;
+	long long framesWritten;
+	std::chrono::steady_clock::time_point start;
+};
+
+// --------------------------------------------------------
+// 16 bit stereo PCM.  The header's sizes are filled in by
+// Close, or when it's deleted.
+// --------------------------------------------------------
+class WaveFileAudioSink : public AudioSink {
+public:
+	WaveFileAudioSink(const std::string& path, int sampleRate);
+	~WaveFileAudioSink();
+
+	bool IsOpen() { return file.is_open(); }
+	bool Write(const float* samples, int frames);
+	void Close();
+
+private:
+	std::ofstream file;
+	int sampleRate;
+	long long framesWritten;
+	std::vector<short> converted;
+
+	void WriteHeader();
+	void WriteInt32(uint32_t value);
+	void WriteInt16(uint16_t value);
+};
+
+// Clamps to -1 to 1 first
+void ConvertAudioToInt16(const float* samples, int count, short* output);
+
+// --------------------------------------------------------
+// Mixes a block at a time into a sink on its own thread,
+// from construction until it's deleted.  The sink sets the
+// pace.
+// --------------------------------------------------------
+class AudioOutput {
+public:
+	AudioOutput(AudioMixer* mixer, AudioSink* sink);
+	~AudioOutput();
+
+	// Time spent mixing, and blocks mixed
+	double GetMixMilliseconds() { return mixMicroseconds.load(std::memory_order_relaxed) / 1000.0; }
+	long long GetBlocks() { return blockCount.load(std::memory_order_relaxed); }
+
+private:
+	AudioMixer* mixer;
+	AudioSink* sink;
+	std::atomic<bool> quit;
+	std::atomic<long long> mixMicroseconds;
+	std::atomic<long long> blockCount;
+	std::thread worker;
+
+	void WorkerLoop();
+};
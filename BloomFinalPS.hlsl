@@ -1,3 +1,8 @@
+cbuffer Data : register(b0)
+{
+	float bloomIntensity;
+}
+
 struct VertexToPixel
 {
 	float4 position		: SV_POSITION;
@@ -15,6 +20,6 @@ float4 main(VertexToPixel input) : SV_TARGET
 
 	float4 tex1 = AllPassTex.Sample(Sampler, input.uv);
 	float4 tex2 = OgTex.Sample(Sampler, input.uv);
-	float4 finalTex = tex1 + tex2;
+	float4 finalTex = tex1 * bloomIntensity + tex2;
 	return finalTex;
-}
\ No newline at end of file
+}
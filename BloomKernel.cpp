@@ -0,0 +1,89 @@
+#include "BloomKernel.h"
+#include <math.h>
+
+int BuildLinearBlurTaps(float sigma, int radius, BloomTap* taps, int maxTaps)
+{
+	if (sigma <= 0.0f || radius < 1 || taps == 0)
+		return 0;
+
+	// Center plus one fetch per pair of texels on a side
+	int tapCount = 1 + (radius + 1) / 2;
+	if (tapCount > maxTaps || tapCount > BloomMaxTaps)
+		return 0;
+
+	// Discrete weights for texels 0..radius, normalized over the
+	// whole kernel (both sides) so the blur doesn't change brightness
+	float weights[2 * BloomMaxTaps];
+	float total = 0.0f;
+	for (int i = 0; i <= radius; i++)
+	{
+		weights[i] = expf(-(float)(i * i) / (2.0f * sigma * sigma));
+		total += (i == 0) ? weights[i] : 2.0f * weights[i];
+	}
+	for (int i = 0; i <= radius; i++)
+		weights[i] /= total;
+
+	taps[0].Offset = 0.0f;
+	taps[0].Weight = weights[0];
+
+	// Merge texels (i, i+1) into one fetch at their weighted center.
+	// An odd radius leaves the last texel on its own.
+	for (int t = 1; t < tapCount; t++)
+	{
+		int i = 2 * t - 1;
+		float w1 = weights[i];
+		float w2 = (i + 1 <= radius) ? weights[i + 1] : 0.0f;
+
+		taps[t].Weight = w1 + w2;
+		taps[t].Offset = (i * w1 + (i + 1) * w2) / (w1 + w2);
+	}
+
+	return tapCount;
+}
+
+BloomTrafficEstimate EstimateBloomTraffic(
+	unsigned int width,
+	unsigned int height,
+	int levels,
+	int tapCount,
+	unsigned int bytesPerPixel)
+{
+	BloomTrafficEstimate estimate = {};
+	double bpp = bytesPerPixel;
+	double fetchesPerBlur = 2.0 * tapCount - 1.0;
+
+	unsigned int w = width / 2;
+	unsigned int h = height / 2;
+	for (int level = 0; level < levels; level++)
+	{
+		double pixels = (double)w * h;
+
+		// Bright pass (level 0) or 4 tap downsample
+		double fetches = (level == 0) ? 1.0 : 4.0;
+
+		// Horizontal + vertical blur
+		fetches += 2.0 * fetchesPerBlur;
+
+		// Upsample from the level below, which also reads back
+		// the destination for the additive blend
+		if (level < levels - 1)
+			fetches += 4.0 + 1.0;
+
+		int passes = 3 + (level < levels - 1 ? 1 : 0);
+		estimate.PixelsShaded += pixels * passes;
+		estimate.TextureFetches += pixels * fetches;
+		estimate.BytesWritten += pixels * passes * bpp;
+
+		w = (w > 1) ? w / 2 : 1;
+		h = (h > 1) ? h / 2 : 1;
+	}
+
+	// Final composite at full size reads the scene and level 0
+	double fullPixels = (double)width * height;
+	estimate.PixelsShaded += fullPixels;
+	estimate.TextureFetches += fullPixels * 2.0;
+	estimate.BytesWritten += fullPixels * bpp;
+
+	estimate.BytesRead = estimate.TextureFetches * bpp;
+	return estimate;
+}
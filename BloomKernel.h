@@ -0,0 +1,52 @@
+#pragma once
+
+// --------------------------------------------------------
+// CPU side helpers for the bloom chain
+//
+// Nothing in here touches D3D, so the numbers the shaders
+// are fed can be checked on any platform.
+// --------------------------------------------------------
+
+// Most taps the blur shader's constant buffer can hold
+// (center tap included)
+const int BloomMaxTaps = 8;
+
+// --------------------------------------------------------
+// One bilinear fetch of a separable blur.  The offset is in
+// texels from the center and usually lands between two
+// texels so the hardware filter blends them for us.
+// --------------------------------------------------------
+struct BloomTap {
+	float Offset;
+	float Weight;
+};
+
+// --------------------------------------------------------
+// Builds the taps for one side (plus center) of a normalized
+// Gaussian that covers radius texels each way.
+//
+// Neighbouring texel pairs are merged into a single fetch
+// placed at their weighted center, so a radius 6 kernel
+// (13 texels) only needs 7 fetches per direction.  taps[0]
+// is always the center.  Returns the tap count, or 0 if the
+// kernel does not fit in maxTaps.
+// --------------------------------------------------------
+int BuildLinearBlurTaps(float sigma, int radius, BloomTap* taps, int maxTaps);
+
+// --------------------------------------------------------
+// Rough per-frame cost of the bloom chain, used to compare
+// it against the old full resolution box blur
+// --------------------------------------------------------
+struct BloomTrafficEstimate {
+	double PixelsShaded;
+	double TextureFetches;
+	double BytesRead;		// Assumes every fetch misses the cache
+	double BytesWritten;
+};
+
+BloomTrafficEstimate EstimateBloomTraffic(
+	unsigned int width,			// Size of the scene target
+	unsigned int height,
+	int levels,					// Levels in the chain, starting at half size
+	int tapCount,				// As returned by BuildLinearBlurTaps
+	unsigned int bytesPerPixel);
@@ -11,6 +11,11 @@ Camera::Camera(float x, float y, float z) {
 	xRotation = 0;
 	yRotation = 0;
 
+	fieldOfView = 0.25f * XM_PI;
+	aspectRatio = 1.0f;
+	nearClip = 0.1f;
+	farClip = 100.0f;
+
 	XMStoreFloat4x4(&viewMatrix, XMMatrixIdentity());
 	XMStoreFloat4x4(&projMatrix, XMMatrixIdentity());
 }
@@ -95,10 +100,12 @@ void Camera::UpdateViewMatrix() {
 
 // Updates the projection matrix
 void Camera::UpdateProjectionMatrix(float aspectRatio) {
+	this->aspectRatio = aspectRatio;
+
 	XMMATRIX P = XMMatrixPerspectiveFovLH(
-		0.25f * XM_PI,		// Field of View Angle
+		fieldOfView,		// Field of View Angle
 		aspectRatio,		// Aspect ratio
-		0.1f,				// Near clip plane distance
-		100.0f);			// Far clip plane distance
+		nearClip,			// Near clip plane distance
+		farClip);			// Far clip plane distance
 	XMStoreFloat4x4(&projMatrix, XMMatrixTranspose(P)); // Transpose for HLSL!
 }
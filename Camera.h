@@ -21,12 +21,22 @@ public:
 	DirectX::XMFLOAT3 GetPosition() { return position; }
 	DirectX::XMFLOAT4X4 GetView() { return viewMatrix; }
 	DirectX::XMFLOAT4X4 GetProjection() { return projMatrix; }
+	float GetFieldOfView() { return fieldOfView; }
+	float GetAspectRatio() { return aspectRatio; }
+	float GetNearClip() { return nearClip; }
+	float GetFarClip() { return farClip; }
 
 private:
 	// Camera matrices
 	DirectX::XMFLOAT4X4 viewMatrix;
 	DirectX::XMFLOAT4X4 projMatrix;
 
+	// Lens
+	float fieldOfView;
+	float aspectRatio;
+	float nearClip;
+	float farClip;
+
 	// Transformations
 	DirectX::XMFLOAT3 startPosition;
 	DirectX::XMFLOAT3 position;
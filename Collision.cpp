@@ -0,0 +1,505 @@
+#include "Collision.h"
+#include <math.h>
+#include <algorithm>
+
+// Spheres this close to a box count as touching it
+static const float CollisionSkin = 1e-4f;
+
+static float Dot3(const float a[3], const float b[3])
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Point moving along d against a still sphere, time of entry in 0-1
+static bool SweepPointSphere(const float p[3], const float d[3], const float center[3], float radius, float& t)
+{
+	float m[3] = { p[0] - center[0], p[1] - center[1], p[2] - center[2] };
+	float a = Dot3(d, d);
+	float b = 2.0f * Dot3(m, d);
+	float c = Dot3(m, m) - radius * radius;
+	if (a < 1e-12f)
+		return false;
+
+	float disc = b * b - 4.0f * a * c;
+	if (disc < 0.0f)
+		return false;
+
+	float s = (-b - sqrtf(disc)) / (2.0f * a);
+	if (s < 0.0f || s > 1.0f)
+		return false;
+
+	t = s;
+	return true;
+}
+
+// Point moving along d against the capsule around segment a-b
+static bool SweepPointCapsule(const float p[3], const float d[3], const float a[3], const float b[3], float radius, float& t)
+{
+	float best = 2.0f;
+
+	float axis[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	float length = sqrtf(Dot3(axis, axis));
+	for (int i = 0; i < 3; i++)
+		axis[i] /= length;
+
+	// Side of the cylinder - everything perpendicular to the axis
+	float m[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+	float mAxial = Dot3(m, axis);
+	float dAxial = Dot3(d, axis);
+	float mPerp[3];
+	float dPerp[3];
+	for (int i = 0; i < 3; i++)
+	{
+		mPerp[i] = m[i] - mAxial * axis[i];
+		dPerp[i] = d[i] - dAxial * axis[i];
+	}
+
+	float qa = Dot3(dPerp, dPerp);
+	float qb = 2.0f * Dot3(mPerp, dPerp);
+	float qc = Dot3(mPerp, mPerp) - radius * radius;
+	if (qa > 1e-12f)
+	{
+		float disc = qb * qb - 4.0f * qa * qc;
+		if (disc >= 0.0f)
+		{
+			float s = (-qb - sqrtf(disc)) / (2.0f * qa);
+			float along = mAxial + s * dAxial;
+			if (s >= 0.0f && s <= 1.0f && along >= 0.0f && along <= length)
+				best = s;
+		}
+	}
+
+	// Rounded ends
+	float s;
+	if (SweepPointSphere(p, d, a, radius, s) && s < best)
+		best = s;
+	if (SweepPointSphere(p, d, b, radius, s) && s < best)
+		best = s;
+
+	if (best > 1.0f)
+		return false;
+
+	t = best;
+	return true;
+}
+
+// --------------------------------------------------------
+// The sphere hits the box when its center enters the box
+// grown by the radius, with rounded edges and corners.  The
+// ray against the grown (square) box finds the face hits;
+// when that lands in an edge or corner region the ray is
+// tested against the capsules around those edges instead.
+// --------------------------------------------------------
+bool SweepSphereBox(
+	const float center[3],
+	float radius,
+	const float motion[3],
+	const float boxCenter[3],
+	const float boxHalfExtents[3],
+	float& time,
+	float normal[3])
+{
+	float boxMin[3];
+	float boxMax[3];
+	for (int i = 0; i < 3; i++)
+	{
+		boxMin[i] = boxCenter[i] - boxHalfExtents[i];
+		boxMax[i] = boxCenter[i] + boxHalfExtents[i];
+	}
+
+	// Already touching - only a contact if it's moving further in.
+	// The skin catches spheres left resting exactly on a face.
+	float closest[3];
+	float offset[3];
+	for (int i = 0; i < 3; i++)
+	{
+		closest[i] = center[i] < boxMin[i] ? boxMin[i] : (center[i] > boxMax[i] ? boxMax[i] : center[i]);
+		offset[i] = center[i] - closest[i];
+	}
+
+	float distanceSq = Dot3(offset, offset);
+	if (distanceSq < (radius + CollisionSkin) * (radius + CollisionSkin))
+	{
+		if (distanceSq > 1e-12f)
+		{
+			float distance = sqrtf(distanceSq);
+			for (int i = 0; i < 3; i++)
+				normal[i] = offset[i] / distance;
+		}
+		else
+		{
+			// Center inside the box, push out the shallowest way
+			int axis = 0;
+			float shallowest = 0.0f;
+			for (int i = 0; i < 3; i++)
+			{
+				float depth = boxHalfExtents[i] - fabsf(center[i] - boxCenter[i]);
+				if (i == 0 || depth < shallowest)
+				{
+					shallowest = depth;
+					axis = i;
+				}
+			}
+			normal[0] = normal[1] = normal[2] = 0.0f;
+			normal[axis] = center[axis] < boxCenter[axis] ? -1.0f : 1.0f;
+		}
+
+		if (Dot3(motion, normal) >= 0.0f)
+			return false;
+
+		time = 0.0f;
+		return true;
+	}
+
+	// Ray against the grown box
+	float tMin = 0.0f;
+	float tMax = 1.0f;
+	int entryAxis = -1;
+	for (int i = 0; i < 3; i++)
+	{
+		float low = boxMin[i] - radius;
+		float high = boxMax[i] + radius;
+		if (fabsf(motion[i]) < 1e-12f)
+		{
+			if (center[i] < low || center[i] > high)
+				return false;
+			continue;
+		}
+
+		float t1 = (low - center[i]) / motion[i];
+		float t2 = (high - center[i]) / motion[i];
+		if (t1 > t2)
+		{
+			float swap = t1;
+			t1 = t2;
+			t2 = swap;
+		}
+		if (t1 > tMin)
+		{
+			tMin = t1;
+			entryAxis = i;
+		}
+		if (t2 < tMax)
+			tMax = t2;
+		if (tMin > tMax)
+			return false;
+	}
+
+	// Which of the original box's faces the entry point is past
+	float entry[3];
+	int outside = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		entry[i] = center[i] + motion[i] * tMin;
+		if (entry[i] < boxMin[i] || entry[i] > boxMax[i])
+			outside++;
+	}
+
+	float t = tMin;
+	if (outside <= 1)
+	{
+		// Flat face.  Starting inside the grown box but away
+		// from the edges would already have been touching.
+		if (entryAxis < 0)
+			return false;
+	}
+	else
+	{
+		// Edge or corner - the capsules along the box edges that
+		// meet at the nearest corner
+		float corner[3];
+		for (int i = 0; i < 3; i++)
+			corner[i] = entry[i] < boxMin[i] ? boxMin[i] : (entry[i] > boxMax[i] ? boxMax[i] : boxMin[i]);
+
+		float best = 2.0f;
+		for (int edge = 0; edge < 3; edge++)
+		{
+			// An edge region only has the one edge, along the axis
+			// the entry point is inside of
+			bool inside = entry[edge] >= boxMin[edge] && entry[edge] <= boxMax[edge];
+			if (outside == 2 && !inside)
+				continue;
+
+			float a[3] = { corner[0], corner[1], corner[2] };
+			float b[3] = { corner[0], corner[1], corner[2] };
+			a[edge] = boxMin[edge];
+			b[edge] = boxMax[edge];
+
+			float s;
+			if (SweepPointCapsule(center, motion, a, b, radius, s) && s < best)
+				best = s;
+		}
+
+		if (best > 1.0f)
+			return false;
+		t = best;
+	}
+
+	// Normal from the closest point on the box at impact
+	float hit[3];
+	for (int i = 0; i < 3; i++)
+	{
+		hit[i] = center[i] + motion[i] * t;
+		closest[i] = hit[i] < boxMin[i] ? boxMin[i] : (hit[i] > boxMax[i] ? boxMax[i] : hit[i]);
+		offset[i] = hit[i] - closest[i];
+	}
+
+	float distance = sqrtf(Dot3(offset, offset));
+	if (distance > 1e-6f)
+	{
+		for (int i = 0; i < 3; i++)
+			normal[i] = offset[i] / distance;
+	}
+	else
+	{
+		normal[0] = normal[1] = normal[2] = 0.0f;
+		normal[entryAxis < 0 ? 0 : entryAxis] = motion[entryAxis < 0 ? 0 : entryAxis] > 0.0f ? -1.0f : 1.0f;
+	}
+
+	time = t;
+	return true;
+}
+
+// --------------------------------------------------------
+// CollisionWorld
+// --------------------------------------------------------
+
+CollisionWorld::CollisionWorld()
+{
+	stats = {};
+	resort = false;
+}
+
+CollisionWorld::~CollisionWorld()
+{
+}
+
+int CollisionWorld::AddBody(const float center[3], const float extents[3], bool isSphere)
+{
+	Body body = {};
+	for (int i = 0; i < 3; i++)
+	{
+		body.Center[i] = center[i];
+		body.Extents[i] = extents[i];
+	}
+	body.IsSphere = isSphere;
+	bodies.push_back(body);
+
+	Proxy proxy = {};
+	proxy.Body = (int)bodies.size() - 1;
+	proxies.push_back(proxy);
+	resort = true;
+
+	std::vector<int>& list = isSphere ? spheres : boxes;
+	list.push_back(proxy.Body);
+	bodyIndex.push_back((int)list.size() - 1);
+	return (int)list.size() - 1;
+}
+
+int CollisionWorld::AddBox(const float center[3], const float halfExtents[3])
+{
+	return AddBody(center, halfExtents, false);
+}
+
+int CollisionWorld::AddSphere(const float center[3], float radius)
+{
+	float extents[3] = { radius, radius, radius };
+	return AddBody(center, extents, true);
+}
+
+void CollisionWorld::SetBoxPosition(int box, const float center[3])
+{
+	Body& body = bodies[boxes[box]];
+	for (int i = 0; i < 3; i++)
+		body.Center[i] = center[i];
+	resort = true;
+}
+
+void CollisionWorld::MoveBox(int box, const float delta[3])
+{
+	Body& body = bodies[boxes[box]];
+	for (int i = 0; i < 3; i++)
+		body.Motion[i] += delta[i];
+}
+
+void CollisionWorld::SetSpherePosition(int sphere, const float center[3])
+{
+	Body& body = bodies[spheres[sphere]];
+	for (int i = 0; i < 3; i++)
+		body.Center[i] = center[i];
+	resort = true;
+}
+
+void CollisionWorld::MoveSphere(int sphere, const float delta[3])
+{
+	Body& body = bodies[spheres[sphere]];
+	for (int i = 0; i < 3; i++)
+		body.Motion[i] += delta[i];
+}
+
+void CollisionWorld::GetBoxPosition(int box, float center[3]) const
+{
+	const Body& body = bodies[boxes[box]];
+	for (int i = 0; i < 3; i++)
+		center[i] = body.Center[i];
+}
+
+void CollisionWorld::GetSpherePosition(int sphere, float center[3]) const
+{
+	const Body& body = bodies[spheres[sphere]];
+	for (int i = 0; i < 3; i++)
+		center[i] = body.Center[i];
+}
+
+// --------------------------------------------------------
+// Refits every proxy to its body's swept bounds and re-sorts
+// them on x.  Bodies barely move between steps, so the
+// insertion sort usually has next to nothing to do.
+// --------------------------------------------------------
+void CollisionWorld::UpdateProxies()
+{
+	for (Proxy& proxy : proxies)
+	{
+		const Body& body = bodies[proxy.Body];
+		for (int i = 0; i < 3; i++)
+		{
+			float from = body.Center[i];
+			float to = body.Center[i] + body.Motion[i];
+			proxy.Min[i] = (from < to ? from : to) - body.Extents[i] - CollisionSkin;
+			proxy.Max[i] = (from < to ? to : from) + body.Extents[i] + CollisionSkin;
+		}
+	}
+
+	// Between steps bodies barely move and an insertion sort
+	// is close to linear, but from scratch it's quadratic
+	if (resort)
+	{
+		std::sort(proxies.begin(), proxies.end(), [](const Proxy& a, const Proxy& b) { return a.Min[0] < b.Min[0]; });
+		resort = false;
+		return;
+	}
+
+	for (size_t i = 1; i < proxies.size(); i++)
+	{
+		Proxy proxy = proxies[i];
+		size_t j = i;
+		while (j > 0 && proxies[j - 1].Min[0] > proxy.Min[0])
+		{
+			proxies[j] = proxies[j - 1];
+			j--;
+		}
+		proxies[j] = proxy;
+	}
+}
+
+void CollisionWorld::Step()
+{
+	contacts.clear();
+	stats = {};
+
+	UpdateProxies();
+
+	// Earliest hit per sphere, time above 1 for none
+	std::vector<CollisionContact> earliest(spheres.size());
+	for (unsigned int s = 0; s < spheres.size(); s++)
+	{
+		earliest[s].Sphere = s;
+		earliest[s].Time = 2.0f;
+	}
+
+	for (size_t i = 0; i < proxies.size(); i++)
+	{
+		const Proxy& a = proxies[i];
+		for (size_t j = i + 1; j < proxies.size() && proxies[j].Min[0] <= a.Max[0]; j++)
+		{
+			const Proxy& b = proxies[j];
+			if (bodies[a.Body].IsSphere == bodies[b.Body].IsSphere)
+				continue;
+			if (a.Min[1] > b.Max[1] || b.Min[1] > a.Max[1] || a.Min[2] > b.Max[2] || b.Min[2] > a.Max[2])
+				continue;
+
+			int sphereBody = bodies[a.Body].IsSphere ? a.Body : b.Body;
+			int boxBody = bodies[a.Body].IsSphere ? b.Body : a.Body;
+			const Body& sphere = bodies[sphereBody];
+			const Body& box = bodies[boxBody];
+			stats.PairsTested++;
+
+			// Sweep in the box's frame
+			float motion[3];
+			for (int k = 0; k < 3; k++)
+				motion[k] = sphere.Motion[k] - box.Motion[k];
+
+			float time;
+			float normal[3];
+			if (!SweepSphereBox(sphere.Center, sphere.Extents[0], motion, box.Center, box.Extents, time, normal))
+				continue;
+
+			CollisionContact& contact = earliest[bodyIndex[sphereBody]];
+			if (time < contact.Time)
+			{
+				contact.Box = bodyIndex[boxBody];
+				contact.Time = time;
+				for (int k = 0; k < 3; k++)
+					contact.Normal[k] = normal[k];
+			}
+		}
+	}
+
+	// Move everything.  A sphere that hit something moves with
+	// it for the rest of the step, so it ends up touching the
+	// box where the box ends up rather than where it was at
+	// the time of impact.
+	for (unsigned int s = 0; s < spheres.size(); s++)
+	{
+		Body& body = bodies[spheres[s]];
+		CollisionContact& contact = earliest[s];
+		if (contact.Time > 1.0f)
+		{
+			for (int k = 0; k < 3; k++)
+				body.Center[k] += body.Motion[k];
+			continue;
+		}
+
+		const Body& box = bodies[boxes[contact.Box]];
+		float boxMin[3];
+		float boxMax[3];
+		for (int k = 0; k < 3; k++)
+		{
+			body.Center[k] += body.Motion[k] * contact.Time + box.Motion[k] * (1.0f - contact.Time);
+			boxMin[k] = box.Center[k] + box.Motion[k] - box.Extents[k];
+			boxMax[k] = box.Center[k] + box.Motion[k] + box.Extents[k];
+		}
+
+		// Closest point on the box.  A center that's inside (only
+		// when it started there) goes out to the face the normal
+		// points through.
+		bool inside = true;
+		for (int k = 0; k < 3; k++)
+		{
+			float c = body.Center[k];
+			contact.Point[k] = c < boxMin[k] ? boxMin[k] : (c > boxMax[k] ? boxMax[k] : c);
+			inside = inside && c > boxMin[k] && c < boxMax[k];
+		}
+		if (inside)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				if (contact.Normal[k] != 0.0f)
+					contact.Point[k] = contact.Normal[k] > 0.0f ? boxMax[k] : boxMin[k];
+			}
+		}
+		contacts.push_back(contact);
+	}
+
+	for (Body& body : bodies)
+	{
+		if (!body.IsSphere)
+		{
+			for (int k = 0; k < 3; k++)
+				body.Center[k] += body.Motion[k];
+		}
+		body.Motion[0] = body.Motion[1] = body.Motion[2] = 0.0f;
+	}
+
+	stats.Contacts = (int)contacts.size();
+}
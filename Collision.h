@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+
+// --------------------------------------------------------
+// Swept collision between moving spheres and moving boxes
+//
+// Everything is axis aligned.  Each Step the bodies move by
+// whatever was passed to MoveSphere/MoveBox; a sweep and
+// prune pass over their swept bounds finds the sphere/box
+// pairs that might touch, and each pair is then swept
+// exactly to find the time of impact.  A sphere stops at its
+// earliest impact and moves with that box for the rest of
+// the step, so it ends the step touching it; a contact is
+// reported for it.  Spheres only stop against the first box
+// they hit in a step.
+//
+// Boxes don't collide with each other.
+// --------------------------------------------------------
+
+// Earliest impact a sphere had during a step
+struct CollisionContact {
+	int Sphere;
+	int Box;
+	float Time;			// 0-1 through the step
+	float Point[3];		// Closest point on the box surface, where the box ends the step
+	float Normal[3];	// Out of the box, towards the sphere
+};
+
+struct CollisionStats {
+	int PairsTested;	// Survived the broadphase
+	int Contacts;
+};
+
+// Sweeps a sphere by motion against a still box.  False if it
+// doesn't hit, or is already touching and moving away.
+bool SweepSphereBox(
+	const float center[3],
+	float radius,
+	const float motion[3],
+	const float boxCenter[3],
+	const float boxHalfExtents[3],
+	float& time,
+	float normal[3]);
+
+class CollisionWorld {
+public:
+	CollisionWorld();
+	~CollisionWorld();
+
+	int AddBox(const float center[3], const float halfExtents[3]);
+	int AddSphere(const float center[3], float radius);
+
+	// Set teleports, Move sweeps during the next Step
+	void SetBoxPosition(int box, const float center[3]);
+	void MoveBox(int box, const float delta[3]);
+	void SetSpherePosition(int sphere, const float center[3]);
+	void MoveSphere(int sphere, const float delta[3]);
+
+	void GetBoxPosition(int box, float center[3]) const;
+	void GetSpherePosition(int sphere, float center[3]) const;
+
+	// Applies all pending moves.  Contacts from the previous
+	// Step are replaced.
+	void Step();
+
+	const std::vector<CollisionContact>& GetContacts() const { return contacts; }
+	const CollisionStats& GetStats() const { return stats; }
+
+private:
+	struct Body {
+		float Center[3];
+		float Extents[3];	// Half extents, or the radius three times
+		float Motion[3];
+		bool IsSphere;
+	};
+
+	// Swept bounds, sorted on x between steps
+	struct Proxy {
+		float Min[3];
+		float Max[3];
+		int Body;
+	};
+
+	std::vector<Body> bodies;
+	std::vector<int> spheres;		// Sphere index -> body
+	std::vector<int> boxes;			// Box index -> body
+	std::vector<int> bodyIndex;		// Body -> sphere or box index
+	std::vector<Proxy> proxies;
+	std::vector<CollisionContact> contacts;
+	CollisionStats stats;
+	bool resort;	// Bodies were added or teleported, sort from scratch
+
+	int AddBody(const float center[3], const float extents[3], bool isSphere);
+	void UpdateProxies();
+};
@@ -0,0 +1,378 @@
+#include "CommandStream.h"
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+
+const char* GetCommandName(int op)
+{
+	static const char* names[CommandOpCount] = {
+		"Invalid",
+		"DefineName",
+		"BeginFrame",
+		"EndFrame",
+		"BeginPass",
+		"EndPass",
+		"InvalidateState",
+		"BindVertexBuffer",
+		"BindIndexBuffer",
+		"BindTopology",
+		"BindRenderTargets",
+		"BindViewport",
+		"BindBlendState",
+		"BindDepthState",
+		"BindRasterizer",
+		"BindShader",
+		"BindResource",
+		"BindSampler",
+		"UploadConstants",
+		"UploadBuffer",
+		"ClearColor",
+		"ClearDepth",
+		"Copy",
+		"Draw",
+		"DrawIndexed",
+		"BindConstants"
+	};
+	return (op > 0 && op < CommandOpCount) ? names[op] : names[0];
+}
+
+// How many leading arguments of a bind say which slot it
+// writes, or -1 if the command isn't a bind
+static int GetBindKeyArgs(int op)
+{
+	switch (op)
+	{
+	case CommandBindVertexBuffer: return 1;
+	case CommandBindShader: return 1;
+	case CommandBindResource: return 2;
+	case CommandBindSampler: return 2;
+	case CommandBindConstants: return 2;
+	case CommandBindIndexBuffer:
+	case CommandBindTopology:
+	case CommandBindRenderTargets:
+	case CommandBindViewport:
+	case CommandBindBlendState:
+	case CommandBindDepthState:
+	case CommandBindRasterizer:
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+// --------------------------------------------------------
+// CommandRecorder
+// --------------------------------------------------------
+
+CommandRecorder::CommandRecorder()
+{
+}
+
+CommandRecorder::~CommandRecorder()
+{
+}
+
+void CommandRecorder::Clear()
+{
+	data.clear();
+	objectIds.clear();
+	nameIds.clear();
+}
+
+uint32_t CommandRecorder::GetObjectId(const void* object)
+{
+	if (!object)
+		return 0;
+
+	auto it = objectIds.find(object);
+	if (it != objectIds.end())
+		return it->second;
+
+	uint32_t id = (uint32_t)objectIds.size() + 1;
+	objectIds[object] = id;
+	return id;
+}
+
+uint32_t CommandRecorder::GetNameId(const std::string& name)
+{
+	auto it = nameIds.find(name);
+	if (it != nameIds.end())
+		return it->second;
+
+	uint32_t id = (uint32_t)nameIds.size() + 1;
+	nameIds[name] = id;
+
+	Record(CommandDefineName, id, (uint32_t)name.size());
+	data.insert(data.end(), name.begin(), name.end());
+	return id;
+}
+
+void CommandRecorder::Record(CommandOp op)
+{
+	Record(op, (const uint32_t*)0, 0);
+}
+
+void CommandRecorder::Record(CommandOp op, uint32_t a)
+{
+	Record(op, &a, 1);
+}
+
+void CommandRecorder::Record(CommandOp op, uint32_t a, uint32_t b)
+{
+	uint32_t args[2] = { a, b };
+	Record(op, args, 2);
+}
+
+void CommandRecorder::Record(CommandOp op, uint32_t a, uint32_t b, uint32_t c)
+{
+	uint32_t args[3] = { a, b, c };
+	Record(op, args, 3);
+}
+
+void CommandRecorder::Record(CommandOp op, uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+	uint32_t args[4] = { a, b, c, d };
+	Record(op, args, 4);
+}
+
+void CommandRecorder::Record(CommandOp op, const uint32_t* args, int count)
+{
+	data.push_back((uint8_t)op);
+	data.push_back((uint8_t)count);
+
+	// Little endian regardless of the host
+	for (int i = 0; i < count; i++)
+	{
+		data.push_back((uint8_t)(args[i]));
+		data.push_back((uint8_t)(args[i] >> 8));
+		data.push_back((uint8_t)(args[i] >> 16));
+		data.push_back((uint8_t)(args[i] >> 24));
+	}
+}
+
+bool CommandRecorder::SaveToFile(const std::string& path)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	file.write((const char*)data.data(), data.size());
+	return file.good();
+}
+
+// --------------------------------------------------------
+// Files
+// --------------------------------------------------------
+
+bool LoadCommandStream(const std::string& path, std::vector<uint8_t>& data)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return true;
+}
+
+// --------------------------------------------------------
+// Reading
+// --------------------------------------------------------
+
+float Command::FloatArg(int i) const
+{
+	uint32_t bits = Arg(i);
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+bool ReadCommandStream(const uint8_t* data, size_t size, const std::function<void(const Command&)>& visit)
+{
+	Command command;
+	size_t at = 0;
+	while (at < size)
+	{
+		if (at + 2 > size)
+			return false;
+
+		int op = data[at];
+		int count = data[at + 1];
+		at += 2;
+		if (at + count * 4 > size || op <= 0 || op >= CommandOpCount)
+			return false;
+
+		command.Op = (CommandOp)op;
+		command.Args.resize(count);
+		for (int i = 0; i < count; i++)
+		{
+			const uint8_t* p = data + at + i * 4;
+			command.Args[i] = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+		}
+		at += count * 4;
+
+		command.Text.clear();
+		if (op == CommandDefineName)
+		{
+			uint32_t length = command.Arg(1);
+			if (at + length > size)
+				return false;
+			command.Text.assign((const char*)data + at, length);
+			at += length;
+		}
+
+		visit(command);
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Analysis
+// --------------------------------------------------------
+
+CommandStreamReport AnalyzeCommandStream(const uint8_t* data, size_t size)
+{
+	CommandStreamReport report = {};
+	report.Total.Name = "Total";
+
+	std::map<uint32_t, std::string> names;
+	std::map<std::string, int> passIndex;
+	std::map<std::vector<uint32_t>, std::vector<uint32_t>> boundState;
+	int currentPass = -1;
+
+	report.Valid = ReadCommandStream(data, size, [&](const Command& command) {
+		int op = command.Op;
+		const std::vector<uint32_t>& args = command.Args;
+		int count = (int)args.size();
+		report.Commands++;
+
+		if (op == CommandDefineName)
+		{
+			names[command.Arg(0)] = command.Text;
+			return;
+		}
+
+		if (op == CommandBeginFrame)
+		{
+			report.Frames++;
+			return;
+		}
+
+		if (op == CommandBeginPass)
+		{
+			std::string name = names.count(command.Arg(0)) ? names[command.Arg(0)] : "Pass " + std::to_string(command.Arg(0));
+			auto it = passIndex.find(name);
+			if (it == passIndex.end())
+			{
+				CommandPassStats pass = {};
+				pass.Name = name;
+				report.Passes.push_back(pass);
+				it = passIndex.insert(std::make_pair(name, (int)report.Passes.size() - 1)).first;
+			}
+			currentPass = it->second;
+			return;
+		}
+
+		if (op == CommandInvalidateState)
+		{
+			boundState.clear();
+			return;
+		}
+
+		if (op == CommandEndPass || op == CommandEndFrame)
+		{
+			currentPass = -1;
+			return;
+		}
+
+		// Work outside any pass only shows up in the total
+		CommandPassStats* targets[2] = { &report.Total, currentPass >= 0 ? &report.Passes[currentPass] : 0 };
+		for (CommandPassStats* stats : targets)
+		{
+			if (!stats)
+				continue;
+
+			int keyArgs = GetBindKeyArgs(op);
+			if (keyArgs >= 0)
+			{
+				stats->Binds++;
+			}
+			else if (op == CommandDraw || op == CommandDrawIndexed)
+			{
+				stats->Draws++;
+				stats->Primitives += command.Arg(0) / 3;
+			}
+			else if (op == CommandUploadConstants)
+			{
+				stats->BytesUploaded += command.Arg(2);
+			}
+			else if (op == CommandUploadBuffer)
+			{
+				stats->BytesUploaded += command.Arg(1);
+			}
+			else if (op == CommandClearColor || op == CommandClearDepth)
+			{
+				stats->Clears++;
+			}
+		}
+
+		// Redundant binds - state carries over between passes and
+		// frames just like it does on the device
+		int keyArgs = GetBindKeyArgs(op);
+		if (keyArgs >= 0)
+		{
+			std::vector<uint32_t> key(1, (uint32_t)op);
+			key.insert(key.end(), args.begin(), args.begin() + std::min(keyArgs, count));
+
+			auto it = boundState.find(key);
+			if (it != boundState.end() && it->second == args)
+			{
+				report.Total.RedundantBinds++;
+				if (currentPass >= 0)
+					report.Passes[currentPass].RedundantBinds++;
+			}
+			boundState[key] = args;
+		}
+	});
+
+	return report;
+}
+
+static void AppendStats(std::string& text, const CommandPassStats& stats, int frames)
+{
+	double perFrame = 1.0 / (frames > 0 ? frames : 1);
+
+	char line[256];
+	snprintf(line, sizeof(line), "%-16s %8.1f %10.1f %8.1f %10.1f %12.1f %7.1f\n",
+		stats.Name.c_str(),
+		stats.Draws * perFrame,
+		stats.Primitives * perFrame,
+		stats.Binds * perFrame,
+		stats.RedundantBinds * perFrame,
+		stats.BytesUploaded * perFrame,
+		stats.Clears * perFrame);
+	text += line;
+}
+
+std::string FormatCommandStreamReport(const CommandStreamReport& report)
+{
+	std::string text;
+	char line[256];
+
+	snprintf(line, sizeof(line), "%d frames, %lld commands%s\nPer frame:\n",
+		report.Frames,
+		report.Commands,
+		report.Valid ? "" : " (stream is truncated or corrupt)");
+	text += line;
+
+	snprintf(line, sizeof(line), "%-16s %8s %10s %8s %10s %12s %7s\n",
+		"Pass", "Draws", "Triangles", "Binds", "Redundant", "Bytes up", "Clears");
+	text += line;
+
+	for (const CommandPassStats& pass : report.Passes)
+		AppendStats(text, pass, report.Frames);
+	AppendStats(text, report.Total, report.Frames);
+
+	return text;
+}
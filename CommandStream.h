@@ -0,0 +1,150 @@
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// --------------------------------------------------------
+// Binary stream of the graphics commands a frame issues
+//
+// Every command is an opcode byte, an argument count byte
+// and that many 32 bit arguments.  D3D objects are stored
+// as small ids (0 = null) handed out the first time the
+// recorder sees them, so the stream says which objects were
+// bound where, not what was in them.  Names (passes) are
+// defined once with a DefineName command and referenced by
+// id afterwards.
+//
+// Nothing here touches D3D - RenderContext does the
+// recording, and the analyzer (and SoftwareReplay, which
+// draws a stream on the software rasterizer) reads streams
+// on any platform.
+//
+// Commands may gain trailing arguments over time; readers
+// take missing ones as 0 and ignore ones they don't know.
+// --------------------------------------------------------
+
+enum CommandOp {
+	CommandDefineName = 1,		// id, length, then length bytes of text
+	CommandBeginFrame,
+	CommandEndFrame,
+	CommandBeginPass,			// name id
+	CommandEndPass,
+	CommandInvalidateState,		// Something outside the stream changed the bound state
+
+	// Binds - a bind replaces the last one with the same op and the
+	// same slot arguments (vertex buffer slot, shader stage, stage + slot)
+	CommandBindVertexBuffer,	// slot, buffer, stride, offset
+	CommandBindIndexBuffer,		// buffer, format, offset
+	CommandBindTopology,		// topology
+	CommandBindRenderTargets,	// depth view, then one id per color view
+	CommandBindViewport,		// x, y, width, height as float bits
+	CommandBindBlendState,		// state, sample mask
+	CommandBindDepthState,		// state, stencil ref
+	CommandBindRasterizer,		// state
+	CommandBindShader,			// stage, shader
+	CommandBindResource,		// stage, slot, view
+	CommandBindSampler,			// stage, slot, sampler
+
+	// Data and work
+	CommandUploadConstants,		// stage, shader, bytes
+	CommandUploadBuffer,		// buffer, bytes
+	CommandClearColor,			// view, then RGBA as float bits
+	CommandClearDepth,			// view, clear flags, depth as float bits
+	CommandCopy,				// dest, source, bytes (0 if unknown)
+	CommandDraw,				// vertex count, start vertex
+	CommandDrawIndexed,			// index count, start index, base vertex
+
+	// Added later, so older captures still read the same
+	CommandBindConstants,		// stage, slot, buffer, first constant (a bind)
+
+	CommandOpCount
+};
+
+// Shader stage argument of the shader commands
+enum CommandStage {
+	CommandStageVertex,
+	CommandStagePixel,
+	CommandStageOther
+};
+
+const char* GetCommandName(int op);
+
+// --------------------------------------------------------
+// Appends commands to an in-memory stream
+// --------------------------------------------------------
+class CommandRecorder {
+public:
+	CommandRecorder();
+	~CommandRecorder();
+
+	void Clear();
+
+	// 0 for null, otherwise a stable id per object
+	uint32_t GetObjectId(const void* object);
+
+	// Defines the name on first use
+	uint32_t GetNameId(const std::string& name);
+
+	void Record(CommandOp op);
+	void Record(CommandOp op, uint32_t a);
+	void Record(CommandOp op, uint32_t a, uint32_t b);
+	void Record(CommandOp op, uint32_t a, uint32_t b, uint32_t c);
+	void Record(CommandOp op, uint32_t a, uint32_t b, uint32_t c, uint32_t d);
+	void Record(CommandOp op, const uint32_t* args, int count);
+
+	const std::vector<uint8_t>& GetData() { return data; }
+	bool SaveToFile(const std::string& path);
+
+private:
+	std::vector<uint8_t> data;
+	std::unordered_map<const void*, uint32_t> objectIds;
+	std::unordered_map<std::string, uint32_t> nameIds;
+};
+
+// --------------------------------------------------------
+// Reading a recorded stream
+// --------------------------------------------------------
+struct Command {
+	CommandOp Op;
+	std::vector<uint32_t> Args;
+	std::string Text;			// DefineName's name
+
+	// 0 for arguments the stream didn't record
+	uint32_t Arg(int i) const { return i < (int)Args.size() ? Args[i] : 0; }
+	float FloatArg(int i) const;
+};
+
+// Calls visit with each command in order.  Returns false if
+// the stream was cut short or garbled, after visiting every
+// command before that point.
+bool ReadCommandStream(const uint8_t* data, size_t size, const std::function<void(const Command&)>& visit);
+
+// --------------------------------------------------------
+// Offline analysis of a recorded stream
+// --------------------------------------------------------
+struct CommandPassStats {
+	std::string Name;
+	long long Draws;
+	long long Primitives;		// Triangles, assuming triangle lists
+	long long Binds;
+	long long RedundantBinds;	// Bound what was already bound
+	long long BytesUploaded;
+	long long Clears;
+};
+
+struct CommandStreamReport {
+	bool Valid;					// False if the stream was cut short or garbled
+	int Frames;
+	long long Commands;
+	CommandPassStats Total;
+	std::vector<CommandPassStats> Passes;	// Summed over every frame, in first seen order
+};
+
+CommandStreamReport AnalyzeCommandStream(const uint8_t* data, size_t size);
+bool LoadCommandStream(const std::string& path, std::vector<uint8_t>& data);
+
+// Human readable summary, per frame averages included
+std::string FormatCommandStreamReport(const CommandStreamReport& report);
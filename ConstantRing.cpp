@@ -0,0 +1,82 @@
+#include "ConstantRing.h"
+
+ConstantRing::ConstantRing(uint32_t size, uint32_t alignment)
+{
+	this->size = size;
+	this->alignment = alignment;
+	head = 0;
+	used = 0;
+	frameBytes = 0;
+	stats = {};
+}
+
+uint32_t ConstantRing::Allocate(uint32_t bytes)
+{
+	uint32_t aligned = (bytes + alignment - 1) & ~(alignment - 1);
+	if (aligned == 0 || aligned > size || used == size)
+	{
+		stats.Failures++;
+		return Invalid;
+	}
+
+	// Empty - might as well start from the top again
+	if (used == 0)
+		head = 0;
+
+	// Free space is head up to tail, or head to the end and
+	// then the start up to tail if tail is behind head
+	uint32_t tail = (head + size - used) % size;
+	if (head >= tail)
+	{
+		if (head + aligned > size)
+		{
+			// Doesn't fit before the end - skip what's left there
+			// and go back to the start, if there's room
+			if (aligned > tail)
+			{
+				stats.Failures++;
+				return Invalid;
+			}
+
+			uint32_t skipped = size - head;
+			used += skipped;
+			frameBytes += skipped;
+			stats.BytesSkipped += skipped;
+			stats.Wraps++;
+			head = 0;
+		}
+	}
+	else if (head + aligned > tail)
+	{
+		stats.Failures++;
+		return Invalid;
+	}
+
+	uint32_t offset = head;
+	head = (head + aligned) % size;
+	used += aligned;
+	frameBytes += aligned;
+
+	stats.BytesAllocated += aligned;
+	stats.Allocations++;
+	return offset;
+}
+
+void ConstantRing::EndFrame(uint64_t fence)
+{
+	if (frameBytes == 0)
+		return;
+
+	Frame frame = { fence, frameBytes };
+	frames.push_back(frame);
+	frameBytes = 0;
+}
+
+void ConstantRing::Retire(uint64_t completedFence)
+{
+	while (!frames.empty() && frames.front().Fence <= completedFence)
+	{
+		used -= frames.front().Bytes;
+		frames.pop_front();
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <deque>
+#include <stdint.h>
+
+// --------------------------------------------------------
+// Ring allocator for constants that change every draw
+//
+// Hands out aligned slices of one big buffer, front to back,
+// starting over at the beginning once it reaches the end.
+// Every frame's slices are tagged with a fence value when
+// the frame ends; space only comes back once the GPU has got
+// past that fence, so nothing it may still be reading gets
+// written over.  Allocate fails rather than overrunning
+// - the caller waits for the oldest fence and retires it.
+//
+// Only offsets are tracked here, so it doesn't care what
+// the buffer or the fences actually are (see
+// ConstantUploadHeap for the D3D side).
+// --------------------------------------------------------
+
+struct ConstantRingStats {
+	long long BytesAllocated;	// Including alignment padding
+	long long BytesSkipped;		// Left at the end when wrapping
+	int Allocations;
+	int Wraps;
+	int Failures;				// Allocate calls with no room
+};
+
+class ConstantRing {
+public:
+	static const uint32_t Invalid = 0xFFFFFFFF;
+
+	// alignment must be a power of two.  D3D wants 256 bytes
+	// (16 constants) between constant buffer offsets.
+	ConstantRing(uint32_t size, uint32_t alignment = 256);
+
+	uint32_t GetSize() const { return size; }
+	uint32_t GetUsed() const { return used; }
+
+	// Offset of a slice of at least bytes, or Invalid if it
+	// won't fit in what the GPU has finished with
+	uint32_t Allocate(uint32_t bytes);
+
+	// Everything allocated since the last EndFrame is free
+	// once fence has completed
+	void EndFrame(uint64_t fence);
+
+	// Frees every frame up to and including completedFence
+	void Retire(uint64_t completedFence);
+
+	// Fence of the oldest frame still holding space, or 0
+	// if there isn't one
+	uint64_t GetOldestFence() const { return frames.empty() ? 0 : frames.front().Fence; }
+
+	// Since the last ResetStats
+	const ConstantRingStats& GetStats() const { return stats; }
+	void ResetStats() { stats = {}; }
+
+private:
+	struct Frame {
+		uint64_t Fence;
+		uint32_t Bytes;		// Taken from the ring, skipped ends included
+	};
+
+	uint32_t size;
+	uint32_t alignment;
+	uint32_t head;			// Next free byte
+	uint32_t used;			// Bytes between the oldest live frame and head
+	uint32_t frameBytes;	// Taken since the last EndFrame
+	std::deque<Frame> frames;
+	ConstantRingStats stats;
+};
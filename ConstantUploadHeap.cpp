@@ -0,0 +1,141 @@
+#include "ConstantUploadHeap.h"
+
+ConstantUploadHeap::ConstantUploadHeap(ID3D11Device* device, RenderContext* context, unsigned int size)
+	: ring(size)
+{
+	this->context = context;
+	buffer = 0;
+	discardNext = true;
+	frame = 1;
+	completed = 0;
+	stalls = 0;
+	fallbackBytes = 0;
+	for (int i = 0; i < MaxFramesInFlight; i++)
+		fences[i] = 0;
+
+	// Binding at an offset and mapping a constant buffer with
+	// no overwrite are both 11.1 features
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+	ringEnabled = context->GetDeviceContext1() &&
+		options.ConstantBufferOffsetting &&
+		options.MapNoOverwriteOnDynamicConstantBuffer;
+	if (!ringEnabled)
+		return;
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.ByteWidth = size;
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	device->CreateBuffer(&desc, 0, &buffer);
+
+	D3D11_QUERY_DESC queryDesc = {};
+	queryDesc.Query = D3D11_QUERY_EVENT;
+	for (int i = 0; i < MaxFramesInFlight; i++)
+		device->CreateQuery(&queryDesc, &fences[i]);
+}
+
+ConstantUploadHeap::~ConstantUploadHeap()
+{
+	if (buffer) buffer->Release();
+	for (int i = 0; i < MaxFramesInFlight; i++)
+	{
+		if (fences[i]) fences[i]->Release();
+	}
+}
+
+// --------------------------------------------------------
+// Moves completed up to fence if the GPU has got that far,
+// waiting for it if asked to.  Frames finish in order, so
+// their queries are checked in order.
+// --------------------------------------------------------
+bool ConstantUploadHeap::Poll(uint64_t fence, bool wait)
+{
+	ID3D11DeviceContext* deviceContext = context->GetDeviceContext();
+	while (completed < fence)
+	{
+		ID3D11Query* query = fences[(completed + 1) % MaxFramesInFlight];
+		BOOL done = FALSE;
+		HRESULT hr;
+		do
+		{
+			hr = deviceContext->GetData(query, &done, sizeof(done), 0);
+		} while (hr == S_FALSE && wait);
+
+		if (hr != S_OK)
+			return false;
+		completed++;
+	}
+	return true;
+}
+
+void ConstantUploadHeap::BeginFrame()
+{
+	if (!ringEnabled)
+		return;
+
+	Poll(frame - 1, false);
+	ring.Retire(completed);
+}
+
+void ConstantUploadHeap::EndFrame()
+{
+	if (!ringEnabled)
+		return;
+
+	// The query about to be reused has to have come back first
+	if (frame > MaxFramesInFlight)
+		Poll(frame - MaxFramesInFlight, true);
+
+	context->GetDeviceContext()->End(fences[frame % MaxFramesInFlight]);
+	ring.EndFrame(frame);
+	frame++;
+}
+
+void ConstantUploadHeap::Upload(ISimpleShader* shader, const std::string& bufferName)
+{
+	const SimpleConstantBuffer* constantBuffer = shader->GetBufferInfo(bufferName);
+	if (!constantBuffer)
+		return;
+
+	if (!ringEnabled)
+	{
+		Fallback(shader, constantBuffer);
+		return;
+	}
+
+	uint32_t offset = ring.Allocate(constantBuffer->Size);
+	while (offset == ConstantRing::Invalid)
+	{
+		// Full of frames the GPU may still be reading - wait for
+		// the oldest.  If the frame being drawn has it all to
+		// itself there's nothing to wait for.
+		uint64_t oldest = ring.GetOldestFence();
+		if (oldest == 0 || !Poll(oldest, true))
+		{
+			Fallback(shader, constantBuffer);
+			return;
+		}
+
+		stalls++;
+		ring.Retire(completed);
+		offset = ring.Allocate(constantBuffer->Size);
+	}
+
+	context->UpdateDynamicBufferRange(buffer, offset, constantBuffer->LocalDataBuffer, constantBuffer->Size, discardNext);
+	discardNext = false;
+
+	// Slices are whole multiples of 16 constants
+	UINT constants = ((constantBuffer->Size + 255) & ~255u) / 16;
+	context->SetConstantBuffer(shader, constantBuffer->BindIndex, buffer, offset / 16, constants);
+}
+
+// The shader's own buffer, the way SimpleShader does it
+void ConstantUploadHeap::Fallback(ISimpleShader* shader, const SimpleConstantBuffer* constantBuffer)
+{
+	context->CopyBufferData(shader, constantBuffer->Name);
+	if (ringEnabled)
+		context->SetConstantBuffer(shader, constantBuffer->BindIndex, constantBuffer->ConstantBuffer, 0, 0);
+	fallbackBytes += constantBuffer->Size;
+}
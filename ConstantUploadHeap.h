@@ -0,0 +1,62 @@
+#pragma once
+
+#include <d3d11_1.h>
+#include <string>
+
+#include "SimpleShader.h"
+#include "RenderContext.h"
+#include "ConstantRing.h"
+
+// --------------------------------------------------------
+// Per object constants out of one big dynamic constant
+// buffer.  Each upload takes the next slice of a
+// ConstantRing, writes it with no overwrite and binds it
+// with a constant buffer offset, so a frame's worth of
+// objects share one buffer instead of each mapping the
+// shader's own with discard.  Event queries are the fences
+// that tell the ring when a frame's slices are free again.
+//
+// Offsets need D3D 11.1; without them Upload falls back to
+// the shader's own buffer.
+// --------------------------------------------------------
+class ConstantUploadHeap {
+public:
+	ConstantUploadHeap(ID3D11Device* device, RenderContext* context, unsigned int size = 1024 * 1024);
+	~ConstantUploadHeap();
+
+	bool IsRingEnabled() { return ringEnabled; }
+
+	// Around everything the frame draws
+	void BeginFrame();
+	void EndFrame();
+
+	// Uploads what's been set in the shader's bufferName
+	// constant buffer and binds it.  Call after the shader is
+	// set, as setting it binds its own buffers again.
+	void Upload(ISimpleShader* shader, const std::string& bufferName);
+
+	// Since the last ResetStats
+	const ConstantRingStats& GetRingStats() { return ring.GetStats(); }
+	int GetStalls() { return stalls; }				// Waits for the GPU to free up space
+	long long GetFallbackBytes() { return fallbackBytes; }	// Uploaded outside the ring
+	void ResetStats() { ring.ResetStats(); stalls = 0; fallbackBytes = 0; }
+
+private:
+	static const int MaxFramesInFlight = 4;
+
+	RenderContext* context;
+	ID3D11Buffer* buffer;
+	ConstantRing ring;
+	bool ringEnabled;
+	bool discardNext;		// A new buffer's first map has to be a discard
+
+	ID3D11Query* fences[MaxFramesInFlight];	// Frame n's is fences[n % MaxFramesInFlight]
+	uint64_t frame;			// Fence value of the frame being drawn
+	uint64_t completed;		// Newest frame the GPU has finished
+
+	int stalls;
+	long long fallbackBytes;
+
+	bool Poll(uint64_t fence, bool wait);
+	void Fallback(ISimpleShader* shader, const SimpleConstantBuffer* constantBuffer);
+};
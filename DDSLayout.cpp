@@ -0,0 +1,283 @@
+#include "DDSLayout.h"
+#include <string.h>
+
+namespace {
+	const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+	const uint32_t DDS_HEADER_SIZE = 124;
+	const uint32_t DDS_PIXELFORMAT_SIZE = 32;
+	const uint32_t DDS_DX10_HEADER_SIZE = 20;
+
+	const uint32_t DDPF_ALPHAPIXELS = 0x1;
+	const uint32_t DDPF_FOURCC = 0x4;
+	const uint32_t DDPF_RGB = 0x40;
+
+	const uint32_t DDSCAPS2_CUBEMAP = 0x200;
+	const uint32_t DDSCAPS2_CUBEMAP_ALLFACES = 0xFC00;
+	const uint32_t DDSCAPS2_VOLUME = 0x200000;
+
+	const uint32_t DX10_DIMENSION_TEXTURE2D = 3;
+	const uint32_t DX10_MISC_TEXTURECUBE = 0x4;
+
+	// D3D11 resource limits
+	const uint32_t MAX_DIMENSION = 16384;
+	const uint32_t MAX_ARRAY_SIZE = 2048;
+	const uint32_t MAX_MIPS = 15;
+
+	// The subset of DXGI_FORMAT values we know how to lay out
+	enum Format : uint32_t {
+		FORMAT_UNKNOWN = 0,
+		FORMAT_R32G32B32A32_FLOAT = 2,
+		FORMAT_R16G16B16A16_FLOAT = 10,
+		FORMAT_R10G10B10A2_UNORM = 24,
+		FORMAT_R11G11B10_FLOAT = 26,
+		FORMAT_R8G8B8A8_UNORM = 28,
+		FORMAT_R8G8B8A8_UNORM_SRGB = 29,
+		FORMAT_R32_FLOAT = 41,
+		FORMAT_R8G8_UNORM = 49,
+		FORMAT_R16_FLOAT = 54,
+		FORMAT_R8_UNORM = 61,
+		FORMAT_BC1_UNORM = 71,
+		FORMAT_BC1_UNORM_SRGB = 72,
+		FORMAT_BC2_UNORM = 74,
+		FORMAT_BC2_UNORM_SRGB = 75,
+		FORMAT_BC3_UNORM = 77,
+		FORMAT_BC3_UNORM_SRGB = 78,
+		FORMAT_BC4_UNORM = 80,
+		FORMAT_BC4_SNORM = 81,
+		FORMAT_BC5_UNORM = 83,
+		FORMAT_BC5_SNORM = 84,
+		FORMAT_B8G8R8A8_UNORM = 87,
+		FORMAT_B8G8R8X8_UNORM = 88,
+		FORMAT_B8G8R8A8_UNORM_SRGB = 91,
+		FORMAT_BC6H_UF16 = 95,
+		FORMAT_BC6H_SF16 = 96,
+		FORMAT_BC7_UNORM = 98,
+		FORMAT_BC7_UNORM_SRGB = 99,
+	};
+
+	uint32_t ReadU32(const uint8_t* p) {
+		// Byte-wise so the parser works on any endianness or alignment
+		return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+	}
+
+	uint32_t MakeFourCC(char a, char b, char c, char d) {
+		return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+	}
+
+	// Maps a legacy (pre-DX10) pixel format onto a DXGI format
+	uint32_t LegacyFormat(const uint8_t* pf) {
+		uint32_t flags = ReadU32(pf + 4);
+		uint32_t fourCC = ReadU32(pf + 8);
+		uint32_t bitCount = ReadU32(pf + 12);
+		uint32_t rMask = ReadU32(pf + 16);
+		uint32_t gMask = ReadU32(pf + 20);
+		uint32_t bMask = ReadU32(pf + 24);
+		uint32_t aMask = ReadU32(pf + 28);
+
+		if (flags & DDPF_FOURCC) {
+			if (fourCC == MakeFourCC('D', 'X', 'T', '1')) return FORMAT_BC1_UNORM;
+			if (fourCC == MakeFourCC('D', 'X', 'T', '2')) return FORMAT_BC2_UNORM;
+			if (fourCC == MakeFourCC('D', 'X', 'T', '3')) return FORMAT_BC2_UNORM;
+			if (fourCC == MakeFourCC('D', 'X', 'T', '4')) return FORMAT_BC3_UNORM;
+			if (fourCC == MakeFourCC('D', 'X', 'T', '5')) return FORMAT_BC3_UNORM;
+			if (fourCC == MakeFourCC('A', 'T', 'I', '1')) return FORMAT_BC4_UNORM;
+			if (fourCC == MakeFourCC('B', 'C', '4', 'U')) return FORMAT_BC4_UNORM;
+			if (fourCC == MakeFourCC('B', 'C', '4', 'S')) return FORMAT_BC4_SNORM;
+			if (fourCC == MakeFourCC('A', 'T', 'I', '2')) return FORMAT_BC5_UNORM;
+			if (fourCC == MakeFourCC('B', 'C', '5', 'U')) return FORMAT_BC5_UNORM;
+			if (fourCC == MakeFourCC('B', 'C', '5', 'S')) return FORMAT_BC5_SNORM;
+
+			// Some writers store D3DFORMAT values directly in the fourCC
+			if (fourCC == 113) return FORMAT_R16G16B16A16_FLOAT;
+			if (fourCC == 116) return FORMAT_R32G32B32A32_FLOAT;
+			if (fourCC == 114) return FORMAT_R32_FLOAT;
+			if (fourCC == 111) return FORMAT_R16_FLOAT;
+			return FORMAT_UNKNOWN;
+		}
+
+		if ((flags & DDPF_RGB) && bitCount == 32) {
+			if (rMask == 0x000000ff && gMask == 0x0000ff00 && bMask == 0x00ff0000 && aMask == 0xff000000)
+				return FORMAT_R8G8B8A8_UNORM;
+			if (rMask == 0x00ff0000 && gMask == 0x0000ff00 && bMask == 0x000000ff && aMask == 0xff000000)
+				return FORMAT_B8G8R8A8_UNORM;
+			if (rMask == 0x00ff0000 && gMask == 0x0000ff00 && bMask == 0x000000ff && !(flags & DDPF_ALPHAPIXELS))
+				return FORMAT_B8G8R8X8_UNORM;
+		}
+		return FORMAT_UNKNOWN;
+	}
+}
+
+uint32_t DDSBitsPerPixel(uint32_t format) {
+	switch (format) {
+	case FORMAT_R32G32B32A32_FLOAT:
+		return 128;
+	case FORMAT_R16G16B16A16_FLOAT:
+		return 64;
+	case FORMAT_R10G10B10A2_UNORM:
+	case FORMAT_R11G11B10_FLOAT:
+	case FORMAT_R8G8B8A8_UNORM:
+	case FORMAT_R8G8B8A8_UNORM_SRGB:
+	case FORMAT_R32_FLOAT:
+	case FORMAT_B8G8R8A8_UNORM:
+	case FORMAT_B8G8R8X8_UNORM:
+	case FORMAT_B8G8R8A8_UNORM_SRGB:
+		return 32;
+	case FORMAT_R8G8_UNORM:
+	case FORMAT_R16_FLOAT:
+		return 16;
+	case FORMAT_R8_UNORM:
+	case FORMAT_BC2_UNORM:
+	case FORMAT_BC2_UNORM_SRGB:
+	case FORMAT_BC3_UNORM:
+	case FORMAT_BC3_UNORM_SRGB:
+	case FORMAT_BC5_UNORM:
+	case FORMAT_BC5_SNORM:
+	case FORMAT_BC6H_UF16:
+	case FORMAT_BC6H_SF16:
+	case FORMAT_BC7_UNORM:
+	case FORMAT_BC7_UNORM_SRGB:
+		return 8;
+	case FORMAT_BC1_UNORM:
+	case FORMAT_BC1_UNORM_SRGB:
+	case FORMAT_BC4_UNORM:
+	case FORMAT_BC4_SNORM:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+bool DDSIsBlockCompressed(uint32_t format) {
+	return (format >= FORMAT_BC1_UNORM && format <= FORMAT_BC5_SNORM) ||
+		(format >= FORMAT_BC6H_UF16 && format <= FORMAT_BC7_UNORM_SRGB);
+}
+
+bool ParseDDSLayout(const uint8_t* data, size_t dataSize, DDSLayout& layout) {
+	layout.Subresources.clear();
+
+	// Magic number plus the basic header
+	if (!data || dataSize < 4 + DDS_HEADER_SIZE)
+		return false;
+	if (ReadU32(data) != DDS_MAGIC)
+		return false;
+
+	const uint8_t* header = data + 4;
+	if (ReadU32(header) != DDS_HEADER_SIZE)
+		return false;
+
+	const uint8_t* pf = header + 72;
+	if (ReadU32(pf) != DDS_PIXELFORMAT_SIZE)
+		return false;
+
+	uint32_t height = ReadU32(header + 8);
+	uint32_t width = ReadU32(header + 12);
+	uint32_t mipCount = ReadU32(header + 24);
+	uint32_t caps2 = ReadU32(header + 108);
+	if (mipCount == 0)
+		mipCount = 1;
+
+	size_t dataOffset = 4 + DDS_HEADER_SIZE;
+	uint32_t format = FORMAT_UNKNOWN;
+	uint32_t arraySize = 1;
+	bool isCube = false;
+
+	if ((ReadU32(pf + 4) & DDPF_FOURCC) && ReadU32(pf + 8) == MakeFourCC('D', 'X', '1', '0')) {
+		// Extended header
+		if (dataSize < dataOffset + DDS_DX10_HEADER_SIZE)
+			return false;
+
+		const uint8_t* dx10 = data + dataOffset;
+		dataOffset += DDS_DX10_HEADER_SIZE;
+
+		format = ReadU32(dx10);
+		if (ReadU32(dx10 + 4) != DX10_DIMENSION_TEXTURE2D)
+			return false;
+
+		arraySize = ReadU32(dx10 + 12);
+		if (arraySize == 0 || arraySize > MAX_ARRAY_SIZE)
+			return false;
+
+		if (ReadU32(dx10 + 8) & DX10_MISC_TEXTURECUBE) {
+			isCube = true;
+			arraySize *= 6;
+		}
+	} else {
+		format = LegacyFormat(pf);
+
+		if (caps2 & DDSCAPS2_VOLUME)
+			return false;
+
+		if (caps2 & DDSCAPS2_CUBEMAP) {
+			// Partial cube maps can't be created in D3D11
+			if ((caps2 & DDSCAPS2_CUBEMAP_ALLFACES) != DDSCAPS2_CUBEMAP_ALLFACES)
+				return false;
+			isCube = true;
+			arraySize = 6;
+		}
+	}
+
+	uint32_t bpp = DDSBitsPerPixel(format);
+	if (bpp == 0)
+		return false;
+
+	// Dimension and mip sanity checks
+	if (width == 0 || height == 0 || width > MAX_DIMENSION || height > MAX_DIMENSION)
+		return false;
+	if (isCube && width != height)
+		return false;
+	if (mipCount > MAX_MIPS)
+		return false;
+
+	uint32_t maxMips = 1;
+	for (uint32_t size = (width > height ? width : height); size > 1; size >>= 1)
+		maxMips++;
+	if (mipCount > maxMips)
+		return false;
+
+	bool compressed = DDSIsBlockCompressed(format);
+
+	// Walk every subresource, checking it fits in the file
+	size_t offset = dataOffset;
+	layout.Subresources.reserve(arraySize * mipCount);
+	for (uint32_t item = 0; item < arraySize; item++) {
+		uint32_t w = width;
+		uint32_t h = height;
+		for (uint32_t mip = 0; mip < mipCount; mip++) {
+			uint64_t rowPitch;
+			uint64_t rows;
+			if (compressed) {
+				uint64_t blocksWide = ((uint64_t)w + 3) / 4;
+				rowPitch = blocksWide * (bpp * 2); // 16 pixels per block
+				rows = ((uint64_t)h + 3) / 4;
+			} else {
+				rowPitch = ((uint64_t)w * bpp + 7) / 8;
+				rows = h;
+			}
+
+			uint64_t slicePitch = rowPitch * rows;
+			if (slicePitch > dataSize || offset > dataSize - (size_t)slicePitch)
+				return false;
+
+			DDSSubresource sub;
+			sub.Offset = offset;
+			sub.Size = (size_t)slicePitch;
+			sub.RowPitch = (uint32_t)rowPitch;
+			sub.SlicePitch = (uint32_t)slicePitch;
+			sub.Width = w;
+			sub.Height = h;
+			layout.Subresources.push_back(sub);
+
+			offset += (size_t)slicePitch;
+			w = w > 1 ? w / 2 : 1;
+			h = h > 1 ? h / 2 : 1;
+		}
+	}
+
+	layout.Width = width;
+	layout.Height = height;
+	layout.MipCount = mipCount;
+	layout.ArraySize = arraySize;
+	layout.Format = format;
+	layout.IsCubeMap = isCube;
+	return true;
+}
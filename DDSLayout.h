@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Describes where a single mip of a DDS file lives
+// relative to the start of the file
+// --------------------------------------------------------
+struct DDSSubresource {
+	size_t Offset;
+	size_t Size;
+	uint32_t RowPitch;
+	uint32_t SlicePitch;
+	uint32_t Width;
+	uint32_t Height;
+};
+
+// --------------------------------------------------------
+// The validated layout of a 2D or cube DDS texture
+//
+// Subresources are ordered the way D3D11 expects them:
+// array slice (or cube face) major, mip minor.
+// --------------------------------------------------------
+struct DDSLayout {
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t MipCount;
+	uint32_t ArraySize;		// Includes the 6 faces of a cube map
+	uint32_t Format;		// DXGI_FORMAT value
+	bool IsCubeMap;
+	std::vector<DDSSubresource> Subresources;
+};
+
+// --------------------------------------------------------
+// Parses and validates a DDS file held in memory
+//
+// Only reads from the buffer, never past dataSize, and does not
+// depend on any platform headers, so it is safe to run over
+// untrusted or truncated files.  Returns false for anything
+// malformed or unsupported (volume textures, unknown formats).
+// --------------------------------------------------------
+bool ParseDDSLayout(const uint8_t* data, size_t dataSize, DDSLayout& layout);
+
+// Bits per pixel of a DXGI format, or 0 if unsupported
+uint32_t DDSBitsPerPixel(uint32_t format);
+bool DDSIsBlockCompressed(uint32_t format);
@@ -0,0 +1,30 @@
+cbuffer Data : register(b0)
+{
+	float2 sourceTexelSize;		// 1 / size of the level being read
+}
+
+
+// Defines the input to this pixel shader
+// - Should match the output of our corresponding vertex shader
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float2 uv           : TEXCOORD0;
+};
+
+// Textures and such
+Texture2D SourceTex		: register(t0);
+SamplerState Sampler	: register(s0);
+
+// Entry point for this pixel shader
+// - Four bilinear fetches, one texel out on each diagonal, average a 4x4
+//   block of the larger level which keeps small highlights from flickering
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	float4 totalColor = SourceTex.Sample(Sampler, input.uv + float2(-1, -1) * sourceTexelSize);
+	totalColor += SourceTex.Sample(Sampler, input.uv + float2( 1, -1) * sourceTexelSize);
+	totalColor += SourceTex.Sample(Sampler, input.uv + float2(-1,  1) * sourceTexelSize);
+	totalColor += SourceTex.Sample(Sampler, input.uv + float2( 1,  1) * sourceTexelSize);
+
+	return totalColor * 0.25f;
+}
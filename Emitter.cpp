@@ -217,7 +217,7 @@ void Emitter::SpawnParticle()
 	livingParticleCount++;
 }
 
-void Emitter::CopyParticlesToGPU(ID3D11DeviceContext* context)
+void Emitter::CopyParticlesToGPU(RenderContext* context)
 {
 	// Update local buffer (living particles only as a speed up)
 
@@ -238,12 +238,7 @@ void Emitter::CopyParticlesToGPU(ID3D11DeviceContext* context)
 	}
 
 	// All particles copied locally - send whole buffer to GPU
-	D3D11_MAPPED_SUBRESOURCE mapped = {};
-	context->Map(vertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
-
-	memcpy(mapped.pData, localParticleVertices, sizeof(ParticleVertex) * 4 * maxParticles);
-
-	context->Unmap(vertexBuffer, 0);
+	context->UpdateDynamicBuffer(vertexBuffer, localParticleVertices, sizeof(ParticleVertex) * 4 * maxParticles);
 }
 
 void Emitter::CopyOneParticle(int index)
@@ -266,7 +261,7 @@ void Emitter::CopyOneParticle(int index)
 	localParticleVertices[i + 3].Color = particles[index].Color;
 }
 
-void Emitter::Draw(ID3D11DeviceContext* context, Camera* camera)
+void Emitter::Draw(RenderContext* context, Camera* camera)
 {
 	// Copy to dynamic buffer
 	CopyParticlesToGPU(context);
@@ -279,12 +274,12 @@ void Emitter::Draw(ID3D11DeviceContext* context, Camera* camera)
 
 	vs->SetMatrix4x4("view", camera->GetView());
 	vs->SetMatrix4x4("projection", camera->GetProjection());
-	vs->SetShader();
-	vs->CopyAllBufferData();
+	context->SetShader(vs);
+	context->CopyAllBufferData(vs);
 
-	ps->SetShaderResourceView("particle", texture);
-	ps->SetShader();
-	ps->CopyAllBufferData();
+	context->SetShaderResourceView(ps, "particle", texture);
+	context->SetShader(ps);
+	context->CopyAllBufferData(ps);
 
 	// Draw the correct parts of the buffer
 	if (firstAliveIndex < firstDeadIndex)
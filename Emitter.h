@@ -5,6 +5,7 @@
 
 #include "Camera.h"
 #include "SimpleShader.h"
+#include "RenderContext.h"
 
 struct Particle
 {
@@ -49,9 +50,9 @@ public:
 	void UpdateSingleParticle(float dt, int index);
 	void SpawnParticle();
 
-	void CopyParticlesToGPU(ID3D11DeviceContext* context);
+	void CopyParticlesToGPU(RenderContext* context);
 	void CopyOneParticle(int index);
-	void Draw(ID3D11DeviceContext* context, Camera* camera);
+	void Draw(RenderContext* context, Camera* camera);
 	void setParticleSpawn();
 	void SetEmitterPosition(DirectX::XMFLOAT3 pos);
 private:
@@ -0,0 +1,249 @@
+#include "FrameGraph.h"
+#include <algorithm>
+
+FrameGraph::FrameGraph()
+{
+	Reset();
+}
+
+FrameGraph::~FrameGraph()
+{
+}
+
+void FrameGraph::Reset()
+{
+	passes.clear();
+	resources.clear();
+	physical.clear();
+	culledPasses = 0;
+	transientCount = 0;
+	clearsRemoved = 0;
+}
+
+FrameGraphResource FrameGraph::CreateTexture(const std::string& name, const FrameGraphTextureDesc& desc)
+{
+	Resource resource = {};
+	resource.Name = name;
+	resource.Desc = desc;
+	resource.Imported = false;
+	resources.push_back(resource);
+	return (FrameGraphResource)resources.size() - 1;
+}
+
+FrameGraphResource FrameGraph::ImportTexture(const std::string& name)
+{
+	Resource resource = {};
+	resource.Name = name;
+	resource.Imported = true;
+	resources.push_back(resource);
+	return (FrameGraphResource)resources.size() - 1;
+}
+
+void FrameGraph::MarkOutput(FrameGraphResource resource)
+{
+	resources[resource].Output = true;
+}
+
+int FrameGraph::AddPass(const std::string& name, std::function<void()> execute)
+{
+	Pass pass;
+	pass.Name = name;
+	pass.Execute = execute;
+	pass.Culled = false;
+	passes.push_back(pass);
+	return (int)passes.size() - 1;
+}
+
+void FrameGraph::Read(int pass, FrameGraphResource resource)
+{
+	passes[pass].Reads.push_back(resource);
+}
+
+void FrameGraph::Write(int pass, FrameGraphResource resource, unsigned int flags, const float clearColor[4])
+{
+	Access access = {};
+	access.Resource = resource;
+	access.Flags = flags;
+	if (clearColor)
+	{
+		for (int i = 0; i < 4; i++)
+			access.ClearColor[i] = clearColor[i];
+	}
+	passes[pass].Writes.push_back(access);
+}
+
+bool FrameGraph::ReadsResource(Pass& pass, FrameGraphResource resource)
+{
+	return std::find(pass.Reads.begin(), pass.Reads.end(), resource) != pass.Reads.end();
+}
+
+bool FrameGraph::Compile()
+{
+	int resourceCount = (int)resources.size();
+	int passCount = (int)passes.size();
+
+	for (Pass& pass : passes)
+	{
+		for (FrameGraphResource r : pass.Reads)
+			if (r < 0 || r >= resourceCount) return false;
+		for (Access& w : pass.Writes)
+			if (w.Resource < 0 || w.Resource >= resourceCount) return false;
+	}
+
+	// Cull - walk backwards from the outputs.  A pass survives if
+	// something later still needs one of the textures it writes.
+	// A write that replaces the whole texture satisfies that need,
+	// so anything written before it is dead.
+	std::vector<bool> needed(resourceCount, false);
+	for (int r = 0; r < resourceCount; r++)
+		needed[r] = resources[r].Output;
+
+	culledPasses = 0;
+	for (int p = passCount - 1; p >= 0; p--)
+	{
+		Pass& pass = passes[p];
+
+		pass.Culled = true;
+		for (Access& w : pass.Writes)
+		{
+			if (needed[w.Resource])
+				pass.Culled = false;
+		}
+
+		if (pass.Culled)
+		{
+			culledPasses++;
+			continue;
+		}
+
+		for (Access& w : pass.Writes)
+		{
+			bool replaces = (w.Flags & (FrameGraphWriteClear | FrameGraphWriteFullscreen)) != 0;
+			if (replaces && !ReadsResource(pass, w.Resource))
+				needed[w.Resource] = false;
+		}
+		for (FrameGraphResource r : pass.Reads)
+			needed[r] = true;
+	}
+
+	// Lifetimes over the surviving passes
+	for (Resource& resource : resources)
+	{
+		resource.FirstUse = -1;
+		resource.LastUse = -1;
+		resource.Physical = -1;
+	}
+
+	for (int p = 0; p < passCount; p++)
+	{
+		Pass& pass = passes[p];
+		if (pass.Culled)
+			continue;
+
+		std::vector<FrameGraphResource> touched = pass.Reads;
+		for (Access& w : pass.Writes)
+			touched.push_back(w.Resource);
+
+		for (FrameGraphResource r : touched)
+		{
+			if (resources[r].FirstUse < 0)
+				resources[r].FirstUse = p;
+			resources[r].LastUse = p;
+		}
+	}
+
+	// Outputs have to survive to the end of the frame
+	for (Resource& resource : resources)
+	{
+		if (resource.Output && resource.FirstUse >= 0)
+			resource.LastUse = passCount;
+	}
+
+	// Clears are only worth doing if the pass doesn't cover
+	// the whole target itself
+	clearsRemoved = 0;
+	for (Pass& pass : passes)
+	{
+		for (Access& w : pass.Writes)
+		{
+			w.KeepClear = false;
+			if (!(w.Flags & FrameGraphWriteClear))
+				continue;
+
+			if (pass.Culled || (w.Flags & FrameGraphWriteFullscreen))
+				clearsRemoved++;
+			else
+				w.KeepClear = true;
+		}
+	}
+
+	// Alias transient textures - in order of first use, take the
+	// first physical target with the same description that is
+	// free by then, or make a new one
+	std::vector<FrameGraphResource> order;
+	for (int r = 0; r < resourceCount; r++)
+	{
+		if (!resources[r].Imported && resources[r].FirstUse >= 0)
+			order.push_back(r);
+	}
+	std::stable_sort(order.begin(), order.end(),
+		[this](FrameGraphResource a, FrameGraphResource b) { return resources[a].FirstUse < resources[b].FirstUse; });
+
+	physical.clear();
+	std::vector<int> physicalFreeAfter;
+	for (FrameGraphResource r : order)
+	{
+		Resource& resource = resources[r];
+
+		for (size_t i = 0; i < physical.size(); i++)
+		{
+			FrameGraphTextureDesc& desc = physical[i];
+			if (physicalFreeAfter[i] < resource.FirstUse &&
+				desc.Width == resource.Desc.Width &&
+				desc.Height == resource.Desc.Height &&
+				desc.Format == resource.Desc.Format &&
+				desc.BindFlags == resource.Desc.BindFlags)
+			{
+				resource.Physical = (int)i;
+				break;
+			}
+		}
+
+		if (resource.Physical < 0)
+		{
+			resource.Physical = (int)physical.size();
+			physical.push_back(resource.Desc);
+			physicalFreeAfter.push_back(0);
+		}
+		physicalFreeAfter[resource.Physical] = resource.LastUse;
+	}
+	transientCount = (int)order.size();
+
+	return true;
+}
+
+void FrameGraph::Execute(const std::function<void(FrameGraphResource, const float*)>& clear,
+	const std::function<void(int, bool)>& marker)
+{
+	for (int p = 0; p < (int)passes.size(); p++)
+	{
+		Pass& pass = passes[p];
+		if (pass.Culled)
+			continue;
+
+		if (marker)
+			marker(p, true);
+
+		for (Access& w : pass.Writes)
+		{
+			if (w.KeepClear)
+				clear(w.Resource, w.ClearColor);
+		}
+
+		if (pass.Execute)
+			pass.Execute();
+
+		if (marker)
+			marker(p, false);
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Handle to a texture declared on a FrameGraph
+typedef int FrameGraphResource;
+
+// --------------------------------------------------------
+// Everything needed to create (or reuse) a transient target
+// --------------------------------------------------------
+struct FrameGraphTextureDesc {
+	unsigned int Width;
+	unsigned int Height;
+	uint32_t Format;		// DXGI_FORMAT value
+	uint32_t BindFlags;		// Extra D3D11_BIND_* flags, e.g. depth/stencil
+};
+
+// How a pass writes to a texture
+enum FrameGraphWriteFlags {
+	FrameGraphWriteClear = 0x1,			// Pass wants the target cleared first
+	FrameGraphWriteFullscreen = 0x2		// Pass overwrites every pixel
+};
+
+// --------------------------------------------------------
+// A declarative description of a frame's render passes
+//
+// Passes declare which textures they read and write, then
+// Compile() works out:
+//  - Which passes can be culled because nothing that reaches
+//    an output depends on them
+//  - The first and last pass that touches each texture
+//  - Which transient textures can share one physical target
+//    (same description, lifetimes that don't overlap)
+//  - Which requested clears are redundant because the pass
+//    overwrites the whole target anyway
+//
+// The graph only deals in handles and descriptions.  Creating the
+// physical targets and binding them is left to whoever executes it,
+// so the compiler runs without a device.
+// --------------------------------------------------------
+class FrameGraph {
+public:
+	FrameGraph();
+	~FrameGraph();
+
+	// Drops every pass and resource
+	void Reset();
+
+	// Transient textures are owned by the graph and may be aliased.
+	// Imported textures (back buffer, shadow map...) live elsewhere
+	// and are only tracked for dependencies.
+	FrameGraphResource CreateTexture(const std::string& name, const FrameGraphTextureDesc& desc);
+	FrameGraphResource ImportTexture(const std::string& name);
+
+	// Keeps the passes that produce this texture alive
+	void MarkOutput(FrameGraphResource resource);
+
+	int AddPass(const std::string& name, std::function<void()> execute);
+	void Read(int pass, FrameGraphResource resource);
+	void Write(int pass, FrameGraphResource resource, unsigned int flags = 0, const float clearColor[4] = 0);
+
+	bool Compile();
+
+	// Runs every surviving pass in order.  clear is called for each
+	// clear that survived compilation, right before its pass.  If
+	// given, marker is called with true before a pass (and its
+	// clears) and with false after it.
+	void Execute(const std::function<void(FrameGraphResource, const float*)>& clear,
+		const std::function<void(int, bool)>& marker = nullptr);
+
+	// Compile results
+	bool IsPassCulled(int pass) { return passes[pass].Culled; }
+	int GetPassCount() { return (int)passes.size(); }
+	const std::string& GetPassName(int pass) { return passes[pass].Name; }
+	int GetResourceCount() { return (int)resources.size(); }
+	const std::string& GetResourceName(FrameGraphResource resource) { return resources[resource].Name; }
+	int GetFirstUse(FrameGraphResource resource) { return resources[resource].FirstUse; }
+	int GetLastUse(FrameGraphResource resource) { return resources[resource].LastUse; }
+
+	// Index into GetPhysicalTextures(), or -1 for imported
+	// and unused textures
+	int GetPhysicalIndex(FrameGraphResource resource) { return resources[resource].Physical; }
+	const std::vector<FrameGraphTextureDesc>& GetPhysicalTextures() { return physical; }
+
+	int GetCulledPassCount() { return culledPasses; }
+	int GetTransientCount() { return transientCount; }
+	int GetClearsRemoved() { return clearsRemoved; }
+
+private:
+	struct Access {
+		FrameGraphResource Resource;
+		unsigned int Flags;
+		float ClearColor[4];
+		bool KeepClear;
+	};
+
+	struct Pass {
+		std::string Name;
+		std::function<void()> Execute;
+		std::vector<FrameGraphResource> Reads;
+		std::vector<Access> Writes;
+		bool Culled;
+	};
+
+	struct Resource {
+		std::string Name;
+		FrameGraphTextureDesc Desc;
+		bool Imported;
+		bool Output;
+		int FirstUse;
+		int LastUse;
+		int Physical;
+	};
+
+	std::vector<Pass> passes;
+	std::vector<Resource> resources;
+	std::vector<FrameGraphTextureDesc> physical;
+
+	int culledPasses;
+	int transientCount;
+	int clearsRemoved;
+
+	bool ReadsResource(Pass& pass, FrameGraphResource resource);
+};
@@ -2,6 +2,10 @@
 #include "Vertex.h"
 #include "WICTextureLoader.h"
 #include "DDSTextureLoader.h" // For loading skyboxes (cube maps)
+#include "TextureLoader.h"
+#include "MappedDDSLoader.h"
+#include "WaveOutSink.h"
+#include <algorithm>
 // For the DirectX Math library
 using namespace DirectX;
 
@@ -27,8 +31,31 @@ Game::Game(HINSTANCE hInstance)
 	// Initialize fields
 	vertexBuffer = 0;
 	indexBuffer = 0;
+	packedVertices = true;
+	depthPrepass = true;
 	vertexShader = 0;
 	pixelShader = 0;
+	renderTargetPool = 0;
+	renderContext = 0;
+	trackGenerator = 0;
+	platformPool = 0;
+	commandRecorder = 0;
+	constantUploadHeap = 0;
+	materialTable = 0;
+	uiVS = 0;
+	uiPS = 0;
+	uiRenderer = 0;
+	menuUI = 0;
+	hudUI = 0;
+	gameOverUI = 0;
+	lightClusters = 0;
+	lightClusterBuffers = 0;
+	audioMixer = 0;
+	audioSink = 0;
+	audioOutput = 0;
+	landingSound = 0;
+	scoreSound = 0;
+	gameOverSound = 0;
 
 	
 #if defined(DEBUG) || defined(_DEBUG)
@@ -80,8 +107,12 @@ Game::~Game()
 	delete material3;
 	delete material4;
 	delete material5;
+	delete materialTable;
+	delete textureStreamer;
 
 	for (auto& e : platformEntity) delete e;
+	delete platformPool;
+	delete trackGenerator;
 	//for (auto& m : platformMesh) delete m;
 	delete sphereEntity;
 	delete sphereMesh;
@@ -92,27 +123,31 @@ Game::~Game()
 	delete ppVS;
 	delete ppPS;
 	delete brightPassPS;
-	delete horzBlurPS;
-	delete vertBlurPS;
+	delete downsamplePS;
+	delete blurPS;
+	delete upsamplePS;
+	delete upscalePS;
 	delete bloomPS;
-	ppSRV->Release();
-	ppSRV2->Release();
-	bpSRV->Release();
-	horBlurSRV->Release();
-	verBlurSRV->Release();
-	bpRTV->Release();
-	horBlurRTV->Release();
-	verBlurRTV->Release();
-	ppRTV->Release();
+	for (auto& t : frameGraphTargets) renderTargetPool->Release(t);
+	delete renderTargetPool;
+	bloomSampler->Release();
+	bloomAddBlendState->Release();
 	
 	//Clean up sky stuff
 	rasterStateSky->Release();
 	depthStateSky->Release();
+	depthStateEqual->Release();
 	skySRV1->Release();
 	skySRV2->Release();
 	
 	// Clean up shadow map
-	shadowDSV->Release();
+	for (int i = 0; i < shadowSettings.CascadeCount; i++)
+	{
+		shadowDSV[i]->Release();
+		shadowCacheDSV[i]->Release();
+	}
+	shadowTexture->Release();
+	shadowCacheTexture->Release();
 	shadowSRV->Release();
 	shadowRasterizer->Release();
 	shadowSampler->Release();
@@ -127,6 +162,12 @@ Game::~Game()
 	scoreUISprite->Release();
 	gameOverSprite->Release();
 	backgroundSprite->Release();
+	delete menuUI;
+	delete hudUI;
+	delete gameOverUI;
+	delete uiRenderer;
+	delete uiVS;
+	delete uiPS;
 
 	//Clean up particle
 	delete emitter;
@@ -135,6 +176,21 @@ Game::~Game()
 	particleTexture->Release();
 	particleBlendState->Release();
 	particleDepthState->Release();
+
+	delete lightClusters;
+	delete lightClusterBuffers;
+
+	// The thread first, it's still reading the sounds
+	delete audioOutput;
+	delete audioSink;
+	delete landingSound;
+	delete scoreSound;
+	delete gameOverSound;
+	delete audioMixer;
+
+	delete constantUploadHeap;
+	delete commandRecorder;
+	delete renderContext;
 }
 
 // --------------------------------------------------------
@@ -146,6 +202,12 @@ void Game::Init()
 	// Helper methods for loading shaders, creating some basic
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
+	renderContext = new RenderContext(context);
+	commandRecorder = new CommandRecorder();
+	constantUploadHeap = new ConstantUploadHeap(device, renderContext);
+	renderer.SetContext(renderContext);
+	renderer.SetUploadHeap(constantUploadHeap);
+
 	LoadShaders();
 	CreateMaterials();
 	CreateParticles();
@@ -153,17 +215,20 @@ void Game::Init()
 	CreateBasicGeometry();
 	CreatePostProcessResources();
 	CreateShadow();
+	CreateLightClusters();
+	CreateSounds();
 
 	//UI stuff
 
 	//Import Play Button Sprite
-	spriteBatch.reset(new SpriteBatch(context));
 	spriteFont.reset(new SpriteFont(device, L"Debug/TextureFiles/Arial.spriteFont"));
+	spriteText.reset(new SpriteText(spriteFont.get()));
 	CreateWICTextureFromFile(device, L"Debug/TextureFiles/cyanplaypanel.png", 0, &playButtonSprite);
 	CreateWICTextureFromFile(device, L"Debug/TextureFiles/cyanquitpanel.png", 0, &quitButtonSprite);
 	CreateWICTextureFromFile(device, L"Debug/TextureFiles/Score_New.png", 0, &scoreUISprite);
 	CreateWICTextureFromFile(device, L"Debug/TextureFiles/GameOverUINew.png", 0, &gameOverSprite);
 	CreateWICTextureFromFile(device, L"Debug/TextureFiles/StartScreen.png", 0, &backgroundSprite);
+	CreateUI();
 
 	//Fade in stuff ************************
 
@@ -202,22 +267,29 @@ void Game::Init()
 // --------------------------------------------------------
 void Game::LoadShaders()
 {
-	vertexShader = new SimpleVertexShader(device, context);
-	if (!vertexShader->LoadShaderFile(L"Debug/VertexShader.cso"))
-		vertexShader->LoadShaderFile(L"VertexShader.cso");		
+	if (packedVertices) {
+		vertexShader = LoadPackedVertexShader(L"PackedVertexShader.cso");
+		skyVertexShader = LoadPackedVertexShader(L"SkyVertexShader.cso");
+	} else {
+		vertexShader = new SimpleVertexShader(device, context);
+		if (!vertexShader->LoadShaderFile(L"Debug/VertexShader.cso"))
+			vertexShader->LoadShaderFile(L"VertexShader.cso");
+
+		skyVertexShader = new SimpleVertexShader(device, context);
+		if (!skyVertexShader->LoadShaderFile(L"Debug/SkyVertexShader.cso"))
+			skyVertexShader->LoadShaderFile(L"SkyVertexShader.cso.cso");
+	}
 
 	pixelShader = new SimplePixelShader(device, context);
 	if(!pixelShader->LoadShaderFile(L"Debug/PixelShader.cso"))	
 		pixelShader->LoadShaderFile(L"PixelShader.cso");
 
+	// Draws the position stream, whichever kind of vertex the
+	// meshes have
 	shadowVS = new SimpleVertexShader(device, context);
 	if (!shadowVS->LoadShaderFile(L"Debug/ShadowVS.cso"))
 		shadowVS->LoadShaderFile(L"ShadowVS.cso");
 
-	skyVertexShader = new SimpleVertexShader(device, context);
-	if (!skyVertexShader->LoadShaderFile(L"Debug/SkyVertexShader.cso"))
-		skyVertexShader->LoadShaderFile(L"SkyVertexShader.cso.cso");
-
 	skyPixelShader = new SimplePixelShader(device, context);
 	if (!skyPixelShader->LoadShaderFile(L"Debug/SkyPixelShader.cso"))
 		skyPixelShader->LoadShaderFile(L"SkyPixelShader.cso");
@@ -231,6 +303,15 @@ void Game::LoadShaders()
 	if (!particlePS->LoadShaderFile(L"Debug/ParticlePS.cso"))
 		particlePS->LoadShaderFile(L"ParticlePS.cso");
 
+	//UI
+	uiVS = new SimpleVertexShader(device, context);
+	if (!uiVS->LoadShaderFile(L"Debug/UIVS.cso"))
+		uiVS->LoadShaderFile(L"UIVS.cso");
+
+	uiPS = new SimplePixelShader(device, context);
+	if (!uiPS->LoadShaderFile(L"Debug/UIPS.cso"))
+		uiPS->LoadShaderFile(L"UIPS.cso");
+
 	//Postprocess stuff
 	ppVS = new SimpleVertexShader(device, context);
 	if (!ppVS->LoadShaderFile(L"Debug/PostProcessVS.cso"))
@@ -244,13 +325,21 @@ void Game::LoadShaders()
 	if (!brightPassPS->LoadShaderFile(L"Debug/BrightPassPS.cso"))
 		brightPassPS->LoadShaderFile(L"BrightPassPS.cso");
 
-	horzBlurPS = new SimplePixelShader(device, context);
-	if (!horzBlurPS->LoadShaderFile(L"Debug/BlurHorizontalPS.cso"))
-		horzBlurPS->LoadShaderFile(L"BlurHorizontalPS.cso");
+	downsamplePS = new SimplePixelShader(device, context);
+	if (!downsamplePS->LoadShaderFile(L"Debug/DownsamplePS.cso"))
+		downsamplePS->LoadShaderFile(L"DownsamplePS.cso");
+
+	blurPS = new SimplePixelShader(device, context);
+	if (!blurPS->LoadShaderFile(L"Debug/GaussianBlurPS.cso"))
+		blurPS->LoadShaderFile(L"GaussianBlurPS.cso");
 
-	vertBlurPS = new SimplePixelShader(device, context);
-	if (!vertBlurPS->LoadShaderFile(L"Debug/BlurVerticalPS.cso"))
-		vertBlurPS->LoadShaderFile(L"BlurVerticalPS.cso");
+	upsamplePS = new SimplePixelShader(device, context);
+	if (!upsamplePS->LoadShaderFile(L"Debug/UpsamplePS.cso"))
+		upsamplePS->LoadShaderFile(L"UpsamplePS.cso");
+
+	upscalePS = new SimplePixelShader(device, context);
+	if (!upscalePS->LoadShaderFile(L"Debug/UpscalePS.cso"))
+		upscalePS->LoadShaderFile(L"UpscalePS.cso");
 
 	bloomPS = new SimplePixelShader(device, context);
 	if (!bloomPS->LoadShaderFile(L"Debug/BloomFinalPS.cso"))
@@ -258,24 +347,35 @@ void Game::LoadShaders()
 }
 
 void Game::CreateMaterials() {
-	CreateWICTextureFromFile(device, context, L"Debug/TextureFiles/Cobble.tif", 0, &sphereSRV);
-	CreateWICTextureFromFile(device, context, L"Debug/TextureFiles/Cobblestone.tiff", 0, &tileSRV);
-	CreateWICTextureFromFile(device, context, L"Debug/TextureFiles/Cobblestone_Normal.tiff", 0, &normalTileSRV);
+	// Material textures prefer their cooked (block compressed, mipped) DDS versions
+	TextureLoader textureLoader(device, context);
 
-	CreateWICTextureFromFile(device, context, L"Debug/TextureFiles/Glass.tiff", 0, &material2SRV);
-	CreateWICTextureFromFile(device, context, L"Debug/TextureFiles/Glass_Normal.tiff", 0, &normal2SRV);
+	textureLoader.LoadTexture(L"Debug/TextureFiles/Cobble.tif", &sphereSRV);
+	textureLoader.LoadTexture(L"Debug/TextureFiles/Cobblestone.tiff", &tileSRV);
+	textureLoader.LoadTexture(L"Debug/TextureFiles/Cobblestone_Normal.tiff", &normalTileSRV);
 
-	CreateWICTextureFromFile(device, context, L"Debug/TextureFiles/Grass.tiff", 0, &material3SRV);
-	CreateWICTextureFromFile(device, context, L"Debug/TextureFiles/Grass_Normal.tiff", 0, &normal3SRV);
+	textureLoader.LoadTexture(L"Debug/TextureFiles/Glass.tiff", &material2SRV);
+	textureLoader.LoadTexture(L"Debug/TextureFiles/Glass_Normal.tiff", &normal2SRV);
 
-	CreateWICTextureFromFile(device, context, L"Debug/TextureFiles/Ice.tiff", 0, &material4SRV);
-	CreateWICTextureFromFile(device, context, L"Debug/TextureFiles/Ice_Normal.tiff", 0, &normal4SRV);
+	textureLoader.LoadTexture(L"Debug/TextureFiles/Grass.tiff", &material3SRV);
+	textureLoader.LoadTexture(L"Debug/TextureFiles/Grass_Normal.tiff", &normal3SRV);
 
-	CreateWICTextureFromFile(device, context, L"Debug/TextureFiles/LavaRocks.tiff", 0, &material5SRV);
-	CreateWICTextureFromFile(device, context, L"Debug/TextureFiles/LavaRocks_Normal.tiff", 0, &normal5SRV);
+	textureLoader.LoadTexture(L"Debug/TextureFiles/Ice.tiff", &material4SRV);
+	textureLoader.LoadTexture(L"Debug/TextureFiles/Ice_Normal.tiff", &normal4SRV);
 
-	CreateDDSTextureFromFile(device, L"Debug/TextureFiles/Stormy.dds", 0, &skySRV1);
-	CreateDDSTextureFromFile(device, L"Debug/TextureFiles/Sunset.dds", 0, &skySRV2);
+	textureLoader.LoadTexture(L"Debug/TextureFiles/LavaRocks.tiff", &material5SRV);
+	textureLoader.LoadTexture(L"Debug/TextureFiles/LavaRocks_Normal.tiff", &normal5SRV);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	textureLoader.PrintStats();
+#endif
+
+	// Sky cube maps are read straight out of a file mapping, falling back
+	// to the regular loader for anything the mapped path doesn't handle
+	if (FAILED(CreateMappedDDSTextureFromFile(device, L"Debug/TextureFiles/Stormy.dds", &skySRV1)))
+		CreateDDSTextureFromFile(device, L"Debug/TextureFiles/Stormy.dds", 0, &skySRV1);
+	if (FAILED(CreateMappedDDSTextureFromFile(device, L"Debug/TextureFiles/Sunset.dds", &skySRV2)))
+		CreateDDSTextureFromFile(device, L"Debug/TextureFiles/Sunset.dds", 0, &skySRV2);
 
 	CreateWICTextureFromFile(device, context, L"Debug/TextureFiles/particle.jpg", 0, &particleTexture);
 
@@ -294,6 +394,34 @@ void Game::CreateMaterials() {
 	material4 = new Material(pixelShader, vertexShader, material4SRV, normal4SRV, sampler1);
 	material5 = new Material(pixelShader, vertexShader, material5SRV, normal5SRV, sampler1);
 
+	// Cooked material textures stream their mips based on screen size
+	textureStreamer = new TextureStreamer(device, 32 * 1024 * 1024);
+	textureStreamer->Register(L"Debug/TextureFiles/Cobblestone.tiff", material1, false, &tileSRV);
+	textureStreamer->Register(L"Debug/TextureFiles/Cobblestone_Normal.tiff", material1, true, &normalTileSRV);
+	textureStreamer->Register(L"Debug/TextureFiles/Glass.tiff", material2, false, &material2SRV);
+	textureStreamer->Register(L"Debug/TextureFiles/Glass_Normal.tiff", material2, true, &normal2SRV);
+	textureStreamer->Register(L"Debug/TextureFiles/Grass.tiff", material3, false, &material3SRV);
+	textureStreamer->Register(L"Debug/TextureFiles/Grass_Normal.tiff", material3, true, &normal3SRV);
+	textureStreamer->Register(L"Debug/TextureFiles/Ice.tiff", material4, false, &material4SRV);
+	textureStreamer->Register(L"Debug/TextureFiles/Ice_Normal.tiff", material4, true, &normal4SRV);
+	textureStreamer->Register(L"Debug/TextureFiles/LavaRocks.tiff", material5, false, &material5SRV);
+	textureStreamer->Register(L"Debug/TextureFiles/LavaRocks_Normal.tiff", material5, true, &normal5SRV);
+
+	// What the lit pass actually binds - texture arrays made
+	// from the textures above, refreshed when they're restreamed
+	materialTable = new MaterialTable(device, renderContext);
+	materialTable->Add(material1);
+	materialTable->Add(material2);
+	materialTable->Add(material3);
+	materialTable->Add(material4);
+	materialTable->Add(material5);
+	materialTable->Build();
+	renderer.SetMaterialTable(materialTable);
+
+	// The arrays stay whole whatever is streamed out, so they
+	// come off the streaming budget
+	textureStreamer->SetReservedBytes((size_t)materialTable->GetTableBytes());
+
 	// Set up the rasterize state
 	D3D11_RASTERIZER_DESC rasterStateDesc = {};
 	rasterStateDesc.FillMode = D3D11_FILL_SOLID;
@@ -307,6 +435,14 @@ void Game::CreateMaterials() {
 	depthStateDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
 	device->CreateDepthStencilState(&depthStateDesc, &depthStateSky);
 
+	// Shading over the depth pre-pass - only the fragment that
+	// won is drawn, and depth is already right
+	D3D11_DEPTH_STENCIL_DESC equalDesc = {};
+	equalDesc.DepthEnable = true;
+	equalDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	equalDesc.DepthFunc = D3D11_COMPARISON_EQUAL;
+	device->CreateDepthStencilState(&equalDesc, &depthStateEqual);
+
 	
 }
 
@@ -354,6 +490,36 @@ void Game::CreateParticles()
 		particleTexture);
 }
 
+// --------------------------------------------------------
+// Loads a vertex shader that reads PackedVertex.  Reflection
+// would give every input a float format, so the layout is
+// made here with the packed formats instead.  Shaders that
+// only read the position (the sky) work too - the rest of
+// their inputs just get whatever is there.
+// --------------------------------------------------------
+SimpleVertexShader* Game::LoadPackedVertexShader(const wchar_t* file)
+{
+	std::wstring debugFile = std::wstring(L"Debug/") + file;
+	ID3DBlob* blob = 0;
+	if (FAILED(D3DReadFileToBlob(debugFile.c_str(), &blob)) && FAILED(D3DReadFileToBlob(file, &blob)))
+		return new SimpleVertexShader(device, context);
+
+	D3D11_INPUT_ELEMENT_DESC elements[] = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(PackedVertex, Position), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, offsetof(PackedVertex, Normal), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, offsetof(PackedVertex, Tangent), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, offsetof(PackedVertex, UV), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+	ID3D11InputLayout* inputLayout = 0;
+	device->CreateInputLayout(elements, ARRAYSIZE(elements), blob->GetBufferPointer(), blob->GetBufferSize(), &inputLayout);
+	blob->Release();
+
+	SimpleVertexShader* shader = new SimpleVertexShader(device, context, inputLayout, false);
+	if (!shader->LoadShaderFile(debugFile.c_str()))
+		shader->LoadShaderFile(file);
+	return shader;
+}
+
 // --------------------------------------------------------
 // Initializes the matrices necessary to represent our geometry's 
 // transformations and our 3D camera
@@ -363,20 +529,9 @@ void Game::CreateMatrices()
 	camera = new Camera(0, 0, -5);
 	camera->UpdateProjectionMatrix((float) width / height);
 
-	// Shadow view matrix (where the light is looking from)
-	XMMATRIX shView = XMMatrixLookAtLH(
-		XMVectorSet(0, 20, -20, 0), // Eye position
-		XMVectorSet(0, 0, 0, 0),		// Look at pos
-		XMVectorSet(0, 1, 0, 0));		// Up
-	XMStoreFloat4x4(&shadowViewMatrix, XMMatrixTranspose(shView));
-
-	// Shadow proj matrix
-	XMMATRIX shProj = XMMatrixOrthographicLH(
-		10.0f,		// Ortho width
-		10.0f,		// Ortho height
-		0.1f,		// Near plane
-		100.0f);	// Far plane
-	XMStoreFloat4x4(&shadowProjectionMatrix, XMMatrixTranspose(shProj));
+	// Same light as the old fixed shadow matrix, which looked
+	// from (0, 20, -20) at the origin
+	shadowLightDirection = XMFLOAT3(0, -1, 1);
 }
 
 
@@ -385,156 +540,501 @@ void Game::CreateMatrices()
 // --------------------------------------------------------
 void Game::CreateBasicGeometry()
 {
-	sphereMesh = new Mesh("Debug/Models/sphere.obj", device);
-	platformMesh = new Mesh("Debug/Models/cube.obj", device);
-
-	GameEntity* p1 = new GameEntity(platformMesh, material1);
-	GameEntity* p2 = new GameEntity(platformMesh, material2);
-	GameEntity* p3 = new GameEntity(platformMesh, material3);
-	GameEntity* p4 = new GameEntity(platformMesh, material4);
-	GameEntity* p5 = new GameEntity(platformMesh, material5);
-
-	platformEntity.push_back(p1);
-	platformEntity.push_back(p2);
-	platformEntity.push_back(p3);
-	platformEntity.push_back(p4);
-	platformEntity.push_back(p5);
-
-	platformEntity[0]->SetPosition(0, -2, 0);
-	platformEntity[1]->SetPosition(0, -2, 2);
-	platformEntity[2]->SetPosition(0, -2, 4);
-	platformEntity[3]->SetPosition(0, -2, 6);
-	platformEntity[4]->SetPosition(0, -2, 8);
-
-	platformEntity[0]->SetScale(1, 0.3, 1);
-	platformEntity[1]->SetScale(1, 0.3, 1);
-	platformEntity[2]->SetScale(1, 0.3, 1);
-	platformEntity[3]->SetScale(1, 0.3, 1);
-	platformEntity[4]->SetScale(1, 0.3, 1);
+	sphereMesh = new Mesh("Debug/Models/sphere.obj", device, packedVertices);
+	platformMesh = new Mesh("Debug/Models/cube.obj", device, packedVertices);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	for (int i = 0; i < sphereMesh->GetLODCount(); i++)
+	{
+		const MeshLOD& lod = sphereMesh->GetLOD(i);
+		printf("\nSphere LOD %d: %d triangles (%.0f%%), error %.4f",
+			i, lod.IndexCount / 3, 100.0f * lod.IndexCount / sphereMesh->GetIndexCount(), lod.Error);
+	}
+	VertexCacheStats before = sphereMesh->GetCacheStatsBefore();
+	VertexCacheStats after = sphereMesh->GetCacheStats();
+	printf("\nSphere vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+		before.ACMR, after.ACMR, before.ATVR, after.ATVR);
+
+	// What packing saves, and what it costs in precision
+	Mesh* meshes[2] = { sphereMesh, platformMesh };
+	const char* names[2] = { "Sphere", "Platform" };
+	for (int i = 0; i < 2; i++)
+	{
+		const VertexPackingStats& packing = meshes[i]->GetPackingStats();
+		int count = meshes[i]->GetVertexCount();
+		printf("\n%s vertices: %d x %d bytes = %d (%d as Vertex), normal error %.4f deg, tangent %.4f deg, UV %.6f",
+			names[i], count, meshes[i]->GetVertexStride(), count * meshes[i]->GetVertexStride(), count * (int)sizeof(Vertex),
+			packing.MaxNormalError, packing.MaxTangentError, packing.MaxUVError);
+	}
+#endif
+
+	// The track - seeded, so every run gets the same layout like
+	// it did with unseeded rand().  Lanes sit at x = 0, 1 and 2.
+	trackRules.Seed = 1;
+	trackRules.LaneCount = 3;
+	trackRules.LaneWidth = 1.0f;
+	trackRules.Spacing = 2.0f;
+	trackRules.Height = -2.0f;
+	trackRules.ViewDistance = 10.0f;
+	trackRules.EasyCount = 5;
+	trackRules.HardCount = 80;
+	trackRules.LaneChangeEasy = 0.3f;
+	trackRules.LaneChangeHard = 0.9f;
+	trackRules.MaxJumpEasy = 1;
+	trackRules.MaxJumpHard = 2;
+	trackGenerator = new TrackGenerator(trackRules);
+
+	// One platform entity per pool slot, materials taking turns
+	Material* platformMaterials[5] = { material1, material2, material3, material4, material5 };
+	int poolSize = (int)(trackRules.ViewDistance / trackRules.Spacing);
+	platformPool = new PlatformPool(poolSize);
+	for (int i = 0; i < poolSize; i++)
+	{
+		TrackPiece piece = trackGenerator->TakePiece();
+		int slot = platformPool->Recycle(piece);
+
+		GameEntity* platform = new GameEntity(platformMesh, platformMaterials[i % 5]);
+		platform->SetPosition(piece.X, piece.Y, slot * trackRules.Spacing);
+		platform->SetScale(1, 0.3, 1);
+		platformEntity.push_back(platform);
+	}
 
 	sphereEntity = new GameEntity(sphereMesh, material1);
 	sphereEntity->SetPosition(0, -1.6f, 0);
 	sphereEntity->SetScale(0.5f, 0.5f, 0.5f);
 	//entities.push_back(sphere);
 
-	skyCubeMesh = new Mesh("Debug/Models/cube.obj", device);
+	// Colliders - the cube mesh spans -0.5 to 0.5.  Platforms are
+	// timed to arrive under the ball and their spacing drifts a
+	// little against its bounces, so along z each collider fills
+	// the gap to the next platform (2 units) and landing only
+	// depends on x, as it always has.
+	for (unsigned int i = 0; i < platformEntity.size(); i++)
+	{
+		XMFLOAT3 position = platformEntity[i]->GetPosition();
+		XMFLOAT3 scale = platformEntity[i]->GetScale();
+		float center[3] = { position.x, position.y, position.z };
+		float halfExtents[3] = { scale.x * 0.5f, scale.y * 0.5f, 1.0f };
+		collisionWorld.AddBox(center, halfExtents);
+	}
+
+	XMFLOAT3 ballPosition = sphereEntity->GetPosition();
+	float ballCenter[3] = { ballPosition.x, ballPosition.y, ballPosition.z };
+	ballCollider = collisionWorld.AddSphere(ballCenter, sphereMesh->GetBoundingRadius() * sphereEntity->GetScale().x);
+
+	skyCubeMesh = new Mesh("Debug/Models/cube.obj", device, packedVertices);
 	skyCubeEntity = new GameEntity(skyCubeMesh, material1);
 }
 
 void Game::CreatePostProcessResources()
 {
 	// Create post process resources -----------------------------------------
-	D3D11_TEXTURE2D_DESC textureDesc = {};
-	textureDesc.Width = width;
-	textureDesc.Height = height;
-	textureDesc.ArraySize = 1;
-	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	textureDesc.CPUAccessFlags = 0;
-	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	textureDesc.MipLevels = 1;
-	textureDesc.MiscFlags = 0;
-	textureDesc.SampleDesc.Count = 1;
-	textureDesc.SampleDesc.Quality = 0;
-	textureDesc.Usage = D3D11_USAGE_DEFAULT;
-
-	ID3D11Texture2D* ppTexture;
-	device->CreateTexture2D(&textureDesc, 0, &ppTexture);
-
-	// Create the Render Target View
-	D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
-	rtvDesc.Format = textureDesc.Format;
-	rtvDesc.Texture2D.MipSlice = 0;
-	rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-
-	device->CreateRenderTargetView(ppTexture, &rtvDesc, &ppRTV);
-
-	//device->CreateRenderTargetView(ppTexture, &rtvDesc, &horBlurRTV);
-
-	// Create the Shader Resource View
-	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Format = textureDesc.Format;
-	srvDesc.Texture2D.MipLevels = 1;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	renderTargetPool = new RenderTargetPool(device);
+
+	D3D11_SAMPLER_DESC bloomSamplerDesc = {};
+	bloomSamplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	bloomSamplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	bloomSamplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	bloomSamplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	bloomSamplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	device->CreateSamplerState(&bloomSamplerDesc, &bloomSampler);
+
+	D3D11_BLEND_DESC addDesc = {};
+	addDesc.RenderTarget[0].BlendEnable = true;
+	addDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
+	addDesc.RenderTarget[0].DestBlend = D3D11_BLEND_ONE;
+	addDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+	addDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+	addDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ONE;
+	addDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	addDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	device->CreateBlendState(&addDesc, &bloomAddBlendState);
+
+	// 13 texel Gaussian per direction, 7 fetches with linear sampling
+	bloomTapCount = BuildLinearBlurTaps(2.5f, 6, bloomTaps, BloomMaxTaps);
+
+	BuildFrameGraph();
+}
 
-	device->CreateShaderResourceView(ppTexture, &srvDesc, &ppSRV);
-	device->CreateShaderResourceView(ppTexture, &srvDesc, &ppSRV2);
+// --------------------------------------------------------
+// Declares the frame's passes and what they read and write:
+//  - Shadow map
+//  - Scene into a full size target
+//  - Bright pass into the half size bloom level
+//  - Downsample that through the rest of the levels
+//  - Separable Gaussian blur on every level
+//  - Add each level onto the next larger one, smallest first
+//  - Upscale the scene to the window size if it was scaled down
+//  - Composite the bloom over the scene into the back buffer
+//  - Score on top, at full resolution
+// then compiles it and creates the physical targets it asks for.
+// --------------------------------------------------------
+void Game::BuildFrameGraph()
+{
+	// Hand the old targets back so the new graph can pick them up again
+	for (auto& t : frameGraphTargets) renderTargetPool->Release(t);
+	frameGraphTargets.clear();
+	frameGraph.Reset();
 
-	// We don't need the texture reference itself no mo'
-	ppTexture->Release();
+	renderWidth = max((unsigned int)(width * renderScale + 0.5f), 1);
+	renderHeight = max((unsigned int)(height * renderScale + 0.5f), 1);
 
-	ID3D11Texture2D* bpTexture;
-	device->CreateTexture2D(&textureDesc, 0, &bpTexture);
-	// Create the Render Target View
-	D3D11_RENDER_TARGET_VIEW_DESC bprtvDesc = {};
-	bprtvDesc.Format = textureDesc.Format;
-	bprtvDesc.Texture2D.MipSlice = 0;
-	bprtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+	// Bloom level 0 is half size, keep halving until we run out of levels or pixels
+	unsigned int bloomWidth = max(renderWidth / 2, 1);
+	unsigned int bloomHeight = max(renderHeight / 2, 1);
 
-	device->CreateRenderTargetView(bpTexture, &bprtvDesc, &bpRTV);
+	bloomLevels = 1;
+	while (bloomLevels < maxBloomLevels &&
+		((bloomWidth >> bloomLevels) > 0 || (bloomHeight >> bloomLevels) > 0))
+		bloomLevels++;
 
-	D3D11_SHADER_RESOURCE_VIEW_DESC bpsrvDesc = {};
-	bpsrvDesc.Format = textureDesc.Format;
-	bpsrvDesc.Texture2D.MipLevels = 1;
-	bpsrvDesc.Texture2D.MostDetailedMip = 0;
-	bpsrvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	// Textures that live outside the graph
+	FrameGraphResource shadowMap = frameGraph.ImportTexture("ShadowMap");
+	FrameGraphResource backBuffer = frameGraph.ImportTexture("BackBuffer");
+	frameGraph.MarkOutput(backBuffer);
 
-	device->CreateShaderResourceView(bpTexture, &bpsrvDesc, &bpSRV);
+	// Transient textures
+	FrameGraphTextureDesc sceneDesc = { renderWidth, renderHeight, DXGI_FORMAT_R8G8B8A8_UNORM, 0 };
+	sceneColor = frameGraph.CreateTexture("SceneColor", sceneDesc);
 
-	bpTexture->Release();
+	FrameGraphTextureDesc depthDesc = { renderWidth, renderHeight, DXGI_FORMAT_D24_UNORM_S8_UINT, D3D11_BIND_DEPTH_STENCIL };
+	sceneDepth = frameGraph.CreateTexture("SceneDepth", depthDesc);
 
-	ID3D11Texture2D* hbTexture;
-	device->CreateTexture2D(&textureDesc, 0, &hbTexture);
+	for (int i = 0; i < bloomLevels; i++)
+	{
+		FrameGraphTextureDesc levelDesc = {
+			max(bloomWidth >> i, 1),
+			max(bloomHeight >> i, 1),
+			DXGI_FORMAT_R8G8B8A8_UNORM,
+			0 };
+		bloomLevel[i] = frameGraph.CreateTexture("BloomLevel" + std::to_string(i), levelDesc);
+		bloomTemp[i] = frameGraph.CreateTexture("BloomTemp" + std::to_string(i), levelDesc);
+	}
 
-	D3D11_RENDER_TARGET_VIEW_DESC hbrtvDesc = {};
-	hbrtvDesc.Format = textureDesc.Format;
-	hbrtvDesc.Texture2D.MipSlice = 0;
-	hbrtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+	// Shadow map
+	int pass = frameGraph.AddPass("Shadow", [this]() {
+		RenderShadowMap();
+	});
+	frameGraph.Write(pass, shadowMap);
+
+	// Scene
+	const float sceneClearColor[4] = { 1.0f, 1.0f, 0.0f, 0.0f };
+	const float depthClear[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+	pass = frameGraph.AddPass("Scene", [this]() {
+		BindTarget(sceneColor, GetTarget(sceneDepth).DSV);
+		if (depthPrepass)
+			DrawDepthPrepass();
+		BuildLightClusters();
+		DrawScene();
+	});
+	frameGraph.Read(pass, shadowMap);
+	frameGraph.Write(pass, sceneColor, FrameGraphWriteClear, sceneClearColor);
+	frameGraph.Write(pass, sceneDepth, FrameGraphWriteClear, depthClear);
+
+	// Bright pass - the linear filter averages each 2x2
+	// block of the scene on the way down to half size
+	pass = frameGraph.AddPass("BrightPass", [this]() {
+		BindTarget(bloomLevel[0]);
+		renderContext->SetShaderResourceView(brightPassPS, "BrightPassTex", GetTarget(sceneColor).SRV);
+		renderContext->SetSamplerState(brightPassPS, "Sampler", bloomSampler);
+		renderContext->CopyAllBufferData(brightPassPS);
+		renderContext->SetShader(brightPassPS);
+		DrawFullscreenTriangle();
+		renderContext->SetShaderResourceView(brightPassPS, "BrightPassTex", 0);
+	});
+	frameGraph.Read(pass, sceneColor);
+	frameGraph.Write(pass, bloomLevel[0], FrameGraphWriteFullscreen);
+
+	// Downsample chain
+	for (int i = 1; i < bloomLevels; i++)
+	{
+		pass = frameGraph.AddPass("Downsample" + std::to_string(i), [this, i]() {
+			RenderTarget& source = GetTarget(bloomLevel[i - 1]);
+			BindTarget(bloomLevel[i]);
+
+			float sourceTexelSize[2] = { 1.0f / source.Width, 1.0f / source.Height };
+			downsamplePS->SetFloat2("sourceTexelSize", sourceTexelSize);
+			renderContext->SetShaderResourceView(downsamplePS, "SourceTex", source.SRV);
+			renderContext->SetSamplerState(downsamplePS, "Sampler", bloomSampler);
+			renderContext->CopyAllBufferData(downsamplePS);
+			renderContext->SetShader(downsamplePS);
+			DrawFullscreenTriangle();
+			renderContext->SetShaderResourceView(downsamplePS, "SourceTex", 0);
+		});
+		frameGraph.Read(pass, bloomLevel[i - 1]);
+		frameGraph.Write(pass, bloomLevel[i], FrameGraphWriteFullscreen);
+	}
 
-	device->CreateRenderTargetView(hbTexture, &hbrtvDesc, &horBlurRTV);
+	// Blur each level, horizontally into the temp texture and back
+	for (int i = 0; i < bloomLevels; i++)
+	{
+		for (int direction = 0; direction < 2; direction++)
+		{
+			FrameGraphResource source = direction == 0 ? bloomLevel[i] : bloomTemp[i];
+			FrameGraphResource dest = direction == 0 ? bloomTemp[i] : bloomLevel[i];
+
+			pass = frameGraph.AddPass((direction == 0 ? "BlurH" : "BlurV") + std::to_string(i), [this, source, dest, direction]() {
+				RenderTarget& sourceTarget = GetTarget(source);
+				BindTarget(dest);
+
+				float taps[BloomMaxTaps][4] = {};
+				for (int t = 0; t < bloomTapCount; t++)
+				{
+					taps[t][0] = bloomTaps[t].Offset;
+					taps[t][1] = bloomTaps[t].Weight;
+				}
+
+				float texelStep[2] = {
+					direction == 0 ? 1.0f / sourceTarget.Width : 0.0f,
+					direction == 0 ? 0.0f : 1.0f / sourceTarget.Height };
+				blurPS->SetInt("tapCount", bloomTapCount);
+				blurPS->SetData("taps", taps, sizeof(taps));
+				blurPS->SetFloat2("texelStep", texelStep);
+				renderContext->SetShaderResourceView(blurPS, "BlurTex", sourceTarget.SRV);
+				renderContext->SetSamplerState(blurPS, "Sampler", bloomSampler);
+				renderContext->CopyAllBufferData(blurPS);
+				renderContext->SetShader(blurPS);
+				DrawFullscreenTriangle();
+				renderContext->SetShaderResourceView(blurPS, "BlurTex", 0);
+			});
+			frameGraph.Read(pass, source);
+			frameGraph.Write(pass, dest, FrameGraphWriteFullscreen);
+		}
+	}
 
-	D3D11_SHADER_RESOURCE_VIEW_DESC hbsrvDesc = {};
-	hbsrvDesc.Format = textureDesc.Format;
-	hbsrvDesc.Texture2D.MipLevels = 1;
-	hbsrvDesc.Texture2D.MostDetailedMip = 0;
-	hbsrvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	// Upsample chain - additive, so each level ends up
+	// holding itself plus everything smaller
+	for (int i = bloomLevels - 2; i >= 0; i--)
+	{
+		pass = frameGraph.AddPass("Upsample" + std::to_string(i), [this, i]() {
+			RenderTarget& source = GetTarget(bloomLevel[i + 1]);
+			BindTarget(bloomLevel[i]);
+
+			float blendFactor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			renderContext->OMSetBlendState(bloomAddBlendState, blendFactor, 0xFFFFFFFF);
+
+			float sourceTexelSize[2] = { 1.0f / source.Width, 1.0f / source.Height };
+			upsamplePS->SetFloat2("sourceTexelSize", sourceTexelSize);
+			renderContext->SetShaderResourceView(upsamplePS, "SourceTex", source.SRV);
+			renderContext->SetSamplerState(upsamplePS, "Sampler", bloomSampler);
+			renderContext->CopyAllBufferData(upsamplePS);
+			renderContext->SetShader(upsamplePS);
+			DrawFullscreenTriangle();
+			renderContext->SetShaderResourceView(upsamplePS, "SourceTex", 0);
+
+			renderContext->OMSetBlendState(0, blendFactor, 0xFFFFFFFF);
+		});
+		frameGraph.Read(pass, bloomLevel[i + 1]);
+		frameGraph.Read(pass, bloomLevel[i]);
+		frameGraph.Write(pass, bloomLevel[i]);
+	}
 
-	device->CreateShaderResourceView(hbTexture, &hbsrvDesc, &horBlurSRV);
+	// Upscale the scene before it is composited
+	FrameGraphResource compositeScene = sceneColor;
+	if (renderWidth != (unsigned int)width || renderHeight != (unsigned int)height)
+	{
+		FrameGraphTextureDesc upscaledDesc = { (unsigned int)width, (unsigned int)height, DXGI_FORMAT_R8G8B8A8_UNORM, 0 };
+		compositeScene = frameGraph.CreateTexture("UpscaledScene", upscaledDesc);
+
+		pass = frameGraph.AddPass("Upscale", [this, compositeScene]() {
+			BindTarget(compositeScene);
+
+			float sourceSize[2] = { (float)renderWidth, (float)renderHeight };
+			upscalePS->SetFloat2("sourceSize", sourceSize);
+			renderContext->SetShaderResourceView(upscalePS, "SourceTex", GetTarget(sceneColor).SRV);
+			renderContext->SetSamplerState(upscalePS, "Sampler", bloomSampler);
+			renderContext->CopyAllBufferData(upscalePS);
+			renderContext->SetShader(upscalePS);
+			DrawFullscreenTriangle();
+			renderContext->SetShaderResourceView(upscalePS, "SourceTex", 0);
+		});
+		frameGraph.Read(pass, sceneColor);
+		frameGraph.Write(pass, compositeScene, FrameGraphWriteFullscreen);
+	}
 
-	hbTexture->Release();
+	// Composite into the back buffer
+	pass = frameGraph.AddPass("Composite", [this, compositeScene]() {
+		renderContext->OMSetRenderTargets(1, &backBufferRTV, 0);
+
+		D3D11_VIEWPORT viewport = {};
+		viewport.Width = (float)width;
+		viewport.Height = (float)height;
+		viewport.MinDepth = 0.0f;
+		viewport.MaxDepth = 1.0f;
+		renderContext->RSSetViewports(1, &viewport);
+
+		bloomPS->SetFloat("bloomIntensity", 1.0f / bloomLevels);
+		renderContext->SetShaderResourceView(bloomPS, "AllPassTex", GetTarget(bloomLevel[0]).SRV);
+		renderContext->SetShaderResourceView(bloomPS, "OgTex", GetTarget(compositeScene).SRV);
+		renderContext->SetSamplerState(bloomPS, "Sampler", bloomSampler);
+		renderContext->CopyAllBufferData(bloomPS);
+		renderContext->SetShader(bloomPS);
+		DrawFullscreenTriangle();
+		renderContext->SetShaderResourceView(bloomPS, "AllPassTex", 0);
+		renderContext->SetShaderResourceView(bloomPS, "OgTex", 0);
+	});
+	frameGraph.Read(pass, compositeScene);
+	frameGraph.Read(pass, bloomLevel[0]);
+	frameGraph.Write(pass, backBuffer, FrameGraphWriteClear | FrameGraphWriteFullscreen);
+
+	// Score UI
+	pass = frameGraph.AddPass("UI", [this]() {
+		//Only the score text ever changes - the panel stays
+		//in its static buffer
+		if (score != shownScore)
+		{
+			wchar_t scoreText[16];
+			FormatInteger(score, scoreText, 16);
+			hudUI->SetText(scoreTextElement, spriteText->Layout(scoreText));
+			shownScore = score;
+		}
+		uiRenderer->Draw(renderContext, hudUI, (float)width, (float)height);
+	});
+	frameGraph.Write(pass, backBuffer);
+
+	frameGraph.Compile();
+
+	// If any target can't be made (out of video memory, say) hand
+	// back the ones that were and don't run the graph at all,
+	// rather than have its passes bind a missing target
+	const std::vector<FrameGraphTextureDesc>& physical = frameGraph.GetPhysicalTextures();
+	frameGraphReady = true;
+	for (auto& desc : physical)
+	{
+		RenderTarget* target = renderTargetPool->Acquire(desc.Width, desc.Height, (DXGI_FORMAT)desc.Format, desc.BindFlags);
+		if (!target)
+		{
+			frameGraphReady = false;
+			break;
+		}
+		frameGraphTargets.push_back(target);
+	}
+	if (!frameGraphReady)
+	{
+		for (auto& t : frameGraphTargets) renderTargetPool->Release(t);
+		frameGraphTargets.clear();
+		renderTargetPool->Trim();
 
-	ID3D11Texture2D* vbTexture;
-	device->CreateTexture2D(&textureDesc, 0, &vbTexture);
+#if defined(DEBUG) || defined(_DEBUG)
+		printf("\nFrame graph: couldn't create a %ux%u render target, the scene won't be drawn\n", renderWidth, renderHeight);
+#endif
+		return;
+	}
 
-	D3D11_RENDER_TARGET_VIEW_DESC vbrtvDesc = {};
-	vbrtvDesc.Format = textureDesc.Format;
-	vbrtvDesc.Texture2D.MipSlice = 0;
-	vbrtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+#if defined(DEBUG) || defined(_DEBUG)
+	BloomTrafficEstimate traffic = EstimateBloomTraffic(renderWidth, renderHeight, bloomLevels, bloomTapCount, 4);
+	printf("\nBloom: %d levels, %d taps, %.1f MB read / %.1f MB written per frame",
+		bloomLevels,
+		bloomTapCount,
+		traffic.BytesRead / (1024.0 * 1024.0),
+		traffic.BytesWritten / (1024.0 * 1024.0));
+	printf("\nFrame graph: %d passes (%d culled), %d transient textures in %d targets, %d clears removed",
+		frameGraph.GetPassCount(),
+		frameGraph.GetCulledPassCount(),
+		frameGraph.GetTransientCount(),
+		(int)physical.size(),
+		frameGraph.GetClearsRemoved());
+	printf("\nRender targets: %d created, %d reused, %.1f MB pooled\n",
+		renderTargetPool->GetCreatedCount(),
+		renderTargetPool->GetReusedCount(),
+		renderTargetPool->GetPooledBytes() / (1024.0 * 1024.0));
+#endif
+}
 
-	device->CreateRenderTargetView(vbTexture, &vbrtvDesc, &verBlurRTV);
+// Only valid while frameGraphReady, which is the only time
+// the graph's passes run
+RenderTarget& Game::GetTarget(FrameGraphResource resource)
+{
+	return *frameGraphTargets[frameGraph.GetPhysicalIndex(resource)];
+}
 
-	D3D11_SHADER_RESOURCE_VIEW_DESC vbsrvDesc = {};
-	vbsrvDesc.Format = textureDesc.Format;
-	vbsrvDesc.Texture2D.MipLevels = 1;
-	vbsrvDesc.Texture2D.MostDetailedMip = 0;
-	vbsrvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+// --------------------------------------------------------
+// Renders into a frame graph texture with a matching viewport
+// --------------------------------------------------------
+void Game::BindTarget(FrameGraphResource resource, ID3D11DepthStencilView* depth)
+{
+	RenderTarget& target = GetTarget(resource);
+	renderContext->OMSetRenderTargets(1, &target.RTV, depth);
+
+	D3D11_VIEWPORT viewport = {};
+	viewport.Width = (float)target.Width;
+	viewport.Height = (float)target.Height;
+	viewport.MinDepth = 0.0f;
+	viewport.MaxDepth = 1.0f;
+	renderContext->RSSetViewports(1, &viewport);
+}
+
+// --------------------------------------------------------
+// Draws the post process vertex shader's 3 vertex triangle,
+// no buffers required
+// --------------------------------------------------------
+void Game::DrawFullscreenTriangle()
+{
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+	ID3D11Buffer* nothing = 0;
+	renderContext->IASetVertexBuffers(0, 1, &nothing, &stride, &offset);
+	renderContext->IASetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
 
-	device->CreateShaderResourceView(vbTexture, &vbsrvDesc, &verBlurSRV);
+	renderContext->SetShader(ppVS);
+	renderContext->Draw(3, 0);
+}
 
-	vbTexture->Release();
+void Game::CreateUI()
+{
+	uiRenderer = new UIRenderer(device, uiVS, uiPS);
+	shownScore = -1;
+
+	// Everything drawn at the texture's own size, like
+	// SpriteBatch::Draw with just a position
+	auto addImage = [](UITree* tree, ID3D11ShaderResourceView* texture, XMFLOAT2 position, bool isStatic) {
+		int textureWidth, textureHeight;
+		UIRenderer::GetTextureSize(texture, textureWidth, textureHeight);
+		tree->SetTextureSize(texture, textureWidth, textureHeight);
+		return tree->AddImage(-1, texture, position.x, position.y, (float)textureWidth, (float)textureHeight, isStatic);
+	};
+
+	menuUI = new UITree();
+	addImage(menuUI, backgroundSprite, XMFLOAT2(0, 0), true);
+	playButtonElement = addImage(menuUI, playButtonSprite, playSpritePosition, true);
+	quitButtonElement = addImage(menuUI, quitButtonSprite, quitSpritePosition, true);
+	menuUI->SetHitTestable(playButtonElement, true);
+	menuUI->SetHitTestable(quitButtonElement, true);
+
+	// Score text is the only thing on any screen that changes
+	hudUI = new UITree();
+	addImage(hudUI, scoreUISprite, XMFLOAT2(width / 2 - 600, height / 2 - 350), true);
+
+	ID3D11ShaderResourceView* fontSheet = 0;
+	spriteFont->GetSpriteSheet(&fontSheet);
+	int sheetWidth, sheetHeight;
+	UIRenderer::GetTextureSize(fontSheet, sheetWidth, sheetHeight);
+	hudUI->SetTextureSize(fontSheet, sheetWidth, sheetHeight);
+	scoreTextElement = hudUI->AddText(-1, fontSheet, width / 2 - 300, height / 2 - 310);
+	fontSheet->Release();	// Still held by the font
+
+	gameOverUI = new UITree();
+	addImage(gameOverUI, gameOverSprite, XMFLOAT2(0, 0), true);
 }
 
 void Game::CreateShadow()
 {
 	// Create shadow requirements ------------------------------------------
-	shadowMapSize = 2048;
-
-
-	// Create the actual texture that will be the shadow map
+	// The cascades are fitted tightly around the view, so each
+	// one gets by with fewer texels than the old single map
+	shadowMapSize = 1024;
+	shadowDistance = 30.0f;
+	shadowSettings.CascadeCount = 3;
+	shadowSettings.SplitLambda = 0.75f;
+	shadowSettings.MapSize = shadowMapSize;
+	shadowSettings.CasterDistance = 20.0f;
+
+	// Create the actual texture that will be the shadow map,
+	// one array slice per cascade
 	D3D11_TEXTURE2D_DESC shadowDesc = {};
 	shadowDesc.Width = shadowMapSize;
 	shadowDesc.Height = shadowMapSize;
-	shadowDesc.ArraySize = 1;
+	shadowDesc.ArraySize = shadowSettings.CascadeCount;
 	shadowDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
 	shadowDesc.CPUAccessFlags = 0;
 	shadowDesc.Format = DXGI_FORMAT_R32_TYPELESS;
@@ -543,26 +1043,43 @@ void Game::CreateShadow()
 	shadowDesc.SampleDesc.Count = 1;
 	shadowDesc.SampleDesc.Quality = 0;
 	shadowDesc.Usage = D3D11_USAGE_DEFAULT;
-	ID3D11Texture2D* shadowTexture;
 	device->CreateTexture2D(&shadowDesc, 0, &shadowTexture);
 
-	// Create the depth/stencil
-	D3D11_DEPTH_STENCIL_VIEW_DESC shadowDSDesc = {};
-	shadowDSDesc.Format = DXGI_FORMAT_D32_FLOAT;
-	shadowDSDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-	shadowDSDesc.Texture2D.MipSlice = 0;
-	device->CreateDepthStencilView(shadowTexture, &shadowDSDesc, &shadowDSV);
+	// Same again for the cached static casters, which only
+	// ever get copied into the real map
+	shadowDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+	device->CreateTexture2D(&shadowDesc, 0, &shadowCacheTexture);
+
+	// Create a depth/stencil for each slice
+	for (int i = 0; i < shadowSettings.CascadeCount; i++)
+	{
+		D3D11_DEPTH_STENCIL_VIEW_DESC shadowDSDesc = {};
+		shadowDSDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		shadowDSDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+		shadowDSDesc.Texture2DArray.MipSlice = 0;
+		shadowDSDesc.Texture2DArray.FirstArraySlice = i;
+		shadowDSDesc.Texture2DArray.ArraySize = 1;
+		device->CreateDepthStencilView(shadowTexture, &shadowDSDesc, &shadowDSV[i]);
+		device->CreateDepthStencilView(shadowCacheTexture, &shadowDSDesc, &shadowCacheDSV[i]);
+	}
 
-	// Create the SRV for the shadow map
+	// Create the SRV for the whole array
 	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
-	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MipLevels = 1;
-	srvDesc.Texture2D.MostDetailedMip = 0;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	srvDesc.Texture2DArray.MipLevels = 1;
+	srvDesc.Texture2DArray.MostDetailedMip = 0;
+	srvDesc.Texture2DArray.FirstArraySlice = 0;
+	srvDesc.Texture2DArray.ArraySize = shadowSettings.CascadeCount;
 	device->CreateShaderResourceView(shadowTexture, &srvDesc, &shadowSRV);
 
-	// Release the texture reference since we don't need it
-	shadowTexture->Release();
+	// Everything that can cast a shadow
+	shadowCasters.push_back(sphereEntity);
+	for (unsigned int i = 0; i < platformEntity.size(); i++)
+		shadowCasters.push_back(platformEntity[i]);
+
+	for (unsigned int i = 0; i < shadowCasters.size(); i++)
+		shadowCasterCache.AddCaster();
 
 	// Create the special "comparison" sampler state for shadows
 	D3D11_SAMPLER_DESC shadowSampDesc = {};
@@ -581,7 +1098,9 @@ void Game::CreateShadow()
 	D3D11_RASTERIZER_DESC shadowRastDesc = {};
 	shadowRastDesc.FillMode = D3D11_FILL_SOLID;
 	shadowRastDesc.CullMode = D3D11_CULL_BACK;
-	shadowRastDesc.DepthClipEnable = true;
+	// No depth clip, so casters between the light and a cascade
+	// get flattened onto its near plane instead of disappearing
+	shadowRastDesc.DepthClipEnable = false;
 	shadowRastDesc.DepthBias = 1000; // Multiplied by (smallest possible value > 0 in depth buffer)
 	shadowRastDesc.DepthBiasClamp = 0.0f;
 	shadowRastDesc.SlopeScaledDepthBias = 1.0f;
@@ -605,12 +1124,196 @@ void Game::CreateShadow()
 	device->CreateBlendState(&blendDesc, &blendState);
 }
 
+// --------------------------------------------------------
+// Clusters are 80 pixels across at 720p, with slices
+// spread over the camera's whole depth range
+// --------------------------------------------------------
+void Game::CreateLightClusters()
+{
+	LightClusterSettings settings = {};
+	settings.TilesX = 16;
+	settings.TilesY = 9;
+	settings.Slices = 24;
+	settings.Near = camera->GetNearClip();
+	settings.Far = camera->GetFarClip();
+	lightClusters = new LightClusterGrid(settings);
+	lightClusterBuffers = new LightClusterBuffers(device);
+
+	XMFLOAT3 ballPosition = sphereEntity->GetPosition();
+	for (int i = 0; i < ballTrailLights; i++)
+		ballTrail[i] = ballPosition;
+}
+
+// --------------------------------------------------------
+// Adds a tone sliding from startHz to endHz, fading out
+// exponentially, onto the end of samples
+// --------------------------------------------------------
+static void AddTone(std::vector<float>& samples, int sampleRate, float seconds, float startHz, float endHz, float decay)
+{
+	int frames = (int)(seconds * sampleRate);
+	float phase = 0;
+	for (int i = 0; i < frames; i++)
+	{
+		float t = i / (float)frames;
+		phase += 2 * XM_PI * (startHz + (endHz - startHz) * t) / sampleRate;
+		samples.push_back(0.5f * sinf(phase) * expf(-decay * t));
+	}
+}
+
+// --------------------------------------------------------
+// Plays through waveOut, or nowhere (at the same pace) if
+// there's no output device
+// --------------------------------------------------------
+void Game::CreateSounds()
+{
+	const int soundRate = 22050;
+	audioMixer = new AudioMixer(48000, 32);
+
+	// A thump on every bounce, a chime every ten points, and
+	// three falling notes at the end
+	std::vector<float> samples;
+	AddTone(samples, soundRate, 0.15f, 160, 60, 6);
+	landingSound = new SoundEffect(audioMixer, samples.data(), (int)samples.size(), 1, soundRate);
+
+	samples.clear();
+	AddTone(samples, soundRate, 0.1f, 880, 880, 2);
+	AddTone(samples, soundRate, 0.25f, 1320, 1320, 4);
+	scoreSound = new SoundEffect(audioMixer, samples.data(), (int)samples.size(), 1, soundRate);
+
+	samples.clear();
+	AddTone(samples, soundRate, 0.25f, 440, 440, 2);
+	AddTone(samples, soundRate, 0.25f, 349, 349, 2);
+	AddTone(samples, soundRate, 0.6f, 262, 250, 4);
+	gameOverSound = new SoundEffect(audioMixer, samples.data(), (int)samples.size(), 1, soundRate);
+
+	WaveOutSink* waveOut = new WaveOutSink(audioMixer->GetSampleRate());
+	if (waveOut->IsOpen())
+	{
+		audioSink = waveOut;
+	}
+	else
+	{
+		delete waveOut;
+		audioSink = new NullAudioSink(audioMixer->GetSampleRate(), true);
+	}
+	audioOutput = new AudioOutput(audioMixer, audioSink);
+}
+
+// --------------------------------------------------------
+// A pulsing spot over each platform and a trail of fading
+// lights left behind the ball.  The world scrolls towards
+// the camera rather than the ball moving forward, so the
+// trail scrolls with it.
+// --------------------------------------------------------
+void Game::UpdateSceneLights(float totalTime, float trailMove)
+{
+	const float trailInterval = 0.03f;
+	const XMFLOAT3 platformColors[5] = {
+		XMFLOAT3(1.0f, 0.6f, 0.2f),
+		XMFLOAT3(0.3f, 0.8f, 1.0f),
+		XMFLOAT3(0.4f, 1.0f, 0.3f),
+		XMFLOAT3(0.7f, 0.8f, 1.0f),
+		XMFLOAT3(1.0f, 0.3f, 0.1f) };
+
+	for (int i = 0; i < ballTrailLights; i++)
+		ballTrail[i].z += trailMove;
+
+	ballTrailTimer += timeScale;
+	if (ballTrailTimer >= trailInterval)
+	{
+		ballTrail[ballTrailNext] = sphereEntity->GetPosition();
+		ballTrailNext = (ballTrailNext + 1) % ballTrailLights;
+		ballTrailTimer = 0.0f;
+	}
+
+	sceneLights.clear();
+	for (unsigned int i = 0; i < platformEntity.size(); i++)
+	{
+		XMFLOAT3 position = platformEntity[i]->GetPosition();
+		float pulse = 0.75f + 0.25f * sinf(totalTime * 3.0f + i);
+
+		ClusterLight light = {};
+		light.Position[0] = position.x;
+		light.Position[1] = position.y + 1.5f;
+		light.Position[2] = position.z;
+		light.Range = 3.0f;
+		light.Color[0] = platformColors[i % 5].x * pulse;
+		light.Color[1] = platformColors[i % 5].y * pulse;
+		light.Color[2] = platformColors[i % 5].z * pulse;
+		light.SpotCosine = 0.85f;
+		light.Direction[1] = -1.0f;
+		sceneLights.push_back(light);
+	}
+
+	// Newest first, each one dimmer than the last
+	for (int i = 0; i < ballTrailLights; i++)
+	{
+		const XMFLOAT3& position = ballTrail[(ballTrailNext - 1 - i + ballTrailLights) % ballTrailLights];
+		float fade = 1.0f - i / (float)ballTrailLights;
+
+		ClusterLight light = {};
+		light.Position[0] = position.x;
+		light.Position[1] = position.y;
+		light.Position[2] = position.z;
+		light.Range = 1.5f;
+		light.Color[0] = 0.2f * fade;
+		light.Color[1] = 0.5f * fade;
+		light.Color[2] = 1.0f * fade;
+		light.SpotCosine = -1.0f;
+		sceneLights.push_back(light);
+	}
+}
+
+// --------------------------------------------------------
+// Culls this frame's lights into the cluster grid and
+// binds the lists for the scene's pixel shader
+// --------------------------------------------------------
+void Game::BuildLightClusters()
+{
+	XMFLOAT4X4 view = camera->GetView();
+	XMFLOAT4X4 projection = camera->GetProjection();
+	lightClusters->Build(sceneLights.data(), (int)sceneLights.size(), &view._11, &projection._11);
+	lightClusterMilliseconds += lightClusters->GetStats().Milliseconds;
+
+	lightClusterBuffers->Upload(renderContext, *lightClusters, sceneLights.data(), (int)sceneLights.size());
+	lightClusterBuffers->Bind(renderContext, pixelShader, *lightClusters, (float)renderWidth, (float)renderHeight);
+}
+
+// --------------------------------------------------------
+// Refits the shadow cascades around the camera's current view
+// --------------------------------------------------------
+void Game::UpdateShadowCascades()
+{
+	// The stored view matrix is transposed, so its rows are the
+	// camera's right, up and forward vectors
+	XMFLOAT4X4 view = camera->GetView();
+	XMFLOAT3 position = camera->GetPosition();
+
+	ShadowCameraDesc desc = {};
+	desc.Position[0] = position.x;
+	desc.Position[1] = position.y;
+	desc.Position[2] = position.z;
+	desc.Up[0] = view._21;
+	desc.Up[1] = view._22;
+	desc.Up[2] = view._23;
+	desc.Forward[0] = view._31;
+	desc.Forward[1] = view._32;
+	desc.Forward[2] = view._33;
+	desc.FieldOfView = camera->GetFieldOfView();
+	desc.AspectRatio = camera->GetAspectRatio();
+	desc.NearClip = camera->GetNearClip();
+	desc.FarClip = min(shadowDistance, camera->GetFarClip());
+
+	float lightDirection[3] = { shadowLightDirection.x, shadowLightDirection.y, shadowLightDirection.z };
+	int count = FitShadowCascades(desc, lightDirection, shadowSettings, shadowCascades);
+	BuildShadowCascadeConstants(shadowCascades, count, shadowConstants);
+}
+
 void Game::RenderShadowMap()
 {
-	// Initial setup: No RTV (remember to clear shadow map)
-	context->OMSetRenderTargets(0, 0, shadowDSV);
-	context->ClearDepthStencilView(shadowDSV, D3D11_CLEAR_DEPTH, 1.0f, 0);
-	context->RSSetState(shadowRasterizer);
+	UpdateShadowCascades();
+
+	renderContext->RSSetState(shadowRasterizer);
 
 	// Set up an appropriate shadow view port
 	D3D11_VIEWPORT shadowVP = {};
@@ -620,48 +1323,309 @@ void Game::RenderShadowMap()
 	shadowVP.Height = (float)shadowMapSize;
 	shadowVP.MinDepth = 0.0f;
 	shadowVP.MaxDepth = 1.0f;
-	context->RSSetViewports(1, &shadowVP);
+	renderContext->RSSetViewports(1, &shadowVP);
 
 	// Set up shaders for making the shadow map
-	shadowVS->SetShader();
-	shadowVS->SetMatrix4x4("view", shadowViewMatrix);
-	shadowVS->SetMatrix4x4("projection", shadowProjectionMatrix);
+	renderContext->SetShader(shadowVS);
 
 	// Turn off pixel shader
-	context->PSSetShader(0, 0, 0);
+	renderContext->PSSetShader(0, 0, 0);
 
-	// Actually draw the entities
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
+	// Track which casters moved since last frame
+	shadowCasterCache.BeginFrame();
+	for (unsigned int i = 0; i < shadowCasters.size(); i++)
+	{
+		GameEntity* ge = shadowCasters[i];
+		XMFLOAT3 position = ge->GetPosition();
+		XMFLOAT3 scale = ge->GetScale();
+		float center[3] = { position.x, position.y, position.z };
+		float radius = ge->GetMesh()->GetBoundingRadius() * max(scale.x, max(scale.y, scale.z));
+		shadowCasterCache.UpdateCaster(i, &ge->GetWorldMatrix()->_11, center, radius);
+	}
 
-	//for (unsigned int i = 0; i < entities.size(); i++)
+	for (int c = 0; c < shadowConstants.Count; c++)
 	{
+		ShadowCascade& cascade = shadowCascades[c];
+		shadowCasterCache.PlanCascade(c, cascade, shadowPlan);
+
+		XMFLOAT4X4 cascadeView;
+		XMFLOAT4X4 cascadeProjection;
+		XMStoreFloat4x4(&cascadeView, XMMatrixTranspose(XMMATRIX(cascade.View)));
+		XMStoreFloat4x4(&cascadeProjection, XMMatrixTranspose(XMMATRIX(cascade.Projection)));
+		shadowVS->SetMatrix4x4("view", cascadeView);
+		shadowVS->SetMatrix4x4("projection", cascadeProjection);
+
+		// Static casters only get redrawn when the cache is stale
+		if (shadowPlan.RebuildCache)
+		{
+			renderContext->OMSetRenderTargets(0, 0, shadowCacheDSV[c]);
+			renderContext->ClearDepthStencilView(shadowCacheDSV[c], D3D11_CLEAR_DEPTH, 1.0f, 0);
+			DrawShadowCasters(shadowPlan.StaticCasters);
+		}
+
+		// Start from the static layer (or an empty map), then
+		// put the moving casters on top
+		renderContext->OMSetRenderTargets(0, 0, 0);
+		if (shadowPlan.UseCache)
+			renderContext->CopySubresourceRegion(shadowTexture, c, 0, 0, 0, shadowCacheTexture, c, 0);
+		else
+			renderContext->ClearDepthStencilView(shadowDSV[c], D3D11_CLEAR_DEPTH, 1.0f, 0);
+
+		renderContext->OMSetRenderTargets(0, 0, shadowDSV[c]);
+		DrawShadowCasters(shadowPlan.DynamicCasters);
+	}
+
+	// Unbind the shadow map so the scene can sample it,
+	// and revert to original states
+	renderContext->OMSetRenderTargets(0, 0, 0);
+	shadowVP.Width = (float)this->width;
+	shadowVP.Height = (float)this->height;
+	renderContext->RSSetViewports(1, &shadowVP);
+	renderContext->RSSetState(0);
+}
 
-		// Grab the data from the first entity's mesh
-		GameEntity* ge = sphereEntity;
-		ID3D11Buffer* vb = ge->GetMesh()->GetVertexBuffer();
-		ID3D11Buffer* ib = ge->GetMesh()->GetIndexBuffer();
+// --------------------------------------------------------
+// Draws the given shadow casters into the bound shadow map
+// --------------------------------------------------------
+void Game::DrawShadowCasters(const std::vector<int>& casters)
+{
+	UINT offset = 0;
+
+	for (int i : casters)
+	{
+		// Grab the position stream from the entity's mesh
+		GameEntity* ge = shadowCasters[i];
+		Mesh* mesh = ge->GetMesh();
+		UINT stride = mesh->GetPositionStride();
+		ID3D11Buffer* vb = mesh->GetPositionBuffer();
+		ID3D11Buffer* ib = mesh->GetPositionIndexBuffer();
 
 		// Set buffers in the input assembler
-		context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
-		context->IASetIndexBuffer(ib, DXGI_FORMAT_R32_UINT, 0);
+		renderContext->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
+		renderContext->IASetIndexBuffer(ib, DXGI_FORMAT_R32_UINT, 0);
 
 		shadowVS->SetMatrix4x4("world", *ge->GetWorldMatrix());
-		shadowVS->CopyAllBufferData();
+		renderContext->CopyAllBufferData(shadowVS);
 
 		// Finally do the actual drawing
-		context->DrawIndexed(ge->GetMesh()->GetIndexCount(), 0, 0);
+		const MeshLOD& lod = mesh->GetLOD(DrawWithLOD(ge));
+		depthVertexBytes += lod.PositionCount * stride;
+		depthVertexBytesFull += lod.VertexCount * mesh->GetVertexStride();
 	}
+}
 
-	// Revert to original targets and states
-	//context->OMSetRenderTargets(1, &this->backBufferRTV, this->depthStencilView);
-	context->OMSetRenderTargets(1, &this->ppRTV, this->depthStencilView);
-	shadowVP.Width = (float)this->width;
-	shadowVP.Height = (float)this->height;
-	context->RSSetViewports(1, &shadowVP);
-	context->RSSetState(0);
+// --------------------------------------------------------
+// Draws the simplest level of the entity's mesh that still
+// looks the same at its size on screen.  Buffers and shaders
+// must already be set.  Returns the level it drew.
+// --------------------------------------------------------
+int Game::DrawWithLOD(GameEntity* entity)
+{
+	Mesh* mesh = entity->GetMesh();
+	float projectedSize = TextureStreamer::ProjectedSize(entity, camera, height * renderScale);
+	int level = mesh->SelectLOD(projectedSize);
+	const MeshLOD& lod = mesh->GetLOD(level);
+	renderContext->DrawIndexed(lod.IndexCount, lod.StartIndex, 0);
+	return level;
 }
 
+// --------------------------------------------------------
+// Platforms fade in over the last 8 units before they reach
+// the ball's row
+// --------------------------------------------------------
+float Game::PlatformAlpha(GameEntity* platform)
+{
+	float dist = 8.1f - platform->GetPosition().z;
+	if (dist <= 0)
+		return 0.0f;
+	if (dist > 8.0f)
+		return 1.0f;
+	return dist * 0.125f;
+}
+
+// --------------------------------------------------------
+// Depth of everything opaque, from the position streams and
+// with no pixel shader.  DrawScene then draws the same
+// entities at the same levels with EQUAL, so each pixel is
+// shaded once.  ShadowVS is just the position transform.
+// --------------------------------------------------------
+void Game::DrawDepthPrepass()
+{
+	renderContext->SetShader(shadowVS);
+	renderContext->PSSetShader(0, 0, 0);
+	shadowVS->SetMatrix4x4("view", camera->GetView());
+	shadowVS->SetMatrix4x4("projection", camera->GetProjection());
+
+	std::vector<GameEntity*> opaque;
+	opaque.push_back(sphereEntity);
+	for (GameEntity* platform : platformEntity)
+	{
+		if (PlatformAlpha(platform) >= 1.0f)
+			opaque.push_back(platform);
+	}
+
+	UINT offset = 0;
+	for (GameEntity* entity : opaque)
+	{
+		Mesh* mesh = entity->GetMesh();
+		UINT stride = mesh->GetPositionStride();
+		ID3D11Buffer* vb = mesh->GetPositionBuffer();
+		renderContext->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
+		renderContext->IASetIndexBuffer(mesh->GetPositionIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
+
+		shadowVS->SetMatrix4x4("world", *entity->GetWorldMatrix());
+		renderContext->CopyAllBufferData(shadowVS);
+		const MeshLOD& lod = mesh->GetLOD(DrawWithLOD(entity));
+		depthVertexBytes += lod.PositionCount * stride;
+		depthVertexBytesFull += lod.VertexCount * mesh->GetVertexStride();
+	}
+}
+
+// --------------------------------------------------------
+// Prints how many fragments the scene's pixel shader runs
+// on this frame with the depth pre-pass and without, from
+// the software rasterizer.  The sky and particles have their
+// own shaders and aren't counted.
+// --------------------------------------------------------
+void Game::ReportShadingCost()
+{
+	std::vector<GameEntity*> entities;
+	entities.push_back(sphereEntity);
+	entities.insert(entities.end(), platformEntity.begin(), platformEntity.end());
+
+	std::vector<ShadingCostDraw> draws;
+	for (GameEntity* entity : entities)
+	{
+		Mesh* mesh = entity->GetMesh();
+		float projectedSize = TextureStreamer::ProjectedSize(entity, camera, height * renderScale);
+		const MeshLOD& lod = mesh->GetLOD(mesh->SelectLOD(projectedSize));
+
+		ShadingCostDraw draw = {};
+		draw.Positions = mesh->GetPositions().data();
+		draw.PositionCount = mesh->GetPositionCount();
+		draw.Indices = mesh->GetPositionIndices().data() + lod.StartIndex;
+		draw.IndexCount = lod.IndexCount;
+		memcpy(draw.World, entity->GetWorldMatrix(), sizeof(draw.World));
+		draw.Opaque = entity == sphereEntity || PlatformAlpha(entity) >= 1.0f;
+		draws.push_back(draw);
+	}
+
+	XMFLOAT4X4 view = camera->GetView();
+	XMFLOAT4X4 projection = camera->GetProjection();
+	SoftwareRasterizer rasterizer;
+	ShadingCost cost = EstimateShadingCost(rasterizer,
+		(int)(width * renderScale), (int)(height * renderScale),
+		&view._11, &projection._11, draws);
+
+	printf("Scene pixel shader runs: %lld without the depth pre-pass, %lld with it (%s, %lld depth only)\n",
+		cost.Shaded, cost.ShadedWithPrepass, depthPrepass ? "on" : "off", cost.PrepassPixels);
+}
+
+// --------------------------------------------------------
+// Draws the sky, level and particles into whatever
+// target is currently bound
+// --------------------------------------------------------
+void Game::DrawScene()
+{
+	UINT stride = skyCubeEntity->GetMesh()->GetVertexStride();
+	UINT offset = 0;
+
+	//SkyBox
+	vertexBuffer = skyCubeEntity->GetMesh()->GetVertexBuffer();
+	indexBuffer = skyCubeEntity->GetMesh()->GetIndexBuffer();
+
+	renderContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+	renderContext->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+
+	skyVertexShader->SetMatrix4x4("view", camera->GetView());
+	skyVertexShader->SetMatrix4x4("projection", camera->GetProjection());
+	renderContext->CopyAllBufferData(skyVertexShader);
+	renderContext->SetShader(skyVertexShader);
+
+	renderContext->SetShaderResourceView(skyPixelShader, "Sky1", skySRV1);
+	renderContext->SetShaderResourceView(skyPixelShader, "Sky2", skySRV2);
+	skyPixelShader->SetData("lerpValue", &skyLerpValue, sizeof(skyLerpValue));
+	renderContext->CopyAllBufferData(skyPixelShader);
+	renderContext->SetShader(skyPixelShader);
+
+	renderContext->RSSetState(rasterStateSky);
+	renderContext->OMSetDepthStencilState(depthStateSky, 0);
+	renderContext->DrawIndexed(skyCubeEntity->GetMesh()->GetIndexCount(), 0, 0);
+
+	// Reset the render states we've changed
+	renderContext->RSSetState(0);
+	renderContext->OMSetDepthStencilState(0, 0);
+
+	/***************************************************************************/
+	float blendFactor[4] = {0.0f, 0.0f, 0.0f, 0.0f};  // Set blend factor[inconsequential, since not using]
+	renderContext->OMSetBlendState(blendState, blendFactor, 0xFFFFFFFF); // Setting the blend state
+	renderer.SetFrameConstants(vertexShader, pixelShader, camera, shadowSampler, shadowSRV, shadowConstants);
+	renderer.SetVertexBuffer(sphereEntity, vertexBuffer);
+	renderer.SetIndexBuffer(sphereEntity, indexBuffer);
+	renderer.SetVertexShader(vertexShader, sphereEntity);
+	renderer.SetPixelShader(pixelShader, sphereEntity);
+
+	stride = sphereEntity->GetMesh()->GetVertexStride();
+	renderContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+	renderContext->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	renderContext->OMSetDepthStencilState(depthPrepass ? depthStateEqual : 0, 0);
+	DrawWithLOD(sphereEntity);
+
+	/*********************************************************************************************/
+	// Faded in platforms first, sorted by material so each table
+	// and sampler is bound once.  Fading ones blend over what's
+	// behind them, so they keep their order and go last.
+	platformDrawOrder.clear();
+	for (GameEntity* platform : platformEntity) {
+		if (PlatformAlpha(platform) >= 1.0f)
+			platformDrawOrder.push_back(platform);
+	}
+	std::stable_sort(platformDrawOrder.begin(), platformDrawOrder.end(), [](GameEntity* a, GameEntity* b) {
+		return a->GetMaterial()->GetState()->SortKey < b->GetMaterial()->GetState()->SortKey;
+	});
+	for (GameEntity* platform : platformEntity) {
+		if (PlatformAlpha(platform) < 1.0f)
+			platformDrawOrder.push_back(platform);
+	}
+
+	for (GameEntity* platform : platformDrawOrder) {
+
+		renderContext->OMSetBlendState(fadeBlendState, 0, 0xffffffff);  // Alpha blending
+
+		// Fully faded in platforms were in the pre-pass
+		float alpha = PlatformAlpha(platform);
+		pixelShader->SetFloat("alphaV", alpha);
+		renderContext->OMSetDepthStencilState(depthPrepass && alpha >= 1.0f ? depthStateEqual : 0, 0);
+
+		renderer.SetVertexBuffer(platform, vertexBuffer);
+		renderer.SetIndexBuffer(platform, indexBuffer);
+		renderer.SetVertexShader(vertexShader, platform);
+		renderer.SetPixelShader(pixelShader, platform);
+
+		stride = platform->GetMesh()->GetVertexStride();
+		renderContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+		renderContext->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+		DrawWithLOD(platform);
+
+		renderContext->OMSetBlendState(0, 0, 0xffffffff);
+	}
+	renderContext->OMSetDepthStencilState(0, 0);
+
+	renderContext->SetShaderResourceView(pixelShader, "ShadowMap", 0);
+	/******************************************************/
+	
+	// Particle states
+	float blend[4] = {1,1,1,1};
+	renderContext->OMSetBlendState(particleBlendState, blend, 0xffffffff);  // Additive blending
+	renderContext->OMSetDepthStencilState(particleDepthState, 0);			// No depth WRITING
+
+																	// Draw the emitter
+	emitter->Draw(renderContext, camera);
+
+	// Reset to default states for next frame
+	renderContext->OMSetBlendState(0, blend, 0xffffffff);
+	renderContext->OMSetDepthStencilState(0, 0);
+}
 
 // --------------------------------------------------------
 // Handle resizing DirectX "stuff" to match the new window size.
@@ -676,6 +1640,11 @@ void Game::OnResize()
 	// camera exists
 	if (camera)
 		camera->UpdateProjectionMatrix((float) width / height);
+
+	// The frame graph's targets follow the window size.  The pool
+	// keeps the old ones around in case we come back to that size.
+	if (renderTargetPool && width > 0 && height > 0)
+		BuildFrameGraph();
 }
 
 
@@ -684,6 +1653,13 @@ void Game::OnResize()
 // --------------------------------------------------------
 void Game::Update(float deltaTime, float totalTime)
 {
+	// Trade resolution for frame time while the level is being drawn
+	if (gameState == GamePlay && resolutionController.Update(deltaTime))
+	{
+		renderScale = resolutionController.GetScale();
+		BuildFrameGraph();
+	}
+
 	if (mouseAtPlay)
 	{
 
@@ -728,84 +1704,107 @@ void Game::Update(float deltaTime, float totalTime)
 		}
 		
 
-		gameState = GamePlay;
+		// Once it's over it stays over, or the check below would
+		// see the ball still falling and end it again every frame
+		if (gameState != GameOver)
+			gameState = GamePlay;
 		float sinTime = (sin(totalTime * 2) + 2.0f) / 10.0f;
-		float xposition = rand() % 3;
 
-		//Reset platforms
-		if (platformEntity[0]->GetPosition().z < -2)
-		{
-			platformEntity[0]->SetPosition(xposition, -2, 8);
-		}
-		if (platformEntity[1]->GetPosition().z < -2)
-		{
-			platformEntity[1]->SetPosition(xposition, -2, 8);
-		}
-		if (platformEntity[2]->GetPosition().z < -2)
+		//Recycle platforms once they're behind the camera, oldest
+		//first, onto the far end of the track
+		while (platformEntity[platformPool->GetOldest()]->GetPosition().z < -2)
 		{
-			platformEntity[2]->SetPosition(xposition, -2, 8);
+			float farZ = platformEntity[platformPool->GetNewest()]->GetPosition().z + trackRules.Spacing;
+			TrackPiece piece = trackGenerator->TakePiece();
+			int slot = platformPool->Recycle(piece);
+			platformEntity[slot]->SetPosition(piece.X, piece.Y, farZ);
 		}
-		if (platformEntity[3]->GetPosition().z < -2)
-		{
-			platformEntity[3]->SetPosition(xposition, -2, 8);
-		}
-		if (platformEntity[4]->GetPosition().z < -2)
+
+		//Move platforms, sweeping their colliders along (setting
+		//the position first picks up the resets above)
+		float platformMove[3] = { 0.0f, 0.0f, -timeScale * 2.01f };
+		for (unsigned int i = 0; i < platformEntity.size(); i++)
 		{
-			platformEntity[4]->SetPosition(xposition, -2, 8);
+			XMFLOAT3 position = platformEntity[i]->GetPosition();
+			float center[3] = { position.x, position.y, position.z };
+			collisionWorld.SetBoxPosition(i, center);
+			collisionWorld.MoveBox(i, platformMove);
+			platformEntity[i]->Move(platformMove[0], platformMove[1], platformMove[2]);
 		}
 
-		//Move platforms
-		platformEntity[0]->Move(0, 0, -timeScale * 2.01);
-		platformEntity[1]->Move(0, 0, -timeScale * 2.01);
-		platformEntity[2]->Move(0, 0, -timeScale * 2.01);
-		platformEntity[3]->Move(0, 0, -timeScale * 2.01);
-		platformEntity[4]->Move(0, 0, -timeScale * 2.01);
-
 		//Move Player
+		float ballMove[3] = { 0.0f, 0.0f, 0.0f };
 		if (GetAsyncKeyState('A') & 0x8000)
 		{
-			sphereEntity->Move(-timeScale*2, 0, 0);
+			ballMove[0] -= timeScale * 2;
 		}
 		if (GetAsyncKeyState('D') & 0x8000)
 		{
-			sphereEntity->Move(timeScale*2, 0, 0);
+			ballMove[0] += timeScale * 2;
 		}
 
-		if (sphereEntity->GetPosition().y < -1.6f)
+		speed = speed - (gravity * timeScale);
+		ballMove[1] = speed * timeScale;
+
+		// The ball stops wherever it first hits a platform, however
+		// far it would have gone this frame, and rides along with it
+		XMFLOAT3 ballPosition = sphereEntity->GetPosition();
+		float ballCenter[3] = { ballPosition.x, ballPosition.y, ballPosition.z };
+		collisionWorld.SetSpherePosition(ballCollider, ballCenter);
+		collisionWorld.MoveSphere(ballCollider, ballMove);
+		collisionWorld.Step();
+		collisionWorld.GetSpherePosition(ballCollider, ballCenter);
+		sphereEntity->SetPosition(ballCenter[0], ballCenter[1], ballCenter[2]);
+		UpdateSceneLights(totalTime, platformMove[2]);
+
+		// Bounce off the top of a platform
+		for (const CollisionContact& contact : collisionWorld.GetContacts())
 		{
-
-			if ((sphereEntity->GetPosition().x - .35f) < (platformEntity[platformCount % 5]->GetPosition().x + 0.5f) && (sphereEntity->GetPosition().x + .35f) >(platformEntity[platformCount % 5]->GetPosition().x - 0.5f))
+			if (contact.Sphere == ballCollider && contact.Normal[1] > 0.5f && speed < 0)
 			{
-				
 				speed = constSpeed;
 				score++;
 				printf("%d", score);
+
+				// Panned towards the ball's lane, lanes being at 0 to 2
+				landingSound->Play(0.8f, 0.0f, (ballCenter[0] - 1.0f) * 0.5f);
+				if (score % 10 == 0)
+					scoreSound->Play();
 				emitter->SetEmitterPosition(sphereEntity->GetPosition());
 				emitter->SpawnParticle();
 				platformCount++;
-				
 			}
-			else
+		}
+
+		// Below the platform tops means it missed them all
+		if (sphereEntity->GetPosition().y < -1.85f)
+		{
+			if (gameState != GameOver)
 			{
 				gameState = GameOver;
+				gameOverSound->Play();
 			}
 		}
 
-		speed = speed - (gravity * timeScale);
-
-		sphereEntity->Move(0, speed*timeScale, 0);
-
 		emitter->Update(deltaTime);
 		// Update the camera
 		camera->Update(deltaTime);
 
-		platformEntity[0]->UpdateWorldMatrix();
-		platformEntity[1]->UpdateWorldMatrix();
-		platformEntity[2]->UpdateWorldMatrix();
-		platformEntity[3]->UpdateWorldMatrix();
-		platformEntity[4]->UpdateWorldMatrix();
+		for (unsigned int i = 0; i < platformEntity.size(); i++)
+			platformEntity[i]->UpdateWorldMatrix();
 		sphereEntity->UpdateWorldMatrix();
 
+		// Stream material mips for what is on screen
+		textureStreamer->BeginFrame();
+		textureStreamer->RequestMaterial(sphereEntity->GetMaterial(), TextureStreamer::ProjectedSize(sphereEntity, camera, (float)height));
+		for (unsigned int i = 0; i < platformEntity.size(); i++)
+			textureStreamer->RequestMaterial(platformEntity[i]->GetMaterial(), TextureStreamer::ProjectedSize(platformEntity[i], camera, (float)height));
+		// Only the replaced textures' layers are copied again
+		std::vector<Material*> streamed;
+		textureStreamer->Update(&streamed);
+		for (Material* material : streamed)
+			materialTable->Refresh(material);
+
 		// Changing alpha value for skybox lerp
 		counterLerp++;                     // Using counter for tracking change
 		if (counterLerp % 100 == 0) {
@@ -840,6 +1839,102 @@ void Game::Update(float deltaTime, float totalTime)
 	
 }
 
+// --------------------------------------------------------
+// Starts a capture on F9 and, once enough frames are in,
+// writes it out and prints what's in it
+// --------------------------------------------------------
+void Game::UpdateCapture()
+{
+	const int captureFrames = 60;
+
+	bool captureKey = (GetAsyncKeyState(VK_F9) & 0x8000) != 0;
+	if (captureKey && !prevCaptureKey && captureFramesLeft == 0)
+	{
+		commandRecorder->Clear();
+		renderContext->SetRecorder(commandRecorder);
+		uiRenderer->ResetStats();
+		depthVertexBytes = 0;
+		depthVertexBytesFull = 0;
+		lightClusterMilliseconds = 0;
+		lightClusterBuffers->ResetStats();
+		renderer.ResetStats();
+		constantUploadHeap->ResetStats();
+		materialTable->ResetStats();
+		captureFramesLeft = captureFrames;
+		prevCaptureKey = captureKey;
+		return;
+	}
+	prevCaptureKey = captureKey;
+
+	if (captureFramesLeft == 0 || --captureFramesLeft > 0)
+		return;
+
+	// Last frame recorded was the previous one
+	renderContext->SetRecorder(0);
+	bool saved = commandRecorder->SaveToFile("Capture.bin");
+
+#if defined(DEBUG) || defined(_DEBUG)
+	const std::vector<uint8_t>& data = commandRecorder->GetData();
+	CommandStreamReport report = AnalyzeCommandStream(data.data(), data.size());
+	printf("\nCapture %s (%d bytes)\n%s",
+		saved ? "saved to Capture.bin" : "could not be saved",
+		(int)data.size(),
+		FormatCommandStreamReport(report).c_str());
+
+	UIRenderStats ui = uiRenderer->GetStats();
+	printf("UI per frame: %.3f ms, %.1f batches, %.1f elements rebuilt, %.1f bytes uploaded\n",
+		ui.CpuMilliseconds / captureFrames,
+		ui.Batches / (float)captureFrames,
+		ui.ElementsTessellated / (float)captureFrames,
+		ui.BytesUploaded / (float)captureFrames);
+
+	// Vertices each depth only pass reads at least once
+	printf("Depth only vertices per frame: %.0f bytes (%.0f from the full vertices, %.1f%% less)\n",
+		depthVertexBytes / (double)captureFrames,
+		depthVertexBytesFull / (double)captureFrames,
+		depthVertexBytesFull > 0 ? 100.0 * (1.0 - depthVertexBytes / (double)depthVertexBytesFull) : 0.0);
+
+	const LightClusterStats& clusters = lightClusters->GetStats();
+	printf("Light clusters per frame: %.3f ms, %.0f bytes uploaded (last frame %d lights, %d visible, %d indices, at most %d in a cluster)\n",
+		lightClusterMilliseconds / captureFrames,
+		lightClusterBuffers->GetBytesUploaded() / (double)captureFrames,
+		clusters.Lights, clusters.LightsVisible, clusters.Indices, clusters.MaxPerCluster);
+
+	// Lit pass constants, and what the ring made of the per
+	// object ones
+	ConstantUploadStats constants = renderer.GetStats();
+	const ConstantRingStats& ring = constantUploadHeap->GetRingStats();
+	printf("Lit pass constants per frame: %.0f bytes per frame, %.0f per material (%.1f changes), %.0f per object (%.1f objects)\n",
+		constants.FrameBytes / (double)captureFrames,
+		constants.MaterialBytes / (double)captureFrames,
+		constants.MaterialChanges / (double)captureFrames,
+		constants.ObjectBytes / (double)captureFrames,
+		constants.Objects / (double)captureFrames);
+	printf("Constant ring: %s, %.0f bytes per frame, %lld skipped, %d wraps, %d stalls, %lld bytes outside it\n",
+		constantUploadHeap->IsRingEnabled() ? "on" : "off (needs D3D 11.1)",
+		ring.BytesAllocated / (double)captureFrames,
+		ring.BytesSkipped, ring.Wraps, constantUploadHeap->GetStalls(), constantUploadHeap->GetFallbackBytes());
+
+	const BindingStats& bindings = materialTable->GetBindingStats();
+	printf("Material binds per frame: %.1f asked for, %.1f issued (%d texture tables, %lld bytes)\n",
+		bindings.Requested / (double)captureFrames,
+		bindings.Issued / (double)captureFrames,
+		materialTable->GetTableCount(), materialTable->GetTableBytes());
+
+	// Since startup, not just the capture - the audio thread
+	// runs on its own clock
+	AudioMixerStats audio = audioMixer->GetStats();
+	double mixMilliseconds = audioOutput->GetMixMilliseconds();
+	printf("Audio: %lld blocks, %lld voices mixed through one (%.0f per ms of mixing), peak %d voices, %d stolen, %d commands dropped\n",
+		audio.Blocks, audio.VoiceBlocks,
+		mixMilliseconds > 0 ? audio.VoiceBlocks / mixMilliseconds : 0.0,
+		audio.PeakVoices, audio.Stolen, audio.Dropped);
+
+	if (gameState == GamePlay)
+		ReportShadingCost();
+#endif
+}
+
 // --------------------------------------------------------
 // Clear the screen, redraw everything, present to the user
 // --------------------------------------------------------
@@ -847,220 +1942,57 @@ void Game::Draw(float deltaTime, float totalTime)
 {
 	
 
+	UpdateCapture();
+	renderContext->BeginFrame();
+	constantUploadHeap->BeginFrame();
+
 	// Background color (Cornflower Blue in this case) for clearing
 	const float color[4] = {1.0f, 1.0f, 0.0f, 0.0f};
 
 	// Clear the render target and depth buffer (erases what's on the screen)
 	//  - Do this ONCE PER FRAME
 	//  - At the beginning of Draw (before drawing *anything*)
-	context->ClearRenderTargetView(backBufferRTV, color);
-	context->ClearDepthStencilView(
-		depthStencilView, 
-		D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL,
-		1.0f,
-		0);
-	
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
+	//  - During gameplay the frame graph's composite covers the whole
+	//    back buffer and the scene uses its own depth buffer
+	if (gameState != GamePlay)
+	{
+		renderContext->ClearRenderTargetView(backBufferRTV, color);
+		renderContext->ClearDepthStencilView(
+			depthStencilView,
+			D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL,
+			1.0f,
+			0);
+	}
+
+	// Let go of render targets we haven't needed in a while
+	renderTargetPool->BeginFrame();
 
 	switch (gameState)
 	{
 	case MainMenu:
-		spriteBatch->Begin();
-		spriteBatch->Draw(backgroundSprite, XMFLOAT2(0, 0));
-		spriteBatch->Draw(playButtonSprite, playSpritePosition);
-		spriteBatch->Draw(quitButtonSprite, quitSpritePosition);
-
-		spriteBatch->End();
+		uiRenderer->Draw(renderContext, menuUI, (float)width, (float)height);
 		break;
 	
 	case GamePlay:
-	{
-		// Post process initial setup =================
-		// Start rendering somewhere else!
-		context->ClearRenderTargetView(ppRTV, color);
-		context->OMSetRenderTargets(1, &ppRTV, depthStencilView);
-
-		//SkyBox
-		vertexBuffer = skyCubeEntity->GetMesh()->GetVertexBuffer();
-		indexBuffer = skyCubeEntity->GetMesh()->GetIndexBuffer();
-
-		context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-		context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
-
-		skyVertexShader->SetMatrix4x4("view", camera->GetView());
-		skyVertexShader->SetMatrix4x4("projection", camera->GetProjection());
-		skyVertexShader->CopyAllBufferData();
-		skyVertexShader->SetShader();
-
-		skyPixelShader->SetShaderResourceView("Sky1", skySRV1);
-		skyPixelShader->SetShaderResourceView("Sky2", skySRV2);
-		skyPixelShader->SetData("lerpValue", &skyLerpValue, sizeof(skyLerpValue));
-		skyPixelShader->CopyAllBufferData();
-		skyPixelShader->SetShader();
-
-		context->RSSetState(rasterStateSky);
-		context->OMSetDepthStencilState(depthStateSky, 0);
-		context->DrawIndexed(skyCubeEntity->GetMesh()->GetIndexCount(), 0, 0);
-
-		// Reset the render states we've changed
-		context->RSSetState(0);
-		context->OMSetDepthStencilState(0, 0);
-
-		/***************************************************************************/
-		float blendFactor[4] = {0.0f, 0.0f, 0.0f, 0.0f};  // Set blend factor[inconsequential, since not using]
-		context->OMSetBlendState(blendState, blendFactor, 0xFFFFFFFF); // Setting the blend state
-		RenderShadowMap();
-		renderer.SetVertexBuffer(sphereEntity, vertexBuffer);
-		renderer.SetIndexBuffer(sphereEntity, indexBuffer);
-		renderer.SetVertexShader(vertexShader, sphereEntity, camera, shadowViewMatrix, shadowProjectionMatrix);
-		renderer.SetPixelShader(pixelShader, sphereEntity, camera, shadowSampler, shadowSRV);
-
-		context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-		context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
-		context->DrawIndexed(sphereEntity->GetMesh()->GetIndexCount(), 0, 0);
-
-		/*********************************************************************************************/
-		float dist;
-		float maxDist;
-
-		for (int i = 0; i <= 4; i++) {
-
-			context->OMSetBlendState(fadeBlendState, 0, 0xffffffff);  // Alpha blending
-
-			dist = 8.1f - platformEntity[i]->GetPosition().z;
-			maxDist = dist * 0.125;
-
-			if (dist <= 0) {
-				pixelShader->SetFloat("alphaV", 0.0f);
-			} else if (dist > 8.0f) {
-				pixelShader->SetFloat("alphaV", 1.0f);
-			} else {
-				pixelShader->SetFloat("alphaV", maxDist);
-			}
-
-			renderer.SetVertexBuffer(platformEntity[i], vertexBuffer);
-			renderer.SetIndexBuffer(platformEntity[i], indexBuffer);
-			renderer.SetVertexShader(vertexShader, platformEntity[i], camera, shadowViewMatrix, shadowProjectionMatrix);
-			renderer.SetPixelShader(pixelShader, platformEntity[i], camera, shadowSampler, shadowSRV);
-
-			context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-			context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
-			context->DrawIndexed(platformEntity[i]->GetMesh()->GetIndexCount(), 0, 0);
-
-			context->OMSetBlendState(0, 0, 0xffffffff);
-		}
-
-		pixelShader->SetShaderResourceView("ShadowMap", 0);
-		/***************************************************/
-		//Score UI
-
-		//Converting int to wchar_t to render it
-		std::string scoreString = std::to_string(score).c_str();
-		std::wstring ss(scoreString.begin(), scoreString.end());
-		const wchar_t* scoreS = ss.c_str();
-		//---------------------------------------
-		
-		spriteBatch->Begin();
-		spriteBatch->Draw(scoreUISprite, XMFLOAT2(width / 2 - 600, height / 2 - 350));
-		spriteFont->DrawString(spriteBatch.get(), scoreS, XMFLOAT2(width/2-300,height/2-310));
-		spriteBatch->End();
-
-
-		/******************************************************/
-		
-		// Particle states
-		float blend[4] = {1,1,1,1};
-		context->OMSetBlendState(particleBlendState, blend, 0xffffffff);  // Additive blending
-		context->OMSetDepthStencilState(particleDepthState, 0);			// No depth WRITING
-
-																		// Draw the emitter
-		emitter->Draw(context, camera);
-
-		// Reset to default states for next frame
-		context->OMSetBlendState(0, blend, 0xffffffff);
-		context->OMSetDepthStencilState(0, 0);
-
-		// Actually do post processing ========================
-		//Bright Pass
-		context->ClearRenderTargetView(bpRTV, color);
-		context->OMSetRenderTargets(1, &bpRTV, 0);
-
-		ppVS->SetShader();
-
-		brightPassPS->SetShaderResourceView("BrightPassTex", ppSRV);
-		brightPassPS->SetSamplerState("Sampler", sampler1);
-		brightPassPS->CopyAllBufferData();
-		brightPassPS->SetShader();
-		ID3D11Buffer* nothing = 0;
-		context->IASetVertexBuffers(0, 1, &nothing, &stride, &offset);
-		context->IASetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
-		context->Draw(3, 0);
-		brightPassPS->SetShaderResourceView("BrightPassTex", 0);
-
-		//Horizontal Blur Pass
-		context->ClearRenderTargetView(horBlurRTV, color);
-		context->OMSetRenderTargets(1, &horBlurRTV, 0);
-
-		ppVS->SetShader();
-
-		horzBlurPS->SetInt("blurAmount", 3);
-		horzBlurPS->SetFloat("pixelWidth", 1.0f / (width / 2));
-		horzBlurPS->SetShaderResourceView("HorzBlurTex", bpSRV);
-		horzBlurPS->SetSamplerState("Sampler", sampler1);
-		horzBlurPS->CopyAllBufferData();
-		horzBlurPS->SetShader();
-		ID3D11Buffer* nothing1 = 0;
-		context->IASetVertexBuffers(0, 1, &nothing1, &stride, &offset);
-		context->IASetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
-		context->Draw(3, 0);
-		horzBlurPS->SetShaderResourceView("HorzBlurTex", 0);
-
-		//Vertical Blur Pass
-		context->ClearRenderTargetView(verBlurRTV, color);
-		context->OMSetRenderTargets(1, &verBlurRTV, 0);
-
-		ppVS->SetShader();
-
-		vertBlurPS->SetInt("blurAmount", 3);
-		vertBlurPS->SetFloat("pixelHeight", 1.0f / (height / 2));
-		vertBlurPS->SetShaderResourceView("VertBlurTex", horBlurSRV);
-		vertBlurPS->SetSamplerState("Sampler", sampler1);
-		vertBlurPS->CopyAllBufferData();
-		vertBlurPS->SetShader();
-		ID3D11Buffer* nothing2 = 0;
-		context->IASetVertexBuffers(0, 1, &nothing2, &stride, &offset);
-		context->IASetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
-		context->Draw(3, 0);
-		vertBlurPS->SetShaderResourceView("VertBlurTex", 0);
-
-		// Get the shaders ready for post processing
-		// Back to the back buffer
-		context->OMSetRenderTargets(1, &backBufferRTV, 0);
-
-		ppVS->SetShader();
-
-		bloomPS->SetShaderResourceView("AllPassTex", verBlurSRV);
-		bloomPS->SetShaderResourceView("OgTex", ppSRV2);
-		bloomPS->SetSamplerState("Sampler", sampler1);
-		bloomPS->CopyAllBufferData();
-		bloomPS->SetShader();
-
-		ID3D11Buffer* nothing3 = 0;
-		context->IASetVertexBuffers(0, 1, &nothing3, &stride, &offset);
-		context->IASetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
-
-		// Actually draw exactly 3 vertices
-		context->Draw(3, 0);
-
-		bloomPS->SetShaderResourceView("AllPassTex", 0);
-		bloomPS->SetShaderResourceView("OgTex", 0);
-	}
+		// Everything from the shadow map to the final composite
+		// is a pass of the frame graph
+		if (!frameGraphReady)
+			break;
+		frameGraph.Execute([this](FrameGraphResource resource, const float* clearColor) {
+			RenderTarget& target = GetTarget(resource);
+			if (target.DSV)
+				renderContext->ClearDepthStencilView(target.DSV, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, clearColor[0], 0);
+			else
+				renderContext->ClearRenderTargetView(target.RTV, clearColor);
+		}, [this](int pass, bool begin) {
+			if (begin)
+				renderContext->BeginPass(frameGraph.GetPassName(pass));
+			else
+				renderContext->EndPass();
+		});
 		break;
 	case GameOver:
-		spriteBatch->Begin();
-		spriteBatch->Draw(gameOverSprite, XMFLOAT2(0,0));
-		spriteBatch->End();
+		uiRenderer->Draw(renderContext, gameOverUI, (float)width, (float)height);
 		break;
 	case Exit:
 		Quit();
@@ -1073,6 +2005,8 @@ void Game::Draw(float deltaTime, float totalTime)
 
 	
 /*************************************************************************/
+	constantUploadHeap->EndFrame();
+	renderContext->EndFrame();
 	swapChain->Present(0, 0);
 	
 }
@@ -1093,22 +2027,14 @@ void Game::OnMouseDown(WPARAM buttonState, int x, int y)
 	prevMousePos.x = x;
 	prevMousePos.y = y;
 
-	//Check if the play button is clicked
-	if (((x > playSpritePosition.x) && (x < playSpritePosition.x+300)) && ((y > playSpritePosition.y) && (y < playSpritePosition.y + 120)))
+	//Check if either button is clicked
+	if (gameState == MainMenu && (buttonState & 0x0001))
 	{
-		if (buttonState & 0x0001)
-		{
+		int hit = menuUI->HitTest((float)x, (float)y);
+		if (hit == playButtonElement)
 			mouseAtPlay = true;
-		}
-	}
-
-	//Check if the quit button is clicked
-	if (((x > quitSpritePosition.x) && (x < quitSpritePosition.x + 250)) && ((y > quitSpritePosition.y) && (y < quitSpritePosition.y + 120)))
-	{
-		if (buttonState & 0x0001)
-		{
+		if (hit == quitButtonElement)
 			mouseAtQuit = true;
-		}
 	}
 
 	// Caputure the mouse so we keep getting mouse move
@@ -9,9 +9,28 @@
 #include "Lights.h"
 #include <vector>
 #include <DirectXMath.h>
-#include "SpriteBatch.h"
 #include "SpriteFont.h"
+#include "SpriteText.h"
+#include "UIRenderer.h"
 #include "Emitter.h"
+#include "TextureStreamer.h"
+#include "BloomKernel.h"
+#include "FrameGraph.h"
+#include "RenderTargetPool.h"
+#include "ResolutionController.h"
+#include "ShadowCascades.h"
+#include "ShadowCasterCache.h"
+#include "Collision.h"
+#include "TrackGenerator.h"
+#include "RenderContext.h"
+#include "CommandStream.h"
+#include "ShadingCostModel.h"
+#include "LightClusters.h"
+#include "LightClusterBuffers.h"
+#include "ConstantUploadHeap.h"
+#include "MaterialTable.h"
+#include "AudioMixer.h"
+#include "AudioSink.h"
 
 class Game 
 	: public DXCore
@@ -37,18 +56,59 @@ private:
 
 	// Initialization helper methods - feel free to customize, combine, etc.
 	void LoadShaders();
+	SimpleVertexShader* LoadPackedVertexShader(const wchar_t* file);
 	void CreateMaterials();
 	void CreateParticles();
 	void CreateMatrices();
 	void CreateBasicGeometry();
 	void CreatePostProcessResources();
 	void CreateShadow();
+	void CreateLightClusters();
+	void CreateSounds();
+	void CreateUI();
 
+	void BuildFrameGraph();
+	void UpdateShadowCascades();
 	void RenderShadowMap();
+	void DrawShadowCasters(const std::vector<int>& casters);
+	void DrawDepthPrepass();
+	void DrawScene();
+	int DrawWithLOD(GameEntity* entity);
+	float PlatformAlpha(GameEntity* platform);
+	void ReportShadingCost();
+	void UpdateSceneLights(float totalTime, float trailMove);
+	void BuildLightClusters();
+
+	// Frame graph helpers
+	RenderTarget& GetTarget(FrameGraphResource resource);
+	void BindTarget(FrameGraphResource resource, ID3D11DepthStencilView* depth = 0);
+	void DrawFullscreenTriangle();
+
+	// Everything Draw does on the GPU goes through this.  F9
+	// records the next few frames into Capture.bin.
+	RenderContext* renderContext;
+	CommandRecorder* commandRecorder;
+	ConstantUploadHeap* constantUploadHeap;	// Per object constants for the lit pass
+	int captureFramesLeft = 0;
+	bool prevCaptureKey = false;
+	long long depthVertexBytes = 0;		// Read by depth only passes since the capture started
+	long long depthVertexBytesFull = 0;	// What they'd read from the full vertices
+	double lightClusterMilliseconds = 0;	// Building the grid since the capture started
+	void UpdateCapture();
 
 	// Buffers to hold actual geometry data
 	ID3D11Buffer* vertexBuffer;
 	ID3D11Buffer* indexBuffer;
+
+	// Meshes hold PackedVertex instead of Vertex, and the
+	// vertex shaders that draw them read it
+	bool packedVertices;
+
+	// Opaque geometry lays down depth first from the position
+	// streams, then shades with EQUAL and no depth writes, so
+	// PixelShader runs once per pixel however much overlaps
+	bool depthPrepass;
+	ID3D11DepthStencilState* depthStateEqual;
 	
 
 	// Wrappers for DirectX shaders to provide simplified functionality
@@ -69,23 +129,43 @@ private:
 	
 	ID3D11SamplerState* sampler1;
 
-	// Post process requirements
-	ID3D11RenderTargetView* ppRTV;		// Allows us to render to a texture
-	ID3D11RenderTargetView* bpRTV;
-	ID3D11RenderTargetView* horBlurRTV;
-	ID3D11RenderTargetView* verBlurRTV;
+	// Post process requirements - the scene and bloom chain are
+	// transient textures of the frame graph, which decides which
+	// ones share a physical target.  The physical targets come from
+	// the pool, so rebuilding the graph after a resize reuses them.
+	FrameGraph frameGraph;
+	RenderTargetPool* renderTargetPool;
+	std::vector<RenderTarget*> frameGraphTargets;	// One per physical texture
+	bool frameGraphReady = false;					// Every physical target was created
+	FrameGraphResource sceneColor;
+	FrameGraphResource sceneDepth;
+
+	// Fraction of the window size the scene is rendered at,
+	// picked from recent frame times
+	ResolutionController resolutionController;
+	float renderScale = 1.0f;
+	unsigned int renderWidth;
+	unsigned int renderHeight;
 
-	ID3D11ShaderResourceView* ppSRV;	// Allows us to sample from the same texture
-	ID3D11ShaderResourceView* ppSRV2;
-	ID3D11ShaderResourceView* bpSRV;
-	ID3D11ShaderResourceView* horBlurSRV;
-	ID3D11ShaderResourceView* verBlurSRV;
+	// Bloom chain - level 0 is half the screen size and every
+	// level after that is half of the one before.  Each level is
+	// blurred through a temp texture of the same size.
+	static const int maxBloomLevels = 5;
+	int bloomLevels;
+	FrameGraphResource bloomLevel[maxBloomLevels];
+	FrameGraphResource bloomTemp[maxBloomLevels];
+	BloomTap bloomTaps[BloomMaxTaps];
+	int bloomTapCount;
+	ID3D11SamplerState* bloomSampler;		// Clamped so the blur doesn't wrap around the screen
+	ID3D11BlendState* bloomAddBlendState;	// Upsampled levels are added on top
 
 	SimpleVertexShader* ppVS;
 	SimplePixelShader* ppPS;
 	SimplePixelShader* brightPassPS;
-	SimplePixelShader* horzBlurPS;
-	SimplePixelShader* vertBlurPS;
+	SimplePixelShader* downsamplePS;
+	SimplePixelShader* blurPS;
+	SimplePixelShader* upsamplePS;
+	SimplePixelShader* upscalePS;
 	SimplePixelShader* bloomPS;
 
 	//Fade in
@@ -114,13 +194,42 @@ private:
 
 	// Shadow stuff
 	int shadowMapSize;
-	ID3D11DepthStencilView* shadowDSV;
+	ShadowCascadeSettings shadowSettings;
+	float shadowDistance;
+	DirectX::XMFLOAT3 shadowLightDirection;
+	ShadowCascade shadowCascades[MaxShadowCascades];
+	ShadowCascadeConstants shadowConstants;
+	ID3D11Texture2D* shadowTexture;
+	ID3D11DepthStencilView* shadowDSV[MaxShadowCascades];	// One per array slice
+	ID3D11Texture2D* shadowCacheTexture;						// Static casters only
+	ID3D11DepthStencilView* shadowCacheDSV[MaxShadowCascades];
+	std::vector<GameEntity*> shadowCasters;
+	ShadowCasterCache shadowCasterCache;
+	ShadowCascadePlan shadowPlan;
 	ID3D11ShaderResourceView* shadowSRV;
 	ID3D11SamplerState* shadowSampler;
 	ID3D11RasterizerState* shadowRasterizer;
 	SimpleVertexShader* shadowVS;
-	DirectX::XMFLOAT4X4 shadowViewMatrix;
-	DirectX::XMFLOAT4X4 shadowProjectionMatrix;
+
+	// Point and spot lights - a spot over each platform and a
+	// trail behind the ball - culled into clusters each frame
+	// so the pixel shader only loops over the ones nearby
+	std::vector<ClusterLight> sceneLights;
+	LightClusterGrid* lightClusters;
+	LightClusterBuffers* lightClusterBuffers;
+	static const int ballTrailLights = 24;
+	DirectX::XMFLOAT3 ballTrail[ballTrailLights];	// Oldest gets replaced
+	int ballTrailNext = 0;
+
+	// Sound effects, mixed on the audio thread.  The sounds
+	// are made up at startup - there are no audio files.
+	AudioMixer* audioMixer;
+	AudioSink* audioSink;
+	AudioOutput* audioOutput;
+	SoundEffect* landingSound;
+	SoundEffect* scoreSound;
+	SoundEffect* gameOverSound;
+	float ballTrailTimer = 0.0f;
 
 	// Particle stuff
 	ID3D11ShaderResourceView* particleTexture;
@@ -144,8 +253,15 @@ private:
 	//std::vector<Mesh*> platformMesh;   // Mesh vector for platforms
 	Mesh* sphereMesh;                  // Mesh for ball
 	Mesh* platformMesh;				   // Mesh for platform
-	std::vector<GameEntity*> platformEntity;  // Entity vector for platforms
+	std::vector<GameEntity*> platformEntity;  // Entity vector for platforms, one per pool slot
+	TrackRules trackRules;
+	TrackGenerator* trackGenerator;
+	PlatformPool* platformPool;
 	GameEntity* sphereEntity;                 // Entity for ball
+
+	// One box per platform (same index) and the ball
+	CollisionWorld collisionWorld;
+	int ballCollider;
 	
 	Renderer renderer;
 
@@ -157,6 +273,10 @@ private:
 	Material* material4;
 	Material* material5;
 
+	TextureStreamer* textureStreamer;
+	MaterialTable* materialTable;		// The materials above, baked
+	std::vector<GameEntity*> platformDrawOrder;	// Lit pass, rebuilt every frame
+
 	float gravity = 20.0f;
 	float speed = 10.0f;
 	float constSpeed = 10.0f;
@@ -169,8 +289,18 @@ private:
 	bool paused = false;
 
 	//UI stuff
-	std::unique_ptr<SpriteBatch> spriteBatch;
 	std::unique_ptr<SpriteFont> spriteFont;
+	std::unique_ptr<SpriteText> spriteText;
+	SimpleVertexShader* uiVS;
+	SimplePixelShader* uiPS;
+	UIRenderer* uiRenderer;
+	UITree* menuUI;
+	UITree* hudUI;
+	UITree* gameOverUI;
+	int playButtonElement;
+	int quitButtonElement;
+	int scoreTextElement;
+	int shownScore;			// Score the HUD text was last laid out for
 	ID3D11ShaderResourceView* playButtonSprite;
 	ID3D11ShaderResourceView* quitButtonSprite;
 	ID3D11ShaderResourceView* scoreUISprite;
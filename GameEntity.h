@@ -25,6 +25,7 @@ public:
 	Material* GetMaterial() { return material; }
 	DirectX::XMFLOAT4X4* GetWorldMatrix() { return &worldMatrix; }
 	DirectX::XMFLOAT3 GetPosition() { return position; }
+	DirectX::XMFLOAT3 GetScale() { return scale; }
 
 private:
 
@@ -0,0 +1,36 @@
+cbuffer Data : register(b0)
+{
+	float2 texelStep;	// One texel along the blur direction, in uv space
+	int tapCount;
+	float4 taps[8];		// x = offset in texels, y = weight (taps[0] is the center)
+}
+
+
+// Defines the input to this pixel shader
+// - Should match the output of our corresponding vertex shader
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float2 uv           : TEXCOORD0;
+};
+
+// Textures and such
+Texture2D BlurTex		: register(t0);
+SamplerState Sampler	: register(s0);
+
+// Entry point for this pixel shader
+// - One direction of a separable Gaussian.  Each tap past the center sits
+//   between two texels so the linear filter does half of the work for us.
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	float4 totalColor = BlurTex.Sample(Sampler, input.uv) * taps[0].y;
+
+	for (int i = 1; i < tapCount; i++)
+	{
+		float2 offset = texelStep * taps[i].x;
+		totalColor += BlurTex.Sample(Sampler, input.uv + offset) * taps[i].y;
+		totalColor += BlurTex.Sample(Sampler, input.uv - offset) * taps[i].y;
+	}
+
+	return totalColor;
+}
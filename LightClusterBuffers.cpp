@@ -0,0 +1,91 @@
+#include "LightClusterBuffers.h"
+
+LightClusterBuffers::LightClusterBuffers(ID3D11Device* device)
+{
+	this->device = device;
+	lightBuffer = {};
+	rangeBuffer = {};
+	indexBuffer = {};
+	bytesUploaded = 0;
+}
+
+LightClusterBuffers::~LightClusterBuffers()
+{
+	Release(lightBuffer);
+	Release(rangeBuffer);
+	Release(indexBuffer);
+}
+
+void LightClusterBuffers::Release(StructuredBuffer& buffer)
+{
+	if (buffer.SRV) buffer.SRV->Release();
+	if (buffer.Buffer) buffer.Buffer->Release();
+	buffer = {};
+}
+
+// --------------------------------------------------------
+// Map with discard, after growing the buffer to the next
+// power of two if it's too small
+// --------------------------------------------------------
+void LightClusterBuffers::Update(RenderContext* context, StructuredBuffer& buffer, const void* data, int count, int stride)
+{
+	if (count > buffer.Capacity || !buffer.Buffer)
+	{
+		int capacity = 64;
+		while (capacity < count)
+			capacity *= 2;
+
+		Release(buffer);
+
+		D3D11_BUFFER_DESC desc = {};
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.ByteWidth = stride * capacity;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		desc.StructureByteStride = stride;
+		device->CreateBuffer(&desc, 0, &buffer.Buffer);
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = capacity;
+		device->CreateShaderResourceView(buffer.Buffer, &srvDesc, &buffer.SRV);
+
+		buffer.Capacity = capacity;
+	}
+
+	// Nothing past the counts is read, so an empty list can
+	// leave the buffer as it was
+	if (count > 0)
+	{
+		context->UpdateDynamicBuffer(buffer.Buffer, data, count * stride);
+		bytesUploaded += count * stride;
+	}
+}
+
+void LightClusterBuffers::Upload(RenderContext* context, const LightClusterGrid& grid, const ClusterLight* lights, int lightCount)
+{
+	const std::vector<uint32_t>& ranges = grid.GetClusterRanges();
+	const std::vector<uint32_t>& indices = grid.GetLightIndices();
+
+	Update(context, lightBuffer, lights, lightCount, sizeof(ClusterLight));
+	Update(context, rangeBuffer, ranges.data(), (int)ranges.size() / 2, sizeof(uint32_t) * 2);
+	Update(context, indexBuffer, indices.data(), (int)indices.size(), sizeof(uint32_t));
+}
+
+void LightClusterBuffers::Bind(RenderContext* context, SimplePixelShader* ps, const LightClusterGrid& grid, float targetWidth, float targetHeight)
+{
+	context->SetShaderResourceView(ps, "ClusterLights", lightBuffer.SRV);
+	context->SetShaderResourceView(ps, "ClusterRanges", rangeBuffer.SRV);
+	context->SetShaderResourceView(ps, "ClusterLightIndices", indexBuffer.SRV);
+
+	// Pixel position to tile is just a scale
+	const LightClusterSettings& settings = grid.GetSettings();
+	ps->SetFloat2("clusterTileScale", DirectX::XMFLOAT2(settings.TilesX / targetWidth, settings.TilesY / targetHeight));
+	ps->SetFloat("clusterSliceScale", grid.GetSliceScale());
+	ps->SetFloat("clusterSliceBias", grid.GetSliceBias());
+	int counts[3] = { settings.TilesX, settings.TilesY, settings.Slices };
+	ps->SetData("clusterCounts", counts, sizeof(counts));
+}
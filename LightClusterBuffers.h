@@ -0,0 +1,45 @@
+#pragma once
+
+#include <d3d11.h>
+
+#include "SimpleShader.h"
+#include "RenderContext.h"
+#include "LightClusters.h"
+
+// --------------------------------------------------------
+// GPU side of a LightClusterGrid - the lights, each
+// cluster's offset and count, and the packed light indices,
+// each in a dynamic structured buffer that grows as needed.
+// Bind hands them and the grid's shape to PixelShader.
+// --------------------------------------------------------
+class LightClusterBuffers {
+public:
+	LightClusterBuffers(ID3D11Device* device);
+	~LightClusterBuffers();
+
+	void Upload(RenderContext* context, const LightClusterGrid& grid, const ClusterLight* lights, int lightCount);
+
+	// targetWidth and targetHeight are the size of what the
+	// shader draws into, which the tiles are spread over
+	void Bind(RenderContext* context, SimplePixelShader* ps, const LightClusterGrid& grid, float targetWidth, float targetHeight);
+
+	// Since the last ResetStats
+	int GetBytesUploaded() { return bytesUploaded; }
+	void ResetStats() { bytesUploaded = 0; }
+
+private:
+	struct StructuredBuffer {
+		ID3D11Buffer* Buffer;
+		ID3D11ShaderResourceView* SRV;
+		int Capacity;		// In elements
+	};
+
+	ID3D11Device* device;
+	StructuredBuffer lightBuffer;
+	StructuredBuffer rangeBuffer;
+	StructuredBuffer indexBuffer;
+	int bytesUploaded;
+
+	void Update(RenderContext* context, StructuredBuffer& buffer, const void* data, int count, int stride);
+	static void Release(StructuredBuffer& buffer);
+};
@@ -0,0 +1,368 @@
+#include "LightClusters.h"
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define LIGHT_CLUSTERS_SSE
+#endif
+
+LightClusterGrid::LightClusterGrid(const LightClusterSettings& settings, int threadCount)
+{
+	this->settings = settings;
+	projectionX = 0;
+	projectionY = 0;
+	stats = {};
+
+	// Slice s starts at Near * (Far / Near)^(s / Slices)
+	float logRatio = logf(settings.Far / settings.Near);
+	sliceScale = settings.Slices / logRatio;
+	sliceBias = -settings.Slices * logf(settings.Near) / logRatio;
+
+	clusterLights.resize(GetClusterCount());
+	ranges.resize(GetClusterCount() * 2);
+
+	job = 0;
+	jobCount = 0;
+	nextJob = 0;
+	busyWorkers = 0;
+	generation = 0;
+	quit = false;
+
+	if (threadCount <= 0)
+		threadCount = std::max((int)std::thread::hardware_concurrency(), 1);
+
+	// The calling thread works too
+	for (int i = 1; i < threadCount; i++)
+		workers.push_back(std::thread(&LightClusterGrid::WorkerLoop, this));
+}
+
+LightClusterGrid::~LightClusterGrid()
+{
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		quit = true;
+	}
+	jobStart.notify_all();
+
+	for (auto& worker : workers)
+		worker.join();
+}
+
+int LightClusterGrid::GetSlice(float viewDepth) const
+{
+	if (viewDepth <= settings.Near)
+		return 0;
+	int slice = (int)floorf(logf(viewDepth) * sliceScale + sliceBias);
+	return std::min(std::max(slice, 0), settings.Slices - 1);
+}
+
+void LightClusterGrid::Build(const ClusterLight* lights, int lightCount, const float* view, const float* projection)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Only the scales matter for a centered perspective
+	// projection - x and y are divided by view depth
+	float scaleX = projection[0];
+	float scaleY = projection[5];
+	if (scaleX != projectionX || scaleY != projectionY)
+		BuildBoxes(scaleX, scaleY);
+
+	ComputeBounds(lights, lightCount, view, scaleX, scaleY);
+
+	// Slices don't share clusters, so each job has its own lists
+	for (std::vector<uint32_t>& list : clusterLights)
+		list.clear();
+	std::function<void(int)> cullSlice = [this](int slice) { CullSlice(slice); };
+	ParallelFor(settings.Slices, cullSlice);
+
+	// Pack the lists one after another
+	indices.clear();
+	stats = {};
+	for (int c = 0; c < GetClusterCount(); c++)
+	{
+		const std::vector<uint32_t>& list = clusterLights[c];
+		ranges[c * 2] = (uint32_t)indices.size();
+		ranges[c * 2 + 1] = (uint32_t)list.size();
+		indices.insert(indices.end(), list.begin(), list.end());
+		stats.MaxPerCluster = std::max(stats.MaxPerCluster, (int)list.size());
+	}
+
+	stats.Lights = lightCount;
+	for (const LightBounds& light : bounds)
+	{
+		if (light.MinSlice <= light.MaxSlice)
+			stats.LightsVisible++;
+	}
+	stats.Indices = (int)indices.size();
+	stats.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// --------------------------------------------------------
+// Boxes only change with the projection.  A tile's sides are
+// planes through the eye, so its widest point in a slice is
+// at the near or far end.
+// --------------------------------------------------------
+void LightClusterGrid::BuildBoxes(float projectionX, float projectionY)
+{
+	this->projectionX = projectionX;
+	this->projectionY = projectionY;
+	boxes.resize(GetClusterCount());
+
+	for (int slice = 0; slice < settings.Slices; slice++)
+	{
+		float nearDepth = settings.Near * powf(settings.Far / settings.Near, slice / (float)settings.Slices);
+		float farDepth = settings.Near * powf(settings.Far / settings.Near, (slice + 1) / (float)settings.Slices);
+
+		for (int y = 0; y < settings.TilesY; y++)
+		{
+			// Tiles go down the screen, NDC y goes up
+			float top = 1.0f - 2.0f * y / settings.TilesY;
+			float bottom = 1.0f - 2.0f * (y + 1) / settings.TilesY;
+
+			for (int x = 0; x < settings.TilesX; x++)
+			{
+				float left = -1.0f + 2.0f * x / settings.TilesX;
+				float right = -1.0f + 2.0f * (x + 1) / settings.TilesX;
+
+				ClusterBox& box = boxes[(slice * settings.TilesY + y) * settings.TilesX + x];
+				box.Min[0] = std::min(left * nearDepth, left * farDepth) / projectionX;
+				box.Max[0] = std::max(right * nearDepth, right * farDepth) / projectionX;
+				box.Min[1] = std::min(bottom * nearDepth, bottom * farDepth) / projectionY;
+				box.Max[1] = std::max(top * nearDepth, top * farDepth) / projectionY;
+				box.Min[2] = nearDepth;
+				box.Max[2] = farDepth;
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// View space sphere, clipped depth range and the screen
+// rectangle around it.  The rectangle is around the box
+// around the sphere - loose, but the per cluster test
+// tightens it up again.  x / depth is smallest at the near
+// end when x is negative and at the far end when it isn't,
+// and the other way around for the largest.
+// --------------------------------------------------------
+void LightClusterGrid::ComputeBounds(const ClusterLight* lights, int lightCount, const float* view, float projectionX, float projectionY)
+{
+	bounds.resize(lightCount);
+	int i = 0;
+
+#ifdef LIGHT_CLUSTERS_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 nearPlane = _mm_set1_ps(settings.Near);
+	const __m128 farPlane = _mm_set1_ps(settings.Far);
+	const __m128 scaleX = _mm_set1_ps(projectionX);
+	const __m128 scaleY = _mm_set1_ps(projectionY);
+
+	// The further edge of the rectangle picks which depth it's
+	// divided by
+	auto divide = [](__m128 value, __m128 useNear, __m128 nearDepth, __m128 farDepth) {
+		__m128 depth = _mm_or_ps(_mm_and_ps(useNear, nearDepth), _mm_andnot_ps(useNear, farDepth));
+		return _mm_div_ps(value, depth);
+	};
+
+	for (; i + 4 <= lightCount; i += 4)
+	{
+		const ClusterLight* l = lights + i;
+		__m128 wx = _mm_setr_ps(l[0].Position[0], l[1].Position[0], l[2].Position[0], l[3].Position[0]);
+		__m128 wy = _mm_setr_ps(l[0].Position[1], l[1].Position[1], l[2].Position[1], l[3].Position[1]);
+		__m128 wz = _mm_setr_ps(l[0].Position[2], l[1].Position[2], l[2].Position[2], l[3].Position[2]);
+		__m128 radius = _mm_setr_ps(l[0].Range, l[1].Range, l[2].Range, l[3].Range);
+
+		__m128 center[3];
+		for (int c = 0; c < 3; c++)
+		{
+			const float* row = view + c * 4;
+			center[c] = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(wx, _mm_set1_ps(row[0])), _mm_mul_ps(wy, _mm_set1_ps(row[1]))),
+				_mm_add_ps(_mm_mul_ps(wz, _mm_set1_ps(row[2])), _mm_set1_ps(row[3])));
+		}
+
+		__m128 depthMin = _mm_max_ps(_mm_sub_ps(center[2], radius), nearPlane);
+		__m128 depthMax = _mm_min_ps(_mm_add_ps(center[2], radius), farPlane);
+
+		__m128 left = _mm_sub_ps(center[0], radius);
+		__m128 right = _mm_add_ps(center[0], radius);
+		__m128 bottom = _mm_sub_ps(center[1], radius);
+		__m128 top = _mm_add_ps(center[1], radius);
+
+		__m128 ndc[4] = {
+			_mm_mul_ps(divide(left, _mm_cmplt_ps(left, zero), depthMin, depthMax), scaleX),
+			_mm_mul_ps(divide(bottom, _mm_cmplt_ps(bottom, zero), depthMin, depthMax), scaleY),
+			_mm_mul_ps(divide(right, _mm_cmpgt_ps(right, zero), depthMin, depthMax), scaleX),
+			_mm_mul_ps(divide(top, _mm_cmpgt_ps(top, zero), depthMin, depthMax), scaleY) };
+
+		float out[10][4];
+		_mm_storeu_ps(out[0], center[0]);
+		_mm_storeu_ps(out[1], center[1]);
+		_mm_storeu_ps(out[2], center[2]);
+		_mm_storeu_ps(out[3], radius);
+		_mm_storeu_ps(out[4], depthMin);
+		_mm_storeu_ps(out[5], depthMax);
+		for (int k = 0; k < 4; k++)
+			_mm_storeu_ps(out[6 + k], ndc[k]);
+
+		for (int j = 0; j < 4; j++)
+		{
+			LightBounds& light = bounds[i + j];
+			light.Center[0] = out[0][j];
+			light.Center[1] = out[1][j];
+			light.Center[2] = out[2][j];
+			light.Radius = out[3][j];
+			light.DepthMin = out[4][j];
+			light.DepthMax = out[5][j];
+			light.NdcMin[0] = out[6][j];
+			light.NdcMin[1] = out[7][j];
+			light.NdcMax[0] = out[8][j];
+			light.NdcMax[1] = out[9][j];
+			FinishBounds(light);
+		}
+	}
+#endif
+
+	// The rest one at a time, the same way
+	for (; i < lightCount; i++)
+	{
+		const ClusterLight& l = lights[i];
+		LightBounds& light = bounds[i];
+		for (int c = 0; c < 3; c++)
+		{
+			const float* row = view + c * 4;
+			light.Center[c] = l.Position[0] * row[0] + l.Position[1] * row[1] + l.Position[2] * row[2] + row[3];
+		}
+		light.Radius = l.Range;
+		light.DepthMin = std::max(light.Center[2] - light.Radius, settings.Near);
+		light.DepthMax = std::min(light.Center[2] + light.Radius, settings.Far);
+
+		float left = light.Center[0] - light.Radius;
+		float right = light.Center[0] + light.Radius;
+		float bottom = light.Center[1] - light.Radius;
+		float top = light.Center[1] + light.Radius;
+		light.NdcMin[0] = left / (left < 0 ? light.DepthMin : light.DepthMax) * projectionX;
+		light.NdcMin[1] = bottom / (bottom < 0 ? light.DepthMin : light.DepthMax) * projectionY;
+		light.NdcMax[0] = right / (right > 0 ? light.DepthMin : light.DepthMax) * projectionX;
+		light.NdcMax[1] = top / (top > 0 ? light.DepthMin : light.DepthMax) * projectionY;
+		FinishBounds(light);
+	}
+}
+
+// Screen rectangle and depths to tiles and slices
+void LightClusterGrid::FinishBounds(LightBounds& light)
+{
+	light.MinSlice = 1;
+	light.MaxSlice = 0;
+
+	// Behind the camera, past the far plane or off the screen
+	if (light.DepthMin > light.DepthMax ||
+		light.NdcMin[0] > 1.0f || light.NdcMax[0] < -1.0f ||
+		light.NdcMin[1] > 1.0f || light.NdcMax[1] < -1.0f)
+		return;
+
+	auto tile = [](float position, int count) {
+		return std::min(std::max((int)floorf(position * count), 0), count - 1);
+	};
+	light.MinX = tile(light.NdcMin[0] * 0.5f + 0.5f, settings.TilesX);
+	light.MaxX = tile(light.NdcMax[0] * 0.5f + 0.5f, settings.TilesX);
+	light.MinY = tile(0.5f - light.NdcMax[1] * 0.5f, settings.TilesY);
+	light.MaxY = tile(0.5f - light.NdcMin[1] * 0.5f, settings.TilesY);
+	light.MinSlice = GetSlice(light.DepthMin);
+	light.MaxSlice = GetSlice(light.DepthMax);
+}
+
+// --------------------------------------------------------
+// Sphere against each cluster box in the light's range
+// --------------------------------------------------------
+void LightClusterGrid::CullSlice(int slice)
+{
+	for (int i = 0; i < (int)bounds.size(); i++)
+	{
+		const LightBounds& light = bounds[i];
+		if (slice < light.MinSlice || slice > light.MaxSlice)
+			continue;
+
+		float radiusSq = light.Radius * light.Radius;
+		for (int y = light.MinY; y <= light.MaxY; y++)
+		{
+			int row = (slice * settings.TilesY + y) * settings.TilesX;
+			for (int x = light.MinX; x <= light.MaxX; x++)
+			{
+				const ClusterBox& box = boxes[row + x];
+				float distanceSq = 0;
+				for (int k = 0; k < 3; k++)
+				{
+					float outside = std::max(box.Min[k] - light.Center[k], 0.0f) + std::max(light.Center[k] - box.Max[k], 0.0f);
+					distanceSq += outside * outside;
+				}
+				if (distanceSq <= radiusSq)
+					clusterLights[row + x].push_back((uint32_t)i);
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Worker pool - ParallelFor hands out indices from an atomic
+// counter and the calling thread takes some too
+// --------------------------------------------------------
+
+void LightClusterGrid::ParallelFor(int count, const std::function<void(int)>& function)
+{
+	if (workers.empty() || count <= 1)
+	{
+		for (int i = 0; i < count; i++)
+			function(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		job = &function;
+		jobCount = count;
+		nextJob = 0;
+		busyWorkers = (int)workers.size();
+		generation++;
+	}
+	jobStart.notify_all();
+
+	RunJobs();
+
+	std::unique_lock<std::mutex> lock(jobMutex);
+	jobDone.wait(lock, [this]() { return busyWorkers == 0; });
+	job = 0;
+}
+
+void LightClusterGrid::RunJobs()
+{
+	for (;;)
+	{
+		int i = nextJob++;
+		if (i >= jobCount)
+			break;
+		(*job)(i);
+	}
+}
+
+void LightClusterGrid::WorkerLoop()
+{
+	int seen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobStart.wait(lock, [this, seen]() { return quit || generation != seen; });
+			if (quit)
+				return;
+			seen = generation;
+		}
+
+		RunJobs();
+
+		std::lock_guard<std::mutex> lock(jobMutex);
+		if (--busyWorkers == 0)
+			jobDone.notify_one();
+	}
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// Clustered light culling
+//
+// The view frustum is cut into a grid of clusters - screen
+// tiles across, and slices along the view depth that get
+// thicker further out (each one is the same ratio deeper
+// than the last).  Every frame each cluster gets the list of
+// lights whose range reaches it, so a pixel only loops over
+// the lights of the cluster it's in, however many there are
+// in the scene.
+//
+// Building it is two steps:
+//  - Each light's bounding sphere is moved to view space and
+//    turned into a range of tiles and slices, four lights at
+//    a time with SSE where there is SSE
+//  - Then one job per slice, spread over a pool of threads,
+//    tests the lights against each cluster's box in that
+//    range and collects the ones that touch it
+// The lists are packed into one index array, with an offset
+// and count per cluster, ready to go into structured buffers
+// (see LightClusterBuffers).
+// --------------------------------------------------------
+
+// One point or spot light.  Same layout as ClusterLight in
+// PixelShader.hlsl.
+struct ClusterLight {
+	float Position[3];	// World space
+	float Range;		// Nothing past this
+	float Color[3];
+	float SpotCosine;	// Cosine of the cone's half angle, -1 for a point light
+	float Direction[3];	// Where a spot light points, unit length
+	float Padding;
+};
+
+struct LightClusterSettings {
+	int TilesX;
+	int TilesY;
+	int Slices;
+	float Near;		// The camera's clip planes
+	float Far;
+};
+
+struct LightClusterStats {
+	int Lights;
+	int LightsVisible;		// In the frustum at all
+	int Indices;			// Entries in all the lists together
+	int MaxPerCluster;
+	double Milliseconds;	// Build time
+};
+
+class LightClusterGrid {
+public:
+	// 0 threads uses every hardware thread
+	LightClusterGrid(const LightClusterSettings& settings, int threadCount = 0);
+	~LightClusterGrid();
+
+	const LightClusterSettings& GetSettings() const { return settings; }
+	int GetClusterCount() const { return settings.TilesX * settings.TilesY * settings.Slices; }
+
+	// view and projection are stored the way they're uploaded
+	// (transposed, see SoftwareShaders.h).  The projection must
+	// be a centered perspective one, like Camera's.
+	void Build(const ClusterLight* lights, int lightCount, const float* view, const float* projection);
+
+	// Two per cluster - offset into the indices, and count.
+	// Clusters go x fastest, then y (from the top), then slice.
+	const std::vector<uint32_t>& GetClusterRanges() const { return ranges; }
+	const std::vector<uint32_t>& GetLightIndices() const { return indices; }
+	const LightClusterStats& GetStats() const { return stats; }
+
+	// Slice of a view depth is floor(log(depth) * scale + bias),
+	// which is what the pixel shader works out
+	float GetSliceScale() const { return sliceScale; }
+	float GetSliceBias() const { return sliceBias; }
+	int GetSlice(float viewDepth) const;
+
+private:
+	// A light's view space sphere and the clusters it might
+	// reach, from Build's first step
+	struct LightBounds {
+		float Center[3];
+		float Radius;
+		float DepthMin, DepthMax;	// Clamped to the clip planes
+		float NdcMin[2], NdcMax[2];	// Screen rectangle, -1 to 1 with y up
+		int MinX, MaxX;
+		int MinY, MaxY;
+		int MinSlice, MaxSlice;		// MinSlice > MaxSlice if it's not visible
+	};
+
+	// View space box around a cluster
+	struct ClusterBox {
+		float Min[3];
+		float Max[3];
+	};
+
+	LightClusterSettings settings;
+	float sliceScale;
+	float sliceBias;
+	float projectionX;	// Projection scales the boxes were made for
+	float projectionY;
+
+	std::vector<ClusterBox> boxes;
+	std::vector<LightBounds> bounds;
+	std::vector<std::vector<uint32_t>> clusterLights;	// Scratch, kept between builds
+	std::vector<uint32_t> ranges;
+	std::vector<uint32_t> indices;
+	LightClusterStats stats;
+
+	void BuildBoxes(float projectionX, float projectionY);
+	void ComputeBounds(const ClusterLight* lights, int lightCount, const float* view, float projectionX, float projectionY);
+	void FinishBounds(LightBounds& light);
+	void CullSlice(int slice);
+
+	// Worker pool, the same as SoftwareRasterizer's
+	std::vector<std::thread> workers;
+	std::mutex jobMutex;
+	std::condition_variable jobStart;
+	std::condition_variable jobDone;
+	const std::function<void(int)>* job;
+	int jobCount;
+	std::atomic<int> nextJob;
+	int busyWorkers;
+	int generation;
+	bool quit;
+
+	void ParallelFor(int count, const std::function<void(int)>& function);
+	void RunJobs();
+	void WorkerLoop();
+};
@@ -0,0 +1,136 @@
+#include "MappedDDSLoader.h"
+#include "DDSLayout.h"
+#include <vector>
+
+MappedFile::MappedFile() {
+	file = INVALID_HANDLE_VALUE;
+	mapping = 0;
+	data = 0;
+	size = 0;
+}
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+bool MappedFile::Open(const wchar_t* fileName) {
+	Close();
+
+	file = CreateFileW(fileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 || (uint64_t)fileSize.QuadPart > (size_t)-1) {
+		Close();
+		return false;
+	}
+	size = (size_t)fileSize.QuadPart;
+
+	mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (!mapping) {
+		Close();
+		return false;
+	}
+
+	data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::Close() {
+	if (data) { UnmapViewOfFile(data); data = 0; }
+	if (mapping) { CloseHandle(mapping); mapping = 0; }
+	if (file != INVALID_HANDLE_VALUE) { CloseHandle(file); file = INVALID_HANDLE_VALUE; }
+	size = 0;
+}
+
+HRESULT CreateMappedDDSTextureFromFile(ID3D11Device* device, const wchar_t* fileName, ID3D11ShaderResourceView** srv, unsigned int skipMips) {
+	if (!device || !fileName || !srv)
+		return E_INVALIDARG;
+	*srv = 0;
+
+	MappedFile file;
+	if (!file.Open(fileName))
+		return HRESULT_FROM_WIN32(GetLastError());
+
+	DDSLayout layout;
+	if (!ParseDDSLayout(file.GetData(), file.GetSize(), layout))
+		return E_FAIL;
+
+	// Keep at least one mip, and keep compressed top levels a multiple of 4
+	if (skipMips >= layout.MipCount)
+		skipMips = layout.MipCount - 1;
+	if (DDSIsBlockCompressed(layout.Format)) {
+		while (skipMips > 0) {
+			const DDSSubresource& top = layout.Subresources[skipMips];
+			if (top.Width % 4 == 0 && top.Height % 4 == 0)
+				break;
+			skipMips--;
+		}
+	}
+	UINT mipCount = layout.MipCount - skipMips;
+
+	// Point every subresource directly into the mapped file
+	std::vector<D3D11_SUBRESOURCE_DATA> initData(layout.ArraySize * mipCount);
+	for (UINT item = 0; item < layout.ArraySize; item++) {
+		for (UINT mip = 0; mip < mipCount; mip++) {
+			const DDSSubresource& sub = layout.Subresources[item * layout.MipCount + mip + skipMips];
+			D3D11_SUBRESOURCE_DATA& init = initData[item * mipCount + mip];
+			init.pSysMem = file.GetData() + sub.Offset;
+			init.SysMemPitch = sub.RowPitch;
+			init.SysMemSlicePitch = sub.SlicePitch;
+		}
+	}
+
+	const DDSSubresource& top = layout.Subresources[skipMips];
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = top.Width;
+	desc.Height = top.Height;
+	desc.MipLevels = mipCount;
+	desc.ArraySize = layout.ArraySize;
+	desc.Format = (DXGI_FORMAT)layout.Format;
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = layout.IsCubeMap ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+
+	// The data is copied by the runtime here, so the mapping can close afterwards
+	ID3D11Texture2D* texture = 0;
+	HRESULT hr = device->CreateTexture2D(&desc, &initData[0], &texture);
+	if (FAILED(hr))
+		return hr;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = desc.Format;
+	if (layout.IsCubeMap && layout.ArraySize == 6) {
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+		srvDesc.TextureCube.MipLevels = mipCount;
+		srvDesc.TextureCube.MostDetailedMip = 0;
+	} else if (layout.IsCubeMap) {
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
+		srvDesc.TextureCubeArray.MipLevels = mipCount;
+		srvDesc.TextureCubeArray.MostDetailedMip = 0;
+		srvDesc.TextureCubeArray.First2DArrayFace = 0;
+		srvDesc.TextureCubeArray.NumCubes = layout.ArraySize / 6;
+	} else if (layout.ArraySize > 1) {
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MipLevels = mipCount;
+		srvDesc.Texture2DArray.MostDetailedMip = 0;
+		srvDesc.Texture2DArray.FirstArraySlice = 0;
+		srvDesc.Texture2DArray.ArraySize = layout.ArraySize;
+	} else {
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = mipCount;
+		srvDesc.Texture2D.MostDetailedMip = 0;
+	}
+
+	hr = device->CreateShaderResourceView(texture, &srvDesc, srv);
+	texture->Release();
+	return hr;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <d3d11.h>
+#include <stdint.h>
+
+// --------------------------------------------------------
+// A read-only memory mapping of a whole file
+// --------------------------------------------------------
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const wchar_t* fileName);
+	void Close();
+
+	const uint8_t* GetData() { return data; }
+	size_t GetSize() { return size; }
+
+private:
+	HANDLE file;
+	HANDLE mapping;
+	const uint8_t* data;
+	size_t size;
+};
+
+// --------------------------------------------------------
+// Creates a 2D or cube texture straight from a memory mapped
+// DDS file.  The subresource data handed to D3D points into the
+// mapping, so no heap copy of the file is ever made.
+//
+// skipMips - Number of the most detailed mips to leave out
+//            (low memory mode).  Clamped so at least one mip
+//            remains and block compressed textures keep a
+//            valid top level size.
+// --------------------------------------------------------
+HRESULT CreateMappedDDSTextureFromFile(
+	ID3D11Device* device,
+	const wchar_t* fileName,
+	ID3D11ShaderResourceView** srv,
+	unsigned int skipMips = 0);
@@ -8,6 +8,8 @@ Material::Material(SimplePixelShader* _pixelShader, SimpleVertexShader* _vertexS
 	materialSRV = _materialSRV;
 	normalSRV = _normalSRV;
 	materialSampler = _materialSampler;
+	specularPower = 8.0f;
+	state = 0;
 }
 
 
@@ -1,6 +1,9 @@
 #pragma once
 //#include"Game.h"
 #include "SimpleShader.h"
+
+struct MaterialState;
+
 class Material {
 public:
 	Material(SimplePixelShader* pixelShader, SimpleVertexShader* vertexShader, ID3D11ShaderResourceView* materialSRV, ID3D11ShaderResourceView* normalSRV, ID3D11SamplerState* materialSampler);
@@ -11,10 +14,23 @@ public:
 	ID3D11ShaderResourceView* GetNormalSRV();
 	ID3D11SamplerState* GetMaterialSampler();
 
+	void SetMaterialSRV(ID3D11ShaderResourceView* srv) { materialSRV = srv; }
+	void SetNormalSRV(ID3D11ShaderResourceView* srv) { normalSRV = srv; }
+
+	// Exponent of the point light's highlight
+	float GetSpecularPower() { return specularPower; }
+	void SetSpecularPower(float power) { specularPower = power; }
+
+	// Baked by the MaterialTable it's in, null until then
+	const MaterialState* GetState() { return state; }
+	void SetState(const MaterialState* state) { this->state = state; }
+
 private:
 	SimplePixelShader* pixelShader;
 	SimpleVertexShader* vertexShader;
 	ID3D11ShaderResourceView* materialSRV;
 	ID3D11ShaderResourceView* normalSRV;
 	ID3D11SamplerState* materialSampler;
+	float specularPower;
+	const MaterialState* state;
 };
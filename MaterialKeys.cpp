@@ -0,0 +1,135 @@
+#include "MaterialKeys.h"
+
+uint32_t MakeMaterialKey(const MaterialKeyParts& parts)
+{
+	const uint32_t programMask = (1u << MaterialKeyProgramBits) - 1;
+	const uint32_t tableMask = (1u << MaterialKeyTableBits) - 1;
+	const uint32_t samplerMask = (1u << MaterialKeySamplerBits) - 1;
+	const uint32_t layerMask = (1u << MaterialKeyLayerBits) - 1;
+
+	uint32_t key = parts.Program & programMask;
+	key = (key << MaterialKeyTableBits) | (parts.Table & tableMask);
+	key = (key << MaterialKeySamplerBits) | (parts.Sampler & samplerMask);
+	key = (key << MaterialKeyLayerBits) | (parts.Layer & layerMask);
+	return key;
+}
+
+MaterialKeyParts SplitMaterialKey(uint32_t key)
+{
+	MaterialKeyParts parts;
+	parts.Layer = key & ((1u << MaterialKeyLayerBits) - 1);
+	key >>= MaterialKeyLayerBits;
+	parts.Sampler = key & ((1u << MaterialKeySamplerBits) - 1);
+	key >>= MaterialKeySamplerBits;
+	parts.Table = key & ((1u << MaterialKeyTableBits) - 1);
+	key >>= MaterialKeyTableBits;
+	parts.Program = key & ((1u << MaterialKeyProgramBits) - 1);
+	return parts;
+}
+
+uint32_t MaterialIdMap::GetId(const void* object, const void* second)
+{
+	std::pair<const void*, const void*> key(object, second);
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		if (objects[i] == key)
+			return (uint32_t)i;
+	}
+	objects.push_back(key);
+	return (uint32_t)objects.size() - 1;
+}
+
+// --------------------------------------------------------
+// Texture tables
+// --------------------------------------------------------
+
+static bool SameDesc(const MaterialTextureDesc& a, const MaterialTextureDesc& b)
+{
+	return a.Width == b.Width && a.Height == b.Height && a.Format == b.Format && a.MipLevels == b.MipLevels;
+}
+
+int GroupMaterialTextures(
+	const std::vector<MaterialTextureDesc>& albedo,
+	const std::vector<MaterialTextureDesc>& normal,
+	std::vector<MaterialTextureSlot>& slots)
+{
+	// First pair of each table, and how many layers it has so far
+	std::vector<size_t> tableFirst;
+	std::vector<int> tableLayers;
+
+	slots.resize(albedo.size());
+	for (size_t i = 0; i < albedo.size(); i++)
+	{
+		int table = -1;
+		for (size_t t = 0; t < tableFirst.size() && table < 0; t++)
+		{
+			size_t first = tableFirst[t];
+			if (SameDesc(albedo[i], albedo[first]) && SameDesc(normal[i], normal[first]))
+				table = (int)t;
+		}
+
+		if (table < 0)
+		{
+			table = (int)tableFirst.size();
+			tableFirst.push_back(i);
+			tableLayers.push_back(0);
+		}
+
+		slots[i].Table = table;
+		slots[i].Layer = tableLayers[table]++;
+	}
+	return (int)tableFirst.size();
+}
+
+// --------------------------------------------------------
+// What's bound where
+// --------------------------------------------------------
+
+BindingCache::BindingCache()
+{
+	stats = {};
+	Invalidate();
+}
+
+bool BindingCache::Bind(int stage, int slot, const void* object)
+{
+	return Record(stage, slot, 0, object);
+}
+
+bool BindingCache::BindSampler(int stage, int slot, const void* sampler)
+{
+	return Record(stage, slot, MaxSlots, sampler);
+}
+
+bool BindingCache::Record(int stage, int slot, int first, const void* object)
+{
+	stats.Requested++;
+
+	// Anything out of range can't be tracked, so always binds
+	if (stage < 0 || stage >= MaxStages || slot < 0 || slot >= MaxSlots)
+	{
+		stats.Issued++;
+		return true;
+	}
+
+	int index = first + slot;
+	if (known[stage][index] && bound[stage][index] == object)
+		return false;
+
+	bound[stage][index] = object;
+	known[stage][index] = true;
+	stats.Issued++;
+	return true;
+}
+
+void BindingCache::Invalidate()
+{
+	for (int stage = 0; stage < MaxStages; stage++)
+	{
+		for (int index = 0; index < MaxSlots * 2; index++)
+		{
+			bound[stage][index] = 0;
+			known[stage][index] = false;
+		}
+	}
+}
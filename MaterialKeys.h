@@ -0,0 +1,117 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+// --------------------------------------------------------
+// The CPU side bookkeeping of baked materials
+//
+//  - A 32 bit sort key per material, packed so that sorting
+//    the keys as plain integers groups draws by what's most
+//    expensive to change: shaders, then texture table, then
+//    sampler, then the layer in the table (just a constant)
+//  - Grouping of albedo / normal map pairs into tables -
+//    pairs whose textures match in size, format and mip
+//    count can share a pair of texture arrays, one layer each
+//  - A record of what's bound in each slot, so binding a
+//    material only touches the slots that actually change
+//
+// MaterialTable does the D3D side.
+// --------------------------------------------------------
+
+// Bits of the key, top to bottom
+const int MaterialKeyProgramBits = 8;
+const int MaterialKeyTableBits = 8;
+const int MaterialKeySamplerBits = 6;
+const int MaterialKeyLayerBits = 10;
+
+struct MaterialKeyParts {
+	uint32_t Program;	// Vertex and pixel shader pair
+	uint32_t Table;
+	uint32_t Sampler;
+	uint32_t Layer;
+};
+
+// Each part should be a small dense id, and is masked to its
+// field if it isn't
+uint32_t MakeMaterialKey(const MaterialKeyParts& parts);
+MaterialKeyParts SplitMaterialKey(uint32_t key);
+
+// Hands out small dense ids in first-use order, for the
+// parts of the key.  Two objects make one id between them
+// (a vertex and pixel shader pair).
+class MaterialIdMap {
+public:
+	uint32_t GetId(const void* object, const void* second = 0);
+	void Clear() { objects.clear(); }
+
+private:
+	std::vector<std::pair<const void*, const void*>> objects;
+};
+
+// --------------------------------------------------------
+// Texture tables
+// --------------------------------------------------------
+
+struct MaterialTextureDesc {
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t Format;		// DXGI_FORMAT
+	uint32_t MipLevels;
+};
+
+struct MaterialTextureSlot {
+	int Table;
+	int Layer;
+};
+
+// One entry per material, albedo[i] and normal[i] being its
+// pair.  Pairs that match another pair exactly go in that
+// pair's table; tables and layers are numbered in first-use
+// order.  Returns the number of tables.
+int GroupMaterialTextures(
+	const std::vector<MaterialTextureDesc>& albedo,
+	const std::vector<MaterialTextureDesc>& normal,
+	std::vector<MaterialTextureSlot>& slots);
+
+// --------------------------------------------------------
+// What's bound where
+// --------------------------------------------------------
+
+struct BindingStats {
+	int Requested;
+	int Issued;		// The rest were already bound
+};
+
+class BindingCache {
+public:
+	BindingCache();
+
+	// True if slot of stage holds something else and the bind
+	// has to go through, in which case it's recorded as bound
+	bool Bind(int stage, int slot, const void* object);
+
+	// The same for samplers, whose slots are separate from the
+	// shader resources'
+	bool BindSampler(int stage, int slot, const void* sampler);
+
+	// Something else bound behind our back - forget it all
+	void Invalidate();
+
+	// Since the last ResetStats
+	const BindingStats& GetStats() const { return stats; }
+	void ResetStats() { stats = {}; }
+
+private:
+	static const int MaxStages = 2;
+	static const int MaxSlots = 16;
+
+	// Shader resources first, then samplers
+	const void* bound[MaxStages][MaxSlots * 2];
+	bool known[MaxStages][MaxSlots * 2];	// False once invalidated, so even null gets rebound
+	BindingStats stats;
+
+	bool Record(int stage, int slot, int first, const void* object);
+};
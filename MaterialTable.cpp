@@ -0,0 +1,308 @@
+#include "MaterialTable.h"
+#include "DDSLayout.h"
+
+// What a map a group doesn't have reads as.  Normals decode
+// as xy * 2 - 1, so this is (0, 0) - straight out.
+static const uint8_t WhiteTexel[4] = { 255, 255, 255, 255 };
+static const uint8_t FlatNormalTexel[4] = { 128, 128, 255, 255 };
+
+MaterialTable::MaterialTable(ID3D11Device* device, RenderContext* context)
+{
+	this->device = device;
+	this->context = context;
+	tableBytes = 0;
+	boundState = 0;
+}
+
+MaterialTable::~MaterialTable()
+{
+	ReleaseTables();
+}
+
+void MaterialTable::ReleaseTables()
+{
+	for (size_t i = 0; i < tables.size(); i++)
+	{
+		if (tables[i].AlbedoSRV) tables[i].AlbedoSRV->Release();
+		if (tables[i].NormalSRV) tables[i].NormalSRV->Release();
+		if (tables[i].Albedo) tables[i].Albedo->Release();
+		if (tables[i].Normal) tables[i].Normal->Release();
+	}
+	tables.clear();
+	tableBytes = 0;
+}
+
+void MaterialTable::Add(Material* material)
+{
+	materials.push_back(material);
+}
+
+MaterialTextureDesc MaterialTable::GetDesc(ID3D11ShaderResourceView* srv)
+{
+	MaterialTextureDesc desc = {};
+	if (!srv)
+		return desc;
+
+	ID3D11Resource* resource = 0;
+	srv->GetResource(&resource);
+	ID3D11Texture2D* texture = 0;
+	if (SUCCEEDED(resource->QueryInterface(__uuidof(ID3D11Texture2D), (void**)&texture)))
+	{
+		D3D11_TEXTURE2D_DESC textureDesc;
+		texture->GetDesc(&textureDesc);
+		desc.Width = textureDesc.Width;
+		desc.Height = textureDesc.Height;
+		desc.Format = textureDesc.Format;
+		desc.MipLevels = textureDesc.MipLevels;
+		texture->Release();
+	}
+	resource->Release();
+	return desc;
+}
+
+// --------------------------------------------------------
+// An array shaped like first's texture, with room for the
+// given number of layers
+// --------------------------------------------------------
+bool MaterialTable::CreateArray(ID3D11ShaderResourceView* first, UINT layers, ID3D11Texture2D** texture, ID3D11ShaderResourceView** srv)
+{
+	MaterialTextureDesc layerDesc = GetDesc(first);
+	if (layerDesc.Width == 0)
+		return false;
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = layerDesc.Width;
+	desc.Height = layerDesc.Height;
+	desc.MipLevels = layerDesc.MipLevels;
+	desc.ArraySize = layers;
+	desc.Format = (DXGI_FORMAT)layerDesc.Format;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	if (FAILED(device->CreateTexture2D(&desc, 0, texture)))
+		return false;
+
+	// Viewed the way the layers were, which may differ from
+	// the texture's own format (sRGB)
+	D3D11_SHADER_RESOURCE_VIEW_DESC firstDesc;
+	first->GetDesc(&firstDesc);
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = firstDesc.Format;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	srvDesc.Texture2DArray.MostDetailedMip = 0;
+	srvDesc.Texture2DArray.MipLevels = layerDesc.MipLevels;
+	srvDesc.Texture2DArray.FirstArraySlice = 0;
+	srvDesc.Texture2DArray.ArraySize = layers;
+	if (FAILED(device->CreateShaderResourceView(*texture, &srvDesc, srv)))
+	{
+		(*texture)->Release();
+		*texture = 0;
+		return false;
+	}
+
+	// Block compressed mips are never less than a block
+	uint32_t bits = DDSBitsPerPixel(layerDesc.Format);
+	bool blocks = DDSIsBlockCompressed(layerDesc.Format);
+	for (UINT mip = 0; mip < layerDesc.MipLevels; mip++)
+	{
+		long long width = max(layerDesc.Width >> mip, 1u);
+		long long height = max(layerDesc.Height >> mip, 1u);
+		if (blocks)
+		{
+			width = max(width, 4LL);
+			height = max(height, 4LL);
+		}
+		tableBytes += width * height * bits / 8 * layers;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// 1x1, every layer the same texel
+// --------------------------------------------------------
+bool MaterialTable::CreateFallbackArray(const uint8_t texel[4], UINT layers, ID3D11Texture2D** texture, ID3D11ShaderResourceView** srv)
+{
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = 1;
+	desc.Height = 1;
+	desc.MipLevels = 1;
+	desc.ArraySize = layers;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	std::vector<D3D11_SUBRESOURCE_DATA> data(layers);
+	for (UINT layer = 0; layer < layers; layer++)
+	{
+		data[layer].pSysMem = texel;
+		data[layer].SysMemPitch = 4;
+	}
+	if (FAILED(device->CreateTexture2D(&desc, &data[0], texture)))
+		return false;
+
+	if (FAILED(device->CreateShaderResourceView(*texture, 0, srv)))
+	{
+		(*texture)->Release();
+		*texture = 0;
+		return false;
+	}
+
+	tableBytes += 4 * layers;
+	return true;
+}
+
+// --------------------------------------------------------
+// Copies the mips source and the array have in common, lined
+// up by size.  Anything that doesn't line up (a different
+// format or shape) is left alone.
+// --------------------------------------------------------
+void MaterialTable::CopyLayer(ID3D11Texture2D* dest, ID3D11ShaderResourceView* source, UINT layer)
+{
+	D3D11_TEXTURE2D_DESC desc;
+	dest->GetDesc(&desc);
+	MaterialTextureDesc sourceDesc = GetDesc(source);
+	if (sourceDesc.Width == 0 || sourceDesc.Format != (uint32_t)desc.Format)
+		return;
+
+	// Skip down whichever side is bigger
+	UINT destMip = 0;
+	UINT sourceMip = 0;
+	while (destMip + 1 < desc.MipLevels && (desc.Width >> destMip) > sourceDesc.Width)
+		destMip++;
+	while (sourceMip + 1 < sourceDesc.MipLevels && (sourceDesc.Width >> sourceMip) > desc.Width)
+		sourceMip++;
+	if (max(desc.Width >> destMip, 1u) != max(sourceDesc.Width >> sourceMip, 1u) ||
+		max(desc.Height >> destMip, 1u) != max(sourceDesc.Height >> sourceMip, 1u))
+		return;
+
+	ID3D11Resource* resource = 0;
+	source->GetResource(&resource);
+	for (; destMip < desc.MipLevels && sourceMip < sourceDesc.MipLevels; destMip++, sourceMip++)
+	{
+		UINT destSubresource = D3D11CalcSubresource(destMip, layer, desc.MipLevels);
+		context->CopySubresourceRegion(dest, destSubresource, 0, 0, 0, resource, sourceMip, 0);
+	}
+	resource->Release();
+}
+
+// --------------------------------------------------------
+// Groups, copies and bakes.  Materials missing a map share
+// a table with the others missing it, and get the fallback.
+// --------------------------------------------------------
+void MaterialTable::Build()
+{
+	ReleaseTables();
+
+	std::vector<MaterialTextureDesc> albedo(materials.size());
+	std::vector<MaterialTextureDesc> normal(materials.size());
+	for (size_t i = 0; i < materials.size(); i++)
+	{
+		albedo[i] = GetDesc(materials[i]->GetMaterialSRV());
+		normal[i] = GetDesc(materials[i]->GetNormalSRV());
+	}
+
+	int tableCount = GroupMaterialTextures(albedo, normal, slots);
+
+	// Layers per table, and a material to take the shape from
+	std::vector<UINT> layers(tableCount, 0);
+	std::vector<Material*> first(tableCount, (Material*)0);
+	for (size_t i = 0; i < materials.size(); i++)
+	{
+		int table = slots[i].Table;
+		layers[table]++;
+		if (!first[table])
+			first[table] = materials[i];
+	}
+
+	tables.resize(tableCount);
+	for (int t = 0; t < tableCount; t++)
+	{
+		Table& table = tables[t];
+		table = {};
+		if (!CreateArray(first[t]->GetMaterialSRV(), layers[t], &table.Albedo, &table.AlbedoSRV))
+			table.AlbedoFallback = CreateFallbackArray(WhiteTexel, layers[t], &table.Albedo, &table.AlbedoSRV);
+		if (!CreateArray(first[t]->GetNormalSRV(), layers[t], &table.Normal, &table.NormalSRV))
+			table.NormalFallback = CreateFallbackArray(FlatNormalTexel, layers[t], &table.Normal, &table.NormalSRV);
+	}
+
+	for (size_t i = 0; i < materials.size(); i++)
+		Refresh(materials[i]);
+
+	// Ids are handed out in the order materials were added,
+	// so keys stay put from one build to the next unless the
+	// grouping changes
+	MaterialIdMap programs;
+	MaterialIdMap samplers;
+	states.assign(materials.size(), MaterialState());
+	for (size_t i = 0; i < materials.size(); i++)
+	{
+		Material* material = materials[i];
+		MaterialState& state = states[i];
+		const Table& table = tables[slots[i].Table];
+
+		state.VertexShader = material->GetVertexShader();
+		state.PixelShader = material->GetPixelShader();
+		state.AlbedoArray = table.AlbedoSRV;
+		state.NormalArray = table.NormalSRV;
+		state.Sampler = material->GetMaterialSampler();
+		state.Layer = (float)slots[i].Layer;
+		state.SpecularPower = material->GetSpecularPower();
+
+		const SimpleSRV* albedoInfo = state.PixelShader->GetShaderResourceViewInfo("MaterialAlbedo");
+		const SimpleSRV* normalInfo = state.PixelShader->GetShaderResourceViewInfo("MaterialNormals");
+		const SimpleSampler* samplerInfo = state.PixelShader->GetSamplerInfo("basicSampler");
+		state.AlbedoSlot = albedoInfo ? (int)albedoInfo->BindIndex : -1;
+		state.NormalSlot = normalInfo ? (int)normalInfo->BindIndex : -1;
+		state.SamplerSlot = samplerInfo ? (int)samplerInfo->BindIndex : -1;
+
+		MaterialKeyParts parts;
+		parts.Program = programs.GetId(state.VertexShader, state.PixelShader);
+		parts.Table = slots[i].Table;
+		parts.Sampler = samplers.GetId(state.Sampler);
+		parts.Layer = slots[i].Layer;
+		state.SortKey = MakeMaterialKey(parts);
+
+		material->SetState(&state);
+	}
+
+	// The old arrays are gone, whatever was bound
+	InvalidateBindings();
+}
+
+void MaterialTable::Refresh(Material* material)
+{
+	for (size_t i = 0; i < materials.size() && i < slots.size(); i++)
+	{
+		if (materials[i] != material)
+			continue;
+
+		const Table& table = tables[slots[i].Table];
+		if (table.Albedo && !table.AlbedoFallback)
+			CopyLayer(table.Albedo, material->GetMaterialSRV(), slots[i].Layer);
+		if (table.Normal && !table.NormalFallback)
+			CopyLayer(table.Normal, material->GetNormalSRV(), slots[i].Layer);
+	}
+}
+
+bool MaterialTable::Bind(const MaterialState* state)
+{
+	if (state->AlbedoSlot >= 0 && bindings.Bind(CommandStagePixel, state->AlbedoSlot, state->AlbedoArray))
+		context->PSSetShaderResource(state->AlbedoSlot, state->AlbedoArray);
+	if (state->NormalSlot >= 0 && bindings.Bind(CommandStagePixel, state->NormalSlot, state->NormalArray))
+		context->PSSetShaderResource(state->NormalSlot, state->NormalArray);
+	if (state->SamplerSlot >= 0 && bindings.BindSampler(CommandStagePixel, state->SamplerSlot, state->Sampler))
+		context->PSSetSampler(state->SamplerSlot, state->Sampler);
+
+	if (state == boundState)
+		return false;
+	boundState = state;
+	return true;
+}
+
+void MaterialTable::InvalidateBindings()
+{
+	bindings.Invalidate();
+	boundState = 0;
+}
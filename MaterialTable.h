@@ -0,0 +1,105 @@
+#pragma once
+
+#include <d3d11.h>
+#include <vector>
+
+#include "SimpleShader.h"
+#include "RenderContext.h"
+#include "Material.h"
+#include "MaterialKeys.h"
+
+// --------------------------------------------------------
+// A material baked for drawing.  Never changed once baked -
+// rebuilding the table bakes new ones.
+// --------------------------------------------------------
+struct MaterialState {
+	uint32_t SortKey;
+	SimpleVertexShader* VertexShader;
+	SimplePixelShader* PixelShader;
+
+	// The table's arrays, and which layer of them is ours
+	ID3D11ShaderResourceView* AlbedoArray;
+	ID3D11ShaderResourceView* NormalArray;
+	ID3D11SamplerState* Sampler;
+	float Layer;
+	float SpecularPower;
+
+	// Looked up in the pixel shader when baked, so binding
+	// doesn't go through the names
+	int AlbedoSlot;
+	int NormalSlot;
+	int SamplerSlot;
+};
+
+// --------------------------------------------------------
+// The lit pass's materials.  Their albedo and normal maps
+// are copied into texture arrays, one pair of arrays per
+// group of materials whose textures match (MaterialKeys),
+// so moving between materials in a group only changes the
+// layer constant.  Bind skips any slot already holding what
+// the material needs.
+//
+// The arrays are copies - the materials' own textures stay
+// where they are.  When streaming replaces one, Refresh
+// copies it over its own layer; only Build regroups.  A map
+// a whole group is missing (a material with no normal map)
+// is a 1x1 array instead: white albedo, flat normals.
+// --------------------------------------------------------
+class MaterialTable {
+public:
+	MaterialTable(ID3D11Device* device, RenderContext* context);
+	~MaterialTable();
+
+	void Add(Material* material);
+
+	// Regroups the materials' current textures, copies them
+	// into fresh arrays and bakes every material's state
+	void Build();
+
+	// Copies material's current textures over its layers.
+	// Whichever of their mips the arrays have are copied, so a
+	// texture streamed down to fewer mips only updates those.
+	void Refresh(Material* material);
+
+	// Binds state's arrays and sampler to its pixel shader,
+	// where they aren't already.  True if state isn't the one
+	// bound last, so its constants need setting.
+	bool Bind(const MaterialState* state);
+
+	// Something else used the pixel shader's slots
+	void InvalidateBindings();
+
+	int GetTableCount() { return (int)tables.size(); }
+	long long GetTableBytes() { return tableBytes; }
+
+	// Since the last ResetStats
+	const BindingStats& GetBindingStats() { return bindings.GetStats(); }
+	void ResetStats() { bindings.ResetStats(); }
+
+private:
+	struct Table {
+		ID3D11Texture2D* Albedo;
+		ID3D11Texture2D* Normal;
+		ID3D11ShaderResourceView* AlbedoSRV;
+		ID3D11ShaderResourceView* NormalSRV;
+		bool AlbedoFallback;	// 1x1 stand-ins, nothing to copy
+		bool NormalFallback;
+	};
+
+	ID3D11Device* device;
+	RenderContext* context;
+	std::vector<Material*> materials;
+	std::vector<MaterialState> states;		// One per material
+	std::vector<MaterialTextureSlot> slots;	// One per material
+	std::vector<Table> tables;
+	long long tableBytes;
+
+	BindingCache bindings;
+	const MaterialState* boundState;
+
+	void ReleaseTables();
+	bool CreateArray(ID3D11ShaderResourceView* first, UINT layers, ID3D11Texture2D** texture, ID3D11ShaderResourceView** srv);
+	bool CreateFallbackArray(const uint8_t texel[4], UINT layers, ID3D11Texture2D** texture, ID3D11ShaderResourceView** srv);
+	void CopyLayer(ID3D11Texture2D* dest, ID3D11ShaderResourceView* source, UINT layer);
+	static MaterialTextureDesc GetDesc(ID3D11ShaderResourceView* srv);
+};
@@ -1,16 +1,31 @@
 #include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "PositionStream.h"
 #include <vector>
 #include <fstream>
 #include <DirectXMath.h>
 
 using namespace DirectX;
 
-Mesh::Mesh(Vertex* vertices, int numVertex, unsigned int* indices, int numIndex, ID3D11Device * device) {
-	CreateBuffers(vertices, numVertex, indices, numIndex, device);
+// How many different vertices the indices use
+static int CountUsed(const unsigned int* indices, int indexCount, int vertexCount) {
+	std::vector<bool> used(vertexCount, false);
+	int count = 0;
+	for (int i = 0; i < indexCount; i++) {
+		if (!used[indices[i]])
+			count++;
+		used[indices[i]] = true;
+	}
+	return count;
+}
+
+Mesh::Mesh(Vertex* vertices, int numVertex, unsigned int* indices, int numIndex, ID3D11Device * device, bool packVertices) {
+	CreateBuffers(vertices, numVertex, indices, numIndex, device, false, packVertices);
 
 }
 
-Mesh::Mesh(const char * objFile, ID3D11Device * device) {
+Mesh::Mesh(const char * objFile, ID3D11Device * device, bool packVertices) {
 	// File input object
 	std::ifstream obj(objFile);
 
@@ -166,9 +181,16 @@ Mesh::Mesh(const char * objFile, ID3D11Device * device) {
 		}
 	}
 
-	// Close the file and create the actual buffers
+	// Close the file
 	obj.close();
-	CreateBuffers(&verts[0], vertCounter, &indices[0], vertCounter, device);
+
+	// Every face got its own vertices above - share the ones
+	// that are the same, so the simplifier can see which
+	// triangles are connected
+	int uniqueVertices = WeldVertices(&verts[0].Position.x, sizeof(Vertex) / sizeof(float), vertCounter, 8, &indices[0], vertCounter);
+
+	// Create the actual buffers
+	CreateBuffers(&verts[0], uniqueVertices, &indices[0], vertCounter, device, true, packVertices);
 }
 
 
@@ -176,6 +198,8 @@ Mesh::Mesh(const char * objFile, ID3D11Device * device) {
 Mesh::~Mesh() {
 	vertexBufferMesh->Release(); vertexBufferMesh = 0;
 	indexBufferMesh->Release(); indexBufferMesh = 0;
+	positionBufferMesh->Release(); positionBufferMesh = 0;
+	positionIndexBufferMesh->Release(); positionIndexBufferMesh = 0;
 }
 
 ID3D11Buffer * Mesh::GetVertexBuffer() {
@@ -190,13 +214,53 @@ int Mesh::GetIndexCount() {
 	return indices1;
 }
 
-void Mesh::CreateBuffers(Vertex* vertices, int numVertex, unsigned int* indices, int numIndex, ID3D11Device * device) {
+void Mesh::CreateBuffers(Vertex* vertices, int numVertex, unsigned int* indices, int numIndex, ID3D11Device * device, bool optimize, bool packVertices) {
 
 	CalculateTangents(vertices, numVertex, indices, numIndex);
 
+	// Bounding sphere around the origin, used for screen size estimates
+	boundingRadius = 0;
+	for (int i = 0; i < numVertex; i++) {
+		float lengthSq =
+			vertices[i].Position.x * vertices[i].Position.x +
+			vertices[i].Position.y * vertices[i].Position.y +
+			vertices[i].Position.z * vertices[i].Position.z;
+		if (lengthSq > boundingRadius)
+			boundingRadius = lengthSq;
+	}
+	boundingRadius = sqrtf(boundingRadius);
+
+	// Full mesh first, then any simpler levels after it in the
+	// same index buffer
+	std::vector<unsigned int> allIndices(indices, indices + numIndex);
+	MeshLOD full = { 0, numIndex, 0.0f, 0, 0 };
+	lods.clear();
+	lods.push_back(full);
+	if (optimize) {
+		BuildLODs(vertices, numVertex, allIndices);
+		OptimizeOrder(vertices, numVertex, allIndices);
+	}
+	cacheStats = AnalyzeVertexCache(&allIndices[0], numIndex, numVertex);
+	if (!optimize)
+		cacheStatsBefore = cacheStats;
+	for (MeshLOD& lod : lods)
+		lod.VertexCount = CountUsed(&allIndices[lod.StartIndex], lod.IndexCount, numVertex);
+
+	CreatePositionBuffers(vertices, numVertex, allIndices, device);
+
+	// Packed vertices are made last, from the finished ones
+	std::vector<PackedVertex> packedVertices;
+	packed = packVertices;
+	vertexCount = numVertex;
+	packingStats = {};
+	if (packed) {
+		packedVertices.resize(numVertex);
+		PackVertices(&vertices[0].Position.x, sizeof(Vertex) / sizeof(float), numVertex, &packedVertices[0], &packingStats);
+	}
+
 	D3D11_BUFFER_DESC vbd;
 	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = sizeof(Vertex) * numVertex;       // 3 = number of vertices in the buffer
+	vbd.ByteWidth = GetVertexStride() * numVertex;
 	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER; // Tells DirectX this is a vertex buffer
 	vbd.CPUAccessFlags = 0;
 	vbd.MiscFlags = 0;
@@ -205,7 +269,7 @@ void Mesh::CreateBuffers(Vertex* vertices, int numVertex, unsigned int* indices,
 	// Create the proper struct to hold the initial vertex data
 	// - This is how we put the initial data into the buffer
 	D3D11_SUBRESOURCE_DATA initialVertexData;
-	initialVertexData.pSysMem = vertices;
+	initialVertexData.pSysMem = packed ? (void*)&packedVertices[0] : (void*)vertices;
 
 	// Actually create the buffer with the initial data
 	// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
@@ -218,7 +282,7 @@ void Mesh::CreateBuffers(Vertex* vertices, int numVertex, unsigned int* indices,
 	//    it to create the buffer.  The description is then useless.
 	D3D11_BUFFER_DESC ibd;
 	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(unsigned int) * numIndex;         // 3 = number of indices in the buffer
+	ibd.ByteWidth = sizeof(unsigned int) * (UINT)allIndices.size();
 	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER; // Tells DirectX this is an index buffer
 	ibd.CPUAccessFlags = 0;
 	ibd.MiscFlags = 0;
@@ -227,7 +291,7 @@ void Mesh::CreateBuffers(Vertex* vertices, int numVertex, unsigned int* indices,
 	// Create the proper struct to hold the initial index data
 	// - This is how we put the initial data into the buffer
 	D3D11_SUBRESOURCE_DATA initialIndexData;
-	initialIndexData.pSysMem = indices;
+	initialIndexData.pSysMem = &allIndices[0];
 
 	// Actually create the buffer with the initial data
 	// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
@@ -243,7 +307,7 @@ void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices,
 	}
 
 	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numVerts;) {
+	for (int i = 0; i < numIndices;) {
 		// Grab indices and vertices of first triangle
 		unsigned int i1 = indices[i++];
 		unsigned int i2 = indices[i++];
@@ -268,8 +332,12 @@ void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices,
 		float s2 = v3->UV.x - v1->UV.x;
 		float t2 = v3->UV.y - v1->UV.y;
 
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
+		// Create vectors for tangent calculation (nothing to go
+		// on if the UVs don't span an area)
+		float area = s1 * t2 - s2 * t1;
+		if (area == 0)
+			continue;
+		float r = 1.0f / area;
 
 		float tx = (t2 * x1 - t1 * x2) * r;
 		float ty = (t2 * y1 - t1 * y2) * r;
@@ -302,4 +370,93 @@ void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices,
 		// Store the tangent
 		XMStoreFloat3(&verts[i].Tangent, tangent);
 	}
-}
\ No newline at end of file
+}
+
+// --------------------------------------------------------
+// Each level aims for half the triangles of the one before,
+// and the chain stops once a level can't get much simpler
+// without moving the surface too far
+// --------------------------------------------------------
+void Mesh::BuildLODs(Vertex* vertices, int numVertex, std::vector<unsigned int>& indices) {
+	const int maxLODs = 4;
+	const float maxError = boundingRadius * 0.05f;
+
+	std::vector<unsigned int> source(indices);
+	std::vector<unsigned int> simplified;
+	while ((int)lods.size() < maxLODs) {
+		MeshSimplifyStats stats;
+		SimplifyMesh(&vertices[0].Position.x, sizeof(Vertex) / sizeof(float), numVertex,
+			&source[0], (int)source.size(), (int)source.size() / 2, maxError, simplified, &stats);
+
+		// Not worth another level
+		if (simplified.empty() || simplified.size() > source.size() * 9 / 10)
+			break;
+
+		// Each level is simplified from the last, so its distance
+		// from the full mesh is at most the two added together
+		MeshLOD lod = { (int)indices.size(), (int)simplified.size(), lods.back().Error + stats.Error, 0, 0 };
+		lods.push_back(lod);
+		indices.insert(indices.end(), simplified.begin(), simplified.end());
+		source.swap(simplified);
+	}
+}
+
+int Mesh::SelectLOD(float projectedSize, float maxPixelError) {
+	if (boundingRadius <= 0)
+		return 0;
+
+	// projectedSize is across the whole bounding sphere
+	float pixelsPerUnit = projectedSize * 0.5f / boundingRadius;
+	int lod = 0;
+	while (lod + 1 < (int)lods.size() && lods[lod + 1].Error * pixelsPerUnit <= maxPixelError)
+		lod++;
+	return lod;
+}
+
+// --------------------------------------------------------
+// Reorders each level's triangles for the vertex cache and
+// overdraw, then the vertices for fetching in order.  Only
+// the order changes - the levels keep their ranges.
+// --------------------------------------------------------
+void Mesh::OptimizeOrder(Vertex* vertices, int& numVertex, std::vector<unsigned int>& indices) {
+	cacheStatsBefore = AnalyzeVertexCache(&indices[0], lods[0].IndexCount, numVertex);
+
+	for (const MeshLOD& lod : lods) {
+		OptimizeVertexCache(&indices[lod.StartIndex], lod.IndexCount, numVertex);
+		OptimizeOverdraw(&indices[lod.StartIndex], lod.IndexCount, &vertices[0].Position.x, sizeof(Vertex) / sizeof(float), numVertex);
+	}
+
+	// Full detail goes first in the index buffer, so its
+	// vertices end up first too
+	numVertex = OptimizeVertexFetch(&vertices[0].Position.x, sizeof(Vertex) / sizeof(float), numVertex, &indices[0], (int)indices.size());
+}
+
+// --------------------------------------------------------
+// The position stream for depth only passes.  Triangles stay
+// in the same order, so the levels keep their ranges and the
+// vertex cache order still holds - better, even, now that
+// seam vertices are one position.
+// --------------------------------------------------------
+void Mesh::CreatePositionBuffers(Vertex* vertices, int numVertex, const std::vector<unsigned int>& indices, ID3D11Device* device) {
+	int indexCount = (int)indices.size();
+	positionCount = BuildPositionStream(&vertices[0].Position.x, sizeof(Vertex) / sizeof(float), numVertex, &indices[0], indexCount, positions, positionIndices);
+
+	for (MeshLOD& lod : lods)
+		lod.PositionCount = CountUsed(&positionIndices[lod.StartIndex], lod.IndexCount, positionCount);
+
+	D3D11_BUFFER_DESC vbd = {};
+	vbd.Usage = D3D11_USAGE_IMMUTABLE;
+	vbd.ByteWidth = GetPositionStride() * positionCount;
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	D3D11_SUBRESOURCE_DATA initialVertexData = {};
+	initialVertexData.pSysMem = &positions[0];
+	device->CreateBuffer(&vbd, &initialVertexData, &positionBufferMesh);
+
+	D3D11_BUFFER_DESC ibd = {};
+	ibd.Usage = D3D11_USAGE_IMMUTABLE;
+	ibd.ByteWidth = sizeof(unsigned int) * indexCount;
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	D3D11_SUBRESOURCE_DATA initialIndexData = {};
+	initialIndexData.pSysMem = &positionIndices[0];
+	device->CreateBuffer(&ibd, &initialIndexData, &positionIndexBufferMesh);
+}
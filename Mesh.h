@@ -1,27 +1,95 @@
 #pragma once
 
 #include <d3d11.h>
+#include <vector>
+#include "MeshOptimizer.h"
 #include "Vertex.h"
+#include "VertexPacking.h"
+
+// One level of detail, a range of the mesh's index buffer
+struct MeshLOD {
+	int StartIndex;
+	int IndexCount;
+	float Error;	// Farthest the surface moved from the full mesh, in mesh units
+	int VertexCount;	// Vertices the level uses
+	int PositionCount;	// Positions it uses in the position stream
+};
 
 class Mesh {
 public:
-	Mesh(Vertex* vertices, int numVertex, unsigned int* indices, int numIndex, ID3D11Device *device);
-	Mesh(const char* objFile, ID3D11Device *device);
+	// With packVertices the vertex buffer holds PackedVertex
+	// instead of Vertex (see GetVertexStride)
+	Mesh(Vertex* vertices, int numVertex, unsigned int* indices, int numIndex, ID3D11Device *device, bool packVertices = false);
+	Mesh(const char* objFile, ID3D11Device *device, bool packVertices = false);
 	~Mesh();
 
 	ID3D11Buffer *GetVertexBuffer();
 	ID3D11Buffer *GetIndexBuffer();
-	int GetIndexCount();
+
+	// Just the positions, as float3, each one only once even
+	// where seams split it into several vertices.  For passes
+	// that only write depth.  The index buffer is its own but
+	// has the same levels at the same ranges.
+	ID3D11Buffer *GetPositionBuffer() { return positionBufferMesh; }
+	ID3D11Buffer *GetPositionIndexBuffer() { return positionIndexBufferMesh; }
+	UINT GetPositionStride() { return sizeof(float) * 3; }
+	int GetPositionCount() { return positionCount; }
+
+	// CPU copies of the position stream, for estimates on the
+	// software rasterizer
+	const std::vector<float>& GetPositions() { return positions; }
+	const std::vector<unsigned int>& GetPositionIndices() { return positionIndices; }
+	int GetIndexCount();	// Full detail
+	float GetBoundingRadius() { return boundingRadius; }
+
+	bool IsPacked() { return packed; }
+	UINT GetVertexStride() { return packed ? sizeof(PackedVertex) : sizeof(Vertex); }
+	int GetVertexCount() { return vertexCount; }
+
+	// How far packing moved the normals, tangents and UVs
+	// (all zero when the mesh isn't packed)
+	const VertexPackingStats& GetPackingStats() { return packingStats; }
+
+	// Level 0 is the full mesh.  Meshes loaded from a file get
+	// up to three simplified levels after it.
+	int GetLODCount() { return (int)lods.size(); }
+	const MeshLOD& GetLOD(int lod) { return lods[lod]; }
+
+	// Simplest level that stays within maxPixelError of the full
+	// mesh when it covers projectedSize pixels on screen (see
+	// TextureStreamer::ProjectedSize)
+	int SelectLOD(float projectedSize, float maxPixelError = 1.0f);
+
+	// Vertex cache efficiency of the full detail level, before
+	// and after loading reordered it (the same for meshes that
+	// weren't loaded from a file)
+	VertexCacheStats GetCacheStatsBefore() { return cacheStatsBefore; }
+	VertexCacheStats GetCacheStats() { return cacheStats; }
 
 
 private:
 
 	ID3D11Buffer *vertexBufferMesh;
 	ID3D11Buffer *indexBufferMesh;
+	ID3D11Buffer *positionBufferMesh;
+	ID3D11Buffer *positionIndexBufferMesh;
+	int positionCount;
+	std::vector<float> positions;
+	std::vector<unsigned int> positionIndices;
 	//ID3D11Device *deviceMesh;
 	int indices1;
+	float boundingRadius;	// Around the mesh's origin
+	bool packed;
+	int vertexCount;
+	VertexPackingStats packingStats;
+	std::vector<MeshLOD> lods;
+	VertexCacheStats cacheStatsBefore;
+	VertexCacheStats cacheStats;
 
-	void CreateBuffers(Vertex *vertices, int numVertex, unsigned int *indices, int numIndex, ID3D11Device *device);
+	void CreateBuffers(Vertex *vertices, int numVertex, unsigned int *indices, int numIndex, ID3D11Device *device, bool optimize, bool packVertices);
+	void BuildLODs(Vertex* vertices, int numVertex, std::vector<unsigned int>& indices);
+	void OptimizeOrder(Vertex* vertices, int& numVertex, std::vector<unsigned int>& indices);
+	void CreatePositionBuffers(Vertex* vertices, int numVertex, const std::vector<unsigned int>& indices, ID3D11Device* device);
 	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
 };
 
@@ -0,0 +1,329 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, int indexCount, int vertexCount, int cacheSize)
+{
+	VertexCacheStats stats = {};
+	if (indexCount < 3)
+		return stats;
+
+	// When each vertex went into the FIFO, by miss count
+	std::vector<int> insertedAt(vertexCount, -cacheSize - 1);
+	int misses = 0;
+	for (int i = 0; i < indexCount; i++)
+	{
+		unsigned int v = indices[i];
+		if (misses - insertedAt[v] > cacheSize)
+			insertedAt[v] = misses++;
+	}
+
+	int used = 0;
+	std::vector<bool> seen(vertexCount, false);
+	for (int i = 0; i < indexCount; i++)
+	{
+		if (!seen[indices[i]])
+			used++;
+		seen[indices[i]] = true;
+	}
+
+	stats.ACMR = misses / (float)(indexCount / 3);
+	stats.ATVR = misses / (float)used;
+	return stats;
+}
+
+// --------------------------------------------------------
+// Vertex cache order
+//
+// Each vertex gets a score from where it sits in a simulated
+// LRU cache and how few triangles it has left to go; the
+// next triangle is whichever touching the cache scores best.
+// Constants are the ones from Forsyth's write-up.
+// --------------------------------------------------------
+
+namespace {
+
+const int ScoreCacheSize = 32;
+const float CacheDecayPower = 1.5f;
+const float LastTriangleScore = 0.75f;
+const float ValenceBoostScale = 2.0f;
+const float ValenceBoostPower = 0.5f;
+
+float VertexScore(int cachePosition, int remainingTriangles)
+{
+	// Nothing left to draw with it
+	if (remainingTriangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		// The three vertices of the triangle just drawn score the
+		// same, so there's no preference for which way to go next
+		if (cachePosition < 3)
+			score = LastTriangleScore;
+		else
+			score = powf(1.0f - (cachePosition - 3) * (1.0f / (ScoreCacheSize - 3)), CacheDecayPower);
+	}
+
+	// Finish off vertices with few triangles left first, so they
+	// don't get stranded
+	score += ValenceBoostScale * powf((float)remainingTriangles, -ValenceBoostPower);
+	return score;
+}
+
+}
+
+void OptimizeVertexCache(unsigned int* indices, int indexCount, int vertexCount)
+{
+	int triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Triangles around each vertex
+	std::vector<int> remaining(vertexCount, 0);
+	for (int i = 0; i < indexCount; i++)
+		remaining[indices[i]]++;
+
+	std::vector<int> firstTriangle(vertexCount + 1, 0);
+	for (int v = 0; v < vertexCount; v++)
+		firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+	std::vector<int> vertexTriangles(indexCount);
+	std::vector<int> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+	for (int i = 0; i < indexCount; i++)
+		vertexTriangles[fill[indices[i]]++] = i / 3;
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (int v = 0; v < vertexCount; v++)
+		vertexScore[v] = VertexScore(-1, remaining[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	for (int t = 0; t < triangleCount; t++)
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> output;
+	output.reserve(indexCount);
+
+	// Most recent first, three spare slots for the incoming triangle
+	int cache[ScoreCacheSize + 3];
+	int cacheCount = 0;
+
+	int best = (int)(std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin());
+	int nextUnemitted = 0;
+	while (best >= 0)
+	{
+		emitted[best] = true;
+		const unsigned int* corners = indices + best * 3;
+		output.insert(output.end(), corners, corners + 3);
+
+		// Move the triangle's vertices to the front of the cache
+		int newCache[ScoreCacheSize + 3];
+		int newCount = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			newCache[newCount++] = corners[c];
+			remaining[corners[c]]--;
+
+			// Take the triangle out of the vertex's list
+			int* list = &vertexTriangles[firstTriangle[corners[c]]];
+			int count = remaining[corners[c]] + 1;
+			for (int i = 0; i < count; i++)
+			{
+				if (list[i] == best)
+				{
+					list[i] = list[count - 1];
+					break;
+				}
+			}
+		}
+		for (int i = 0; i < cacheCount; i++)
+		{
+			int v = cache[i];
+			if (v != (int)corners[0] && v != (int)corners[1] && v != (int)corners[2])
+				newCache[newCount++] = v;
+		}
+
+		// Rescore everything that was or is in the cache, and the
+		// triangles around it; the best of those goes next
+		best = -1;
+		float bestScore = -1.0f;
+		for (int i = 0; i < newCount; i++)
+		{
+			int v = newCache[i];
+			cachePosition[v] = i < ScoreCacheSize ? i : -1;
+			float score = VertexScore(cachePosition[v], remaining[v]);
+			float change = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			for (int j = 0; j < remaining[v]; j++)
+			{
+				int t = vertexTriangles[firstTriangle[v] + j];
+				triangleScore[t] += change;
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+
+		cacheCount = std::min(newCount, ScoreCacheSize);
+		memcpy(cache, newCache, cacheCount * sizeof(int));
+
+		// Nothing in the cache has triangles left - carry on
+		// from the next one not drawn yet
+		if (best < 0)
+		{
+			while (nextUnemitted < triangleCount && emitted[nextUnemitted])
+				nextUnemitted++;
+			if (nextUnemitted < triangleCount)
+				best = nextUnemitted;
+		}
+	}
+
+	memcpy(indices, output.data(), indexCount * sizeof(unsigned int));
+}
+
+// --------------------------------------------------------
+// Overdraw order
+// --------------------------------------------------------
+void OptimizeOverdraw(unsigned int* indices, int indexCount, const float* positions, int vertexStride, int vertexCount)
+{
+	int triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Clusters start wherever the cache order missed on all
+	// three vertices - it was starting over there anyway, so
+	// moving the clusters around costs next to nothing
+	const int cacheSize = 16;
+	std::vector<int> insertedAt(vertexCount, -cacheSize - 1);
+	std::vector<int> clusterStart;
+	int misses = 0;
+	for (int t = 0; t < triangleCount; t++)
+	{
+		int triangleMisses = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = indices[t * 3 + c];
+			if (misses - insertedAt[v] > cacheSize)
+			{
+				insertedAt[v] = misses++;
+				triangleMisses++;
+			}
+		}
+		if (t == 0 || triangleMisses == 3)
+			clusterStart.push_back(t);
+	}
+	clusterStart.push_back(triangleCount);
+
+	auto position = [=](unsigned int v) { return positions + v * vertexStride; };
+
+	// Area weighted centroid of the whole mesh
+	double meshCenter[3] = { 0, 0, 0 };
+	double meshArea = 0;
+	struct Cluster {
+		int Start;
+		int End;
+		double Center[3];
+		double Normal[3];
+		float Sort;
+	};
+	std::vector<Cluster> clusters(clusterStart.size() - 1);
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		Cluster& cluster = clusters[c];
+		cluster = {};
+		cluster.Start = clusterStart[c];
+		cluster.End = clusterStart[c + 1];
+
+		double area = 0;
+		for (int t = cluster.Start; t < cluster.End; t++)
+		{
+			const float* a = position(indices[t * 3]);
+			const float* b = position(indices[t * 3 + 1]);
+			const float* d = position(indices[t * 3 + 2]);
+			double e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			double e2[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+			double n[3] = {
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0] };
+			double triangleArea = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) * 0.5;
+
+			for (int k = 0; k < 3; k++)
+			{
+				cluster.Normal[k] += n[k];
+				cluster.Center[k] += (a[k] + b[k] + d[k]) / 3.0 * triangleArea;
+			}
+			area += triangleArea;
+		}
+
+		for (int k = 0; k < 3; k++)
+			meshCenter[k] += cluster.Center[k];
+		meshArea += area;
+		if (area > 0)
+		{
+			for (int k = 0; k < 3; k++)
+				cluster.Center[k] /= area;
+		}
+	}
+	if (meshArea > 0)
+	{
+		for (int k = 0; k < 3; k++)
+			meshCenter[k] /= meshArea;
+	}
+
+	// How far the cluster faces away from the middle.  Front
+	// faces pointing outward are the ones most likely to cover
+	// something else, so they go first.
+	for (Cluster& cluster : clusters)
+	{
+		double length = sqrt(cluster.Normal[0] * cluster.Normal[0] + cluster.Normal[1] * cluster.Normal[1] + cluster.Normal[2] * cluster.Normal[2]);
+		double dot = 0;
+		for (int k = 0; k < 3; k++)
+			dot += (cluster.Center[k] - meshCenter[k]) * cluster.Normal[k];
+		cluster.Sort = length > 0 ? (float)(dot / length) : 0.0f;
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.Sort > b.Sort; });
+
+	std::vector<unsigned int> output;
+	output.reserve(indexCount);
+	for (const Cluster& cluster : clusters)
+		output.insert(output.end(), indices + cluster.Start * 3, indices + cluster.End * 3);
+	memcpy(indices, output.data(), indexCount * sizeof(unsigned int));
+}
+
+// --------------------------------------------------------
+// Vertex fetch order
+// --------------------------------------------------------
+int OptimizeVertexFetch(float* vertices, int vertexStride, int vertexCount, unsigned int* indices, int indexCount)
+{
+	const unsigned int unused = ~0u;
+	std::vector<unsigned int> remap(vertexCount, unused);
+	unsigned int next = 0;
+	for (int i = 0; i < indexCount; i++)
+	{
+		unsigned int& to = remap[indices[i]];
+		if (to == unused)
+			to = next++;
+		indices[i] = to;
+	}
+	int used = (int)next;
+
+	for (int v = 0; v < vertexCount; v++)
+	{
+		if (remap[v] == unused)
+			remap[v] = next++;
+	}
+
+	std::vector<float> source(vertices, vertices + vertexCount * vertexStride);
+	for (int v = 0; v < vertexCount; v++)
+		memcpy(vertices + remap[v] * vertexStride, &source[v * vertexStride], vertexStride * sizeof(float));
+	return used;
+}
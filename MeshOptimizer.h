@@ -0,0 +1,39 @@
+#pragma once
+
+// --------------------------------------------------------
+// Index and vertex reordering for faster drawing
+//
+// Run on a mesh once after loading, in this order:
+//  - OptimizeVertexCache reorders triangles so vertices are
+//    reused while they're still in the post transform cache
+//    (Tom Forsyth's linear-speed algorithm)
+//  - OptimizeOverdraw then breaks that order into the runs
+//    the cache order already starts fresh at, and draws the
+//    runs facing out of the mesh first, so they tend to hide
+//    the rest instead of being drawn over
+//  - OptimizeVertexFetch last, renumbering vertices in the
+//    order the index buffer first uses them, so the vertex
+//    buffer is read front to back
+//
+// None of them change what gets drawn, only the order.
+// --------------------------------------------------------
+
+struct VertexCacheStats {
+	float ACMR;		// Vertices transformed per triangle (0.5 is ideal on big meshes, 3 is worst)
+	float ATVR;		// Vertices transformed per vertex (1 is ideal)
+};
+
+// FIFO cache of cacheSize, which is about what current
+// hardware behaves like
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, int indexCount, int vertexCount, int cacheSize = 16);
+
+void OptimizeVertexCache(unsigned int* indices, int indexCount, int vertexCount);
+
+// positions is the first float of the first vertex,
+// vertexStride in floats.  Expects the cache optimized order.
+void OptimizeOverdraw(unsigned int* indices, int indexCount, const float* positions, int vertexStride, int vertexCount);
+
+// Reorders vertices (vertexStride floats each) in place and
+// remaps indices.  Vertices no index uses move to the end.
+// Returns how many are used.
+int OptimizeVertexFetch(float* vertices, int vertexStride, int vertexCount, unsigned int* indices, int indexCount);
@@ -0,0 +1,351 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <unordered_map>
+
+namespace {
+
+// Symmetric 4x4 matrix of the summed plane equations, plus the
+// total area of the planes so errors come out as squared
+// distance no matter how many planes went in
+struct Quadric {
+	double A00, A01, A02, A03;
+	double A11, A12, A13;
+	double A22, A23;
+	double A33;
+	double Weight;
+
+	void AddPlane(const double n[3], double d, double weight)
+	{
+		A00 += weight * n[0] * n[0]; A01 += weight * n[0] * n[1]; A02 += weight * n[0] * n[2]; A03 += weight * n[0] * d;
+		A11 += weight * n[1] * n[1]; A12 += weight * n[1] * n[2]; A13 += weight * n[1] * d;
+		A22 += weight * n[2] * n[2]; A23 += weight * n[2] * d;
+		A33 += weight * d * d;
+		Weight += weight;
+	}
+
+	void Add(const Quadric& q)
+	{
+		A00 += q.A00; A01 += q.A01; A02 += q.A02; A03 += q.A03;
+		A11 += q.A11; A12 += q.A12; A13 += q.A13;
+		A22 += q.A22; A23 += q.A23;
+		A33 += q.A33;
+		Weight += q.Weight;
+	}
+
+	double Error(const float p[3]) const
+	{
+		double x = p[0], y = p[1], z = p[2];
+		double e =
+			A00 * x * x + 2 * A01 * x * y + 2 * A02 * x * z + 2 * A03 * x +
+			A11 * y * y + 2 * A12 * y * z + 2 * A13 * y +
+			A22 * z * z + 2 * A23 * z +
+			A33;
+		return Weight > 0 ? fabs(e) / Weight : 0;
+	}
+};
+
+struct Collapse {
+	unsigned int From;
+	unsigned int To;
+	double Cost;
+};
+
+void TriangleNormal(const float* a, const float* b, const float* c, double n[3])
+{
+	double e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	double e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+	n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+	n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+// Sorts vertex numbers so identical keys end up together
+void SortByKey(const float* vertices, int vertexStride, int vertexCount, int keyFloats, std::vector<unsigned int>& order)
+{
+	order.resize(vertexCount);
+	for (int i = 0; i < vertexCount; i++)
+		order[i] = i;
+
+	size_t keySize = keyFloats * sizeof(float);
+	std::sort(order.begin(), order.end(), [=](unsigned int a, unsigned int b) {
+		int compare = memcmp(vertices + a * vertexStride, vertices + b * vertexStride, keySize);
+		return compare != 0 ? compare < 0 : a < b;
+	});
+}
+
+}
+
+int WeldVertices(float* vertices, int vertexStride, int vertexCount, int compareFloats, unsigned int* indices, int indexCount)
+{
+	std::vector<unsigned int> order;
+	SortByKey(vertices, vertexStride, vertexCount, compareFloats, order);
+
+	// Every vertex points at the first of its duplicates
+	std::vector<unsigned int> first(vertexCount);
+	size_t keySize = compareFloats * sizeof(float);
+	for (int i = 0; i < vertexCount; i++)
+	{
+		bool same = i > 0 && memcmp(vertices + order[i] * vertexStride, vertices + order[i - 1] * vertexStride, keySize) == 0;
+		first[order[i]] = same ? first[order[i - 1]] : order[i];
+	}
+
+	// Compact, keeping the original order of what's left
+	std::vector<unsigned int> remap(vertexCount);
+	int count = 0;
+	for (int i = 0; i < vertexCount; i++)
+	{
+		if (first[i] != (unsigned int)i)
+			continue;
+		if (count != i)
+			memmove(vertices + count * vertexStride, vertices + i * vertexStride, vertexStride * sizeof(float));
+		remap[i] = count++;
+	}
+
+	for (int i = 0; i < indexCount; i++)
+		indices[i] = remap[first[indices[i]]];
+	return count;
+}
+
+void SimplifyMesh(
+	const float* vertices, int vertexStride, int vertexCount,
+	const unsigned int* indices, int indexCount,
+	int targetIndexCount, float maxError,
+	std::vector<unsigned int>& result,
+	MeshSimplifyStats* stats)
+{
+	MeshSimplifyStats localStats = {};
+	localStats.SourceTriangles = indexCount / 3;
+
+	auto position = [=](unsigned int v) { return vertices + v * vertexStride; };
+
+	// Vertices that share a position share a quadric, keyed by
+	// the lowest numbered one (the "group")
+	std::vector<unsigned int> order;
+	SortByKey(vertices, vertexStride, vertexCount, 3, order);
+	std::vector<unsigned int> group(vertexCount);
+	for (int i = 0; i < vertexCount; i++)
+	{
+		bool same = i > 0 && memcmp(position(order[i]), position(order[i - 1]), 3 * sizeof(float)) == 0;
+		group[order[i]] = same ? group[order[i - 1]] : order[i];
+	}
+
+	result.assign(indices, indices + indexCount);
+
+	// Borders are edges only one triangle uses
+	std::vector<bool> locked(vertexCount, false);
+	std::unordered_map<uint64_t, int> edgeUse;
+	for (size_t t = 0; t < result.size(); t += 3)
+	{
+		for (int e = 0; e < 3; e++)
+		{
+			uint64_t a = group[result[t + e]];
+			uint64_t b = group[result[t + (e + 1) % 3]];
+			edgeUse[a < b ? (a << 32) | b : (b << 32) | a]++;
+		}
+	}
+	for (auto& edge : edgeUse)
+	{
+		if (edge.second == 1)
+		{
+			locked[(unsigned int)(edge.first >> 32)] = true;
+			locked[(unsigned int)(edge.first & 0xFFFFFFFF)] = true;
+		}
+	}
+
+	std::vector<Quadric> quadrics(vertexCount, Quadric());
+	for (size_t t = 0; t < result.size(); t += 3)
+	{
+		const float* p0 = position(result[t]);
+		double n[3];
+		TriangleNormal(p0, position(result[t + 1]), position(result[t + 2]), n);
+		double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (length == 0)
+			continue;
+
+		n[0] /= length; n[1] /= length; n[2] /= length;
+		double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+		for (int c = 0; c < 3; c++)
+			quadrics[group[result[t + c]]].AddPlane(n, d, length * 0.5);
+	}
+
+	double maxCost = (double)maxError * maxError;
+	std::vector<Collapse> collapses;
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	std::vector<int> firstTriangle(vertexCount + 1);
+	std::vector<int> groupTriangles;
+	std::vector<std::pair<unsigned int, unsigned int>> wedges;
+
+	// Collapse in passes: cheapest first, and nothing next to
+	// an earlier collapse of the same pass, so the costs and
+	// adjacency each pass works from stay valid
+	while ((int)result.size() > targetIndexCount)
+	{
+		int triangleCount = (int)result.size() / 3;
+
+		collapses.clear();
+		for (size_t t = 0; t < result.size(); t += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned int a = result[t + e];
+				unsigned int b = result[t + (e + 1) % 3];
+				unsigned int ga = group[a];
+				unsigned int gb = group[b];
+
+				Quadric sum = quadrics[ga];
+				sum.Add(quadrics[gb]);
+				if (!locked[ga])
+				{
+					Collapse collapse = { a, b, sum.Error(position(b)) };
+					collapses.push_back(collapse);
+				}
+				if (!locked[gb])
+				{
+					Collapse collapse = { b, a, sum.Error(position(a)) };
+					collapses.push_back(collapse);
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.Cost < b.Cost; });
+
+		// Triangles around each group
+		std::fill(firstTriangle.begin(), firstTriangle.end(), 0);
+		for (size_t i = 0; i < result.size(); i++)
+			firstTriangle[group[result[i]] + 1]++;
+		for (int v = 0; v < vertexCount; v++)
+			firstTriangle[v + 1] += firstTriangle[v];
+		groupTriangles.resize(result.size());
+		std::vector<int> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+		for (size_t i = 0; i < result.size(); i++)
+			groupTriangles[fill[group[result[i]]]++] = (int)(i / 3);
+
+		for (int v = 0; v < vertexCount; v++)
+			remap[v] = v;
+		std::fill(touched.begin(), touched.end(), false);
+
+		// Each collapse takes out about two triangles
+		int collapseBudget = std::max((triangleCount - targetIndexCount / 3) / 2, 1);
+		int collapsed = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapsed >= collapseBudget || collapse.Cost > maxCost)
+				break;
+
+			unsigned int from = group[collapse.From];
+			unsigned int to = group[collapse.To];
+			if (touched[from] || touched[to])
+				continue;
+
+			// Reject anything that turns a remaining triangle over,
+			// or nearly
+			bool flips = false;
+			for (int i = firstTriangle[from]; i < firstTriangle[from + 1] && !flips; i++)
+			{
+				int t = groupTriangles[i] * 3;
+				unsigned int corner[3] = { result[t], result[t + 1], result[t + 2] };
+				if (group[corner[0]] == to || group[corner[1]] == to || group[corner[2]] == to)
+					continue;
+
+				double before[3], after[3];
+				TriangleNormal(position(corner[0]), position(corner[1]), position(corner[2]), before);
+				for (int c = 0; c < 3; c++)
+				{
+					if (group[corner[c]] == from)
+						corner[c] = collapse.To;
+				}
+				TriangleNormal(position(corner[0]), position(corner[1]), position(corner[2]), after);
+				// Anything turned more than about 75 degrees counts
+				double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+				double lengths = sqrt((before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) *
+					(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]));
+				flips = dot <= 0.25 * lengths;
+			}
+			if (flips)
+				continue;
+
+			// Every vertex at from's position has to move to its
+			// own vertex at to's position, along an edge it
+			// already has.  On a seam that means sliding along the
+			// seam, with each side keeping its UVs and normals.
+			wedges.clear();
+			for (int i = firstTriangle[from]; i < firstTriangle[from + 1]; i++)
+			{
+				int t = groupTriangles[i] * 3;
+				unsigned int partner = ~0u;
+				for (int c = 0; c < 3; c++)
+				{
+					if (group[result[t + c]] == to)
+						partner = result[t + c];
+				}
+
+				for (int c = 0; c < 3; c++)
+				{
+					unsigned int wedge = result[t + c];
+					if (group[wedge] != from)
+						continue;
+
+					size_t w = 0;
+					while (w < wedges.size() && wedges[w].first != wedge)
+						w++;
+					if (w == wedges.size())
+						wedges.push_back(std::make_pair(wedge, partner));
+					else if (wedges[w].second == ~0u)
+						wedges[w].second = partner;
+				}
+			}
+
+			bool matched = true;
+			for (size_t w = 0; w < wedges.size() && matched; w++)
+			{
+				matched = wedges[w].second != ~0u;
+				for (size_t other = 0; other < w && matched; other++)
+					matched = wedges[other].second != wedges[w].second;
+			}
+			if (!matched)
+				continue;
+
+			for (auto& wedge : wedges)
+				remap[wedge.first] = wedge.second;
+			quadrics[to].Add(quadrics[from]);
+
+			// The flip test above saw the whole fan as it was
+			for (int i = firstTriangle[from]; i < firstTriangle[from + 1]; i++)
+			{
+				int t = groupTriangles[i] * 3;
+				for (int c = 0; c < 3; c++)
+					touched[group[result[t + c]]] = true;
+			}
+			touched[to] = true;
+			localStats.Error = std::max(localStats.Error, (float)sqrt(collapse.Cost));
+			collapsed++;
+		}
+
+		if (collapsed == 0)
+			break;
+		localStats.Collapses += collapsed;
+		localStats.Passes++;
+
+		// Apply, dropping triangles that lost an edge
+		size_t write = 0;
+		for (size_t t = 0; t < result.size(); t += 3)
+		{
+			unsigned int a = remap[result[t]];
+			unsigned int b = remap[result[t + 1]];
+			unsigned int c = remap[result[t + 2]];
+			if (group[a] == group[b] || group[b] == group[c] || group[a] == group[c])
+				continue;
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+
+	localStats.Triangles = (int)result.size() / 3;
+	if (stats)
+		*stats = localStats;
+}
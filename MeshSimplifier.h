@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+
+// --------------------------------------------------------
+// Mesh simplification by quadric error edge collapse
+//
+// Vertices are plain arrays of floats with the position in
+// the first three.  Simplifying never moves or adds a vertex,
+// it only collapses edges onto one of their ends, so every
+// level of detail is just another index buffer over the same
+// vertex buffer.
+//
+// Where vertices share a position but not their other
+// attributes (UV or normal seams, hard edges) the position
+// can only slide along the seam, taking every side with it,
+// so seams keep their shape and don't tear.  Positions on an
+// open border never move, and a collapse that would flip a
+// triangle over is skipped.
+// --------------------------------------------------------
+
+struct MeshSimplifyStats {
+	int SourceTriangles;
+	int Triangles;
+	float Error;		// Roughly the farthest the surface moved, in mesh units
+	int Collapses;
+	int Passes;
+};
+
+// Merges vertices whose first compareFloats floats match
+// exactly, compacting vertices in place and remapping
+// indices.  Returns the new vertex count.  vertexStride is in
+// floats.
+int WeldVertices(float* vertices, int vertexStride, int vertexCount, int compareFloats, unsigned int* indices, int indexCount);
+
+// Collapses edges until there are no more than
+// targetIndexCount indices left or the next collapse would
+// cost more than maxError.  result gets the new index buffer.
+void SimplifyMesh(
+	const float* vertices, int vertexStride, int vertexCount,
+	const unsigned int* indices, int indexCount,
+	int targetIndexCount, float maxError,
+	std::vector<unsigned int>& result,
+	MeshSimplifyStats* stats = 0);
@@ -0,0 +1,170 @@
+#include "MipStreamingPolicy.h"
+#include <math.h>
+
+MipStreamingPolicy::MipStreamingPolicy(size_t _budgetBytes, int _streamOutDelayFrames, int _maxChangesPerFrame) {
+	budgetBytes = _budgetBytes;
+	streamOutDelayFrames = _streamOutDelayFrames;
+	maxChangesPerFrame = _maxChangesPerFrame;
+}
+
+MipStreamingPolicy::~MipStreamingPolicy() {
+}
+
+int MipStreamingPolicy::AddTexture(uint32_t width, const std::vector<size_t>& mipBytes, int residentTopMip) {
+	TextureState t;
+	t.Width = width;
+	t.MipBytes = mipBytes;
+	t.ResidentTopMip = residentTopMip;
+	t.DesiredTopMip = residentTopMip;
+	t.FramesWantingLess = 0;
+	t.ScreenPixels = 0;
+	textures.push_back(t);
+	return (int)textures.size() - 1;
+}
+
+void MipStreamingPolicy::BeginFrame() {
+	for (size_t i = 0; i < textures.size(); i++)
+		textures[i].ScreenPixels = 0;
+}
+
+void MipStreamingPolicy::RequestScreenSize(int textureID, float pixels) {
+	// Several entities may share a texture, so keep the largest
+	if (pixels > textures[textureID].ScreenPixels)
+		textures[textureID].ScreenPixels = pixels;
+}
+
+void MipStreamingPolicy::SetResident(int textureID, int topMip) {
+	textures[textureID].ResidentTopMip = topMip;
+}
+
+size_t MipStreamingPolicy::GetResidentBytes() {
+	size_t total = 0;
+	for (size_t i = 0; i < textures.size(); i++)
+		total += BytesFromMip(textures[i], textures[i].ResidentTopMip);
+	return total;
+}
+
+void MipStreamingPolicy::Update(std::vector<MipChange>& changes) {
+	changes.clear();
+
+	// Desired level from screen size alone
+	size_t desiredBytes = 0;
+	for (size_t i = 0; i < textures.size(); i++) {
+		textures[i].DesiredTopMip = ChooseMip(textures[i]);
+		desiredBytes += BytesFromMip(textures[i], textures[i].DesiredTopMip);
+	}
+
+	// Over budget: drop detail from whichever texture has the most
+	// texels per screen pixel (off screen textures go first)
+	while (desiredBytes > budgetBytes) {
+		int victim = -1;
+		float victimDensity = 0;
+		for (size_t i = 0; i < textures.size(); i++) {
+			TextureState& t = textures[i];
+			if (t.DesiredTopMip >= LowestDetailMip(t))
+				continue;
+
+			float pixels = t.ScreenPixels > 1.0f ? t.ScreenPixels : 1.0f;
+			float density = (t.Width >> t.DesiredTopMip) / pixels;
+			if (victim < 0 || density > victimDensity) {
+				victim = (int)i;
+				victimDensity = density;
+			}
+		}
+		if (victim < 0)
+			break;
+
+		TextureState& t = textures[victim];
+		desiredBytes -= t.MipBytes[t.DesiredTopMip];
+		t.DesiredTopMip++;
+	}
+
+	size_t residentBytes = GetResidentBytes();
+	bool overBudget = residentBytes > budgetBytes;
+
+	// Stream out first so there is room for the stream ins
+	for (size_t i = 0; i < textures.size() && (int)changes.size() < maxChangesPerFrame; i++) {
+		TextureState& t = textures[i];
+		if (t.DesiredTopMip > t.ResidentTopMip) {
+			t.FramesWantingLess++;
+			if (overBudget || t.FramesWantingLess >= streamOutDelayFrames) {
+				MipChange change = { (int)i, t.DesiredTopMip };
+				changes.push_back(change);
+				residentBytes -= BytesFromMip(t, t.ResidentTopMip) - BytesFromMip(t, t.DesiredTopMip);
+				t.FramesWantingLess = 0;
+			}
+		} else {
+			t.FramesWantingLess = 0;
+		}
+	}
+
+	// Stream in, largest on screen first.  One that doesn't fit is
+	// passed over so a smaller one behind it can still come in.
+	std::vector<bool> passedOver(textures.size(), false);
+	while ((int)changes.size() < maxChangesPerFrame) {
+		int best = -1;
+		for (size_t i = 0; i < textures.size(); i++) {
+			TextureState& t = textures[i];
+			if (t.DesiredTopMip >= t.ResidentTopMip || passedOver[i])
+				continue;
+			if (best < 0 || t.ScreenPixels > textures[best].ScreenPixels)
+				best = (int)i;
+		}
+		if (best < 0)
+			break;
+
+		TextureState& t = textures[best];
+		size_t extra = BytesFromMip(t, t.DesiredTopMip) - BytesFromMip(t, t.ResidentTopMip);
+		if (residentBytes + extra > budgetBytes) {
+			passedOver[best] = true;
+			continue;
+		}
+
+		MipChange change = { best, t.DesiredTopMip };
+		changes.push_back(change);
+		residentBytes += extra;
+
+		// Already handled this frame
+		t.DesiredTopMip = t.ResidentTopMip;
+	}
+}
+
+size_t MipStreamingPolicy::BytesFromMip(const TextureState& t, int topMip) {
+	size_t total = 0;
+	for (size_t m = topMip; m < t.MipBytes.size(); m++)
+		total += t.MipBytes[m];
+	return total;
+}
+
+int MipStreamingPolicy::LowestDetailMip(const TextureState& t) {
+	int mip = 0;
+	uint32_t size = t.Width;
+	while (size > MinResidentSize && mip < (int)t.MipBytes.size() - 1) {
+		size /= 2;
+		mip++;
+	}
+	return mip;
+}
+
+int MipStreamingPolicy::ChooseMip(const TextureState& t) {
+	int lowest = LowestDetailMip(t);
+	if (t.ScreenPixels <= 0)
+		return lowest;
+
+	// One texel per pixel is enough detail
+	float mipF = log2f((float)t.Width / t.ScreenPixels);
+
+	// Dead band around what is already resident: stream in once the ideal
+	// level is half a mip sharper, stream out only once a whole mip can go
+	int mip;
+	if (mipF < t.ResidentTopMip - 0.5f)
+		mip = (int)floorf(mipF + 0.5f);
+	else if (mipF > t.ResidentTopMip + 1.5f)
+		mip = (int)floorf(mipF - 0.5f);
+	else
+		mip = t.ResidentTopMip;
+
+	if (mip < 0) mip = 0;
+	if (mip > lowest) mip = lowest;
+	return mip;
+}
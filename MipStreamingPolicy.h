@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// --------------------------------------------------------
+// A decision to change how many mips of a texture are resident
+// --------------------------------------------------------
+struct MipChange {
+	int TextureID;
+	int TopMip;		// New most detailed resident mip
+};
+
+// --------------------------------------------------------
+// CPU side policy for mip streaming
+//
+// Each frame the caller reports how large (in pixels) every
+// visible texture appears on screen.  Update() turns that into a
+// desired top mip per texture, trims the set to fit the memory
+// budget (most texels per screen pixel first) and emits the changes that
+// should be streamed in or out.  It knows nothing about D3D, so it
+// can be driven by recorded camera traces as well as the game.
+//
+// Hysteresis keeps textures from flickering between mips:
+//  - A dead band around the resident level (half a mip for
+//    streaming in, a mip and a half for streaming out)
+//  - Streaming out (less detail) waits for several frames
+//    unless the budget is exceeded
+//  - Only a few changes are made per frame
+// --------------------------------------------------------
+class MipStreamingPolicy {
+public:
+	MipStreamingPolicy(size_t budgetBytes, int streamOutDelayFrames = 30, int maxChangesPerFrame = 1);
+	~MipStreamingPolicy();
+
+	// mipBytes - size of every mip, most detailed first
+	int AddTexture(uint32_t width, const std::vector<size_t>& mipBytes, int residentTopMip);
+
+	void BeginFrame();
+	void RequestScreenSize(int textureID, float pixels);
+	void Update(std::vector<MipChange>& changes);
+	void SetResident(int textureID, int topMip);
+
+	void SetBudget(size_t bytes) { budgetBytes = bytes; }
+	size_t GetBudget() { return budgetBytes; }
+	size_t GetResidentBytes();
+	int GetResidentMip(int textureID) { return textures[textureID].ResidentTopMip; }
+	int GetTextureCount() { return (int)textures.size(); }
+
+private:
+	struct TextureState {
+		uint32_t Width;
+		std::vector<size_t> MipBytes;
+		int ResidentTopMip;
+		int DesiredTopMip;
+		int FramesWantingLess;
+		float ScreenPixels;
+	};
+
+	std::vector<TextureState> textures;
+	size_t budgetBytes;
+	int streamOutDelayFrames;
+	int maxChangesPerFrame;
+
+	// Smallest mip kept for textures that aren't on screen at all
+	static const uint32_t MinResidentSize = 64;
+
+	size_t BytesFromMip(const TextureState& t, int topMip);
+	int LowestDetailMip(const TextureState& t);
+	int ChooseMip(const TextureState& t);
+};
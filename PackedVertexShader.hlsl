@@ -0,0 +1,61 @@
+// Same constant buffers as VertexShader.hlsl
+cbuffer PerFrame : register(b0)
+{
+	matrix view;
+	matrix projection;
+};
+
+cbuffer PerObject : register(b1)
+{
+	matrix world;
+};
+
+// Matches PackedVertex in VertexPacking.h.  The input layout
+// reads the normal and tangent as R16G16_SNORM and the UV as
+// R16G16_FLOAT, so they all arrive here as plain floats.
+struct VertexShaderInput
+{
+	float3 position		: POSITION;
+	float2 normal		: NORMAL;		// Octahedral
+	float2 tangent		: TANGENT;		// Octahedral
+	float2 uv			: TEXCOORD;
+};
+
+// Same as VertexShader.hlsl, so PixelShader.hlsl works with both
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float3 normal		: NORMAL;
+	float2 uv			: TEXCOORD;
+	float3 tangent		: TANGENT;
+	float3 worldPos		: POSITION;
+	float viewDepth		: TEXCOORD1;
+};
+
+// Unfolds a point on the -1 to 1 square back onto the
+// octahedron and out to the unit sphere (see OctDecode in
+// VertexPacking.cpp)
+float3 OctDecode(float2 encoded)
+{
+	float3 v = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	if (v.z < 0.0f)
+		v.xy = (1.0f - abs(v.yx)) * (v.xy >= 0.0f ? 1.0f : -1.0f);
+	return normalize(v);
+}
+
+VertexToPixel main(VertexShaderInput input)
+{
+	VertexToPixel output;
+
+	// precise to match the depth pre-pass (ShadowVS) exactly
+	precise matrix worldViewProj = mul(mul(world, view), projection);
+	precise float4 position = mul(float4(input.position, 1.0f), worldViewProj);
+	output.position = position;
+
+	output.normal = mul(OctDecode(input.normal), (float3x3)world);
+	output.tangent = mul(OctDecode(input.tangent), (float3x3)world);
+	output.worldPos = mul(float4(input.position, 1.0f), world).xyz;
+	output.viewDepth = mul(float4(output.worldPos, 1.0f), view).z;
+	output.uv = input.uv;
+	return output;
+}
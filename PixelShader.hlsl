@@ -17,12 +17,29 @@ struct VertexToPixel
 	float2 uv           : TEXCOORD;     // UV co-ordinates
 	float3 tangent		: TANGENT;
 	float3 worldPos		: POSITION;
-	float4 posForShadow	: POSITION1;
+	float viewDepth		: TEXCOORD1;		// Picks the shadow cascade
 };
 
-Texture2D textureSRV : register(t0);
-Texture2D normalMapSRV : register(t1);
-Texture2D ShadowMap : register(t2);
+// Every material in the same table shares these, each in its
+// own layer (see MaterialTable.h)
+Texture2DArray MaterialAlbedo : register(t0);
+Texture2DArray MaterialNormals : register(t1);
+Texture2DArray ShadowMap : register(t2);	// One slice per cascade
+
+// Point and spot lights, culled into clusters on the CPU (see
+// LightClusters.h).  Same layout as ClusterLight there.
+struct ClusterLight {
+	float3 position;
+	float range;
+	float3 color;
+	float spotCosine;		// -1 for a point light
+	float3 direction;
+	float padding;
+};
+
+StructuredBuffer<ClusterLight> ClusterLights : register(t3);
+StructuredBuffer<uint2> ClusterRanges : register(t4);		// Offset and count per cluster
+StructuredBuffer<uint> ClusterLightIndices : register(t5);
 
 SamplerState basicSampler : register(s0);
 SamplerComparisonState ShadowSampler : register(s1);
@@ -34,7 +51,10 @@ struct DirectionalLight {
 
 };
 
-cbuffer ExternalData : register(b0) {
+// Split by how often they change - Renderer uploads PerFrame
+// once for the whole pass, PerMaterial when the material
+// changes and PerObject for every draw
+cbuffer PerFrame : register(b0) {
 	DirectionalLight dirLight1;
 	DirectionalLight dirLight2;
 	DirectionalLight dirLight3;
@@ -46,9 +66,58 @@ cbuffer ExternalData : register(b0) {
 	float3 cameraPosition1;
 	float3 spotLightDirection;
 	float spotPower;
+
+	// Must match MaxShadowCascades on the C++ side
+	matrix cascadeViewProj[4];
+	float4 cascadeSplits;		// Far view depth of each cascade
+	int cascadeCount;
+
+	float2 clusterTileScale;	// Tiles per pixel
+	float clusterSliceScale;	// Slice is log(depth) * scale + bias
+	float clusterSliceBias;
+	int3 clusterCounts;			// Tiles across, tiles down, slices
+};
+
+cbuffer PerMaterial : register(b1) {
+	float specularPower;
+	float materialLayer;		// Of MaterialAlbedo and MaterialNormals
+};
+
+cbuffer PerObject : register(b2) {
 	float alphaV;
 };
 
+// Everything in this pixel's cluster, with the light fading
+// out to nothing at its range
+float3 ClusterLighting(float4 screenPos, float viewDepth, float3 worldPos, float3 normal, float3 surfaceColor)
+{
+	int2 tile = min(int2(screenPos.xy * clusterTileScale), clusterCounts.xy - 1);
+	int slice = clamp(int(floor(log(max(viewDepth, 1e-4f)) * clusterSliceScale + clusterSliceBias)), 0, clusterCounts.z - 1);
+	uint2 range = ClusterRanges[(slice * clusterCounts.y + tile.y) * clusterCounts.x + tile.x];
+
+	float3 total = 0;
+	for (uint i = 0; i < range.y; i++)
+	{
+		ClusterLight light = ClusterLights[ClusterLightIndices[range.x + i]];
+		float3 toLight = light.position - worldPos;
+		float distance = length(toLight);
+		toLight /= max(distance, 1e-4f);
+
+		float attenuation = saturate(1.0f - distance / light.range);
+		attenuation *= attenuation;
+
+		// Spot lights get a soft edge over the outer tenth of the cone
+		if (light.spotCosine > -1.0f)
+		{
+			float spot = dot(-toLight, light.direction);
+			attenuation *= saturate((spot - light.spotCosine) / max((1.0f - light.spotCosine) * 0.1f, 1e-4f));
+		}
+
+		total += light.color * surfaceColor * saturate(dot(normal, toLight)) * attenuation;
+	}
+	return total;
+}
+
 // --------------------------------------------------------
 // The entry point (main method) for our pixel shader
 // 
@@ -81,9 +150,12 @@ float spotAmount = pow(angleFromCenter, spotPower);
 //Specular highlight for point light
 float3 toCamera = normalize(cameraPosition - input.worldPos);
 float3 refl = reflect(-dirToPointLight, input.normal);
-float specular = pow(saturate(dot(refl, toCamera)), 8);
+float specular = pow(saturate(dot(refl, toCamera)), specularPower);
 
-float3 normalFromMap = normalMapSRV.Sample(basicSampler, input.uv).xyz * 2 - 1;
+// Only XY are used so two-channel (BC5) normal maps work too; Z is rebuilt
+float3 normalFromMap;
+normalFromMap.xy = MaterialNormals.Sample(basicSampler, float3(input.uv, materialLayer)).xy * 2 - 1;
+normalFromMap.z = sqrt(saturate(1.0f - dot(normalFromMap.xy, normalFromMap.xy)));
 
 // Transform from tangent to world space
 float3 N = input.normal;
@@ -97,7 +169,7 @@ float lightAmount1 = saturate(dot(input.normal, -normalize(dirLight1.direction))
 float lightAmount2 = saturate(dot(input.normal, -normalize(dirLight2.direction)));
 float lightAmount3 = saturate(dot(input.normal, -normalize(dirLight3.direction)));
 
-float4 surfaceColor = textureSRV.Sample(basicSampler, input.uv);
+float4 surfaceColor = MaterialAlbedo.Sample(basicSampler, float3(input.uv, materialLayer));
 
 float3 light1 = ((dirLight1.diffuseColor.rgb * lightAmount1 * surfaceColor.rgb) + (dirLight1.ambientColor.rgb * surfaceColor.rgb)) + specular + spotAmount;
 float3 light2 = ((dirLight2.diffuseColor * lightAmount2 * surfaceColor) + (dirLight2.ambientColor * surfaceColor));
@@ -105,20 +177,31 @@ float3 light3 = ((dirLight3.diffuseColor * lightAmount3 * surfaceColor) + (dirLi
 
 float3 totalLight = light1 + light2 + light3;
 
-//Shadow Mapping
-float2 shadowUV = input.posForShadow.xy / input.posForShadow.w * 0.5f + 0.5f;
-shadowUV.y = 1.0f - shadowUV.y;
+//Shadow Mapping - use the first cascade that reaches this far,
+//anything past the last one is unshadowed
+float shadowAmount = 1.0f;
+int cascade = 0;
+[unroll] for (int i = 0; i < 3; i++)
+	cascade += (i < cascadeCount - 1 && input.viewDepth > cascadeSplits[i]) ? 1 : 0;
+
+if (input.viewDepth <= cascadeSplits[cascade]) {
+	float4 posForShadow = mul(float4(input.worldPos, 1.0f), cascadeViewProj[cascade]);
 
-float depthFromLight = input.posForShadow.z / input.posForShadow.w;
+	float2 shadowUV = posForShadow.xy * 0.5f + 0.5f;
+	shadowUV.y = 1.0f - shadowUV.y;
 
-float shadowAmount = ShadowMap.SampleCmpLevelZero(
-	ShadowSampler,
-	shadowUV,
-	depthFromLight
-);
+	shadowAmount = ShadowMap.SampleCmpLevelZero(
+		ShadowSampler,
+		float3(shadowUV, cascade),
+		posForShadow.z
+	);
+}
 
 surfaceColor.a = alphaV;
-return float4(totalLight * shadowAmount, surfaceColor.a);
+// The sun's shadow doesn't block the cluster lights
+float3 clusterLight = ClusterLighting(input.position, input.viewDepth, input.worldPos, input.normal, surfaceColor.rgb);
+
+return float4(totalLight * shadowAmount + clusterLight, surfaceColor.a);
 // Just return the input color
 // - This color (like most values passing through the rasterizer) is 
 //   interpolated for each pixel between the corresponding vertices 
@@ -0,0 +1,28 @@
+#include "PositionStream.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+int BuildPositionStream(
+	const float* vertices, int vertexStride, int vertexCount,
+	const unsigned int* indices, int indexCount,
+	std::vector<float>& positions, std::vector<unsigned int>& positionIndices)
+{
+	positions.resize(vertexCount * 3);
+	for (int i = 0; i < vertexCount; i++)
+	{
+		for (int k = 0; k < 3; k++)
+			positions[i * 3 + k] = vertices[i * vertexStride + k];
+	}
+
+	positionIndices.assign(indices, indices + indexCount);
+	if (vertexCount == 0 || indexCount == 0)
+	{
+		positions.clear();
+		return 0;
+	}
+
+	int positionCount = WeldVertices(&positions[0], 3, vertexCount, 3, &positionIndices[0], indexCount);
+	positionCount = OptimizeVertexFetch(&positions[0], 3, positionCount, &positionIndices[0], indexCount);
+	positions.resize(positionCount * 3);
+	return positionCount;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+
+// --------------------------------------------------------
+// Position only stream for depth only passes
+//
+// Shadow and depth passes only read positions, so they get a
+// tightly packed float3 buffer of their own.  Vertices that
+// were only split for a UV or normal seam are one position
+// again, and the triangles keep their order, so index ranges
+// (levels of detail) carry straight over.
+// --------------------------------------------------------
+
+// vertices have the position in their first three floats,
+// vertexStride floats apart.  positions gets the welded
+// float3s in the order positionIndices first uses them, and
+// positionIndices the same triangles over those.  Returns
+// the position count.
+int BuildPositionStream(
+	const float* vertices, int vertexStride, int vertexCount,
+	const unsigned int* indices, int indexCount,
+	std::vector<float>& positions, std::vector<unsigned int>& positionIndices);
@@ -0,0 +1,316 @@
+#include "RenderContext.h"
+#include <string.h>
+
+RenderContext::RenderContext(ID3D11DeviceContext* context)
+{
+	this->context = context;
+	recorder = 0;
+
+	context1 = 0;
+	context->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&context1);
+}
+
+RenderContext::~RenderContext()
+{
+	if (context1) context1->Release();
+}
+
+uint32_t RenderContext::GetStage(ISimpleShader* shader)
+{
+	if (dynamic_cast<SimpleVertexShader*>(shader))
+		return CommandStageVertex;
+	if (dynamic_cast<SimplePixelShader*>(shader))
+		return CommandStagePixel;
+	return CommandStageOther;
+}
+
+// --------------------------------------------------------
+// Markers
+// --------------------------------------------------------
+
+void RenderContext::BeginFrame()
+{
+	if (recorder)
+		recorder->Record(CommandBeginFrame);
+}
+
+void RenderContext::EndFrame()
+{
+	if (recorder)
+		recorder->Record(CommandEndFrame);
+}
+
+void RenderContext::BeginPass(const std::string& name)
+{
+	if (recorder)
+		recorder->Record(CommandBeginPass, recorder->GetNameId(name));
+}
+
+void RenderContext::EndPass()
+{
+	if (recorder)
+		recorder->Record(CommandEndPass);
+}
+
+void RenderContext::InvalidateState()
+{
+	if (recorder)
+		recorder->Record(CommandInvalidateState);
+}
+
+// --------------------------------------------------------
+// Input assembler
+// --------------------------------------------------------
+
+void RenderContext::IASetVertexBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets)
+{
+	if (recorder)
+	{
+		for (UINT i = 0; i < numBuffers; i++)
+			recorder->Record(CommandBindVertexBuffer, startSlot + i, GetId(buffers[i]), strides[i], offsets[i]);
+	}
+	context->IASetVertexBuffers(startSlot, numBuffers, buffers, strides, offsets);
+}
+
+void RenderContext::IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset)
+{
+	if (recorder)
+		recorder->Record(CommandBindIndexBuffer, GetId(buffer), (uint32_t)format, offset);
+	context->IASetIndexBuffer(buffer, format, offset);
+}
+
+void RenderContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	if (recorder)
+		recorder->Record(CommandBindTopology, (uint32_t)topology);
+	context->IASetPrimitiveTopology(topology);
+}
+
+// --------------------------------------------------------
+// Output merger and rasterizer
+// --------------------------------------------------------
+
+void RenderContext::OMSetRenderTargets(UINT numViews, ID3D11RenderTargetView* const* renderTargetViews, ID3D11DepthStencilView* depthStencilView)
+{
+	if (recorder)
+	{
+		uint32_t args[1 + D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+		int count = 0;
+		args[count++] = GetId(depthStencilView);
+		for (UINT i = 0; i < numViews && i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; i++)
+			args[count++] = GetId(renderTargetViews[i]);
+		recorder->Record(CommandBindRenderTargets, args, count);
+	}
+	context->OMSetRenderTargets(numViews, renderTargetViews, depthStencilView);
+}
+
+void RenderContext::OMSetBlendState(ID3D11BlendState* blendState, const FLOAT blendFactor[4], UINT sampleMask)
+{
+	if (recorder)
+		recorder->Record(CommandBindBlendState, GetId(blendState), sampleMask);
+	context->OMSetBlendState(blendState, blendFactor, sampleMask);
+}
+
+void RenderContext::OMSetDepthStencilState(ID3D11DepthStencilState* depthStencilState, UINT stencilRef)
+{
+	if (recorder)
+		recorder->Record(CommandBindDepthState, GetId(depthStencilState), stencilRef);
+	context->OMSetDepthStencilState(depthStencilState, stencilRef);
+}
+
+void RenderContext::RSSetState(ID3D11RasterizerState* rasterizerState)
+{
+	if (recorder)
+		recorder->Record(CommandBindRasterizer, GetId(rasterizerState));
+	context->RSSetState(rasterizerState);
+}
+
+void RenderContext::RSSetViewports(UINT numViewports, const D3D11_VIEWPORT* viewports)
+{
+	if (recorder && numViewports > 0)
+	{
+		uint32_t args[4];
+		memcpy(&args[0], &viewports[0].TopLeftX, 4);
+		memcpy(&args[1], &viewports[0].TopLeftY, 4);
+		memcpy(&args[2], &viewports[0].Width, 4);
+		memcpy(&args[3], &viewports[0].Height, 4);
+		recorder->Record(CommandBindViewport, args, 4);
+	}
+	context->RSSetViewports(numViewports, viewports);
+}
+
+void RenderContext::PSSetShader(ID3D11PixelShader* pixelShader, ID3D11ClassInstance* const* classInstances, UINT numClassInstances)
+{
+	if (recorder)
+		recorder->Record(CommandBindShader, CommandStagePixel, GetId(pixelShader));
+	context->PSSetShader(pixelShader, classInstances, numClassInstances);
+}
+
+void RenderContext::PSSetShaderResource(UINT slot, ID3D11ShaderResourceView* srv)
+{
+	if (recorder)
+		recorder->Record(CommandBindResource, CommandStagePixel, slot, GetId(srv));
+	context->PSSetShaderResources(slot, 1, &srv);
+}
+
+void RenderContext::PSSetSampler(UINT slot, ID3D11SamplerState* sampler)
+{
+	if (recorder)
+		recorder->Record(CommandBindSampler, CommandStagePixel, slot, GetId(sampler));
+	context->PSSetSamplers(slot, 1, &sampler);
+}
+
+// --------------------------------------------------------
+// Resources
+// --------------------------------------------------------
+
+void RenderContext::ClearRenderTargetView(ID3D11RenderTargetView* renderTargetView, const FLOAT color[4])
+{
+	if (recorder)
+	{
+		uint32_t args[5];
+		args[0] = GetId(renderTargetView);
+		memcpy(&args[1], color, sizeof(FLOAT) * 4);
+		recorder->Record(CommandClearColor, args, 5);
+	}
+	context->ClearRenderTargetView(renderTargetView, color);
+}
+
+void RenderContext::ClearDepthStencilView(ID3D11DepthStencilView* depthStencilView, UINT clearFlags, FLOAT depth, UINT8 stencil)
+{
+	if (recorder)
+	{
+		uint32_t depthBits;
+		memcpy(&depthBits, &depth, sizeof(depthBits));
+		recorder->Record(CommandClearDepth, GetId(depthStencilView), clearFlags, depthBits);
+	}
+	context->ClearDepthStencilView(depthStencilView, clearFlags, depth, stencil);
+}
+
+void RenderContext::CopySubresourceRegion(ID3D11Resource* dest, UINT destSubresource, UINT destX, UINT destY, UINT destZ, ID3D11Resource* source, UINT sourceSubresource, const D3D11_BOX* sourceBox)
+{
+	if (recorder)
+		recorder->Record(CommandCopy, GetId(dest), GetId(source), 0);
+	context->CopySubresourceRegion(dest, destSubresource, destX, destY, destZ, source, sourceSubresource, sourceBox);
+}
+
+void RenderContext::UpdateDynamicBuffer(ID3D11Buffer* buffer, const void* data, UINT size)
+{
+	if (recorder)
+		recorder->Record(CommandUploadBuffer, GetId(buffer), size);
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	memcpy(mapped.pData, data, size);
+	context->Unmap(buffer, 0);
+}
+
+void RenderContext::UpdateDynamicBufferRange(ID3D11Buffer* buffer, UINT offset, const void* data, UINT size, bool discard)
+{
+	if (recorder)
+		recorder->Record(CommandUploadBuffer, GetId(buffer), size);
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	context->Map(buffer, 0, discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mapped);
+	memcpy((unsigned char*)mapped.pData + offset, data, size);
+	context->Unmap(buffer, 0);
+}
+
+// --------------------------------------------------------
+// SimpleShader
+// --------------------------------------------------------
+
+void RenderContext::SetShader(ISimpleShader* shader)
+{
+	if (recorder)
+		recorder->Record(CommandBindShader, GetStage(shader), GetId(shader));
+	shader->SetShader();
+}
+
+void RenderContext::CopyAllBufferData(ISimpleShader* shader)
+{
+	if (recorder)
+	{
+		uint32_t bytes = 0;
+		for (unsigned int i = 0; i < shader->GetBufferCount(); i++)
+			bytes += shader->GetBufferSize(i);
+		recorder->Record(CommandUploadConstants, GetStage(shader), GetId(shader), bytes);
+	}
+	shader->CopyAllBufferData();
+}
+
+void RenderContext::CopyBufferData(ISimpleShader* shader, const std::string& bufferName)
+{
+	if (recorder)
+	{
+		const SimpleConstantBuffer* buffer = shader->GetBufferInfo(bufferName);
+		if (buffer)
+			recorder->Record(CommandUploadConstants, GetStage(shader), GetId(shader), buffer->Size);
+	}
+	shader->CopyBufferData(bufferName);
+}
+
+bool RenderContext::SetShaderResourceView(ISimpleShader* shader, const std::string& name, ID3D11ShaderResourceView* srv)
+{
+	if (recorder)
+	{
+		const SimpleSRV* info = shader->GetShaderResourceViewInfo(name);
+		if (info)
+			recorder->Record(CommandBindResource, GetStage(shader), info->BindIndex, GetId(srv));
+	}
+	return shader->SetShaderResourceView(name, srv);
+}
+
+bool RenderContext::SetSamplerState(ISimpleShader* shader, const std::string& name, ID3D11SamplerState* sampler)
+{
+	if (recorder)
+	{
+		const SimpleSampler* info = shader->GetSamplerInfo(name);
+		if (info)
+			recorder->Record(CommandBindSampler, GetStage(shader), info->BindIndex, GetId(sampler));
+	}
+	return shader->SetSamplerState(name, sampler);
+}
+
+void RenderContext::SetConstantBuffer(ISimpleShader* shader, UINT slot, ID3D11Buffer* buffer, UINT firstConstant, UINT numConstants)
+{
+	uint32_t stage = GetStage(shader);
+	if (stage == CommandStageOther)
+		return;
+
+	if (recorder)
+		recorder->Record(CommandBindConstants, stage, slot, GetId(buffer), firstConstant);
+
+	if (numConstants == 0 || !context1)
+	{
+		if (stage == CommandStageVertex)
+			context->VSSetConstantBuffers(slot, 1, &buffer);
+		else
+			context->PSSetConstantBuffers(slot, 1, &buffer);
+	}
+	else
+	{
+		if (stage == CommandStageVertex)
+			context1->VSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &numConstants);
+		else
+			context1->PSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &numConstants);
+	}
+}
+
+// --------------------------------------------------------
+// Draws
+// --------------------------------------------------------
+
+void RenderContext::Draw(UINT vertexCount, UINT startVertex)
+{
+	if (recorder)
+		recorder->Record(CommandDraw, vertexCount, startVertex);
+	context->Draw(vertexCount, startVertex);
+}
+
+void RenderContext::DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex)
+{
+	if (recorder)
+		recorder->Record(CommandDrawIndexed, indexCount, startIndex, (uint32_t)baseVertex);
+	context->DrawIndexed(indexCount, startIndex, baseVertex);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <d3d11_1.h>
+#include <string>
+#include "SimpleShader.h"
+#include "CommandStream.h"
+
+// --------------------------------------------------------
+// Thin wrapper over the device context that the draw code
+// goes through.  The calls mirror the D3D ones they forward
+// to; with a recorder attached each one is also appended to
+// the recorder's command stream.
+//
+// SimpleShader calls are routed through here too, so the
+// stream sees shader binds and constant buffer uploads.
+// --------------------------------------------------------
+class RenderContext {
+public:
+	RenderContext(ID3D11DeviceContext* context);
+	~RenderContext();
+
+	ID3D11DeviceContext* GetDeviceContext() { return context; }
+
+	// Null before D3D 11.1, which has no constant buffer offsets
+	ID3D11DeviceContext1* GetDeviceContext1() { return context1; }
+
+	// Null stops recording
+	void SetRecorder(CommandRecorder* recorder) { this->recorder = recorder; }
+	CommandRecorder* GetRecorder() { return recorder; }
+
+	// Markers, only meaningful to the stream
+	void BeginFrame();
+	void EndFrame();
+	void BeginPass(const std::string& name);
+	void EndPass();
+
+	// Call after drawing with something that binds state behind
+	// our back (SpriteBatch), so no bind after it looks redundant
+	void InvalidateState();
+
+	// Input assembler
+	void IASetVertexBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets);
+	void IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset);
+	void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+
+	// Output merger and rasterizer
+	void OMSetRenderTargets(UINT numViews, ID3D11RenderTargetView* const* renderTargetViews, ID3D11DepthStencilView* depthStencilView);
+	void OMSetBlendState(ID3D11BlendState* blendState, const FLOAT blendFactor[4], UINT sampleMask);
+	void OMSetDepthStencilState(ID3D11DepthStencilState* depthStencilState, UINT stencilRef);
+	void RSSetState(ID3D11RasterizerState* rasterizerState);
+	void RSSetViewports(UINT numViewports, const D3D11_VIEWPORT* viewports);
+
+	// Pixel shader off (SimpleShader has no way to unbind)
+	void PSSetShader(ID3D11PixelShader* pixelShader, ID3D11ClassInstance* const* classInstances, UINT numClassInstances);
+
+	// Pixel shader slots by number, for binds whose slot was
+	// looked up ahead of time (MaterialTable)
+	void PSSetShaderResource(UINT slot, ID3D11ShaderResourceView* srv);
+	void PSSetSampler(UINT slot, ID3D11SamplerState* sampler);
+
+	// Resources
+	void ClearRenderTargetView(ID3D11RenderTargetView* renderTargetView, const FLOAT color[4]);
+	void ClearDepthStencilView(ID3D11DepthStencilView* depthStencilView, UINT clearFlags, FLOAT depth, UINT8 stencil);
+	void CopySubresourceRegion(ID3D11Resource* dest, UINT destSubresource, UINT destX, UINT destY, UINT destZ, ID3D11Resource* source, UINT sourceSubresource, const D3D11_BOX* sourceBox);
+	void UpdateDynamicBuffer(ID3D11Buffer* buffer, const void* data, UINT size);	// Map with discard
+	void UpdateDynamicBufferRange(ID3D11Buffer* buffer, UINT offset, const void* data, UINT size, bool discard);	// No overwrite unless discard - the GPU mustn't be using that range
+
+	// SimpleShader
+	void SetShader(ISimpleShader* shader);
+	void CopyAllBufferData(ISimpleShader* shader);
+	void CopyBufferData(ISimpleShader* shader, const std::string& bufferName);
+	bool SetShaderResourceView(ISimpleShader* shader, const std::string& name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(ISimpleShader* shader, const std::string& name, ID3D11SamplerState* sampler);
+
+	// Binds buffer to the shader's stage in place of its own
+	// constant buffer in that slot.  Counts are in 16 byte
+	// constants; 0 constants binds the whole buffer.  Vertex
+	// and pixel shaders only.
+	void SetConstantBuffer(ISimpleShader* shader, UINT slot, ID3D11Buffer* buffer, UINT firstConstant, UINT numConstants);
+
+	// Draws
+	void Draw(UINT vertexCount, UINT startVertex);
+	void DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex);
+
+private:
+	ID3D11DeviceContext* context;
+	ID3D11DeviceContext1* context1;
+	CommandRecorder* recorder;
+
+	uint32_t GetId(const void* object) { return recorder->GetObjectId(object); }
+	static uint32_t GetStage(ISimpleShader* shader);
+};
@@ -0,0 +1,69 @@
+#include "RenderTarget.h"
+
+bool CreateRenderTarget(ID3D11Device* device, unsigned int width, unsigned int height, DXGI_FORMAT format, RenderTarget& target, unsigned int bindFlags)
+{
+	target = {};
+
+	// Depth buffers only get a depth/stencil view
+	bool isDepth = (bindFlags & D3D11_BIND_DEPTH_STENCIL) != 0;
+
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = width;
+	textureDesc.Height = height;
+	textureDesc.ArraySize = 1;
+	textureDesc.BindFlags = isDepth ? bindFlags : D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE | bindFlags;
+	textureDesc.CPUAccessFlags = 0;
+	textureDesc.Format = format;
+	textureDesc.MipLevels = 1;
+	textureDesc.MiscFlags = 0;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+
+	if (FAILED(device->CreateTexture2D(&textureDesc, 0, &target.Texture)))
+		return false;
+
+	if (isDepth)
+	{
+		if (FAILED(device->CreateDepthStencilView(target.Texture, 0, &target.DSV)))
+		{
+			ReleaseRenderTarget(target);
+			return false;
+		}
+	}
+	else
+	{
+		D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
+		rtvDesc.Format = format;
+		rtvDesc.Texture2D.MipSlice = 0;
+		rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = format;
+		srvDesc.Texture2D.MipLevels = 1;
+		srvDesc.Texture2D.MostDetailedMip = 0;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+
+		if (FAILED(device->CreateRenderTargetView(target.Texture, &rtvDesc, &target.RTV)) ||
+			FAILED(device->CreateShaderResourceView(target.Texture, &srvDesc, &target.SRV)))
+		{
+			ReleaseRenderTarget(target);
+			return false;
+		}
+	}
+
+	target.Width = width;
+	target.Height = height;
+	target.Format = format;
+	target.BindFlags = bindFlags;
+	return true;
+}
+
+void ReleaseRenderTarget(RenderTarget& target)
+{
+	if (target.DSV) target.DSV->Release();
+	if (target.SRV) target.SRV->Release();
+	if (target.RTV) target.RTV->Release();
+	if (target.Texture) target.Texture->Release();
+	target = {};
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <d3d11.h>
+
+// --------------------------------------------------------
+// A 2D texture we can both render to and sample from, or a
+// depth buffer when D3D11_BIND_DEPTH_STENCIL is requested
+// --------------------------------------------------------
+struct RenderTarget {
+	ID3D11Texture2D* Texture;
+	ID3D11RenderTargetView* RTV;
+	ID3D11ShaderResourceView* SRV;
+	ID3D11DepthStencilView* DSV;
+	unsigned int Width;
+	unsigned int Height;
+	DXGI_FORMAT Format;
+	unsigned int BindFlags;		// Beyond render target and shader resource
+};
+
+bool CreateRenderTarget(ID3D11Device* device, unsigned int width, unsigned int height, DXGI_FORMAT format, RenderTarget& target, unsigned int bindFlags = 0);
+void ReleaseRenderTarget(RenderTarget& target);
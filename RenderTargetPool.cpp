@@ -0,0 +1,120 @@
+#include "RenderTargetPool.h"
+
+RenderTargetPool::RenderTargetPool(ID3D11Device* device, int maxIdleFrames)
+{
+	this->device = device;
+	this->maxIdleFrames = maxIdleFrames;
+	frame = 0;
+	createdCount = 0;
+	reusedCount = 0;
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+	for (auto& e : entries)
+	{
+		ReleaseRenderTarget(*e.Target);
+		delete e.Target;
+	}
+}
+
+RenderTarget* RenderTargetPool::Acquire(unsigned int width, unsigned int height, DXGI_FORMAT format, unsigned int bindFlags)
+{
+	for (auto& e : entries)
+	{
+		RenderTarget* t = e.Target;
+		if (!e.InUse &&
+			t->Width == width &&
+			t->Height == height &&
+			t->Format == format &&
+			t->BindFlags == bindFlags)
+		{
+			e.InUse = true;
+			e.LastUsedFrame = frame;
+			reusedCount++;
+			return t;
+		}
+	}
+
+	RenderTarget* target = new RenderTarget();
+	if (!CreateRenderTarget(device, width, height, format, *target, bindFlags))
+	{
+		delete target;
+		return 0;
+	}
+
+	Entry entry;
+	entry.Target = target;
+	entry.InUse = true;
+	entry.LastUsedFrame = frame;
+	entries.push_back(entry);
+	createdCount++;
+	return target;
+}
+
+void RenderTargetPool::Release(RenderTarget* target)
+{
+	for (auto& e : entries)
+	{
+		if (e.Target == target)
+		{
+			e.InUse = false;
+			e.LastUsedFrame = frame;
+			return;
+		}
+	}
+}
+
+void RenderTargetPool::BeginFrame()
+{
+	frame++;
+
+	for (size_t i = 0; i < entries.size();)
+	{
+		Entry& e = entries[i];
+		if (!e.InUse && frame - e.LastUsedFrame > maxIdleFrames)
+		{
+			ReleaseRenderTarget(*e.Target);
+			delete e.Target;
+			entries.erase(entries.begin() + i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+void RenderTargetPool::Trim()
+{
+	for (size_t i = 0; i < entries.size();)
+	{
+		Entry& e = entries[i];
+		if (!e.InUse)
+		{
+			ReleaseRenderTarget(*e.Target);
+			delete e.Target;
+			entries.erase(entries.begin() + i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+size_t RenderTargetPool::GetPooledBytes()
+{
+	// Everything the pool makes is a single mip
+	size_t bytes = 0;
+	for (auto& e : entries)
+	{
+		size_t bytesPerPixel = 4;
+		if (e.Target->Format == DXGI_FORMAT_R16G16B16A16_FLOAT || e.Target->Format == DXGI_FORMAT_R32G32_FLOAT)
+			bytesPerPixel = 8;
+		else if (e.Target->Format == DXGI_FORMAT_R32G32B32A32_FLOAT)
+			bytesPerPixel = 16;
+		bytes += (size_t)e.Target->Width * e.Target->Height * bytesPerPixel;
+	}
+	return bytes;
+}
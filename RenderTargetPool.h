@@ -0,0 +1,49 @@
+#pragma once
+
+#include <d3d11.h>
+#include <vector>
+#include "RenderTarget.h"
+
+// --------------------------------------------------------
+// Hands out render targets keyed by (format, size, bind flags)
+//
+// Released targets stay in the pool so the next request with
+// the same key reuses them instead of creating a new texture.
+// This matters when the window is resized back and forth or the
+// render scale changes: the old sizes are still around for a
+// while.  Targets nobody has asked for in maxIdleFrames frames
+// are destroyed by BeginFrame().
+// --------------------------------------------------------
+class RenderTargetPool {
+public:
+	RenderTargetPool(ID3D11Device* device, int maxIdleFrames = 120);
+	~RenderTargetPool();
+
+	RenderTarget* Acquire(unsigned int width, unsigned int height, DXGI_FORMAT format, unsigned int bindFlags = 0);
+	void Release(RenderTarget* target);
+
+	// Ages the free targets and destroys the stale ones
+	void BeginFrame();
+
+	// Destroys every target that isn't currently acquired
+	void Trim();
+
+	int GetCreatedCount() { return createdCount; }
+	int GetReusedCount() { return reusedCount; }
+	size_t GetPooledBytes();
+
+private:
+	struct Entry {
+		RenderTarget* Target;
+		bool InUse;
+		int LastUsedFrame;
+	};
+
+	ID3D11Device* device;
+	std::vector<Entry> entries;
+	int frame;
+	int maxIdleFrames;
+
+	int createdCount;
+	int reusedCount;
+};
@@ -3,6 +3,10 @@
 
 
 Renderer::Renderer() {
+	context = 0;
+	uploadHeap = 0;
+	materialTable = 0;
+	stats = {};
 
 }
 
@@ -24,28 +28,15 @@ void Renderer::SetIndexBuffer(GameEntity* &gameEntity, ID3D11Buffer* &indexBuffe
 	indexBuffer = gameEntity->GetMesh()->GetIndexBuffer();
 }
 
-void Renderer::SetVertexShader(SimpleVertexShader* &vertexShader, GameEntity* &gameEntity, Camera* &camera, XMFLOAT4X4 &shadowViewMatrix, XMFLOAT4X4 &shadowProjectionMatrix) {
-	vertexShader = gameEntity->GetMaterial()->GetVertexShader();
-	vertexShader->SetMatrix4x4("world", *gameEntity->GetWorldMatrix());
+void Renderer::SetFrameConstants(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader, Camera* camera, ID3D11SamplerState* shadowSampler, ID3D11ShaderResourceView* shadowSRV, const ShadowCascadeConstants& shadowConstants) {
 	vertexShader->SetMatrix4x4("view", camera->GetView());
 	vertexShader->SetMatrix4x4("projection", camera->GetProjection());
 
-	vertexShader->SetMatrix4x4("shadowView", shadowViewMatrix);
-	vertexShader->SetMatrix4x4("shadowProj", shadowProjectionMatrix);
-
-	vertexShader->CopyAllBufferData();
-	vertexShader->SetShader();
-}
-
-void Renderer::SetPixelShader(SimplePixelShader* &pixelShader, GameEntity* &gameEntity, Camera* &camera, ID3D11SamplerState* &shadowSampler, ID3D11ShaderResourceView* &shadowSRV) {
 	SetLights();
-	pixelShader = gameEntity->GetMaterial()->GetPixelShader();
 	pixelShader->SetData("dirLight1", &dirLight1, sizeof(DirectionalLight));
 	pixelShader->SetData("dirLight2", &dirLight2, sizeof(DirectionalLight));
 	pixelShader->SetData("dirLight3", &dirLight3, sizeof(DirectionalLight));
 
-
-
 	pixelShader->SetFloat3("pointLightPosition", XMFLOAT3(2, 2, 0));
 	pixelShader->SetFloat4("pointLightColor", XMFLOAT4(0.1, 0.1f, 1, 1));
 	pixelShader->SetFloat3("cameraPosition", XMFLOAT3(0, 0, -5));
@@ -53,14 +44,44 @@ void Renderer::SetPixelShader(SimplePixelShader* &pixelShader, GameEntity* &game
 	pixelShader->SetFloat3("spotLightDirection", XMFLOAT3(0, 3, 3));
 	pixelShader->SetFloat("spotPower", 0.5);
 
-	pixelShader->SetShaderResourceView("textureSRV", gameEntity->GetMaterial()->GetMaterialSRV());
-	pixelShader->SetShaderResourceView("normalMapSRV", gameEntity->GetMaterial()->GetNormalSRV());
-	pixelShader->SetSamplerState("basicSampler", gameEntity->GetMaterial()->GetMaterialSampler());
+	pixelShader->SetData("cascadeViewProj", shadowConstants.ViewProjection, sizeof(shadowConstants.ViewProjection));
+	pixelShader->SetFloat4("cascadeSplits", shadowConstants.Splits);
+	pixelShader->SetInt("cascadeCount", shadowConstants.Count);
 
-	pixelShader->SetSamplerState("ShadowSampler", shadowSampler);
-	pixelShader->SetShaderResourceView("ShadowMap", shadowSRV);
+	context->CopyBufferData(vertexShader, "PerFrame");
+	context->CopyBufferData(pixelShader, "PerFrame");
+	stats.FrameBytes += vertexShader->GetBufferInfo("PerFrame")->Size + pixelShader->GetBufferInfo("PerFrame")->Size;
 
-	pixelShader->CopyAllBufferData();
-	pixelShader->SetShader();
+	context->SetShader(vertexShader);
+	context->SetShader(pixelShader);
+	context->SetSamplerState(pixelShader, "ShadowSampler", shadowSampler);
+	context->SetShaderResourceView(pixelShader, "ShadowMap", shadowSRV);
+	materialTable->InvalidateBindings();
 }
 
+void Renderer::SetVertexShader(SimpleVertexShader* &vertexShader, GameEntity* &gameEntity) {
+	vertexShader = gameEntity->GetMaterial()->GetVertexShader();
+	vertexShader->SetMatrix4x4("world", *gameEntity->GetWorldMatrix());
+
+	uploadHeap->Upload(vertexShader, "PerObject");
+	stats.ObjectBytes += vertexShader->GetBufferInfo("PerObject")->Size;
+}
+
+void Renderer::SetPixelShader(SimplePixelShader* &pixelShader, GameEntity* &gameEntity) {
+	const MaterialState* state = gameEntity->GetMaterial()->GetState();
+	pixelShader = state->PixelShader;
+
+	// Only what differs from the last material gets bound
+	if (materialTable->Bind(state)) {
+		pixelShader->SetFloat("specularPower", state->SpecularPower);
+		pixelShader->SetFloat("materialLayer", state->Layer);
+		context->CopyBufferData(pixelShader, "PerMaterial");
+		stats.MaterialBytes += pixelShader->GetBufferInfo("PerMaterial")->Size;
+		stats.MaterialChanges++;
+	}
+
+	// alphaV, set by whoever's drawing
+	uploadHeap->Upload(pixelShader, "PerObject");
+	stats.ObjectBytes += pixelShader->GetBufferInfo("PerObject")->Size;
+	stats.Objects++;
+}
@@ -3,12 +3,35 @@
 #include "GameEntity.h"
 #include "Camera.h"
 #include "Lights.h"
+#include "ShadowCascades.h"
+#include "RenderContext.h"
+#include "ConstantUploadHeap.h"
+#include "MaterialTable.h"
+
+// Bytes of constants the lit pass uploaded, by how often
+// they change
+struct ConstantUploadStats {
+	long long FrameBytes;
+	long long MaterialBytes;
+	long long ObjectBytes;
+	int Objects;
+	int MaterialChanges;
+};
 
 class Renderer {
 public:
 	Renderer();
 	~Renderer();
 
+	// Shader binds and uploads go through this
+	void SetContext(RenderContext* context) { this->context = context; }
+
+	// Per object constants come out of this
+	void SetUploadHeap(ConstantUploadHeap* heap) { uploadHeap = heap; }
+
+	// Entities' materials must have been baked by this
+	void SetMaterialTable(MaterialTable* table) { materialTable = table; }
+
 	void SetLights();
 	/*ID3D11Buffer* SetVertexBuffer();
 	ID3D11Buffer* SetIndexBuffer();
@@ -17,9 +40,26 @@ public:
 
 	void SetVertexBuffer(GameEntity* &gameEntity, ID3D11Buffer* &vertexBuffer);
 	void SetIndexBuffer(GameEntity* &gameEntity, ID3D11Buffer* &indexBuffer);
-	void SetVertexShader(SimpleVertexShader* &vertexShader, GameEntity* &gameEntity, Camera* &camera, XMFLOAT4X4 &shadowViewMatrix, XMFLOAT4X4 &shadowProjectionMatrix);
-	void SetPixelShader(SimplePixelShader* &pixelShader, GameEntity* &gameEntity, Camera* &camera, ID3D11SamplerState* &shadowSampler, ID3D11ShaderResourceView* &shadowSRV);
+
+	// Once before the entities of a pass - camera, lights and
+	// shadows go to both shaders and they're bound.  The
+	// entities' materials are expected to use these shaders.
+	void SetFrameConstants(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader, Camera* camera, ID3D11SamplerState* shadowSampler, ID3D11ShaderResourceView* shadowSRV, const ShadowCascadeConstants& shadowConstants);
+
+	// Then per entity - the material's texture tables where
+	// they aren't bound, its constants if it's a different
+	// material, and the entity's own
+	void SetVertexShader(SimpleVertexShader* &vertexShader, GameEntity* &gameEntity);
+	void SetPixelShader(SimplePixelShader* &pixelShader, GameEntity* &gameEntity);
+
+	// Since the last ResetStats
+	ConstantUploadStats GetStats() { return stats; }
+	void ResetStats() { stats = {}; }
 private:
+	RenderContext* context;
+	ConstantUploadHeap* uploadHeap;
+	MaterialTable* materialTable;
+	ConstantUploadStats stats;
 	GameEntity* gameEntity;
 	Camera* camera;
 	ID3D11Buffer *vertexBufferRender;
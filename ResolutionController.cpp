@@ -0,0 +1,115 @@
+#include "ResolutionController.h"
+#include <math.h>
+
+namespace {
+	// PI gains on the relative frame time error
+	const float ProportionalGain = 0.15f;
+	const float IntegralGain = 0.02f;
+
+	// Relative error we don't react to.  Raising the scale needs more
+	// headroom than lowering it needs overrun, otherwise a target that
+	// sits between two steps flips back and forth forever.
+	const float DeadBandDown = 0.05f;
+	const float DeadBandUp = 0.12f;
+
+	// Applied scales are multiples of this
+	const float ScaleStep = 0.0625f;
+
+	// Frames to wait after a change before the next one
+	const int CooldownDown = 15;
+	const int CooldownUp = 90;
+
+	// Hitches longer than this (window drags, breakpoints)
+	// would only skew the average
+	const float MaxFrameTime = 0.1f;
+}
+
+ResolutionController::ResolutionController(float targetFrameTime, float minScale, float maxScale)
+{
+	this->targetFrameTime = targetFrameTime;
+	this->minScale = minScale;
+	this->maxScale = maxScale;
+	Reset();
+}
+
+ResolutionController::~ResolutionController()
+{
+}
+
+void ResolutionController::Reset()
+{
+	historyCount = 0;
+	historyIndex = 0;
+	scale = maxScale;
+	appliedScale = maxScale;
+	previousError = 0.0f;
+	framesSinceChange = 0;
+}
+
+float ResolutionController::GetAverageFrameTime()
+{
+	if (historyCount == 0)
+		return 0.0f;
+
+	float total = 0.0f;
+	for (int i = 0; i < historyCount; i++)
+		total += history[i];
+	return total / historyCount;
+}
+
+bool ResolutionController::Update(float frameTime)
+{
+	if (frameTime > MaxFrameTime)
+		frameTime = MaxFrameTime;
+
+	history[historyIndex] = frameTime;
+	historyIndex = (historyIndex + 1) % historySize;
+	if (historyCount < historySize)
+		historyCount++;
+
+	framesSinceChange++;
+
+	// Wait for a full history at the current scale
+	if (historyCount < historySize)
+		return false;
+
+	// Positive when there is time to spare
+	float error = (targetFrameTime - GetAverageFrameTime()) / targetFrameTime;
+	if ((error < 0.0f && -error < DeadBandDown) || (error > 0.0f && error < DeadBandUp))
+		error = 0.0f;
+
+	// Velocity form PI - clamping the output is all the
+	// anti-windup it needs.  The proportional part reacts to the
+	// error shrinking as much as growing, so only let a step
+	// move the way the error itself points: a hitch that drags
+	// the average from well under target into the dead band
+	// mustn't lower the scale.
+	float step = ProportionalGain * (error - previousError) + IntegralGain * error;
+	if ((step < 0.0f && error >= 0.0f) || (step > 0.0f && error <= 0.0f))
+		step = 0.0f;
+	scale += step;
+	previousError = error;
+
+	if (scale < minScale) scale = minScale;
+	if (scale > maxScale) scale = maxScale;
+
+	float quantized = floorf(scale / ScaleStep + 0.5f) * ScaleStep;
+	if (quantized < minScale) quantized = minScale;
+	if (quantized > maxScale) quantized = maxScale;
+
+	if (quantized == appliedScale)
+		return false;
+
+	int cooldown = quantized < appliedScale ? CooldownDown : CooldownUp;
+	if (framesSinceChange < cooldown)
+		return false;
+
+	appliedScale = quantized;
+	framesSinceChange = 0;
+
+	// Frame times measured at the old scale say nothing about the new one
+	historyCount = 0;
+	historyIndex = 0;
+	previousError = 0.0f;
+	return true;
+}
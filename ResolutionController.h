@@ -0,0 +1,50 @@
+#pragma once
+
+// --------------------------------------------------------
+// Picks the render scale from recent frame times
+//
+// Frame times go into a short history.  Once it is full, the
+// average is compared against the target and a PI controller
+// nudges a continuous scale up or down.  The scale that is
+// actually applied moves in fixed steps, so the render targets
+// only come in a handful of sizes, and hysteresis keeps it from
+// bouncing:
+//  - Errors inside a dead band are ignored, and the band is
+//    wider for raising the scale than for lowering it
+//  - After a change the history is thrown away and the next
+//    change has to wait; dropping quality waits less than
+//    raising it
+//
+// It only sees the numbers it is given, so a recorded list of
+// frame times always produces the same scale changes.
+// --------------------------------------------------------
+class ResolutionController {
+public:
+	ResolutionController(float targetFrameTime = 1.0f / 60.0f, float minScale = 0.5f, float maxScale = 1.0f);
+	~ResolutionController();
+
+	// Returns true if the applied scale changed
+	bool Update(float frameTime);
+	void Reset();
+
+	float GetScale() { return appliedScale; }
+	float GetAverageFrameTime();
+
+	void SetTargetFrameTime(float seconds) { targetFrameTime = seconds; }
+	float GetTargetFrameTime() { return targetFrameTime; }
+
+private:
+	static const int historySize = 16;
+	float history[historySize];
+	int historyCount;
+	int historyIndex;
+
+	float targetFrameTime;
+	float minScale;
+	float maxScale;
+
+	float scale;			// Continuous controller output
+	float appliedScale;		// Quantized scale in use
+	float previousError;
+	int framesSinceChange;
+};
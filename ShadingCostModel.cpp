@@ -0,0 +1,63 @@
+#include "ShadingCostModel.h"
+#include "SoftwareShaders.h"
+#include <string.h>
+
+namespace {
+
+void DrawPositions(SoftwareRasterizer& rasterizer, const SoftwareDrawState& state, SoftwareShadowVertexShader& transform, const ShadingCostDraw& draw)
+{
+	memcpy(transform.World, draw.World, sizeof(transform.World));
+	rasterizer.DrawIndexed(state, draw.Positions, sizeof(float) * 3, draw.PositionCount,
+		draw.Indices, draw.IndexCount, transform, SoftwarePixelShader());
+}
+
+}
+
+ShadingCost EstimateShadingCost(
+	SoftwareRasterizer& rasterizer,
+	int width, int height,
+	const float* view, const float* projection,
+	const std::vector<ShadingCostDraw>& draws)
+{
+	ShadingCost cost = {};
+	SoftwareTarget target(width, height);
+	rasterizer.SetTarget(&target);
+
+	// ShadowVS is only a position transform, which is all a
+	// depth only draw needs
+	SoftwareShadowVertexShader transform;
+	memcpy(transform.View, view, sizeof(transform.View));
+	memcpy(transform.Projection, projection, sizeof(transform.Projection));
+
+	SoftwareDrawState lessState = SoftwareDefaultState(0);
+	lessState.ColorWrite = false;
+
+	// Without - everything in order
+	target.ClearDepth(1.0f);
+	rasterizer.ResetStats();
+	for (const ShadingCostDraw& draw : draws)
+		DrawPositions(rasterizer, lessState, transform, draw);
+	cost.Shaded = rasterizer.GetStats().PixelsShaded;
+
+	// With - opaque depth first, then everything again
+	target.ClearDepth(1.0f);
+	rasterizer.ResetStats();
+	for (const ShadingCostDraw& draw : draws)
+	{
+		if (draw.Opaque)
+			DrawPositions(rasterizer, lessState, transform, draw);
+	}
+	cost.PrepassPixels = rasterizer.GetStats().PixelsShaded;
+
+	SoftwareDrawState equalState = lessState;
+	equalState.DepthFunc = SoftwareDepthEqual;
+	equalState.DepthWrite = false;
+
+	rasterizer.ResetStats();
+	for (const ShadingCostDraw& draw : draws)
+		DrawPositions(rasterizer, draw.Opaque ? equalState : lessState, transform, draw);
+	cost.ShadedWithPrepass = rasterizer.GetStats().PixelsShaded;
+
+	rasterizer.SetTarget(0);
+	return cost;
+}
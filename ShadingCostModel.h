@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include "SoftwareRasterizer.h"
+
+// --------------------------------------------------------
+// How many times the scene's pixel shader runs in a frame,
+// with and without a depth pre-pass
+//
+// Draws the frame's geometry on the software rasterizer with
+// no pixel shader and counts the fragments that would have
+// been shaded:
+//  - Without the pre-pass, every fragment that passes LESS
+//    at the time it's drawn, so overdraw pays in full
+//  - With it, opaque draws first lay down depth on their
+//    own, then draw again with EQUAL and no depth writes, so
+//    only the nearest fragment of each pixel is shaded
+// Draws that aren't opaque (fading platforms) blend, so they
+// stay out of the pre-pass and draw with LESS either way.
+// --------------------------------------------------------
+
+// Matrices are the transposed ones uploaded to the shaders,
+// like SoftwareShaders.h
+struct ShadingCostDraw {
+	const float* Positions;		// float3 each
+	unsigned int PositionCount;
+	const unsigned int* Indices;
+	unsigned int IndexCount;
+	float World[16];
+	bool Opaque;
+};
+
+struct ShadingCost {
+	long long Shaded;				// Pixel shader runs without the pre-pass
+	long long ShadedWithPrepass;	// And with it
+	long long PrepassPixels;		// Depth only fragments the pre-pass wrote
+};
+
+// Draws are in the order the frame draws them
+ShadingCost EstimateShadingCost(
+	SoftwareRasterizer& rasterizer,
+	int width, int height,
+	const float* view, const float* projection,
+	const std::vector<ShadingCostDraw>& draws);
@@ -0,0 +1,197 @@
+#include "ShadowCascades.h"
+#include <math.h>
+
+static float Dot(const float a[3], const float b[3])
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void Cross(const float a[3], const float b[3], float out[3])
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static bool Normalize(float v[3])
+{
+	float length = sqrtf(Dot(v, v));
+	if (length < 1e-6f)
+		return false;
+
+	v[0] /= length;
+	v[1] /= length;
+	v[2] /= length;
+	return true;
+}
+
+static void Multiply(const float a[16], const float b[16], float out[16])
+{
+	for (int r = 0; r < 4; r++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			out[r * 4 + c] =
+				a[r * 4 + 0] * b[0 * 4 + c] +
+				a[r * 4 + 1] * b[1 * 4 + c] +
+				a[r * 4 + 2] * b[2 * 4 + c] +
+				a[r * 4 + 3] * b[3 * 4 + c];
+		}
+	}
+}
+
+void ComputeCascadeSplits(float nearClip, float farClip, int count, float lambda, float* splits)
+{
+	splits[0] = nearClip;
+	for (int i = 1; i < count; i++)
+	{
+		float t = (float)i / count;
+		float logSplit = nearClip * powf(farClip / nearClip, t);
+		float uniformSplit = nearClip + (farClip - nearClip) * t;
+		splits[i] = lambda * logSplit + (1.0f - lambda) * uniformSplit;
+	}
+	splits[count] = farClip;
+}
+
+int FitShadowCascades(
+	const ShadowCameraDesc& camera,
+	const float lightDirection[3],
+	const ShadowCascadeSettings& settings,
+	ShadowCascade* cascades)
+{
+	int count = settings.CascadeCount;
+	if (count < 1 || count > MaxShadowCascades || settings.MapSize == 0 ||
+		camera.NearClip <= 0.0f || camera.FarClip <= camera.NearClip)
+		return 0;
+
+	// Light basis - any up works as long as it isn't parallel to the light
+	float lightZ[3] = { lightDirection[0], lightDirection[1], lightDirection[2] };
+	if (!Normalize(lightZ))
+		return 0;
+
+	float up[3] = { 0.0f, 1.0f, 0.0f };
+	if (fabsf(lightZ[1]) > 0.99f)
+	{
+		up[1] = 0.0f;
+		up[2] = 1.0f;
+	}
+
+	float lightX[3];
+	float lightY[3];
+	Cross(up, lightZ, lightX);
+	Normalize(lightX);
+	Cross(lightZ, lightX, lightY);
+
+	float forward[3] = { camera.Forward[0], camera.Forward[1], camera.Forward[2] };
+	if (!Normalize(forward))
+		return 0;
+
+	// Ratio of a frustum slice's half diagonal to its depth
+	float tanHalfFov = tanf(camera.FieldOfView * 0.5f);
+	float diagonal = tanHalfFov * sqrtf(1.0f + camera.AspectRatio * camera.AspectRatio);
+	float diagonalSq = diagonal * diagonal;
+
+	float splits[MaxShadowCascades + 1];
+	ComputeCascadeSplits(camera.NearClip, camera.FarClip, count, settings.SplitLambda, splits);
+
+	for (int i = 0; i < count; i++)
+	{
+		ShadowCascade& cascade = cascades[i];
+		float n = splits[i];
+		float f = splits[i + 1];
+		cascade.SplitNear = n;
+		cascade.SplitFar = f;
+
+		// Smallest sphere around the slice has its center on the view
+		// axis, where the near and far corners are equally far away.
+		// Wide slices push that point past the far plane, in which case
+		// the far corners alone decide.
+		float centerDepth = 0.5f * (f + n) * (1.0f + diagonalSq);
+		float radius;
+		if (centerDepth >= f)
+		{
+			centerDepth = f;
+			radius = f * diagonal;
+		}
+		else
+		{
+			float toFar = f - centerDepth;
+			radius = sqrtf(toFar * toFar + f * f * diagonalSq);
+		}
+
+		// Round up so float noise can't change the size between frames
+		radius = ceilf(radius * 16.0f) / 16.0f;
+
+		float center[3];
+		for (int c = 0; c < 3; c++)
+			center[c] = camera.Position[c] + forward[c] * centerDepth;
+
+		// Snap the center to whole texels across the light's view
+		float texelSize = 2.0f * radius / settings.MapSize;
+		float x = floorf(Dot(center, lightX) / texelSize) * texelSize;
+		float y = floorf(Dot(center, lightY) / texelSize) * texelSize;
+		float z = Dot(center, lightZ);
+		for (int c = 0; c < 3; c++)
+			cascade.Center[c] = lightX[c] * x + lightY[c] * y + lightZ[c] * z;
+		cascade.Radius = radius;
+
+		// Light sits behind the sphere, looking along lightZ
+		float back = radius + settings.CasterDistance;
+		float eye[3];
+		for (int c = 0; c < 3; c++)
+			eye[c] = cascade.Center[c] - lightZ[c] * back;
+
+		float* v = cascade.View;
+		v[0] = lightX[0];	v[1] = lightY[0];	v[2] = lightZ[0];	v[3] = 0.0f;
+		v[4] = lightX[1];	v[5] = lightY[1];	v[6] = lightZ[1];	v[7] = 0.0f;
+		v[8] = lightX[2];	v[9] = lightY[2];	v[10] = lightZ[2];	v[11] = 0.0f;
+		v[12] = -Dot(lightX, eye);
+		v[13] = -Dot(lightY, eye);
+		v[14] = -Dot(lightZ, eye);
+		v[15] = 1.0f;
+
+		// Orthographic from the eye to the far side of the sphere
+		float depth = back + radius;
+		float* p = cascade.Projection;
+		for (int e = 0; e < 16; e++)
+			p[e] = 0.0f;
+		p[0] = 1.0f / radius;
+		p[5] = 1.0f / radius;
+		p[10] = 1.0f / depth;
+		p[15] = 1.0f;
+
+		Multiply(cascade.View, cascade.Projection, cascade.ViewProjection);
+	}
+
+	return count;
+}
+
+bool ShadowCascadeTouchesSphere(const ShadowCascade& cascade, const float center[3], float radius)
+{
+	const float* v = cascade.View;
+	float x = center[0] * v[0] + center[1] * v[4] + center[2] * v[8] + v[12];
+	float y = center[0] * v[1] + center[1] * v[5] + center[2] * v[9] + v[13];
+	float z = center[0] * v[2] + center[1] * v[6] + center[2] * v[10] + v[14];
+
+	float extent = cascade.Radius + radius;
+	if (fabsf(x) > extent || fabsf(y) > extent)
+		return false;
+
+	// Past the far plane.  Nothing is too close - see above.
+	float depth = 1.0f / cascade.Projection[10];
+	return z - radius <= depth;
+}
+
+void BuildShadowCascadeConstants(const ShadowCascade* cascades, int count, ShadowCascadeConstants& constants)
+{
+	constants = {};
+	constants.Count = count;
+	for (int i = 0; i < count; i++)
+	{
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				constants.ViewProjection[i][c * 4 + r] = cascades[i].ViewProjection[r * 4 + c];
+
+		constants.Splits[i] = cascades[i].SplitFar;
+	}
+}
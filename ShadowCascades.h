@@ -0,0 +1,92 @@
+#pragma once
+
+// --------------------------------------------------------
+// CPU side fitting for cascaded shadow maps
+//
+// Float math only (no D3D, no DirectXMath) so the cascade
+// bounds can be checked without a device.  Matrices use the
+// same row-vector layout as XMMATRIX and still need to be
+// transposed before they go to a shader.
+// --------------------------------------------------------
+
+// Most cascades the shaders' constant buffers can hold
+const int MaxShadowCascades = 4;
+
+// --------------------------------------------------------
+// What the cascades are fitted to.  Basis vectors are the
+// camera's world space axes (left handed, forward = +Z).
+// --------------------------------------------------------
+struct ShadowCameraDesc {
+	float Position[3];
+	float Forward[3];
+	float Up[3];
+	float FieldOfView;		// Vertical, in radians
+	float AspectRatio;
+	float NearClip;
+	float FarClip;			// Shadows end here, may be closer than the camera's far plane
+};
+
+struct ShadowCascadeSettings {
+	int CascadeCount;		// 1 - MaxShadowCascades
+	float SplitLambda;		// 0 = uniform splits, 1 = logarithmic
+	unsigned int MapSize;	// Texels per side of each cascade
+	float CasterDistance;	// Extra room behind each cascade for casters outside the view
+};
+
+// --------------------------------------------------------
+// One fitted cascade
+//
+// The cascade covers a bounding sphere of its slice of the
+// view frustum.  The sphere's radius only depends on the
+// split distances and the lens, so it doesn't change as
+// the camera turns, and the center is snapped to whole
+// texels in light space so it doesn't crawl as the camera
+// moves.  Together that keeps shadow edges from shimmering.
+// --------------------------------------------------------
+struct ShadowCascade {
+	float SplitNear;		// View depth range this cascade is used for
+	float SplitFar;
+	float Center[3];		// Snapped bounding sphere, world space
+	float Radius;
+	float View[16];
+	float Projection[16];
+	float ViewProjection[16];
+};
+
+// --------------------------------------------------------
+// What the pixel shader's ShadowData buffer needs, already
+// transposed for HLSL
+// --------------------------------------------------------
+struct ShadowCascadeConstants {
+	float ViewProjection[MaxShadowCascades][16];
+	float Splits[MaxShadowCascades];		// Far view depth of each cascade
+	int Count;
+};
+
+// --------------------------------------------------------
+// Practical split scheme - each split is a lambda blend of
+// the logarithmic and uniform split at that index.  Writes
+// count + 1 distances, from nearClip to farClip.
+// --------------------------------------------------------
+void ComputeCascadeSplits(float nearClip, float farClip, int count, float lambda, float* splits);
+
+// --------------------------------------------------------
+// Fits every cascade for this frame.  lightDirection is the
+// direction the light travels.  Returns the cascade count,
+// or 0 if the settings are out of range.
+// --------------------------------------------------------
+int FitShadowCascades(
+	const ShadowCameraDesc& camera,
+	const float lightDirection[3],
+	const ShadowCascadeSettings& settings,
+	ShadowCascade* cascades);
+
+// --------------------------------------------------------
+// Whether a caster with this world space bounding sphere
+// can put a shadow into the cascade.  Casters between the
+// light and the cascade still count - they are flattened
+// onto the near plane when the map is drawn.
+// --------------------------------------------------------
+bool ShadowCascadeTouchesSphere(const ShadowCascade& cascade, const float center[3], float radius);
+
+void BuildShadowCascadeConstants(const ShadowCascade* cascades, int count, ShadowCascadeConstants& constants);
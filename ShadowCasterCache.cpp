@@ -0,0 +1,105 @@
+#include "ShadowCasterCache.h"
+#include <string.h>
+
+ShadowCasterCache::ShadowCasterCache(int settleFrames)
+{
+	this->settleFrames = settleFrames;
+	stats = {};
+	Invalidate();
+}
+
+ShadowCasterCache::~ShadowCasterCache()
+{
+}
+
+int ShadowCasterCache::AddCaster()
+{
+	Caster caster = {};
+	caster.Seen = false;
+	casters.push_back(caster);
+	return (int)casters.size() - 1;
+}
+
+void ShadowCasterCache::BeginFrame()
+{
+	stats = {};
+}
+
+void ShadowCasterCache::UpdateCaster(int caster, const float world[16], const float center[3], float radius)
+{
+	Caster& c = casters[caster];
+	bool wasStatic = IsStatic(caster);
+
+	if (c.Seen && memcmp(c.World, world, sizeof(c.World)) == 0)
+	{
+		if (c.StillFrames < settleFrames)
+			c.StillFrames++;
+	}
+	else
+	{
+		c.StillFrames = 0;
+	}
+
+	memcpy(c.World, world, sizeof(c.World));
+	memcpy(c.Center, center, sizeof(c.Center));
+	c.Radius = radius;
+	c.Seen = true;
+
+	// Joining or leaving the static set changes what the
+	// cached layers should hold
+	if (wasStatic != IsStatic(caster))
+		Invalidate();
+}
+
+void ShadowCasterCache::PlanCascade(int cascade, const ShadowCascade& fit, ShadowCascadePlan& plan)
+{
+	plan.StaticCasters.clear();
+	plan.DynamicCasters.clear();
+
+	for (int i = 0; i < (int)casters.size(); i++)
+	{
+		Caster& c = casters[i];
+		if (!ShadowCascadeTouchesSphere(fit, c.Center, c.Radius))
+		{
+			stats.Culled++;
+			continue;
+		}
+
+		if (IsStatic(i))
+			plan.StaticCasters.push_back(i);
+		else
+			plan.DynamicCasters.push_back(i);
+	}
+
+	CachedCascade& layer = cached[cascade];
+	bool sameFit =
+		memcmp(layer.View, fit.View, sizeof(layer.View)) == 0 &&
+		memcmp(layer.Projection, fit.Projection, sizeof(layer.Projection)) == 0;
+
+	// Nothing static to cache, so a plain clear is cheaper than a copy
+	plan.UseCache = !plan.StaticCasters.empty();
+	plan.RebuildCache = plan.UseCache && !(layer.Valid && sameFit);
+
+	if (plan.RebuildCache)
+	{
+		stats.CacheRebuilds++;
+		stats.Drawn += (int)plan.StaticCasters.size();
+	}
+	else
+	{
+		stats.Cached += (int)plan.StaticCasters.size();
+	}
+	stats.Drawn += (int)plan.DynamicCasters.size();
+
+	// A cascade without static casters has an empty layer, which
+	// goes stale as soon as one shows up
+	layer.Valid = plan.UseCache;
+	memcpy(layer.View, fit.View, sizeof(layer.View));
+	memcpy(layer.Projection, fit.Projection, sizeof(layer.Projection));
+}
+
+void ShadowCasterCache::Invalidate()
+{
+	for (int i = 0; i < MaxShadowCascades; i++)
+		cached[i].Valid = false;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include "ShadowCascades.h"
+
+// --------------------------------------------------------
+// What RenderShadowMap has to do for one cascade this frame
+// --------------------------------------------------------
+struct ShadowCascadePlan {
+	bool UseCache;				// Start from the cached static layer instead of a clear
+	bool RebuildCache;			// Redraw StaticCasters into the cache first
+	std::vector<int> StaticCasters;
+	std::vector<int> DynamicCasters;	// Drawn on top every frame
+};
+
+// Per frame counters, summed over every cascade
+struct ShadowCasterStats {
+	int Drawn;			// Draw calls actually issued
+	int Culled;			// Caster can't reach the cascade
+	int Cached;			// Static caster served from the cache
+	int CacheRebuilds;	// Cascades whose static layer was redrawn
+};
+
+// --------------------------------------------------------
+// Decides which shadow casters get drawn into which cascade,
+// and which of them can come from a cached static layer
+//
+// A caster counts as static once its world matrix has stayed
+// the same for settleFrames frames.  Each cascade keeps a
+// depth layer holding only the static casters, which stays
+// valid until the cascade's matrices change (camera or light
+// moved far enough to shift it a texel) or a caster joins or
+// leaves the static set.  Dynamic casters are drawn on top of
+// a copy of that layer every frame.
+//
+// No D3D in here - the caller owns the depth targets and does
+// the drawing, so the bookkeeping runs on any platform.
+// --------------------------------------------------------
+class ShadowCasterCache {
+public:
+	ShadowCasterCache(int settleFrames = 30);
+	~ShadowCasterCache();
+
+	// Returns the caster's index
+	int AddCaster();
+	int GetCasterCount() { return (int)casters.size(); }
+	bool IsStatic(int caster) { return casters[caster].StillFrames >= settleFrames; }
+
+	// Call once per frame, before anything else
+	void BeginFrame();
+
+	// Call for every caster each frame.  world is the caster's
+	// world matrix, center and radius its world space bounds.
+	void UpdateCaster(int caster, const float world[16], const float center[3], float radius);
+
+	void PlanCascade(int cascade, const ShadowCascade& fit, ShadowCascadePlan& plan);
+
+	// Forget every cached layer, e.g. after recreating the targets
+	void Invalidate();
+
+	const ShadowCasterStats& GetStats() { return stats; }
+
+private:
+	struct Caster {
+		float World[16];
+		float Center[3];
+		float Radius;
+		int StillFrames;
+		bool Seen;
+	};
+
+	struct CachedCascade {
+		bool Valid;
+		float View[16];
+		float Projection[16];
+	};
+
+	int settleFrames;
+	std::vector<Caster> casters;
+	CachedCascade cached[MaxShadowCascades];
+	ShadowCasterStats stats;
+};
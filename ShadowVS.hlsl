@@ -6,12 +6,10 @@ cbuffer externalData : register(b0)
 	matrix projection;
 };
 
+// Reads the mesh's position stream, not the full vertices
 struct VertexShaderInput
 {
 	float3 position		: POSITION;
-	float2 uv			: TEXCOORD;
-	float3 normal		: NORMAL;
-	float3 tangent		: TANGENT;
 };
 
 struct VertexToPixel
@@ -23,8 +21,11 @@ VertexToPixel main(VertexShaderInput input)
 {
 	VertexToPixel output;
 
-	matrix worldViewProj = mul(mul(world, view), projection);
-	output.position = mul(float4(input.position, 1.0f), worldViewProj);
+	// precise, and the same math as the scene's vertex shaders,
+	// so the depth pre-pass matches them exactly for EQUAL
+	precise matrix worldViewProj = mul(mul(world, view), projection);
+	precise float4 position = mul(float4(input.position, 1.0f), worldViewProj);
+	output.position = position;
 
 	return output;
 }
\ No newline at end of file
@@ -101,7 +101,16 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 	refl->GetDesc(&shaderDesc);
 
 	// Create resource arrays
-	constantBufferCount = shaderDesc.ConstantBuffers;
+	// Structured buffers are listed with the constant buffers
+	// too, but they're bound as shader resources (below)
+	constantBufferCount = 0;
+	for (unsigned int b = 0; b < shaderDesc.ConstantBuffers; b++)
+	{
+		D3D11_SHADER_BUFFER_DESC bufferDesc;
+		refl->GetConstantBufferByIndex(b)->GetDesc(&bufferDesc);
+		if (bufferDesc.Type == D3D_CT_CBUFFER)
+			constantBufferCount++;
+	}
 	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
 	
 	// Handle bound resources (like shaders and samplers)
@@ -116,6 +125,8 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		switch (resourceDesc.Type)
 		{
 		case D3D_SIT_TEXTURE: // A texture resource
+		case D3D_SIT_STRUCTURED: // Bound the same way as a texture
+		case D3D_SIT_BYTEADDRESS:
 		{
 			// Create the SRV wrapper
 			SimpleSRV* srv = new SimpleSRV();
@@ -142,15 +153,17 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 	}
 
 	// Loop through all constant buffers
-	for (unsigned int b = 0; b < constantBufferCount; b++)
+	for (unsigned int r = 0, b = 0; r < shaderDesc.ConstantBuffers; r++)
 	{
 		// Get this buffer
 		ID3D11ShaderReflectionConstantBuffer* cb =
-			refl->GetConstantBufferByIndex(b);
+			refl->GetConstantBufferByIndex(r);
 		
 		// Get the description of this buffer
 		D3D11_SHADER_BUFFER_DESC bufferDesc;
 		cb->GetDesc(&bufferDesc);
+		if (bufferDesc.Type != D3D_CT_CBUFFER)
+			continue;
 		
 		// Get the description of the resource binding, so
 		// we know exactly how it's bound in the shader
@@ -201,6 +214,7 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
 			constantBuffers[b].Variables.push_back(varStruct);
 		}
+		b++;
 	}
 
 	// All set
@@ -0,0 +1,594 @@
+#include "SoftwareRasterizer.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+SoftwareDrawState SoftwareDefaultState(int varyingCount)
+{
+	SoftwareDrawState state = {};
+	state.VaryingCount = varyingCount;
+	state.CullMode = SoftwareCullBack;
+	state.DepthTest = true;
+	state.DepthFunc = SoftwareDepthLess;
+	state.DepthWrite = true;
+	state.DepthClip = true;
+	state.DepthBias = 0.0f;
+	state.ColorWrite = true;
+	state.BlendMode = SoftwareBlendNone;
+	return state;
+}
+
+static float Saturate(float value)
+{
+	return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+static bool DepthPasses(SoftwareDepthFunc func, float z, float depth)
+{
+	switch (func)
+	{
+	case SoftwareDepthLessEqual: return z <= depth;
+	case SoftwareDepthEqual: return z == depth;
+	default: return z < depth;
+	}
+}
+
+// --------------------------------------------------------
+// SoftwareTarget
+// --------------------------------------------------------
+
+SoftwareTarget::SoftwareTarget(int width, int height)
+{
+	this->width = width;
+	this->height = height;
+	color.resize((size_t)width * height * 4, 0.0f);
+	depth.resize((size_t)width * height, 1.0f);
+}
+
+SoftwareTarget::~SoftwareTarget()
+{
+}
+
+void SoftwareTarget::ClearColor(const float clearColor[4])
+{
+	for (size_t i = 0; i < color.size(); i += 4)
+	{
+		for (int c = 0; c < 4; c++)
+			color[i + c] = Saturate(clearColor[c]);
+	}
+}
+
+void SoftwareTarget::ClearDepth(float clearDepth)
+{
+	std::fill(depth.begin(), depth.end(), clearDepth);
+}
+
+bool SoftwareTarget::SaveTGA(const std::string& path)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	// Uncompressed true color, 32 bits, 8 of them alpha, top-left origin
+	unsigned char header[18] = {};
+	header[2] = 2;
+	header[12] = (unsigned char)(width & 0xFF);
+	header[13] = (unsigned char)(width >> 8);
+	header[14] = (unsigned char)(height & 0xFF);
+	header[15] = (unsigned char)(height >> 8);
+	header[16] = 32;
+	header[17] = 0x28;
+	file.write((const char*)header, sizeof(header));
+
+	std::vector<unsigned char> row((size_t)width * 4);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			const float* pixel = GetColor(x, y);
+			row[x * 4 + 0] = (unsigned char)(pixel[2] * 255.0f + 0.5f);
+			row[x * 4 + 1] = (unsigned char)(pixel[1] * 255.0f + 0.5f);
+			row[x * 4 + 2] = (unsigned char)(pixel[0] * 255.0f + 0.5f);
+			row[x * 4 + 3] = (unsigned char)(pixel[3] * 255.0f + 0.5f);
+		}
+		file.write((const char*)row.data(), row.size());
+	}
+
+	return file.good();
+}
+
+bool SoftwareTarget::LoadTGA(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	// Only reads back what SaveTGA writes
+	unsigned char header[18];
+	if (!file.read((char*)header, sizeof(header)) || header[2] != 2 || header[16] != 32)
+		return false;
+
+	int fileWidth = header[12] | (header[13] << 8);
+	int fileHeight = header[14] | (header[15] << 8);
+	bool topDown = (header[17] & 0x20) != 0;
+	file.ignore(header[0]);
+
+	*this = SoftwareTarget(fileWidth, fileHeight);
+
+	std::vector<unsigned char> row((size_t)width * 4);
+	for (int i = 0; i < height; i++)
+	{
+		if (!file.read((char*)row.data(), row.size()))
+			return false;
+
+		int y = topDown ? i : height - 1 - i;
+		for (int x = 0; x < width; x++)
+		{
+			float* pixel = GetColor(x, y);
+			pixel[0] = row[x * 4 + 2] / 255.0f;
+			pixel[1] = row[x * 4 + 1] / 255.0f;
+			pixel[2] = row[x * 4 + 0] / 255.0f;
+			pixel[3] = row[x * 4 + 3] / 255.0f;
+		}
+	}
+
+	return true;
+}
+
+int SoftwareTarget::CountDifferences(SoftwareTarget& other, int tolerance)
+{
+	if (other.width != width || other.height != height)
+		return -1;
+
+	int differences = 0;
+	for (size_t i = 0; i < color.size(); i += 4)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			int a = (int)(color[i + c] * 255.0f + 0.5f);
+			int b = (int)(other.color[i + c] * 255.0f + 0.5f);
+			if (abs(a - b) > tolerance)
+			{
+				differences++;
+				break;
+			}
+		}
+	}
+	return differences;
+}
+
+// --------------------------------------------------------
+// SoftwareRasterizer
+// --------------------------------------------------------
+
+SoftwareRasterizer::SoftwareRasterizer(int threadCount)
+{
+	target = 0;
+	stats = {};
+	job = 0;
+	jobCount = 0;
+	nextJob = 0;
+	busyWorkers = 0;
+	generation = 0;
+	quit = false;
+
+	if (threadCount <= 0)
+		threadCount = std::max((int)std::thread::hardware_concurrency(), 1);
+
+	// The calling thread works too
+	for (int i = 1; i < threadCount; i++)
+		workers.push_back(std::thread(&SoftwareRasterizer::WorkerLoop, this));
+}
+
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		quit = true;
+	}
+	jobStart.notify_all();
+
+	for (auto& worker : workers)
+		worker.join();
+}
+
+void SoftwareRasterizer::DrawIndexed(
+	const SoftwareDrawState& state,
+	const void* vertices,
+	unsigned int stride,
+	unsigned int vertexCount,
+	const unsigned int* indices,
+	unsigned int indexCount,
+	const SoftwareVertexShader& vertexShader,
+	const SoftwarePixelShader& pixelShader)
+{
+	if (!target || state.VaryingCount < 0 || state.VaryingCount > SoftwareMaxVaryings)
+		return;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Vertex shading, in chunks across the pool
+	const int chunk = 256;
+	shadedVertices.resize(vertexCount);
+	const unsigned char* bytes = (const unsigned char*)vertices;
+	std::function<void(int)> shadeChunk = [&](int c) {
+		unsigned int end = std::min((unsigned int)(c + 1) * chunk, vertexCount);
+		for (unsigned int v = c * chunk; v < end; v++)
+			vertexShader(bytes + (size_t)v * stride, shadedVertices[v]);
+	};
+	ParallelFor((vertexCount + chunk - 1) / chunk, shadeChunk);
+
+	// Primitive assembly, clipping and setup - in order, so the
+	// triangle list keeps submission order
+	triangles.clear();
+	for (unsigned int i = 0; i + 2 < indexCount; i += 3)
+	{
+		if (indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount)
+			continue;
+
+		ClipTriangle(state,
+			shadedVertices[indices[i]],
+			shadedVertices[indices[i + 1]],
+			shadedVertices[indices[i + 2]]);
+	}
+	stats.TrianglesSubmitted += indexCount / 3;
+	stats.TrianglesRasterized += triangles.size();
+
+	// Bin into tiles
+	int tilesX = (target->GetWidth() + TileSize - 1) / TileSize;
+	int tilesY = (target->GetHeight() + TileSize - 1) / TileSize;
+	tileTriangles.resize(tilesX * tilesY);
+	for (auto& list : tileTriangles)
+		list.clear();
+
+	for (int t = 0; t < (int)triangles.size(); t++)
+	{
+		Triangle& tri = triangles[t];
+		for (int ty = tri.MinY / TileSize; ty <= tri.MaxY / TileSize; ty++)
+			for (int tx = tri.MinX / TileSize; tx <= tri.MaxX / TileSize; tx++)
+				tileTriangles[ty * tilesX + tx].push_back(t);
+	}
+
+	// Shade the tiles
+	std::atomic<long long> pixelsTested(0);
+	std::atomic<long long> pixelsShaded(0);
+	std::function<void(int)> shadeTile = [&](int tile) {
+		if (tileTriangles[tile].empty())
+			return;
+
+		long long tested = 0;
+		long long shaded = 0;
+		RasterizeTile(state, pixelShader, tile, tested, shaded);
+		pixelsTested += tested;
+		pixelsShaded += shaded;
+	};
+	ParallelFor(tilesX * tilesY, shadeTile);
+
+	stats.PixelsTested += pixelsTested;
+	stats.PixelsShaded += pixelsShaded;
+	stats.Seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void SoftwareRasterizer::ClipTriangle(const SoftwareDrawState& state, const SoftwareVertex& a, const SoftwareVertex& b, const SoftwareVertex& c)
+{
+	// Anything with w near 0 can't be divided, and a guard band
+	// keeps screen coordinates small enough for float edge math.
+	// With depth clip on, near and far clip as well.
+	const float epsilon = 1e-5f;
+	const float guard = 16.0f;
+	const int maxVerts = 3 + 7;
+
+	SoftwareVertex buffers[2][maxVerts];
+	int count = 3;
+	buffers[0][0] = a;
+	buffers[0][1] = b;
+	buffers[0][2] = c;
+
+	bool inside = true;
+	for (int v = 0; v < 3; v++)
+	{
+		const float* p = buffers[0][v].Position;
+		if (p[3] < epsilon || fabsf(p[0]) > guard * p[3] || fabsf(p[1]) > guard * p[3] ||
+			(state.DepthClip && (p[2] < 0.0f || p[2] > p[3])))
+			inside = false;
+	}
+
+	int current = 0;
+	if (!inside)
+	{
+		int planeCount = state.DepthClip ? 7 : 5;
+		for (int plane = 0; plane < planeCount && count > 0; plane++)
+		{
+			SoftwareVertex* in = buffers[current];
+			SoftwareVertex* out = buffers[1 - current];
+			int outCount = 0;
+
+			for (int v = 0; v < count; v++)
+			{
+				const SoftwareVertex& p0 = in[v];
+				const SoftwareVertex& p1 = in[(v + 1) % count];
+
+				float d[2];
+				const SoftwareVertex* ends[2] = { &p0, &p1 };
+				for (int e = 0; e < 2; e++)
+				{
+					const float* p = ends[e]->Position;
+					switch (plane)
+					{
+					case 0: d[e] = p[3] - epsilon; break;
+					case 1: d[e] = guard * p[3] - p[0]; break;
+					case 2: d[e] = guard * p[3] + p[0]; break;
+					case 3: d[e] = guard * p[3] - p[1]; break;
+					case 4: d[e] = guard * p[3] + p[1]; break;
+					case 5: d[e] = p[2]; break;
+					default: d[e] = p[3] - p[2]; break;
+					}
+				}
+
+				if (d[0] >= 0.0f)
+					out[outCount++] = p0;
+
+				if ((d[0] >= 0.0f) != (d[1] >= 0.0f))
+				{
+					float t = d[0] / (d[0] - d[1]);
+					SoftwareVertex& mid = out[outCount++];
+					for (int k = 0; k < 4; k++)
+						mid.Position[k] = p0.Position[k] + (p1.Position[k] - p0.Position[k]) * t;
+					for (int k = 0; k < state.VaryingCount; k++)
+						mid.Varyings[k] = p0.Varyings[k] + (p1.Varyings[k] - p0.Varyings[k]) * t;
+				}
+			}
+
+			count = outCount;
+			current = 1 - current;
+		}
+	}
+
+	// Fan the clipped polygon back into triangles
+	for (int v = 1; v + 1 < count; v++)
+	{
+		const SoftwareVertex* tri[3] = { &buffers[current][0], &buffers[current][v], &buffers[current][v + 1] };
+		SetupTriangle(state, tri);
+	}
+}
+
+void SoftwareRasterizer::SetupTriangle(const SoftwareDrawState& state, const SoftwareVertex* clipped[3])
+{
+	float width = (float)target->GetWidth();
+	float height = (float)target->GetHeight();
+
+	Triangle tri;
+	for (int v = 0; v < 3; v++)
+	{
+		const float* p = clipped[v]->Position;
+		float invW = 1.0f / p[3];
+		tri.FixedX[v] = (int)floorf((p[0] * invW + 1.0f) * 0.5f * width * SubpixelSteps + 0.5f);
+		tri.FixedY[v] = (int)floorf((1.0f - p[1] * invW) * 0.5f * height * SubpixelSteps + 0.5f);
+		tri.X[v] = tri.FixedX[v] / (float)SubpixelSteps;
+		tri.Y[v] = tri.FixedY[v] / (float)SubpixelSteps;
+		tri.Z[v] = p[2] * invW;
+		tri.InvW[v] = invW;
+		for (int k = 0; k < state.VaryingCount; k++)
+			tri.Varyings[v][k] = clipped[v]->Varyings[k] * invW;
+	}
+
+	// Positive area is clockwise on screen, which is front facing
+	long long area = (long long)(tri.FixedX[1] - tri.FixedX[0]) * (tri.FixedY[2] - tri.FixedY[0]) -
+		(long long)(tri.FixedX[2] - tri.FixedX[0]) * (tri.FixedY[1] - tri.FixedY[0]);
+	if (area == 0 ||
+		(state.CullMode == SoftwareCullBack && area < 0) ||
+		(state.CullMode == SoftwareCullFront && area > 0))
+		return;
+
+	// Rasterize everything as clockwise
+	if (area < 0)
+	{
+		std::swap(tri.X[1], tri.X[2]);
+		std::swap(tri.Y[1], tri.Y[2]);
+		std::swap(tri.FixedX[1], tri.FixedX[2]);
+		std::swap(tri.FixedY[1], tri.FixedY[2]);
+		std::swap(tri.Z[1], tri.Z[2]);
+		std::swap(tri.InvW[1], tri.InvW[2]);
+		for (int k = 0; k < state.VaryingCount; k++)
+			std::swap(tri.Varyings[1][k], tri.Varyings[2][k]);
+	}
+
+	// Pixels whose centers can land inside
+	float minX = std::min(tri.X[0], std::min(tri.X[1], tri.X[2]));
+	float maxX = std::max(tri.X[0], std::max(tri.X[1], tri.X[2]));
+	float minY = std::min(tri.Y[0], std::min(tri.Y[1], tri.Y[2]));
+	float maxY = std::max(tri.Y[0], std::max(tri.Y[1], tri.Y[2]));
+	tri.MinX = std::max((int)ceilf(minX - 0.5f), 0);
+	tri.MinY = std::max((int)ceilf(minY - 0.5f), 0);
+	tri.MaxX = std::min((int)floorf(maxX - 0.5f), target->GetWidth() - 1);
+	tri.MaxY = std::min((int)floorf(maxY - 0.5f), target->GetHeight() - 1);
+	if (tri.MinX > tri.MaxX || tri.MinY > tri.MaxY)
+		return;
+
+	triangles.push_back(tri);
+}
+
+void SoftwareRasterizer::RasterizeTile(
+	const SoftwareDrawState& state,
+	const SoftwarePixelShader& pixelShader,
+	int tile,
+	long long& pixelsTested,
+	long long& pixelsShaded)
+{
+	int tilesX = (target->GetWidth() + TileSize - 1) / TileSize;
+	int tileX = (tile % tilesX) * TileSize;
+	int tileY = (tile / tilesX) * TileSize;
+
+	float varyings[SoftwareMaxVaryings];
+	float color[4];
+
+	for (int t : tileTriangles[tile])
+	{
+		const Triangle& tri = triangles[t];
+
+		int x0 = std::max(tri.MinX, tileX);
+		int y0 = std::max(tri.MinY, tileY);
+		int x1 = std::min(tri.MaxX, tileX + TileSize - 1);
+		int y1 = std::min(tri.MaxY, tileY + TileSize - 1);
+
+		// Edge i is opposite vertex i.  Top-left rule: a pixel center
+		// exactly on an edge only counts for top and left edges.
+		// In fixed point an edge shared by two triangles comes out
+		// exactly negated in the other one, so no pixel along it
+		// is drawn twice or missed.
+		long long edgeX[3], edgeY[3], dx[3], dy[3];
+		bool topLeft[3];
+		for (int e = 0; e < 3; e++)
+		{
+			int from = (e + 1) % 3;
+			int to = (e + 2) % 3;
+			edgeX[e] = tri.FixedX[from];
+			edgeY[e] = tri.FixedY[from];
+			dx[e] = tri.FixedX[to] - tri.FixedX[from];
+			dy[e] = tri.FixedY[to] - tri.FixedY[from];
+			topLeft[e] = dy[e] < 0 || (dy[e] == 0 && dx[e] > 0);
+		}
+
+		long long area = dx[2] * (tri.FixedY[2] - tri.FixedY[0]) - dy[2] * (tri.FixedX[2] - tri.FixedX[0]);
+		float invArea = 1.0f / (float)area;
+
+		for (int y = y0; y <= y1; y++)
+		{
+			long long py = y * SubpixelSteps + SubpixelSteps / 2;
+			for (int x = x0; x <= x1; x++)
+			{
+				long long px = x * SubpixelSteps + SubpixelSteps / 2;
+
+				float weight[3];
+				bool covered = true;
+				for (int e = 0; e < 3 && covered; e++)
+				{
+					long long edge = dx[e] * (py - edgeY[e]) - dy[e] * (px - edgeX[e]);
+					covered = edge > 0 || (edge == 0 && topLeft[e]);
+					weight[e] = (float)edge * invArea;
+				}
+				if (!covered)
+					continue;
+
+				pixelsTested++;
+
+				// Relative to the first vertex, so a flat triangle's
+				// depth is exactly its own everywhere and coplanar
+				// draws compare equal
+				float z = tri.Z[0] + weight[1] * (tri.Z[1] - tri.Z[0]) + weight[2] * (tri.Z[2] - tri.Z[0]);
+				z = Saturate(z + state.DepthBias);
+
+				float* depth = target->GetDepth(x, y);
+				if (state.DepthTest && !DepthPasses(state.DepthFunc, z, *depth))
+					continue;
+
+				if (pixelShader)
+				{
+					float oneOverW = weight[0] * tri.InvW[0] + weight[1] * tri.InvW[1] + weight[2] * tri.InvW[2];
+					float w = 1.0f / oneOverW;
+					for (int k = 0; k < state.VaryingCount; k++)
+						varyings[k] = (weight[0] * tri.Varyings[0][k] + weight[1] * tri.Varyings[1][k] + weight[2] * tri.Varyings[2][k]) * w;
+
+					if (!pixelShader(varyings, color))
+						continue;
+				}
+
+				pixelsShaded++;
+
+				if (state.DepthWrite)
+					*depth = z;
+
+				if (!state.ColorWrite || !pixelShader)
+					continue;
+
+				// UNORM target - the source is clamped before blending
+				float* dest = target->GetColor(x, y);
+				for (int c = 0; c < 4; c++)
+					color[c] = Saturate(color[c]);
+
+				switch (state.BlendMode)
+				{
+				case SoftwareBlendAlpha:
+					for (int c = 0; c < 3; c++)
+						dest[c] = Saturate(color[c] * color[3] + dest[c] * (1.0f - color[3]));
+					dest[3] = 0.0f;
+					break;
+				case SoftwareBlendAdditive:
+					for (int c = 0; c < 4; c++)
+						dest[c] = Saturate(color[c] + dest[c]);
+					break;
+				default:
+					for (int c = 0; c < 4; c++)
+						dest[c] = color[c];
+					break;
+				}
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Worker pool - ParallelFor hands out indices from an atomic
+// counter and the calling thread takes some too
+// --------------------------------------------------------
+
+void SoftwareRasterizer::ParallelFor(int count, const std::function<void(int)>& function)
+{
+	if (workers.empty() || count <= 1)
+	{
+		for (int i = 0; i < count; i++)
+			function(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		job = &function;
+		jobCount = count;
+		nextJob = 0;
+		busyWorkers = (int)workers.size();
+		generation++;
+	}
+	jobStart.notify_all();
+
+	RunJobs();
+
+	std::unique_lock<std::mutex> lock(jobMutex);
+	jobDone.wait(lock, [this]() { return busyWorkers == 0; });
+	job = 0;
+}
+
+void SoftwareRasterizer::RunJobs()
+{
+	for (;;)
+	{
+		int i = nextJob++;
+		if (i >= jobCount)
+			break;
+		(*job)(i);
+	}
+}
+
+void SoftwareRasterizer::WorkerLoop()
+{
+	int seen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobStart.wait(lock, [this, seen]() { return quit || generation != seen; });
+			if (quit)
+				return;
+			seen = generation;
+		}
+
+		RunJobs();
+
+		std::lock_guard<std::mutex> lock(jobMutex);
+		if (--busyWorkers == 0)
+			jobDone.notify_one();
+	}
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// Reference software backend for the parts of the D3D11
+// pipeline this project uses, so rendering can be checked
+// without a device
+//
+// Covers indexed triangle lists, back/front face culling,
+// clipping, the LESS, LESS_EQUAL and EQUAL depth tests and
+// the blend states Game
+// creates.  Shaders are C++ functors (see SoftwareShaders.h
+// for ports of the real ones).  Rasterization follows the
+// D3D rules - pixel centers at +0.5, top-left fill rule,
+// perspective correct interpolation - so output should be
+// close to the hardware's.
+//
+// The target is split into tiles and the tiles are shaded
+// on a pool of threads.  Each tile draws its triangles in
+// submission order, so blending gives the same image on
+// any thread count.
+// --------------------------------------------------------
+
+// Most floats a vertex shader can pass to the pixel shader
+const int SoftwareMaxVaryings = 16;
+
+// What a vertex shader functor produces
+struct SoftwareVertex {
+	float Position[4];		// Clip space, like SV_POSITION
+	float Varyings[SoftwareMaxVaryings];
+};
+
+// vertex points at one element of the vertex buffer
+typedef std::function<void(const void* vertex, SoftwareVertex& out)> SoftwareVertexShader;
+
+// Gets the interpolated varyings, returns false to discard
+typedef std::function<bool(const float* varyings, float color[4])> SoftwarePixelShader;
+
+enum SoftwareCullMode {
+	SoftwareCullNone,
+	SoftwareCullBack,		// D3D11_CULL_BACK with clockwise front faces
+	SoftwareCullFront
+};
+
+enum SoftwareDepthFunc {
+	SoftwareDepthLess,
+	SoftwareDepthLessEqual,
+	SoftwareDepthEqual		// For drawing over a depth pre-pass
+};
+
+enum SoftwareBlendMode {
+	SoftwareBlendNone,
+	SoftwareBlendAlpha,		// Same as the fade state: SRC_ALPHA / INV_SRC_ALPHA, alpha written as 0
+	SoftwareBlendAdditive	// ONE / ONE on every channel, like the particles and bloom
+};
+
+struct SoftwareDrawState {
+	int VaryingCount;
+	SoftwareCullMode CullMode;
+	bool DepthTest;
+	SoftwareDepthFunc DepthFunc;
+	bool DepthWrite;
+	bool DepthClip;			// Off clamps depth to 0-1 instead of clipping
+	float DepthBias;		// Added to depth before the test
+	bool ColorWrite;		// Off for depth only passes like the shadow map
+	SoftwareBlendMode BlendMode;
+};
+
+// The D3D defaults - back face culling, depth test and write on
+SoftwareDrawState SoftwareDefaultState(int varyingCount);
+
+// --------------------------------------------------------
+// Color + depth target.  Color is stored as float RGBA and
+// clamped to 0-1 on write, like a UNORM target.
+// --------------------------------------------------------
+class SoftwareTarget {
+public:
+	SoftwareTarget(int width, int height);
+	~SoftwareTarget();
+
+	int GetWidth() const { return width; }
+	int GetHeight() const { return height; }
+
+	void ClearColor(const float color[4]);
+	void ClearDepth(float depth);
+
+	float* GetColor(int x, int y) { return &color[(y * width + x) * 4]; }
+	float* GetDepth(int x, int y) { return &depth[y * width + x]; }
+	const float* GetColor(int x, int y) const { return &color[(y * width + x) * 4]; }
+	const float* GetDepth(int x, int y) const { return &depth[y * width + x]; }
+
+	// 8 bit per channel uncompressed TGA, for golden images
+	bool SaveTGA(const std::string& path);
+	bool LoadTGA(const std::string& path);
+
+	// Pixels whose 8 bit color differs by more than tolerance in
+	// any channel, or -1 if the sizes don't match
+	int CountDifferences(SoftwareTarget& other, int tolerance);
+
+private:
+	int width;
+	int height;
+	std::vector<float> color;
+	std::vector<float> depth;
+};
+
+struct SoftwareRasterizerStats {
+	long long TrianglesSubmitted;
+	long long TrianglesRasterized;	// Survived culling and clipping
+	long long PixelsTested;			// Covered, before the depth test
+	long long PixelsShaded;			// Pixel shader ran
+	double Seconds;
+
+	double TrianglesPerSecond() const { return Seconds > 0 ? TrianglesSubmitted / Seconds : 0; }
+	double PixelsPerSecond() const { return Seconds > 0 ? PixelsShaded / Seconds : 0; }
+};
+
+class SoftwareRasterizer {
+public:
+	// 0 threads uses every hardware thread
+	SoftwareRasterizer(int threadCount = 0);
+	~SoftwareRasterizer();
+
+	void SetTarget(SoftwareTarget* target) { this->target = target; }
+
+	void DrawIndexed(
+		const SoftwareDrawState& state,
+		const void* vertices,
+		unsigned int stride,
+		unsigned int vertexCount,
+		const unsigned int* indices,
+		unsigned int indexCount,
+		const SoftwareVertexShader& vertexShader,
+		const SoftwarePixelShader& pixelShader);
+
+	const SoftwareRasterizerStats& GetStats() { return stats; }
+	void ResetStats() { stats = {}; }
+	int GetThreadCount() { return (int)workers.size() + 1; }
+
+private:
+	// Screen space triangle, ready to rasterize
+	struct Triangle {
+		float X[3];
+		float Y[3];
+		int FixedX[3];		// Snapped to 1/256 of a pixel, like D3D,
+		int FixedY[3];		// so edge tests are exact
+		float Z[3];
+		float InvW[3];
+		float Varyings[3][SoftwareMaxVaryings];		// Already divided by w
+		int MinX, MinY, MaxX, MaxY;
+	};
+
+	static const int TileSize = 64;
+	static const int SubpixelSteps = 256;
+
+	SoftwareTarget* target;
+	SoftwareRasterizerStats stats;
+
+	// Scratch, kept between draws to avoid reallocating
+	std::vector<SoftwareVertex> shadedVertices;
+	std::vector<Triangle> triangles;
+	std::vector<std::vector<int>> tileTriangles;
+
+	void SetupTriangle(const SoftwareDrawState& state, const SoftwareVertex* clipped[3]);
+	void ClipTriangle(const SoftwareDrawState& state, const SoftwareVertex& a, const SoftwareVertex& b, const SoftwareVertex& c);
+	void RasterizeTile(
+		const SoftwareDrawState& state,
+		const SoftwarePixelShader& pixelShader,
+		int tile,
+		long long& pixelsTested,
+		long long& pixelsShaded);
+
+	// Worker pool
+	std::vector<std::thread> workers;
+	std::mutex jobMutex;
+	std::condition_variable jobStart;
+	std::condition_variable jobDone;
+	const std::function<void(int)>* job;
+	int jobCount;
+	std::atomic<int> nextJob;
+	int busyWorkers;
+	int generation;
+	bool quit;
+
+	void ParallelFor(int count, const std::function<void(int)>& function);
+	void RunJobs();
+	void WorkerLoop();
+};
@@ -0,0 +1,331 @@
+#include "SoftwareReplay.h"
+
+// The D3D values the stream carries
+static const uint32_t TopologyTriangleList = 4;		// D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+static const uint32_t FormatR32Uint = 42;			// DXGI_FORMAT_R32_UINT
+static const uint32_t FormatR16Uint = 57;			// DXGI_FORMAT_R16_UINT
+static const uint32_t ClearDepthFlag = 1;			// D3D11_CLEAR_DEPTH
+
+SoftwareReplay::SoftwareReplay(SoftwareRasterizer& rasterizer)
+	: rasterizer(rasterizer)
+{
+}
+
+SoftwareReplay::~SoftwareReplay()
+{
+}
+
+// --------------------------------------------------------
+// Registration
+// --------------------------------------------------------
+
+void SoftwareReplay::SetBuffer(uint32_t id, const void* data, size_t bytes)
+{
+	Buffer buffer = { (const unsigned char*)data, bytes };
+	buffers[id] = buffer;
+}
+
+void SoftwareReplay::SetVertexShader(uint32_t id, const SoftwareVertexShader& shader, int varyingCount)
+{
+	VertexShader vertexShader = { shader, varyingCount };
+	vertexShaders[id] = vertexShader;
+}
+
+void SoftwareReplay::SetPixelShader(uint32_t id, const SoftwarePixelShader& shader)
+{
+	pixelShaders[id] = shader;
+}
+
+void SoftwareReplay::SetView(uint32_t id, SoftwareTarget* target)
+{
+	views[id] = target;
+}
+
+void SoftwareReplay::SetBlendState(uint32_t id, SoftwareBlendMode mode)
+{
+	blendStates[id] = mode;
+}
+
+void SoftwareReplay::SetDepthState(uint32_t id, const SoftwareReplayDepthState& state)
+{
+	depthStates[id] = state;
+}
+
+void SoftwareReplay::SetRasterizerState(uint32_t id, const SoftwareReplayRasterizerState& state)
+{
+	rasterizerStates[id] = state;
+}
+
+// --------------------------------------------------------
+// Replay
+// --------------------------------------------------------
+
+SoftwareReplayReport SoftwareReplay::Replay(const uint8_t* data, size_t size)
+{
+	SoftwareReplayReport report = {};
+	report.Total.Name = "Total";
+
+	// Null state objects are the D3D defaults
+	blendStates[0] = SoftwareBlendNone;
+	SoftwareReplayDepthState defaultDepth = { true, true, SoftwareDepthLess };
+	depthStates[0] = defaultDepth;
+	SoftwareReplayRasterizerState defaultRasterizer = { SoftwareCullBack, true, 0.0f };
+	rasterizerStates[0] = defaultRasterizer;
+
+	bound.VertexBuffer = bound.VertexStride = bound.VertexOffset = Unbound;
+	bound.IndexBuffer = bound.IndexFormat = bound.IndexOffset = Unbound;
+	bound.Topology = TopologyTriangleList;
+	bound.DepthView = bound.ColorView = Unbound;
+	bound.BlendState = bound.DepthState = bound.RasterizerState = 0;
+	bound.VertexShader = bound.PixelShader = Unbound;
+
+	std::map<uint32_t, std::string> names;
+	std::map<std::string, int> passIndex;
+	int currentPass = -1;
+
+	report.Valid = ReadCommandStream(data, size, [&](const Command& command) {
+		switch (command.Op)
+		{
+		case CommandDefineName:
+			names[command.Arg(0)] = command.Text;
+			break;
+
+		case CommandBeginFrame:
+			report.Frames++;
+			break;
+
+		case CommandBeginPass:
+		{
+			std::string name = names.count(command.Arg(0)) ? names[command.Arg(0)] : "Pass " + std::to_string(command.Arg(0));
+			auto it = passIndex.find(name);
+			if (it == passIndex.end())
+			{
+				SoftwareReplayPassStats pass = {};
+				pass.Name = name;
+				report.Passes.push_back(pass);
+				it = passIndex.insert(std::make_pair(name, (int)report.Passes.size() - 1)).first;
+			}
+			currentPass = it->second;
+			break;
+		}
+
+		case CommandEndPass:
+		case CommandEndFrame:
+			currentPass = -1;
+			break;
+
+		case CommandClearColor:
+		case CommandClearDepth:
+			Clear(command);
+			break;
+
+		case CommandDraw:
+		case CommandDrawIndexed:
+		{
+			long long pixelsShaded = 0;
+			bool drawn = Draw(command, pixelsShaded);
+
+			SoftwareReplayPassStats* targets[2] = { &report.Total, currentPass >= 0 ? &report.Passes[currentPass] : 0 };
+			for (SoftwareReplayPassStats* stats : targets)
+			{
+				if (!stats)
+					continue;
+				stats->Draws += drawn ? 1 : 0;
+				stats->Skipped += drawn ? 0 : 1;
+				stats->PixelsShaded += pixelsShaded;
+			}
+			break;
+		}
+
+		default:
+			Bind(command);
+			break;
+		}
+	});
+
+	return report;
+}
+
+void SoftwareReplay::Bind(const Command& command)
+{
+	switch (command.Op)
+	{
+	case CommandInvalidateState:
+		// Whatever drew last left its own state behind
+		bound.VertexBuffer = bound.IndexBuffer = Unbound;
+		bound.DepthView = bound.ColorView = Unbound;
+		bound.BlendState = bound.DepthState = bound.RasterizerState = Unbound;
+		bound.VertexShader = bound.PixelShader = Unbound;
+		bound.Topology = Unbound;
+		break;
+
+	case CommandBindVertexBuffer:
+		// Only slot 0 - the scene's vertices are one stream
+		if (command.Arg(0) == 0)
+		{
+			bound.VertexBuffer = command.Arg(1);
+			bound.VertexStride = command.Arg(2);
+			bound.VertexOffset = command.Arg(3);
+		}
+		break;
+
+	case CommandBindIndexBuffer:
+		bound.IndexBuffer = command.Arg(0);
+		bound.IndexFormat = command.Arg(1);
+		bound.IndexOffset = command.Arg(2);
+		break;
+
+	case CommandBindTopology:
+		bound.Topology = command.Arg(0);
+		break;
+
+	case CommandBindRenderTargets:
+		bound.DepthView = command.Arg(0);
+		bound.ColorView = command.Arg(1);
+		break;
+
+	case CommandBindBlendState:
+		bound.BlendState = command.Arg(0);
+		break;
+
+	case CommandBindDepthState:
+		bound.DepthState = command.Arg(0);
+		break;
+
+	case CommandBindRasterizer:
+		bound.RasterizerState = command.Arg(0);
+		break;
+
+	case CommandBindShader:
+		if (command.Arg(0) == CommandStageVertex)
+			bound.VertexShader = command.Arg(1);
+		else if (command.Arg(0) == CommandStagePixel)
+			bound.PixelShader = command.Arg(1);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void SoftwareReplay::Clear(const Command& command)
+{
+	auto view = views.find(command.Arg(0));
+	if (view == views.end() || !view->second)
+		return;
+
+	if (command.Op == CommandClearColor)
+	{
+		float color[4] = { command.FloatArg(1), command.FloatArg(2), command.FloatArg(3), command.FloatArg(4) };
+		view->second->ClearColor(color);
+	}
+	else if (command.Args.size() < 3)
+	{
+		// Recorded before clears kept their values
+		view->second->ClearDepth(1.0f);
+	}
+	else if (command.Arg(1) & ClearDepthFlag)
+	{
+		view->second->ClearDepth(command.FloatArg(2));
+	}
+}
+
+bool SoftwareReplay::Draw(const Command& command, long long& pixelsShaded)
+{
+	if (bound.Topology != TopologyTriangleList)
+		return false;
+
+	auto vertexBuffer = buffers.find(bound.VertexBuffer);
+	auto vertexShader = vertexShaders.find(bound.VertexShader);
+	auto blend = blendStates.find(bound.BlendState);
+	auto depth = depthStates.find(bound.DepthState);
+	auto raster = rasterizerStates.find(bound.RasterizerState);
+	if (vertexBuffer == buffers.end() || vertexShader == vertexShaders.end() ||
+		blend == blendStates.end() || depth == depthStates.end() || raster == rasterizerStates.end())
+		return false;
+
+	// No pixel shader draws depth only
+	SoftwarePixelShader noPixelShader;
+	const SoftwarePixelShader* pixelShader = &noPixelShader;
+	if (bound.PixelShader != 0)
+	{
+		auto it = pixelShaders.find(bound.PixelShader);
+		if (it == pixelShaders.end())
+			return false;
+		pixelShader = &it->second;
+	}
+
+	// One target holds both color and depth
+	SoftwareTarget* target = 0;
+	if (bound.ColorView == Unbound || bound.DepthView == Unbound)
+		return false;
+	if (bound.ColorView != 0)
+	{
+		auto it = views.find(bound.ColorView);
+		if (it == views.end() || !it->second)
+			return false;
+		target = it->second;
+	}
+	if (bound.DepthView != 0)
+	{
+		auto it = views.find(bound.DepthView);
+		if (it == views.end() || !it->second || (target && target != it->second))
+			return false;
+		target = it->second;
+	}
+	if (!target)
+		return false;
+
+	SoftwareDrawState state = SoftwareDefaultState(vertexShader->second.VaryingCount);
+	state.BlendMode = blend->second;
+	state.DepthTest = depth->second.DepthTest && bound.DepthView != 0;
+	state.DepthWrite = depth->second.DepthWrite && bound.DepthView != 0;
+	state.DepthFunc = depth->second.DepthFunc;
+	state.CullMode = raster->second.CullMode;
+	state.DepthClip = raster->second.DepthClip;
+	state.DepthBias = raster->second.DepthBias;
+	state.ColorWrite = bound.ColorView != 0 && bound.PixelShader != 0;
+
+	const Buffer& vertices = vertexBuffer->second;
+	if (bound.VertexStride == 0 || bound.VertexOffset > vertices.Bytes)
+		return false;
+	unsigned int vertexCount = (unsigned int)((vertices.Bytes - bound.VertexOffset) / bound.VertexStride);
+
+	// Indices into the bound vertices, base vertex applied.  Any
+	// that end up out of range are dropped by the rasterizer.
+	unsigned int count = command.Arg(0);
+	indices.resize(count);
+	if (command.Op == CommandDrawIndexed)
+	{
+		auto indexBuffer = buffers.find(bound.IndexBuffer);
+		if (indexBuffer == buffers.end())
+			return false;
+
+		size_t indexSize = bound.IndexFormat == FormatR32Uint ? 4 : (bound.IndexFormat == FormatR16Uint ? 2 : 0);
+		size_t first = bound.IndexOffset + (size_t)command.Arg(1) * indexSize;
+		if (indexSize == 0 || first + (size_t)count * indexSize > indexBuffer->second.Bytes)
+			return false;
+
+		const unsigned char* source = indexBuffer->second.Data + first;
+		int baseVertex = (int)command.Arg(2);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int index = indexSize == 4 ?
+				source[i * 4] | (source[i * 4 + 1] << 8) | (source[i * 4 + 2] << 16) | ((unsigned int)source[i * 4 + 3] << 24) :
+				source[i * 2] | (source[i * 2 + 1] << 8);
+			indices[i] = index + baseVertex;
+		}
+	}
+	else
+	{
+		for (unsigned int i = 0; i < count; i++)
+			indices[i] = command.Arg(1) + i;
+	}
+
+	long long shadedBefore = rasterizer.GetStats().PixelsShaded;
+	rasterizer.SetTarget(target);
+	rasterizer.DrawIndexed(state, vertices.Data + bound.VertexOffset, bound.VertexStride, vertexCount,
+		indices.data(), count, vertexShader->second.Shader, *pixelShader);
+	pixelsShaded = rasterizer.GetStats().PixelsShaded - shadedBefore;
+	return true;
+}
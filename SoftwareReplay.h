@@ -0,0 +1,115 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include "CommandStream.h"
+#include "SoftwareRasterizer.h"
+
+// --------------------------------------------------------
+// Replays a recorded command stream on the software
+// rasterizer
+//
+// The stream only says which objects were bound, so what
+// they hold is registered here against the ids the recorder
+// gave them (CommandRecorder::GetObjectId): buffer contents,
+// shader functors, targets and what each state object does.
+// Constants aren't in the stream either - the shader
+// functors carry whatever the draws need.  A draw that uses
+// anything unregistered, or isn't a triangle list, is
+// skipped and counted.
+//
+// State objects and the topology start out as the D3D
+// defaults (Game sets triangle lists once, at startup);
+// everything else has to be bound in the stream first.
+// Viewports aren't applied - register each target at the
+// size its viewport was.
+// --------------------------------------------------------
+
+struct SoftwareReplayDepthState {
+	bool DepthTest;
+	bool DepthWrite;
+	SoftwareDepthFunc DepthFunc;
+};
+
+struct SoftwareReplayRasterizerState {
+	SoftwareCullMode CullMode;
+	bool DepthClip;
+	float DepthBias;
+};
+
+struct SoftwareReplayPassStats {
+	std::string Name;
+	long long Draws;			// Replayed
+	long long Skipped;			// Used something that wasn't registered
+	long long PixelsShaded;
+};
+
+struct SoftwareReplayReport {
+	bool Valid;					// False if the stream was cut short or garbled
+	int Frames;
+	SoftwareReplayPassStats Total;
+	std::vector<SoftwareReplayPassStats> Passes;	// Summed over every frame, in first seen order
+};
+
+class SoftwareReplay {
+public:
+	SoftwareReplay(SoftwareRasterizer& rasterizer);
+	~SoftwareReplay();
+
+	// Not copied, so it has to outlive Replay
+	void SetBuffer(uint32_t id, const void* data, size_t bytes);
+
+	void SetVertexShader(uint32_t id, const SoftwareVertexShader& shader, int varyingCount);
+	void SetPixelShader(uint32_t id, const SoftwarePixelShader& shader);
+
+	// Render target and depth views.  A color view and the depth
+	// view bound with it must be the same target.
+	void SetView(uint32_t id, SoftwareTarget* target);
+
+	void SetBlendState(uint32_t id, SoftwareBlendMode mode);
+	void SetDepthState(uint32_t id, const SoftwareReplayDepthState& state);
+	void SetRasterizerState(uint32_t id, const SoftwareReplayRasterizerState& state);
+
+	SoftwareReplayReport Replay(const uint8_t* data, size_t size);
+
+private:
+	struct Buffer {
+		const unsigned char* Data;
+		size_t Bytes;
+	};
+
+	struct VertexShader {
+		SoftwareVertexShader Shader;
+		int VaryingCount;
+	};
+
+	// Ids as bound, or Unbound
+	struct BoundState {
+		uint32_t VertexBuffer, VertexStride, VertexOffset;
+		uint32_t IndexBuffer, IndexFormat, IndexOffset;
+		uint32_t Topology;
+		uint32_t DepthView, ColorView;
+		uint32_t BlendState, DepthState, RasterizerState;
+		uint32_t VertexShader, PixelShader;
+	};
+
+	static const uint32_t Unbound = 0xFFFFFFFF;
+
+	SoftwareRasterizer& rasterizer;
+
+	std::map<uint32_t, Buffer> buffers;
+	std::map<uint32_t, VertexShader> vertexShaders;
+	std::map<uint32_t, SoftwarePixelShader> pixelShaders;
+	std::map<uint32_t, SoftwareTarget*> views;
+	std::map<uint32_t, SoftwareBlendMode> blendStates;
+	std::map<uint32_t, SoftwareReplayDepthState> depthStates;
+	std::map<uint32_t, SoftwareReplayRasterizerState> rasterizerStates;
+
+	BoundState bound;
+	std::vector<unsigned int> indices;		// Scratch, rebased to the draw's vertices
+
+	void Bind(const Command& command);
+	void Clear(const Command& command);
+	bool Draw(const Command& command, long long& pixelsShaded);
+};
@@ -0,0 +1,256 @@
+#include "SoftwareShaders.h"
+#include <math.h>
+
+// mul(v, M) for a matrix stored the way it was uploaded
+// (transposed), so column c of M is row c of the array
+static void Mul(const float* v, int size, const float m[16], float* out, int outSize)
+{
+	for (int c = 0; c < outSize; c++)
+	{
+		float sum = 0.0f;
+		for (int r = 0; r < size; r++)
+			sum += v[r] * m[c * 4 + r];
+		out[c] = sum;
+	}
+}
+
+static float Saturate(float value)
+{
+	return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+static float Dot3(const float a[3], const float b[3])
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void Normalize3(float v[3])
+{
+	float length = sqrtf(Dot3(v, v));
+	if (length > 0.0f)
+	{
+		v[0] /= length;
+		v[1] /= length;
+		v[2] /= length;
+	}
+}
+
+// --------------------------------------------------------
+// SoftwareTexture
+// --------------------------------------------------------
+
+SoftwareTexture::SoftwareTexture(int width, int height)
+{
+	this->width = width;
+	this->height = height;
+	texels.resize((size_t)width * height * 4, 0.0f);
+}
+
+SoftwareTexture::SoftwareTexture(int width, int height, const float color[4])
+	: SoftwareTexture(width, height)
+{
+	for (size_t i = 0; i < texels.size(); i += 4)
+	{
+		for (int c = 0; c < 4; c++)
+			texels[i + c] = color[c];
+	}
+}
+
+void SoftwareTexture::Sample(float u, float v, float out[4]) const
+{
+	float x = u * width - 0.5f;
+	float y = v * height - 0.5f;
+	float fx = floorf(x);
+	float fy = floorf(y);
+	float tx = x - fx;
+	float ty = y - fy;
+
+	int x0 = (int)fx % width;
+	int y0 = (int)fy % height;
+	if (x0 < 0) x0 += width;
+	if (y0 < 0) y0 += height;
+	int x1 = (x0 + 1) % width;
+	int y1 = (y0 + 1) % height;
+
+	const float* t00 = &texels[(y0 * width + x0) * 4];
+	const float* t10 = &texels[(y0 * width + x1) * 4];
+	const float* t01 = &texels[(y1 * width + x0) * 4];
+	const float* t11 = &texels[(y1 * width + x1) * 4];
+	for (int c = 0; c < 4; c++)
+	{
+		float top = t00[c] + (t10[c] - t00[c]) * tx;
+		float bottom = t01[c] + (t11[c] - t01[c]) * tx;
+		out[c] = top + (bottom - top) * ty;
+	}
+}
+
+// Bilinear LESS comparison with a border depth of 1
+static float SampleShadow(const SoftwareTarget* map, float u, float v, float depth)
+{
+	int width = map->GetWidth();
+	int height = map->GetHeight();
+
+	float x = u * width - 0.5f;
+	float y = v * height - 0.5f;
+	float fx = floorf(x);
+	float fy = floorf(y);
+	float tx = x - fx;
+	float ty = y - fy;
+
+	float lit[2][2];
+	for (int j = 0; j < 2; j++)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			int sx = (int)fx + i;
+			int sy = (int)fy + j;
+			float texel = 1.0f;
+			if (sx >= 0 && sy >= 0 && sx < width && sy < height)
+				texel = *map->GetDepth(sx, sy);
+			lit[j][i] = depth < texel ? 1.0f : 0.0f;
+		}
+	}
+
+	float top = lit[0][0] + (lit[0][1] - lit[0][0]) * tx;
+	float bottom = lit[1][0] + (lit[1][1] - lit[1][0]) * tx;
+	return top + (bottom - top) * ty;
+}
+
+// --------------------------------------------------------
+// VertexShader.hlsl
+// --------------------------------------------------------
+void SoftwareBasicVertexShader::operator()(const void* vertex, SoftwareVertex& out) const
+{
+	const SoftwareVertexInput& input = *(const SoftwareVertexInput*)vertex;
+
+	float position[4] = { input.Position[0], input.Position[1], input.Position[2], 1.0f };
+	float worldPos[4];
+	float viewPos[4];
+	Mul(position, 4, World, worldPos, 4);
+	Mul(worldPos, 4, View, viewPos, 4);
+	Mul(viewPos, 4, Projection, out.Position, 4);
+
+	float* varyings = out.Varyings;
+	Mul(input.Normal, 3, World, varyings + 0, 3);
+	varyings[3] = input.UV[0];
+	varyings[4] = input.UV[1];
+	Mul(input.Tangent, 3, World, varyings + 5, 3);
+	varyings[8] = worldPos[0];
+	varyings[9] = worldPos[1];
+	varyings[10] = worldPos[2];
+	varyings[11] = viewPos[2];
+}
+
+// --------------------------------------------------------
+// ShadowVS.hlsl
+// --------------------------------------------------------
+void SoftwareShadowVertexShader::operator()(const void* vertex, SoftwareVertex& out) const
+{
+	const SoftwareVertexInput& input = *(const SoftwareVertexInput*)vertex;
+
+	float position[4] = { input.Position[0], input.Position[1], input.Position[2], 1.0f };
+	float worldPos[4];
+	float viewPos[4];
+	Mul(position, 4, World, worldPos, 4);
+	Mul(worldPos, 4, View, viewPos, 4);
+	Mul(viewPos, 4, Projection, out.Position, 4);
+}
+
+// --------------------------------------------------------
+// PixelShader.hlsl
+// --------------------------------------------------------
+bool SoftwareBasicPixelShader::operator()(const float* varyings, float color[4]) const
+{
+	float normal[3] = { varyings[0], varyings[1], varyings[2] };
+	float uv[2] = { varyings[3], varyings[4] };
+	float tangent[3] = { varyings[5], varyings[6], varyings[7] };
+	float worldPos[3] = { varyings[8], varyings[9], varyings[10] };
+	float viewDepth = varyings[11];
+
+	Normalize3(normal);
+	Normalize3(tangent);
+
+	// Spot light
+	float dirToPointLight[3];
+	for (int c = 0; c < 3; c++)
+		dirToPointLight[c] = PointLightPosition[c] - worldPos[c];
+	Normalize3(dirToPointLight);
+
+	float fromLight[3] = { -dirToPointLight[0], -dirToPointLight[1], -dirToPointLight[2] };
+	float angleFromCenter = fmaxf(Dot3(fromLight, SpotLightDirection), 0.0f);
+	float spotAmount = powf(angleFromCenter, SpotPower);
+
+	// Specular highlight for the point light
+	float toCamera[3];
+	for (int c = 0; c < 3; c++)
+		toCamera[c] = CameraPosition[c] - worldPos[c];
+	Normalize3(toCamera);
+
+	float nDotL = Dot3(fromLight, normal);
+	float refl[3];
+	for (int c = 0; c < 3; c++)
+		refl[c] = fromLight[c] - 2.0f * nDotL * normal[c];
+	float specular = powf(Saturate(Dot3(refl, toCamera)), 8.0f);
+
+	// Two channel normal map, Z rebuilt
+	float normalSample[4];
+	NormalMap->Sample(uv[0], uv[1], normalSample);
+	float normalFromMap[3];
+	normalFromMap[0] = normalSample[0] * 2.0f - 1.0f;
+	normalFromMap[1] = normalSample[1] * 2.0f - 1.0f;
+	normalFromMap[2] = sqrtf(Saturate(1.0f - normalFromMap[0] * normalFromMap[0] - normalFromMap[1] * normalFromMap[1]));
+
+	// Tangent to world space
+	float tDotN = Dot3(tangent, normal);
+	float T[3];
+	for (int c = 0; c < 3; c++)
+		T[c] = tangent[c] - normal[c] * tDotN;
+	Normalize3(T);
+	float B[3] = {
+		T[1] * normal[2] - T[2] * normal[1],
+		T[2] * normal[0] - T[0] * normal[2],
+		T[0] * normal[1] - T[1] * normal[0] };
+
+	float mapped[3];
+	for (int c = 0; c < 3; c++)
+		mapped[c] = normalFromMap[0] * T[c] + normalFromMap[1] * B[c] + normalFromMap[2] * normal[c];
+	Normalize3(mapped);
+
+	float surfaceColor[4];
+	Texture->Sample(uv[0], uv[1], surfaceColor);
+
+	const SoftwareDirectionalLight* lights[3] = { &DirLight1, &DirLight2, &DirLight3 };
+	float totalLight[3] = { specular + spotAmount, specular + spotAmount, specular + spotAmount };
+	for (int l = 0; l < 3; l++)
+	{
+		float direction[3] = { lights[l]->Direction[0], lights[l]->Direction[1], lights[l]->Direction[2] };
+		Normalize3(direction);
+		float toLight[3] = { -direction[0], -direction[1], -direction[2] };
+		float amount = Saturate(Dot3(mapped, toLight));
+
+		for (int c = 0; c < 3; c++)
+			totalLight[c] += lights[l]->DiffuseColor[c] * amount * surfaceColor[c] + lights[l]->AmbientColor[c] * surfaceColor[c];
+	}
+
+	// Shadow from the first cascade that reaches this far
+	float shadowAmount = 1.0f;
+	int cascade = 0;
+	for (int i = 0; i < 3; i++)
+		cascade += (i < Shadow.Count - 1 && viewDepth > Shadow.Splits[i]) ? 1 : 0;
+
+	if (Shadow.Count > 0 && viewDepth <= Shadow.Splits[cascade] && ShadowMaps[cascade])
+	{
+		float position[4] = { worldPos[0], worldPos[1], worldPos[2], 1.0f };
+		float posForShadow[4];
+		Mul(position, 4, Shadow.ViewProjection[cascade], posForShadow, 4);
+
+		float u = posForShadow[0] * 0.5f + 0.5f;
+		float v = 1.0f - (posForShadow[1] * 0.5f + 0.5f);
+		shadowAmount = SampleShadow(ShadowMaps[cascade], u, v, posForShadow[2]);
+	}
+
+	for (int c = 0; c < 3; c++)
+		color[c] = totalLight[c] * shadowAmount;
+	color[3] = AlphaV;
+	return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+#include "ShadowCascades.h"
+#include "SoftwareRasterizer.h"
+
+// --------------------------------------------------------
+// C++ ports of the shaders the scene is drawn with, for the
+// software rasterizer.  Keep these in step with the HLSL.
+//
+// Matrices are stored exactly as they are uploaded to the
+// GPU (the transposed XMFLOAT4X4s), so the same data can be
+// fed to both.
+// --------------------------------------------------------
+
+// Same layout as Vertex in Vertex.h
+struct SoftwareVertexInput {
+	float Position[3];
+	float Normal[3];
+	float UV[2];
+	float Tangent[3];
+};
+
+// --------------------------------------------------------
+// RGBA float texture sampled like basicSampler - bilinear,
+// wrapped, top mip only
+// --------------------------------------------------------
+class SoftwareTexture {
+public:
+	SoftwareTexture(int width, int height);
+	SoftwareTexture(int width, int height, const float color[4]);
+
+	int GetWidth() const { return width; }
+	int GetHeight() const { return height; }
+	float* GetTexel(int x, int y) { return &texels[(y * width + x) * 4]; }
+
+	void Sample(float u, float v, float out[4]) const;
+
+private:
+	int width;
+	int height;
+	std::vector<float> texels;
+};
+
+// --------------------------------------------------------
+// VertexShader.hlsl
+// --------------------------------------------------------
+class SoftwareBasicVertexShader {
+public:
+	// Varyings: normal (3), uv (2), tangent (3), worldPos (3), viewDepth (1)
+	static const int VaryingCount = 12;
+
+	float World[16];
+	float View[16];
+	float Projection[16];
+
+	void operator()(const void* vertex, SoftwareVertex& out) const;
+};
+
+// --------------------------------------------------------
+// ShadowVS.hlsl - position only, draw with no pixel shader
+// --------------------------------------------------------
+class SoftwareShadowVertexShader {
+public:
+	static const int VaryingCount = 0;
+
+	float World[16];
+	float View[16];
+	float Projection[16];
+
+	void operator()(const void* vertex, SoftwareVertex& out) const;
+};
+
+// Same layout as DirectionalLight in Lights.h
+struct SoftwareDirectionalLight {
+	float AmbientColor[4];
+	float DiffuseColor[4];
+	float Direction[3];
+};
+
+// --------------------------------------------------------
+// PixelShader.hlsl, expects SoftwareBasicVertexShader's
+// varyings.  ShadowMaps holds one depth target per cascade,
+// sampled like ShadowSampler (bilinear LESS comparison,
+// border of 1).
+// --------------------------------------------------------
+class SoftwareBasicPixelShader {
+public:
+	SoftwareDirectionalLight DirLight1;
+	SoftwareDirectionalLight DirLight2;
+	SoftwareDirectionalLight DirLight3;
+	float PointLightPosition[3];
+	float CameraPosition[3];
+	float SpotLightDirection[3];
+	float SpotPower;
+	float AlphaV;
+
+	const SoftwareTexture* Texture;
+	const SoftwareTexture* NormalMap;
+
+	ShadowCascadeConstants Shadow;
+	const SoftwareTarget* ShadowMaps[MaxShadowCascades];
+
+	bool operator()(const float* varyings, float color[4]) const;
+};
@@ -0,0 +1,74 @@
+#include "SpriteSort.h"
+#include <string.h>
+
+uint32_t DepthSortKey(float depth)
+{
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(bits));
+
+	// Negative floats sort backwards, so flip all their bits;
+	// positive ones just need to land above the negatives
+	return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+uint64_t PackSpriteKey(SpriteOrder order, uint32_t textureId, float depth)
+{
+	switch (order)
+	{
+	case SpriteOrder_BackToFront:
+		return ((uint64_t)~DepthSortKey(depth) << 32) | textureId;
+	case SpriteOrder_FrontToBack:
+		return ((uint64_t)DepthSortKey(depth) << 32) | textureId;
+	default:
+		return textureId;
+	}
+}
+
+void RadixSortSpriteKeys(std::vector<SpriteKey>& keys, std::vector<SpriteKey>& scratch)
+{
+	size_t count = keys.size();
+	if (count < 2)
+		return;
+	scratch.resize(count);
+
+	// Count every byte of every key in one pass
+	uint32_t histogram[8][256];
+	memset(histogram, 0, sizeof(histogram));
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t key = keys[i].Key;
+		for (int b = 0; b < 8; b++)
+			histogram[b][(key >> (b * 8)) & 0xFF]++;
+	}
+
+	SpriteKey* from = keys.data();
+	SpriteKey* to = scratch.data();
+	for (int b = 0; b < 8; b++)
+	{
+		uint32_t* counts = histogram[b];
+
+		// Every key has the same byte here (the unused high
+		// half in texture order, say) - nothing to move
+		if (counts[(from[0].Key >> (b * 8)) & 0xFF] == count)
+			continue;
+
+		uint32_t offset = 0;
+		for (int d = 0; d < 256; d++)
+		{
+			uint32_t n = counts[d];
+			counts[d] = offset;
+			offset += n;
+		}
+
+		for (size_t i = 0; i < count; i++)
+			to[counts[(from[i].Key >> (b * 8)) & 0xFF]++] = from[i];
+
+		SpriteKey* swap = from;
+		from = to;
+		to = swap;
+	}
+
+	// Odd number of passes leaves the result in scratch
+	if (from != keys.data())
+		keys.swap(scratch);
+}
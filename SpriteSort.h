@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Sprite ordering with a radix sort
+//
+// Every queued sprite gets one 64 bit key holding its
+// texture and depth, packed so that sorting the keys as plain
+// integers gives the order the sort mode asks for.  An LSD
+// radix sort on those keys is linear in the sprite count and
+// stable, so sprites that tie keep the order they were drawn
+// in.
+//
+// Not part of the game build: UITree batches in draw order,
+// which blending needs, so nothing there can be reordered.
+// --------------------------------------------------------
+
+enum SpriteOrder {
+	SpriteOrder_Texture,		// Group by texture, draw order within one
+	SpriteOrder_BackToFront,	// Largest depth first, then by texture
+	SpriteOrder_FrontToBack,	// Smallest depth first, then by texture
+};
+
+struct SpriteKey {
+	uint64_t Key;
+	uint32_t Index;		// Which sprite, in the order it was queued
+};
+
+// Float depth as an unsigned int that sorts the same way
+uint32_t DepthSortKey(float depth);
+
+// textureId should be small and dense - ids handed out in
+// first-use order keep the texture groups in that order too
+uint64_t PackSpriteKey(SpriteOrder order, uint32_t textureId, float depth);
+
+// Sorts keys in place.  scratch is resized to match and can
+// be kept between calls so sorting never allocates once warm.
+void RadixSortSpriteKeys(std::vector<SpriteKey>& keys, std::vector<SpriteKey>& scratch);
@@ -0,0 +1,49 @@
+#include "SpriteText.h"
+
+using namespace DirectX;
+
+SpriteText::SpriteText(SpriteFont* font)
+{
+	this->font = font;
+	texture = 0;
+	font->GetSpriteSheet(&texture);
+}
+
+SpriteText::~SpriteText()
+{
+	if (texture) texture->Release();
+}
+
+const TextRun& SpriteText::Layout(const wchar_t* text, float scale)
+{
+	SpriteFont* font = this->font;
+	return cache.Get(font, text, scale, font->GetLineSpacing(), [font](wchar_t character) {
+		const SpriteFont::Glyph* glyph = font->FindGlyph(character);
+
+		TextGlyph result;
+		result.Character = glyph->Character;
+		result.Left = glyph->Subrect.left;
+		result.Top = glyph->Subrect.top;
+		result.Right = glyph->Subrect.right;
+		result.Bottom = glyph->Subrect.bottom;
+		result.XOffset = glyph->XOffset;
+		result.YOffset = glyph->YOffset;
+		result.XAdvance = glyph->XAdvance;
+		return result;
+	});
+}
+
+void SpriteText::Draw(SpriteBatch* spriteBatch, const wchar_t* text, XMFLOAT2 position, FXMVECTOR color, float scale)
+{
+	DrawRun(spriteBatch, Layout(text, scale), position, color);
+}
+
+void SpriteText::DrawRun(SpriteBatch* spriteBatch, const TextRun& run, XMFLOAT2 position, FXMVECTOR color)
+{
+	for (const TextQuad& quad : run.Quads)
+	{
+		RECT source = { quad.Left, quad.Top, quad.Right, quad.Bottom };
+		XMFLOAT2 at(position.x + quad.X, position.y + quad.Y);
+		spriteBatch->Draw(texture, at, &source, color, 0.0f, XMFLOAT2(0, 0), run.Scale);
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "SpriteBatch.h"
+#include "SpriteFont.h"
+#include "TextLayout.h"
+
+// --------------------------------------------------------
+// Draws text with a SpriteFont through a layout cache, so
+// the same string drawn every frame is laid out once and
+// then goes straight to the SpriteBatch as glyph quads.
+// Looks the same as SpriteFont::DrawString without rotation
+// or sprite effects.
+// --------------------------------------------------------
+class SpriteText {
+public:
+	SpriteText(DirectX::SpriteFont* font);
+	~SpriteText();
+
+	const TextRun& Layout(const wchar_t* text, float scale = 1.0f);
+
+	void Draw(DirectX::SpriteBatch* spriteBatch, const wchar_t* text, DirectX::XMFLOAT2 position, DirectX::FXMVECTOR color = DirectX::Colors::White, float scale = 1.0f);
+
+	// Draws a run from Layout()
+	void DrawRun(DirectX::SpriteBatch* spriteBatch, const TextRun& run, DirectX::XMFLOAT2 position, DirectX::FXMVECTOR color = DirectX::Colors::White);
+
+	TextLayoutCache& GetCache() { return cache; }
+
+private:
+	DirectX::SpriteFont* font;
+	ID3D11ShaderResourceView* texture;
+	TextLayoutCache cache;
+};
@@ -0,0 +1,414 @@
+// Audio mixer: mixed output matches a double precision mix of
+// the same voices (same rate and resampled, panned, pitched,
+// cut into odd sized calls), voices end, get stolen and stop
+// when told; commands cross the lock free ring in order with
+// none lost, from another thread too; the WAV sink writes the
+// header and samples it should.  Then voices mixed per ms of
+// mixing, and how long a Play takes to reach the sink when the
+// sink is paced like a sound card.
+//
+//   g++ -std=c++14 -O2 -pthread -I.. AudioMixerTest.cpp ../AudioMixer.cpp ../AudioSink.cpp -o AudioMixerTest && ./AudioMixerTest
+
+#include "TestCommon.h"
+#include "AudioMixer.h"
+#include "AudioSink.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static unsigned int seed = 1;
+
+static float RandomFloat(float low, float high) {
+	seed = seed * 1664525 + 1013904223;
+	return low + (high - low) * (seed >> 8) * (1.0f / 16777216.0f);
+}
+
+static std::vector<float> Tone(int frames, int channels, float frequency, int sampleRate) {
+	std::vector<float> samples(frames * channels);
+	for (int i = 0; i < frames; i++)
+		for (int c = 0; c < channels; c++)
+			samples[i * channels + c] = 0.8f * sinf(6.2831853f * frequency * i / sampleRate + c) + RandomFloat(-0.1f, 0.1f);
+	return samples;
+}
+
+// --------------------------------------------------------
+// Accuracy
+// --------------------------------------------------------
+
+struct ReferenceVoice {
+	const SoundEffect* Sound;
+	float Volume;
+	float Pitch;
+	float Pan;
+};
+
+// The mixer's fixed point positions, everything else in double
+static std::vector<double> ReferenceMix(const std::vector<ReferenceVoice>& voices, int sampleRate, float masterVolume, int frames) {
+	std::vector<double> output(frames * 2, 0.0);
+	for (const ReferenceVoice& voice : voices) {
+		double rate = (double)voice.Sound->GetSampleRate() / sampleRate * pow(2.0, (double)voice.Pitch);
+		uint64_t step = std::max((uint64_t)(rate * 4294967296.0), (uint64_t)1);
+		uint64_t end = (uint64_t)voice.Sound->GetFrameCount() << 32;
+		double pan = std::min(std::max((double)voice.Pan, -1.0), 1.0);
+		double angle = (pan + 1.0) * 3.14159265358979 / 4.0;
+		double gains[2] = { voice.Volume * cos(angle) * masterVolume, voice.Volume * sin(angle) * masterVolume };
+
+		const float* samples = voice.Sound->GetSamples();
+		uint64_t position = 0;
+		for (int i = 0; i < frames && position < end; i++, position += step) {
+			const float* s = samples + (position >> 32);
+			double fraction = (uint32_t)position / 4294967296.0;
+			double sample = s[0] + ((double)s[1] - s[0]) * fraction;
+			output[i * 2] += sample * gains[0];
+			output[i * 2 + 1] += sample * gains[1];
+		}
+	}
+	return output;
+}
+
+static double MaxError(const std::vector<float>& output, const std::vector<double>& expected) {
+	double error = 0;
+	for (size_t i = 0; i < output.size(); i++)
+		error = std::max(error, fabs(output[i] - expected[i]));
+	return error;
+}
+
+// Mixes in calls of uneven sizes, the way a sink asking for
+// whatever it has room for would
+static std::vector<float> MixUneven(AudioMixer& mixer, int frames) {
+	std::vector<float> output(frames * 2);
+	for (int start = 0; start < frames;) {
+		int count = std::min(frames - start, 1 + (int)RandomFloat(0, 700));
+		mixer.Mix(output.data() + start * 2, count);
+		start += count;
+	}
+	return output;
+}
+
+static void TestAccuracy() {
+	const int rates[] = { 48000, 44100, 22050, 96000 };
+	for (int round = 0; round < 40; round++) {
+		AudioMixer mixer(48000, 32);
+		int rate = rates[round % 4];
+		int voiceCount = 1 + round % 9;
+		float master = round % 5 == 0 ? 0.5f : 1.0f;
+		mixer.SetMasterVolume(master);
+
+		std::vector<SoundEffect*> sounds;
+		std::vector<ReferenceVoice> voices;
+		for (int v = 0; v < voiceCount; v++) {
+			int channels = 1 + v % 2;
+			int frames = 1 + (int)RandomFloat(0, 9000);
+			std::vector<float> samples = Tone(frames, channels, RandomFloat(50, 4000), rate);
+			sounds.push_back(new SoundEffect(&mixer, samples.data(), frames, channels, rate));
+
+			// Some at the source rate exactly, for the straight copy
+			ReferenceVoice voice = { sounds.back(), RandomFloat(0, 1.5f), v % 3 == 0 ? 0.0f : RandomFloat(-1, 1), RandomFloat(-1.3f, 1.3f) };
+			voices.push_back(voice);
+			CHECK(sounds.back()->Play(voice.Volume, voice.Pitch, voice.Pan));
+		}
+
+		const int frames = 30000;
+		std::vector<float> output = MixUneven(mixer, frames);
+		CHECK(MaxError(output, ReferenceMix(voices, 48000, master, frames)) < 1e-5);
+		CHECK(mixer.GetActiveVoices() == 0);
+		for (SoundEffect* sound : sounds)
+			delete sound;
+	}
+
+	// Stereo sounds are averaged, and pan is equal power
+	float stereo[4] = { 1.0f, 0.0f, 0.5f, 0.5f };
+	AudioMixer mixer(48000, 4);
+	SoundEffect sound(&mixer, stereo, 2, 2, 48000);
+	CHECK(sound.GetFrameCount() == 2 && sound.GetSamples()[0] == 0.5f && sound.GetSamples()[1] == 0.5f && sound.GetSamples()[2] == 0.0f);
+	sound.Play(1.0f, 0.0f, -1.0f);
+	float output[8];
+	mixer.Mix(output, 4);
+	CHECK(output[0] == 0.5f && fabsf(output[1]) < 1e-7f && output[4] == 0.0f && output[5] == 0.0f);
+	sound.Play(1.0f, 0.0f, 0.0f);
+	mixer.Mix(output, 4);
+	CHECK(fabsf(output[0] - 0.5f * 0.70710678f) < 1e-6f && fabsf(output[1] - output[0]) < 1e-6f);
+}
+
+static void TestVoices() {
+	// Frames played: the source length over the step, rounded up
+	AudioMixer mixer(48000, 2);
+	std::vector<float> ones(1000, 1.0f);
+	SoundEffect same(&mixer, ones.data(), 1000, 1, 48000);
+	SoundEffect octaveUp(&mixer, ones.data(), 999, 1, 48000);
+	same.Play(1.0f, 0.0f, -1.0f);
+	std::vector<float> output(2000 * 2);
+	mixer.Mix(output.data(), 2000);
+	CHECK(output[999 * 2] == 1.0f && output[1000 * 2] == 0.0f);
+
+	octaveUp.Play(1.0f, 1.0f, -1.0f);
+	mixer.Mix(output.data(), 2000);
+	CHECK(output[499 * 2] == 1.0f && output[500 * 2] == 0.0f);
+	CHECK(mixer.GetActiveVoices() == 0);
+
+	// Every voice busy: the oldest goes
+	std::vector<float> longer(48000, 1.0f);
+	SoundEffect a(&mixer, longer.data(), 48000, 1, 48000);
+	SoundEffect b(&mixer, longer.data(), 48000, 1, 48000);
+	a.Play(1.0f, 0.0f, -1.0f);
+	b.Play(2.0f, 0.0f, -1.0f);
+	mixer.Mix(output.data(), 100);
+	CHECK(output[0] == 3.0f);
+	a.Play(4.0f, 0.0f, -1.0f);
+	mixer.Mix(output.data(), 100);
+	CHECK(output[0] == 6.0f && mixer.GetStats().Stolen == 1 && mixer.GetStats().PeakVoices == 2);
+
+	// Stop all, then nothing
+	mixer.StopAll();
+	mixer.Mix(output.data(), 100);
+	CHECK(output[0] == 0.0f && mixer.GetActiveVoices() == 0);
+
+	// Nothing to play plays nothing
+	SoundEffect empty(&mixer, 0, 0, 1, 48000);
+	CHECK(empty.Play());
+	mixer.Mix(output.data(), 100);
+	CHECK(mixer.GetActiveVoices() == 0);
+}
+
+// --------------------------------------------------------
+// Command ring
+// --------------------------------------------------------
+
+static void TestRing() {
+	// 64 fit, the next is dropped until the audio thread takes
+	// them
+	AudioMixer mixer(48000, 1);
+	int accepted = 0;
+	for (int i = 0; i < 70; i++)
+		accepted += mixer.SetMasterVolume((float)i) ? 1 : 0;
+	CHECK(accepted == 64 && mixer.GetStats().Dropped == 6);
+
+	float output[2];
+	mixer.Mix(output, 1);
+	CHECK(mixer.GetStats().Commands == 64);
+	CHECK(mixer.SetMasterVolume(1.0f));
+
+	// Another thread playing flat out.  One voice, so in each
+	// block the last Play wins and takes the voice over, and a
+	// sound as long as a block, so a block with no Play in it
+	// is silent.  Volumes count up, so the blocks have to as
+	// well, and the last block has to be the last Play.
+	const int blockFrames = 64;
+	const int plays = 100000;
+	AudioMixer threaded(48000, 1);
+	std::vector<float> ones(blockFrames, 1.0f);
+	SoundEffect click(&threaded, ones.data(), blockFrames, 1, 48000);
+
+	int refused = 0;
+	std::atomic<bool> done(false);
+	std::thread game([&]() {
+		for (int k = 1; k <= plays; k++) {
+			while (!click.Play((float)k, 0.0f, -1.0f)) {
+				refused++;
+				std::this_thread::yield();
+			}
+		}
+		done = true;
+	});
+
+	float block[blockFrames * 2];
+	float last = 0;
+	int outOfOrder = 0, blocksPlayed = 0;
+	while (last < (float)plays) {
+		// Silence once everything was pushed means one got lost
+		bool finished = done;
+		threaded.Mix(block, blockFrames);
+		if (block[0] == 0.0f) {
+			if (finished)
+				break;
+			std::this_thread::yield();
+			continue;
+		}
+		outOfOrder += block[0] <= last || block[blockFrames * 2 - 2] != block[0] ? 1 : 0;
+		last = block[0];
+		blocksPlayed++;
+	}
+	game.join();
+
+	AudioMixerStats stats = threaded.GetStats();
+	CHECK(outOfOrder == 0 && last == (float)plays);
+	CHECK(stats.Commands == plays && stats.Dropped == refused);
+	CHECK(stats.Stolen == plays - blocksPlayed);
+}
+
+// --------------------------------------------------------
+// WAV output
+// --------------------------------------------------------
+
+static uint32_t ReadInt(const std::vector<unsigned char>& bytes, size_t at, int size) {
+	uint32_t value = 0;
+	for (int i = size - 1; i >= 0; i--)
+		value = (value << 8) | bytes[at + i];
+	return value;
+}
+
+static void TestWave() {
+	// Clamping first, then scaled to 32767
+	float edges[6] = { -2.0f, -1.0f, 0.0f, 0.5f, 1.0f, 3.0f };
+	short converted[6];
+	ConvertAudioToInt16(edges, 6, converted);
+	CHECK(converted[0] == -32767 && converted[1] == -32767 && converted[2] == 0);
+	CHECK(converted[3] == 16383 && converted[4] == 32767 && converted[5] == 32767);
+
+	AudioMixer mixer(44100, 8);
+	std::vector<float> samples = Tone(20000, 1, 440.0f, 44100);
+	SoundEffect sound(&mixer, samples.data(), 20000, 1, 44100);
+	sound.Play(1.4f, 0.3f, 0.4f);
+	sound.Play(0.6f, -0.2f, -0.7f);
+
+	const char* path = "AudioMixerTest.wav";
+	const int blocks = 50;
+	std::vector<float> mixed;
+	{
+		WaveFileAudioSink sink(path, 44100);
+		CHECK(sink.IsOpen());
+		float block[AudioBlockFrames * 2];
+		for (int b = 0; b < blocks; b++) {
+			mixer.Mix(block, AudioBlockFrames);
+			mixed.insert(mixed.end(), block, block + AudioBlockFrames * 2);
+			CHECK(sink.Write(block, AudioBlockFrames));
+		}
+	}
+
+	FILE* file = fopen(path, "rb");
+	CHECK(file != 0);
+	if (!file)
+		return;
+	std::vector<unsigned char> bytes;
+	unsigned char buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		bytes.insert(bytes.end(), buffer, buffer + read);
+	fclose(file);
+	remove(path);
+
+	uint32_t dataBytes = blocks * AudioBlockFrames * 4;
+	CHECK(bytes.size() == 44 + dataBytes);
+	if (bytes.size() != 44 + dataBytes)
+		return;
+	CHECK(memcmp(&bytes[0], "RIFF", 4) == 0 && ReadInt(bytes, 4, 4) == 36 + dataBytes && memcmp(&bytes[8], "WAVE", 4) == 0);
+	CHECK(memcmp(&bytes[12], "fmt ", 4) == 0 && ReadInt(bytes, 16, 4) == 16);
+	CHECK(ReadInt(bytes, 20, 2) == 1 && ReadInt(bytes, 22, 2) == 2);
+	CHECK(ReadInt(bytes, 24, 4) == 44100 && ReadInt(bytes, 28, 4) == 44100 * 4);
+	CHECK(ReadInt(bytes, 32, 2) == 4 && ReadInt(bytes, 34, 2) == 16);
+	CHECK(memcmp(&bytes[36], "data", 4) == 0 && ReadInt(bytes, 40, 4) == dataBytes);
+
+	std::vector<short> expected(mixed.size());
+	ConvertAudioToInt16(mixed.data(), (int)mixed.size(), expected.data());
+	int mismatched = 0, clipped = 0;
+	for (size_t i = 0; i < expected.size(); i++) {
+		mismatched += (short)ReadInt(bytes, 44 + i * 2, 2) != expected[i] ? 1 : 0;
+		clipped += fabsf(mixed[i]) > 1.0f ? 1 : 0;
+	}
+	CHECK(mismatched == 0 && clipped > 0);
+}
+
+// --------------------------------------------------------
+// Throughput and latency
+// --------------------------------------------------------
+
+static void BenchmarkMix() {
+	const char* names[2] = { "48 kHz sounds (straight copy)", "44.1 kHz sounds (resampled)" };
+	const int rates[2] = { 48000, 44100 };
+	for (int r = 0; r < 2; r++) {
+		AudioMixer mixer(48000, 32);
+		std::vector<float> samples = Tone(rates[r] * 4, 1, 300.0f, rates[r]);
+		SoundEffect sound(&mixer, samples.data(), rates[r] * 4, 1, rates[r]);
+		for (int v = 0; v < 32; v++)
+			sound.Play(0.03f, r == 0 ? 0.0f : RandomFloat(-0.1f, 0.1f), RandomFloat(-1, 1));
+
+		const int blocks = 500;
+		float block[AudioBlockFrames * 2];
+		auto start = std::chrono::steady_clock::now();
+		for (int b = 0; b < blocks; b++)
+			mixer.Mix(block, AudioBlockFrames);
+		double milliseconds = ElapsedMilliseconds(start);
+
+		AudioMixerStats stats = mixer.GetStats();
+		CHECK(stats.VoiceBlocks == 32 * blocks);
+		printf("%s: %.0f voices per ms of mixing (%.1f us per %d frame block of 32 voices, %.2f%% of real time)\n",
+			names[r], stats.VoiceBlocks / milliseconds, milliseconds * 1000.0 / blocks, AudioBlockFrames,
+			100.0 * milliseconds / (blocks * AudioBlockFrames * 1000.0 / 48000));
+	}
+}
+
+// Paced like NullAudioSink in real time, noting when the first
+// sound after silence arrives
+class ListeningSink : public AudioSink {
+public:
+	ListeningSink(int sampleRate) : heard(0) {
+		this->sampleRate = sampleRate;
+		framesWritten = 0;
+		start = std::chrono::steady_clock::now();
+	}
+
+	bool Write(const float* samples, int frames) {
+		for (int i = 0; i < frames; i++) {
+			if (samples[i * 2] != 0.0f) {
+				// When that frame would be handed over, at the rate
+				// the sink takes them
+				auto at = std::chrono::steady_clock::now() + std::chrono::microseconds((long long)i * 1000000 / sampleRate);
+				long long expected = 0;
+				heard.compare_exchange_strong(expected, at.time_since_epoch().count());
+				break;
+			}
+		}
+		framesWritten += frames;
+		std::this_thread::sleep_until(start + std::chrono::microseconds(framesWritten * 1000000 / sampleRate));
+		return true;
+	}
+
+	std::atomic<long long> heard;
+
+private:
+	int sampleRate;
+	long long framesWritten;
+	std::chrono::steady_clock::time_point start;
+};
+
+static void BenchmarkLatency() {
+	AudioMixer mixer(48000, 32);
+	std::vector<float> ones(64, 1.0f);
+	SoundEffect click(&mixer, ones.data(), 64, 1, 48000);
+	ListeningSink sink(48000);
+	AudioOutput output(&mixer, &sink);
+
+	const int plays = 40;
+	double total = 0, worst = 0;
+	for (int p = 0; p < plays; p++) {
+		std::this_thread::sleep_for(std::chrono::microseconds((long long)RandomFloat(2000, 12000)));
+		sink.heard = 0;
+		auto played = std::chrono::steady_clock::now();
+		click.Play(1.0f, 0.0f, -1.0f);
+		while (sink.heard == 0)
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+
+		double milliseconds = (sink.heard - played.time_since_epoch().count()) *
+			(double)std::chrono::steady_clock::period::num / std::chrono::steady_clock::period::den * 1000.0;
+		total += milliseconds;
+		worst = std::max(worst, milliseconds);
+	}
+
+	// A block of mixing ahead of the sink at most, give or take
+	// the scheduler
+	double blockMilliseconds = AudioBlockFrames * 1000.0 / 48000;
+	CHECK(total / plays < blockMilliseconds * 2);
+	printf("Play to sink: %.2f ms on average, %.2f ms at worst (one %d frame block is %.2f ms)\n",
+		total / plays, worst, AudioBlockFrames, blockMilliseconds);
+}
+
+int main() {
+	TestAccuracy();
+	TestVoices();
+	TestRing();
+	TestWave();
+	BenchmarkMix();
+	BenchmarkLatency();
+	return TestResult("AudioMixerTest");
+}
@@ -0,0 +1,267 @@
+// Bloom kernel: runs the bloom chain's shaders on the CPU, with
+// a bilinear clamp sampler like the game's, and diffs what they
+// produce against the filters they're meant to be.  --write
+// saves the chain's response to a point of light as a PGM.
+//
+//   g++ -std=c++14 -O2 -I.. BloomKernelTest.cpp ../BloomKernel.cpp -o BloomKernelTest && ./BloomKernelTest [--write]
+
+#include "TestCommon.h"
+#include "BloomKernel.h"
+#include <fstream>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+struct Image {
+	int Width;
+	int Height;
+	std::vector<float> Pixels;
+
+	Image(int width, int height) : Width(width), Height(height), Pixels((size_t)width * height, 0.0f) {}
+	float& At(int x, int y) { return Pixels[(size_t)y * Width + x]; }
+	float Texel(int x, int y) const {
+		x = x < 0 ? 0 : (x >= Width ? Width - 1 : x);
+		y = y < 0 ? 0 : (y >= Height ? Height - 1 : y);
+		return Pixels[(size_t)y * Width + x];
+	}
+};
+
+// Linear filtering with clamp addressing, uv in [0, 1]
+static float Sample(const Image& image, float u, float v) {
+	float x = u * image.Width - 0.5f;
+	float y = v * image.Height - 0.5f;
+	int x0 = (int)floorf(x);
+	int y0 = (int)floorf(y);
+	float fx = x - x0;
+	float fy = y - y0;
+	float top = image.Texel(x0, y0) * (1 - fx) + image.Texel(x0 + 1, y0) * fx;
+	float bottom = image.Texel(x0, y0 + 1) * (1 - fx) + image.Texel(x0 + 1, y0 + 1) * fx;
+	return top * (1 - fy) + bottom * fy;
+}
+
+// GaussianBlurPS
+static Image Blur(const Image& source, const BloomTap* taps, int tapCount, bool horizontal) {
+	Image result(source.Width, source.Height);
+	float stepU = horizontal ? 1.0f / source.Width : 0.0f;
+	float stepV = horizontal ? 0.0f : 1.0f / source.Height;
+	for (int y = 0; y < source.Height; y++) {
+		for (int x = 0; x < source.Width; x++) {
+			float u = (x + 0.5f) / source.Width;
+			float v = (y + 0.5f) / source.Height;
+			float total = Sample(source, u, v) * taps[0].Weight;
+			for (int i = 1; i < tapCount; i++) {
+				float du = stepU * taps[i].Offset;
+				float dv = stepV * taps[i].Offset;
+				total += Sample(source, u + du, v + dv) * taps[i].Weight;
+				total += Sample(source, u - du, v - dv) * taps[i].Weight;
+			}
+			result.At(x, y) = total;
+		}
+	}
+	return result;
+}
+
+// DownsamplePS - into an image half the size
+static Image Downsample(const Image& source) {
+	Image result(source.Width > 1 ? source.Width / 2 : 1, source.Height > 1 ? source.Height / 2 : 1);
+	float texelU = 1.0f / source.Width;
+	float texelV = 1.0f / source.Height;
+	for (int y = 0; y < result.Height; y++) {
+		for (int x = 0; x < result.Width; x++) {
+			float u = (x + 0.5f) / result.Width;
+			float v = (y + 0.5f) / result.Height;
+			result.At(x, y) = (Sample(source, u - texelU, v - texelV) + Sample(source, u + texelU, v - texelV) +
+				Sample(source, u - texelU, v + texelV) + Sample(source, u + texelU, v + texelV)) * 0.25f;
+		}
+	}
+	return result;
+}
+
+// UpsamplePS, added onto the larger level by the blend state
+static void UpsampleAdd(const Image& source, Image& dest) {
+	float halfU = 0.5f / source.Width;
+	float halfV = 0.5f / source.Height;
+	for (int y = 0; y < dest.Height; y++) {
+		for (int x = 0; x < dest.Width; x++) {
+			float u = (x + 0.5f) / dest.Width;
+			float v = (y + 0.5f) / dest.Height;
+			dest.At(x, y) += (Sample(source, u - halfU, v - halfV) + Sample(source, u + halfU, v - halfV) +
+				Sample(source, u - halfU, v + halfV) + Sample(source, u + halfU, v + halfV)) * 0.25f;
+		}
+	}
+}
+
+// The whole chain from the bright pass target, as Game::DrawBloom runs it
+static Image BloomChain(const Image& brightPass, int levels, const BloomTap* taps, int tapCount) {
+	std::vector<Image> chain;
+	chain.push_back(brightPass);
+	for (int i = 1; i < levels; i++)
+		chain.push_back(Downsample(chain.back()));
+	for (int i = 0; i < levels; i++)
+		chain[i] = Blur(Blur(chain[i], taps, tapCount, true), taps, tapCount, false);
+	for (int i = levels - 2; i >= 0; i--)
+		UpsampleAdd(chain[i + 1], chain[i]);
+
+	Image result = chain[0];
+	for (size_t i = 0; i < result.Pixels.size(); i++)
+		result.Pixels[i] /= levels;
+	return result;
+}
+
+static float MaxDifference(const Image& a, const Image& b) {
+	float largest = 0;
+	for (size_t i = 0; i < a.Pixels.size(); i++)
+		largest = fmaxf(largest, fabsf(a.Pixels[i] - b.Pixels[i]));
+	return largest;
+}
+
+static double Sum(const Image& image) {
+	double total = 0;
+	for (size_t i = 0; i < image.Pixels.size(); i++)
+		total += image.Pixels[i];
+	return total;
+}
+
+static Image Noise(int width, int height) {
+	Image image(width, height);
+	uint32_t seed = 7;
+	for (size_t i = 0; i < image.Pixels.size(); i++) {
+		seed = seed * 1664525 + 1013904223;
+		image.Pixels[i] = (seed >> 8) / 16777216.0f;
+	}
+	return image;
+}
+
+static void TestTaps() {
+	BloomTap taps[BloomMaxTaps];
+	CHECK(BuildLinearBlurTaps(2.5f, 6, taps, BloomMaxTaps) == 4);
+	CHECK(taps[0].Offset == 0.0f);
+
+	// Weights cover both sides and add up to one
+	float total = taps[0].Weight;
+	for (int i = 1; i < 4; i++) {
+		total += 2 * taps[i].Weight;
+		CHECK(taps[i].Offset > 2 * i - 1 - 0.001f && taps[i].Offset < 2 * i + 0.001f);
+	}
+	CHECK(fabsf(total - 1.0f) < 1e-5f);
+
+	// Odd radius leaves the last texel on its own
+	CHECK(BuildLinearBlurTaps(2.0f, 5, taps, BloomMaxTaps) == 4);
+	CHECK(fabsf(taps[3].Offset - 5.0f) < 1e-5f);
+
+	CHECK(BuildLinearBlurTaps(2.5f, 20, taps, BloomMaxTaps) == 0);
+	CHECK(BuildLinearBlurTaps(2.5f, 6, taps, 3) == 0);
+	CHECK(BuildLinearBlurTaps(0.0f, 6, taps, BloomMaxTaps) == 0);
+}
+
+// The merged bilinear taps against every texel weighted on its own
+static void TestBlurMatchesGaussian() {
+	const float sigma = 2.5f;
+	const int radius = 6;
+	BloomTap taps[BloomMaxTaps];
+	int tapCount = BuildLinearBlurTaps(sigma, radius, taps, BloomMaxTaps);
+
+	float weights[radius + 1];
+	float total = 0;
+	for (int i = 0; i <= radius; i++) {
+		weights[i] = expf(-(float)(i * i) / (2 * sigma * sigma));
+		total += i == 0 ? weights[i] : 2 * weights[i];
+	}
+
+	Image source = Noise(61, 37);
+	Image reference(source.Width, source.Height);
+	for (int y = 0; y < source.Height; y++) {
+		for (int x = 0; x < source.Width; x++) {
+			float sum = 0;
+			for (int i = -radius; i <= radius; i++)
+				sum += source.Texel(x + i, y) * weights[i < 0 ? -i : i] / total;
+			reference.At(x, y) = sum;
+		}
+	}
+	Image blurred = Blur(source, taps, tapCount, true);
+	float difference = MaxDifference(blurred, reference);
+	CHECK(difference < 1e-5f);
+	printf("blur vs discrete gaussian: max difference %g\n", difference);
+}
+
+// Each downsampled texel is the average of a 4x4 block
+static void TestDownsampleIsBox() {
+	Image source = Noise(64, 32);
+	Image small = Downsample(source);
+	float largest = 0;
+	for (int y = 1; y < small.Height - 1; y++) {
+		for (int x = 1; x < small.Width - 1; x++) {
+			float sum = 0;
+			for (int j = -1; j < 3; j++)
+				for (int i = -1; i < 3; i++)
+					sum += source.Texel(x * 2 + i, y * 2 + j);
+			largest = fmaxf(largest, fabsf(sum / 16 - small.At(x, y)));
+		}
+	}
+	CHECK(largest < 1e-5f);
+}
+
+static void TestChain(bool write) {
+	BloomTap taps[BloomMaxTaps];
+	int tapCount = BuildLinearBlurTaps(2.5f, 6, taps, BloomMaxTaps);
+	const int levels = 5;
+
+	// A point of light, in the middle and far enough from the
+	// edges that even the smallest level doesn't clamp it
+	Image light(512, 512);
+	for (int y = 254; y < 258; y++)
+		for (int x = 254; x < 258; x++)
+			light.At(x, y) = 1.0f;
+	Image bloom = BloomChain(light, levels, taps, tapCount);
+
+	// It spreads the same way in every direction
+	Image mirrored(bloom.Width, bloom.Height);
+	Image transposed(bloom.Width, bloom.Height);
+	for (int y = 0; y < bloom.Height; y++) {
+		for (int x = 0; x < bloom.Width; x++) {
+			mirrored.At(x, y) = bloom.Texel(bloom.Width - 1 - x, y);
+			transposed.At(x, y) = bloom.Texel(y, x);
+		}
+	}
+	CHECK(MaxDifference(bloom, mirrored) < 1e-5f);
+	CHECK(MaxDifference(bloom, transposed) < 1e-5f);
+
+	// Each level keeps the light's energy, so after dividing by
+	// the level count the chain as a whole does too
+	double energy = Sum(bloom) / Sum(light);
+	CHECK(fabs(energy - 1.0) < 0.01);
+
+	// And falls off smoothly away from the center
+	bool falling = true;
+	for (int x = 258; x < 511; x++)
+		falling = falling && bloom.At(x + 1, 256) <= bloom.At(x, 256) + 1e-6f;
+	CHECK(falling);
+	CHECK(bloom.At(320, 256) > 0.0f);		// Reaches well past a single blur's radius
+
+	printf("chain: energy %.4f, peak %.4f, at 16 texels %.5f, at 64 texels %.6f\n",
+		energy, bloom.At(256, 256), bloom.At(272, 256), bloom.At(320, 256));
+
+	if (write) {
+		std::ofstream file("BloomKernelTest_chain.pgm", std::ios::binary);
+		file << "P5\n" << bloom.Width << " " << bloom.Height << "\n255\n";
+		float peak = bloom.At(256, 256);
+		for (size_t i = 0; i < bloom.Pixels.size(); i++) {
+			// Square root so the tail shows up
+			file.put((char)(uint8_t)(sqrtf(bloom.Pixels[i] / peak) * 255.0f + 0.5f));
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	TestTaps();
+	TestBlurMatchesGaussian();
+	TestDownsampleIsBox();
+	TestChain(argc > 1 && strcmp(argv[1], "--write") == 0);
+
+	BloomTap taps[BloomMaxTaps];
+	int tapCount = BuildLinearBlurTaps(2.5f, 6, taps, BloomMaxTaps);
+	BloomTrafficEstimate estimate = EstimateBloomTraffic(1280, 720, 5, tapCount, 8);
+	printf("1280x720 chain: %.2f Mpixels shaded, %.2f M fetches, %.1f MB read, %.1f MB written\n",
+		estimate.PixelsShaded / 1e6, estimate.TextureFetches / 1e6, estimate.BytesRead / 1048576, estimate.BytesWritten / 1048576);
+	return TestResult("BloomKernelTest");
+}
@@ -0,0 +1,303 @@
+// Collision: sphere against box sweeps with known answers,
+// moving boxes carrying the spheres they hit, then random
+// worlds checked against a brute force sweep of every pair
+// and for where spheres and contact points end up.  Ends
+// with how long a Step takes for a crowded world, and for
+// 50k moving boxes.
+//
+//   g++ -std=c++14 -O2 -I.. CollisionTest.cpp ../Collision.cpp -o CollisionTest && ./CollisionTest
+
+#include "TestCommon.h"
+#include "Collision.h"
+#include <math.h>
+
+static bool Near(float a, float b, float tolerance = 1e-4f) {
+	return fabsf(a - b) <= tolerance;
+}
+
+static float Random(uint32_t& seed, float low, float high) {
+	seed = seed * 1664525 + 1013904223;
+	return low + (high - low) * ((seed >> 8) / 16777216.0f);
+}
+
+static float DistanceToBox(const float point[3], const float center[3], const float halfExtents[3]) {
+	float distanceSq = 0.0f;
+	for (int i = 0; i < 3; i++) {
+		float outside = fabsf(point[i] - center[i]) - halfExtents[i];
+		if (outside > 0.0f)
+			distanceSq += outside * outside;
+	}
+	return sqrtf(distanceSq);
+}
+
+static void TestSweeps() {
+	const float box[3] = { 0.0f, 0.0f, 0.0f };
+	const float half[3] = { 1.0f, 1.0f, 1.0f };
+	float time, normal[3];
+
+	// Face
+	float faceStart[3] = { -3.0f, 0.2f, 0.0f };
+	float faceMotion[3] = { 4.0f, 0.0f, 0.0f };
+	CHECK(SweepSphereBox(faceStart, 0.5f, faceMotion, box, half, time, normal));
+	CHECK(Near(time, 1.5f / 4.0f));
+	CHECK(Near(normal[0], -1.0f) && Near(normal[1], 0.0f) && Near(normal[2], 0.0f));
+
+	// Edge, along the diagonal
+	float edgeStart[3] = { -3.0f, -3.0f, 0.0f };
+	float edgeMotion[3] = { 4.0f, 4.0f, 0.0f };
+	float edgeContact = -1.0f - 0.5f / sqrtf(2.0f);
+	CHECK(SweepSphereBox(edgeStart, 0.5f, edgeMotion, box, half, time, normal));
+	CHECK(Near(time, (edgeContact + 3.0f) / 4.0f));
+	CHECK(Near(normal[0], -0.70711f) && Near(normal[1], -0.70711f) && Near(normal[2], 0.0f));
+
+	// Corner
+	float cornerStart[3] = { -3.0f, -3.0f, -3.0f };
+	float cornerMotion[3] = { 4.0f, 4.0f, 4.0f };
+	float cornerContact = -1.0f - 0.5f / sqrtf(3.0f);
+	CHECK(SweepSphereBox(cornerStart, 0.5f, cornerMotion, box, half, time, normal));
+	CHECK(Near(time, (cornerContact + 3.0f) / 4.0f));
+	CHECK(Near(normal[0], -0.57735f) && Near(normal[1], -0.57735f) && Near(normal[2], -0.57735f));
+
+	// Past the corner, inside the grown box's bounds but outside
+	// the rounded one
+	float passStart[3] = { -3.0f, -1.4f, -1.4f };
+	float passMotion[3] = { 6.0f, 0.0f, 0.0f };
+	CHECK(!SweepSphereBox(passStart, 0.5f, passMotion, box, half, time, normal));
+
+	// Resting on top: falling further is a contact at once,
+	// moving off isn't
+	float resting[3] = { 0.3f, 1.5f, 0.0f };
+	float down[3] = { 0.0f, -0.1f, 0.0f };
+	float up[3] = { 0.0f, 0.1f, 0.0f };
+	CHECK(SweepSphereBox(resting, 0.5f, down, box, half, time, normal) && time == 0.0f && Near(normal[1], 1.0f));
+	CHECK(!SweepSphereBox(resting, 0.5f, up, box, half, time, normal));
+}
+
+// A box sliding into a still sphere pushes it along, so the
+// sphere ends the step touching the box, not inside it
+static void TestMovingBox() {
+	CollisionWorld world;
+	const float boxCenter[3] = { 0.0f, 0.0f, 0.0f };
+	const float half[3] = { 1.0f, 1.0f, 1.0f };
+	const float sphereCenter[3] = { 2.0f, 0.3f, 0.0f };
+	int box = world.AddBox(boxCenter, half);
+	int sphere = world.AddSphere(sphereCenter, 0.5f);
+
+	const float boxMove[3] = { 3.0f, 0.0f, 0.0f };
+	world.MoveBox(box, boxMove);
+	world.Step();
+
+	CHECK(world.GetContacts().size() == 1);
+	if (world.GetContacts().size() != 1)
+		return;
+	const CollisionContact& contact = world.GetContacts()[0];
+	CHECK(contact.Sphere == sphere && contact.Box == box);
+	CHECK(Near(contact.Time, 0.5f / 3.0f));
+
+	float center[3], boxNow[3];
+	world.GetSpherePosition(sphere, center);
+	world.GetBoxPosition(box, boxNow);
+	CHECK(Near(boxNow[0], 3.0f));
+	CHECK(Near(center[0], 4.5f) && Near(center[1], 0.3f));
+	CHECK(Near(contact.Point[0], 4.0f) && Near(contact.Point[1], 0.3f) && Near(contact.Point[2], 0.0f));
+	CHECK(Near(contact.Normal[0], 1.0f));
+}
+
+// The ball falling onto a platform that's sliding towards the
+// camera, like the game: it lands on top and rides along
+static void TestLanding() {
+	CollisionWorld world;
+	const float platform[3] = { 1.0f, -1.0f, 4.0f };
+	const float half[3] = { 0.5f, 0.1f, 1.0f };
+	const float ball[3] = { 1.2f, -0.5f, 4.5f };
+	world.AddBox(platform, half);
+	world.AddSphere(ball, 0.25f);
+
+	const float platformMove[3] = { 0.0f, 0.0f, -0.3f };
+	const float ballMove[3] = { 0.05f, -0.4f, 0.0f };
+	world.MoveBox(0, platformMove);
+	world.MoveSphere(0, ballMove);
+	world.Step();
+
+	CHECK(world.GetContacts().size() == 1);
+	if (world.GetContacts().size() != 1)
+		return;
+	const CollisionContact& contact = world.GetContacts()[0];
+	float center[3];
+	world.GetSpherePosition(0, center);
+	float time = 0.15f / 0.4f;
+	CHECK(Near(contact.Time, time));
+	CHECK(Near(contact.Normal[1], 1.0f));
+	CHECK(Near(center[0], 1.2f + 0.05f * time));
+	CHECK(Near(center[1], -0.9f + 0.25f));
+	CHECK(Near(center[2], 4.5f - 0.3f * (1.0f - time)));
+	CHECK(Near(contact.Point[1], -0.9f) && Near(contact.Point[0], center[0]) && Near(contact.Point[2], center[2]));
+}
+
+struct RandomWorld {
+	std::vector<float> SphereStart, SphereMotion, SphereRadius;
+	std::vector<float> BoxStart, BoxMotion, BoxHalf;
+};
+
+static RandomWorld MakeWorld(uint32_t& seed, int sphereCount, int boxCount, float size, float speed) {
+	RandomWorld world;
+	for (int b = 0; b < boxCount; b++) {
+		for (int i = 0; i < 3; i++) {
+			world.BoxStart.push_back(Random(seed, -size, size));
+			world.BoxHalf.push_back(Random(seed, 0.2f, 1.5f));
+			world.BoxMotion.push_back(Random(seed, -speed, speed));
+		}
+	}
+	// Spheres start clear of every box
+	while ((int)world.SphereRadius.size() < sphereCount) {
+		float center[3] = { Random(seed, -size, size), Random(seed, -size, size), Random(seed, -size, size) };
+		float radius = Random(seed, 0.1f, 0.8f);
+		bool clear = true;
+		for (int b = 0; b < boxCount && clear; b++)
+			clear = DistanceToBox(center, &world.BoxStart[b * 3], &world.BoxHalf[b * 3]) > radius + 0.01f;
+		if (!clear)
+			continue;
+		world.SphereStart.insert(world.SphereStart.end(), center, center + 3);
+		world.SphereRadius.push_back(radius);
+		for (int i = 0; i < 3; i++)
+			world.SphereMotion.push_back(Random(seed, -speed, speed));
+	}
+	return world;
+}
+
+static void Build(const RandomWorld& random, CollisionWorld& world) {
+	for (size_t b = 0; b < random.BoxHalf.size() / 3; b++) {
+		world.AddBox(&random.BoxStart[b * 3], &random.BoxHalf[b * 3]);
+		world.MoveBox((int)b, &random.BoxMotion[b * 3]);
+	}
+	for (size_t s = 0; s < random.SphereRadius.size(); s++) {
+		world.AddSphere(&random.SphereStart[s * 3], random.SphereRadius[s]);
+		world.MoveSphere((int)s, &random.SphereMotion[s * 3]);
+	}
+}
+
+// Same contacts as sweeping every pair, and every sphere that
+// hit something ends up touching that box where the box ended
+static void TestRandomWorlds() {
+	uint32_t seed = 3;
+	int contactsChecked = 0;
+	for (int round = 0; round < 300; round++) {
+		RandomWorld random = MakeWorld(seed, 40, 25, 8.0f, 3.0f);
+		CollisionWorld world;
+		Build(random, world);
+		world.Step();
+
+		int sphereCount = (int)random.SphereRadius.size();
+		int boxCount = (int)random.BoxHalf.size() / 3;
+		std::vector<int> contactOf(sphereCount, -1);
+		const std::vector<CollisionContact>& contacts = world.GetContacts();
+		for (size_t c = 0; c < contacts.size(); c++)
+			contactOf[contacts[c].Sphere] = (int)c;
+
+		for (int s = 0; s < sphereCount; s++) {
+			float earliest = 2.0f;
+			for (int b = 0; b < boxCount; b++) {
+				float motion[3], time, normal[3];
+				for (int i = 0; i < 3; i++)
+					motion[i] = random.SphereMotion[s * 3 + i] - random.BoxMotion[b * 3 + i];
+				if (SweepSphereBox(&random.SphereStart[s * 3], random.SphereRadius[s], motion, &random.BoxStart[b * 3], &random.BoxHalf[b * 3], time, normal))
+					earliest = time < earliest ? time : earliest;
+			}
+
+			float center[3];
+			world.GetSpherePosition(s, center);
+			if (earliest > 1.0f) {
+				CHECK(contactOf[s] < 0);
+				for (int i = 0; i < 3; i++)
+					CHECK(Near(center[i], random.SphereStart[s * 3 + i] + random.SphereMotion[s * 3 + i], 1e-3f));
+				continue;
+			}
+
+			CHECK(contactOf[s] >= 0);
+			if (contactOf[s] < 0)
+				continue;
+			const CollisionContact& contact = contacts[contactOf[s]];
+			CHECK(contact.Time == earliest);
+
+			float boxNow[3];
+			world.GetBoxPosition(contact.Box, boxNow);
+			const float* half = &random.BoxHalf[contact.Box * 3];
+			float radius = random.SphereRadius[s];
+			CHECK(Near(DistanceToBox(center, boxNow, half), radius, 2e-3f));
+
+			// The point is the closest one on the surface
+			CHECK(DistanceToBox(contact.Point, boxNow, half) < 1e-4f);
+			float offset[3];
+			for (int i = 0; i < 3; i++)
+				offset[i] = center[i] - contact.Point[i];
+			float distance = sqrtf(offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2]);
+			CHECK(Near(distance, radius, 2e-3f));
+			CHECK(offset[0] * contact.Normal[0] + offset[1] * contact.Normal[1] + offset[2] * contact.Normal[2] > radius * 0.99f);
+			contactsChecked++;
+		}
+	}
+	CHECK(contactsChecked > 500);
+}
+
+static void Benchmark() {
+	uint32_t seed = 11;
+	RandomWorld random = MakeWorld(seed, 2000, 500, 60.0f, 0.5f);
+	CollisionWorld world;
+	Build(random, world);
+
+	// The first Step sorts from scratch, the rest barely change
+	world.Step();
+	const int steps = 200;
+	long long pairs = 0, contacts = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int step = 0; step < steps; step++) {
+		for (size_t s = 0; s < random.SphereRadius.size(); s++)
+			world.MoveSphere((int)s, &random.SphereMotion[s * 3]);
+		for (size_t b = 0; b < random.BoxHalf.size() / 3; b++)
+			world.MoveBox((int)b, &random.BoxMotion[b * 3]);
+		world.Step();
+		pairs += world.GetStats().PairsTested;
+		contacts += world.GetStats().Contacts;
+	}
+	double milliseconds = ElapsedMilliseconds(start);
+	printf("2000 spheres, 500 boxes: %.1f us/step, %.0f pairs swept and %.0f contacts a step\n",
+		milliseconds * 1000.0 / steps, (double)pairs / steps, (double)contacts / steps);
+}
+
+// The broadphase at scale: 50k boxes all moving every step
+static void BenchmarkBoxes() {
+	uint32_t seed = 17;
+	RandomWorld random = MakeWorld(seed, 2000, 50000, 280.0f, 0.5f);
+	CollisionWorld world;
+	Build(random, world);
+
+	auto start = std::chrono::steady_clock::now();
+	world.Step();
+	double first = ElapsedMilliseconds(start);
+
+	const int steps = 20;
+	long long pairs = 0, contacts = 0;
+	start = std::chrono::steady_clock::now();
+	for (int step = 0; step < steps; step++) {
+		for (size_t s = 0; s < random.SphereRadius.size(); s++)
+			world.MoveSphere((int)s, &random.SphereMotion[s * 3]);
+		for (size_t b = 0; b < random.BoxHalf.size() / 3; b++)
+			world.MoveBox((int)b, &random.BoxMotion[b * 3]);
+		world.Step();
+		pairs += world.GetStats().PairsTested;
+		contacts += world.GetStats().Contacts;
+	}
+	double milliseconds = ElapsedMilliseconds(start);
+	printf("2000 spheres, 50000 moving boxes: first step %.1f ms, then %.2f ms/step, %.0f pairs swept and %.0f contacts a step\n",
+		first, milliseconds / steps, (double)pairs / steps, (double)contacts / steps);
+}
+
+int main() {
+	TestSweeps();
+	TestMovingBox();
+	TestLanding();
+	TestRandomWorlds();
+	Benchmark();
+	BenchmarkBoxes();
+	return TestResult("CollisionTest");
+}
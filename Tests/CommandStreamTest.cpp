@@ -0,0 +1,385 @@
+// Command stream: records frames the way RenderContext does,
+// checks what the analyzer makes of them (counts per pass,
+// redundant binds, cut short and garbled streams), then
+// replays them on the software rasterizer and compares that
+// with drawing the same thing directly.  Ends with how fast
+// the analyzer reads a long capture and a replay runs.
+//
+//   g++ -std=c++14 -O2 -pthread -I.. CommandStreamTest.cpp ../CommandStream.cpp ../SoftwareReplay.cpp ../SoftwareRasterizer.cpp -o CommandStreamTest && ./CommandStreamTest
+
+#include "TestCommon.h"
+#include "CommandStream.h"
+#include "SoftwareReplay.h"
+#include <string.h>
+
+// Stand ins for D3D objects - only their addresses matter
+struct FakeObject {
+	int Unused;
+};
+
+struct Objects {
+	FakeObject VertexBuffer, IndexBuffer, ConstantBuffer;
+	FakeObject VertexShader, PixelShader, DepthVertexShader;
+	FakeObject BackBuffer, DepthBuffer, ShadowDepth;
+	FakeObject FadeBlend, ShadowRasterizer, Texture, Sampler;
+};
+
+// Same arguments RenderContext records for each call
+static void ClearColor(CommandRecorder& recorder, const void* view, const float color[4]) {
+	uint32_t args[5];
+	args[0] = recorder.GetObjectId(view);
+	memcpy(&args[1], color, sizeof(float) * 4);
+	recorder.Record(CommandClearColor, args, 5);
+}
+
+static void ClearDepth(CommandRecorder& recorder, const void* view, float depth) {
+	uint32_t depthBits;
+	memcpy(&depthBits, &depth, sizeof(depthBits));
+	recorder.Record(CommandClearDepth, recorder.GetObjectId(view), 1, depthBits);
+}
+
+static void BindTargets(CommandRecorder& recorder, const void* color, const void* depth) {
+	uint32_t args[2] = { recorder.GetObjectId(depth), recorder.GetObjectId(color) };
+	recorder.Record(CommandBindRenderTargets, args, color ? 2 : 1);
+}
+
+static void BindShader(CommandRecorder& recorder, CommandStage stage, const void* shader) {
+	recorder.Record(CommandBindShader, stage, recorder.GetObjectId(shader));
+}
+
+// --------------------------------------------------------
+// A small scene: a floor and two quads over it, the nearer
+// one faded, with a depth only shadow pass first
+// --------------------------------------------------------
+struct SceneVertex {
+	float Position[3];
+	float Color[4];
+};
+
+static const SceneVertex sceneVertices[] = {
+	// Floor
+	{ { -1.0f, -1.0f, 0.9f }, { 0.3f, 0.3f, 0.3f, 1.0f } },
+	{ { -1.0f, 0.0f, 0.6f }, { 0.5f, 0.5f, 0.5f, 1.0f } },
+	{ { 1.0f, 0.0f, 0.6f }, { 0.5f, 0.5f, 0.5f, 1.0f } },
+	{ { 1.0f, -1.0f, 0.9f }, { 0.3f, 0.3f, 0.3f, 1.0f } },
+	// Back quad
+	{ { -0.6f, -0.5f, 0.5f }, { 0.1f, 0.4f, 0.9f, 1.0f } },
+	{ { -0.6f, 0.7f, 0.5f }, { 0.1f, 0.8f, 0.9f, 1.0f } },
+	{ { 0.4f, 0.7f, 0.5f }, { 0.1f, 0.8f, 0.9f, 1.0f } },
+	{ { 0.4f, -0.5f, 0.5f }, { 0.1f, 0.4f, 0.9f, 1.0f } },
+	// Front quad
+	{ { -0.2f, -0.8f, 0.3f }, { 1.0f, 0.3f, 0.1f, 0.5f } },
+	{ { -0.2f, 0.3f, 0.3f }, { 1.0f, 0.6f, 0.1f, 0.5f } },
+	{ { 0.8f, 0.3f, 0.3f }, { 1.0f, 0.6f, 0.1f, 0.5f } },
+	{ { 0.8f, -0.8f, 0.3f }, { 1.0f, 0.3f, 0.1f, 0.5f } },
+};
+
+// One quad's indices, drawn with a base vertex for each
+static const unsigned int sceneIndices[] = { 0, 1, 2, 0, 2, 3 };
+
+static void SceneVS(const void* vertex, SoftwareVertex& out) {
+	const SceneVertex& input = *(const SceneVertex*)vertex;
+	out.Position[0] = input.Position[0];
+	out.Position[1] = input.Position[1];
+	out.Position[2] = input.Position[2];
+	out.Position[3] = 1.0f;
+	memcpy(out.Varyings, input.Color, sizeof(input.Color));
+}
+
+static bool ScenePS(const float* varyings, float color[4]) {
+	memcpy(color, varyings, sizeof(float) * 4);
+	return true;
+}
+
+static const float clearColor[4] = { 0.05f, 0.05f, 0.1f, 1.0f };
+
+static void RecordFrame(CommandRecorder& recorder, Objects& objects) {
+	uint32_t vertexBuffer = recorder.GetObjectId(&objects.VertexBuffer);
+	uint32_t indexBuffer = recorder.GetObjectId(&objects.IndexBuffer);
+
+	recorder.Record(CommandBeginFrame);
+
+	// Shadow pass - depth only, its own rasterizer state
+	recorder.Record(CommandBeginPass, recorder.GetNameId("Shadow"));
+	BindTargets(recorder, 0, &objects.ShadowDepth);
+	ClearDepth(recorder, &objects.ShadowDepth, 1.0f);
+	recorder.Record(CommandBindRasterizer, recorder.GetObjectId(&objects.ShadowRasterizer));
+	recorder.Record(CommandBindVertexBuffer, 0, vertexBuffer, sizeof(SceneVertex), 0);
+	recorder.Record(CommandBindIndexBuffer, indexBuffer, 42, 0);
+	recorder.Record(CommandUploadConstants, CommandStageVertex, recorder.GetObjectId(&objects.DepthVertexShader), 192);
+	BindShader(recorder, CommandStageVertex, &objects.DepthVertexShader);
+	recorder.Record(CommandBindShader, CommandStagePixel, 0);
+	for (int quad = 1; quad < 3; quad++)
+		recorder.Record(CommandDrawIndexed, 6, 0, quad * 4);
+	recorder.Record(CommandBindRasterizer, 0);
+	recorder.Record(CommandEndPass);
+
+	// Scene pass
+	recorder.Record(CommandBeginPass, recorder.GetNameId("Scene"));
+	BindTargets(recorder, &objects.BackBuffer, &objects.DepthBuffer);
+	ClearColor(recorder, &objects.BackBuffer, clearColor);
+	ClearDepth(recorder, &objects.DepthBuffer, 1.0f);
+	recorder.Record(CommandUploadConstants, CommandStageVertex, recorder.GetObjectId(&objects.VertexShader), 192);
+	recorder.Record(CommandUploadConstants, CommandStagePixel, recorder.GetObjectId(&objects.PixelShader), 64);
+	BindShader(recorder, CommandStageVertex, &objects.VertexShader);
+	BindShader(recorder, CommandStagePixel, &objects.PixelShader);
+	recorder.Record(CommandBindResource, CommandStagePixel, 0, recorder.GetObjectId(&objects.Texture));
+	recorder.Record(CommandBindSampler, CommandStagePixel, 0, recorder.GetObjectId(&objects.Sampler));
+	for (int quad = 0; quad < 2; quad++) {
+		// The material rebinds per draw - the second is redundant
+		recorder.Record(CommandBindResource, CommandStagePixel, 0, recorder.GetObjectId(&objects.Texture));
+		recorder.Record(CommandDrawIndexed, 6, 0, quad * 4);
+	}
+	recorder.Record(CommandBindBlendState, recorder.GetObjectId(&objects.FadeBlend), 0xFFFFFFFF);
+	recorder.Record(CommandUploadBuffer, recorder.GetObjectId(&objects.ConstantBuffer), 256);
+	recorder.Record(CommandDrawIndexed, 6, 0, 8);
+	recorder.Record(CommandBindBlendState, 0, 0xFFFFFFFF);
+	recorder.Record(CommandEndPass);
+
+	recorder.Record(CommandEndFrame);
+}
+
+// --------------------------------------------------------
+// Analyzer
+// --------------------------------------------------------
+
+static const CommandPassStats* FindPass(const CommandStreamReport& report, const char* name) {
+	for (size_t i = 0; i < report.Passes.size(); i++)
+		if (report.Passes[i].Name == name)
+			return &report.Passes[i];
+	return 0;
+}
+
+static void TestAnalyzer() {
+	CommandRecorder recorder;
+	Objects objects;
+	RecordFrame(recorder, objects);
+	RecordFrame(recorder, objects);
+
+	const std::vector<uint8_t>& data = recorder.GetData();
+	CommandStreamReport report = AnalyzeCommandStream(data.data(), data.size());
+	CHECK(report.Valid);
+	CHECK(report.Frames == 2);
+	CHECK(report.Passes.size() == 2);
+
+	const CommandPassStats* shadow = FindPass(report, "Shadow");
+	const CommandPassStats* scene = FindPass(report, "Scene");
+	CHECK(shadow && scene);
+	if (!shadow || !scene)
+		return;
+
+	CHECK(shadow->Draws == 4 && shadow->Primitives == 8);
+	CHECK(shadow->Binds == 2 * 7);
+	CHECK(shadow->Clears == 2);
+	CHECK(shadow->BytesUploaded == 2 * 192);
+
+	CHECK(scene->Draws == 6 && scene->Primitives == 12);
+	CHECK(scene->Binds == 2 * 9);
+	CHECK(scene->Clears == 4);
+	CHECK(scene->BytesUploaded == 2 * (192 + 64 + 256));
+
+	// The scene's texture is bound three times a frame with
+	// nothing else in that slot.  Frame two also finds the
+	// buffers and the sampler still bound from frame one.
+	CommandRecorder single;
+	RecordFrame(single, objects);
+	CHECK(AnalyzeCommandStream(single.GetData().data(), single.GetData().size()).Total.RedundantBinds == 2);
+	CHECK(shadow->RedundantBinds == 2);
+	CHECK(scene->RedundantBinds == 6);
+	CHECK(report.Total.RedundantBinds == 8);
+	CHECK(report.Total.Draws == shadow->Draws + scene->Draws);
+
+	// Something drawing behind the stream's back means the next
+	// binds can't be redundant
+	CommandRecorder invalidated;
+	invalidated.Record(CommandBindBlendState, 5, 0xFFFFFFFF);
+	invalidated.Record(CommandBindBlendState, 5, 0xFFFFFFFF);
+	invalidated.Record(CommandInvalidateState);
+	invalidated.Record(CommandBindBlendState, 5, 0xFFFFFFFF);
+	report = AnalyzeCommandStream(invalidated.GetData().data(), invalidated.GetData().size());
+	CHECK(report.Total.Binds == 3 && report.Total.RedundantBinds == 1);
+
+	// Draws recorded with only a count, as older captures have
+	CommandRecorder old;
+	old.Record(CommandBeginFrame);
+	old.Record(CommandDrawIndexed, 30);
+	old.Record(CommandDraw, 3);
+	old.Record(CommandEndFrame);
+	report = AnalyzeCommandStream(old.GetData().data(), old.GetData().size());
+	CHECK(report.Valid && report.Total.Draws == 2 && report.Total.Primitives == 11);
+}
+
+// Every cut of a stream reads up to the cut and no further,
+// and random damage never reads out of bounds
+static void TestDamagedStreams() {
+	CommandRecorder recorder;
+	Objects objects;
+	RecordFrame(recorder, objects);
+	const std::vector<uint8_t>& data = recorder.GetData();
+
+	// Command boundaries, from reading the whole thing
+	std::vector<size_t> boundaries(1, 0);
+	size_t at = 0;
+	ReadCommandStream(data.data(), data.size(), [&](const Command& command) {
+		at += 2 + command.Args.size() * 4 + command.Text.size();
+		boundaries.push_back(at);
+	});
+	CHECK(at == data.size());
+
+	size_t boundary = 0;
+	for (size_t size = 0; size <= data.size(); size++) {
+		while (boundary + 1 < boundaries.size() && boundaries[boundary + 1] <= size)
+			boundary++;
+		long long commands = 0;
+		bool valid = ReadCommandStream(data.data(), size, [&](const Command&) { commands++; });
+		CHECK(valid == (boundaries[boundary] == size));
+		CHECK(commands == (long long)boundary);
+		AnalyzeCommandStream(data.data(), size);
+	}
+
+	uint32_t seed = 7;
+	std::vector<uint8_t> damaged;
+	for (int round = 0; round < 20000; round++) {
+		damaged = data;
+		for (int flips = 0; flips < 4; flips++) {
+			seed = seed * 1664525 + 1013904223;
+			damaged[(seed >> 8) % damaged.size()] = (uint8_t)(seed >> 24);
+		}
+		size_t size = (seed >> 4) % (damaged.size() + 1);
+		std::vector<uint8_t> cut(damaged.begin(), damaged.begin() + size);
+		AnalyzeCommandStream(cut.data(), cut.size());
+	}
+}
+
+// --------------------------------------------------------
+// Replay
+// --------------------------------------------------------
+
+static void Register(SoftwareReplay& replay, CommandRecorder& recorder, Objects& objects, SoftwareTarget& backBuffer, SoftwareTarget& shadowMap) {
+	replay.SetBuffer(recorder.GetObjectId(&objects.VertexBuffer), sceneVertices, sizeof(sceneVertices));
+	replay.SetBuffer(recorder.GetObjectId(&objects.IndexBuffer), sceneIndices, sizeof(sceneIndices));
+	replay.SetVertexShader(recorder.GetObjectId(&objects.VertexShader), SceneVS, 4);
+	replay.SetVertexShader(recorder.GetObjectId(&objects.DepthVertexShader), SceneVS, 0);
+	replay.SetPixelShader(recorder.GetObjectId(&objects.PixelShader), ScenePS);
+	replay.SetView(recorder.GetObjectId(&objects.BackBuffer), &backBuffer);
+	replay.SetView(recorder.GetObjectId(&objects.DepthBuffer), &backBuffer);
+	replay.SetView(recorder.GetObjectId(&objects.ShadowDepth), &shadowMap);
+	replay.SetBlendState(recorder.GetObjectId(&objects.FadeBlend), SoftwareBlendAlpha);
+	SoftwareReplayRasterizerState shadowState = { SoftwareCullNone, false, 0.001f };
+	replay.SetRasterizerState(recorder.GetObjectId(&objects.ShadowRasterizer), shadowState);
+}
+
+// What RecordFrame should come to, drawn straight onto the
+// rasterizer
+static void DrawDirect(SoftwareRasterizer& rasterizer, SoftwareTarget& backBuffer, SoftwareTarget& shadowMap) {
+	SoftwareDrawState state = SoftwareDefaultState(0);
+	state.CullMode = SoftwareCullNone;
+	state.DepthClip = false;
+	state.DepthBias = 0.001f;
+	state.ColorWrite = false;
+	shadowMap.ClearDepth(1.0f);
+	rasterizer.SetTarget(&shadowMap);
+	for (int quad = 1; quad < 3; quad++)
+		rasterizer.DrawIndexed(state, sceneVertices + quad * 4, sizeof(SceneVertex), 4, sceneIndices, 6, SceneVS, SoftwarePixelShader());
+
+	state = SoftwareDefaultState(4);
+	backBuffer.ClearColor(clearColor);
+	backBuffer.ClearDepth(1.0f);
+	rasterizer.SetTarget(&backBuffer);
+	for (int quad = 0; quad < 2; quad++)
+		rasterizer.DrawIndexed(state, sceneVertices + quad * 4, sizeof(SceneVertex), 4, sceneIndices, 6, SceneVS, ScenePS);
+	state.BlendMode = SoftwareBlendAlpha;
+	rasterizer.DrawIndexed(state, sceneVertices + 8, sizeof(SceneVertex), 4, sceneIndices, 6, SceneVS, ScenePS);
+}
+
+static void TestReplay() {
+	CommandRecorder recorder;
+	Objects objects;
+	RecordFrame(recorder, objects);
+
+	SoftwareRasterizer rasterizer(2);
+	SoftwareTarget backBuffer(96, 64), shadowMap(64, 64);
+	SoftwareReplay replay(rasterizer);
+	Register(replay, recorder, objects, backBuffer, shadowMap);
+	SoftwareReplayReport report = replay.Replay(recorder.GetData().data(), recorder.GetData().size());
+	CHECK(report.Valid && report.Frames == 1);
+	CHECK(report.Total.Draws == 5 && report.Total.Skipped == 0);
+	CHECK(report.Passes.size() == 2 && report.Passes[1].Name == "Scene" && report.Passes[1].PixelsShaded > 96 * 64);
+
+	SoftwareTarget expected(96, 64), expectedShadow(64, 64);
+	DrawDirect(rasterizer, expected, expectedShadow);
+	CHECK(backBuffer.CountDifferences(expected, 0) == 0);
+
+	// The shadow map's depth came out the same too
+	int depthDifferences = 0;
+	for (int y = 0; y < 64; y++)
+		for (int x = 0; x < 64; x++)
+			depthDifferences += *shadowMap.GetDepth(x, y) != *expectedShadow.GetDepth(x, y) ? 1 : 0;
+	CHECK(depthDifferences == 0);
+	CHECK(*shadowMap.GetDepth(32, 32) < 1.0f);
+
+	// Unregistered shaders, targets or buffers skip the draw
+	// rather than guessing
+	SoftwareReplay partial(rasterizer);
+	Register(partial, recorder, objects, backBuffer, shadowMap);
+	partial.SetView(recorder.GetObjectId(&objects.ShadowDepth), 0);
+	report = partial.Replay(recorder.GetData().data(), recorder.GetData().size());
+	CHECK(report.Total.Draws == 3 && report.Total.Skipped == 2);
+	CHECK(report.Passes.size() == 2 && report.Passes[0].Skipped == 2);
+
+	SoftwareReplay empty(rasterizer);
+	report = empty.Replay(recorder.GetData().data(), recorder.GetData().size());
+	CHECK(report.Total.Draws == 0 && report.Total.Skipped == 5);
+
+	// And after something else drew, until everything's rebound
+	CommandRecorder after;
+	after.Record(CommandBeginFrame);
+	after.Record(CommandInvalidateState);
+	after.Record(CommandDrawIndexed, 6, 0, 0);
+	after.Record(CommandEndFrame);
+	report = replay.Replay(after.GetData().data(), after.GetData().size());
+	CHECK(report.Total.Draws == 0 && report.Total.Skipped == 1);
+}
+
+// --------------------------------------------------------
+// Throughput
+// --------------------------------------------------------
+
+static void Benchmark() {
+	// Analyzing a long capture, 40 times the scene per frame
+	CommandRecorder recorder;
+	Objects objects;
+	for (int frame = 0; frame < 60 * 40; frame++)
+		RecordFrame(recorder, objects);
+	const std::vector<uint8_t>& data = recorder.GetData();
+
+	auto start = std::chrono::steady_clock::now();
+	CommandStreamReport report = AnalyzeCommandStream(data.data(), data.size());
+	double analyzeMilliseconds = ElapsedMilliseconds(start);
+	CHECK(report.Valid);
+	printf("Analyze: %zu KB, %lld commands, %lld draws in %.2f ms (%.0f MB/s)\n", data.size() >> 10, report.Commands,
+		report.Total.Draws, analyzeMilliseconds, data.size() / 1048576.0 / (analyzeMilliseconds / 1000.0));
+
+	// Replaying 60 frames of it at 720p
+	CommandRecorder frames;
+	for (int frame = 0; frame < 60; frame++)
+		RecordFrame(frames, objects);
+	SoftwareRasterizer rasterizer;
+	SoftwareTarget backBuffer(1280, 720), shadowMap(1024, 1024);
+	SoftwareReplay replay(rasterizer);
+	Register(replay, frames, objects, backBuffer, shadowMap);
+	start = std::chrono::steady_clock::now();
+	SoftwareReplayReport replayed = replay.Replay(frames.GetData().data(), frames.GetData().size());
+	double replayMilliseconds = ElapsedMilliseconds(start);
+	CHECK(replayed.Total.Draws == 60 * 5);
+	printf("Replay:  %lld draws in %.1f ms (%.2f ms/frame, %.1f M pixels/s on %d threads)\n", replayed.Total.Draws,
+		replayMilliseconds, replayMilliseconds / 60.0, replayed.Total.PixelsShaded / 1e3 / replayMilliseconds, rasterizer.GetThreadCount());
+}
+
+int main() {
+	TestAnalyzer();
+	TestDamagedStreams();
+	TestReplay();
+	Benchmark();
+	return TestResult("CommandStreamTest");
+}
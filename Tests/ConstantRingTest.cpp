@@ -0,0 +1,339 @@
+// Constant ring: slices are aligned and in bounds, wrapping
+// skips the end and gives it back with the frame that wrapped,
+// space only comes back once a frame's fence is retired, and
+// against a mock GPU that finishes frames late no slice ever
+// lands on one a frame in flight still holds.  Then a report
+// of the lit pass's constant uploads through a mock of
+// ConstantUploadHeap - bytes per frame split by how often
+// they change next to the old everything-per-entity upload,
+// and what the ring made of them.
+//
+//   g++ -std=c++14 -O2 -I.. ConstantRingTest.cpp ../ConstantRing.cpp -o ConstantRingTest && ./ConstantRingTest
+
+#include "TestCommon.h"
+#include "ConstantRing.h"
+#include <algorithm>
+#include <vector>
+
+static unsigned int seed = 1;
+
+static unsigned int RandomBits() {
+	seed = seed * 1664525 + 1013904223;
+	return seed >> 8;
+}
+
+static void TestAllocate() {
+	ConstantRing ring(4096);
+	CHECK(ring.GetSize() == 4096 && ring.GetUsed() == 0);
+
+	// Rounded up to 256, one after another
+	CHECK(ring.Allocate(64) == 0);
+	CHECK(ring.Allocate(256) == 256);
+	CHECK(ring.Allocate(257) == 512);
+	CHECK(ring.GetUsed() == 1024);
+	CHECK(ring.GetStats().Allocations == 3 && ring.GetStats().BytesAllocated == 1024);
+
+	// Nothing, or more than the whole ring, never fits
+	CHECK(ring.Allocate(0) == ConstantRing::Invalid);
+	CHECK(ring.Allocate(4097) == ConstantRing::Invalid);
+	CHECK(ring.GetStats().Failures == 2 && ring.GetUsed() == 1024);
+
+	// Other alignments
+	ConstantRing small(100, 4);
+	CHECK(small.Allocate(1) == 0 && small.Allocate(5) == 4 && small.Allocate(4) == 12);
+	CHECK(small.GetUsed() == 16);
+}
+
+static void TestFences() {
+	ConstantRing ring(1024);
+
+	// A frame with nothing in it holds nothing
+	ring.EndFrame(1);
+	CHECK(ring.GetOldestFence() == 0);
+
+	CHECK(ring.Allocate(256) == 0);
+	CHECK(ring.Allocate(256) == 256);
+	ring.EndFrame(2);
+	CHECK(ring.Allocate(512) == 512);
+	ring.EndFrame(3);
+	CHECK(ring.GetOldestFence() == 2 && ring.GetUsed() == 1024);
+
+	// Full until the GPU gets past a fence
+	CHECK(ring.Allocate(1) == ConstantRing::Invalid);
+	ring.Retire(1);
+	CHECK(ring.Allocate(1) == ConstantRing::Invalid && ring.GetUsed() == 1024);
+
+	// Frame 2 gone - its 512 bytes at the start come back
+	ring.Retire(2);
+	CHECK(ring.GetOldestFence() == 3 && ring.GetUsed() == 512);
+	CHECK(ring.Allocate(512) == 0);
+	CHECK(ring.Allocate(1) == ConstantRing::Invalid);
+
+	// Retiring further than anything in flight empties it
+	ring.EndFrame(4);
+	ring.Retire(10);
+	CHECK(ring.GetUsed() == 0 && ring.GetOldestFence() == 0);
+
+	// Empty starts over at the top, wherever the head was
+	CHECK(ring.Allocate(256) == 0);
+	CHECK(ring.GetStats().Wraps == 0);
+}
+
+static void TestWrap() {
+	ConstantRing ring(1024);
+	ring.Allocate(512);
+	ring.EndFrame(1);
+	ring.Allocate(256);
+	ring.EndFrame(2);
+	ring.Retire(1);
+
+	// 256 left at the end, 512 free at the start: a 512 byte
+	// slice skips the end and goes to the start
+	CHECK(ring.Allocate(512) == 0);
+	CHECK(ring.GetStats().Wraps == 1 && ring.GetStats().BytesSkipped == 256);
+	CHECK(ring.GetUsed() == 1024);
+	ring.EndFrame(3);
+
+	// The skipped end belongs to frame 3, so it only comes back
+	// with it
+	ring.Retire(2);
+	CHECK(ring.GetUsed() == 768);
+	CHECK(ring.Allocate(256) == 512);
+	CHECK(ring.Allocate(256) == ConstantRing::Invalid);
+	ring.EndFrame(4);
+	ring.Retire(3);
+	CHECK(ring.GetUsed() == 256);
+
+	// Not enough at the start either - fails without skipping.
+	// 256 free at the end, 256 at the start, 512 asked for.
+	ConstantRing tight(1024);
+	tight.Allocate(256);
+	tight.EndFrame(1);
+	tight.Allocate(512);
+	tight.EndFrame(2);
+	tight.Retire(1);
+	CHECK(tight.Allocate(512) == ConstantRing::Invalid);
+	CHECK(tight.GetStats().Wraps == 0 && tight.GetStats().BytesSkipped == 0 && tight.GetUsed() == 512);
+	CHECK(tight.Allocate(256) == 768);
+}
+
+// --------------------------------------------------------
+// Mock GPU - a frame finishes some frames after it's ended,
+// or straight away when the CPU waits for it
+// --------------------------------------------------------
+
+struct Slice {
+	uint32_t Offset;
+	uint32_t Bytes;
+};
+
+static bool Overlaps(const Slice& a, const Slice& b) {
+	return a.Offset < b.Offset + b.Bytes && b.Offset < a.Offset + a.Bytes;
+}
+
+static void TestAgainstGpu() {
+	const uint32_t sizes[] = { 4096, 65536, 1000 * 256 };
+	for (uint32_t size : sizes) {
+		ConstantRing ring(size);
+		std::vector<std::vector<Slice>> inFlight;	// inFlight[f] for fence f + 1
+		std::vector<Slice> current;
+		uint64_t completed = 0;
+		int overlaps = 0, outOfBounds = 0, misaligned = 0, stalls = 0;
+
+		for (uint64_t frame = 1; frame <= 300; frame++) {
+			int latency = 1 + RandomBits() % 3;
+			if (frame > (uint64_t)latency)
+				completed = std::max(completed, frame - latency);
+			ring.Retire(completed);
+
+			int allocations = RandomBits() % 40;
+			for (int a = 0; a < allocations; a++) {
+				uint32_t bytes = 1 + RandomBits() % (RandomBits() % 8 == 0 ? size / 3 : 600);
+				// No more frames than the latency can be in flight,
+				// so a few waits always make room
+				uint32_t offset = ring.Allocate(bytes);
+				for (int wait = 0; wait < 8 && offset == ConstantRing::Invalid && ring.GetOldestFence() != 0; wait++) {
+					completed = ring.GetOldestFence();
+					ring.Retire(completed);
+					stalls++;
+					offset = ring.Allocate(bytes);
+				}
+				if (offset == ConstantRing::Invalid) {
+					// Only this frame left holding space, and the free
+					// space either side of it too small
+					uint32_t aligned = (bytes + 255) & ~255u;
+					CHECK(ring.GetUsed() + 2 * aligned > size);
+					continue;
+				}
+
+				Slice slice = { offset, bytes };
+				outOfBounds += offset + bytes > size ? 1 : 0;
+				misaligned += offset % 256 != 0 ? 1 : 0;
+				for (uint64_t f = completed; f < inFlight.size(); f++)
+					for (const Slice& other : inFlight[f])
+						overlaps += Overlaps(slice, other) ? 1 : 0;
+				for (const Slice& other : current)
+					overlaps += Overlaps(slice, other) ? 1 : 0;
+				current.push_back(slice);
+			}
+
+			ring.EndFrame(frame);
+			inFlight.push_back(current);
+			current.clear();
+		}
+
+		CHECK(overlaps == 0 && outOfBounds == 0 && misaligned == 0);
+		CHECK(ring.GetStats().Wraps > 0 && stalls > 0);
+
+		// Once the GPU catches up it's all free again
+		ring.Retire(~0ull);
+		CHECK(ring.GetUsed() == 0);
+		CHECK(ring.Allocate(size) == 0);
+	}
+}
+
+// --------------------------------------------------------
+// Upload report
+// --------------------------------------------------------
+
+// Constant buffer sizes as the shaders declare them, packed
+// into 16 byte registers
+static const int VertexPerFrame = 128;		// view, projection
+static const int VertexPerObject = 64;		// world
+static const int PixelPerFrame = 560;		// Lights, cascades, cluster grid
+static const int PixelPerMaterial = 16;		// specularPower, materialLayer
+static const int PixelPerObject = 16;		// alphaV
+
+// Before the split every entity uploaded the vertex shader's
+// world, view, projection, shadowView and shadowProj and all
+// of the pixel shader's lights
+static const int OldPerEntity = 5 * 64 + 272;
+
+// ConstantUploadHeap without D3D: Poll and the stalls the
+// same, the GPU finishing frames a set number of frames late
+class MockUploadHeap {
+public:
+	MockUploadHeap(uint32_t size, int gpuLatency) : ring(size) {
+		latency = gpuLatency;
+		frame = 1;
+		completed = 0;
+		stalls = 0;
+		fallbackBytes = 0;
+	}
+
+	void BeginFrame() {
+		Poll(frame - 1, false);
+		ring.Retire(completed);
+	}
+
+	void EndFrame() {
+		if (frame > MaxFramesInFlight)
+			Poll(frame - MaxFramesInFlight, true);
+		ring.EndFrame(frame);
+		frame++;
+	}
+
+	void Upload(uint32_t bytes) {
+		uint32_t offset = ring.Allocate(bytes);
+		while (offset == ConstantRing::Invalid) {
+			uint64_t oldest = ring.GetOldestFence();
+			if (oldest == 0 || !Poll(oldest, true)) {
+				fallbackBytes += bytes;
+				return;
+			}
+			stalls++;
+			ring.Retire(completed);
+			offset = ring.Allocate(bytes);
+		}
+	}
+
+	const ConstantRingStats& GetRingStats() const { return ring.GetStats(); }
+	int GetStalls() const { return stalls; }
+	long long GetFallbackBytes() const { return fallbackBytes; }
+
+private:
+	static const int MaxFramesInFlight = 4;
+
+	ConstantRing ring;
+	int latency;
+	uint64_t frame;
+	uint64_t completed;
+	int stalls;
+	long long fallbackBytes;
+
+	bool Poll(uint64_t fence, bool wait) {
+		uint64_t done = frame > (uint64_t)latency ? frame - latency : 0;
+		completed = std::max(completed, std::min(fence, done));
+		if (wait)
+			completed = std::max(completed, fence);
+		return completed >= fence;
+	}
+};
+
+struct Scene {
+	const char* Name;
+	int Objects;
+	int Materials;
+};
+
+static void Report() {
+	// The game draws the ball and five platforms over five
+	// materials; the others are what a busier level could be
+	const Scene scenes[] = {
+		{ "Game (6 objects)", 6, 5 },
+		{ "500 objects", 500, 20 },
+		{ "2000 objects", 2000, 50 },
+	};
+	const int frames = 600;
+
+	for (const Scene& scene : scenes) {
+		MockUploadHeap heap(1024 * 1024, 2);
+		long long frameBytes = 0, materialBytes = 0, objectBytes = 0;
+
+		auto start = std::chrono::steady_clock::now();
+		for (int f = 0; f < frames; f++) {
+			heap.BeginFrame();
+			frameBytes += VertexPerFrame + PixelPerFrame;
+
+			// Sorted by material, so each one is set once
+			int lastMaterial = -1;
+			for (int o = 0; o < scene.Objects; o++) {
+				int material = o * scene.Materials / scene.Objects;
+				if (material != lastMaterial) {
+					materialBytes += PixelPerMaterial;
+					lastMaterial = material;
+				}
+				heap.Upload(VertexPerObject);
+				heap.Upload(PixelPerObject);
+				objectBytes += VertexPerObject + PixelPerObject;
+			}
+			heap.EndFrame();
+		}
+		double milliseconds = ElapsedMilliseconds(start);
+
+		const ConstantRingStats& ring = heap.GetRingStats();
+		CHECK(ring.Allocations == frames * scene.Objects * 2 && heap.GetFallbackBytes() == 0);
+
+		double total = (frameBytes + materialBytes + objectBytes) / (double)frames;
+		double old = (double)OldPerEntity * scene.Objects;
+		printf("%s: %.0f bytes/frame (%.0f per frame, %.0f per material, %.0f per object), was %.0f (%.1fx less)\n",
+			scene.Name, total, frameBytes / (double)frames, materialBytes / (double)frames, objectBytes / (double)frames,
+			old, old / total);
+		printf("  ring: %.0f bytes/frame with alignment, %d wraps, %lld skipped, %d stalls, %.3f us/frame allocating\n",
+			ring.BytesAllocated / (double)frames, ring.Wraps, ring.BytesSkipped, heap.GetStalls(),
+			milliseconds * 1000.0 / frames);
+	}
+}
+
+int main() {
+	TestAllocate();
+	TestFences();
+	TestWrap();
+	TestAgainstGpu();
+
+	// The mock heap waits until the ring makes room, as the
+	// real one does
+	if (testFailures == 0)
+		Report();
+	return TestResult("ConstantRingTest");
+}
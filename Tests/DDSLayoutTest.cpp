@@ -0,0 +1,192 @@
+// DDS layout parser: known good headers, then truncated and
+// mutated ones, which must be refused or laid out inside the
+// buffer.  Worth building with the sanitizers too:
+//
+//   g++ -std=c++14 -O2 -I.. DDSLayoutTest.cpp ../DDSLayout.cpp -o DDSLayoutTest && ./DDSLayoutTest
+//   g++ -std=c++14 -g -fsanitize=address,undefined -I.. DDSLayoutTest.cpp ../DDSLayout.cpp -o DDSLayoutTest && ./DDSLayoutTest
+
+#include "TestCommon.h"
+#include "DDSLayout.h"
+#include <string.h>
+
+static const uint32_t FormatBC1 = 71;
+static const uint32_t FormatBC3 = 77;
+static const uint32_t FormatRGBA8 = 28;
+
+static void Put32(std::vector<uint8_t>& file, size_t offset, uint32_t value) {
+	for (int i = 0; i < 4; i++)
+		file[offset + i] = (uint8_t)(value >> (i * 8));
+}
+
+// Header only, payload sized by the caller
+static std::vector<uint8_t> MakeHeader(uint32_t width, uint32_t height, uint32_t mips, const char* fourCC) {
+	std::vector<uint8_t> file(4 + 124, 0);
+	memcpy(&file[0], "DDS ", 4);
+	Put32(file, 4, 124);
+	Put32(file, 4 + 8, height);
+	Put32(file, 4 + 12, width);
+	Put32(file, 4 + 24, mips);
+	Put32(file, 4 + 72, 32);
+	Put32(file, 4 + 76, 0x4);
+	memcpy(&file[4 + 80], fourCC, 4);
+	return file;
+}
+
+static std::vector<uint8_t> MakeBC1(uint32_t width, uint32_t height, uint32_t mips) {
+	std::vector<uint8_t> file = MakeHeader(width, height, mips, "DXT1");
+	size_t bytes = 0;
+	for (uint32_t mip = 0; mip < mips; mip++) {
+		uint32_t w = width >> mip ? width >> mip : 1;
+		uint32_t h = height >> mip ? height >> mip : 1;
+		bytes += ((w + 3) / 4) * ((h + 3) / 4) * 8;
+	}
+	file.resize(file.size() + bytes, 0x5A);
+	return file;
+}
+
+static std::vector<uint8_t> MakeDX10Array(uint32_t width, uint32_t height, uint32_t arraySize, bool cube) {
+	std::vector<uint8_t> file = MakeHeader(width, height, 1, "DX10");
+	file.resize(file.size() + 20, 0);
+	Put32(file, 128, FormatRGBA8);
+	Put32(file, 132, 3);
+	Put32(file, 136, cube ? 0x4 : 0);
+	Put32(file, 140, arraySize);
+	file.resize(file.size() + (size_t)width * height * 4 * arraySize * (cube ? 6 : 1), 0x33);
+	return file;
+}
+
+// Whatever parsed must lie inside the buffer it came from
+static bool LayoutInBounds(const DDSLayout& layout, size_t size) {
+	for (size_t i = 0; i < layout.Subresources.size(); i++) {
+		const DDSSubresource& sub = layout.Subresources[i];
+		if (sub.Offset > size || sub.Size > size - sub.Offset)
+			return false;
+		if ((size_t)sub.SlicePitch != sub.Size)
+			return false;
+	}
+	return layout.Subresources.size() == (size_t)layout.ArraySize * layout.MipCount;
+}
+
+static void TestKnownFiles() {
+	DDSLayout layout;
+
+	std::vector<uint8_t> bc1 = MakeBC1(256, 128, 9);
+	CHECK(ParseDDSLayout(bc1.data(), bc1.size(), layout));
+	CHECK(layout.Format == FormatBC1 && layout.MipCount == 9 && layout.ArraySize == 1 && !layout.IsCubeMap);
+	CHECK(layout.Subresources[0].Offset == 128);
+	CHECK(layout.Subresources[0].RowPitch == 64 * 8);
+	CHECK(layout.Subresources[8].Width == 1 && layout.Subresources[8].Height == 1);
+	CHECK(layout.Subresources[8].Size == 8);		// A 1x1 BC mip is still a whole block
+	CHECK(LayoutInBounds(layout, bc1.size()));
+
+	// Odd sizes round up to whole blocks
+	std::vector<uint8_t> odd = MakeBC1(5, 3, 1);
+	CHECK(ParseDDSLayout(odd.data(), odd.size(), layout));
+	CHECK(layout.Subresources[0].Size == 2 * 8);
+
+	std::vector<uint8_t> dxt5 = MakeHeader(4, 4, 1, "DXT5");
+	dxt5.resize(dxt5.size() + 16);
+	CHECK(ParseDDSLayout(dxt5.data(), dxt5.size(), layout));
+	CHECK(layout.Format == FormatBC3);
+
+	std::vector<uint8_t> array = MakeDX10Array(8, 8, 3, false);
+	CHECK(ParseDDSLayout(array.data(), array.size(), layout));
+	CHECK(layout.Format == FormatRGBA8 && layout.ArraySize == 3);
+	CHECK(layout.Subresources[1].Offset == 148 + 8 * 8 * 4);
+
+	std::vector<uint8_t> cube = MakeDX10Array(4, 4, 1, true);
+	CHECK(ParseDDSLayout(cube.data(), cube.size(), layout));
+	CHECK(layout.IsCubeMap && layout.ArraySize == 6);
+
+	// Legacy cube maps need all six faces
+	std::vector<uint8_t> partial = MakeBC1(4, 4, 1);
+	partial.resize(partial.size() + 5 * 8);
+	Put32(partial, 4 + 108, 0x200 | 0x400);
+	CHECK(!ParseDDSLayout(partial.data(), partial.size(), layout));
+	Put32(partial, 4 + 108, 0x200 | 0xFC00);
+	CHECK(ParseDDSLayout(partial.data(), partial.size(), layout));
+	CHECK(layout.IsCubeMap && layout.ArraySize == 6);
+
+	// Refused outright
+	std::vector<uint8_t> file = MakeBC1(64, 64, 1);
+	Put32(file, 4 + 108, 0x200000);	// Volume
+	CHECK(!ParseDDSLayout(file.data(), file.size(), layout));
+	file = MakeBC1(64, 64, 8);		// More mips than 64 has
+	CHECK(!ParseDDSLayout(file.data(), file.size(), layout));
+	file = MakeHeader(64, 64, 1, "XYZW");
+	file.resize(file.size() + 64 * 64);
+	CHECK(!ParseDDSLayout(file.data(), file.size(), layout));
+	file = MakeBC1(32768, 4, 1);
+	CHECK(!ParseDDSLayout(file.data(), file.size(), layout));
+	CHECK(!ParseDDSLayout(0, 0, layout));
+}
+
+// Every length short of the whole file
+static void TestTruncation() {
+	std::vector<uint8_t> files[] = { MakeBC1(64, 32, 7), MakeDX10Array(8, 8, 2, false), MakeDX10Array(4, 4, 1, true) };
+	for (int f = 0; f < 3; f++) {
+		DDSLayout layout;
+		for (size_t size = 0; size < files[f].size(); size++) {
+			std::vector<uint8_t> truncated(files[f].begin(), files[f].begin() + size);
+			CHECK(!ParseDDSLayout(truncated.data(), truncated.size(), layout));
+		}
+		CHECK(ParseDDSLayout(files[f].data(), files[f].size(), layout));
+	}
+}
+
+static uint32_t fuzzState = 0x12345678;
+
+static uint32_t NextRandom() {
+	fuzzState ^= fuzzState << 13;
+	fuzzState ^= fuzzState >> 17;
+	fuzzState ^= fuzzState << 5;
+	return fuzzState;
+}
+
+// Random bytes and words written over the headers, which is
+// where the sizes and counts that could overflow live
+static int Fuzz(int iterations, int& accepted) {
+	std::vector<uint8_t> seeds[] = { MakeBC1(64, 32, 7), MakeDX10Array(8, 8, 2, false), MakeDX10Array(4, 4, 1, true) };
+	const uint32_t interesting[] = { 0, 1, 3, 4, 6, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF, 16384, 16385, 2048, 2049, 15, 16 };
+
+	int failures = 0;
+	accepted = 0;
+	for (int i = 0; i < iterations; i++) {
+		std::vector<uint8_t> file = seeds[i % 3];
+		int mutations = 1 + NextRandom() % 4;
+		for (int m = 0; m < mutations; m++) {
+			size_t at = NextRandom() % 148;
+			if (at + 4 > file.size())
+				continue;
+			if (NextRandom() & 1)
+				file[at] = (uint8_t)NextRandom();
+			else
+				Put32(file, at & ~3, interesting[NextRandom() % (sizeof(interesting) / sizeof(interesting[0]))]);
+		}
+		if (NextRandom() % 4 == 0)
+			file.resize(NextRandom() % (file.size() + 1));
+
+		DDSLayout layout;
+		if (ParseDDSLayout(file.data(), file.size(), layout)) {
+			accepted++;
+			if (!LayoutInBounds(layout, file.size()))
+				failures++;
+		}
+	}
+	return failures;
+}
+
+int main() {
+	TestKnownFiles();
+	TestTruncation();
+
+	const int iterations = 200000;
+	int accepted;
+	auto start = std::chrono::steady_clock::now();
+	CHECK(Fuzz(iterations, accepted) == 0);
+	double milliseconds = ElapsedMilliseconds(start);
+	CHECK(accepted > 0);
+
+	printf("fuzz: %d inputs, %d accepted, %.0f ms\n", iterations, accepted, milliseconds);
+	return TestResult("DDSLayoutTest");
+}
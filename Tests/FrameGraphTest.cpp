@@ -0,0 +1,316 @@
+// Frame graph: culling, clears, and an aliasing simulator - every
+// physical target remembers which texture was last written into
+// it, and each pass checks the textures it reads are still there.
+// Run over the game's own graph and thousands of random ones.
+//
+//   g++ -std=c++14 -O2 -I.. FrameGraphTest.cpp ../FrameGraph.cpp -o FrameGraphTest && ./FrameGraphTest
+
+#include "TestCommon.h"
+#include "FrameGraph.h"
+#include <algorithm>
+
+static const uint32_t FormatRGBA8 = 28;
+static const uint32_t FormatD24S8 = 45;
+static const uint32_t BindDepthStencil = 0x40;
+
+struct Simulation {
+	std::vector<int> Contents;		// Texture last written into each physical target
+	int Reads;
+	int Corrupted;					// Reads that found another texture's contents
+	int Clears;
+	std::vector<int> Order;			// Passes as they ran
+};
+
+// Each pass records what it does into the simulation when it runs.
+// A write that doesn't replace the whole texture reads it too.
+struct SimPass {
+	std::vector<FrameGraphResource> Reads;
+	std::vector<std::pair<FrameGraphResource, unsigned int>> Writes;
+};
+
+static int AddSimPass(FrameGraph& graph, Simulation& sim, std::vector<SimPass>& declared, const SimPass& pass) {
+	int index = (int)declared.size();
+	declared.push_back(pass);
+	int id = graph.AddPass("pass", [&graph, &sim, &declared, index]() {
+		sim.Order.push_back(index);
+		const SimPass& p = declared[index];
+		for (FrameGraphResource r : p.Reads) {
+			int physical = graph.GetPhysicalIndex(r);
+			if (physical < 0)
+				continue;
+			sim.Reads++;
+			if (sim.Contents[physical] != r)
+				sim.Corrupted++;
+		}
+		for (auto& w : p.Writes) {
+			int physical = graph.GetPhysicalIndex(w.first);
+			if (physical >= 0)
+				sim.Contents[physical] = w.first;
+		}
+	});
+	for (FrameGraphResource r : pass.Reads)
+		graph.Read(id, r);
+	for (auto& w : pass.Writes)
+		graph.Write(id, w.first, w.second);
+	return id;
+}
+
+static void Run(FrameGraph& graph, Simulation& sim) {
+	sim.Contents.assign(graph.GetPhysicalTextures().size(), -1);
+	sim.Reads = 0;
+	sim.Corrupted = 0;
+	sim.Clears = 0;
+	sim.Order.clear();
+	graph.Execute([&graph, &sim](FrameGraphResource r, const float*) {
+		// A clear is a write of the whole texture
+		int physical = graph.GetPhysicalIndex(r);
+		if (physical >= 0)
+			sim.Contents[physical] = r;
+		sim.Clears++;
+	});
+}
+
+// Declares the same passes as Game::BuildFrameGraph, plus one
+// whose output nothing reads
+static void BuildGameGraph(FrameGraph& graph, Simulation& sim, std::vector<SimPass>& declared, unsigned int width, unsigned int height, int levels, bool upscale) {
+	graph.Reset();
+	declared.clear();
+	declared.reserve(64);
+	const unsigned int replace = FrameGraphWriteFullscreen;
+
+	FrameGraphResource shadowMap = graph.ImportTexture("ShadowMap");
+	FrameGraphResource backBuffer = graph.ImportTexture("BackBuffer");
+	graph.MarkOutput(backBuffer);
+
+	FrameGraphTextureDesc sceneDesc = { width, height, FormatRGBA8, 0 };
+	FrameGraphTextureDesc depthDesc = { width, height, FormatD24S8, BindDepthStencil };
+	FrameGraphResource sceneColor = graph.CreateTexture("SceneColor", sceneDesc);
+	FrameGraphResource sceneDepth = graph.CreateTexture("SceneDepth", depthDesc);
+
+	std::vector<FrameGraphResource> bloom, blurred;
+	for (int i = 0; i < levels; i++) {
+		FrameGraphTextureDesc desc = { (width / 2) >> i, (height / 2) >> i, FormatRGBA8, 0 };
+		bloom.push_back(graph.CreateTexture("Bloom", desc));
+		blurred.push_back(graph.CreateTexture("BloomBlurX", desc));
+	}
+	FrameGraphResource composite = sceneColor;
+	if (upscale) {
+		FrameGraphTextureDesc fullDesc = { width * 2, height * 2, FormatRGBA8, 0 };
+		composite = graph.CreateTexture("Upscaled", fullDesc);
+	}
+
+	SimPass pass;
+	pass = SimPass(); pass.Writes = { { shadowMap, 0 } };
+	AddSimPass(graph, sim, declared, pass);
+	pass = SimPass(); pass.Reads = { shadowMap }; pass.Writes = { { sceneColor, FrameGraphWriteClear }, { sceneDepth, FrameGraphWriteClear } };
+	AddSimPass(graph, sim, declared, pass);
+	pass = SimPass(); pass.Reads = { sceneColor }; pass.Writes = { { bloom[0], replace } };
+	AddSimPass(graph, sim, declared, pass);
+	for (int i = 1; i < levels; i++) {
+		pass = SimPass(); pass.Reads = { bloom[i - 1] }; pass.Writes = { { bloom[i], replace } };
+		AddSimPass(graph, sim, declared, pass);
+	}
+	for (int i = 0; i < levels; i++) {
+		pass = SimPass(); pass.Reads = { bloom[i] }; pass.Writes = { { blurred[i], replace } };
+		AddSimPass(graph, sim, declared, pass);
+		pass = SimPass(); pass.Reads = { blurred[i] }; pass.Writes = { { bloom[i], replace } };
+		AddSimPass(graph, sim, declared, pass);
+	}
+	for (int i = levels - 2; i >= 0; i--) {
+		// Added on top, so the level is read as well as written
+		pass = SimPass(); pass.Reads = { bloom[i + 1], bloom[i] }; pass.Writes = { { bloom[i], 0 } };
+		AddSimPass(graph, sim, declared, pass);
+	}
+	if (upscale) {
+		pass = SimPass(); pass.Reads = { sceneColor }; pass.Writes = { { composite, replace } };
+		AddSimPass(graph, sim, declared, pass);
+	}
+	pass = SimPass(); pass.Reads = { composite, bloom[0] }; pass.Writes = { { backBuffer, FrameGraphWriteClear | replace } };
+	AddSimPass(graph, sim, declared, pass);
+	pass = SimPass(); pass.Writes = { { backBuffer, 0 } };
+	AddSimPass(graph, sim, declared, pass);
+
+	// Something nothing reads, which should be culled
+	FrameGraphTextureDesc debugDesc = { width, height, FormatRGBA8, 0 };
+	FrameGraphResource debug = graph.CreateTexture("Debug", debugDesc);
+	pass = SimPass(); pass.Reads = { sceneDepth }; pass.Writes = { { debug, FrameGraphWriteClear } };
+	AddSimPass(graph, sim, declared, pass);
+}
+
+static void TestGameGraph() {
+	FrameGraph graph;
+	Simulation sim;
+	std::vector<SimPass> declared;
+
+	BuildGameGraph(graph, sim, declared, 1280, 720, 5, false);
+	CHECK(graph.Compile());
+	Run(graph, sim);
+	CHECK(sim.Corrupted == 0);
+	CHECK(graph.GetCulledPassCount() == 1);
+	CHECK(graph.IsPassCulled(graph.GetPassCount() - 1));
+	CHECK(graph.GetClearsRemoved() == 2);	// The fullscreen composite, and the culled pass
+	CHECK(sim.Clears == 2);
+
+	// Every level is alive until the upsamples, and each blur
+	// scratch texture is the only one its size that's free -
+	// so the game's graph has nothing to alias
+	int physical = (int)graph.GetPhysicalTextures().size();
+	CHECK(physical == graph.GetTransientCount());
+	CHECK(graph.GetPhysicalIndex(graph.GetResourceCount() - 1) == -1);
+	printf("game graph: %d passes (%d culled), %d transient textures in %d targets\n",
+		graph.GetPassCount(), graph.GetCulledPassCount(), graph.GetTransientCount(), physical);
+
+	// The scaled down version has an extra full size texture
+	BuildGameGraph(graph, sim, declared, 640, 360, 5, true);
+	CHECK(graph.Compile());
+	Run(graph, sim);
+	CHECK(sim.Corrupted == 0);
+}
+
+// Passes in declaration order, output or not
+static void TestOrderAndCulling() {
+	FrameGraph graph;
+	FrameGraphTextureDesc desc = { 64, 64, FormatRGBA8, 0 };
+	FrameGraphResource out = graph.ImportTexture("Out");
+	graph.MarkOutput(out);
+	FrameGraphResource a = graph.CreateTexture("A", desc);
+	FrameGraphResource b = graph.CreateTexture("B", desc);
+
+	std::vector<int> ran;
+	int first = graph.AddPass("WriteA", [&]() { ran.push_back(0); });
+	graph.Write(first, a, FrameGraphWriteFullscreen);
+	int overwritten = graph.AddPass("WriteAAgain", [&]() { ran.push_back(1); });
+	graph.Write(overwritten, a, FrameGraphWriteFullscreen);
+	int unused = graph.AddPass("WriteB", [&]() { ran.push_back(2); });
+	graph.Write(unused, b, FrameGraphWriteFullscreen);
+	int last = graph.AddPass("Final", [&]() { ran.push_back(3); });
+	graph.Read(last, a);
+	graph.Write(last, out);
+
+	CHECK(graph.Compile());
+	CHECK(graph.IsPassCulled(first));		// Whatever it wrote is replaced before anyone reads it
+	CHECK(!graph.IsPassCulled(overwritten));
+	CHECK(graph.IsPassCulled(unused));
+	CHECK(graph.GetPhysicalIndex(b) == -1);
+	CHECK(graph.GetPhysicalIndex(out) == -1);
+	graph.Execute([](FrameGraphResource, const float*) {});
+	CHECK(ran.size() == 2 && ran[0] == 1 && ran[1] == 3);
+
+	// Out of range handles don't compile
+	int bad = graph.AddPass("Bad", nullptr);
+	graph.Read(bad, 99);
+	CHECK(!graph.Compile());
+}
+
+static uint32_t seed = 99;
+
+static uint32_t Random(uint32_t range) {
+	seed = seed * 1664525 + 1013904223;
+	return (seed >> 8) % range;
+}
+
+// Random chains: each pass reads textures already written and
+// writes new ones or updates old ones.  The last pass reads a few
+// and writes the output.
+static int RandomGraphs(int count, double& aliasedFraction) {
+	int corrupted = 0;
+	int transient = 0, physical = 0;
+	const FrameGraphTextureDesc descs[] = {
+		{ 256, 256, FormatRGBA8, 0 }, { 128, 128, FormatRGBA8, 0 }, { 256, 256, FormatD24S8, BindDepthStencil } };
+
+	for (int g = 0; g < count; g++) {
+		FrameGraph graph;
+		Simulation sim;
+		std::vector<SimPass> declared;
+		declared.reserve(64);
+
+		FrameGraphResource out = graph.ImportTexture("Out");
+		graph.MarkOutput(out);
+		int textureCount = 4 + Random(12);
+		std::vector<FrameGraphResource> textures;
+		for (int i = 0; i < textureCount; i++)
+			textures.push_back(graph.CreateTexture("T", descs[Random(3)]));
+
+		std::vector<FrameGraphResource> written;
+		int passCount = 3 + Random(20);
+		for (int p = 0; p < passCount; p++) {
+			SimPass pass;
+			for (uint32_t r = Random(3); r > 0 && !written.empty(); r--)
+				pass.Reads.push_back(written[Random((uint32_t)written.size())]);
+
+			FrameGraphResource target = textures[Random((uint32_t)textureCount)];
+			bool seen = std::find(written.begin(), written.end(), target) != written.end();
+			unsigned int flags = Random(2) ? FrameGraphWriteFullscreen : FrameGraphWriteClear;
+			if (seen && Random(3) == 0) {
+				// Blend on top of what's there
+				flags = 0;
+				pass.Reads.push_back(target);
+			}
+			pass.Writes.push_back(std::make_pair(target, flags));
+			if (!seen)
+				written.push_back(target);
+			AddSimPass(graph, sim, declared, pass);
+		}
+
+		SimPass final;
+		for (uint32_t r = 1 + Random(3); r > 0 && !written.empty(); r--)
+			final.Reads.push_back(written[Random((uint32_t)written.size())]);
+		final.Writes.push_back(std::make_pair(out, 0u));
+		AddSimPass(graph, sim, declared, final);
+
+		if (!graph.Compile()) {
+			corrupted++;
+			continue;
+		}
+		Run(graph, sim);
+		corrupted += sim.Corrupted;
+		transient += graph.GetTransientCount();
+		physical += (int)graph.GetPhysicalTextures().size();
+
+		// Every surviving pass reaches the output: something it wrote
+		// is read by a later surviving pass, or it's the output
+		for (int p = 0; p < graph.GetPassCount(); p++) {
+			if (graph.IsPassCulled(p))
+				continue;
+			bool used = false;
+			for (auto& w : declared[p].Writes) {
+				if (w.first == out)
+					used = true;
+				for (int later = p + 1; later < graph.GetPassCount() && !used; later++) {
+					if (graph.IsPassCulled(later))
+						continue;
+					const std::vector<FrameGraphResource>& reads = declared[later].Reads;
+					used = std::find(reads.begin(), reads.end(), w.first) != reads.end();
+				}
+			}
+			if (!used)
+				corrupted++;
+		}
+	}
+	aliasedFraction = transient > 0 ? 1.0 - (double)physical / transient : 0;
+	return corrupted;
+}
+
+int main() {
+	TestGameGraph();
+	TestOrderAndCulling();
+
+	double aliased;
+	auto start = std::chrono::steady_clock::now();
+	CHECK(RandomGraphs(5000, aliased) == 0);
+	double milliseconds = ElapsedMilliseconds(start);
+	printf("5000 random graphs: %.0f%% of transient textures aliased, %.3f ms per build, compile and run\n",
+		aliased * 100, milliseconds / 5000);
+
+	// Compile cost alone for the game's graph
+	FrameGraph graph;
+	Simulation sim;
+	std::vector<SimPass> declared;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < 1000; i++) {
+		BuildGameGraph(graph, sim, declared, 1280, 720, 5, false);
+		graph.Compile();
+	}
+	printf("game graph: %.1f us per build and compile\n", ElapsedMilliseconds(start));
+	return TestResult("FrameGraphTest");
+}
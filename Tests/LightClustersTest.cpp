@@ -0,0 +1,311 @@
+// Light clusters: each cluster's list has every light whose
+// sphere reaches into it (points sampled through the sphere)
+// and none whose sphere misses the cluster's box (every light
+// against every box by brute force), slices match GetSlice and
+// the packed ranges are consistent - with light counts that do
+// and don't fill the SSE groups of four.  Then build time for
+// 1000 lights on Game's grid, on one thread and on the pool,
+// next to the brute force.
+//
+//   g++ -std=c++14 -O2 -pthread -I.. LightClustersTest.cpp ../LightClusters.cpp -o LightClustersTest && ./LightClustersTest
+
+#include "TestCommon.h"
+#include "LightClusters.h"
+#include <algorithm>
+#include <math.h>
+#include <thread>
+
+static unsigned int seed = 1;
+
+static float RandomFloat(float low, float high) {
+	seed = seed * 1664525 + 1013904223;
+	return low + (high - low) * (seed >> 8) * (1.0f / 16777216.0f);
+}
+
+// Game::CreateLightClusters, with Camera's clip planes
+static LightClusterSettings GameSettings() {
+	LightClusterSettings settings = {};
+	settings.TilesX = 16;
+	settings.TilesY = 9;
+	settings.Slices = 24;
+	settings.Near = 0.1f;
+	settings.Far = 100.0f;
+	return settings;
+}
+
+// A left handed look-to view and XMMatrixPerspectiveFovLH,
+// stored transposed like Camera does
+struct CameraMatrices {
+	float View[16];
+	float Projection[16];
+};
+
+static CameraMatrices MakeCamera(const float eye[3], float yaw, float pitch, float fov, float aspect, const LightClusterSettings& settings) {
+	float forward[3] = { sinf(yaw) * cosf(pitch), sinf(pitch), cosf(yaw) * cosf(pitch) };
+	float right[3] = { cosf(yaw), 0.0f, -sinf(yaw) };
+	float up[3] = {
+		forward[1] * right[2] - forward[2] * right[1],
+		forward[2] * right[0] - forward[0] * right[2],
+		forward[0] * right[1] - forward[1] * right[0] };
+	const float* axes[3] = { right, up, forward };
+
+	CameraMatrices camera = {};
+	for (int row = 0; row < 3; row++) {
+		for (int k = 0; k < 3; k++)
+			camera.View[row * 4 + k] = axes[row][k];
+		camera.View[row * 4 + 3] = -(axes[row][0] * eye[0] + axes[row][1] * eye[1] + axes[row][2] * eye[2]);
+	}
+	camera.View[15] = 1.0f;
+
+	float scaleY = 1.0f / tanf(fov * 0.5f);
+	camera.Projection[0] = scaleY / aspect;
+	camera.Projection[5] = scaleY;
+	camera.Projection[10] = settings.Far / (settings.Far - settings.Near);
+	camera.Projection[11] = -settings.Near * settings.Far / (settings.Far - settings.Near);
+	camera.Projection[14] = 1.0f;
+	return camera;
+}
+
+// Lights around the camera, most of them in front of it, some
+// behind, past the far plane or straddling the near one
+static std::vector<ClusterLight> MakeLights(int count, const float eye[3], float minRange, float maxRange) {
+	std::vector<ClusterLight> lights(count);
+	for (ClusterLight& light : lights) {
+		light = {};
+		float spread = RandomFloat(0.0f, 1.0f) < 0.1f ? 120.0f : 40.0f;
+		light.Position[0] = eye[0] + RandomFloat(-spread, spread);
+		light.Position[1] = eye[1] + RandomFloat(-spread, spread) * 0.3f;
+		light.Position[2] = eye[2] + RandomFloat(-spread * 0.2f, spread);
+		light.Range = RandomFloat(minRange, maxRange);
+		light.Color[0] = light.Color[1] = light.Color[2] = 1.0f;
+		light.SpotCosine = -1.0f;
+	}
+	return lights;
+}
+
+// Every light against every cluster box, boxes worked out
+// from scratch
+static std::vector<std::vector<uint32_t>> BruteForce(const LightClusterSettings& settings, const CameraMatrices& camera, const std::vector<ClusterLight>& lights) {
+	int clusterCount = settings.TilesX * settings.TilesY * settings.Slices;
+	std::vector<std::vector<uint32_t>> lists(clusterCount);
+	float projectionX = camera.Projection[0], projectionY = camera.Projection[5];
+
+	std::vector<float> boxes(clusterCount * 6);
+	for (int slice = 0; slice < settings.Slices; slice++) {
+		float nearDepth = settings.Near * powf(settings.Far / settings.Near, slice / (float)settings.Slices);
+		float farDepth = settings.Near * powf(settings.Far / settings.Near, (slice + 1) / (float)settings.Slices);
+		for (int y = 0; y < settings.TilesY; y++) {
+			float top = 1.0f - 2.0f * y / settings.TilesY;
+			float bottom = 1.0f - 2.0f * (y + 1) / settings.TilesY;
+			for (int x = 0; x < settings.TilesX; x++) {
+				float left = -1.0f + 2.0f * x / settings.TilesX;
+				float right = -1.0f + 2.0f * (x + 1) / settings.TilesX;
+				float* box = &boxes[((slice * settings.TilesY + y) * settings.TilesX + x) * 6];
+				box[0] = std::min(left * nearDepth, left * farDepth) / projectionX;
+				box[1] = std::min(bottom * nearDepth, bottom * farDepth) / projectionY;
+				box[2] = nearDepth;
+				box[3] = std::max(right * nearDepth, right * farDepth) / projectionX;
+				box[4] = std::max(top * nearDepth, top * farDepth) / projectionY;
+				box[5] = farDepth;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < lights.size(); i++) {
+		float center[3];
+		for (int c = 0; c < 3; c++) {
+			const float* row = camera.View + c * 4;
+			center[c] = lights[i].Position[0] * row[0] + lights[i].Position[1] * row[1] + lights[i].Position[2] * row[2] + row[3];
+		}
+		float radiusSq = lights[i].Range * lights[i].Range;
+		for (int cluster = 0; cluster < clusterCount; cluster++) {
+			const float* box = &boxes[cluster * 6];
+			float distanceSq = 0;
+			for (int k = 0; k < 3; k++) {
+				float outside = std::max(box[k] - center[k], 0.0f) + std::max(center[k] - box[k + 3], 0.0f);
+				distanceSq += outside * outside;
+			}
+			if (distanceSq <= radiusSq)
+				lists[cluster].push_back((uint32_t)i);
+		}
+	}
+	return lists;
+}
+
+// Which cluster a view space point falls in, straight from
+// the projection, or -1 off screen or too near a cluster's side
+// to call
+static int ClusterOf(const LightClusterSettings& settings, const CameraMatrices& camera, const float point[3]) {
+	float depth = point[2];
+	if (depth <= settings.Near || depth >= settings.Far)
+		return -1;
+	float screenX = (point[0] * camera.Projection[0] / depth * 0.5f + 0.5f) * settings.TilesX;
+	float screenY = (0.5f - point[1] * camera.Projection[5] / depth * 0.5f) * settings.TilesY;
+	float slice = logf(depth / settings.Near) / logf(settings.Far / settings.Near) * settings.Slices;
+	const float edge = 1e-3f;
+	float coordinates[3] = { screenX, screenY, slice };
+	for (float coordinate : coordinates)
+		if (fabsf(coordinate - roundf(coordinate)) < edge)
+			return -1;
+	if (screenX < 0 || screenX >= settings.TilesX || screenY < 0 || screenY >= settings.TilesY)
+		return -1;
+	return ((int)slice * settings.TilesY + (int)screenY) * settings.TilesX + (int)screenX;
+}
+
+// The lists sit between two references: every cluster some
+// point of a light's sphere lands in has the light, and no
+// cluster has a light its box misses
+static void CheckLists(LightClusterGrid& grid, const CameraMatrices& camera, const std::vector<ClusterLight>& lights) {
+	grid.Build(lights.data(), (int)lights.size(), camera.View, camera.Projection);
+	const LightClusterSettings& settings = grid.GetSettings();
+	std::vector<std::vector<uint32_t>> boxLists = BruteForce(settings, camera, lights);
+
+	const std::vector<uint32_t>& ranges = grid.GetClusterRanges();
+	const std::vector<uint32_t>& indices = grid.GetLightIndices();
+	std::vector<std::vector<uint32_t>> lists(grid.GetClusterCount());
+	uint32_t offset = 0;
+	int notInBox = 0, maxPerCluster = 0;
+	for (int cluster = 0; cluster < grid.GetClusterCount(); cluster++) {
+		uint32_t start = ranges[cluster * 2], count = ranges[cluster * 2 + 1];
+		CHECK(start == offset);
+		offset += count;
+		if (start + count > indices.size())
+			break;
+
+		lists[cluster].assign(indices.begin() + start, indices.begin() + start + count);
+		CHECK(std::is_sorted(lists[cluster].begin(), lists[cluster].end()));
+		for (uint32_t light : lists[cluster])
+			notInBox += std::binary_search(boxLists[cluster].begin(), boxLists[cluster].end(), light) ? 0 : 1;
+		maxPerCluster = std::max(maxPerCluster, (int)count);
+	}
+	CHECK(notInBox == 0);
+	CHECK(offset == indices.size());
+
+	// Points through each sphere, the surface included
+	int missed = 0, visible = 0;
+	for (size_t i = 0; i < lights.size(); i++) {
+		float center[3];
+		for (int c = 0; c < 3; c++) {
+			const float* row = camera.View + c * 4;
+			center[c] = lights[i].Position[0] * row[0] + lights[i].Position[1] * row[1] + lights[i].Position[2] * row[2] + row[3];
+		}
+		bool seen = false;
+		for (int sample = 0; sample < 400; sample++) {
+			float direction[3] = { RandomFloat(-1, 1), RandomFloat(-1, 1), RandomFloat(-1, 1) };
+			float length = sqrtf(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+			if (length < 1e-3f || length > 1.0f)
+				continue;
+			float distance = lights[i].Range * (sample % 2 ? 0.999f : RandomFloat(0, 0.999f)) / length;
+			float point[3];
+			for (int c = 0; c < 3; c++)
+				point[c] = center[c] + direction[c] * distance;
+			int cluster = ClusterOf(settings, camera, point);
+			if (cluster < 0)
+				continue;
+			seen = true;
+			missed += std::binary_search(lists[cluster].begin(), lists[cluster].end(), (uint32_t)i) ? 0 : 1;
+		}
+		visible += seen ? 1 : 0;
+	}
+	CHECK(missed == 0);
+
+	const LightClusterStats& stats = grid.GetStats();
+	CHECK(stats.Lights == (int)lights.size());
+	CHECK(stats.Indices == (int)indices.size() && stats.MaxPerCluster == maxPerCluster);
+	CHECK(stats.LightsVisible >= visible);
+}
+
+static void TestLists() {
+	LightClusterSettings settings = GameSettings();
+	LightClusterGrid grid(settings, 3);
+	const int counts[] = { 0, 1, 3, 4, 5, 63, 257 };
+	for (int round = 0; round < 200; round++) {
+		float eye[3] = { RandomFloat(-5, 5), RandomFloat(0, 3), RandomFloat(-5, 5) };
+		float aspect = round % 3 == 0 ? 1.0f : 16.0f / 9.0f;
+		CameraMatrices camera = MakeCamera(eye, RandomFloat(-3.1f, 3.1f), RandomFloat(-0.5f, 0.5f), 0.25f * 3.14159265f + RandomFloat(0, 0.5f), aspect, settings);
+		std::vector<ClusterLight> lights = MakeLights(counts[round % 7], eye, 0.2f, 8.0f);
+		CheckLists(grid, camera, lights);
+	}
+
+	// A different grid, and a light that fills the whole view
+	LightClusterSettings coarse = settings;
+	coarse.TilesX = 5;
+	coarse.TilesY = 3;
+	coarse.Slices = 7;
+	coarse.Near = 0.5f;
+	coarse.Far = 40.0f;
+	LightClusterGrid coarseGrid(coarse, 1);
+	float eye[3] = { 0, 0, 0 };
+	CameraMatrices camera = MakeCamera(eye, 0.3f, 0.1f, 1.0f, 1.5f, coarse);
+	std::vector<ClusterLight> lights = MakeLights(30, eye, 0.5f, 4.0f);
+	lights[7].Range = 500.0f;
+	CheckLists(coarseGrid, camera, lights);
+	for (int cluster = 0; cluster < coarseGrid.GetClusterCount(); cluster++)
+		CHECK(coarseGrid.GetClusterRanges()[cluster * 2 + 1] >= 1);
+}
+
+static void TestSlices() {
+	LightClusterSettings settings = GameSettings();
+	LightClusterGrid grid(settings, 1);
+	CHECK(grid.GetSlice(0.0f) == 0 && grid.GetSlice(settings.Near) == 0);
+	CHECK(grid.GetSlice(settings.Far * 2.0f) == settings.Slices - 1);
+
+	// Just inside each slice's ends, computed the way the boxes are
+	for (int slice = 0; slice < settings.Slices; slice++) {
+		float nearDepth = settings.Near * powf(settings.Far / settings.Near, slice / (float)settings.Slices);
+		float farDepth = settings.Near * powf(settings.Far / settings.Near, (slice + 1) / (float)settings.Slices);
+		CHECK(grid.GetSlice(nearDepth * 1.001f) == slice);
+		CHECK(grid.GetSlice(farDepth * 0.999f) == slice);
+
+		// The shader's formula
+		float depth = sqrtf(nearDepth * farDepth);
+		CHECK((int)floorf(logf(depth) * grid.GetSliceScale() + grid.GetSliceBias()) == slice);
+	}
+}
+
+// --------------------------------------------------------
+// Build time
+// --------------------------------------------------------
+
+static void Benchmark() {
+	LightClusterSettings settings = GameSettings();
+	float eye[3] = { 0.0f, 1.0f, -5.0f };
+	CameraMatrices camera = MakeCamera(eye, 0.0f, -0.1f, 0.25f * 3.14159265f, 16.0f / 9.0f, settings);
+
+	const float ranges[2][2] = { { 1.5f, 1.5f }, { 1.0f, 6.0f } };
+	const char* rangeNames[2] = { "range 1.5 (the ball trail's)", "range 1 to 6" };
+	int hardwareThreads = std::max((int)std::thread::hardware_concurrency(), 1);
+	const int threadCounts[3] = { 1, 4, hardwareThreads };
+
+	for (int r = 0; r < 2; r++) {
+		std::vector<ClusterLight> lights = MakeLights(1000, eye, ranges[r][0], ranges[r][1]);
+		printf("1000 lights, %s:\n", rangeNames[r]);
+
+		for (int threads : threadCounts) {
+			LightClusterGrid grid(settings, threads);
+			grid.Build(lights.data(), (int)lights.size(), camera.View, camera.Projection);
+
+			const int builds = 200;
+			auto start = std::chrono::steady_clock::now();
+			for (int b = 0; b < builds; b++)
+				grid.Build(lights.data(), (int)lights.size(), camera.View, camera.Projection);
+			double milliseconds = ElapsedMilliseconds(start) / builds;
+
+			const LightClusterStats& stats = grid.GetStats();
+			printf("  %2d threads: %.3f ms/build (%d visible, %d indices, at most %d in a cluster)\n",
+				threads, milliseconds, stats.LightsVisible, stats.Indices, stats.MaxPerCluster);
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		std::vector<std::vector<uint32_t>> lists = BruteForce(settings, camera, lights);
+		printf("  brute force: %.3f ms\n", ElapsedMilliseconds(start));
+		CHECK(!lists.empty());
+	}
+}
+
+int main() {
+	TestLists();
+	TestSlices();
+	Benchmark();
+	return TestResult("LightClustersTest");
+}
@@ -0,0 +1,343 @@
+// Material keys: keys pack and unpack every field, sort the
+// way their parts compare (shaders first, layer last), and
+// mask parts too big for their field; ids come out dense in
+// first-use order; texture pairs group into tables exactly
+// when everything about both textures matches; the binding
+// cache skips a bind only when the slot already holds it.
+// Then binds per frame for the game's materials and a bigger
+// made up set, drawn as they come and sorted by key, next to
+// the three per entity the old path made.
+//
+//   g++ -std=c++14 -O2 -I.. MaterialKeysTest.cpp ../MaterialKeys.cpp -o MaterialKeysTest && ./MaterialKeysTest
+
+#include "TestCommon.h"
+#include "MaterialKeys.h"
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+static unsigned int seed = 1;
+
+static unsigned int RandomBits() {
+	seed = seed * 1664525 + 1013904223;
+	return seed >> 8;
+}
+
+static MaterialKeyParts RandomParts() {
+	MaterialKeyParts parts;
+	parts.Program = RandomBits() % (1u << MaterialKeyProgramBits);
+	parts.Table = RandomBits() % (1u << MaterialKeyTableBits);
+	parts.Sampler = RandomBits() % (1u << MaterialKeySamplerBits);
+	parts.Layer = RandomBits() % (1u << MaterialKeyLayerBits);
+
+	// Mostly small, like real ids, so equal parts come up
+	if (RandomBits() % 2) {
+		parts.Program %= 3;
+		parts.Table %= 3;
+		parts.Sampler %= 2;
+		parts.Layer %= 4;
+	}
+	return parts;
+}
+
+static std::tuple<uint32_t, uint32_t, uint32_t, uint32_t> Order(const MaterialKeyParts& parts) {
+	return std::make_tuple(parts.Program, parts.Table, parts.Sampler, parts.Layer);
+}
+
+static void TestKeys() {
+	CHECK(MaterialKeyProgramBits + MaterialKeyTableBits + MaterialKeySamplerBits + MaterialKeyLayerBits == 32);
+
+	int roundTrips = 0, ordered = 0;
+	const int rounds = 100000;
+	for (int round = 0; round < rounds; round++) {
+		MaterialKeyParts a = RandomParts(), b = RandomParts();
+		uint32_t keyA = MakeMaterialKey(a), keyB = MakeMaterialKey(b);
+		roundTrips += Order(SplitMaterialKey(keyA)) == Order(a) ? 1 : 0;
+		ordered += (keyA < keyB) == (Order(a) < Order(b)) && (keyA == keyB) == (Order(a) == Order(b)) ? 1 : 0;
+	}
+	CHECK(roundTrips == rounds && ordered == rounds);
+
+	// The ends of each field
+	MaterialKeyParts all = { 255, 255, 63, 1023 };
+	CHECK(MakeMaterialKey(all) == 0xFFFFFFFFu);
+	MaterialKeyParts none = { 0, 0, 0, 0 };
+	CHECK(MakeMaterialKey(none) == 0);
+	MaterialKeyParts program = { 1, 0, 0, 0 };
+	MaterialKeyParts rest = { 0, 255, 63, 1023 };
+	CHECK(MakeMaterialKey(program) == 0x01000000u && MakeMaterialKey(rest) < MakeMaterialKey(program));
+
+	// Too big for its field - masked, and the others untouched
+	MaterialKeyParts big = { 256 + 2, 3, 64 + 5, 1024 + 7 };
+	MaterialKeyParts split = SplitMaterialKey(MakeMaterialKey(big));
+	CHECK(split.Program == 2 && split.Table == 3 && split.Sampler == 5 && split.Layer == 7);
+}
+
+static void TestIds() {
+	int objects[4];
+	MaterialIdMap ids;
+	CHECK(ids.GetId(&objects[2]) == 0);
+	CHECK(ids.GetId(&objects[0]) == 1);
+	CHECK(ids.GetId(&objects[2]) == 0);
+
+	// Pairs: the order and the second object count
+	CHECK(ids.GetId(&objects[0], &objects[1]) == 2);
+	CHECK(ids.GetId(&objects[1], &objects[0]) == 3);
+	CHECK(ids.GetId(&objects[0], &objects[1]) == 2);
+	CHECK(ids.GetId(&objects[0]) == 1);
+	CHECK(ids.GetId(0) == 4);
+
+	ids.Clear();
+	CHECK(ids.GetId(&objects[3]) == 0);
+}
+
+// --------------------------------------------------------
+// Texture tables
+// --------------------------------------------------------
+
+static MaterialTextureDesc RandomDesc() {
+	const uint32_t sizes[] = { 256, 512, 1024 };
+	const uint32_t formats[] = { 71, 77, 28 };	// BC1, BC3, R8G8B8A8
+	MaterialTextureDesc desc;
+	desc.Width = sizes[RandomBits() % 3];
+	desc.Height = RandomBits() % 4 ? desc.Width : sizes[RandomBits() % 3];
+	desc.Format = formats[RandomBits() % 3];
+	desc.MipLevels = 1;
+	if (RandomBits() % 4) {
+		for (uint32_t size = std::max(desc.Width, desc.Height); size > 1; size /= 2)
+			desc.MipLevels++;
+	}
+	return desc;
+}
+
+typedef std::tuple<uint32_t, uint32_t, uint32_t, uint32_t> DescKey;
+
+static DescKey KeyOf(const MaterialTextureDesc& desc) {
+	return std::make_tuple(desc.Width, desc.Height, desc.Format, desc.MipLevels);
+}
+
+static void TestGrouping() {
+	for (int round = 0; round < 500; round++) {
+		int count = RandomBits() % 40;
+		std::vector<MaterialTextureDesc> albedo(count), normal(count);
+		for (int i = 0; i < count; i++) {
+			albedo[i] = RandomDesc();
+			normal[i] = RandomBits() % 3 ? albedo[i] : RandomDesc();
+		}
+
+		// One table per distinct pair, in first-use order
+		std::map<std::pair<DescKey, DescKey>, int> expectedTables;
+		std::vector<int> layers;
+		std::vector<MaterialTextureSlot> expected(count);
+		for (int i = 0; i < count; i++) {
+			auto pair = std::make_pair(KeyOf(albedo[i]), KeyOf(normal[i]));
+			auto found = expectedTables.find(pair);
+			int table = found != expectedTables.end() ? found->second : (int)expectedTables.size();
+			if (found == expectedTables.end()) {
+				expectedTables[pair] = table;
+				layers.push_back(0);
+			}
+			expected[i].Table = table;
+			expected[i].Layer = layers[table]++;
+		}
+
+		std::vector<MaterialTextureSlot> slots(3, MaterialTextureSlot{ 9, 9 });
+		int tables = GroupMaterialTextures(albedo, normal, slots);
+		CHECK(tables == (int)expectedTables.size());
+		CHECK((int)slots.size() == count);
+		int mismatched = 0;
+		for (int i = 0; i < count && i < (int)slots.size(); i++)
+			mismatched += slots[i].Table != expected[i].Table || slots[i].Layer != expected[i].Layer ? 1 : 0;
+		CHECK(mismatched == 0);
+	}
+
+	// Each difference on its own splits a table
+	MaterialTextureDesc base = { 512, 512, 71, 10 };
+	std::vector<MaterialTextureDesc> albedo(6, base), normal(6, base);
+	albedo[1].Width = 256;
+	albedo[2].Height = 256;
+	albedo[3].Format = 77;
+	albedo[4].MipLevels = 1;
+	normal[5].MipLevels = 9;
+	std::vector<MaterialTextureSlot> slots;
+	CHECK(GroupMaterialTextures(albedo, normal, slots) == 6);
+
+	// And the same pair again shares the first one's table
+	albedo.push_back(base);
+	normal.push_back(base);
+	CHECK(GroupMaterialTextures(albedo, normal, slots) == 6);
+	CHECK(slots[6].Table == 0 && slots[6].Layer == 1);
+}
+
+// --------------------------------------------------------
+// Binding dedup
+// --------------------------------------------------------
+
+static void TestBindingCache() {
+	int objects[8];
+	BindingCache cache;
+
+	// Nothing is known at first, so even null goes through
+	CHECK(cache.Bind(1, 0, 0));
+	CHECK(!cache.Bind(1, 0, 0));
+	CHECK(cache.Bind(1, 0, &objects[0]));
+	CHECK(!cache.Bind(1, 0, &objects[0]));
+
+	// Stages and slots are kept apart
+	CHECK(cache.Bind(0, 0, &objects[0]));
+	CHECK(cache.Bind(1, 1, &objects[0]));
+	CHECK(!cache.Bind(0, 0, &objects[0]) && !cache.Bind(1, 1, &objects[0]));
+
+	// Out of range can't be tracked and always binds
+	CHECK(cache.Bind(1, 16, &objects[1]) && cache.Bind(1, 16, &objects[1]));
+	CHECK(cache.Bind(2, 0, &objects[1]) && cache.Bind(-1, 0, &objects[1]));
+
+	// Samplers have slots of their own - a texture in t0 and
+	// a sampler in s0 don't knock each other out
+	CHECK(cache.BindSampler(1, 0, &objects[2]));
+	CHECK(!cache.Bind(1, 0, &objects[0]) && !cache.BindSampler(1, 0, &objects[2]));
+	CHECK(cache.BindSampler(1, 16, &objects[2]) && cache.BindSampler(1, 16, &objects[2]));
+
+	// Invalidate forgets everything
+	cache.Invalidate();
+	CHECK(cache.Bind(1, 0, &objects[0]) && cache.BindSampler(1, 0, &objects[2]));
+	CHECK(cache.GetStats().Requested == 19 && cache.GetStats().Issued == 13);
+	cache.ResetStats();
+	CHECK(cache.GetStats().Requested == 0 && cache.GetStats().Issued == 0);
+
+	// Against a plain record of every slot, samplers after
+	// the shader resources
+	const void* reference[2][32];
+	bool known[2][32] = {};
+	int mismatched = 0;
+	cache.Invalidate();
+	for (int round = 0; round < 100000; round++) {
+		if (RandomBits() % 500 == 0) {
+			cache.Invalidate();
+			std::fill(&known[0][0], &known[0][0] + 64, false);
+			continue;
+		}
+		int stage = RandomBits() % 2, slot = RandomBits() % 16;
+		bool sampler = RandomBits() % 3 == 0;
+		int index = slot + (sampler ? 16 : 0);
+		const void* object = RandomBits() % 9 ? (const void*)&objects[RandomBits() % 8] : 0;
+		bool expected = !known[stage][index] || reference[stage][index] != object;
+		reference[stage][index] = object;
+		known[stage][index] = true;
+		bool issued = sampler ? cache.BindSampler(stage, slot, object) : cache.Bind(stage, slot, object);
+		mismatched += issued != expected ? 1 : 0;
+	}
+	CHECK(mismatched == 0);
+}
+
+// --------------------------------------------------------
+// Binds per frame
+// --------------------------------------------------------
+
+// What MaterialTable bakes for a material, minus the D3D
+struct TestMaterial {
+	int Program;
+	int Sampler;
+	MaterialTextureDesc Albedo;
+	MaterialTextureDesc Normal;
+	const void* AlbedoArray;
+	const void* NormalArray;
+	uint32_t SortKey;
+};
+
+// The lit pixel shader's slots - textures in t0 and t1, the
+// sampler in s0 (MaterialTable takes them from the shader)
+static void Bake(std::vector<TestMaterial>& materials, std::vector<int>& tableIds) {
+	std::vector<MaterialTextureDesc> albedo, normal;
+	for (const TestMaterial& material : materials) {
+		albedo.push_back(material.Albedo);
+		normal.push_back(material.Normal);
+	}
+	std::vector<MaterialTextureSlot> slots;
+	int tables = GroupMaterialTextures(albedo, normal, slots);
+	tableIds.resize(tables * 2);
+
+	MaterialIdMap programs, samplers;
+	for (size_t i = 0; i < materials.size(); i++) {
+		TestMaterial& material = materials[i];
+		material.AlbedoArray = &tableIds[slots[i].Table * 2];
+		material.NormalArray = &tableIds[slots[i].Table * 2 + 1];
+		MaterialKeyParts parts;
+		parts.Program = programs.GetId((const void*)(size_t)(material.Program + 1));
+		parts.Table = slots[i].Table;
+		parts.Sampler = samplers.GetId((const void*)(size_t)(material.Sampler + 1));
+		parts.Layer = slots[i].Layer;
+		material.SortKey = MakeMaterialKey(parts);
+	}
+}
+
+static int DrawFrames(const std::vector<TestMaterial>& materials, const std::vector<int>& draws, int frames) {
+	const int pixelStage = 1;
+	BindingCache bindings;
+	for (int frame = 0; frame < frames; frame++) {
+		// Renderer::SetFrameConstants starts each frame afresh
+		bindings.Invalidate();
+		for (int m : draws) {
+			bindings.Bind(pixelStage, 0, materials[m].AlbedoArray);
+			bindings.Bind(pixelStage, 1, materials[m].NormalArray);
+			bindings.BindSampler(pixelStage, 0, (const void*)(size_t)(materials[m].Sampler + 1));
+		}
+	}
+	return bindings.GetStats().Issued;
+}
+
+static void Report() {
+	struct Scene {
+		const char* Name;
+		int Materials;
+		int Draws;
+		int Shapes;		// Distinct texture sizes and formats
+		int Samplers;
+	};
+	const Scene scenes[] = {
+		{ "Game (5 materials, 6 draws)", 5, 6, 1, 1 },
+		{ "64 materials, 500 draws", 64, 500, 4, 2 },
+		{ "200 materials, 2000 draws", 200, 2000, 8, 3 },
+	};
+	const int frames = 100;
+
+	for (const Scene& scene : scenes) {
+		std::vector<TestMaterial> materials(scene.Materials);
+		for (int i = 0; i < scene.Materials; i++) {
+			MaterialTextureDesc desc = { 512u << (i % scene.Shapes % 2), 512, 71u + i % scene.Shapes / 2, 10 };
+			materials[i] = TestMaterial();
+			materials[i].Program = 0;
+			materials[i].Sampler = i % scene.Samplers;
+			materials[i].Albedo = desc;
+			materials[i].Normal = desc;
+		}
+		std::vector<int> tableIds;
+		Bake(materials, tableIds);
+
+		// Game: the ball with the first material, then platforms
+		// taking turns
+		std::vector<int> draws(scene.Draws);
+		for (int d = 0; d < scene.Draws; d++)
+			draws[d] = scene.Materials == 5 ? std::max(d - 1, 0) % 5 : (int)(RandomBits() % scene.Materials);
+
+		int asIs = DrawFrames(materials, draws, frames);
+
+		auto start = std::chrono::steady_clock::now();
+		std::stable_sort(draws.begin(), draws.end(), [&](int a, int b) { return materials[a].SortKey < materials[b].SortKey; });
+		double sortMicroseconds = ElapsedMilliseconds(start) * 1000.0;
+		int sorted = DrawFrames(materials, draws, frames);
+		CHECK(sorted <= asIs);
+
+		printf("%s: %d tables, binds per frame %.1f as drawn, %.1f sorted by key (was %d), sort %.1f us\n",
+			scene.Name, (int)tableIds.size() / 2, asIs / (double)frames, sorted / (double)frames,
+			scene.Draws * 3, sortMicroseconds);
+	}
+}
+
+int main() {
+	TestKeys();
+	TestIds();
+	TestGrouping();
+	TestBindingCache();
+	Report();
+	return TestResult("MaterialKeysTest");
+}
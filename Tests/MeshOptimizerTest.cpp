@@ -0,0 +1,258 @@
+// Mesh optimizer: the cache analysis against a plain FIFO
+// simulation, each pass only reordering (same triangles, same
+// winding, same vertex data), and ACMR / ATVR before and after
+// Mesh::OptimizeOrder's passes on every bundled model - as
+// loaded, and from a shuffled worst case.  Then triangles per
+// second through each pass on a big grid.
+//
+//   g++ -std=c++14 -O2 -I.. MeshOptimizerTest.cpp ../MeshOptimizer.cpp ../MeshSimplifier.cpp -o MeshOptimizerTest && ./MeshOptimizerTest
+
+#include "TestCommon.h"
+#include "MeshOptimizer.h"
+#include "ObjModel.h"
+#include <algorithm>
+#include <deque>
+#include <string>
+
+static unsigned int seed = 1;
+
+static unsigned int RandomBits() {
+	seed = seed * 1664525 + 1013904223;
+	return seed >> 8;
+}
+
+static void Shuffle(std::vector<unsigned int>& indices) {
+	for (size_t t = indices.size() / 3; t > 1; t--) {
+		size_t other = RandomBits() % t;
+		for (int c = 0; c < 3; c++)
+			std::swap(indices[(t - 1) * 3 + c], indices[other * 3 + c]);
+	}
+}
+
+// A FIFO cache, as simple as it gets
+static VertexCacheStats SimulateFifo(const std::vector<unsigned int>& indices, int vertexCount, int cacheSize) {
+	std::deque<unsigned int> cache;
+	int misses = 0;
+	for (unsigned int v : indices) {
+		if (std::find(cache.begin(), cache.end(), v) != cache.end())
+			continue;
+		misses++;
+		cache.push_back(v);
+		if ((int)cache.size() > cacheSize)
+			cache.pop_front();
+	}
+
+	std::vector<bool> used(vertexCount, false);
+	int usedCount = 0;
+	for (unsigned int v : indices) {
+		usedCount += used[v] ? 0 : 1;
+		used[v] = true;
+	}
+
+	VertexCacheStats stats;
+	stats.ACMR = misses / (float)(indices.size() / 3);
+	stats.ATVR = misses / (float)usedCount;
+	return stats;
+}
+
+// Each triangle's corners as data, turned to start at the
+// smallest so the same triangle with the same winding always
+// compares equal; sorted, so the order doesn't matter
+static std::vector<std::vector<float>> TriangleSet(const std::vector<float>& vertices, int stride, const std::vector<unsigned int>& indices) {
+	std::vector<std::vector<float>> triangles;
+	for (size_t t = 0; t < indices.size(); t += 3) {
+		std::vector<float> corners[3];
+		for (int c = 0; c < 3; c++)
+			corners[c].assign(&vertices[indices[t + c] * stride], &vertices[indices[t + c] * stride] + stride);
+		int first = (int)(std::min_element(corners, corners + 3) - corners);
+		std::vector<float> triangle;
+		for (int c = 0; c < 3; c++)
+			triangle.insert(triangle.end(), corners[(first + c) % 3].begin(), corners[(first + c) % 3].end());
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+// A grid with UVs, so the vertex data tells every vertex apart
+static void MakeGrid(int size, std::vector<float>& vertices, std::vector<unsigned int>& indices) {
+	vertices.clear();
+	indices.clear();
+	for (int z = 0; z <= size; z++) {
+		for (int x = 0; x <= size; x++) {
+			float vertex[ObjVertexFloats] = { (float)x, 0.1f * ((x * 7 + z * 3) % 5), (float)z, 0, 1, 0, x / (float)size, z / (float)size };
+			vertices.insert(vertices.end(), vertex, vertex + ObjVertexFloats);
+		}
+	}
+	for (int z = 0; z < size; z++) {
+		for (int x = 0; x < size; x++) {
+			unsigned int a = z * (size + 1) + x, b = a + 1, c = a + size + 1, d = c + 1;
+			unsigned int quad[6] = { a, c, b, b, c, d };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+}
+
+static void TestAnalyze() {
+	const int cacheSizes[] = { 1, 3, 8, 16, 32 };
+	for (int round = 0; round < 200; round++) {
+		int vertexCount = 3 + RandomBits() % 200;
+		std::vector<unsigned int> indices(3 * (1 + RandomBits() % 300));
+		for (unsigned int& index : indices)
+			index = RandomBits() % (round % 2 ? vertexCount : std::min(vertexCount, 12));
+		for (int cacheSize : cacheSizes) {
+			VertexCacheStats expected = SimulateFifo(indices, vertexCount, cacheSize);
+			VertexCacheStats stats = AnalyzeVertexCache(indices.data(), (int)indices.size(), vertexCount, cacheSize);
+			CHECK(stats.ACMR == expected.ACMR && stats.ATVR == expected.ATVR);
+		}
+	}
+
+	// The ends of the scale
+	unsigned int single[] = { 0, 1, 2 };
+	VertexCacheStats stats = AnalyzeVertexCache(single, 3, 3);
+	CHECK(stats.ACMR == 3.0f && stats.ATVR == 1.0f);
+	stats = AnalyzeVertexCache(single, 2, 3);
+	CHECK(stats.ACMR == 0.0f && stats.ATVR == 0.0f);
+}
+
+static void TestOnlyReorders() {
+	for (int round = 0; round < 20; round++) {
+		std::vector<float> vertices;
+		std::vector<unsigned int> indices;
+		MakeGrid(4 + round * 3, vertices, indices);
+		Shuffle(indices);
+		int vertexCount = (int)(vertices.size() / ObjVertexFloats);
+
+		// A few vertices nothing uses, to see them go to the end
+		std::vector<float> padding(ObjVertexFloats * 3, -1.0f);
+		vertices.insert(vertices.begin(), padding.begin(), padding.end());
+		for (unsigned int& index : indices)
+			index += 3;
+		vertexCount += 3;
+
+		std::vector<std::vector<float>> expected = TriangleSet(vertices, ObjVertexFloats, indices);
+
+		OptimizeVertexCache(indices.data(), (int)indices.size(), vertexCount);
+		CHECK(TriangleSet(vertices, ObjVertexFloats, indices) == expected);
+
+		OptimizeOverdraw(indices.data(), (int)indices.size(), vertices.data(), ObjVertexFloats, vertexCount);
+		CHECK(TriangleSet(vertices, ObjVertexFloats, indices) == expected);
+
+		int used = OptimizeVertexFetch(vertices.data(), ObjVertexFloats, vertexCount, indices.data(), (int)indices.size());
+		CHECK(used == vertexCount - 3);
+		CHECK(TriangleSet(vertices, ObjVertexFloats, indices) == expected);
+		for (int v = used; v < vertexCount; v++)
+			CHECK(vertices[v * ObjVertexFloats] == -1.0f);
+
+		// Every vertex first used right after the one before
+		unsigned int next = 0;
+		for (unsigned int index : indices) {
+			CHECK(index <= next);
+			if (index == next)
+				next++;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Bundled models
+// --------------------------------------------------------
+
+struct OrderResult {
+	VertexCacheStats Before;
+	VertexCacheStats Cache;		// After OptimizeVertexCache
+	VertexCacheStats After;		// And OptimizeOverdraw, as drawn
+};
+
+// Mesh::OptimizeOrder on one index buffer
+static OrderResult Optimize(const std::vector<float>& source, std::vector<unsigned int> indices, int cacheSize) {
+	std::vector<float> vertices(source);
+	int vertexCount = (int)(vertices.size() / ObjVertexFloats);
+	OrderResult result;
+	result.Before = AnalyzeVertexCache(indices.data(), (int)indices.size(), vertexCount, cacheSize);
+	OptimizeVertexCache(indices.data(), (int)indices.size(), vertexCount);
+	result.Cache = AnalyzeVertexCache(indices.data(), (int)indices.size(), vertexCount, cacheSize);
+	OptimizeOverdraw(indices.data(), (int)indices.size(), vertices.data(), ObjVertexFloats, vertexCount);
+	OptimizeVertexFetch(vertices.data(), ObjVertexFloats, vertexCount, indices.data(), (int)indices.size());
+	result.After = AnalyzeVertexCache(indices.data(), (int)indices.size(), vertexCount, cacheSize);
+	return result;
+}
+
+static void TestModels() {
+	const char* names[] = { "cube.obj", "cone.obj", "cylinder.obj", "sphere.obj", "torus.obj", "helix.obj" };
+	printf("Model          Tris  Verts  ACMR as loaded -> optimized   shuffled -> optimized   ATVR as loaded -> optimized\n");
+	for (const char* name : names) {
+		std::vector<float> vertices;
+		std::vector<unsigned int> indices;
+		std::string path = std::string("../Debug/Models/") + name;
+		CHECK(LoadObj(path.c_str(), vertices, indices));
+		if (indices.empty())
+			continue;
+
+		OrderResult loaded = Optimize(vertices, indices, 16);
+		std::vector<unsigned int> shuffled(indices);
+		Shuffle(shuffled);
+		OrderResult fromShuffled = Optimize(vertices, shuffled, 16);
+
+		// Never worse than it came, and the overdraw pass only
+		// cuts where the cache order was starting over anyway
+		CHECK(loaded.After.ACMR <= loaded.Before.ACMR + 0.01f);
+		CHECK(fromShuffled.After.ACMR < fromShuffled.Before.ACMR);
+		CHECK(loaded.After.ACMR <= loaded.Cache.ACMR * 1.05f + 0.01f);
+		CHECK(fromShuffled.After.ATVR <= 1.6f);
+
+		// Where it starts shouldn't matter much
+		CHECK(fromShuffled.After.ACMR <= loaded.After.ACMR * 1.15f + 0.01f);
+
+		printf("%-12s %6d %6d  %6.3f -> %6.3f          %6.3f -> %6.3f          %6.3f -> %6.3f\n",
+			name, (int)indices.size() / 3, (int)(vertices.size() / ObjVertexFloats),
+			loaded.Before.ACMR, loaded.After.ACMR, fromShuffled.Before.ACMR, fromShuffled.After.ACMR,
+			loaded.Before.ATVR, loaded.After.ATVR);
+	}
+}
+
+// --------------------------------------------------------
+// Throughput
+// --------------------------------------------------------
+
+static void Benchmark() {
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+	MakeGrid(300, vertices, indices);
+	Shuffle(indices);
+	int vertexCount = (int)(vertices.size() / ObjVertexFloats);
+	int indexCount = (int)indices.size();
+	double triangles = indexCount / 3;
+
+	VertexCacheStats before = AnalyzeVertexCache(indices.data(), indexCount, vertexCount);
+	auto start = std::chrono::steady_clock::now();
+	OptimizeVertexCache(indices.data(), indexCount, vertexCount);
+	double cacheMilliseconds = ElapsedMilliseconds(start);
+
+	start = std::chrono::steady_clock::now();
+	OptimizeOverdraw(indices.data(), indexCount, vertices.data(), ObjVertexFloats, vertexCount);
+	double overdrawMilliseconds = ElapsedMilliseconds(start);
+
+	start = std::chrono::steady_clock::now();
+	OptimizeVertexFetch(vertices.data(), ObjVertexFloats, vertexCount, indices.data(), indexCount);
+	double fetchMilliseconds = ElapsedMilliseconds(start);
+
+	start = std::chrono::steady_clock::now();
+	VertexCacheStats after = AnalyzeVertexCache(indices.data(), indexCount, vertexCount);
+	double analyzeMilliseconds = ElapsedMilliseconds(start);
+	CHECK(after.ACMR < 0.8f);
+
+	printf("Grid, %.0f triangles shuffled, ACMR %.3f -> %.3f\n", triangles, before.ACMR, after.ACMR);
+	printf("  OptimizeVertexCache %6.1f ms, %5.2f M triangles/s\n", cacheMilliseconds, triangles / cacheMilliseconds / 1000.0);
+	printf("  OptimizeOverdraw    %6.1f ms, %5.2f M triangles/s\n", overdrawMilliseconds, triangles / overdrawMilliseconds / 1000.0);
+	printf("  OptimizeVertexFetch %6.1f ms, %5.2f M triangles/s\n", fetchMilliseconds, triangles / fetchMilliseconds / 1000.0);
+	printf("  AnalyzeVertexCache  %6.1f ms, %5.2f M triangles/s\n", analyzeMilliseconds, triangles / analyzeMilliseconds / 1000.0);
+}
+
+int main() {
+	TestAnalyze();
+	TestOnlyReorders();
+	TestModels();
+	Benchmark();
+	return TestResult("MeshOptimizerTest");
+}
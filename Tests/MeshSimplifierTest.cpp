@@ -0,0 +1,374 @@
+// Mesh simplifier: welding, then each bundled model's level
+// of detail chain built the way Mesh::BuildLODs does, with
+// the distance the surface really moved measured both ways
+// against what the simplifier reports.  A bumpy grid with a UV
+// seam checks borders stay put, seams don't tear and nothing
+// flips.  Then triangles per second on a dense sphere.
+//
+//   g++ -std=c++14 -O2 -I.. MeshSimplifierTest.cpp ../MeshSimplifier.cpp -o MeshSimplifierTest && ./MeshSimplifierTest
+
+#include "TestCommon.h"
+#include "ObjModel.h"
+#include <algorithm>
+#include <map>
+#include <math.h>
+#include <string>
+
+// --------------------------------------------------------
+// Geometry helpers
+// --------------------------------------------------------
+
+struct Vec3 {
+	double X, Y, Z;
+};
+
+static Vec3 Sub(Vec3 a, Vec3 b) { Vec3 r = { a.X - b.X, a.Y - b.Y, a.Z - b.Z }; return r; }
+static Vec3 Add(Vec3 a, Vec3 b) { Vec3 r = { a.X + b.X, a.Y + b.Y, a.Z + b.Z }; return r; }
+static Vec3 Scale(Vec3 a, double s) { Vec3 r = { a.X * s, a.Y * s, a.Z * s }; return r; }
+static double Dot(Vec3 a, Vec3 b) { return a.X * b.X + a.Y * b.Y + a.Z * b.Z; }
+static Vec3 Cross(Vec3 a, Vec3 b) { Vec3 r = { a.Y * b.Z - a.Z * b.Y, a.Z * b.X - a.X * b.Z, a.X * b.Y - a.Y * b.X }; return r; }
+
+static Vec3 Position(const std::vector<float>& vertices, int stride, unsigned int v) {
+	Vec3 p = { vertices[v * stride], vertices[v * stride + 1], vertices[v * stride + 2] };
+	return p;
+}
+
+// Closest point on triangle abc to p (Real-Time Collision
+// Detection, 5.1.5), as a distance
+static double PointTriangleDistance(Vec3 p, Vec3 a, Vec3 b, Vec3 c) {
+	Vec3 ab = Sub(b, a), ac = Sub(c, a), ap = Sub(p, a);
+	double d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+	Vec3 closest;
+	if (d1 <= 0 && d2 <= 0) {
+		closest = a;
+	} else {
+		Vec3 bp = Sub(p, b);
+		double d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+		Vec3 cp = Sub(p, c);
+		double d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+		double vc = d1 * d4 - d3 * d2, vb = d5 * d2 - d1 * d6, va = d3 * d6 - d5 * d4;
+		if (d3 >= 0 && d4 <= d3)
+			closest = b;
+		else if (d6 >= 0 && d5 <= d6)
+			closest = c;
+		else if (vc <= 0 && d1 >= 0 && d3 <= 0)
+			closest = Add(a, Scale(ab, d1 / (d1 - d3)));
+		else if (vb <= 0 && d2 >= 0 && d6 <= 0)
+			closest = Add(a, Scale(ac, d2 / (d2 - d6)));
+		else if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0)
+			closest = Add(b, Scale(Sub(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+		else {
+			double denominator = 1.0 / (va + vb + vc);
+			closest = Add(a, Add(Scale(ab, vb * denominator), Scale(ac, vc * denominator)));
+		}
+	}
+	Vec3 d = Sub(p, closest);
+	return sqrt(Dot(d, d));
+}
+
+// Farthest any sample of from's surface (corners, edge
+// midpoints, centers) lies from to's surface
+static double SurfaceDistance(const std::vector<float>& vertices, int stride,
+	const std::vector<unsigned int>& from, const std::vector<unsigned int>& to) {
+	double farthest = 0;
+	for (size_t t = 0; t < from.size(); t += 3) {
+		Vec3 a = Position(vertices, stride, from[t]);
+		Vec3 b = Position(vertices, stride, from[t + 1]);
+		Vec3 c = Position(vertices, stride, from[t + 2]);
+		Vec3 samples[7] = { a, b, c, Scale(Add(a, b), 0.5), Scale(Add(b, c), 0.5), Scale(Add(a, c), 0.5), Scale(Add(a, Add(b, c)), 1.0 / 3) };
+		for (const Vec3& p : samples) {
+			double nearest = 1e30;
+			for (size_t u = 0; u < to.size() && nearest > farthest; u += 3)
+				nearest = std::min(nearest, PointTriangleDistance(p, Position(vertices, stride, to[u]),
+					Position(vertices, stride, to[u + 1]), Position(vertices, stride, to[u + 2])));
+			farthest = std::max(farthest, nearest);
+		}
+	}
+	return farthest;
+}
+
+// Edges by position, with how many triangles use each
+typedef std::map<std::pair<std::vector<float>, std::vector<float>>, int> EdgeUse;
+
+static EdgeUse CountEdges(const std::vector<float>& vertices, int stride, const std::vector<unsigned int>& indices) {
+	EdgeUse edges;
+	for (size_t t = 0; t < indices.size(); t += 3) {
+		for (int e = 0; e < 3; e++) {
+			const float* a = &vertices[indices[t + e] * stride];
+			const float* b = &vertices[indices[t + (e + 1) % 3] * stride];
+			std::vector<float> pa(a, a + 3), pb(b, b + 3);
+			edges[pa < pb ? std::make_pair(pa, pb) : std::make_pair(pb, pa)]++;
+		}
+	}
+	return edges;
+}
+
+static std::vector<std::pair<std::vector<float>, std::vector<float>>> BorderEdges(const EdgeUse& edges) {
+	std::vector<std::pair<std::vector<float>, std::vector<float>>> border;
+	for (const auto& edge : edges)
+		if (edge.second == 1)
+			border.push_back(edge.first);
+	return border;
+}
+
+static bool IsWatertight(const EdgeUse& edges) {
+	for (const auto& edge : edges)
+		if (edge.second != 2)
+			return false;
+	return true;
+}
+
+// No triangle left with two corners at one position, every
+// index in range
+static bool IsClean(const std::vector<float>& vertices, int stride, const std::vector<unsigned int>& indices) {
+	int vertexCount = (int)(vertices.size() / stride);
+	for (size_t t = 0; t < indices.size(); t += 3) {
+		for (int c = 0; c < 3; c++)
+			if ((int)indices[t + c] >= vertexCount)
+				return false;
+		for (int c = 0; c < 3; c++)
+			if (memcmp(&vertices[indices[t + c] * stride], &vertices[indices[t + (c + 1) % 3] * stride], 3 * sizeof(float)) == 0)
+				return false;
+	}
+	return true;
+}
+
+static double BoundingRadius(const std::vector<float>& vertices, int stride) {
+	Vec3 low = Position(vertices, stride, 0), high = low;
+	for (size_t v = 0; v < vertices.size() / stride; v++) {
+		Vec3 p = Position(vertices, stride, (unsigned int)v);
+		low.X = std::min(low.X, p.X); low.Y = std::min(low.Y, p.Y); low.Z = std::min(low.Z, p.Z);
+		high.X = std::max(high.X, p.X); high.Y = std::max(high.Y, p.Y); high.Z = std::max(high.Z, p.Z);
+	}
+	Vec3 extent = Sub(high, low);
+	return sqrt(Dot(extent, extent)) * 0.5;
+}
+
+// --------------------------------------------------------
+// Tests
+// --------------------------------------------------------
+
+static void TestWeld() {
+	// Two floats of key, one extra that isn't compared
+	float vertices[] = {
+		1, 2, 10,
+		3, 4, 11,
+		1, 2, 12,
+		5, 6, 13,
+		3, 4, 14,
+	};
+	unsigned int indices[] = { 0, 1, 2, 2, 3, 4, 4, 1, 0 };
+	int count = WeldVertices(vertices, 3, 5, 2, indices, 9);
+	CHECK(count == 3);
+
+	// The first of each kept, in order
+	const float expected[] = { 1, 2, 10, 3, 4, 11, 5, 6, 13 };
+	CHECK(memcmp(vertices, expected, sizeof(expected)) == 0);
+	const unsigned int expectedIndices[] = { 0, 1, 0, 0, 2, 1, 1, 1, 0 };
+	CHECK(memcmp(indices, expectedIndices, sizeof(expectedIndices)) == 0);
+}
+
+struct ModelReport {
+	const char* Name;
+	int Triangles[4];
+	float Reported[4];
+	double Measured[4];
+	int Levels;
+	double Milliseconds;
+};
+
+static ModelReport TestModel(const char* name) {
+	ModelReport report = {};
+	report.Name = name;
+
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+	std::string path = std::string("../Debug/Models/") + name;
+	CHECK(LoadObj(path.c_str(), vertices, indices));
+	if (indices.empty())
+		return report;
+
+	const int stride = ObjVertexFloats;
+	int vertexCount = (int)(vertices.size() / stride);
+	double radius = BoundingRadius(vertices, stride);
+	bool watertight = IsWatertight(CountEdges(vertices, stride, indices));
+
+	// Mesh::BuildLODs
+	const float maxError = (float)radius * 0.05f;
+	report.Triangles[0] = (int)indices.size() / 3;
+	report.Levels = 1;
+	std::vector<unsigned int> source(indices), simplified;
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::vector<unsigned int>> levels;
+	while (report.Levels < 4) {
+		MeshSimplifyStats stats;
+		SimplifyMesh(vertices.data(), stride, vertexCount, source.data(), (int)source.size(), (int)source.size() / 2, maxError, simplified, &stats);
+		if (simplified.empty() || simplified.size() > source.size() * 9 / 10)
+			break;
+
+		CHECK(stats.SourceTriangles == (int)source.size() / 3 && stats.Triangles == (int)simplified.size() / 3);
+		CHECK(stats.Error <= maxError);
+		report.Triangles[report.Levels] = stats.Triangles;
+		report.Reported[report.Levels] = report.Reported[report.Levels - 1] + stats.Error;
+		levels.push_back(simplified);
+		report.Levels++;
+		source.swap(simplified);
+	}
+	report.Milliseconds = ElapsedMilliseconds(start);
+
+	for (int level = 1; level < report.Levels; level++) {
+		const std::vector<unsigned int>& lod = levels[level - 1];
+		CHECK(IsClean(vertices, stride, lod));
+		if (watertight)
+			CHECK(IsWatertight(CountEdges(vertices, stride, lod)));
+
+		// Every vertex is one of the originals, so the simplified
+		// surface lies close to the full one and back
+		double measured = std::max(SurfaceDistance(vertices, stride, lod, indices), SurfaceDistance(vertices, stride, indices, lod));
+		report.Measured[level] = measured;
+		CHECK(measured <= report.Reported[level] * 2.0 + radius * 0.01);
+		CHECK(measured <= radius * 0.25);
+	}
+	return report;
+}
+
+// A bumpy heightfield, with the middle column of vertices
+// doubled up for a UV seam
+static void MakeGrid(int size, std::vector<float>& vertices, std::vector<unsigned int>& indices) {
+	const int stride = ObjVertexFloats;
+	vertices.clear();
+	indices.clear();
+	int seam = size / 2;
+	int columns = size + 2;
+	for (int z = 0; z <= size; z++) {
+		for (int column = 0; column < columns; column++) {
+			int x = column <= seam ? column : column - 1;
+			float height = 0.3f * sinf(x * 0.4f) * cosf(z * 0.3f);
+			float vertex[stride] = { (float)x, height, (float)z, 0, 1, 0, column <= seam ? 0.0f : 1.0f, 0 };
+			vertices.insert(vertices.end(), vertex, vertex + stride);
+		}
+	}
+	for (int z = 0; z < size; z++) {
+		for (int column = 0; column + 1 < columns; column++) {
+			if (column == seam)
+				continue;
+			unsigned int a = z * columns + column, b = a + 1, c = a + columns, d = c + 1;
+			unsigned int quad[6] = { a, c, b, b, c, d };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+}
+
+static void TestBordersAndSeams() {
+	const int stride = ObjVertexFloats;
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices, result;
+	MakeGrid(40, vertices, indices);
+	int vertexCount = (int)(vertices.size() / stride);
+
+	EdgeUse before = CountEdges(vertices, stride, indices);
+	MeshSimplifyStats stats;
+	SimplifyMesh(vertices.data(), stride, vertexCount, indices.data(), (int)indices.size(), (int)indices.size() / 8, 1.0f, result, &stats);
+	CHECK(stats.Triangles < stats.SourceTriangles / 2);
+	CHECK(IsClean(vertices, stride, result));
+
+	// The outline is exactly what it was and the seam didn't open
+	// into a new border
+	EdgeUse after = CountEdges(vertices, stride, result);
+	CHECK(BorderEdges(before) == BorderEdges(after));
+
+	// Each side of the seam kept its own UVs
+	for (unsigned int index : result) {
+		float x = vertices[index * stride];
+		float u = vertices[index * stride + 6];
+		if (x < 20.0f)
+			CHECK(u == 0.0f);
+		if (x > 20.0f)
+			CHECK(u == 1.0f);
+	}
+
+	// Nothing turned over - a sliver can end up standing on edge
+	for (size_t t = 0; t < result.size(); t += 3) {
+		Vec3 a = Position(vertices, stride, result[t]);
+		Vec3 n = Cross(Sub(Position(vertices, stride, result[t + 1]), a), Sub(Position(vertices, stride, result[t + 2]), a));
+		CHECK(n.Y >= 0);
+	}
+
+	// No error allowed leaves a curved surface alone
+	SimplifyMesh(vertices.data(), stride, vertexCount, indices.data(), (int)indices.size(), 0, 0.0f, result, &stats);
+	CHECK(stats.Error == 0.0f && stats.Triangles > stats.SourceTriangles * 9 / 10);
+}
+
+// --------------------------------------------------------
+// Throughput
+// --------------------------------------------------------
+
+// UV sphere with a seam where longitude wraps, bumped so that
+// no collapse is free
+static void MakeSphere(int rings, int segments, std::vector<float>& vertices, std::vector<unsigned int>& indices) {
+	vertices.clear();
+	indices.clear();
+	for (int r = 0; r <= rings; r++) {
+		float theta = 3.14159265f * r / rings;
+		for (int s = 0; s <= segments; s++) {
+			float phi = 6.2831853f * (s % segments) / segments;
+			float radius = 1.0f + 0.02f * sinf(phi * 7.0f) * sinf(theta * 5.0f);
+			float n[3] = { sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi) };
+			if (r == 0 || r == rings)
+				n[0] = n[2] = 0.0f;
+			float vertex[ObjVertexFloats] = { n[0] * radius, n[1] * radius, n[2] * radius, n[0], n[1], n[2], s / (float)segments, r / (float)rings };
+			vertices.insert(vertices.end(), vertex, vertex + ObjVertexFloats);
+		}
+	}
+	for (int r = 0; r < rings; r++) {
+		for (int s = 0; s < segments; s++) {
+			unsigned int a = r * (segments + 1) + s, b = a + 1, c = a + segments + 1, d = c + 1;
+			if (r != 0) {
+				unsigned int t[3] = { a, b, c };
+				indices.insert(indices.end(), t, t + 3);
+			}
+			if (r != rings - 1) {
+				unsigned int t[3] = { b, d, c };
+				indices.insert(indices.end(), t, t + 3);
+			}
+		}
+	}
+}
+
+static void Benchmark(const std::vector<ModelReport>& models) {
+	for (const ModelReport& model : models) {
+		printf("%-13s %5d triangles", model.Name, model.Triangles[0]);
+		for (int level = 1; level < model.Levels; level++)
+			printf(" -> %5d (error %.3f, measured %.3f)", model.Triangles[level], model.Reported[level], model.Measured[level]);
+		printf(", chain in %.2f ms\n", model.Milliseconds);
+	}
+
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices, result;
+	MakeSphere(256, 512, vertices, indices);
+	int vertexCount = (int)(vertices.size() / ObjVertexFloats);
+	const int divisors[] = { 2, 16 };
+	for (int divisor : divisors) {
+		MeshSimplifyStats stats;
+		auto start = std::chrono::steady_clock::now();
+		SimplifyMesh(vertices.data(), ObjVertexFloats, vertexCount, indices.data(), (int)indices.size(),
+			(int)indices.size() / divisor, 1.0f, result, &stats);
+		double milliseconds = ElapsedMilliseconds(start);
+		CHECK(stats.Triangles <= stats.SourceTriangles / divisor);
+		printf("Sphere %d -> %d triangles: %.0f ms, %.2f M source triangles/s, %d passes, error %.4f\n",
+			stats.SourceTriangles, stats.Triangles, milliseconds, stats.SourceTriangles / milliseconds / 1000.0, stats.Passes, stats.Error);
+	}
+}
+
+int main() {
+	TestWeld();
+
+	std::vector<ModelReport> models;
+	const char* names[] = { "cube.obj", "cone.obj", "cylinder.obj", "sphere.obj", "torus.obj", "helix.obj" };
+	for (const char* name : names)
+		models.push_back(TestModel(name));
+
+	TestBordersAndSeams();
+	Benchmark(models);
+	return TestResult("MeshSimplifierTest");
+}
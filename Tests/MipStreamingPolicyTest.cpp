@@ -0,0 +1,247 @@
+// Mip streaming policy: the budget and hysteresis rules, then a
+// camera trace replayed through it.  Pass a trace file to replay
+// that instead of the built in fly-by; each line is
+// "frame texture pixels", frames in order.
+//
+//   g++ -std=c++14 -O2 -I.. MipStreamingPolicyTest.cpp ../MipStreamingPolicy.cpp -o MipStreamingPolicyTest && ./MipStreamingPolicyTest [trace.txt]
+
+#include "TestCommon.h"
+#include "MipStreamingPolicy.h"
+#include <fstream>
+#include <math.h>
+
+// BC1 mip sizes for a square texture
+static std::vector<size_t> MipBytes(uint32_t width) {
+	std::vector<size_t> bytes;
+	for (uint32_t w = width; ; w /= 2) {
+		uint32_t blocks = (w + 3) / 4;
+		bytes.push_back((size_t)blocks * blocks * 8);
+		if (w == 1)
+			break;
+	}
+	return bytes;
+}
+
+static size_t BytesFromMip(uint32_t width, int topMip) {
+	std::vector<size_t> bytes = MipBytes(width);
+	size_t total = 0;
+	for (size_t m = topMip; m < bytes.size(); m++)
+		total += bytes[m];
+	return total;
+}
+
+static void Apply(MipStreamingPolicy& policy, const std::vector<MipChange>& changes) {
+	for (size_t i = 0; i < changes.size(); i++)
+		policy.SetResident(changes[i].TextureID, changes[i].TopMip);
+}
+
+static void TestChooseAndHysteresis() {
+	MipStreamingPolicy policy(64 << 20, 5, 4);
+	int id = policy.AddTexture(1024, MipBytes(1024), 4);
+	std::vector<MipChange> changes;
+
+	// Full screen wants the top mip
+	policy.BeginFrame();
+	policy.RequestScreenSize(id, 1024);
+	policy.Update(changes);
+	CHECK(changes.size() == 1 && changes[0].TopMip == 0);
+	Apply(policy, changes);
+
+	// Slightly smaller isn't enough to drop a mip
+	policy.BeginFrame();
+	policy.RequestScreenSize(id, 600);
+	policy.Update(changes);
+	CHECK(changes.empty());
+
+	// Much smaller waits out the delay before streaming out
+	for (int frame = 0; frame < 4; frame++) {
+		policy.BeginFrame();
+		policy.RequestScreenSize(id, 100);
+		policy.Update(changes);
+		CHECK(changes.empty());
+	}
+	policy.BeginFrame();
+	policy.RequestScreenSize(id, 100);
+	policy.Update(changes);
+	CHECK(changes.size() == 1 && changes[0].TopMip > 0);
+	Apply(policy, changes);
+
+	// Off screen keeps only the 64 texel mip
+	for (int frame = 0; frame < 5; frame++) {
+		policy.BeginFrame();
+		policy.Update(changes);
+		Apply(policy, changes);
+	}
+	CHECK(policy.GetResidentMip(id) == 4);
+}
+
+static void TestBudget() {
+	// Two textures wanting more detail than there's room for -
+	// both get some, trimmed evenly by texels per screen pixel
+	size_t budget = BytesFromMip(1024, 0) + BytesFromMip(1024, 4);
+	MipStreamingPolicy policy(budget, 30, 4);
+	int near = policy.AddTexture(1024, MipBytes(1024), 4);
+	int far = policy.AddTexture(1024, MipBytes(1024), 4);
+
+	std::vector<MipChange> changes;
+	policy.BeginFrame();
+	policy.RequestScreenSize(near, 1024);
+	policy.RequestScreenSize(far, 256);
+	policy.Update(changes);
+	Apply(policy, changes);
+	CHECK(policy.GetResidentBytes() <= budget);
+	CHECK(policy.GetResidentMip(near) < 4 && policy.GetResidentMip(far) < 4);
+	CHECK(policy.GetResidentMip(near) < policy.GetResidentMip(far));
+
+	// Over budget streams out straight away, no delay
+	policy.SetBudget(BytesFromMip(1024, 4) * 2);
+	policy.BeginFrame();
+	policy.RequestScreenSize(near, 1024);
+	policy.RequestScreenSize(far, 256);
+	policy.Update(changes);
+	Apply(policy, changes);
+	CHECK(policy.GetResidentBytes() <= policy.GetBudget());
+}
+
+// The largest texture on screen doesn't fit the room that's
+// left (an old one is still waiting out its stream out delay),
+// but a smaller one does - it shouldn't wait behind it
+static void TestSmallerStillStreamsIn() {
+	size_t budget = BytesFromMip(1024, 0) + BytesFromMip(1024, 4) + BytesFromMip(256, 0);
+	MipStreamingPolicy policy(budget, 30, 1);
+	int old = policy.AddTexture(1024, MipBytes(1024), 0);
+	int large = policy.AddTexture(1024, MipBytes(1024), 4);
+	int little = policy.AddTexture(256, MipBytes(256), 2);
+
+	std::vector<MipChange> changes;
+	policy.BeginFrame();
+	policy.RequestScreenSize(large, 1024);
+	policy.RequestScreenSize(little, 256);
+	policy.Update(changes);
+	CHECK(changes.size() == 1);
+	CHECK(!changes.empty() && changes[0].TextureID == little && changes[0].TopMip == 0);
+	CHECK(policy.GetResidentMip(old) == 0);
+}
+
+struct TraceFrame {
+	std::vector<std::pair<int, float>> Requests;
+};
+
+struct ReplayReport {
+	int Changes;
+	int Reversals;			// A texture streaming the other way from its last change
+	int StarvedFrames;		// Frames with something on screen below the detail it wanted
+	size_t PeakBytes;
+	size_t StreamedInBytes;
+	bool StayedInBudget;
+};
+
+static ReplayReport Replay(const std::vector<TraceFrame>& trace, int textureCount, uint32_t width, size_t budget) {
+	MipStreamingPolicy policy(budget, 30, 1);
+	for (int i = 0; i < textureCount; i++)
+		policy.AddTexture(width, MipBytes(width), (int)MipBytes(width).size() - 1);
+
+	ReplayReport report = { 0, 0, 0, 0, 0, true };
+	std::vector<int> lastDirection(textureCount, 0);
+	std::vector<MipChange> changes;
+	for (size_t f = 0; f < trace.size(); f++) {
+		policy.BeginFrame();
+		for (size_t r = 0; r < trace[f].Requests.size(); r++)
+			policy.RequestScreenSize(trace[f].Requests[r].first, trace[f].Requests[r].second);
+		policy.Update(changes);
+
+		for (size_t c = 0; c < changes.size(); c++) {
+			int id = changes[c].TextureID;
+			int resident = policy.GetResidentMip(id);
+			int direction = changes[c].TopMip < resident ? 1 : -1;
+			if (direction > 0)
+				report.StreamedInBytes += BytesFromMip(width, changes[c].TopMip) - BytesFromMip(width, resident);
+			if (lastDirection[id] != 0 && lastDirection[id] != direction)
+				report.Reversals++;
+			lastDirection[id] = direction;
+			report.Changes++;
+		}
+		Apply(policy, changes);
+
+		size_t resident = policy.GetResidentBytes();
+		report.PeakBytes = resident > report.PeakBytes ? resident : report.PeakBytes;
+		if (resident > budget)
+			report.StayedInBudget = false;
+
+		for (size_t r = 0; r < trace[f].Requests.size(); r++) {
+			int id = trace[f].Requests[r].first;
+			float wanted = log2f(width / trace[f].Requests[r].second);
+			if (policy.GetResidentMip(id) > wanted + 1.5f) {
+				report.StarvedFrames++;
+				break;
+			}
+		}
+	}
+	return report;
+}
+
+// A camera flying along a row of textured platforms and back,
+// with a little jitter in how large each one looks
+static std::vector<TraceFrame> FlyBy(int textureCount, int frames) {
+	std::vector<TraceFrame> trace(frames);
+	uint32_t seed = 1;
+	for (int f = 0; f < frames; f++) {
+		float t = (float)f / frames;
+		float camera = (t < 0.5f ? t * 2 : 2 - t * 2) * textureCount * 10.0f;
+		for (int i = 0; i < textureCount; i++) {
+			float distance = fabsf(i * 10.0f - camera) + 1.0f;
+			if (distance > 40.0f)
+				continue;
+			seed = seed * 1664525 + 1013904223;
+			float jitter = 1.0f + ((seed >> 8) / 16777216.0f - 0.5f) * 0.04f;
+			trace[f].Requests.push_back(std::make_pair(i, 2048.0f / distance * jitter));
+		}
+	}
+	return trace;
+}
+
+static bool LoadTrace(const char* path, std::vector<TraceFrame>& trace, int& textureCount) {
+	std::ifstream file(path);
+	if (!file)
+		return false;
+	int frame, texture;
+	float pixels;
+	textureCount = 0;
+	while (file >> frame >> texture >> pixels) {
+		if (frame < 0 || texture < 0)
+			return false;
+		if ((size_t)frame >= trace.size())
+			trace.resize(frame + 1);
+		trace[frame].Requests.push_back(std::make_pair(texture, pixels));
+		textureCount = texture + 1 > textureCount ? texture + 1 : textureCount;
+	}
+	return !trace.empty();
+}
+
+int main(int argc, char** argv) {
+	TestChooseAndHysteresis();
+	TestBudget();
+	TestSmallerStillStreamsIn();
+
+	const uint32_t width = 1024;
+	std::vector<TraceFrame> trace;
+	int textureCount = 20;
+	if (argc > 1) {
+		CHECK(LoadTrace(argv[1], trace, textureCount));
+	} else {
+		trace = FlyBy(textureCount, 3000);
+	}
+
+	printf("%-10s %8s %10s %8s %10s %12s\n", "budget KB", "changes", "reversals", "starved", "peak KB", "streamed KB");
+	const size_t budgets[] = { 512 << 10, 1024 << 10, 2048 << 10 };
+	for (int b = 0; b < 3; b++) {
+		auto start = std::chrono::steady_clock::now();
+		ReplayReport report = Replay(trace, textureCount, width, budgets[b]);
+		double milliseconds = ElapsedMilliseconds(start);
+		CHECK(report.StayedInBudget);
+		CHECK(report.Reversals * 4 <= report.Changes);
+		printf("%-10zu %8d %10d %8d %10zu %12zu  (%.2f us/frame)\n", budgets[b] >> 10, report.Changes, report.Reversals,
+			report.StarvedFrames, report.PeakBytes >> 10, report.StreamedInBytes >> 10, milliseconds * 1000.0 / trace.size());
+	}
+	return TestResult("MipStreamingPolicyTest");
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+// --------------------------------------------------------
+// Just enough of d3d11.h for the tests to build the D3D side
+// classes that only pass D3D objects through.  Every interface
+// is an empty struct; the tests supply the few functions those
+// classes call (CreateRenderTarget and so on) themselves.
+// --------------------------------------------------------
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct ID3D11Device {};
+struct ID3D11DeviceContext {};
+struct ID3D11Texture2D {};
+struct ID3D11RenderTargetView {};
+struct ID3D11ShaderResourceView {};
+struct ID3D11DepthStencilView {};
+
+enum DXGI_FORMAT {
+	DXGI_FORMAT_UNKNOWN = 0,
+	DXGI_FORMAT_R32G32B32A32_FLOAT = 2,
+	DXGI_FORMAT_R16G16B16A16_FLOAT = 10,
+	DXGI_FORMAT_R32G32_FLOAT = 16,
+	DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+	DXGI_FORMAT_R32_TYPELESS = 39,
+	DXGI_FORMAT_D24_UNORM_S8_UINT = 45,
+};
+
+enum {
+	D3D11_BIND_SHADER_RESOURCE = 0x8,
+	D3D11_BIND_RENDER_TARGET = 0x20,
+	D3D11_BIND_DEPTH_STENCIL = 0x40,
+};
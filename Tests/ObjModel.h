@@ -0,0 +1,67 @@
+#pragma once
+
+// --------------------------------------------------------
+// Loads the bundled models for the mesh tests: just enough
+// OBJ for the files in Debug/Models (positions, UVs, normals,
+// triangle and quad faces written v/vt/vn), flipped to left
+// handed the way Mesh does, then welded like Mesh does.
+// Vertices are position, normal, UV - 8 floats.
+// --------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "MeshSimplifier.h"
+
+static const int ObjVertexFloats = 8;
+
+inline bool LoadObj(const char* path, std::vector<float>& vertices, std::vector<unsigned int>& indices) {
+	vertices.clear();
+	indices.clear();
+
+	FILE* file = fopen(path, "r");
+	if (!file)
+		return false;
+
+	std::vector<float> positions, normals, uvs;
+	char line[256];
+	while (fgets(line, sizeof(line), file)) {
+		float x, y, z;
+		if (strncmp(line, "vn ", 3) == 0 && sscanf(line, "vn %f %f %f", &x, &y, &z) == 3) {
+			normals.push_back(x); normals.push_back(y); normals.push_back(-z);
+		} else if (strncmp(line, "vt ", 3) == 0 && sscanf(line, "vt %f %f", &x, &y) == 2) {
+			uvs.push_back(x); uvs.push_back(1.0f - y);
+		} else if (strncmp(line, "v ", 2) == 0 && sscanf(line, "v %f %f %f", &x, &y, &z) == 3) {
+			positions.push_back(x); positions.push_back(y); positions.push_back(-z);
+		} else if (strncmp(line, "f ", 2) == 0) {
+			unsigned int i[12];
+			int read = sscanf(line, "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u",
+				&i[0], &i[1], &i[2], &i[3], &i[4], &i[5], &i[6], &i[7], &i[8], &i[9], &i[10], &i[11]);
+			if (read != 9 && read != 12)
+				continue;
+
+			// Winding flipped along with z
+			const int triangles[2][3] = { { 0, 2, 1 }, { 0, 3, 2 } };
+			for (int t = 0; t < (read == 12 ? 2 : 1); t++) {
+				for (int c = 0; c < 3; c++) {
+					const unsigned int* corner = i + triangles[t][c] * 3;
+					if (corner[0] > positions.size() / 3 || corner[1] > uvs.size() / 2 || corner[2] > normals.size() / 3 ||
+						corner[0] == 0 || corner[1] == 0 || corner[2] == 0) {
+						fclose(file);
+						return false;
+					}
+					indices.push_back((unsigned int)(vertices.size() / ObjVertexFloats));
+					vertices.insert(vertices.end(), &positions[(corner[0] - 1) * 3], &positions[(corner[0] - 1) * 3] + 3);
+					vertices.insert(vertices.end(), &normals[(corner[2] - 1) * 3], &normals[(corner[2] - 1) * 3] + 3);
+					vertices.insert(vertices.end(), &uvs[(corner[1] - 1) * 2], &uvs[(corner[1] - 1) * 2] + 2);
+				}
+			}
+		}
+	}
+	fclose(file);
+
+	int count = WeldVertices(vertices.data(), ObjVertexFloats, (int)(vertices.size() / ObjVertexFloats),
+		ObjVertexFloats, indices.data(), (int)indices.size());
+	vertices.resize(count * ObjVertexFloats);
+	return !indices.empty();
+}
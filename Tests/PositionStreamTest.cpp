@@ -0,0 +1,103 @@
+// Position stream: every bundled model's depth only stream
+// draws the same triangles from the same positions, in the
+// same order, with each distinct position stored once.  Then
+// how many bytes the depth passes fetch per model, from the
+// full Vertex buffer and from the position stream.
+//
+//   g++ -std=c++14 -O2 -I.. PositionStreamTest.cpp ../PositionStream.cpp ../MeshOptimizer.cpp ../MeshSimplifier.cpp -o PositionStreamTest && ./PositionStreamTest
+
+#include "TestCommon.h"
+#include "PositionStream.h"
+#include "ObjModel.h"
+#include <array>
+#include <set>
+#include <string>
+
+// What the depth passes bound before: a whole Vertex
+static const int VertexBytes = 44;
+static const int PositionBytes = 12;
+
+static void TestModels() {
+	const char* names[] = { "cube.obj", "cone.obj", "cylinder.obj", "sphere.obj", "torus.obj", "helix.obj" };
+	printf("Model         Verts  Positions  Vertex bytes -> positions   Saved\n");
+	for (const char* name : names) {
+		std::vector<float> vertices;
+		std::vector<unsigned int> indices;
+		std::string path = std::string("../Debug/Models/") + name;
+		CHECK(LoadObj(path.c_str(), vertices, indices));
+		if (indices.empty())
+			continue;
+
+		int vertexCount = (int)(vertices.size() / ObjVertexFloats);
+		int indexCount = (int)indices.size();
+		std::vector<float> positions;
+		std::vector<unsigned int> positionIndices;
+		int positionCount = BuildPositionStream(vertices.data(), ObjVertexFloats, vertexCount, indices.data(), indexCount, positions, positionIndices);
+		CHECK((int)positions.size() == positionCount * 3);
+		CHECK((int)positionIndices.size() == indexCount);
+
+		// Same corners, same order
+		int mismatches = 0;
+		for (int i = 0; i < indexCount; i++) {
+			CHECK(positionIndices[i] < (unsigned int)positionCount);
+			if (positionIndices[i] >= (unsigned int)positionCount)
+				break;
+			const float* original = &vertices[indices[i] * ObjVertexFloats];
+			const float* position = &positions[positionIndices[i] * 3];
+			if (original[0] != position[0] || original[1] != position[1] || original[2] != position[2])
+				mismatches++;
+		}
+		CHECK(mismatches == 0);
+
+		// No more positions than there are different ones, and
+		// each one is used, first use first
+		std::set<std::array<float, 3>> unique;
+		for (int i = 0; i < indexCount; i++) {
+			const float* original = &vertices[indices[i] * ObjVertexFloats];
+			unique.insert({ { original[0], original[1], original[2] } });
+		}
+		CHECK(positionCount <= (int)unique.size());
+		CHECK(positionCount <= vertexCount);
+		unsigned int next = 0;
+		for (int i = 0; i < indexCount; i++) {
+			CHECK(positionIndices[i] <= next);
+			if (positionIndices[i] == next)
+				next++;
+		}
+		CHECK((int)next == positionCount);
+
+		int before = vertexCount * VertexBytes;
+		int after = positionCount * PositionBytes;
+		printf("%-12s %6d  %9d  %12d -> %9d  %6d (%.0f%%)\n",
+			name, vertexCount, positionCount, before, after, before - after, 100.0 * (before - after) / before);
+	}
+}
+
+// Welding is exact - positions a hair apart stay apart - and
+// an empty mesh is fine
+static void TestEdgeCases() {
+	float quad[] = {
+		0.0f, 0.0f, 0.0f, 1.0f,
+		1.0f, 0.0f, 0.0f, 2.0f,
+		0.0f, 1.0f, 0.0f, 3.0f,
+		1.0f, 0.0f, 0.0f, 4.0f,
+		1.0f, 1.0f, 0.0f, 5.0f,
+		0.0f, 1.0f + 1e-6f, 0.0f, 6.0f,
+	};
+	unsigned int indices[] = { 0, 1, 2, 3, 4, 5 };
+	std::vector<float> positions;
+	std::vector<unsigned int> positionIndices;
+	int count = BuildPositionStream(quad, 4, 6, indices, 6, positions, positionIndices);
+	CHECK(count == 5);
+	CHECK(positionIndices[3] == positionIndices[1]);
+	CHECK(positionIndices[5] != positionIndices[2]);
+
+	count = BuildPositionStream(quad, 4, 0, indices, 0, positions, positionIndices);
+	CHECK(count == 0 && positions.empty() && positionIndices.empty());
+}
+
+int main() {
+	TestEdgeCases();
+	TestModels();
+	return TestResult("PositionStreamTest");
+}
@@ -0,0 +1,153 @@
+// Render target pool: reuse by key, aging, trimming, and a
+// failed creation coming back as null.  Builds against the mock
+// d3d11.h, with CreateRenderTarget faked below.
+//
+//   g++ -std=c++14 -O2 -I.. -IMock RenderTargetPoolTest.cpp ../RenderTargetPool.cpp -o RenderTargetPoolTest && ./RenderTargetPoolTest
+
+#include "TestCommon.h"
+#include "RenderTargetPool.h"
+
+static int liveTargets = 0;
+static int failNextCreates = 0;
+
+bool CreateRenderTarget(ID3D11Device* /*device*/, unsigned int width, unsigned int height, DXGI_FORMAT format, RenderTarget& target, unsigned int bindFlags) {
+	if (failNextCreates > 0) {
+		failNextCreates--;
+		return false;
+	}
+	target = RenderTarget();
+	target.Width = width;
+	target.Height = height;
+	target.Format = format;
+	target.BindFlags = bindFlags;
+	liveTargets++;
+	return true;
+}
+
+void ReleaseRenderTarget(RenderTarget& /*target*/) {
+	liveTargets--;
+}
+
+static void TestReuse() {
+	ID3D11Device device;
+	RenderTargetPool pool(&device, 10);
+
+	RenderTarget* a = pool.Acquire(640, 360, DXGI_FORMAT_R8G8B8A8_UNORM);
+	RenderTarget* b = pool.Acquire(640, 360, DXGI_FORMAT_R8G8B8A8_UNORM);
+	CHECK(a && b && a != b);		// Both in use, so two targets
+	CHECK(pool.GetCreatedCount() == 2);
+
+	// Same key comes back, a different size, format or bind flags doesn't
+	pool.Release(a);
+	CHECK(pool.Acquire(640, 360, DXGI_FORMAT_R8G8B8A8_UNORM) == a);
+	CHECK(pool.GetReusedCount() == 1);
+	pool.Release(a);
+	CHECK(pool.Acquire(320, 360, DXGI_FORMAT_R8G8B8A8_UNORM) != a);
+	CHECK(pool.Acquire(640, 360, DXGI_FORMAT_R16G16B16A16_FLOAT) != a);
+	RenderTarget* depth = pool.Acquire(640, 360, DXGI_FORMAT_R8G8B8A8_UNORM, D3D11_BIND_DEPTH_STENCIL);
+	CHECK(depth != a && depth->BindFlags == D3D11_BIND_DEPTH_STENCIL);
+	CHECK(pool.Acquire(640, 360, DXGI_FORMAT_R8G8B8A8_UNORM) == a);
+	CHECK(pool.GetCreatedCount() == 5);
+
+	// 640x360 RGBA8 twice, 320x360 RGBA8, 640x360 RGBA16F, and the depth one
+	size_t expected = 640 * 360 * 4 * 2 + 320 * 360 * 4 + 640 * 360 * 8 + 640 * 360 * 4;
+	CHECK(pool.GetPooledBytes() == expected);
+}
+
+static void TestAging() {
+	ID3D11Device device;
+	{
+		RenderTargetPool pool(&device, 3);
+		RenderTarget* kept = pool.Acquire(100, 100, DXGI_FORMAT_R8G8B8A8_UNORM);
+		RenderTarget* idle = pool.Acquire(200, 200, DXGI_FORMAT_R8G8B8A8_UNORM);
+		pool.Release(idle);
+		CHECK(liveTargets == 2);
+
+		// Idle for maxIdleFrames is still kept, one more and it goes
+		for (int i = 0; i < 3; i++)
+			pool.BeginFrame();
+		CHECK(liveTargets == 2);
+		pool.BeginFrame();
+		CHECK(liveTargets == 1);
+
+		// In use is never aged out
+		for (int i = 0; i < 10; i++)
+			pool.BeginFrame();
+		CHECK(liveTargets == 1);
+
+		// Asking for it again resets its age
+		pool.Release(kept);
+		pool.BeginFrame();
+		pool.BeginFrame();
+		CHECK(pool.Acquire(100, 100, DXGI_FORMAT_R8G8B8A8_UNORM) == kept);
+		pool.Release(kept);
+		pool.BeginFrame();
+		pool.BeginFrame();
+		CHECK(liveTargets == 1);
+
+		pool.Trim();
+		CHECK(liveTargets == 0);
+	}
+
+	// Whatever's left goes with the pool
+	{
+		RenderTargetPool pool(&device, 3);
+		pool.Acquire(100, 100, DXGI_FORMAT_R8G8B8A8_UNORM);
+		pool.Release(pool.Acquire(50, 50, DXGI_FORMAT_R8G8B8A8_UNORM));
+		CHECK(liveTargets == 2);
+	}
+	CHECK(liveTargets == 0);
+}
+
+static void TestFailedCreate() {
+	ID3D11Device device;
+	RenderTargetPool pool(&device, 3);
+
+	failNextCreates = 1;
+	CHECK(pool.Acquire(8192, 8192, DXGI_FORMAT_R32G32B32A32_FLOAT) == 0);
+	CHECK(pool.GetCreatedCount() == 0);
+	CHECK(pool.GetPooledBytes() == 0);
+
+	// The pool's fine afterwards
+	CHECK(pool.Acquire(64, 64, DXGI_FORMAT_R8G8B8A8_UNORM) != 0);
+	CHECK(pool.GetCreatedCount() == 1);
+}
+
+// Resizing the window back and forth, the way Game rebuilds its
+// frame graph targets: release everything, acquire the new set
+static void BenchmarkResize() {
+	ID3D11Device device;
+	RenderTargetPool pool(&device, 120);
+	const unsigned int sizes[][2] = { { 1280, 720 }, { 1920, 1080 }, { 1280, 720 }, { 1600, 900 }, { 1920, 1080 } };
+
+	std::vector<RenderTarget*> targets;
+	int rebuilds = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < 600; frame++) {
+		pool.BeginFrame();
+		if (frame % 20 != 0)
+			continue;
+
+		for (auto t : targets) pool.Release(t);
+		targets.clear();
+		unsigned int w = sizes[(frame / 20) % 5][0], h = sizes[(frame / 20) % 5][1];
+		targets.push_back(pool.Acquire(w, h, DXGI_FORMAT_R8G8B8A8_UNORM));
+		targets.push_back(pool.Acquire(w, h, DXGI_FORMAT_D24_UNORM_S8_UINT, D3D11_BIND_DEPTH_STENCIL));
+		for (unsigned int level = 1; level <= 5; level++)
+			targets.push_back(pool.Acquire(w >> level, h >> level, DXGI_FORMAT_R8G8B8A8_UNORM));
+		rebuilds++;
+	}
+	double milliseconds = ElapsedMilliseconds(start);
+	CHECK(pool.GetCreatedCount() == 3 * 7);		// One set per distinct size, then only reuse
+
+	printf("%d rebuilds: %d created, %d reused, %.1f MB pooled, %.3f ms\n", rebuilds, pool.GetCreatedCount(),
+		pool.GetReusedCount(), pool.GetPooledBytes() / 1048576.0, milliseconds);
+}
+
+int main() {
+	TestReuse();
+	TestAging();
+	TestFailedCreate();
+	BenchmarkResize();
+	return TestResult("RenderTargetPoolTest");
+}
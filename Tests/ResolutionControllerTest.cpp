@@ -0,0 +1,167 @@
+// Resolution controller: frame time traces through a simple GPU
+// bound model (frame time grows with the pixels drawn) to check
+// it settles, reacts to load and doesn't flip between steps.
+// Pass a file of frame times in seconds, one per line, to replay
+// a recorded trace instead - the scale changes are printed.
+//
+//   g++ -std=c++14 -O2 -I.. ResolutionControllerTest.cpp ../ResolutionController.cpp -o ResolutionControllerTest && ./ResolutionControllerTest [frametimes.txt]
+
+#include "TestCommon.h"
+#include "ResolutionController.h"
+#include <fstream>
+#include <math.h>
+#include <vector>
+
+const float Target = 1.0f / 60.0f;
+
+static uint32_t noiseSeed = 5;
+
+// +-amount, uniformly
+static float Noise(float amount) {
+	noiseSeed = noiseSeed * 1664525 + 1013904223;
+	return ((noiseSeed >> 8) / 16777216.0f * 2 - 1) * amount;
+}
+
+struct TraceResult {
+	int Changes;
+	int Reversals;			// Changes in the other direction from the last one
+	int LastChangeFrame;
+	int FramesOver;			// Frames slower than the target by more than 10%
+	float FinalScale;
+	float MeanFrameTime;
+};
+
+// gpuCost(frame) is the full resolution frame time, of which
+// fixed is spent whatever the scale
+template <typename Cost>
+static TraceResult RunModel(int frames, float fixed, Cost gpuCost) {
+	ResolutionController controller(Target);
+	TraceResult result = { 0, 0, -1, 0, 1.0f, 0.0f };
+	int lastDirection = 0;
+	float previousScale = controller.GetScale();
+	double total = 0;
+
+	for (int frame = 0; frame < frames; frame++) {
+		float scale = controller.GetScale();
+		float frameTime = fixed + (gpuCost(frame) - fixed) * scale * scale;
+		frameTime *= 1.0f + Noise(0.03f);
+		total += frameTime;
+		if (frameTime > Target * 1.1f)
+			result.FramesOver++;
+
+		if (controller.Update(frameTime)) {
+			int direction = controller.GetScale() > previousScale ? 1 : -1;
+			if (lastDirection != 0 && direction != lastDirection)
+				result.Reversals++;
+			lastDirection = direction;
+			previousScale = controller.GetScale();
+			result.Changes++;
+			result.LastChangeFrame = frame;
+		}
+	}
+	result.FinalScale = controller.GetScale();
+	result.MeanFrameTime = (float)(total / frames);
+	return result;
+}
+
+static void Report(const char* name, const TraceResult& r) {
+	printf("%-12s %7d %9d %11d %11d %7.4f %9.2f\n", name, r.Changes, r.Reversals, r.LastChangeFrame, r.FramesOver,
+		r.FinalScale, r.MeanFrameTime * 1000);
+}
+
+static void TestTraces() {
+	printf("%-12s %7s %9s %11s %11s %7s %9s\n", "trace", "changes", "reversals", "last change", "frames over", "scale", "mean ms");
+
+	// Plenty of headroom - never leaves full resolution
+	TraceResult light = RunModel(3000, 0.004f, [](int) { return 0.010f; });
+	CHECK(light.Changes == 0);
+	CHECK(light.FinalScale == 1.0f);
+	Report("light", light);
+
+	// Needs about 0.75 to hit 60 Hz - gets there, then stays
+	TraceResult heavy = RunModel(3000, 0.004f, [](int) { return 0.004f + 0.0127f / (0.75f * 0.75f); });
+	CHECK(heavy.FinalScale >= 0.6875f && heavy.FinalScale <= 0.8125f);
+	CHECK(heavy.LastChangeFrame < 1000);
+	CHECK(heavy.Reversals <= 1);
+	Report("heavy", heavy);
+
+	// Heavy section in the middle: drops quickly, comes back slowly
+	TraceResult spike = RunModel(4000, 0.004f, [](int frame) { return frame >= 1000 && frame < 2000 ? 0.030f : 0.010f; });
+	CHECK(spike.FinalScale == 1.0f);
+	CHECK(spike.Reversals == 1);
+	Report("spike", spike);
+
+	int dropFrame = -1;
+	{
+		ResolutionController controller(Target);
+		for (int frame = 0; frame < 300 && dropFrame < 0; frame++) {
+			float scale = controller.GetScale();
+			if (controller.Update(0.004f + 0.026f * scale * scale) && frame > 0)
+				dropFrame = frame;
+		}
+	}
+	CHECK(dropFrame > 0 && dropFrame < 40);
+
+	// Can't be met even at the lowest scale - bottoms out, no more
+	TraceResult hopeless = RunModel(3000, 0.020f, [](int) { return 0.040f; });
+	CHECK(hopeless.FinalScale == 0.5f);
+	CHECK(hopeless.Reversals == 0);
+	Report("hopeless", hopeless);
+
+	// Sitting just past a step boundary doesn't bounce between the two
+	TraceResult boundary = RunModel(6000, 0.004f, [](int) { return 0.004f + 0.0127f / (0.78f * 0.78f); });
+	CHECK(boundary.Reversals <= 1);
+	Report("boundary", boundary);
+}
+
+static void TestHitchesAndDeterminism() {
+	// One long frame in a light trace is clamped and averaged away
+	ResolutionController controller(Target);
+	int changes = 0;
+	for (int frame = 0; frame < 600; frame++)
+		changes += controller.Update(frame == 300 ? 0.5f : 0.010f) ? 1 : 0;
+	CHECK(changes == 0);
+
+	// The same numbers always give the same changes
+	std::vector<float> trace;
+	noiseSeed = 11;
+	for (int frame = 0; frame < 2000; frame++)
+		trace.push_back(0.018f + Noise(0.006f));
+	ResolutionController a(Target), b(Target);
+	bool same = true;
+	for (float t : trace)
+		same = same && a.Update(t) == b.Update(t) && a.GetScale() == b.GetScale();
+	CHECK(same);
+
+	// Reset goes back to full resolution with an empty history
+	a.Reset();
+	CHECK(a.GetScale() == 1.0f && a.GetAverageFrameTime() == 0.0f);
+}
+
+static void ReplayFile(const char* path) {
+	std::ifstream file(path);
+	CHECK(file.good());
+	ResolutionController controller(Target);
+	float frameTime;
+	int frame = 0;
+	while (file >> frameTime) {
+		if (controller.Update(frameTime))
+			printf("frame %d: scale %.4f (average %.2f ms)\n", frame, controller.GetScale(), controller.GetAverageFrameTime() * 1000);
+		frame++;
+	}
+	printf("%d frames, final scale %.4f\n", frame, controller.GetScale());
+}
+
+int main(int argc, char** argv) {
+	TestTraces();
+	TestHitchesAndDeterminism();
+	if (argc > 1)
+		ReplayFile(argv[1]);
+
+	ResolutionController controller(Target);
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < 1000000; i++)
+		controller.Update(0.016f + (i & 7) * 0.0005f);
+	printf("Update: %.1f ns\n", ElapsedMilliseconds(start) * 1e6 / 1000000);
+	return TestResult("ResolutionControllerTest");
+}
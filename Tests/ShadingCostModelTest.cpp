@@ -0,0 +1,324 @@
+// Shading cost model: the LESS, LESS_EQUAL and EQUAL tests
+// the pre-pass leans on, then stacks of opaque platforms where
+// the pre-pass must shade each covered pixel exactly once, a
+// fading platform that stays out of it, and random stacks
+// checked against counting every pixel by hand.  Prints both
+// counts for each scene, then how long a big estimate takes.
+//
+//   g++ -std=c++14 -O2 -pthread -I.. ShadingCostModelTest.cpp ../ShadingCostModel.cpp ../SoftwareRasterizer.cpp ../SoftwareShaders.cpp -o ShadingCostModelTest && ./ShadingCostModelTest
+
+#include "TestCommon.h"
+#include "ShadingCostModel.h"
+#include "SoftwareShaders.h"
+#include <string.h>
+#include <vector>
+
+const int Width = 128;
+const int Height = 96;
+
+// A screen aligned platform, in whole pixels, at one depth.
+// With identity matrices the positions are clip space.
+struct Platform {
+	int Left, Top, Right, Bottom;
+	float Depth;
+	bool Opaque;
+
+	std::vector<float> Positions;
+	std::vector<unsigned int> Indices;
+};
+
+static unsigned int seed = 1;
+
+static unsigned int RandomBits() {
+	seed = seed * 1664525 + 1013904223;
+	return seed;
+}
+
+static int RandomInt(int low, int high) {
+	return low + (int)((RandomBits() >> 8) % (unsigned int)(high - low + 1));
+}
+
+static void Identity(float m[16]) {
+	memset(m, 0, sizeof(float) * 16);
+	m[0] = m[5] = m[10] = m[15] = 1.0f;
+}
+
+static Platform MakePlatform(int left, int top, int right, int bottom, float depth, bool opaque = true) {
+	Platform platform = { left, top, right, bottom, depth, opaque, {}, {} };
+	float x0 = left * 2.0f / Width - 1.0f;
+	float x1 = right * 2.0f / Width - 1.0f;
+	float y0 = 1.0f - top * 2.0f / Height;
+	float y1 = 1.0f - bottom * 2.0f / Height;
+	float corners[] = {
+		x0, y0, depth,
+		x1, y0, depth,
+		x1, y1, depth,
+		x0, y1, depth,
+	};
+	platform.Positions.assign(corners, corners + 12);
+
+	// Clockwise on screen, so back face culling keeps them
+	unsigned int indices[] = { 0, 1, 2, 0, 2, 3 };
+	platform.Indices.assign(indices, indices + 6);
+	return platform;
+}
+
+static std::vector<ShadingCostDraw> MakeDraws(const std::vector<Platform>& platforms) {
+	std::vector<ShadingCostDraw> draws;
+	for (const Platform& platform : platforms) {
+		ShadingCostDraw draw = {};
+		draw.Positions = platform.Positions.data();
+		draw.PositionCount = 4;
+		draw.Indices = platform.Indices.data();
+		draw.IndexCount = 6;
+		Identity(draw.World);
+		draw.Opaque = platform.Opaque;
+		draws.push_back(draw);
+	}
+	return draws;
+}
+
+static ShadingCost Estimate(SoftwareRasterizer& rasterizer, const std::vector<Platform>& platforms) {
+	float view[16], projection[16];
+	Identity(view);
+	Identity(projection);
+	return EstimateShadingCost(rasterizer, Width, Height, view, projection, MakeDraws(platforms));
+}
+
+// What the model should come to, worked out pixel by pixel
+static ShadingCost Reference(const std::vector<Platform>& platforms) {
+	ShadingCost cost = {};
+	for (int y = 0; y < Height; y++) {
+		for (int x = 0; x < Width; x++) {
+			float depth = 1.0f;
+			float opaqueDepth = 1.0f;
+			for (const Platform& p : platforms) {
+				if (x < p.Left || x >= p.Right || y < p.Top || y >= p.Bottom)
+					continue;
+				if (p.Depth < depth) {
+					cost.Shaded++;
+					depth = p.Depth;
+				}
+				if (p.Opaque && p.Depth < opaqueDepth) {
+					cost.PrepassPixels++;
+					opaqueDepth = p.Depth;
+				}
+			}
+
+			// Opaque ones where they match the depth so far, see
+			// through ones where they're in front of it - and
+			// they write depth, hiding any opaque one behind
+			depth = opaqueDepth;
+			for (const Platform& p : platforms) {
+				if (x < p.Left || x >= p.Right || y < p.Top || y >= p.Bottom)
+					continue;
+				if (p.Opaque)
+					cost.ShadedWithPrepass += p.Depth == depth ? 1 : 0;
+				else if (p.Depth < depth) {
+					cost.ShadedWithPrepass++;
+					depth = p.Depth;
+				}
+			}
+		}
+	}
+	return cost;
+}
+
+static long long Covered(const std::vector<Platform>& platforms) {
+	long long covered = 0;
+	for (int y = 0; y < Height; y++) {
+		for (int x = 0; x < Width; x++) {
+			for (const Platform& p : platforms) {
+				if (x >= p.Left && x < p.Right && y >= p.Top && y < p.Bottom) {
+					covered++;
+					break;
+				}
+			}
+		}
+	}
+	return covered;
+}
+
+static void Report(const char* name, const ShadingCost& cost, long long covered) {
+	printf("%-28s covered %6lld  shaded %6lld  with pre-pass %6lld  (pre-pass wrote %6lld)\n",
+		name, covered, cost.Shaded, cost.ShadedWithPrepass, cost.PrepassPixels);
+}
+
+// --------------------------------------------------------
+// The depth tests, straight on the rasterizer: a platform
+// drawn again over its own depth passes EQUAL and LESS_EQUAL
+// everywhere and LESS nowhere; a nearer one passes all three
+// --------------------------------------------------------
+static void TestDepthFuncs(SoftwareRasterizer& rasterizer) {
+	SoftwareTarget target(Width, Height);
+	rasterizer.SetTarget(&target);
+
+	Platform platform = MakePlatform(10, 20, 74, 52, 0.5f);
+	Platform nearer = MakePlatform(10, 20, 74, 52, 0.25f);
+	Platform farther = MakePlatform(10, 20, 74, 52, 0.75f);
+	long long area = 64 * 32;
+
+	SoftwareShadowVertexShader transform;
+	Identity(transform.World);
+	Identity(transform.View);
+	Identity(transform.Projection);
+
+	SoftwareDrawState write = SoftwareDefaultState(0);
+	write.ColorWrite = false;
+
+	SoftwareDepthFunc funcs[] = { SoftwareDepthLess, SoftwareDepthLessEqual, SoftwareDepthEqual };
+	long long expectSame[] = { 0, area, area };
+	long long expectNearer[] = { area, area, 0 };
+	long long expectFarther[] = { 0, 0, 0 };
+	for (int f = 0; f < 3; f++) {
+		const Platform* second[] = { &platform, &nearer, &farther };
+		const long long* expected[] = { expectSame, expectNearer, expectFarther };
+		for (int s = 0; s < 3; s++) {
+			target.ClearDepth(1.0f);
+			rasterizer.DrawIndexed(write, platform.Positions.data(), 12, 4, platform.Indices.data(), 6, transform, SoftwarePixelShader());
+
+			SoftwareDrawState test = write;
+			test.DepthFunc = funcs[f];
+			test.DepthWrite = false;
+			rasterizer.ResetStats();
+			rasterizer.DrawIndexed(test, second[s]->Positions.data(), 12, 4, second[s]->Indices.data(), 6, transform, SoftwarePixelShader());
+			CHECK(rasterizer.GetStats().PixelsTested == area);
+			CHECK(rasterizer.GetStats().PixelsShaded == expected[s][f]);
+		}
+	}
+
+	// EQUAL with no depth written at all passes nothing but
+	// the far plane
+	target.ClearDepth(1.0f);
+	SoftwareDrawState equal = write;
+	equal.DepthFunc = SoftwareDepthEqual;
+	rasterizer.ResetStats();
+	rasterizer.DrawIndexed(equal, platform.Positions.data(), 12, 4, platform.Indices.data(), 6, transform, SoftwarePixelShader());
+	CHECK(rasterizer.GetStats().PixelsShaded == 0);
+
+	rasterizer.SetTarget(0);
+}
+
+// --------------------------------------------------------
+// Stacks of platforms
+// --------------------------------------------------------
+static void TestStacks(SoftwareRasterizer& rasterizer) {
+	// Back to front, the worst case: every platform is shaded
+	// in full without the pre-pass, each pixel once with it
+	std::vector<Platform> stack;
+	for (int i = 0; i < 6; i++)
+		stack.push_back(MakePlatform(8 + i * 6, 4 + i * 5, 120 - i * 4, 90 - i * 6, 0.9f - i * 0.1f));
+	long long covered = Covered(stack);
+	long long total = 0;
+	for (const Platform& p : stack)
+		total += (long long)(p.Right - p.Left) * (p.Bottom - p.Top);
+
+	ShadingCost backToFront = Estimate(rasterizer, stack);
+	CHECK(backToFront.Shaded == total);
+	CHECK(backToFront.ShadedWithPrepass == covered);
+	CHECK(backToFront.ShadedWithPrepass <= backToFront.Shaded);
+	CHECK(backToFront.PrepassPixels == total);
+	Report("Opaque stack, back to front", backToFront, covered);
+
+	// Front to back, the pre-pass has nothing left to save
+	std::vector<Platform> reversed(stack.rbegin(), stack.rend());
+	ShadingCost frontToBack = Estimate(rasterizer, reversed);
+	CHECK(frontToBack.Shaded == covered);
+	CHECK(frontToBack.ShadedWithPrepass == covered);
+	CHECK(frontToBack.PrepassPixels == covered);
+	Report("Opaque stack, front to back", frontToBack, covered);
+
+	// A fading platform in front blends over whatever is
+	// there, so it's shaded in full either way
+	std::vector<Platform> fading = stack;
+	fading.push_back(MakePlatform(0, 0, 64, 48, 0.05f, false));
+	long long fadingArea = 64 * 48;
+	ShadingCost withFade = Estimate(rasterizer, fading);
+	CHECK(withFade.Shaded == total + fadingArea);
+	CHECK(withFade.ShadedWithPrepass == covered + fadingArea);
+	CHECK(withFade.PrepassPixels == total);
+	Report("Opaque stack + fading front", withFade, Covered(fading));
+
+	// Behind the stack it only shows where nothing opaque is
+	std::vector<Platform> behind = stack;
+	behind.insert(behind.begin(), MakePlatform(0, 0, 128, 96, 0.95f, false));
+	ShadingCost withBehind = Estimate(rasterizer, behind);
+	CHECK(withBehind.ShadedWithPrepass == covered + (Width * Height - covered));
+	Report("Fading behind the stack", withBehind, Covered(behind));
+
+	// Two opaque platforms at the same depth both pass EQUAL
+	// where they overlap - the one case the pre-pass shades a
+	// pixel twice
+	std::vector<Platform> coplanar;
+	coplanar.push_back(MakePlatform(0, 0, 80, 60, 0.5f));
+	coplanar.push_back(MakePlatform(40, 30, 128, 96, 0.5f));
+	long long overlap = 40 * 30;
+	ShadingCost sameDepth = Estimate(rasterizer, coplanar);
+	CHECK(sameDepth.ShadedWithPrepass == Covered(coplanar) + overlap);
+	CHECK(sameDepth.Shaded == Covered(coplanar));
+	Report("Coplanar opaque pair", sameDepth, Covered(coplanar));
+}
+
+// Random stacks, opaque and fading, in any order, at depths
+// that never tie
+static void TestRandomStacks(SoftwareRasterizer& rasterizer) {
+	for (int round = 0; round < 40; round++) {
+		std::vector<Platform> platforms;
+		int count = RandomInt(1, 12);
+		for (int i = 0; i < count; i++) {
+			int left = RandomInt(0, Width - 2);
+			int top = RandomInt(0, Height - 2);
+			int right = RandomInt(left + 1, Width);
+			int bottom = RandomInt(top + 1, Height);
+			float depth = (RandomInt(0, 30) * 16 + i + 1) / 512.0f;
+			platforms.push_back(MakePlatform(left, top, right, bottom, depth, RandomInt(0, 3) != 0));
+		}
+
+		ShadingCost cost = Estimate(rasterizer, platforms);
+		ShadingCost expected = Reference(platforms);
+		CHECK(cost.Shaded == expected.Shaded);
+		CHECK(cost.ShadedWithPrepass == expected.ShadedWithPrepass);
+		CHECK(cost.PrepassPixels == expected.PrepassPixels);
+
+		// All opaque, every covered pixel is shaded exactly once
+		std::vector<Platform> opaque = platforms;
+		for (Platform& p : opaque)
+			p.Opaque = true;
+		ShadingCost opaqueCost = Estimate(rasterizer, opaque);
+		CHECK(opaqueCost.ShadedWithPrepass == Covered(opaque));
+		CHECK(opaqueCost.ShadedWithPrepass <= opaqueCost.Shaded);
+	}
+}
+
+// --------------------------------------------------------
+// Time for a crowded frame
+// --------------------------------------------------------
+static void Benchmark(SoftwareRasterizer& rasterizer) {
+	std::vector<Platform> platforms;
+	for (int i = 0; i < 200; i++) {
+		int left = RandomInt(0, Width - 2);
+		int top = RandomInt(0, Height - 2);
+		float depth = (RandomInt(0, 49) * 256 + i + 1) / 16384.0f;
+		platforms.push_back(MakePlatform(left, top, RandomInt(left + 1, Width), RandomInt(top + 1, Height), depth));
+	}
+
+	const int runs = 20;
+	ShadingCost cost = {};
+	auto start = std::chrono::steady_clock::now();
+	for (int run = 0; run < runs; run++)
+		cost = Estimate(rasterizer, platforms);
+	double milliseconds = ElapsedMilliseconds(start) / runs;
+	CHECK(cost.ShadedWithPrepass == Covered(platforms));
+	Report("200 random opaque", cost, Covered(platforms));
+	printf("EstimateShadingCost: %.2f ms for 200 draws at %dx%d on %d threads\n",
+		milliseconds, Width, Height, rasterizer.GetThreadCount());
+}
+
+int main() {
+	SoftwareRasterizer rasterizer;
+	TestDepthFuncs(rasterizer);
+	TestStacks(rasterizer);
+	TestRandomStacks(rasterizer);
+	Benchmark(rasterizer);
+	return TestResult("ShadingCostModelTest");
+}
@@ -0,0 +1,217 @@
+// Shadow cascades: split schemes, every slice of the frustum
+// landing inside its cascade, and the two things that keep
+// edges from shimmering - a radius that doesn't change as the
+// camera turns, and a center that moves in whole texels.
+//
+//   g++ -std=c++14 -O2 -I.. ShadowCascadesTest.cpp ../ShadowCascades.cpp -o ShadowCascadesTest && ./ShadowCascadesTest
+
+#include "TestCommon.h"
+#include "ShadowCascades.h"
+#include <math.h>
+
+// Row vector times matrix, like XMVector3TransformCoord
+static void Transform(const float m[16], const float p[3], float out[3]) {
+	float w = p[0] * m[3] + p[1] * m[7] + p[2] * m[11] + m[15];
+	for (int c = 0; c < 3; c++)
+		out[c] = (p[0] * m[c] + p[1] * m[4 + c] + p[2] * m[8 + c] + m[12 + c]) / w;
+}
+
+static ShadowCameraDesc MakeCamera(float yaw, float pitch, float x, float z) {
+	ShadowCameraDesc camera = {};
+	camera.Position[0] = x;
+	camera.Position[1] = 2.0f;
+	camera.Position[2] = z;
+	camera.Forward[0] = sinf(yaw) * cosf(pitch);
+	camera.Forward[1] = sinf(pitch);
+	camera.Forward[2] = cosf(yaw) * cosf(pitch);
+	camera.Up[1] = 1.0f;
+	camera.FieldOfView = 0.25f * 3.1415926535f;
+	camera.AspectRatio = 16.0f / 9.0f;
+	camera.NearClip = 0.1f;
+	camera.FarClip = 60.0f;
+	return camera;
+}
+
+static ShadowCascadeSettings MakeSettings() {
+	ShadowCascadeSettings settings = {};
+	settings.CascadeCount = 4;
+	settings.SplitLambda = 0.8f;
+	settings.MapSize = 1024;
+	settings.CasterDistance = 20.0f;
+	return settings;
+}
+
+static const float lightDirection[3] = { 0.3f, -1.0f, 0.4f };
+
+// The eight corners of the frustum between two view depths
+static void SliceCorners(const ShadowCameraDesc& camera, float n, float f, float corners[8][3]) {
+	float forward[3] = { camera.Forward[0], camera.Forward[1], camera.Forward[2] };
+	float length = sqrtf(forward[0] * forward[0] + forward[1] * forward[1] + forward[2] * forward[2]);
+	for (int c = 0; c < 3; c++)
+		forward[c] /= length;
+	float right[3] = { camera.Up[1] * forward[2] - camera.Up[2] * forward[1], camera.Up[2] * forward[0] - camera.Up[0] * forward[2],
+		camera.Up[0] * forward[1] - camera.Up[1] * forward[0] };
+	length = sqrtf(right[0] * right[0] + right[1] * right[1] + right[2] * right[2]);
+	for (int c = 0; c < 3; c++)
+		right[c] /= length;
+	float up[3] = { forward[1] * right[2] - forward[2] * right[1], forward[2] * right[0] - forward[0] * right[2],
+		forward[0] * right[1] - forward[1] * right[0] };
+
+	float tanHalf = tanf(camera.FieldOfView * 0.5f);
+	for (int i = 0; i < 8; i++) {
+		float depth = i < 4 ? n : f;
+		float sx = (i & 1) ? 1.0f : -1.0f;
+		float sy = (i & 2) ? 1.0f : -1.0f;
+		for (int c = 0; c < 3; c++) {
+			corners[i][c] = camera.Position[c] + forward[c] * depth + right[c] * sx * depth * tanHalf * camera.AspectRatio +
+				up[c] * sy * depth * tanHalf;
+		}
+	}
+}
+
+static void TestSplits() {
+	float splits[MaxShadowCascades + 1];
+	ComputeCascadeSplits(1.0f, 100.0f, 4, 0.0f, splits);
+	CHECK(fabsf(splits[1] - 25.75f) < 1e-4f && fabsf(splits[2] - 50.5f) < 1e-4f);
+	ComputeCascadeSplits(1.0f, 100.0f, 4, 1.0f, splits);
+	CHECK(fabsf(splits[2] - 10.0f) < 1e-4f);		// Log splits are geometric
+	CHECK(splits[0] == 1.0f && splits[4] == 100.0f);
+
+	ComputeCascadeSplits(0.1f, 60.0f, 4, 0.8f, splits);
+	for (int i = 0; i < 4; i++)
+		CHECK(splits[i] < splits[i + 1]);
+	ComputeCascadeSplits(0.1f, 60.0f, 1, 0.8f, splits);
+	CHECK(splits[0] == 0.1f && splits[1] == 60.0f);
+}
+
+static void TestSlicesInsideCascades() {
+	ShadowCascadeSettings settings = MakeSettings();
+	ShadowCascade cascades[MaxShadowCascades];
+	int failures = 0;
+	float tightest = 0;
+
+	for (int view = 0; view < 200; view++) {
+		ShadowCameraDesc camera = MakeCamera(view * 0.37f, sinf(view * 0.11f) * 0.8f, view * 0.9f - 50.0f, view * 0.3f);
+		CHECK(FitShadowCascades(camera, lightDirection, settings, cascades) == 4);
+
+		for (int i = 0; i < 4; i++) {
+			float corners[8][3];
+			SliceCorners(camera, cascades[i].SplitNear, cascades[i].SplitFar, corners);
+			for (int k = 0; k < 8; k++) {
+				float clip[3];
+				Transform(cascades[i].ViewProjection, corners[k], clip);
+				bool inside = fabsf(clip[0]) <= 1.0f && fabsf(clip[1]) <= 1.0f && clip[2] >= 0.0f && clip[2] <= 1.0f;
+				failures += inside ? 0 : 1;
+				tightest = fmaxf(tightest, fmaxf(fabsf(clip[0]), fabsf(clip[1])));
+			}
+		}
+	}
+	CHECK(failures == 0);
+	CHECK(tightest > 0.7f);		// The sphere isn't much bigger than the slice
+	printf("slices: every corner inside its cascade, furthest at %.3f of the map's half width\n", tightest);
+}
+
+static void TestStability() {
+	ShadowCascadeSettings settings = MakeSettings();
+	ShadowCascade first[MaxShadowCascades], other[MaxShadowCascades];
+
+	// Turning on the spot leaves every radius as it was
+	FitShadowCascades(MakeCamera(0.0f, 0.0f, 0.0f, 0.0f), lightDirection, settings, first);
+	bool sameRadius = true;
+	for (int view = 1; view < 100; view++) {
+		FitShadowCascades(MakeCamera(view * 0.063f, (view % 7) * 0.1f - 0.3f, 0.0f, 0.0f), lightDirection, settings, other);
+		for (int i = 0; i < 4; i++)
+			sameRadius = sameRadius && other[i].Radius == first[i].Radius;
+	}
+	CHECK(sameRadius);
+
+	// Moving a little at a time, a fixed point in the world always
+	// lands at the same spot within a texel of the map
+	float world[3] = { 3.3f, 0.0f, 7.1f };
+	float firstFraction[MaxShadowCascades];
+	float largestDrift = 0;
+	for (int step = 0; step < 200; step++) {
+		FitShadowCascades(MakeCamera(0.2f, -0.1f, step * 0.013f, step * 0.007f), lightDirection, settings, other);
+		for (int i = 0; i < 4; i++) {
+			float clip[3];
+			Transform(other[i].ViewProjection, world, clip);
+			float texel = (clip[0] * 0.5f + 0.5f) * settings.MapSize;
+			float fraction = texel - floorf(texel);
+			if (step == 0)
+				firstFraction[i] = fraction;
+			float drift = fabsf(fraction - firstFraction[i]);
+			largestDrift = fmaxf(largestDrift, fminf(drift, 1.0f - drift));
+		}
+	}
+	CHECK(largestDrift < 0.01f);
+	printf("moving camera: sub-texel drift of a fixed point %.5f texels\n", largestDrift);
+}
+
+static void TestTouchesSphere() {
+	ShadowCascadeSettings settings = MakeSettings();
+	ShadowCascade cascades[MaxShadowCascades];
+	FitShadowCascades(MakeCamera(0.0f, 0.0f, 0.0f, 0.0f), lightDirection, settings, cascades);
+	const ShadowCascade& c = cascades[1];
+
+	CHECK(ShadowCascadeTouchesSphere(c, c.Center, 0.5f));
+
+	// Well off to the side
+	float side[3] = { c.Center[0] + 200.0f, c.Center[1], c.Center[2] };
+	CHECK(!ShadowCascadeTouchesSphere(c, side, 1.0f));
+
+	// Between the light and the cascade still casts into it
+	float length = sqrtf(lightDirection[0] * lightDirection[0] + lightDirection[1] * lightDirection[1] + lightDirection[2] * lightDirection[2]);
+	float towardLight[3], beyond[3];
+	for (int k = 0; k < 3; k++) {
+		towardLight[k] = c.Center[k] - lightDirection[k] / length * (c.Radius + 100.0f);
+		beyond[k] = c.Center[k] + lightDirection[k] / length * (c.Radius * 2 + settings.CasterDistance + 10.0f);
+	}
+	CHECK(ShadowCascadeTouchesSphere(c, towardLight, 1.0f));
+	CHECK(!ShadowCascadeTouchesSphere(c, beyond, 1.0f));
+}
+
+static void TestConstantsAndLimits() {
+	ShadowCascadeSettings settings = MakeSettings();
+	ShadowCascade cascades[MaxShadowCascades];
+	ShadowCameraDesc camera = MakeCamera(0.0f, 0.0f, 0.0f, 0.0f);
+	FitShadowCascades(camera, lightDirection, settings, cascades);
+
+	ShadowCascadeConstants constants;
+	BuildShadowCascadeConstants(cascades, 3, constants);
+	CHECK(constants.Count == 3);
+	CHECK(constants.ViewProjection[2][1 * 4 + 3] == cascades[2].ViewProjection[3 * 4 + 1]);
+	CHECK(constants.Splits[2] == cascades[2].SplitFar);
+	CHECK(constants.Splits[3] == 0.0f);
+
+	settings.CascadeCount = 0;
+	CHECK(FitShadowCascades(camera, lightDirection, settings, cascades) == 0);
+	settings.CascadeCount = MaxShadowCascades + 1;
+	CHECK(FitShadowCascades(camera, lightDirection, settings, cascades) == 0);
+	settings.CascadeCount = 2;
+	float noLight[3] = { 0, 0, 0 };
+	CHECK(FitShadowCascades(camera, noLight, settings, cascades) == 0);
+
+	// Light straight down still has a basis
+	float down[3] = { 0, -1, 0 };
+	CHECK(FitShadowCascades(camera, down, settings, cascades) == 2);
+	CHECK(cascades[0].View[0] == cascades[0].View[0]);		// Not NaN
+}
+
+int main() {
+	TestSplits();
+	TestSlicesInsideCascades();
+	TestStability();
+	TestTouchesSphere();
+	TestConstantsAndLimits();
+
+	ShadowCascadeSettings settings = MakeSettings();
+	ShadowCascade cascades[MaxShadowCascades];
+	float sink = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < 100000; i++) {
+		FitShadowCascades(MakeCamera(i * 0.001f, 0.0f, i * 0.01f, 0.0f), lightDirection, settings, cascades);
+		sink += cascades[3].Center[0];
+	}
+	printf("FitShadowCascades (4 cascades): %.0f ns%s\n", ElapsedMilliseconds(start) * 1e6 / 100000, sink == 1e30f ? " " : "");
+	return TestResult("ShadowCascadesTest");
+}
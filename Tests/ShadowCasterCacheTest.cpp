@@ -0,0 +1,263 @@
+// Shadow caster cache: replays Game::RenderShadowMap against a
+// mock context whose depth targets record what was drawn into
+// them, with which matrices, and checks every frame's shadow map
+// holds exactly what drawing every caster from scratch would.
+//
+//   g++ -std=c++14 -O2 -I.. ShadowCasterCacheTest.cpp ../ShadowCasterCache.cpp ../ShadowCascades.cpp -o ShadowCasterCacheTest && ./ShadowCasterCacheTest
+
+#include "TestCommon.h"
+#include "ShadowCasterCache.h"
+#include <math.h>
+#include <set>
+#include <string.h>
+
+// One caster as it landed in a depth target: which one, where it
+// was and which cascade matrices it was drawn with
+struct DrawRecord {
+	int Caster;
+	int Pose;
+	int Fit;
+
+	bool operator<(const DrawRecord& other) const {
+		if (Caster != other.Caster) return Caster < other.Caster;
+		if (Pose != other.Pose) return Pose < other.Pose;
+		return Fit < other.Fit;
+	}
+	bool operator==(const DrawRecord& other) const {
+		return Caster == other.Caster && Pose == other.Pose && Fit == other.Fit;
+	}
+};
+
+typedef std::set<DrawRecord> DepthTarget;
+
+// Stands in for the device context: clears, draws and the copy
+// from the cache texture to the shadow map
+struct MockContext {
+	DepthTarget Cache[MaxShadowCascades];
+	DepthTarget Map[MaxShadowCascades];
+	int Draws = 0;
+	int Copies = 0;
+	int Clears = 0;
+
+	void Clear(DepthTarget& target) { target.clear(); Clears++; }
+	void Copy(int cascade) { Map[cascade] = Cache[cascade]; Copies++; }
+	void Draw(DepthTarget& target, int caster, int pose, int fit) {
+		DrawRecord record = { caster, pose, fit };
+		target.insert(record);
+		Draws++;
+	}
+};
+
+struct SceneCaster {
+	float Position[3];
+	float Radius;
+	int Pose;			// Bumped whenever it moves
+};
+
+static float World(const SceneCaster& caster, float world[16]) {
+	memset(world, 0, sizeof(float) * 16);
+	world[0] = world[5] = world[10] = world[15] = 1.0f;
+	world[12] = caster.Position[0];
+	world[13] = caster.Position[1];
+	world[14] = caster.Position[2];
+	return caster.Radius;
+}
+
+// Identifies a cascade's matrices, so a stale layer shows up as
+// records with an old fit
+static int FitId(const ShadowCascade& cascade) {
+	uint32_t hash = 2166136261u;
+	const uint8_t* bytes = (const uint8_t*)cascade.View;
+	for (size_t i = 0; i < sizeof(cascade.View) + sizeof(cascade.Projection); i++)
+		hash = (hash ^ (i < sizeof(cascade.View) ? bytes[i] : ((const uint8_t*)cascade.Projection)[i - sizeof(cascade.View)])) * 16777619u;
+	return (int)hash;
+}
+
+// Game::RenderShadowMap, minus the D3D
+static void RenderShadowMap(ShadowCasterCache& cache, MockContext& context, const std::vector<SceneCaster>& scene,
+	const ShadowCascade* cascades, int count) {
+	cache.BeginFrame();
+	for (int i = 0; i < (int)scene.size(); i++) {
+		float world[16];
+		float radius = World(scene[i], world);
+		cache.UpdateCaster(i, world, scene[i].Position, radius);
+	}
+
+	ShadowCascadePlan plan;
+	for (int c = 0; c < count; c++) {
+		cache.PlanCascade(c, cascades[c], plan);
+		int fit = FitId(cascades[c]);
+
+		if (plan.RebuildCache) {
+			context.Clear(context.Cache[c]);
+			for (int i : plan.StaticCasters)
+				context.Draw(context.Cache[c], i, scene[i].Pose, fit);
+		}
+
+		if (plan.UseCache)
+			context.Copy(c);
+		else
+			context.Clear(context.Map[c]);
+
+		for (int i : plan.DynamicCasters)
+			context.Draw(context.Map[c], i, scene[i].Pose, fit);
+	}
+}
+
+// What the map should hold: everything that can reach the
+// cascade, where it is now, drawn with this frame's matrices
+static DepthTarget Reference(const std::vector<SceneCaster>& scene, const ShadowCascade& cascade) {
+	DepthTarget target;
+	int fit = FitId(cascade);
+	for (int i = 0; i < (int)scene.size(); i++) {
+		if (ShadowCascadeTouchesSphere(cascade, scene[i].Position, scene[i].Radius)) {
+			DrawRecord record = { i, scene[i].Pose, fit };
+			target.insert(record);
+		}
+	}
+	return target;
+}
+
+static void Fit(float cameraX, float cameraZ, float yaw, ShadowCascade* cascades) {
+	ShadowCameraDesc camera = {};
+	camera.Position[0] = cameraX;
+	camera.Position[1] = 3.0f;
+	camera.Position[2] = cameraZ;
+	camera.Forward[0] = sinf(yaw);
+	camera.Forward[2] = cosf(yaw);
+	camera.Up[1] = 1.0f;
+	camera.FieldOfView = 0.785f;
+	camera.AspectRatio = 16.0f / 9.0f;
+	camera.NearClip = 0.1f;
+	camera.FarClip = 50.0f;
+
+	ShadowCascadeSettings settings = { 3, 0.8f, 1024, 20.0f };
+	const float light[3] = { 0.3f, -1.0f, 0.4f };
+	FitShadowCascades(camera, light, settings, cascades);
+}
+
+static void TestAgainstReference() {
+	const int cascadeCount = 3;
+	const int settle = 10;
+	ShadowCasterCache cache(settle);
+	MockContext context;
+
+	// A row of platforms, some of which move for a while and stop,
+	// one that moves all the time (the ball), and one that jumps
+	// now and then
+	std::vector<SceneCaster> scene;
+	for (int i = 0; i < 60; i++) {
+		SceneCaster caster = { { (float)(i % 6) * 4.0f - 10.0f, 0.0f, (float)(i / 6) * 8.0f }, 2.0f, 0 };
+		scene.push_back(caster);
+		cache.AddCaster();
+	}
+
+	int mismatches = 0;
+	int staleFits = 0;
+	int frames = 900;
+	int draws[3] = { 0, 0, 0 };
+	int naiveDraws[3] = { 0, 0, 0 };
+	for (int frame = 0; frame < frames; frame++) {
+		// Ball
+		scene[0].Position[1] = 1.0f + sinf(frame * 0.1f);
+		scene[0].Pose++;
+		// Platforms that slide in, then stop
+		for (int i = 10; i < 20; i++) {
+			if (frame < 40 + i * 5) {
+				scene[i].Position[0] += 0.05f;
+				scene[i].Pose++;
+			}
+		}
+		// One that teleports every 100 frames
+		if (frame % 100 == 50) {
+			scene[30].Position[2] += 5.0f;
+			scene[30].Pose++;
+		}
+
+		// Camera holds still, then follows along, then cuts to a
+		// new view and holds there
+		float cameraZ = frame < 300 ? 0.0f : (frame < 600 ? (frame - 300) * 0.05f : 30.0f);
+		float yaw = frame >= 600 ? 0.6f : 0.0f;
+		ShadowCascade cascades[MaxShadowCascades];
+		Fit(0.0f, cameraZ, yaw, cascades);
+
+		int drawsBefore = context.Draws;
+		RenderShadowMap(cache, context, scene, cascades, cascadeCount);
+		draws[frame / 300] += context.Draws - drawsBefore;
+
+		for (int c = 0; c < cascadeCount; c++) {
+			DepthTarget expected = Reference(scene, cascades[c]);
+			naiveDraws[frame / 300] += (int)expected.size();
+			if (context.Map[c] != expected)
+				mismatches++;
+			int fit = FitId(cascades[c]);
+			for (const DrawRecord& record : context.Map[c])
+				staleFits += record.Fit != fit ? 1 : 0;
+		}
+	}
+	CHECK(mismatches == 0);
+	CHECK(staleFits == 0);
+
+	// Only pays off while the cascades hold still - a moving camera
+	// shifts them by a texel most frames, and every shift is a rebuild
+	CHECK(draws[0] * 4 < naiveDraws[0]);
+	CHECK(draws[2] * 4 < naiveDraws[2]);
+	CHECK(draws[1] <= naiveDraws[1]);
+	const char* phases[] = { "still camera", "moving camera", "after a cut" };
+	for (int p = 0; p < 3; p++)
+		printf("%-14s %6.1f draws per frame, %6.1f drawing everything\n", phases[p], draws[p] / 300.0, naiveDraws[p] / 300.0);
+}
+
+static void TestStaticSet() {
+	ShadowCasterCache cache(3);
+	int a = cache.AddCaster();
+	float world[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+	float center[3] = { 0, 0, 0 };
+
+	// First sighting never counts as still
+	cache.UpdateCaster(a, world, center, 1.0f);
+	CHECK(!cache.IsStatic(a));
+	for (int i = 0; i < 2; i++)
+		cache.UpdateCaster(a, world, center, 1.0f);
+	CHECK(!cache.IsStatic(a));
+	cache.UpdateCaster(a, world, center, 1.0f);
+	CHECK(cache.IsStatic(a));
+
+	// Any change to the matrix makes it dynamic again
+	world[13] = 0.001f;
+	cache.UpdateCaster(a, world, center, 1.0f);
+	CHECK(!cache.IsStatic(a));
+
+	// With nothing static the plan skips the cache entirely
+	ShadowCascade cascades[MaxShadowCascades];
+	Fit(0.0f, 0.0f, 0.0f, cascades);
+	ShadowCascadePlan plan;
+	cache.BeginFrame();
+	cache.PlanCascade(0, cascades[0], plan);
+	CHECK(!plan.UseCache && !plan.RebuildCache);
+	CHECK(plan.DynamicCasters.size() == 1);
+	CHECK(cache.GetStats().Drawn == 1);
+
+	// Settled again: rebuilt once, then served from the cache
+	for (int i = 0; i < 4; i++)
+		cache.UpdateCaster(a, world, center, 1.0f);
+	cache.BeginFrame();
+	cache.PlanCascade(0, cascades[0], plan);
+	CHECK(plan.UseCache && plan.RebuildCache);
+	cache.BeginFrame();
+	cache.PlanCascade(0, cascades[0], plan);
+	CHECK(plan.UseCache && !plan.RebuildCache);
+	CHECK(cache.GetStats().Cached == 1 && cache.GetStats().Drawn == 0);
+
+	// And Invalidate forces a rebuild
+	cache.Invalidate();
+	cache.BeginFrame();
+	cache.PlanCascade(0, cascades[0], plan);
+	CHECK(plan.RebuildCache);
+}
+
+int main() {
+	TestStaticSet();
+	TestAgainstReference();
+	return TestResult("ShadowCasterCacheTest");
+}
@@ -0,0 +1,519 @@
+// Software rasterizer: draws a handful of small scenes that each
+// lean on one part of the pipeline (depth, fill rule, blending,
+// clipping, the ported scene shaders) and compares them against
+// the golden images in Golden/.  Each scene is also drawn on one
+// thread and on several, which must match exactly.  Then times a
+// large scene for triangles and pixels per second.  --write
+// saves the scenes as new golden images instead.
+//
+//   g++ -std=c++14 -O2 -pthread -I.. SoftwareRasterizerTest.cpp ../SoftwareRasterizer.cpp ../SoftwareShaders.cpp -o SoftwareRasterizerTest && ./SoftwareRasterizerTest [--write]
+
+#include "TestCommon.h"
+#include "SoftwareRasterizer.h"
+#include "SoftwareShaders.h"
+#include <math.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+const int SceneWidth = 128;
+const int SceneHeight = 96;
+
+// Position is clip space for the flat scenes, view space for
+// the ones drawn through Perspective
+struct ColorVertex {
+	float Position[4];
+	float Color[4];
+};
+
+static ColorVertex MakeVertex(float x, float y, float z, float r, float g, float b, float a = 1.0f) {
+	ColorVertex vertex = { { x, y, z, 1.0f }, { r, g, b, a } };
+	return vertex;
+}
+
+static void PassThroughVS(const void* vertex, SoftwareVertex& out) {
+	const ColorVertex& input = *(const ColorVertex*)vertex;
+	memcpy(out.Position, input.Position, sizeof(out.Position));
+	memcpy(out.Varyings, input.Color, sizeof(input.Color));
+}
+
+static bool ColorPS(const float* varyings, float color[4]) {
+	memcpy(color, varyings, sizeof(float) * 4);
+	return true;
+}
+
+// Row major, applied to column vectors - which is also how the
+// transposed matrices the shaders take are laid out
+static void Identity(float m[16]) {
+	memset(m, 0, sizeof(float) * 16);
+	m[0] = m[5] = m[10] = m[15] = 1.0f;
+}
+
+static void Multiply(const float a[16], const float b[16], float out[16]) {
+	float result[16];
+	for (int r = 0; r < 4; r++)
+		for (int c = 0; c < 4; c++)
+			result[r * 4 + c] = a[r * 4 + 0] * b[0 * 4 + c] + a[r * 4 + 1] * b[1 * 4 + c] + a[r * 4 + 2] * b[2 * 4 + c] + a[r * 4 + 3] * b[3 * 4 + c];
+	memcpy(out, result, sizeof(result));
+}
+
+static void Translation(float x, float y, float z, float m[16]) {
+	Identity(m);
+	m[3] = x;
+	m[7] = y;
+	m[11] = z;
+}
+
+static void RotationXY(float pitch, float yaw, float m[16]) {
+	float x[16], y[16];
+	Identity(x);
+	Identity(y);
+	x[5] = cosf(pitch); x[6] = -sinf(pitch);
+	x[9] = sinf(pitch); x[10] = cosf(pitch);
+	y[0] = cosf(yaw); y[2] = sinf(yaw);
+	y[8] = -sinf(yaw); y[10] = cosf(yaw);
+	Multiply(y, x, m);
+}
+
+// XMMatrixPerspectiveFovLH
+static void Perspective(float fovY, float aspect, float nearZ, float farZ, float m[16]) {
+	memset(m, 0, sizeof(float) * 16);
+	float yScale = 1.0f / tanf(fovY * 0.5f);
+	m[0] = yScale / aspect;
+	m[5] = yScale;
+	m[10] = farZ / (farZ - nearZ);
+	m[11] = -nearZ * farZ / (farZ - nearZ);
+	m[14] = 1.0f;
+}
+
+static void Draw(SoftwareRasterizer& rasterizer, const SoftwareDrawState& state, const std::vector<ColorVertex>& vertices,
+	const std::vector<unsigned int>& indices, const SoftwareVertexShader& vertexShader = PassThroughVS) {
+	rasterizer.DrawIndexed(state, vertices.data(), sizeof(ColorVertex), (unsigned int)vertices.size(),
+		indices.data(), (unsigned int)indices.size(), vertexShader, ColorPS);
+}
+
+static void Clear(SoftwareTarget& target, float r, float g, float b) {
+	float color[4] = { r, g, b, 1.0f };
+	target.ClearColor(color);
+	target.ClearDepth(1.0f);
+}
+
+// --------------------------------------------------------
+// Scenes
+// --------------------------------------------------------
+
+// Two triangles passing through each other in front of a third
+static void DepthScene(SoftwareRasterizer& rasterizer, SoftwareTarget& target) {
+	Clear(target, 0.1f, 0.1f, 0.1f);
+	SoftwareDrawState state = SoftwareDefaultState(4);
+	state.CullMode = SoftwareCullNone;
+
+	std::vector<ColorVertex> vertices = {
+		MakeVertex(-0.9f, -0.9f, 0.9f, 0.2f, 0.2f, 1.0f),
+		MakeVertex(0.0f, 0.9f, 0.9f, 0.2f, 0.2f, 1.0f),
+		MakeVertex(0.9f, -0.9f, 0.9f, 0.2f, 0.2f, 1.0f),
+		MakeVertex(-0.8f, -0.6f, 0.2f, 1.0f, 0.2f, 0.2f),
+		MakeVertex(-0.8f, 0.6f, 0.2f, 1.0f, 0.2f, 0.2f),
+		MakeVertex(0.8f, 0.0f, 0.8f, 1.0f, 0.2f, 0.2f),
+		MakeVertex(0.8f, -0.6f, 0.2f, 0.2f, 1.0f, 0.2f),
+		MakeVertex(0.8f, 0.6f, 0.2f, 0.2f, 1.0f, 0.2f),
+		MakeVertex(-0.8f, 0.0f, 0.8f, 0.2f, 1.0f, 0.2f),
+	};
+	std::vector<unsigned int> indices = { 0, 1, 2, 3, 4, 5, 6, 7, 8 };
+	Draw(rasterizer, state, vertices, indices);
+}
+
+// A fan and a grid of quads, all sharing edges and drawn
+// additively - a pixel drawn twice shows up brighter
+static void FillRuleScene(SoftwareRasterizer& rasterizer, SoftwareTarget& target) {
+	Clear(target, 0.0f, 0.0f, 0.0f);
+	SoftwareDrawState state = SoftwareDefaultState(4);
+	state.CullMode = SoftwareCullNone;
+	state.DepthTest = false;
+	state.DepthWrite = false;
+	state.BlendMode = SoftwareBlendAdditive;
+
+	std::vector<ColorVertex> vertices;
+	std::vector<unsigned int> indices;
+
+	// Fan around an off center point, on the left half
+	const int spokes = 13;
+	vertices.push_back(MakeVertex(-0.47f, 0.03f, 0.5f, 0.25f, 0.25f, 0.25f, 0.0f));
+	for (int i = 0; i < spokes; i++) {
+		float angle = i * 6.2831853f / spokes + 0.1f;
+		vertices.push_back(MakeVertex(-0.5f + cosf(angle) * 0.45f, sinf(angle) * 0.8f, 0.5f, 0.25f, 0.25f, 0.25f, 0.0f));
+	}
+	for (int i = 0; i < spokes; i++) {
+		indices.push_back(0);
+		indices.push_back(1 + i);
+		indices.push_back(1 + (i + 1) % spokes);
+	}
+
+	// Skewed 5x5 grid of quads on the right half
+	unsigned int base = (unsigned int)vertices.size();
+	for (int y = 0; y <= 5; y++)
+		for (int x = 0; x <= 5; x++)
+			vertices.push_back(MakeVertex(0.05f + x * 0.17f + y * 0.013f, -0.85f + y * 0.33f + x * 0.021f, 0.5f, 0.25f, 0.25f, 0.25f, 0.0f));
+	for (int y = 0; y < 5; y++) {
+		for (int x = 0; x < 5; x++) {
+			unsigned int corner = base + y * 6 + x;
+			unsigned int quad[6] = { corner, corner + 6, corner + 7, corner, corner + 7, corner + 1 };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+	Draw(rasterizer, state, vertices, indices);
+}
+
+// An opaque backdrop, a fading quad and an additive one over it
+static void BlendScene(SoftwareRasterizer& rasterizer, SoftwareTarget& target) {
+	Clear(target, 0.0f, 0.0f, 0.0f);
+	SoftwareDrawState state = SoftwareDefaultState(4);
+	state.CullMode = SoftwareCullNone;
+
+	std::vector<ColorVertex> vertices = {
+		MakeVertex(-1.0f, -1.0f, 0.9f, 0.2f, 0.4f, 0.2f),
+		MakeVertex(-1.0f, 1.0f, 0.9f, 0.2f, 0.4f, 0.8f),
+		MakeVertex(1.0f, 1.0f, 0.9f, 0.8f, 0.4f, 0.8f),
+		MakeVertex(1.0f, -1.0f, 0.9f, 0.8f, 0.4f, 0.2f),
+	};
+	std::vector<unsigned int> quad = { 0, 1, 2, 0, 2, 3 };
+	Draw(rasterizer, state, vertices, quad);
+
+	state.DepthWrite = false;
+	state.BlendMode = SoftwareBlendAlpha;
+	vertices = {
+		MakeVertex(-0.8f, -0.6f, 0.5f, 1.0f, 0.0f, 0.0f, 0.0f),
+		MakeVertex(-0.8f, 0.6f, 0.5f, 1.0f, 0.0f, 0.0f, 1.0f),
+		MakeVertex(0.3f, 0.6f, 0.5f, 1.0f, 1.0f, 0.0f, 1.0f),
+		MakeVertex(0.3f, -0.6f, 0.5f, 1.0f, 1.0f, 0.0f, 0.0f),
+	};
+	Draw(rasterizer, state, vertices, quad);
+
+	state.BlendMode = SoftwareBlendAdditive;
+	vertices = {
+		MakeVertex(-0.2f, -0.8f, 0.5f, 0.0f, 0.0f, 0.6f),
+		MakeVertex(-0.2f, 0.3f, 0.5f, 0.0f, 0.3f, 0.6f),
+		MakeVertex(0.9f, 0.3f, 0.5f, 0.0f, 0.3f, 0.6f),
+		MakeVertex(0.9f, -0.8f, 0.5f, 0.0f, 0.0f, 0.6f),
+	};
+	Draw(rasterizer, state, vertices, quad);
+}
+
+// View space triangles through a perspective projection: one
+// with a corner behind the camera, one far past the guard band
+// and one through the far plane, drawn with depth clip off and
+// then on
+static void ClipScene(SoftwareRasterizer& rasterizer, SoftwareTarget& target) {
+	Clear(target, 0.1f, 0.1f, 0.1f);
+	float projection[16];
+	Perspective(1.0f, (float)SceneWidth / SceneHeight, 0.5f, 10.0f, projection);
+	SoftwareVertexShader perspectiveVS = [&](const void* vertex, SoftwareVertex& out) {
+		const ColorVertex& input = *(const ColorVertex*)vertex;
+		for (int r = 0; r < 4; r++)
+			out.Position[r] = projection[r * 4 + 0] * input.Position[0] + projection[r * 4 + 1] * input.Position[1] +
+				projection[r * 4 + 2] * input.Position[2] + projection[r * 4 + 3];
+		memcpy(out.Varyings, input.Color, sizeof(input.Color));
+	};
+
+	// View space point that lands on ndcX, ndcY
+	auto onScreen = [&](float ndcX, float ndcY, float z, float r, float g, float b) {
+		return MakeVertex(ndcX * z / projection[0], ndcY * z / projection[5], z, r, g, b);
+	};
+
+	SoftwareDrawState state = SoftwareDefaultState(4);
+	state.CullMode = SoftwareCullNone;
+	std::vector<ColorVertex> vertices = {
+		onScreen(-0.9f, -0.8f, 2.0f, 1.0f, 0.2f, 0.2f),
+		onScreen(-0.3f, -0.2f, 3.0f, 1.0f, 1.0f, 0.2f),
+		MakeVertex(-0.5f, 0.5f, -1.0f, 1.0f, 0.2f, 1.0f),
+		MakeVertex(-200.0f, -1.0f, 4.0f, 0.2f, 1.0f, 0.2f),
+		MakeVertex(200.0f, -1.0f, 4.0f, 0.2f, 1.0f, 1.0f),
+		MakeVertex(0.0f, -0.4f, 4.0f, 0.2f, 0.2f, 1.0f),
+		onScreen(0.1f, 0.9f, 3.0f, 0.9f, 0.9f, 0.9f),
+		onScreen(0.9f, 0.9f, 20.0f, 0.9f, 0.5f, 0.1f),
+		onScreen(0.3f, 0.4f, 3.0f, 0.9f, 0.9f, 0.9f),
+	};
+	std::vector<unsigned int> indices = { 0, 1, 2, 3, 4, 5 };
+	Draw(rasterizer, state, vertices, indices, perspectiveVS);
+
+	// The far plane triangle clamped rather than clipped, then
+	// clipped, lower down
+	state.DepthClip = false;
+	indices = { 6, 7, 8 };
+	Draw(rasterizer, state, vertices, indices, perspectiveVS);
+
+	state.DepthClip = true;
+	vertices[6] = onScreen(0.1f, -0.1f, 3.0f, 0.9f, 0.9f, 0.9f);
+	vertices[7] = onScreen(0.9f, -0.1f, 20.0f, 0.9f, 0.5f, 0.1f);
+	vertices[8] = onScreen(0.3f, -0.6f, 3.0f, 0.9f, 0.9f, 0.9f);
+	Draw(rasterizer, state, vertices, indices, perspectiveVS);
+}
+
+// A spinning, textured cube through the ports of the real
+// shaders, three directional lights and the spot light, no shadow
+struct LitScene {
+	std::vector<SoftwareVertexInput> Vertices;
+	std::vector<unsigned int> Indices;
+	SoftwareTexture Texture;
+	SoftwareTexture NormalMap;
+	SoftwareBasicVertexShader VertexShader;
+	SoftwareBasicPixelShader PixelShader;
+
+	LitScene() : Texture(64, 64), NormalMap(4, 4) {
+		for (int y = 0; y < 64; y++) {
+			for (int x = 0; x < 64; x++) {
+				float* texel = Texture.GetTexel(x, y);
+				bool light = ((x / 8) + (y / 8)) % 2 == 0;
+				texel[0] = light ? 0.9f : 0.3f;
+				texel[1] = light ? 0.8f : 0.3f;
+				texel[2] = light ? 0.6f : 0.4f;
+				texel[3] = 1.0f;
+			}
+		}
+		// A few bumps in the normal map
+		for (int y = 0; y < 4; y++) {
+			for (int x = 0; x < 4; x++) {
+				float* texel = NormalMap.GetTexel(x, y);
+				texel[0] = x == 1 ? 0.7f : 0.5f;
+				texel[1] = y == 2 ? 0.35f : 0.5f;
+				texel[2] = 1.0f;
+				texel[3] = 1.0f;
+			}
+		}
+
+		AddCube(0.0f, 0.0f, 0.0f, 1.0f);
+
+		memset(&PixelShader, 0, sizeof(PixelShader));
+		float ambient[3] = { 0.1f, 0.1f, 0.12f };
+		float diffuse[3][3] = { { 0.8f, 0.8f, 0.7f }, { 0.2f, 0.2f, 0.4f }, { 0.3f, 0.1f, 0.1f } };
+		float direction[3][3] = { { 1.0f, -1.0f, 1.0f }, { -1.0f, 0.5f, 0.0f }, { 0.0f, 0.0f, -1.0f } };
+		SoftwareDirectionalLight* lights[3] = { &PixelShader.DirLight1, &PixelShader.DirLight2, &PixelShader.DirLight3 };
+		for (int l = 0; l < 3; l++) {
+			for (int c = 0; c < 3; c++) {
+				lights[l]->AmbientColor[c] = ambient[c];
+				lights[l]->DiffuseColor[c] = diffuse[l][c];
+				lights[l]->Direction[c] = direction[l][c];
+			}
+			lights[l]->AmbientColor[3] = lights[l]->DiffuseColor[3] = 1.0f;
+		}
+		// Spot light aimed at one corner, from above and in front
+		float spotPosition[3] = { 2.0f, 4.0f, -3.0f };
+		float spotTarget[3] = { 0.5f, 0.5f, -0.5f };
+		float spotLength = 0.0f;
+		for (int c = 0; c < 3; c++) {
+			PixelShader.PointLightPosition[c] = spotPosition[c];
+			PixelShader.SpotLightDirection[c] = spotTarget[c] - spotPosition[c];
+			spotLength += PixelShader.SpotLightDirection[c] * PixelShader.SpotLightDirection[c];
+		}
+		for (int c = 0; c < 3; c++)
+			PixelShader.SpotLightDirection[c] /= sqrtf(spotLength);
+		PixelShader.SpotPower = 400.0f;
+		PixelShader.CameraPosition[2] = -4.0f;
+		PixelShader.AlphaV = 1.0f;
+		PixelShader.Texture = &Texture;
+		PixelShader.NormalMap = &NormalMap;
+		PixelShader.Shadow.Count = 0;
+	}
+
+	// Faces wind clockwise seen from outside, the front faces
+	void AddCube(float x, float y, float z, float size) {
+		const float normals[6][3] = { { 0, 0, -1 }, { 0, 0, 1 }, { -1, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 } };
+		const float ups[6][3] = { { 0, 1, 0 }, { 0, 1, 0 }, { 0, 1, 0 }, { 0, 1, 0 }, { 0, 0, 1 }, { 0, 0, 1 } };
+		for (int f = 0; f < 6; f++) {
+			const float* n = normals[f];
+			const float* v = ups[f];
+			float u[3] = { n[1] * v[2] - n[2] * v[1], n[2] * v[0] - n[0] * v[2], n[0] * v[1] - n[1] * v[0] };
+			unsigned int base = (unsigned int)Vertices.size();
+			const float corners[4][2] = { { -1, -1 }, { -1, 1 }, { 1, 1 }, { 1, -1 } };
+			for (int c = 0; c < 4; c++) {
+				SoftwareVertexInput vertex;
+				for (int i = 0; i < 3; i++) {
+					float center[3] = { x, y, z };
+					vertex.Position[i] = center[i] + (n[i] + u[i] * corners[c][0] + v[i] * corners[c][1]) * size * 0.5f;
+					vertex.Normal[i] = n[i];
+					vertex.Tangent[i] = u[i];
+				}
+				vertex.UV[0] = corners[c][0] * 0.5f + 0.5f;
+				vertex.UV[1] = 0.5f - corners[c][1] * 0.5f;
+				Vertices.push_back(vertex);
+			}
+			unsigned int quad[6] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+			Indices.insert(Indices.end(), quad, quad + 6);
+		}
+	}
+
+	void SetCamera(float aspect, float distance) {
+		float view[16];
+		Translation(0.0f, 0.0f, distance, view);
+		memcpy(VertexShader.View, view, sizeof(view));
+		Perspective(1.0f, aspect, 0.1f, 100.0f, VertexShader.Projection);
+		PixelShader.CameraPosition[2] = -distance;
+	}
+
+	void Draw(SoftwareRasterizer& rasterizer, SoftwareCullMode cullMode) {
+		SoftwareDrawState state = SoftwareDefaultState(SoftwareBasicVertexShader::VaryingCount);
+		state.CullMode = cullMode;
+		rasterizer.DrawIndexed(state, Vertices.data(), sizeof(SoftwareVertexInput), (unsigned int)Vertices.size(),
+			Indices.data(), (unsigned int)Indices.size(), VertexShader, PixelShader);
+	}
+};
+
+static void LitCubeScene(SoftwareRasterizer& rasterizer, SoftwareTarget& target) {
+	Clear(target, 0.05f, 0.05f, 0.1f);
+	static LitScene scene;
+	scene.SetCamera((float)SceneWidth / SceneHeight, 2.6f);
+	RotationXY(0.5f, 0.7f, scene.VertexShader.World);
+	scene.Draw(rasterizer, SoftwareCullBack);
+}
+
+struct Scene {
+	const char* Name;
+	void (*Render)(SoftwareRasterizer& rasterizer, SoftwareTarget& target);
+};
+
+static const Scene scenes[] = {
+	{ "Depth", DepthScene },
+	{ "FillRule", FillRuleScene },
+	{ "Blend", BlendScene },
+	{ "Clip", ClipScene },
+	{ "LitCube", LitCubeScene },
+};
+
+// --------------------------------------------------------
+// Checks
+// --------------------------------------------------------
+
+static void TestScenes(bool write) {
+	SoftwareRasterizer single(1);
+	SoftwareRasterizer pool(4);
+	for (size_t s = 0; s < sizeof(scenes) / sizeof(scenes[0]); s++) {
+		SoftwareTarget target(SceneWidth, SceneHeight);
+		SoftwareTarget threaded(SceneWidth, SceneHeight);
+		single.SetTarget(&target);
+		pool.SetTarget(&threaded);
+		scenes[s].Render(single, target);
+		scenes[s].Render(pool, threaded);
+		CHECK(target.CountDifferences(threaded, 0) == 0);
+
+		std::string path = std::string("Golden/") + scenes[s].Name + ".tga";
+		if (write) {
+			CHECK(target.SaveTGA(path));
+			continue;
+		}
+
+		// A few edge pixels may land the other way on another
+		// compiler's float math, nothing more
+		SoftwareTarget golden(1, 1);
+		CHECK(golden.LoadTGA(path));
+		int differences = target.CountDifferences(golden, 1);
+		CHECK(differences >= 0 && differences <= SceneWidth * SceneHeight / 500);
+		if (differences != 0)
+			printf("%s: %d pixels differ from %s\n", scenes[s].Name, differences, path.c_str());
+	}
+}
+
+// Every covered pixel of the additive fill rule scene is drawn
+// exactly once, so nothing is brighter than one layer
+static void TestFillRule() {
+	SoftwareRasterizer rasterizer(1);
+	SoftwareTarget target(SceneWidth, SceneHeight);
+	rasterizer.SetTarget(&target);
+	FillRuleScene(rasterizer, target);
+
+	int covered = 0;
+	int twice = 0;
+	for (int y = 0; y < SceneHeight; y++) {
+		for (int x = 0; x < SceneWidth; x++) {
+			float value = target.GetColor(x, y)[0];
+			covered += value > 0.2f ? 1 : 0;
+			twice += value > 0.3f ? 1 : 0;
+		}
+	}
+	CHECK(covered > SceneWidth * SceneHeight / 4);
+	CHECK(twice == 0);
+}
+
+// The cube is closed, so culling back faces changes nothing,
+// and culling front faces shows only its insides
+static void TestCulling() {
+	SoftwareRasterizer rasterizer(1);
+	LitScene scene;
+	scene.SetCamera((float)SceneWidth / SceneHeight, 2.6f);
+	RotationXY(0.5f, 0.7f, scene.VertexShader.World);
+
+	SoftwareTarget images[3] = { SoftwareTarget(SceneWidth, SceneHeight), SoftwareTarget(SceneWidth, SceneHeight), SoftwareTarget(SceneWidth, SceneHeight) };
+	const SoftwareCullMode modes[3] = { SoftwareCullNone, SoftwareCullBack, SoftwareCullFront };
+	long long shaded[3];
+	for (int m = 0; m < 3; m++) {
+		Clear(images[m], 0.0f, 0.0f, 0.0f);
+		rasterizer.SetTarget(&images[m]);
+		rasterizer.ResetStats();
+		scene.Draw(rasterizer, modes[m]);
+		shaded[m] = rasterizer.GetStats().PixelsShaded;
+	}
+	CHECK(images[0].CountDifferences(images[1], 0) <= SceneWidth / 4);
+	CHECK(images[1].CountDifferences(images[2], 8) > SceneWidth * SceneHeight / 20);
+	CHECK(shaded[1] < shaded[0] && shaded[2] < shaded[0]);
+}
+
+// --------------------------------------------------------
+// Throughput
+// --------------------------------------------------------
+
+// A perspective ground plane of small triangles, through the
+// scene shaders at 720p
+static void Benchmark(int threadCount) {
+	const int width = 1280;
+	const int height = 720;
+	const int grid = 256;
+
+	LitScene scene;
+	scene.Vertices.clear();
+	scene.Indices.clear();
+	for (int z = 0; z <= grid; z++) {
+		for (int x = 0; x <= grid; x++) {
+			SoftwareVertexInput vertex = {
+				{ (x - grid * 0.5f) * 0.1f, -1.0f, z * 0.1f },
+				{ 0.0f, 1.0f, 0.0f },
+				{ x * 0.25f, z * 0.25f },
+				{ 1.0f, 0.0f, 0.0f } };
+			scene.Vertices.push_back(vertex);
+		}
+	}
+	for (int z = 0; z < grid; z++) {
+		for (int x = 0; x < grid; x++) {
+			unsigned int corner = z * (grid + 1) + x;
+			unsigned int quad[6] = { corner, corner + grid + 1, corner + grid + 2, corner, corner + grid + 2, corner + 1 };
+			scene.Indices.insert(scene.Indices.end(), quad, quad + 6);
+		}
+	}
+	scene.SetCamera((float)width / height, 0.0f);
+	Identity(scene.VertexShader.World);
+	scene.PixelShader.PointLightPosition[2] = 8.0f;
+
+	SoftwareRasterizer rasterizer(threadCount);
+	SoftwareTarget target(width, height);
+	rasterizer.SetTarget(&target);
+
+	const int frames = 10;
+	for (int f = 0; f < frames; f++) {
+		Clear(target, 0.0f, 0.0f, 0.0f);
+		scene.Draw(rasterizer, SoftwareCullNone);
+	}
+	const SoftwareRasterizerStats& stats = rasterizer.GetStats();
+	printf("%2d threads: %6.2f M triangles/s  %7.2f M pixels/s  (%.1f ms/frame, %lld pixels shaded a frame)\n",
+		rasterizer.GetThreadCount(), stats.TrianglesPerSecond() / 1e6, stats.PixelsPerSecond() / 1e6,
+		stats.Seconds * 1000.0 / frames, stats.PixelsShaded / frames);
+}
+
+int main(int argc, char** argv) {
+	bool write = argc > 1 && strcmp(argv[1], "--write") == 0;
+	TestScenes(write);
+	TestFillRule();
+	TestCulling();
+
+	Benchmark(1);
+	if (std::thread::hardware_concurrency() > 1)
+		Benchmark(0);
+	return TestResult("SoftwareRasterizerTest");
+}
@@ -0,0 +1,179 @@
+// Sprite sort: depth keys order like the floats they came
+// from, packed keys order the way each mode asks, and the
+// radix sort matches std::stable_sort, ties included.  Then
+// sprites per second for each sort mode, keys packed and
+// sorted, against std::stable_sort on the same keys.
+//
+//   g++ -std=c++14 -O2 -I.. SpriteSortTest.cpp ../SpriteSort.cpp -o SpriteSortTest && ./SpriteSortTest
+
+#include "TestCommon.h"
+#include "SpriteSort.h"
+#include <algorithm>
+#include <limits>
+#include <string.h>
+
+static unsigned int seed = 1;
+
+static unsigned int RandomBits() {
+	seed = seed * 1664525 + 1013904223;
+	return seed;
+}
+
+static float RandomFloat(float low, float high) {
+	return low + (high - low) * (RandomBits() >> 8) * (1.0f / 16777216.0f);
+}
+
+static bool KeyLess(const SpriteKey& a, const SpriteKey& b) {
+	return a.Key < b.Key;
+}
+
+static void TestDepthKeys() {
+	const float infinity = std::numeric_limits<float>::infinity();
+	const float values[] = { -infinity, -1e30f, -2.0f, -1.0f, -1e-30f, 0.0f, 1e-30f, 0.5f, 1.0f, 1e30f, infinity };
+	for (size_t i = 0; i + 1 < sizeof(values) / sizeof(values[0]); i++)
+		CHECK(DepthSortKey(values[i]) < DepthSortKey(values[i + 1]));
+
+	for (int i = 0; i < 100000; i++) {
+		float a = RandomFloat(-100.0f, 100.0f);
+		float b = i % 4 == 0 ? a : RandomFloat(-100.0f, 100.0f);
+		CHECK((a < b) == (DepthSortKey(a) < DepthSortKey(b)));
+		CHECK((a == b) == (DepthSortKey(a) == DepthSortKey(b)));
+	}
+}
+
+static void TestPackedKeys() {
+	// Texture order ignores depth
+	CHECK(PackSpriteKey(SpriteOrder_Texture, 3, 0.9f) == PackSpriteKey(SpriteOrder_Texture, 3, 0.1f));
+	CHECK(PackSpriteKey(SpriteOrder_Texture, 2, 0.9f) < PackSpriteKey(SpriteOrder_Texture, 3, 0.1f));
+
+	// Depth first, then texture
+	CHECK(PackSpriteKey(SpriteOrder_BackToFront, 9, 0.9f) < PackSpriteKey(SpriteOrder_BackToFront, 0, 0.1f));
+	CHECK(PackSpriteKey(SpriteOrder_BackToFront, 1, 0.5f) < PackSpriteKey(SpriteOrder_BackToFront, 2, 0.5f));
+	CHECK(PackSpriteKey(SpriteOrder_FrontToBack, 9, 0.1f) < PackSpriteKey(SpriteOrder_FrontToBack, 0, 0.9f));
+	CHECK(PackSpriteKey(SpriteOrder_FrontToBack, 1, 0.5f) < PackSpriteKey(SpriteOrder_FrontToBack, 2, 0.5f));
+}
+
+static std::vector<SpriteKey> RandomKeys(SpriteOrder order, size_t count, int textures, int depths) {
+	std::vector<SpriteKey> keys(count);
+	for (size_t i = 0; i < count; i++) {
+		// Few distinct depths, so plenty of ties
+		float depth = (RandomBits() >> 8) % depths / (float)depths;
+		keys[i].Key = PackSpriteKey(order, (RandomBits() >> 8) % textures, depth);
+		keys[i].Index = (uint32_t)i;
+	}
+	return keys;
+}
+
+static bool Same(const std::vector<SpriteKey>& a, const std::vector<SpriteKey>& b) {
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); i++)
+		if (a[i].Key != b[i].Key || a[i].Index != b[i].Index)
+			return false;
+	return true;
+}
+
+static void TestRadixSort() {
+	const SpriteOrder orders[] = { SpriteOrder_Texture, SpriteOrder_BackToFront, SpriteOrder_FrontToBack };
+	const size_t sizes[] = { 0, 1, 2, 3, 17, 256, 1000, 4097 };
+	std::vector<SpriteKey> scratch;
+
+	for (SpriteOrder order : orders) {
+		for (size_t count : sizes) {
+			for (int textures = 1; textures <= 300; textures *= 7) {
+				std::vector<SpriteKey> keys = RandomKeys(order, count, textures, 5);
+				std::vector<SpriteKey> expected = keys;
+				std::stable_sort(expected.begin(), expected.end(), KeyLess);
+				RadixSortSpriteKeys(keys, scratch);
+				CHECK(Same(keys, expected));
+			}
+		}
+	}
+
+	// Keys that differ in one byte only, so one pass runs and the
+	// result lands in scratch; and in every byte, so all eight do
+	for (int bytes = 1; bytes <= 8; bytes++) {
+		std::vector<SpriteKey> keys(1000);
+		for (size_t i = 0; i < keys.size(); i++) {
+			keys[i].Key = 0x0101010101010101ull;
+			for (int b = 0; b < bytes; b++)
+				keys[i].Key ^= (uint64_t)(RandomBits() >> 24) << (b * 8);
+			keys[i].Index = (uint32_t)i;
+		}
+		std::vector<SpriteKey> expected = keys;
+		std::stable_sort(expected.begin(), expected.end(), KeyLess);
+		RadixSortSpriteKeys(keys, scratch);
+		CHECK(Same(keys, expected));
+	}
+
+	// All the same key - nothing moves
+	std::vector<SpriteKey> same = RandomKeys(SpriteOrder_Texture, 500, 1, 1);
+	RadixSortSpriteKeys(same, scratch);
+	for (size_t i = 0; i < same.size(); i++)
+		CHECK(same[i].Index == i);
+}
+
+// --------------------------------------------------------
+// Throughput
+// --------------------------------------------------------
+
+static void Benchmark() {
+	const char* names[] = { "Texture", "BackToFront", "FrontToBack" };
+	const size_t sizes[] = { 256, 2048, 32768 };
+	const int textureCount = 24;
+
+	// Sprites as a UI queues them: a texture and a depth each
+	const size_t maxCount = 32768;
+	std::vector<uint32_t> textures(maxCount);
+	std::vector<float> depths(maxCount);
+	for (size_t i = 0; i < maxCount; i++) {
+		textures[i] = (RandomBits() >> 8) % textureCount;
+		depths[i] = RandomFloat(0.0f, 1.0f);
+	}
+
+	std::vector<SpriteKey> keys, copy, scratch;
+	keys.reserve(maxCount);
+	for (int order = SpriteOrder_Texture; order <= SpriteOrder_FrontToBack; order++) {
+		for (size_t count : sizes) {
+			int repeats = (int)(4000000 / count);
+
+			auto start = std::chrono::steady_clock::now();
+			uint32_t first = 0;
+			for (int r = 0; r < repeats; r++) {
+				keys.clear();
+				for (size_t i = 0; i < count; i++) {
+					SpriteKey key = { PackSpriteKey((SpriteOrder)order, textures[i], depths[i]), (uint32_t)i };
+					keys.push_back(key);
+				}
+				RadixSortSpriteKeys(keys, scratch);
+				first += keys[0].Index;
+			}
+			double radixMilliseconds = ElapsedMilliseconds(start);
+
+			start = std::chrono::steady_clock::now();
+			for (int r = 0; r < repeats; r++) {
+				copy.clear();
+				for (size_t i = 0; i < count; i++) {
+					SpriteKey key = { PackSpriteKey((SpriteOrder)order, textures[i], depths[i]), (uint32_t)i };
+					copy.push_back(key);
+				}
+				std::stable_sort(copy.begin(), copy.end(), KeyLess);
+				first -= copy[0].Index;
+			}
+			double stableMilliseconds = ElapsedMilliseconds(start);
+			CHECK(first == 0 && Same(keys, copy));
+
+			double sprites = (double)count * repeats;
+			printf("%-11s %6d sprites: radix %6.1f M sprites/s, std::stable_sort %6.1f M sprites/s\n",
+				names[order], (int)count, sprites / radixMilliseconds / 1000.0, sprites / stableMilliseconds / 1000.0);
+		}
+	}
+}
+
+int main() {
+	TestDepthKeys();
+	TestPackedKeys();
+	TestRadixSort();
+	Benchmark();
+	return TestResult("SpriteSortTest");
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+// --------------------------------------------------------
+// Shared by the standalone tests in this folder.  Each test
+// is its own program, built and run with the line at the
+// top of its file; it exits non-zero if any check failed,
+// then prints whatever it measured.
+// --------------------------------------------------------
+
+#include <chrono>
+#include <stdio.h>
+
+static int testFailures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition); \
+			testFailures++; \
+		} \
+	} while (0)
+
+inline double ElapsedMilliseconds(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline int TestResult(const char* name) {
+	if (testFailures == 0)
+		printf("%s: passed\n", name);
+	else
+		printf("%s: FAILED (%d)\n", name, testFailures);
+	return testFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,271 @@
+// Text layout: LayoutText against a straight port of
+// SpriteFont's ForEachGlyph, DrawString placement and
+// MeasureString on random text, FormatInteger against
+// swprintf, and the cache's keys, hits and eviction.  Then
+// layouts per second uncached and cached, and the HUD's
+// changing score.
+//
+//   g++ -std=c++14 -O2 -I.. TextLayoutTest.cpp ../TextLayout.cpp -o TextLayoutTest && ./TextLayoutTest
+
+#include "TestCommon.h"
+#include "TextLayout.h"
+#include <algorithm>
+#include <limits.h>
+#include <wchar.h>
+#include <wctype.h>
+
+static unsigned int seed = 1;
+
+static int RandomInt(int low, int high) {
+	seed = seed * 1664525 + 1013904223;
+	return low + (int)((seed >> 8) % (unsigned int)(high - low + 1));
+}
+
+// --------------------------------------------------------
+// A made up font: printable ASCII with odd offsets (some
+// negative), a 1x1 space and '?' as the default glyph
+// --------------------------------------------------------
+
+struct TestFont {
+	std::vector<TextGlyph> Glyphs;
+	float LineSpacing;
+	int Lookups;
+
+	TextGlyph Find(wchar_t character) {
+		Lookups++;
+		if (character >= 32 && character < 127)
+			return Glyphs[character - 32];
+		return Glyphs['?' - 32];
+	}
+};
+
+static TestFont MakeFont() {
+	TestFont font;
+	font.LineSpacing = 18.0f;
+	font.Lookups = 0;
+	for (int c = 32; c < 127; c++) {
+		TextGlyph glyph;
+		glyph.Character = c;
+		glyph.Left = RandomInt(0, 200);
+		glyph.Top = RandomInt(0, 200);
+		glyph.Right = glyph.Left + (c == ' ' ? 1 : RandomInt(2, 12));
+		glyph.Bottom = glyph.Top + (c == ' ' ? 1 : RandomInt(8, 20));
+		glyph.XOffset = RandomInt(-3, 2) * 0.5f;
+		glyph.YOffset = (float)RandomInt(0, 8);
+		glyph.XAdvance = RandomInt(-1, 3) * 0.5f;
+		font.Glyphs.push_back(glyph);
+	}
+	return font;
+}
+
+static TextGlyphLookup Lookup(TestFont& font) {
+	return [&font](wchar_t character) { return font.Find(character); };
+}
+
+// SpriteFont::Impl::ForEachGlyph, DrawString with no rotation
+// or effects, and MeasureString
+static void ReferenceLayout(TestFont& font, const wchar_t* text, float scale, std::vector<TextQuad>& quads, float& width, float& height) {
+	quads.clear();
+	width = height = 0.0f;
+	float x = 0, y = 0;
+	for (; *text; text++) {
+		wchar_t character = *text;
+		switch (character) {
+		case '\r':
+			continue;
+		case '\n':
+			x = 0;
+			y += font.LineSpacing;
+			break;
+		default:
+			TextGlyph glyph = font.Find(character);
+			x += glyph.XOffset;
+			if (x < 0)
+				x = 0;
+			float advance = glyph.Right - glyph.Left + glyph.XAdvance;
+			if (!iswspace(character) || glyph.Right - glyph.Left > 1 || glyph.Bottom - glyph.Top > 1) {
+				// The sprite's origin is -(x, y + YOffset), scaled with it
+				TextQuad quad = { x * scale, (y + glyph.YOffset) * scale, glyph.Left, glyph.Top, glyph.Right, glyph.Bottom };
+				quads.push_back(quad);
+
+				float w = (float)(glyph.Right - glyph.Left);
+				float h = std::max((float)(glyph.Bottom - glyph.Top) + glyph.YOffset, font.LineSpacing);
+				width = std::max(width, x + w);
+				height = std::max(height, y + h);
+			}
+			x += advance;
+			break;
+		}
+	}
+	width *= scale;
+	height *= scale;
+}
+
+static std::wstring RandomText(int length) {
+	static const wchar_t extra[] = { L'\n', L'\r', L' ', L' ', L'\t', 0x00E9, 0x4E2D };
+	std::wstring text;
+	for (int i = 0; i < length; i++) {
+		if (RandomInt(0, 5) == 0)
+			text += extra[RandomInt(0, 6)];
+		else
+			text += (wchar_t)RandomInt(33, 126);
+	}
+	return text;
+}
+
+static void TestMatchesSpriteFont() {
+	TestFont font = MakeFont();
+	const float scales[] = { 1.0f, 0.5f, 2.0f, 1.37f };
+
+	std::vector<TextQuad> expected;
+	TextRun run;
+	for (int i = 0; i < 3000; i++) {
+		std::wstring text = RandomText(RandomInt(0, 60));
+		float scale = scales[i % 4];
+		float width, height;
+		ReferenceLayout(font, text.c_str(), scale, expected, width, height);
+		LayoutText(text.c_str(), scale, font.LineSpacing, Lookup(font), run);
+
+		CHECK(run.Scale == scale && run.Width == width && run.Height == height);
+		CHECK(run.Quads.size() == expected.size());
+		if (run.Quads.size() != expected.size())
+			continue;
+		for (size_t q = 0; q < expected.size(); q++) {
+			const TextQuad& a = run.Quads[q];
+			const TextQuad& b = expected[q];
+			CHECK(a.X == b.X && a.Y == b.Y && a.Left == b.Left && a.Top == b.Top && a.Right == b.Right && a.Bottom == b.Bottom);
+		}
+	}
+
+	// Empty, only spaces, and a run reused for something shorter
+	LayoutText(L"abc\ndef", 1.0f, font.LineSpacing, Lookup(font), run);
+	CHECK(run.Quads.size() == 6 && run.Height >= 2 * font.LineSpacing);
+	LayoutText(L"", 1.0f, font.LineSpacing, Lookup(font), run);
+	CHECK(run.Quads.empty() && run.Width == 0.0f && run.Height == 0.0f);
+	LayoutText(L"   \r\n ", 1.0f, font.LineSpacing, Lookup(font), run);
+	CHECK(run.Quads.empty() && run.Width == 0.0f && run.Height == 0.0f);
+}
+
+static void TestFormatInteger() {
+	const int values[] = { 0, 1, -1, 9, 10, -10, 12345, -98765, INT_MAX, INT_MIN, INT_MIN + 1 };
+	wchar_t buffer[16], expected[32];
+	for (int i = 0; i < 20000; i++) {
+		int value = i < 11 ? values[i] : (int)(seed = seed * 1664525 + 1013904223) >> RandomInt(0, 31);
+		swprintf(expected, 32, L"%d", value);
+		int length = FormatInteger(value, buffer, 16);
+		CHECK(length == (int)wcslen(expected) && wcscmp(buffer, expected) == 0);
+	}
+
+	// Too small a buffer keeps the start and stays terminated
+	wchar_t small[4] = { L'x', L'x', L'x', L'x' };
+	CHECK(FormatInteger(-12345, small, 4) == 3 && wcscmp(small, L"-12") == 0);
+	CHECK(FormatInteger(7, small, 1) == 0 && small[0] == 0);
+	small[0] = L'x';
+	CHECK(FormatInteger(7, small, 0) == 0 && small[0] == L'x');
+}
+
+static void TestCache() {
+	TestFont font = MakeFont();
+	TestFont other = MakeFont();
+	TextLayoutCache cache(8);
+
+	const TextRun& first = cache.Get(&font, L"Score", 1.0f, font.LineSpacing, Lookup(font));
+	int lookups = font.Lookups;
+	CHECK(lookups == 5 && cache.GetMisses() == 1 && cache.GetHits() == 0);
+
+	// A hit hands back the same run without touching the font
+	const TextRun& again = cache.Get(&font, L"Score", 1.0f, font.LineSpacing, Lookup(font));
+	CHECK(&again == &first && font.Lookups == lookups && cache.GetHits() == 1);
+
+	// Anything in the key changing is a different run
+	CHECK(&cache.Get(&font, L"Score", 2.0f, font.LineSpacing, Lookup(font)) != &first);
+	CHECK(&cache.Get(&other, L"Score", 1.0f, other.LineSpacing, Lookup(other)) != &first);
+	CHECK(&cache.Get(&font, L"Scor", 1.0f, font.LineSpacing, Lookup(font)) != &first);
+	const TextRun& spaced = cache.Get(&font, L"Score", 1.0f, 30.0f, Lookup(font));
+	CHECK(&spaced != &first && spaced.Height == 30.0f);
+	CHECK(cache.GetMisses() == 5 && cache.GetHits() == 1);
+
+	// What it hands back is what LayoutText makes
+	TextRun expected;
+	LayoutText(L"Line one\nLine two", 1.5f, font.LineSpacing, Lookup(font), expected);
+	const TextRun& cached = cache.Get(&font, L"Line one\nLine two", 1.5f, font.LineSpacing, Lookup(font));
+	CHECK(cached.Width == expected.Width && cached.Height == expected.Height && cached.Quads.size() == expected.Quads.size());
+
+	// Filling up drops everything
+	wchar_t text[16];
+	for (int i = 0; i < 8; i++) {
+		FormatInteger(i, text, 16);
+		cache.Get(&font, text, 1.0f, font.LineSpacing, Lookup(font));
+	}
+	int misses = cache.GetMisses();
+	cache.Get(&font, L"Score", 1.0f, font.LineSpacing, Lookup(font));
+	CHECK(cache.GetMisses() == misses + 1);
+	cache.Get(&font, L"Score", 1.0f, font.LineSpacing, Lookup(font));
+	CHECK(cache.GetMisses() == misses + 1);
+
+	cache.Clear();
+	cache.Get(&font, L"Score", 1.0f, font.LineSpacing, Lookup(font));
+	CHECK(cache.GetMisses() == misses + 2);
+}
+
+// --------------------------------------------------------
+// Throughput
+// --------------------------------------------------------
+
+static void Benchmark() {
+	TestFont font = MakeFont();
+	TextGlyphLookup lookup = Lookup(font);
+
+	// The HUD's kind of strings
+	std::vector<std::wstring> texts;
+	texts.push_back(L"Score: ");
+	texts.push_back(L"Press Space to start");
+	texts.push_back(L"GAME OVER\nPress R to restart");
+	texts.push_back(L"Paused");
+	for (int i = 0; i < 12; i++)
+		texts.push_back(RandomText(24));
+
+	const int count = 400000;
+	TextRun run;
+	size_t quads = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < count; i++) {
+		LayoutText(texts[i % texts.size()].c_str(), 1.0f, font.LineSpacing, lookup, run);
+		quads += run.Quads.size();
+	}
+	double layoutMilliseconds = ElapsedMilliseconds(start);
+	double glyphs = (double)font.Lookups / count;
+
+	TextLayoutCache cache;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < count; i++)
+		quads -= cache.Get(&font, texts[i % texts.size()].c_str(), 1.0f, font.LineSpacing, lookup).Quads.size();
+	double cachedMilliseconds = ElapsedMilliseconds(start);
+	CHECK(quads == 0);
+
+	// A score that goes up most frames misses every time it does
+	TextLayoutCache scoreCache;
+	wchar_t score[16];
+	start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < count; frame++) {
+		FormatInteger(frame / 2 * 10, score, 16);
+		quads += scoreCache.Get(&font, score, 1.0f, font.LineSpacing, lookup).Quads.size();
+	}
+	double scoreMilliseconds = ElapsedMilliseconds(start);
+	CHECK(scoreCache.GetHits() == count / 2);
+
+	printf("LayoutText: %.2f M strings/s, %.0f ns each (%.1f glyphs on average)\n",
+		count / layoutMilliseconds / 1000.0, layoutMilliseconds * 1e6 / count, glyphs);
+	printf("Cached:     %.2f M strings/s, %.0f ns each, %d hits %d misses\n",
+		count / cachedMilliseconds / 1000.0, cachedMilliseconds * 1e6 / count, cache.GetHits(), cache.GetMisses());
+	printf("Score:      %.0f ns/frame with the score changing every other frame\n",
+		scoreMilliseconds * 1e6 / count);
+}
+
+int main() {
+	TestMatchesSpriteFont();
+	TestFormatInteger();
+	TestCache();
+	Benchmark();
+	return TestResult("TextLayoutTest");
+}
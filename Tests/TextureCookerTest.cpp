@@ -0,0 +1,240 @@
+// Texture cooker: block round trips, gamma correct mips, and
+// what the cooked textures save at load time.  Run from this
+// folder, as it reads the project's textures.
+//
+//   g++ -std=c++14 -O2 -I.. -I../Tools/TextureCooker TextureCookerTest.cpp ../DDSLayout.cpp ../Tools/TextureCooker/TextureCooker.cpp ../Tools/TextureCooker/TiffReader.cpp -o TextureCookerTest && ./TextureCookerTest
+
+#include "TestCommon.h"
+#include "DDSLayout.h"
+#include "TextureCooker.h"
+#include <fstream>
+#include <iterator>
+#include <math.h>
+#include <string.h>
+
+static const char* textureFolder = "../Debug/TextureFiles/";
+static const uint32_t FormatBC1 = 71;		// DXGI_FORMAT_BC1_UNORM
+
+static std::vector<uint8_t> ReadFile(const std::string& path) {
+	std::ifstream file(path, std::ios::binary);
+	return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+// Mean squared error over the given channels of two RGBA blocks
+static double BlockError(const uint8_t* a, const uint8_t* b, int firstChannel, int channels) {
+	double error = 0;
+	for (int i = 0; i < 16; i++) {
+		for (int c = firstChannel; c < firstChannel + channels; c++) {
+			double d = (double)a[i * 4 + c] - b[i * 4 + c];
+			error += d * d;
+		}
+	}
+	return error / (16 * channels);
+}
+
+static void TestBlocks() {
+	uint8_t pixels[64], decoded[64], block[16];
+
+	// A flat block comes back exactly, as far as 565 allows
+	for (int i = 0; i < 16; i++) {
+		pixels[i * 4] = 200; pixels[i * 4 + 1] = 100; pixels[i * 4 + 2] = 40; pixels[i * 4 + 3] = 255;
+	}
+	EncodeBC1Block(pixels, block);
+	DecodeBC1Block(block, decoded);
+	CHECK(BlockError(pixels, decoded, 0, 3) < 16.0);
+	CHECK(decoded[3] == 255);
+
+	// A gradient lies on a line, which is what BC1 stores.  16
+	// steps squeezed into 4 colours (or 8 alphas) can't do much
+	// better than these - an even spread of 4 over the red ramp
+	// alone is ~530.
+	for (int i = 0; i < 16; i++) {
+		pixels[i * 4] = (uint8_t)(i * 16);
+		pixels[i * 4 + 1] = (uint8_t)(255 - i * 16);
+		pixels[i * 4 + 2] = (uint8_t)(64 + i * 8);
+		pixels[i * 4 + 3] = (uint8_t)(i * 17);
+	}
+	EncodeBC1Block(pixels, block);
+	DecodeBC1Block(block, decoded);
+	CHECK(BlockError(pixels, decoded, 0, 3) < 350.0);
+	for (int i = 0; i < 16; i++)
+		CHECK(decoded[i * 4 + 3] == 255);		// Always four colour mode, never punch through
+
+	// BC3 keeps the alpha ramp to within a palette step
+	EncodeBC3Block(pixels, block);
+	DecodeBC3Block(block, decoded);
+	CHECK(BlockError(pixels, decoded, 0, 3) < 350.0);
+	CHECK(BlockError(pixels, decoded, 3, 1) < 120.0);
+
+	// BC5 keeps the two channels on their own
+	EncodeBC5Block(pixels, block);
+	DecodeBC5Block(block, decoded);
+	CHECK(BlockError(pixels, decoded, 0, 2) < 120.0);
+
+	// Two colours far apart land on the endpoints
+	for (int i = 0; i < 16; i++) {
+		uint8_t value = (i & 1) ? 255 : 0;
+		pixels[i * 4] = pixels[i * 4 + 1] = pixels[i * 4 + 2] = value;
+	}
+	EncodeBC1Block(pixels, block);
+	DecodeBC1Block(block, decoded);
+	CHECK(BlockError(pixels, decoded, 0, 3) == 0.0);
+}
+
+static void TestMips() {
+	// A black and white checker averages to half the light,
+	// which sRGB stores as 188 - not 128
+	CookerImage checker;
+	checker.Width = 2;
+	checker.Height = 2;
+	checker.HasAlpha = false;
+	checker.Pixels.assign(16, 255);
+	memset(&checker.Pixels[0], 0, 3);
+	memset(&checker.Pixels[12], 0, 3);
+
+	std::vector<CookerLevel> levels;
+	GenerateMips(checker, false, levels);
+	CHECK(levels.size() == 2);
+	std::vector<uint8_t> rgba;
+	ConvertLevel(levels[1], false, rgba);
+	CHECK(rgba[0] >= 186 && rgba[0] <= 190);
+	CHECK(rgba[3] == 255);
+
+	// The top level comes back as it went in
+	ConvertLevel(levels[0], false, rgba);
+	CHECK(rgba == checker.Pixels);
+
+	// Normals pointing different ways average to a unit vector
+	CookerImage normals = checker;
+	const uint8_t directions[4][3] = { { 255, 128, 128 }, { 128, 255, 128 }, { 128, 128, 255 }, { 128, 128, 255 } };
+	for (int i = 0; i < 4; i++)
+		memcpy(&normals.Pixels[i * 4], directions[i], 3);
+	GenerateMips(normals, true, levels);
+	const float* n = &levels[1].Pixels[0];
+	CHECK(fabsf(sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) - 1.0f) < 0.001f);
+
+	// Odd sizes still go down to 1x1
+	CookerImage odd;
+	odd.Width = 5;
+	odd.Height = 3;
+	odd.HasAlpha = false;
+	odd.Pixels.assign(5 * 3 * 4, 90);
+	GenerateMips(odd, false, levels);
+	CHECK(levels.size() == 3);
+	CHECK(levels[1].Width == 2 && levels[1].Height == 1);
+	CHECK(levels[2].Width == 1 && levels[2].Height == 1);
+
+	// And encode with the edges padded out
+	std::vector<uint8_t> blocks;
+	ConvertLevel(levels[0], false, rgba);
+	EncodeSurface(rgba.data(), 5, 3, CookerBC1, blocks);
+	CHECK(blocks.size() == 2 * 8);
+}
+
+static void TestTiff() {
+	CookerImage image;
+	std::string error;
+	CHECK(!ParseTiff((const uint8_t*)"II*\0", 4, image, error));
+
+	// The LZW and uncompressed sources both decode
+	CHECK(ReadTiff(std::string(textureFolder) + "Grass.tiff", image, error));
+	CHECK(image.Width == 1024 && image.Height == 1024);
+	CHECK(ReadTiff(std::string(textureFolder) + "Cobble.tif", image, error));
+	CHECK(image.Width == 1024 && image.Height == 1024 && !image.HasAlpha);
+
+	// Cut short, it's refused rather than read past the end
+	std::vector<uint8_t> data = ReadFile(std::string(textureFolder) + "Grass.tiff");
+	CHECK(!ParseTiff(data.data(), data.size() / 2, image, error));
+}
+
+// Every cooked texture that's checked in should match its
+// source and parse the way the game will parse it
+static void TestCookedFiles() {
+	const char* names[] = { "Cobble", "Grass", "LavaRocks" };
+	const char* extensions[] = { ".tif", ".tiff", ".tiff" };
+
+	printf("%-10s %12s %12s %10s %10s %8s\n", "texture", "tiff ms", "dds ms", "RGBA KB", "BC KB", "PSNR");
+	for (int t = 0; t < 3; t++) {
+		std::string source = std::string(textureFolder) + names[t] + extensions[t];
+		std::string cooked = std::string(textureFolder) + names[t] + ".dds";
+
+		// What a load costs either way: decoding the source, or
+		// reading the DDS and finding its mips
+		auto start = std::chrono::steady_clock::now();
+		CookerImage image;
+		std::string error;
+		bool sourceRead = ReadTiff(source, image, error);
+		double sourceMilliseconds = ElapsedMilliseconds(start);
+		CHECK(sourceRead);
+
+		start = std::chrono::steady_clock::now();
+		std::vector<uint8_t> data = ReadFile(cooked);
+		DDSLayout layout;
+		bool parsed = ParseDDSLayout(data.data(), data.size(), layout);
+		double cookedMilliseconds = ElapsedMilliseconds(start);
+		CHECK(parsed);
+		if (!sourceRead || !parsed)
+			continue;
+
+		CHECK(layout.Format == FormatBC1);
+		CHECK(layout.Width == (uint32_t)image.Width && layout.Height == (uint32_t)image.Height);
+		CHECK(layout.MipCount == 11);
+
+		// Top mip against the source
+		const DDSSubresource& top = layout.Subresources[0];
+		int blocksWide = (image.Width + 3) / 4;
+		double error2 = 0;
+		uint8_t decoded[64];
+		for (int by = 0; by < image.Height / 4; by++) {
+			for (int bx = 0; bx < blocksWide; bx++) {
+				DecodeBC1Block(&data[top.Offset + (by * blocksWide + bx) * 8], decoded);
+				for (int y = 0; y < 4; y++) {
+					for (int x = 0; x < 4; x++) {
+						const uint8_t* original = &image.Pixels[((size_t)(by * 4 + y) * image.Width + bx * 4 + x) * 4];
+						for (int c = 0; c < 3; c++) {
+							double d = (double)original[c] - decoded[(y * 4 + x) * 4 + c];
+							error2 += d * d;
+						}
+					}
+				}
+			}
+		}
+		error2 /= (double)image.Width * image.Height * 3;
+		double psnr = 10.0 * log10(255.0 * 255.0 / error2);
+		CHECK(psnr > 30.0);
+
+		// WIC's path is RGBA8 with the mips the context generates
+		size_t rgbaBytes = (size_t)image.Width * image.Height * 4 * 4 / 3;
+		size_t blockBytes = 0;
+		for (size_t i = 0; i < layout.Subresources.size(); i++)
+			blockBytes += layout.Subresources[i].Size;
+		printf("%-10s %12.1f %12.1f %10zu %10zu %8.1f\n", names[t], sourceMilliseconds, cookedMilliseconds,
+			rgbaBytes / 1024, blockBytes / 1024, psnr);
+	}
+}
+
+static void BenchmarkEncode() {
+	CookerImage image;
+	std::string error;
+	if (!ReadTiff(std::string(textureFolder) + "Grass.tiff", image, error))
+		return;
+
+	const CookerFormat formats[] = { CookerBC1, CookerBC3, CookerBC5 };
+	const char* names[] = { "BC1", "BC3", "BC5" };
+	for (int f = 0; f < 3; f++) {
+		std::vector<uint8_t> blocks;
+		auto start = std::chrono::steady_clock::now();
+		EncodeSurface(image.Pixels.data(), image.Width, image.Height, formats[f], blocks);
+		double milliseconds = ElapsedMilliseconds(start);
+		printf("%s encode: %.1f Mpixels/s\n", names[f], image.Width * image.Height / milliseconds / 1000.0);
+	}
+}
+
+int main() {
+	TestBlocks();
+	TestMips();
+	TestTiff();
+	TestCookedFiles();
+	BenchmarkEncode();
+	return TestResult("TextureCookerTest");
+}
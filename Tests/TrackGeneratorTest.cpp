@@ -0,0 +1,207 @@
+// Track generator: the same seed gives the same track with or
+// without the worker, lanes and jumps stay inside the rules,
+// and lane changes get more frequent as the difficulty ramps.
+// Then the platform pool's recycling order, and throughput:
+// pieces per second generated inline, taken from the worker's
+// ring, and a game-like run of the pool.
+//
+//   g++ -std=c++14 -O2 -pthread -I.. TrackGeneratorTest.cpp ../TrackGenerator.cpp -o TrackGeneratorTest && ./TrackGeneratorTest
+
+#include "TestCommon.h"
+#include "TrackGenerator.h"
+#include <stdlib.h>
+
+// Game::Init's rules
+static TrackRules GameRules(unsigned int seed) {
+	TrackRules rules = {};
+	rules.Seed = seed;
+	rules.LaneCount = 3;
+	rules.LaneWidth = 1.0f;
+	rules.Spacing = 2.0f;
+	rules.Height = -2.0f;
+	rules.ViewDistance = 10.0f;
+	rules.EasyCount = 5;
+	rules.HardCount = 80;
+	rules.LaneChangeEasy = 0.3f;
+	rules.LaneChangeHard = 0.9f;
+	rules.MaxJumpEasy = 1;
+	rules.MaxJumpHard = 2;
+	return rules;
+}
+
+static std::vector<TrackPiece> Take(const TrackRules& rules, bool useWorker, int count) {
+	TrackGenerator generator(rules, useWorker);
+	std::vector<TrackPiece> pieces(count);
+	for (int i = 0; i < count; i++)
+		pieces[i] = generator.TakePiece();
+	return pieces;
+}
+
+static bool Same(const std::vector<TrackPiece>& a, const std::vector<TrackPiece>& b) {
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); i++)
+		if (a[i].Sequence != b[i].Sequence || a[i].Lane != b[i].Lane || a[i].X != b[i].X || a[i].Y != b[i].Y)
+			return false;
+	return true;
+}
+
+static void TestDeterminism() {
+	TrackRules rules = GameRules(42);
+	std::vector<TrackPiece> inline1 = Take(rules, false, 5000);
+	CHECK(Same(inline1, Take(rules, false, 5000)));
+	CHECK(Same(inline1, Take(rules, true, 5000)));
+
+	rules.Seed = 43;
+	CHECK(!Same(inline1, Take(rules, false, 5000)));
+
+	// Seed 0 is allowed, it just can't be xorshift's state
+	rules.Seed = 0;
+	std::vector<TrackPiece> zero = Take(rules, false, 200);
+	int changes = 0;
+	for (size_t i = 1; i < zero.size(); i++)
+		changes += zero[i].Lane != zero[i - 1].Lane ? 1 : 0;
+	CHECK(changes > 20);
+}
+
+static void TestRules() {
+	for (unsigned int seed = 1; seed <= 20; seed++) {
+		TrackRules rules = GameRules(seed);
+		rules.LaneCount = 5;
+		rules.MaxJumpHard = 3;
+		std::vector<TrackPiece> pieces = Take(rules, false, 2000);
+		for (size_t i = 0; i < pieces.size(); i++) {
+			const TrackPiece& piece = pieces[i];
+			CHECK(piece.Sequence == (int)i);
+			CHECK(piece.Lane >= 0 && piece.Lane < rules.LaneCount);
+			CHECK(piece.X == piece.Lane * rules.LaneWidth && piece.Y == rules.Height);
+			if ((int)i < rules.EasyCount)
+				CHECK(piece.Lane == 0);
+			if (i == 0)
+				continue;
+
+			int jump = abs(piece.Lane - pieces[i - 1].Lane);
+			float difficulty = (int)i <= rules.EasyCount ? 0.0f : ((int)i - rules.EasyCount) / (float)(rules.HardCount - rules.EasyCount);
+			difficulty = difficulty > 1.0f ? 1.0f : difficulty;
+			int maxJump = rules.MaxJumpEasy + (int)((rules.MaxJumpHard - rules.MaxJumpEasy) * difficulty + 0.5f);
+			CHECK(jump <= maxJump);
+		}
+	}
+
+	// One lane never changes
+	TrackRules single = GameRules(7);
+	single.LaneCount = 1;
+	std::vector<TrackPiece> pieces = Take(single, false, 500);
+	for (size_t i = 0; i < pieces.size(); i++)
+		CHECK(pieces[i].Lane == 0);
+}
+
+// Over many seeds the share of pieces that change lane comes
+// close to the easy chance at the start of the ramp and the
+// hard chance past its end.  Small seeds like the game's 1 are
+// most of them, so this also catches xorshift starting tiny.
+static void TestDifficultyRamp() {
+	TrackRules rules = GameRules(1);
+	int easyChanges = 0, easyTotal = 0, hardChanges = 0, hardTotal = 0;
+	for (unsigned int seed = 1; seed <= 400; seed++) {
+		rules.Seed = seed;
+		std::vector<TrackPiece> pieces = Take(rules, false, 300);
+		for (int i = rules.EasyCount; i < rules.EasyCount + 5; i++) {
+			easyChanges += pieces[i].Lane != pieces[i - 1].Lane ? 1 : 0;
+			easyTotal++;
+		}
+		for (int i = rules.HardCount; i < 300; i++) {
+			hardChanges += pieces[i].Lane != pieces[i - 1].Lane ? 1 : 0;
+			hardTotal++;
+		}
+	}
+	float easy = easyChanges / (float)easyTotal;
+	float hard = hardChanges / (float)hardTotal;
+	CHECK(easy > 0.25f && easy < 0.40f);
+	CHECK(hard > 0.86f && hard < 0.94f);
+	printf("Lane changes: %.2f just past the easy start (rule %.2f), %.2f once hard (rule %.2f)\n",
+		easy, rules.LaneChangeEasy, hard, rules.LaneChangeHard);
+}
+
+static void TestPool() {
+	PlatformPool pool(5);
+	TrackGenerator generator(GameRules(1), false);
+	for (int i = 0; i < 5; i++)
+		CHECK(pool.Recycle(generator.TakePiece()) == i);
+	CHECK(pool.GetOldest() == 0 && pool.GetNewest() == 4);
+	CHECK(pool.GetReuseCount() == 0);
+
+	// Slots come back round in order, each newest when recycled
+	for (int i = 0; i < 12; i++) {
+		int slot = pool.Recycle(generator.TakePiece());
+		CHECK(slot == i % 5);
+		CHECK(pool.GetNewest() == slot);
+		CHECK(pool.GetPiece(slot).Sequence == 5 + i);
+	}
+	CHECK(pool.GetReuseCount() == 12);
+}
+
+// --------------------------------------------------------
+// Throughput
+// --------------------------------------------------------
+
+static void Benchmark() {
+	const int count = 2000000;
+	TrackRules rules = GameRules(9);
+
+	TrackGenerator inlineGenerator(rules, false);
+	auto start = std::chrono::steady_clock::now();
+	int laneSum = 0;
+	for (int i = 0; i < count; i++)
+		laneSum += inlineGenerator.TakePiece().Lane;
+	double inlineMilliseconds = ElapsedMilliseconds(start);
+
+	TrackGenerator workerGenerator(rules, true);
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < count; i++)
+		laneSum -= workerGenerator.TakePiece().Lane;
+	double workerMilliseconds = ElapsedMilliseconds(start);
+	TrackStats stats = workerGenerator.GetStats();
+	CHECK(laneSum == 0);
+	CHECK(stats.Taken == count && stats.Generated >= count);
+
+	printf("Inline: %.1f M pieces/s\n", count / inlineMilliseconds / 1000.0);
+	printf("Worker: %.1f M pieces/s taken flat out, waited %d times in %lld takes\n",
+		count / workerMilliseconds / 1000.0, stats.Waits, stats.Taken);
+
+	// The game's loop: five platforms sliding towards the camera,
+	// recycled onto the far end once they're behind it, at 60 Hz
+	// for an hour
+	PlatformPool pool(5);
+	std::vector<float> z(5);
+	TrackGenerator game(rules, true);
+	for (int i = 0; i < 5; i++) {
+		int slot = pool.Recycle(game.TakePiece());
+		z[slot] = i * rules.Spacing;
+	}
+	const int frames = 60 * 60 * 60;
+	start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < frames; frame++) {
+		for (int i = 0; i < 5; i++)
+			z[i] -= 2.01f / 60.0f;
+		while (z[pool.GetOldest()] < -2.0f) {
+			float farZ = z[pool.GetNewest()] + rules.Spacing;
+			int slot = pool.Recycle(game.TakePiece());
+			z[slot] = farZ;
+		}
+	}
+	double gameMilliseconds = ElapsedMilliseconds(start);
+	TrackStats gameStats = game.GetStats();
+	CHECK(pool.GetReuseCount() > 0 && pool.GetSize() == 5);
+	printf("An hour of play: %lld recycles into 5 slots, %d waits for the worker, %.3f us/frame\n",
+		pool.GetReuseCount(), gameStats.Waits, gameMilliseconds * 1000.0 / frames);
+}
+
+int main() {
+	TestDeterminism();
+	TestRules();
+	TestDifficultyRamp();
+	TestPool();
+	Benchmark();
+	return TestResult("TrackGeneratorTest");
+}
@@ -0,0 +1,244 @@
+// Retained UI: tessellated quads land where the elements are
+// with their texture coordinates and color, batches split only
+// on texture, changes rebuild just the layer they touch, and
+// hit testing finds the topmost element.  Then a headless
+// report of the game's menu and HUD: CPU time per frame and
+// bytes uploaded per frame, counted the way UIRenderer uploads
+// (a layer only when its version changed), next to what the
+// old SpriteBatch path sent every frame.
+//
+//   g++ -std=c++14 -O2 -I.. UITreeTest.cpp ../UITree.cpp ../TextLayout.cpp -o UITreeTest && ./UITreeTest
+
+#include "TestCommon.h"
+#include "UITree.h"
+
+// Stand ins for the renderer's shader resource views
+static int background, playButton, quitButton, scorePanel, fontSheet;
+
+static bool SameColor(const UIVertex& vertex, const float color[4]) {
+	for (int c = 0; c < 4; c++)
+		if (vertex.Color[c] != color[c])
+			return false;
+	return true;
+}
+
+static void TestTessellation() {
+	UITree tree;
+	tree.SetTextureSize(&fontSheet, 256, 128);
+	int group = tree.AddGroup(-1, 100.0f, 50.0f);
+	int image = tree.AddImage(group, &background, 10.0f, 20.0f, 64.0f, 32.0f);
+	int text = tree.AddText(group, &fontSheet, 5.0f, 5.0f, true);
+
+	TextRun run = {};
+	run.Scale = 2.0f;
+	TextQuad quad = { 3.0f, 4.0f, 32, 16, 40, 32 };
+	run.Quads.push_back(quad);
+	run.Quads.push_back(quad);
+	tree.SetText(text, run);
+
+	const float tint[4] = { 0.25f, 0.5f, 0.75f, 0.5f };
+	tree.SetColor(image, tint);
+	tree.Build();
+
+	const UILayer& layer = tree.GetStaticLayer();
+	CHECK(layer.Vertices.size() == 18 && tree.GetDynamicLayer().Vertices.empty());
+	CHECK(layer.Batches.size() == 2);
+	CHECK(layer.Batches[0].Texture == &background && layer.Batches[0].StartVertex == 0 && layer.Batches[0].VertexCount == 6);
+	CHECK(layer.Batches[1].Texture == &fontSheet && layer.Batches[1].StartVertex == 6 && layer.Batches[1].VertexCount == 12);
+
+	// The image: two clockwise triangles over its rectangle, every
+	// corner carrying the element's color
+	const UIVertex* v = layer.Vertices.data();
+	CHECK(v[0].X == 110.0f && v[0].Y == 70.0f && v[0].U == 0.0f && v[0].V == 0.0f);
+	CHECK(v[1].X == 174.0f && v[1].Y == 70.0f && v[1].U == 1.0f && v[1].V == 0.0f);
+	CHECK(v[2].X == 174.0f && v[2].Y == 102.0f && v[2].U == 1.0f && v[2].V == 1.0f);
+	CHECK(v[5].X == 110.0f && v[5].Y == 102.0f && v[5].U == 0.0f && v[5].V == 1.0f);
+	for (int i = 0; i < 6; i++)
+		CHECK(SameColor(v[i], tint));
+
+	// A glyph: scaled source size, sheet relative coordinates,
+	// default white
+	const float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	CHECK(v[6].X == 108.0f && v[6].Y == 59.0f && v[6].U == 32 / 256.0f && v[6].V == 16 / 128.0f);
+	CHECK(v[8].X == 124.0f && v[8].Y == 91.0f && v[8].U == 40 / 256.0f && v[8].V == 32 / 128.0f);
+	for (int i = 6; i < 18; i++)
+		CHECK(SameColor(v[i], white));
+
+	// Text on a sheet with no known size is left out
+	UITree unsized;
+	int orphan = unsized.AddText(-1, &fontSheet, 0.0f, 0.0f);
+	unsized.SetText(orphan, run);
+	unsized.Build();
+	CHECK(unsized.GetDynamicLayer().Vertices.empty());
+}
+
+static void TestRebuilds() {
+	UITree tree;
+	tree.SetTextureSize(&fontSheet, 256, 128);
+	int panel = tree.AddImage(-1, &scorePanel, 0.0f, 0.0f, 300.0f, 100.0f);
+	int group = tree.AddGroup(-1, 0.0f, 0.0f);
+	int score = tree.AddText(group, &fontSheet, 10.0f, 10.0f);
+	tree.Build();
+	unsigned int staticVersion = tree.GetStaticLayer().Version;
+	unsigned int dynamicVersion = tree.GetDynamicLayer().Version;
+
+	// Nothing changed, nothing rebuilt
+	tree.Build();
+	CHECK(tree.GetStaticLayer().Version == staticVersion && tree.GetDynamicLayer().Version == dynamicVersion);
+	CHECK(tree.GetBuildStats().ElementsTessellated == 0);
+
+	// Dynamic text leaves the static panel alone
+	TextRun run = {};
+	run.Scale = 1.0f;
+	TextQuad quad = { 0.0f, 0.0f, 0, 0, 8, 8 };
+	run.Quads.push_back(quad);
+	tree.SetText(score, run);
+	tree.Build();
+	CHECK(tree.GetStaticLayer().Version == staticVersion && tree.GetDynamicLayer().Version == ++dynamicVersion);
+	CHECK(tree.GetBuildStats().ElementsTessellated == 1 && tree.GetBuildStats().VerticesBuilt == 6);
+
+	// Moving a group to where it already is does nothing; moving
+	// it for real rebuilds the layer its child is in
+	tree.SetPosition(group, 0.0f, 0.0f);
+	tree.Build();
+	CHECK(tree.GetDynamicLayer().Version == dynamicVersion);
+	tree.SetPosition(group, 5.0f, 0.0f);
+	tree.Build();
+	CHECK(tree.GetStaticLayer().Version == staticVersion && tree.GetDynamicLayer().Version == ++dynamicVersion);
+	CHECK(tree.GetDynamicLayer().Vertices[0].X == 15.0f);
+
+	// Hiding the panel empties the static layer
+	tree.SetVisible(panel, false);
+	tree.Build();
+	CHECK(tree.GetStaticLayer().Version == ++staticVersion && tree.GetStaticLayer().Vertices.empty());
+	CHECK(tree.GetDynamicLayer().Version == dynamicVersion);
+
+	// A color change shows up on every vertex
+	const float red[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+	tree.SetColor(score, red);
+	tree.Build();
+	for (const UIVertex& vertex : tree.GetDynamicLayer().Vertices)
+		CHECK(SameColor(vertex, red));
+}
+
+static void TestHitTest() {
+	UITree tree;
+	int group = tree.AddGroup(-1, 100.0f, 100.0f);
+	int back = tree.AddImage(group, &background, 0.0f, 0.0f, 200.0f, 200.0f);
+	int front = tree.AddImage(group, &playButton, 50.0f, 50.0f, 50.0f, 50.0f);
+	int ignored = tree.AddImage(-1, &quitButton, 0.0f, 0.0f, 1000.0f, 1000.0f);
+	tree.SetHitTestable(back, true);
+	tree.SetHitTestable(front, true);
+	(void)ignored;
+
+	CHECK(tree.HitTest(160.0f, 160.0f) == front);
+	CHECK(tree.HitTest(150.0f, 150.0f) == front);
+	CHECK(tree.HitTest(200.0f, 200.0f) == back);		// Right and bottom edges are outside
+	CHECK(tree.HitTest(110.0f, 110.0f) == back);
+	CHECK(tree.HitTest(99.0f, 110.0f) == -1);
+
+	tree.SetVisible(front, false);
+	CHECK(tree.HitTest(160.0f, 160.0f) == back);
+	tree.SetVisible(group, false);
+	CHECK(tree.HitTest(160.0f, 160.0f) == -1);
+}
+
+// --------------------------------------------------------
+// Headless report
+// --------------------------------------------------------
+
+// What UIRenderer::UpdateBuffers sends for a tree this frame
+struct UploadTracker {
+	unsigned int StaticVersion;
+	unsigned int DynamicVersion;
+
+	int Update(UITree& tree) {
+		int bytes = 0;
+		if (StaticVersion != tree.GetStaticLayer().Version) {
+			bytes += (int)(sizeof(UIVertex) * tree.GetStaticLayer().Vertices.size());
+			StaticVersion = tree.GetStaticLayer().Version;
+		}
+		if (DynamicVersion != tree.GetDynamicLayer().Version) {
+			bytes += (int)(sizeof(UIVertex) * tree.GetDynamicLayer().Vertices.size());
+			DynamicVersion = tree.GetDynamicLayer().Version;
+		}
+		return bytes;
+	}
+};
+
+// Fixed width digits, like Arial's
+static TextGlyph FindGlyph(wchar_t character) {
+	int digit = character >= L'0' && character <= L'9' ? character - L'0' : 0;
+	TextGlyph glyph = { (uint32_t)character, digit * 12, 0, digit * 12 + 11, 22, 0.0f, 2.0f, 1.0f };
+	return glyph;
+}
+
+static void Report() {
+	// Game::CreateUI at 1280x720
+	UITree menu;
+	menu.AddImage(-1, &background, 0.0f, 0.0f, 1280.0f, 720.0f);
+	int play = menu.AddImage(-1, &playButton, 540.0f, 300.0f, 200.0f, 80.0f);
+	int quit = menu.AddImage(-1, &quitButton, 540.0f, 420.0f, 200.0f, 80.0f);
+	menu.SetHitTestable(play, true);
+	menu.SetHitTestable(quit, true);
+
+	UITree hud;
+	hud.AddImage(-1, &scorePanel, 40.0f, 10.0f, 400.0f, 120.0f);
+	hud.SetTextureSize(&fontSheet, 512, 256);
+	int scoreText = hud.AddText(-1, &fontSheet, 340.0f, 50.0f);
+	TextLayoutCache cache;
+
+	// A minute on the menu with the mouse moving, then ten of
+	// play with the score going up a few times a second
+	const int menuFrames = 60 * 60;
+	const int hudFrames = 60 * 60 * 10;
+	UploadTracker menuUpload = {}, hudUpload = {};
+	long long menuBytes = 0, hudBytes = 0;
+	int hits = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < menuFrames; frame++) {
+		hits += menu.HitTest((float)(frame % 1280), (float)(frame % 720)) >= 0 ? 1 : 0;
+		menu.Build();
+		menuBytes += menuUpload.Update(menu);
+	}
+	double menuMilliseconds = ElapsedMilliseconds(start);
+
+	int shownScore = -1;
+	start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < hudFrames; frame++) {
+		int score = frame / 20 * 10;
+		if (score != shownScore) {
+			wchar_t text[16];
+			FormatInteger(score, text, 16);
+			hud.SetText(scoreText, cache.Get(&fontSheet, text, 1.0f, 22.0f, FindGlyph));
+			shownScore = score;
+		}
+		hud.Build();
+		hudBytes += hudUpload.Update(hud);
+	}
+	double hudMilliseconds = ElapsedMilliseconds(start);
+	CHECK(hits > 0);
+
+	// The first frame uploads everything, after that only what changed
+	CHECK(menuBytes == (long long)sizeof(UIVertex) * 18);
+	CHECK(hudBytes < (long long)hudFrames * (long long)sizeof(UIVertex) * 6 * 6 / 10);
+
+	// SpriteBatch sent four 36 byte vertices per sprite per frame
+	const int spriteVertexBytes = 36;
+	double menuSpriteBytes = 3 * 4 * spriteVertexBytes;
+	double hudSpriteBytes = (1 + 4) * 4 * spriteVertexBytes;
+
+	printf("Menu: %.3f us/frame, %.1f bytes/frame uploaded (SpriteBatch: %.0f)\n",
+		menuMilliseconds * 1000.0 / menuFrames, menuBytes / (double)menuFrames, menuSpriteBytes);
+	printf("HUD:  %.3f us/frame, %.1f bytes/frame uploaded (SpriteBatch: about %.0f)\n",
+		hudMilliseconds * 1000.0 / hudFrames, hudBytes / (double)hudFrames, hudSpriteBytes);
+}
+
+int main() {
+	TestTessellation();
+	TestRebuilds();
+	TestHitTest();
+	Report();
+	return TestResult("UITreeTest");
+}
@@ -0,0 +1,278 @@
+// Vertex packing: octahedral normals decoded back within a
+// fixed angle of where they started - axes, diagonals and a
+// lot of random directions - and half floats against known
+// bit patterns (denormals, ties, overflow, NaN) plus every
+// half surviving a round trip.  Then how many bytes a vertex
+// takes in each bundled model, as a Vertex and packed.
+//
+//   g++ -std=c++14 -O2 -I.. VertexPackingTest.cpp ../VertexPacking.cpp ../MeshSimplifier.cpp -o VertexPackingTest && ./VertexPackingTest
+
+#include "TestCommon.h"
+#include "VertexPacking.h"
+#include "ObjModel.h"
+#include <math.h>
+#include <string>
+
+// Two 16 bit snorms put neighbouring codes 1/32767 apart on
+// the folded square.  With the closest of the four codes
+// around a point picked, the worst is near the middle of each
+// octant's face, where the square is stretched most - just
+// under 0.0025 degrees.  Rounding each axis on its own gets
+// to twice that.
+static const double OctErrorBound = 0.003;
+
+// A Vertex: float3 position, float3 normal, float2 UV,
+// float3 tangent
+static const int VertexFloats = 11;
+static const int VertexBytes = VertexFloats * 4;
+
+static unsigned int seed = 1;
+
+static unsigned int RandomBits() {
+	seed = seed * 1664525 + 1013904223;
+	return seed;
+}
+
+static float Random(float low, float high) {
+	return low + (high - low) * (RandomBits() >> 8) / 16777216.0f;
+}
+
+static double AngleDegrees(const float* a, const float* b) {
+	double cross[3] = {
+		(double)a[1] * b[2] - (double)a[2] * b[1],
+		(double)a[2] * b[0] - (double)a[0] * b[2],
+		(double)a[0] * b[1] - (double)a[1] * b[0] };
+	double sine = sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+	double cosine = (double)a[0] * b[0] + (double)a[1] * b[1] + (double)a[2] * b[2];
+	return atan2(sine, cosine) * (180.0 / 3.14159265358979);
+}
+
+static void Normalize(float* v) {
+	float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	for (int i = 0; i < 3; i++)
+		v[i] /= length;
+}
+
+// Encodes and decodes, returning the angle it moved
+static double RoundTrip(const float* vector) {
+	int16_t encoded[2];
+	float decoded[3];
+	OctEncode(vector, encoded);
+	OctDecode(encoded, decoded);
+	CHECK(fabsf(decoded[0] * decoded[0] + decoded[1] * decoded[1] + decoded[2] * decoded[2] - 1.0f) < 1e-5f);
+	return AngleDegrees(vector, decoded);
+}
+
+// --------------------------------------------------------
+// Octahedral encoding
+// --------------------------------------------------------
+static void TestOctahedral() {
+	// The six axes land on corners of the square or its
+	// middle, which are exact
+	double axisError = 0.0;
+	for (int axis = 0; axis < 3; axis++) {
+		for (int sign = -1; sign <= 1; sign += 2) {
+			float v[3] = { 0.0f, 0.0f, 0.0f };
+			v[axis] = (float)sign;
+			double error = RoundTrip(v);
+			axisError = error > axisError ? error : axisError;
+		}
+	}
+	CHECK(axisError < 1e-4);
+
+	// Corners of the cube and middles of its edges, which sit
+	// on the fold
+	double diagonalError = 0.0;
+	for (int x = -1; x <= 1; x++) {
+		for (int y = -1; y <= 1; y++) {
+			for (int z = -1; z <= 1; z++) {
+				if (x * x + y * y + z * z < 2)
+					continue;
+				float v[3] = { (float)x, (float)y, (float)z };
+				Normalize(v);
+				double error = RoundTrip(v);
+				diagonalError = error > diagonalError ? error : diagonalError;
+			}
+		}
+	}
+	CHECK(diagonalError < OctErrorBound);
+
+	// Uniform over the sphere
+	double randomError = 0.0;
+	const int count = 1000000;
+	for (int i = 0; i < count; i++) {
+		float z = Random(-1.0f, 1.0f);
+		float angle = Random(0.0f, 6.2831853f);
+		float ring = sqrtf(1.0f - z * z);
+		float v[3] = { ring * cosf(angle), ring * sinf(angle), z };
+		Normalize(v);
+		double error = RoundTrip(v);
+		randomError = error > randomError ? error : randomError;
+	}
+	CHECK(randomError < OctErrorBound);
+
+	// Not unit length still encodes the direction, zero falls
+	// back to +x
+	float scaled[3] = { 0.0f, -3.0f, 4.0f };
+	float unit[3] = { 0.0f, -0.6f, 0.8f };
+	int16_t a[2], b[2];
+	OctEncode(scaled, a);
+	OctEncode(unit, b);
+	CHECK(a[0] == b[0] && a[1] == b[1]);
+	float zero[3] = { 0.0f, 0.0f, 0.0f };
+	float decoded[3];
+	OctEncode(zero, a);
+	OctDecode(a, decoded);
+	CHECK(decoded[0] > 0.9999f);
+
+	printf("Octahedral worst error (bound %.4f degrees): axes %.6f, diagonals %.6f, %d random %.6f\n",
+		OctErrorBound, axisError, diagonalError, count, randomError);
+}
+
+// --------------------------------------------------------
+// Half floats
+// --------------------------------------------------------
+static float FromBits(uint32_t bits) {
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static void TestHalf() {
+	// Exact values
+	CHECK(FloatToHalf(0.0f) == 0x0000);
+	CHECK(FloatToHalf(-0.0f) == 0x8000);
+	CHECK(FloatToHalf(1.0f) == 0x3C00);
+	CHECK(FloatToHalf(-2.0f) == 0xC000);
+	CHECK(FloatToHalf(0.5f) == 0x3800);
+	CHECK(FloatToHalf(65504.0f) == 0x7BFF);
+	CHECK(HalfToFloat(0x7BFF) == 65504.0f);
+	CHECK(HalfToFloat(0x3555) == 0.333251953125f);
+
+	// Denormals: the smallest, the largest, and the smallest
+	// normal just above
+	CHECK(FloatToHalf(ldexpf(1.0f, -24)) == 0x0001);
+	CHECK(HalfToFloat(0x0001) == ldexpf(1.0f, -24));
+	CHECK(FloatToHalf(ldexpf(1023.0f, -24)) == 0x03FF);
+	CHECK(HalfToFloat(0x03FF) == ldexpf(1023.0f, -24));
+	CHECK(FloatToHalf(ldexpf(1.0f, -14)) == 0x0400);
+	CHECK(HalfToFloat(0x8200) == -ldexpf(1.0f, -15));
+
+	// Rounding to nearest, ties to even - in the normal range,
+	// in the denormals, and up out of them
+	CHECK(FloatToHalf(1.0f + ldexpf(1.0f, -11)) == 0x3C00);
+	CHECK(FloatToHalf(1.0f + ldexpf(3.0f, -11)) == 0x3C02);
+	CHECK(FloatToHalf(1.0f + ldexpf(1.0f, -11) + ldexpf(1.0f, -20)) == 0x3C01);
+	CHECK(FloatToHalf(ldexpf(1.0f, -25)) == 0x0000);
+	CHECK(FloatToHalf(ldexpf(3.0f, -25)) == 0x0002);
+	CHECK(FloatToHalf(ldexpf(1.5f, -25)) == 0x0001);
+	CHECK(FloatToHalf(ldexpf(1.0f, -26)) == 0x0000);
+	CHECK(FloatToHalf(ldexpf(2047.0f, -25)) == 0x0400);
+	CHECK(FloatToHalf(2047.0f / 1024.0f * 0.9999999f) == 0x3FFF);
+	CHECK(FloatToHalf(4095.0f / 2048.0f) == 0x4000);
+
+	// Overflow: 65520 is halfway to the next exponent and
+	// rounds to infinity, anything below stays finite
+	CHECK(FloatToHalf(65519.0f) == 0x7BFF);
+	CHECK(FloatToHalf(65520.0f) == 0x7C00);
+	CHECK(FloatToHalf(-1e10f) == 0xFC00);
+	CHECK(FloatToHalf(FromBits(0x7F800000)) == 0x7C00);
+	CHECK(FloatToHalf(FromBits(0xFF800000)) == 0xFC00);
+	CHECK(HalfToFloat(0x7C00) == FromBits(0x7F800000));
+
+	// NaN stays NaN, even one whose payload is all in the bits
+	// a half drops
+	CHECK((FloatToHalf(FromBits(0x7FC00000)) & 0x7C00) == 0x7C00 && (FloatToHalf(FromBits(0x7FC00000)) & 0x3FF) != 0);
+	CHECK((FloatToHalf(FromBits(0x7F800001)) & 0x3FF) != 0);
+	CHECK(isnan(HalfToFloat(0x7E00)));
+	CHECK(isnan(HalfToFloat(0xFC01)));
+
+	// Every half comes back as itself
+	int mismatches = 0;
+	for (uint32_t h = 0; h < 0x10000; h++) {
+		float value = HalfToFloat((uint16_t)h);
+		bool isNan = (h & 0x7C00) == 0x7C00 && (h & 0x3FF) != 0;
+		if (isNan)
+			mismatches += isnan(value) ? 0 : 1;
+		else
+			mismatches += FloatToHalf(value) == h ? 0 : 1;
+	}
+	CHECK(mismatches == 0);
+
+	// Random floats land on the nearest half
+	double worstRelative = 0.0;
+	for (int i = 0; i < 1000000; i++) {
+		float value = ldexpf(Random(1.0f, 2.0f), (int)(RandomBits() % 29) - 14);
+		if (RandomBits() & 1)
+			value = -value;
+		float back = HalfToFloat(FloatToHalf(value));
+		double relative = fabs((double)back - value) / fabs((double)value);
+		worstRelative = relative > worstRelative ? relative : worstRelative;
+	}
+	CHECK(worstRelative <= ldexp(1.0, -11));
+
+	printf("Half floats: every half round trips, worst relative error over normals %.3g (bound %.3g)\n",
+		worstRelative, ldexp(1.0, -11));
+}
+
+// --------------------------------------------------------
+// The bundled models, as Vertex and as PackedVertex
+// --------------------------------------------------------
+static void TestModels() {
+	CHECK(sizeof(PackedVertex) == 24);
+
+	const char* names[] = { "cube.obj", "cone.obj", "cylinder.obj", "sphere.obj", "torus.obj", "helix.obj" };
+	printf("Model         Verts  Bytes/vertex  Vertex bytes -> packed   Normal error  UV error\n");
+	for (const char* name : names) {
+		std::vector<float> loaded;
+		std::vector<unsigned int> indices;
+		std::string path = std::string("../Debug/Models/") + name;
+		CHECK(LoadObj(path.c_str(), loaded, indices));
+		if (loaded.empty())
+			continue;
+
+		// Lay them out like Vertex, with any tangent at right
+		// angles to the normal - the OBJs don't carry one
+		int count = (int)(loaded.size() / ObjVertexFloats);
+		std::vector<float> vertices(count * VertexFloats);
+		for (int v = 0; v < count; v++) {
+			const float* in = &loaded[v * ObjVertexFloats];
+			float* out = &vertices[v * VertexFloats];
+			for (int k = 0; k < 8; k++)
+				out[k] = in[k];
+			Normalize(out + 3);
+			const float* normal = out + 3;
+			float axis[3] = { 0.0f, 0.0f, 0.0f };
+			axis[fabsf(normal[0]) < 0.9f ? 0 : 1] = 1.0f;
+			float along = axis[0] * normal[0] + axis[1] * normal[1] + axis[2] * normal[2];
+			for (int k = 0; k < 3; k++)
+				out[8 + k] = axis[k] - normal[k] * along;
+			Normalize(out + 8);
+		}
+
+		std::vector<PackedVertex> packed(count);
+		VertexPackingStats stats;
+		PackVertices(vertices.data(), VertexFloats, count, packed.data(), &stats);
+		CHECK(stats.MaxNormalError < OctErrorBound);
+		CHECK(stats.MaxTangentError < OctErrorBound);
+		// Half a step of the biggest UV's exponent
+		float largestUV = 0.0f;
+		for (int v = 0; v < count; v++) {
+			for (int k = 6; k < 8; k++)
+				largestUV = fabsf(vertices[v * VertexFloats + k]) > largestUV ? fabsf(vertices[v * VertexFloats + k]) : largestUV;
+		}
+		CHECK(stats.MaxUVError <= largestUV * ldexpf(1.0f, -11));
+
+		printf("%-12s %6d  %2d -> %2d      %7d -> %7d   %9.6f  %9.6f\n",
+			name, count, VertexBytes, (int)sizeof(PackedVertex),
+			count * VertexBytes, count * (int)sizeof(PackedVertex),
+			stats.MaxNormalError, stats.MaxUVError);
+	}
+}
+
+int main() {
+	TestOctahedral();
+	TestHalf();
+	TestModels();
+	return TestResult("VertexPackingTest");
+}
@@ -0,0 +1,160 @@
+#include "TextLayout.h"
+#include <wchar.h>
+#include <wctype.h>
+
+// --------------------------------------------------------
+// Mirrors SpriteFont::Impl::ForEachGlyph and the placement
+// in SpriteFont::DrawString (no rotation or effects)
+// --------------------------------------------------------
+void LayoutText(const wchar_t* text, float scale, float lineSpacing, const TextGlyphLookup& findGlyph, TextRun& run)
+{
+	run.Quads.clear();
+	run.Scale = scale;
+	run.Width = 0.0f;
+	run.Height = 0.0f;
+
+	float x = 0.0f;
+	float y = 0.0f;
+	for (; *text; text++)
+	{
+		wchar_t character = *text;
+		if (character == L'\r')
+			continue;
+
+		if (character == L'\n')
+		{
+			x = 0.0f;
+			y += lineSpacing;
+			continue;
+		}
+
+		TextGlyph glyph = findGlyph(character);
+
+		x += glyph.XOffset;
+		if (x < 0.0f)
+			x = 0.0f;
+
+		int width = glyph.Right - glyph.Left;
+		int height = glyph.Bottom - glyph.Top;
+		float advance = width + glyph.XAdvance;
+
+		// Spaces take room but don't draw anything
+		if (!iswspace(character) || width > 1 || height > 1)
+		{
+			TextQuad quad;
+			quad.X = x * scale;
+			quad.Y = (y + glyph.YOffset) * scale;
+			quad.Left = glyph.Left;
+			quad.Top = glyph.Top;
+			quad.Right = glyph.Right;
+			quad.Bottom = glyph.Bottom;
+			run.Quads.push_back(quad);
+
+			// Bounds of the drawn glyphs, like MeasureString
+			float bottom = height + glyph.YOffset;
+			if (bottom < lineSpacing)
+				bottom = lineSpacing;
+			if (x + width > run.Width)
+				run.Width = x + width;
+			if (y + bottom > run.Height)
+				run.Height = y + bottom;
+		}
+
+		x += advance;
+	}
+
+	run.Width *= scale;
+	run.Height *= scale;
+}
+
+int FormatInteger(int value, wchar_t* buffer, int bufferSize)
+{
+	if (bufferSize <= 0)
+		return 0;
+
+	// Digits come out backwards
+	wchar_t digits[12];
+	int count = 0;
+	unsigned int magnitude = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+	do
+	{
+		digits[count++] = (wchar_t)(L'0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude > 0);
+
+	int length = 0;
+	if (value < 0 && length < bufferSize - 1)
+		buffer[length++] = L'-';
+	while (count > 0 && length < bufferSize - 1)
+		buffer[length++] = digits[--count];
+
+	buffer[length] = 0;
+	return length;
+}
+
+// --------------------------------------------------------
+// TextLayoutCache
+// --------------------------------------------------------
+
+TextLayoutCache::TextLayoutCache(int maxEntries)
+{
+	this->maxEntries = maxEntries;
+	hits = 0;
+	misses = 0;
+}
+
+TextLayoutCache::~TextLayoutCache()
+{
+}
+
+void TextLayoutCache::Clear()
+{
+	entries.clear();
+}
+
+// FNV-1a over the font, scale, line spacing and characters
+uint64_t TextLayoutCache::Hash(const void* font, const wchar_t* text, float scale, float lineSpacing)
+{
+	uint64_t hash = 14695981039346656037ull;
+	auto mix = [&hash](const void* data, size_t size) {
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+	};
+
+	mix(&font, sizeof(font));
+	mix(&scale, sizeof(scale));
+	mix(&lineSpacing, sizeof(lineSpacing));
+	mix(text, wcslen(text) * sizeof(wchar_t));
+	return hash;
+}
+
+const TextRun& TextLayoutCache::Get(const void* font, const wchar_t* text, float scale, float lineSpacing, const TextGlyphLookup& findGlyph)
+{
+	uint64_t hash = Hash(font, text, scale, lineSpacing);
+
+	auto range = entries.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		Entry& entry = it->second;
+		if (entry.Font == font && entry.Run.Scale == scale && entry.LineSpacing == lineSpacing && entry.Text == text)
+		{
+			hits++;
+			return entry.Run;
+		}
+	}
+
+	misses++;
+	if ((int)entries.size() >= maxEntries)
+		entries.clear();
+
+	Entry entry;
+	entry.Font = font;
+	entry.Text = text;
+	entry.LineSpacing = lineSpacing;
+	LayoutText(text, scale, lineSpacing, findGlyph, entry.Run);
+	return entries.insert(std::make_pair(hash, entry))->second.Run;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// --------------------------------------------------------
+// Text layout done once and reused
+//
+// LayoutText places glyphs exactly the way SpriteFont's
+// DrawString does, but keeps the result - one quad per
+// visible glyph - so text that doesn't change from frame to
+// frame skips the glyph lookups and layout.  The cache keys
+// runs on font, text, scale and line spacing.
+//
+// Nothing here touches D3D - SpriteText feeds the quads to a
+// SpriteBatch.
+// --------------------------------------------------------
+
+// Same fields as SpriteFont::Glyph
+struct TextGlyph {
+	uint32_t Character;
+	int Left;
+	int Top;
+	int Right;
+	int Bottom;
+	float XOffset;
+	float YOffset;
+	float XAdvance;
+};
+
+// One glyph, positioned relative to the text's origin and
+// already scaled
+struct TextQuad {
+	float X;
+	float Y;
+	int Left;		// Source rectangle in the font's sprite sheet
+	int Top;
+	int Right;
+	int Bottom;
+};
+
+struct TextRun {
+	std::vector<TextQuad> Quads;
+	float Scale;
+	float Width;	// Same as SpriteFont::MeasureString, scaled
+	float Height;
+};
+
+// Finds a character's glyph, or the font's default one
+typedef std::function<TextGlyph(wchar_t)> TextGlyphLookup;
+
+void LayoutText(const wchar_t* text, float scale, float lineSpacing, const TextGlyphLookup& findGlyph, TextRun& run);
+
+// Writes value into buffer without allocating, returns the
+// length (the text is cut short if buffer is too small)
+int FormatInteger(int value, wchar_t* buffer, int bufferSize);
+
+class TextLayoutCache {
+public:
+	// Everything is dropped when it fills up - UI text rarely
+	// has more than a handful of strings live at once
+	TextLayoutCache(int maxEntries = 256);
+	~TextLayoutCache();
+
+	// font only identifies the font, it's never dereferenced.
+	// findGlyph is only called when the run isn't cached yet.
+	const TextRun& Get(const void* font, const wchar_t* text, float scale, float lineSpacing, const TextGlyphLookup& findGlyph);
+
+	void Clear();
+
+	int GetHits() { return hits; }
+	int GetMisses() { return misses; }
+
+private:
+	struct Entry {
+		const void* Font;
+		std::wstring Text;
+		float LineSpacing;
+		TextRun Run;
+	};
+
+	std::unordered_multimap<uint64_t, Entry> entries;
+	int maxEntries;
+	int hits;
+	int misses;
+
+	static uint64_t Hash(const void* font, const wchar_t* text, float scale, float lineSpacing);
+};
@@ -0,0 +1,138 @@
+#include "TextureLoader.h"
+#include "WICTextureLoader.h"
+#include "DDSTextureLoader.h"
+#include "MappedDDSLoader.h"
+#include <stdio.h>
+
+using namespace DirectX;
+
+TextureLoader::TextureLoader(ID3D11Device* _device, ID3D11DeviceContext* _context) {
+	device = _device;
+	context = _context;
+
+	skipMips = 0;
+	totalLoadSeconds = 0;
+	totalBytes = 0;
+	cookedCount = 0;
+	sourceCount = 0;
+
+	__int64 perfFreq;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&perfFreq);
+	perfCounterSeconds = 1.0 / (double)perfFreq;
+}
+
+TextureLoader::~TextureLoader() {
+}
+
+// --------------------------------------------------------
+// Loads a texture, using the cooked DDS version if there is one
+// --------------------------------------------------------
+HRESULT TextureLoader::LoadTexture(const wchar_t* fileName, ID3D11ShaderResourceView** srv) {
+	__int64 start;
+	QueryPerformanceCounter((LARGE_INTEGER*)&start);
+
+	// Cooked textures already contain their mips, so they are created
+	// straight from a file mapping with no decode and no context
+	std::wstring cooked = GetCookedFileName(fileName);
+	HRESULT hr = CreateMappedDDSTextureFromFile(device, cooked.c_str(), srv, skipMips);
+	if (SUCCEEDED(hr)) {
+		cookedCount++;
+	} else {
+		// Fall back to the source image (mips are generated on the GPU)
+		hr = CreateWICTextureFromFile(device, context, fileName, 0, srv);
+		if (SUCCEEDED(hr))
+			sourceCount++;
+	}
+
+	__int64 end;
+	QueryPerformanceCounter((LARGE_INTEGER*)&end);
+	totalLoadSeconds += (end - start) * perfCounterSeconds;
+
+	if (SUCCEEDED(hr))
+		totalBytes += CalculateResourceBytes(*srv);
+
+	return hr;
+}
+
+void TextureLoader::PrintStats() {
+	printf("\nTextures: %d cooked, %d source, %.1f ms, %.2f MB\n",
+		cookedCount,
+		sourceCount,
+		totalLoadSeconds * 1000.0,
+		totalBytes / (1024.0 * 1024.0));
+}
+
+// --------------------------------------------------------
+// Estimates the memory used by the texture behind an SRV,
+// including all of its mips and array slices
+// --------------------------------------------------------
+size_t TextureLoader::CalculateResourceBytes(ID3D11ShaderResourceView* srv) {
+	ID3D11Resource* resource = 0;
+	srv->GetResource(&resource);
+
+	ID3D11Texture2D* texture = 0;
+	HRESULT hr = resource->QueryInterface(__uuidof(ID3D11Texture2D), (void**)&texture);
+	resource->Release();
+	if (FAILED(hr))
+		return 0;
+
+	D3D11_TEXTURE2D_DESC desc;
+	texture->GetDesc(&desc);
+	texture->Release();
+
+	// Bytes per 4x4 block for compressed formats, per pixel otherwise
+	size_t blockBytes = 0;
+	size_t pixelBytes = 4;
+	switch (desc.Format) {
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		blockBytes = 8;
+		break;
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		blockBytes = 16;
+		break;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+		pixelBytes = 8;
+		break;
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		pixelBytes = 16;
+		break;
+	default:
+		break;
+	}
+
+	size_t bytes = 0;
+	UINT w = desc.Width;
+	UINT h = desc.Height;
+	for (UINT mip = 0; mip < desc.MipLevels; mip++) {
+		if (blockBytes)
+			bytes += ((w + 3) / 4) * ((h + 3) / 4) * blockBytes;
+		else
+			bytes += w * h * pixelBytes;
+
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+	}
+	return bytes * desc.ArraySize;
+}
+
+// --------------------------------------------------------
+// Swaps the extension of a source image for ".dds"
+// --------------------------------------------------------
+std::wstring TextureLoader::GetCookedFileName(const wchar_t* fileName) {
+	std::wstring name = fileName;
+	size_t dot = name.find_last_of(L'.');
+	if (dot != std::wstring::npos)
+		name.erase(dot);
+	return name + L".dds";
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <d3d11.h>
+#include <string>
+
+// --------------------------------------------------------
+// Loads material textures, preferring offline-cooked DDS files
+//
+// For every source image (e.g. "Grass.tiff") the loader first
+// looks for a cooked "Grass.dds" next to it.  Cooked files are
+// block compressed (BC1 for opaque albedo, BC3 when alpha is used,
+// BC5 for the *_Normal maps) and carry a full mip chain, so they
+// skip the WIC decode and need 1/4 - 1/8 of the VRAM.  They're
+// produced by Tools/TextureCooker, for example:
+//   TextureCooker Grass.tiff Grass.dds
+//   TextureCooker --normal Grass_Normal.tiff Grass_Normal.dds
+// If no cooked file exists the source image is decoded through WIC.
+// --------------------------------------------------------
+class TextureLoader {
+public:
+	TextureLoader(ID3D11Device* device, ID3D11DeviceContext* context);
+	~TextureLoader();
+
+	HRESULT LoadTexture(const wchar_t* fileName, ID3D11ShaderResourceView** srv);
+
+	// Low memory mode: drop this many of the most detailed mips of cooked textures
+	void SetSkipMips(unsigned int mips) { skipMips = mips; }
+
+	// Load statistics, accumulated over every LoadTexture call
+	void PrintStats();
+	double GetTotalLoadSeconds() { return totalLoadSeconds; }
+	size_t GetTotalBytes() { return totalBytes; }
+
+	static size_t CalculateResourceBytes(ID3D11ShaderResourceView* srv);
+	static std::wstring GetCookedFileName(const wchar_t* fileName);
+
+private:
+	ID3D11Device* device;
+	ID3D11DeviceContext* context;
+
+	unsigned int skipMips;
+
+	double perfCounterSeconds;
+	double totalLoadSeconds;
+	size_t totalBytes;
+	int cookedCount;
+	int sourceCount;
+};
@@ -0,0 +1,111 @@
+#include "TextureStreamer.h"
+#include "TextureLoader.h"
+#include "MappedDDSLoader.h"
+#include "DDSLayout.h"
+
+using namespace DirectX;
+
+TextureStreamer::TextureStreamer(ID3D11Device* _device, size_t budgetBytes)
+	: policy(budgetBytes) {
+	device = _device;
+	this->budgetBytes = budgetBytes;
+	reservedBytes = 0;
+}
+
+TextureStreamer::~TextureStreamer() {
+}
+
+bool TextureStreamer::Register(const wchar_t* sourceFile, Material* material, bool isNormalMap, ID3D11ShaderResourceView** srvSlot) {
+	std::wstring cooked = TextureLoader::GetCookedFileName(sourceFile);
+
+	// Only the header is needed to know the mip sizes
+	MappedFile file;
+	if (!file.Open(cooked.c_str()))
+		return false;
+
+	DDSLayout layout;
+	if (!ParseDDSLayout(file.GetData(), file.GetSize(), layout) || layout.IsCubeMap)
+		return false;
+
+	std::vector<size_t> mipBytes;
+	for (UINT mip = 0; mip < layout.MipCount; mip++)
+		mipBytes.push_back(layout.Subresources[mip].Size * layout.ArraySize);
+
+	StreamedTexture texture;
+	texture.FileName = cooked;
+	texture.Owner = material;
+	texture.IsNormalMap = isNormalMap;
+	texture.SRVSlot = srvSlot;
+	texture.PolicyID = policy.AddTexture(layout.Width, mipBytes, 0);
+	textures.push_back(texture);
+	return true;
+}
+
+void TextureStreamer::BeginFrame() {
+	policy.BeginFrame();
+}
+
+void TextureStreamer::RequestMaterial(Material* material, float screenPixels) {
+	for (size_t i = 0; i < textures.size(); i++) {
+		if (textures[i].Owner == material)
+			policy.RequestScreenSize(textures[i].PolicyID, screenPixels);
+	}
+}
+
+void TextureStreamer::SetReservedBytes(size_t bytes) {
+	reservedBytes = bytes;
+	policy.SetBudget(budgetBytes > bytes ? budgetBytes - bytes : 0);
+}
+
+bool TextureStreamer::Update(std::vector<Material*>* replaced) {
+	policy.Update(changes);
+
+	bool anyReplaced = false;
+	for (size_t c = 0; c < changes.size(); c++) {
+		StreamedTexture* texture = 0;
+		for (size_t i = 0; i < textures.size(); i++) {
+			if (textures[i].PolicyID == changes[c].TextureID)
+				texture = &textures[i];
+		}
+		if (!texture)
+			continue;
+
+		// Recreate with the new top mip; keep the old one if that fails
+		ID3D11ShaderResourceView* srv = 0;
+		if (FAILED(CreateMappedDDSTextureFromFile(device, texture->FileName.c_str(), &srv, changes[c].TopMip)))
+			continue;
+
+		(*texture->SRVSlot)->Release();
+		*texture->SRVSlot = srv;
+		if (texture->IsNormalMap)
+			texture->Owner->SetNormalSRV(srv);
+		else
+			texture->Owner->SetMaterialSRV(srv);
+
+		policy.SetResident(changes[c].TextureID, changes[c].TopMip);
+		if (replaced)
+			replaced->push_back(texture->Owner);
+		anyReplaced = true;
+	}
+	return anyReplaced;
+}
+
+float TextureStreamer::ProjectedSize(GameEntity* entity, Camera* camera, float screenHeight) {
+	XMFLOAT3 position = entity->GetPosition();
+	XMFLOAT3 scale = entity->GetScale();
+	float maxScale = max(scale.x, max(scale.y, scale.z));
+	float radius = entity->GetMesh()->GetBoundingRadius() * maxScale;
+
+	// Camera matrices are stored transposed for HLSL
+	XMFLOAT4X4 view = camera->GetView();
+	XMFLOAT4X4 proj = camera->GetProjection();
+	XMVECTOR viewPos = XMVector3Transform(XMLoadFloat3(&position), XMMatrixTranspose(XMLoadFloat4x4(&view)));
+
+	// Entirely behind the camera
+	float depth = XMVectorGetZ(viewPos);
+	if (depth + radius <= 0)
+		return 0;
+	depth = max(depth, 0.1f);
+
+	return radius * proj._22 / depth * screenHeight;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <d3d11.h>
+#include <string>
+#include <vector>
+#include "MipStreamingPolicy.h"
+#include "Material.h"
+#include "GameEntity.h"
+#include "Camera.h"
+
+// --------------------------------------------------------
+// Streams mips of cooked material textures in and out
+//
+// Every frame the game reports how big each entity appears on
+// screen; MipStreamingPolicy decides which textures need more or
+// fewer mips under the budget, and the chosen textures are
+// recreated from their mapped DDS files with the matching number
+// of top mips skipped.  Only textures with a cooked DDS stream;
+// anything loaded through WIC stays fully resident.
+// --------------------------------------------------------
+class TextureStreamer {
+public:
+	TextureStreamer(ID3D11Device* device, size_t budgetBytes);
+	~TextureStreamer();
+
+	// srvSlot - Where the texture's current SRV lives.  It is released
+	//           and replaced whenever the texture is restreamed.
+	bool Register(const wchar_t* sourceFile, Material* material, bool isNormalMap, ID3D11ShaderResourceView** srvSlot);
+
+	void BeginFrame();
+	void RequestMaterial(Material* material, float screenPixels);
+
+	// True if any texture was replaced.  replaced, if given,
+	// gets the materials whose textures were.
+	bool Update(std::vector<Material*>* replaced = 0);
+
+	// Memory the same budget has to cover that isn't streamed
+	// (MaterialTable's arrays), taken off what textures get
+	void SetReservedBytes(size_t bytes);
+
+	size_t GetResidentBytes() { return policy.GetResidentBytes(); }
+	size_t GetReservedBytes() { return reservedBytes; }
+
+	// Height in pixels of an entity's bounding sphere on screen
+	static float ProjectedSize(GameEntity* entity, Camera* camera, float screenHeight);
+
+private:
+	struct StreamedTexture {
+		std::wstring FileName;
+		Material* Owner;
+		bool IsNormalMap;
+		ID3D11ShaderResourceView** SRVSlot;
+		int PolicyID;
+	};
+
+	ID3D11Device* device;
+	MipStreamingPolicy policy;
+	size_t budgetBytes;
+	size_t reservedBytes;
+	std::vector<StreamedTexture> textures;
+	std::vector<MipChange> changes;
+};
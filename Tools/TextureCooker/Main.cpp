@@ -0,0 +1,52 @@
+// Cooks one source texture into a block compressed DDS:
+//
+//   TextureCooker [--normal] Grass.tiff Grass.dds
+//
+// Build anywhere with
+//   g++ -std=c++14 -O2 Main.cpp TextureCooker.cpp TiffReader.cpp -o TextureCooker
+
+#include "TextureCooker.h"
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+int main(int argc, char** argv) {
+	bool normalMap = false;
+	int first = 1;
+	if (argc > 1 && strcmp(argv[1], "--normal") == 0) {
+		normalMap = true;
+		first = 2;
+	}
+	if (argc - first != 2) {
+		printf("usage: TextureCooker [--normal] input output\n");
+		return 1;
+	}
+	const char* input = argv[first];
+	const char* output = argv[first + 1];
+
+	auto start = std::chrono::steady_clock::now();
+	CookerImage image;
+	std::string error;
+	if (!ReadTiff(input, image, error)) {
+		printf("%s: %s\n", input, error.c_str());
+		return 1;
+	}
+	double readMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	CookedTexture cooked;
+	CookerTimings timings;
+	CookTexture(image, normalMap, cooked, &timings);
+	if (!WriteDDS(output, cooked)) {
+		printf("%s: can't write\n", output);
+		return 1;
+	}
+
+	const char* formats[] = { "BC1", "BC3", "BC5" };
+	size_t bytes = 0;
+	for (size_t i = 0; i < cooked.Mips.size(); i++)
+		bytes += cooked.Mips[i].size();
+	printf("%s -> %s: %dx%d %s, %d mips, %zu bytes (read %.1f ms, mips %.1f ms, encode %.1f ms)\n",
+		input, output, cooked.Width, cooked.Height, formats[cooked.Format], (int)cooked.Mips.size(), bytes,
+		readMilliseconds, timings.MipMilliseconds, timings.EncodeMilliseconds);
+	return 0;
+}
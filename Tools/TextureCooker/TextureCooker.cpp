@@ -0,0 +1,532 @@
+#include "TextureCooker.h"
+#include <chrono>
+#include <fstream>
+#include <math.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define TEXTURE_COOKER_SSE
+#endif
+
+// --------------------------------------------------------
+// Colour space
+// --------------------------------------------------------
+
+static float SRGBToLinear(float value) {
+	return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSRGB(float value) {
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+static uint8_t ToByte(float value) {
+	value = value < 0 ? 0 : (value > 1 ? 1 : value);
+	return (uint8_t)(value * 255.0f + 0.5f);
+}
+
+static void Normalize(float* v) {
+	float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	if (length > 0) {
+		v[0] /= length;
+		v[1] /= length;
+		v[2] /= length;
+	}
+}
+
+// --------------------------------------------------------
+// Mips
+// --------------------------------------------------------
+
+void GenerateMips(const CookerImage& image, bool normalMap, std::vector<CookerLevel>& levels) {
+	float toLinear[256];
+	for (int i = 0; i < 256; i++)
+		toLinear[i] = normalMap ? i / 255.0f * 2.0f - 1.0f : SRGBToLinear(i / 255.0f);
+
+	levels.clear();
+	levels.resize(1);
+	CookerLevel& top = levels[0];
+	top.Width = image.Width;
+	top.Height = image.Height;
+	top.Pixels.resize((size_t)image.Width * image.Height * 4);
+	for (size_t p = 0; p < (size_t)image.Width * image.Height; p++) {
+		const uint8_t* source = &image.Pixels[p * 4];
+		float* dest = &top.Pixels[p * 4];
+		dest[0] = toLinear[source[0]];
+		dest[1] = toLinear[source[1]];
+		dest[2] = toLinear[source[2]];
+		dest[3] = source[3] / 255.0f;
+		if (normalMap)
+			Normalize(dest);
+	}
+
+	// Each level from the one above, never from bytes, so
+	// rounding doesn't build up down the chain.  An odd edge
+	// repeats its last texel.
+	while (levels.back().Width > 1 || levels.back().Height > 1) {
+		const CookerLevel& above = levels.back();
+		CookerLevel level;
+		level.Width = above.Width > 1 ? above.Width / 2 : 1;
+		level.Height = above.Height > 1 ? above.Height / 2 : 1;
+		level.Pixels.resize((size_t)level.Width * level.Height * 4);
+
+		for (int y = 0; y < level.Height; y++) {
+			int y0 = y * 2;
+			int y1 = y0 + 1 < above.Height ? y0 + 1 : above.Height - 1;
+			for (int x = 0; x < level.Width; x++) {
+				int x0 = x * 2;
+				int x1 = x0 + 1 < above.Width ? x0 + 1 : above.Width - 1;
+				const float* a = &above.Pixels[((size_t)y0 * above.Width + x0) * 4];
+				const float* b = &above.Pixels[((size_t)y0 * above.Width + x1) * 4];
+				const float* c = &above.Pixels[((size_t)y1 * above.Width + x0) * 4];
+				const float* d = &above.Pixels[((size_t)y1 * above.Width + x1) * 4];
+				float* dest = &level.Pixels[((size_t)y * level.Width + x) * 4];
+				for (int i = 0; i < 4; i++)
+					dest[i] = (a[i] + b[i] + c[i] + d[i]) * 0.25f;
+				if (normalMap)
+					Normalize(dest);
+			}
+		}
+		levels.push_back(level);
+	}
+}
+
+void ConvertLevel(const CookerLevel& level, bool normalMap, std::vector<uint8_t>& rgba) {
+	rgba.resize((size_t)level.Width * level.Height * 4);
+	for (size_t p = 0; p < (size_t)level.Width * level.Height; p++) {
+		const float* source = &level.Pixels[p * 4];
+		uint8_t* dest = &rgba[p * 4];
+		for (int i = 0; i < 3; i++)
+			dest[i] = ToByte(normalMap ? source[i] * 0.5f + 0.5f : LinearToSRGB(source[i]));
+		dest[3] = ToByte(source[3]);
+	}
+}
+
+// --------------------------------------------------------
+// BC1 colour
+// --------------------------------------------------------
+
+static uint16_t To565(const float* color) {
+	int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+	int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+	int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+	r = r < 0 ? 0 : (r > 31 ? 31 : r);
+	g = g < 0 ? 0 : (g > 63 ? 63 : g);
+	b = b < 0 ? 0 : (b > 31 ? 31 : b);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void From565(uint16_t color, int* rgb) {
+	int r = (color >> 11) & 31;
+	int g = (color >> 5) & 63;
+	int b = color & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+// The four colours a pair of endpoints gives, in index order
+static void BC1Palette(uint16_t color0, uint16_t color1, int palette[4][3]) {
+	From565(color0, palette[0]);
+	From565(color1, palette[1]);
+	for (int i = 0; i < 3; i++) {
+		palette[2][i] = (2 * palette[0][i] + palette[1][i]) / 3;
+		palette[3][i] = (palette[0][i] + 2 * palette[1][i]) / 3;
+	}
+}
+
+// Nearest palette entry for each of the 16 pixels, given as
+// separate R, G and B arrays.  Returns the squared error.
+static float PickColorIndices(const float* r, const float* g, const float* b, const int palette[4][3], int* indices) {
+	float error = 0;
+	int i = 0;
+
+#ifdef TEXTURE_COOKER_SSE
+	__m128 totalError = _mm_setzero_ps();
+	for (; i < 16; i += 4) {
+		__m128 pr = _mm_loadu_ps(r + i);
+		__m128 pg = _mm_loadu_ps(g + i);
+		__m128 pb = _mm_loadu_ps(b + i);
+		__m128 best = _mm_set1_ps(1e30f);
+		__m128 bestIndex = _mm_setzero_ps();
+		for (int p = 0; p < 4; p++) {
+			__m128 dr = _mm_sub_ps(pr, _mm_set1_ps((float)palette[p][0]));
+			__m128 dg = _mm_sub_ps(pg, _mm_set1_ps((float)palette[p][1]));
+			__m128 db = _mm_sub_ps(pb, _mm_set1_ps((float)palette[p][2]));
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+			__m128 closer = _mm_cmplt_ps(distance, best);
+			best = _mm_or_ps(_mm_and_ps(closer, distance), _mm_andnot_ps(closer, best));
+			bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps((float)p)), _mm_andnot_ps(closer, bestIndex));
+		}
+		totalError = _mm_add_ps(totalError, best);
+
+		float lanes[4];
+		_mm_storeu_ps(lanes, bestIndex);
+		for (int lane = 0; lane < 4; lane++)
+			indices[i + lane] = (int)lanes[lane];
+	}
+	float errors[4];
+	_mm_storeu_ps(errors, totalError);
+	error = errors[0] + errors[1] + errors[2] + errors[3];
+#endif
+
+	for (; i < 16; i++) {
+		float best = 1e30f;
+		for (int p = 0; p < 4; p++) {
+			float dr = r[i] - palette[p][0];
+			float dg = g[i] - palette[p][1];
+			float db = b[i] - palette[p][2];
+			float distance = dr * dr + dg * dg + db * db;
+			if (distance < best) {
+				best = distance;
+				indices[i] = p;
+			}
+		}
+		error += best;
+	}
+	return error;
+}
+
+// Endpoints in four colour mode (color0 > color1), or both
+// the same for a flat block
+static void OrderEndpoints(uint16_t& color0, uint16_t& color1) {
+	if (color0 < color1) {
+		uint16_t swap = color0;
+		color0 = color1;
+		color1 = swap;
+	}
+}
+
+static void WriteColorBlock(uint16_t color0, uint16_t color1, const int* indices, uint8_t* block) {
+	uint32_t bits = 0;
+	for (int i = 0; i < 16; i++)
+		bits |= (uint32_t)(color0 == color1 ? 0 : indices[i]) << (i * 2);
+	block[0] = (uint8_t)color0;
+	block[1] = (uint8_t)(color0 >> 8);
+	block[2] = (uint8_t)color1;
+	block[3] = (uint8_t)(color1 >> 8);
+	for (int i = 0; i < 4; i++)
+		block[4 + i] = (uint8_t)(bits >> (i * 8));
+}
+
+void EncodeBC1Block(const uint8_t* pixels, uint8_t* block) {
+	float r[16], g[16], b[16];
+	float mean[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++) {
+		r[i] = pixels[i * 4];
+		g[i] = pixels[i * 4 + 1];
+		b[i] = pixels[i * 4 + 2];
+		mean[0] += r[i];
+		mean[1] += g[i];
+		mean[2] += b[i];
+	}
+	for (int c = 0; c < 3; c++)
+		mean[c] /= 16.0f;
+
+	// Principal axis of the colours, by power iteration on
+	// their covariance
+	float cov[6] = { 0, 0, 0, 0, 0, 0 };
+	for (int i = 0; i < 16; i++) {
+		float dr = r[i] - mean[0], dg = g[i] - mean[1], db = b[i] - mean[2];
+		cov[0] += dr * dr; cov[1] += dr * dg; cov[2] += dr * db;
+		cov[3] += dg * dg; cov[4] += dg * db; cov[5] += db * db;
+	}
+	float axis[3] = { 1, 1, 1 };
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float next[3] = {
+			cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+			cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+			cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2] };
+		float length = sqrtf(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+		if (length < 1e-6f)
+			break;
+		for (int c = 0; c < 3; c++)
+			axis[c] = next[c] / length;
+	}
+
+	// Ends of the colours along it
+	float lowest = 1e30f, highest = -1e30f;
+	for (int i = 0; i < 16; i++) {
+		float t = (r[i] - mean[0]) * axis[0] + (g[i] - mean[1]) * axis[1] + (b[i] - mean[2]) * axis[2];
+		lowest = t < lowest ? t : lowest;
+		highest = t > highest ? t : highest;
+	}
+	float end0[3], end1[3];
+	for (int c = 0; c < 3; c++) {
+		end0[c] = mean[c] + axis[c] * highest;
+		end1[c] = mean[c] + axis[c] * lowest;
+	}
+
+	uint16_t color0 = To565(end0);
+	uint16_t color1 = To565(end1);
+	OrderEndpoints(color0, color1);
+	int palette[4][3];
+	int indices[16];
+	BC1Palette(color0, color1, palette);
+	float error = PickColorIndices(r, g, b, palette, indices);
+
+	// One round of least squares: the endpoints that best fit
+	// the indices just picked, kept if they do better
+	const float weight0[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+	float aa = 0, ab = 0, bb = 0;
+	float ax[3] = { 0, 0, 0 }, bx[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++) {
+		float w0 = weight0[indices[i]];
+		float w1 = 1.0f - w0;
+		aa += w0 * w0; ab += w0 * w1; bb += w1 * w1;
+		float pixel[3] = { r[i], g[i], b[i] };
+		for (int c = 0; c < 3; c++) {
+			ax[c] += w0 * pixel[c];
+			bx[c] += w1 * pixel[c];
+		}
+	}
+	float determinant = aa * bb - ab * ab;
+	if (fabsf(determinant) > 1e-6f) {
+		float fit0[3], fit1[3];
+		for (int c = 0; c < 3; c++) {
+			fit0[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+			fit1[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+		}
+		uint16_t fitColor0 = To565(fit0);
+		uint16_t fitColor1 = To565(fit1);
+		OrderEndpoints(fitColor0, fitColor1);
+		int fitPalette[4][3];
+		int fitIndices[16];
+		BC1Palette(fitColor0, fitColor1, fitPalette);
+		float fitError = PickColorIndices(r, g, b, fitPalette, fitIndices);
+		if (fitError < error && fitColor0 != fitColor1) {
+			color0 = fitColor0;
+			color1 = fitColor1;
+			memcpy(indices, fitIndices, sizeof(indices));
+		}
+	}
+
+	WriteColorBlock(color0, color1, indices, block);
+}
+
+void DecodeBC1Block(const uint8_t* block, uint8_t* pixels) {
+	uint16_t color0 = block[0] | (block[1] << 8);
+	uint16_t color1 = block[2] | (block[3] << 8);
+	uint32_t bits = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+
+	int palette[4][3];
+	BC1Palette(color0, color1, palette);
+	int alpha[4] = { 255, 255, 255, 255 };
+	if (color0 <= color1) {
+		// Three colour mode - the midpoint, then transparent black
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+		alpha[3] = 0;
+	}
+
+	for (int i = 0; i < 16; i++) {
+		int index = (bits >> (i * 2)) & 3;
+		pixels[i * 4] = (uint8_t)palette[index][0];
+		pixels[i * 4 + 1] = (uint8_t)palette[index][1];
+		pixels[i * 4 + 2] = (uint8_t)palette[index][2];
+		pixels[i * 4 + 3] = (uint8_t)alpha[index];
+	}
+}
+
+// --------------------------------------------------------
+// Single channel blocks - BC3's alpha and each half of BC5
+// --------------------------------------------------------
+
+// Eight values from the highest to the lowest, evenly
+// spaced.  Index 0 is the highest, 1 the lowest and 2 to 7
+// the ones in between, highest first.
+static void EncodeChannelBlock(const uint8_t* pixels, int channel, uint8_t* block) {
+	float values[16];
+	int highest = 0, lowest = 255;
+	for (int i = 0; i < 16; i++) {
+		int value = pixels[i * 4 + channel];
+		values[i] = (float)value;
+		highest = value > highest ? value : highest;
+		lowest = value < lowest ? value : lowest;
+	}
+
+	int indices[16];
+	if (highest == lowest) {
+		for (int i = 0; i < 16; i++)
+			indices[i] = 0;
+	} else {
+		// Steps down from the highest, rounded - which of the
+		// eight is nearest, since they're evenly spaced
+		const int stepToIndex[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+		float scale = 7.0f / (highest - lowest);
+		int i = 0;
+#ifdef TEXTURE_COOKER_SSE
+		__m128 top = _mm_set1_ps((float)highest);
+		__m128 scale4 = _mm_set1_ps(scale);
+		for (; i < 16; i += 4) {
+			__m128 steps = _mm_mul_ps(_mm_sub_ps(top, _mm_loadu_ps(values + i)), scale4);
+			__m128i rounded = _mm_cvtps_epi32(steps);
+			int lanes[4];
+			_mm_storeu_si128((__m128i*)lanes, rounded);
+			for (int lane = 0; lane < 4; lane++)
+				indices[i + lane] = stepToIndex[lanes[lane] < 0 ? 0 : (lanes[lane] > 7 ? 7 : lanes[lane])];
+		}
+#endif
+		for (; i < 16; i++) {
+			int step = (int)((highest - values[i]) * scale + 0.5f);
+			indices[i] = stepToIndex[step < 0 ? 0 : (step > 7 ? 7 : step)];
+		}
+	}
+
+	block[0] = (uint8_t)highest;
+	block[1] = (uint8_t)lowest;
+	uint64_t bits = 0;
+	for (int i = 0; i < 16; i++)
+		bits |= (uint64_t)indices[i] << (i * 3);
+	for (int i = 0; i < 6; i++)
+		block[2 + i] = (uint8_t)(bits >> (i * 8));
+}
+
+static void DecodeChannelBlock(const uint8_t* block, uint8_t* pixels, int channel) {
+	int value0 = block[0];
+	int value1 = block[1];
+	int palette[8] = { value0, value1 };
+	if (value0 > value1) {
+		for (int i = 1; i < 7; i++)
+			palette[i + 1] = ((7 - i) * value0 + i * value1) / 7;
+	} else {
+		for (int i = 1; i < 5; i++)
+			palette[i + 1] = ((5 - i) * value0 + i * value1) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	uint64_t bits = 0;
+	for (int i = 0; i < 6; i++)
+		bits |= (uint64_t)block[2 + i] << (i * 8);
+	for (int i = 0; i < 16; i++)
+		pixels[i * 4 + channel] = (uint8_t)palette[(bits >> (i * 3)) & 7];
+}
+
+void EncodeBC3Block(const uint8_t* pixels, uint8_t* block) {
+	EncodeChannelBlock(pixels, 3, block);
+	EncodeBC1Block(pixels, block + 8);
+}
+
+void DecodeBC3Block(const uint8_t* block, uint8_t* pixels) {
+	DecodeBC1Block(block + 8, pixels);
+	DecodeChannelBlock(block, pixels, 3);
+}
+
+void EncodeBC5Block(const uint8_t* pixels, uint8_t* block) {
+	EncodeChannelBlock(pixels, 0, block);
+	EncodeChannelBlock(pixels, 1, block + 8);
+}
+
+void DecodeBC5Block(const uint8_t* block, uint8_t* pixels) {
+	DecodeChannelBlock(block, pixels, 0);
+	DecodeChannelBlock(block + 8, pixels, 1);
+	for (int i = 0; i < 16; i++) {
+		pixels[i * 4 + 2] = 0;
+		pixels[i * 4 + 3] = 255;
+	}
+}
+
+// --------------------------------------------------------
+// Surfaces and files
+// --------------------------------------------------------
+
+void EncodeSurface(const uint8_t* rgba, int width, int height, CookerFormat format, std::vector<uint8_t>& blocks) {
+	int blocksWide = (width + 3) / 4;
+	int blocksHigh = (height + 3) / 4;
+	int blockBytes = format == CookerBC1 ? 8 : 16;
+	blocks.resize((size_t)blocksWide * blocksHigh * blockBytes);
+
+	uint8_t pixels[64];
+	for (int by = 0; by < blocksHigh; by++) {
+		for (int bx = 0; bx < blocksWide; bx++) {
+			for (int y = 0; y < 4; y++) {
+				int sy = by * 4 + y < height ? by * 4 + y : height - 1;
+				for (int x = 0; x < 4; x++) {
+					int sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+					memcpy(pixels + (y * 4 + x) * 4, rgba + ((size_t)sy * width + sx) * 4, 4);
+				}
+			}
+
+			uint8_t* block = &blocks[((size_t)by * blocksWide + bx) * blockBytes];
+			if (format == CookerBC1)
+				EncodeBC1Block(pixels, block);
+			else if (format == CookerBC3)
+				EncodeBC3Block(pixels, block);
+			else
+				EncodeBC5Block(pixels, block);
+		}
+	}
+}
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void CookTexture(const CookerImage& image, bool normalMap, CookedTexture& cooked, CookerTimings* timings) {
+	cooked.Format = normalMap ? CookerBC5 : (image.HasAlpha ? CookerBC3 : CookerBC1);
+	cooked.Width = image.Width;
+	cooked.Height = image.Height;
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<CookerLevel> levels;
+	GenerateMips(image, normalMap, levels);
+	double mipMilliseconds = MillisecondsSince(start);
+
+	start = std::chrono::steady_clock::now();
+	cooked.Mips.resize(levels.size());
+	std::vector<uint8_t> rgba;
+	for (size_t i = 0; i < levels.size(); i++) {
+		ConvertLevel(levels[i], normalMap, rgba);
+		EncodeSurface(rgba.data(), levels[i].Width, levels[i].Height, cooked.Format, cooked.Mips[i]);
+	}
+
+	if (timings) {
+		timings->MipMilliseconds = mipMilliseconds;
+		timings->EncodeMilliseconds = MillisecondsSince(start);
+	}
+}
+
+static void WriteU32(std::ofstream& file, uint32_t value) {
+	char bytes[4] = { (char)value, (char)(value >> 8), (char)(value >> 16), (char)(value >> 24) };
+	file.write(bytes, 4);
+}
+
+bool WriteDDS(const std::string& path, const CookedTexture& cooked) {
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	const uint32_t flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;	// Caps, height, width, pixel format, mip count, linear size
+	const uint32_t caps = 0x1000 | 0x400000 | 0x8;							// Texture, mipmap, complex
+	const char* fourCC = cooked.Format == CookerBC1 ? "DXT1" : (cooked.Format == CookerBC3 ? "DXT5" : "ATI2");
+
+	file.write("DDS ", 4);
+	WriteU32(file, 124);
+	WriteU32(file, flags);
+	WriteU32(file, cooked.Height);
+	WriteU32(file, cooked.Width);
+	WriteU32(file, (uint32_t)cooked.Mips[0].size());
+	WriteU32(file, 0);		// Depth
+	WriteU32(file, (uint32_t)cooked.Mips.size());
+	for (int i = 0; i < 11; i++)
+		WriteU32(file, 0);
+
+	// Pixel format
+	WriteU32(file, 32);
+	WriteU32(file, 0x4);	// Four character code
+	file.write(fourCC, 4);
+	for (int i = 0; i < 5; i++)
+		WriteU32(file, 0);
+
+	WriteU32(file, caps);
+	for (int i = 0; i < 4; i++)
+		WriteU32(file, 0);
+
+	for (size_t i = 0; i < cooked.Mips.size(); i++)
+		file.write((const char*)cooked.Mips[i].data(), cooked.Mips[i].size());
+	return file.good();
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "TiffReader.h"
+
+// --------------------------------------------------------
+// Offline texture cooking - source image in, block
+// compressed DDS with a full mip chain out (see
+// TextureLoader.h for how the game picks them up)
+//
+//  - Mips are box filtered in linear light, so the sRGB
+//    stored albedo doesn't darken as it shrinks.  Normal
+//    maps are filtered as vectors and renormalized.
+//  - BC1 for opaque albedo, BC3 when there's alpha, BC5
+//    (just X and Y) for normal maps.  Endpoints come from
+//    the block's principal axis; picking each pixel's index
+//    runs four pixels at a time with SSE where there is SSE.
+//  - Texel values are kept as they were (UNORM, not SRGB)
+//    so the cooked texture shades the same as the WIC one.
+// --------------------------------------------------------
+
+enum CookerFormat {
+	CookerBC1,
+	CookerBC3,
+	CookerBC5
+};
+
+// Linear light RGBA (or a normal in XYZ) per pixel
+struct CookerLevel {
+	int Width;
+	int Height;
+	std::vector<float> Pixels;
+};
+
+struct CookedTexture {
+	CookerFormat Format;
+	int Width;
+	int Height;
+	std::vector<std::vector<uint8_t>> Mips;		// Blocks, top mip first
+};
+
+struct CookerTimings {
+	double MipMilliseconds;
+	double EncodeMilliseconds;
+};
+
+// Every level down to 1x1, the image itself first
+void GenerateMips(const CookerImage& image, bool normalMap, std::vector<CookerLevel>& levels);
+
+// A level back to 8 bit RGBA, sRGB encoded unless it's a normal map
+void ConvertLevel(const CookerLevel& level, bool normalMap, std::vector<uint8_t>& rgba);
+
+// Single 4x4 blocks.  pixels is 16 RGBA texels, row by row.
+void EncodeBC1Block(const uint8_t* pixels, uint8_t* block);
+void EncodeBC3Block(const uint8_t* pixels, uint8_t* block);
+void EncodeBC5Block(const uint8_t* pixels, uint8_t* block);		// R and G only
+
+// And back, for checking the encoders
+void DecodeBC1Block(const uint8_t* block, uint8_t* pixels);
+void DecodeBC3Block(const uint8_t* block, uint8_t* pixels);
+void DecodeBC5Block(const uint8_t* block, uint8_t* pixels);		// B is 0, A 255
+
+// Whole surface, padded out to whole blocks by repeating the
+// edge texels
+void EncodeSurface(const uint8_t* rgba, int width, int height, CookerFormat format, std::vector<uint8_t>& blocks);
+
+// Mips and encodes an image.  Normal maps always go to BC5,
+// otherwise it's BC3 if the image has alpha and BC1 if not.
+void CookTexture(const CookerImage& image, bool normalMap, CookedTexture& cooked, CookerTimings* timings = 0);
+
+// Legacy header with a DXT1 / DXT5 / ATI2 four character
+// code, which every DDS reader understands
+bool WriteDDS(const std::string& path, const CookedTexture& cooked);
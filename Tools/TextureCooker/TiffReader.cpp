@@ -0,0 +1,307 @@
+#include "TiffReader.h"
+#include <fstream>
+#include <string.h>
+#include <iterator>
+
+namespace {
+	enum {
+		TagImageWidth = 256,
+		TagImageLength = 257,
+		TagBitsPerSample = 258,
+		TagCompression = 259,
+		TagStripOffsets = 273,
+		TagSamplesPerPixel = 277,
+		TagRowsPerStrip = 278,
+		TagStripByteCounts = 279,
+		TagPlanarConfiguration = 284,
+		TagPredictor = 317,
+	};
+
+	enum {
+		TypeShort = 3,
+		TypeLong = 4,
+	};
+
+	enum {
+		CompressionNone = 1,
+		CompressionLZW = 5,
+	};
+
+	struct Reader {
+		const uint8_t* Data;
+		size_t Size;
+		bool BigEndian;
+
+		bool Has(size_t offset, size_t bytes) const { return offset <= Size && bytes <= Size - offset; }
+
+		uint32_t U16(size_t offset) const {
+			const uint8_t* p = Data + offset;
+			return BigEndian ? (p[0] << 8) | p[1] : p[0] | (p[1] << 8);
+		}
+
+		uint32_t U32(size_t offset) const {
+			const uint8_t* p = Data + offset;
+			return BigEndian ?
+				((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3] :
+				p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+		}
+	};
+
+	// One directory entry's values, however they're stored -
+	// inline when they fit in the entry's four bytes
+	bool ReadValues(const Reader& reader, size_t entry, std::vector<uint32_t>& values) {
+		uint32_t type = reader.U16(entry + 2);
+		uint32_t count = reader.U32(entry + 4);
+		uint32_t width = type == TypeShort ? 2 : (type == TypeLong ? 4 : 0);
+		if (width == 0 || count == 0 || count > (1 << 20))
+			return false;
+
+		size_t offset = entry + 8;
+		if (count * width > 4) {
+			offset = reader.U32(entry + 8);
+			if (!reader.Has(offset, (size_t)count * width))
+				return false;
+		}
+
+		values.resize(count);
+		for (uint32_t i = 0; i < count; i++)
+			values[i] = width == 2 ? reader.U16(offset + i * 2) : reader.U32(offset + i * 4);
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// TIFF's LZW: codes MSB first, starting at 9 bits and
+	// widening one code early (at 511, 1023 and 2047).  Stops
+	// at the end of information code, the end of the input or
+	// once output is full, whichever is first.
+	// --------------------------------------------------------
+	bool DecodeLZW(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputSize) {
+		const int ClearCode = 256;
+		const int EndCode = 257;
+		const int MaxCodes = 4096;
+
+		// Each entry is its prefix's entry plus one byte
+		int prefix[MaxCodes];
+		uint8_t suffix[MaxCodes];
+		uint8_t first[MaxCodes];
+		int length[MaxCodes];
+		for (int i = 0; i < 256; i++) {
+			prefix[i] = -1;
+			suffix[i] = (uint8_t)i;
+			first[i] = (uint8_t)i;
+			length[i] = 1;
+		}
+
+		int nextCode = 258;
+		int codeBits = 9;
+		int previous = -1;
+		size_t written = 0;
+		uint32_t bitBuffer = 0;
+		int bitCount = 0;
+		size_t inputPos = 0;
+
+		while (written < outputSize) {
+			while (bitCount < codeBits && inputPos < inputSize) {
+				bitBuffer = (bitBuffer << 8) | input[inputPos++];
+				bitCount += 8;
+			}
+			if (bitCount < codeBits)
+				break;
+
+			int code = (bitBuffer >> (bitCount - codeBits)) & ((1 << codeBits) - 1);
+			bitCount -= codeBits;
+
+			if (code == EndCode)
+				break;
+			if (code == ClearCode) {
+				nextCode = 258;
+				codeBits = 9;
+				previous = -1;
+				continue;
+			}
+
+			int entry;
+			if (code < nextCode && (code < 256 || code >= 258)) {
+				entry = code;
+			} else if (code == nextCode && previous >= 0) {
+				entry = -1;		// Previous string plus its own first byte
+			} else {
+				return false;
+			}
+
+			// The new table entry is previous plus the first byte of
+			// what's being output now
+			if (previous >= 0 && nextCode < MaxCodes) {
+				uint8_t firstByte = entry >= 0 ? first[entry] : first[previous];
+				prefix[nextCode] = previous;
+				suffix[nextCode] = firstByte;
+				first[nextCode] = first[previous];
+				length[nextCode] = length[previous] + 1;
+				if (entry < 0)
+					entry = nextCode;
+				nextCode++;
+				if (nextCode + 1 == (1 << codeBits) && codeBits < 12)
+					codeBits++;
+			}
+			if (entry < 0)
+				return false;
+
+			// Strings come out of the table backwards
+			int count = length[entry];
+			if ((size_t)count > outputSize - written)
+				count = (int)(outputSize - written);
+			int skip = length[entry] - count;
+			int at = entry;
+			for (int i = 0; i < skip; i++)
+				at = prefix[at];
+			for (int i = count - 1; i >= 0; i--) {
+				output[written + i] = suffix[at];
+				at = prefix[at];
+			}
+			written += count;
+			previous = entry;
+		}
+		return written == outputSize;
+	}
+}
+
+bool ParseTiff(const uint8_t* data, size_t size, CookerImage& image, std::string& error) {
+	Reader reader = { data, size, false };
+	if (size < 8 || !((data[0] == 'I' && data[1] == 'I') || (data[0] == 'M' && data[1] == 'M'))) {
+		error = "not a TIFF file";
+		return false;
+	}
+	reader.BigEndian = data[0] == 'M';
+	if (reader.U16(2) != 42) {
+		error = "not a TIFF file";
+		return false;
+	}
+
+	// Only the first image in the file
+	size_t directory = reader.U32(4);
+	if (!reader.Has(directory, 2)) {
+		error = "truncated";
+		return false;
+	}
+	uint32_t entryCount = reader.U16(directory);
+	if (!reader.Has(directory + 2, entryCount * 12)) {
+		error = "truncated";
+		return false;
+	}
+
+	uint32_t width = 0, height = 0, compression = CompressionNone, samples = 1;
+	uint32_t rowsPerStrip = 0xFFFFFFFF, planar = 1, predictor = 1;
+	std::vector<uint32_t> bits, stripOffsets, stripBytes;
+	for (uint32_t i = 0; i < entryCount; i++) {
+		size_t entry = directory + 2 + i * 12;
+		std::vector<uint32_t> values;
+		if (!ReadValues(reader, entry, values))
+			continue;
+
+		switch (reader.U16(entry)) {
+		case TagImageWidth: width = values[0]; break;
+		case TagImageLength: height = values[0]; break;
+		case TagBitsPerSample: bits = values; break;
+		case TagCompression: compression = values[0]; break;
+		case TagStripOffsets: stripOffsets = values; break;
+		case TagSamplesPerPixel: samples = values[0]; break;
+		case TagRowsPerStrip: rowsPerStrip = values[0]; break;
+		case TagStripByteCounts: stripBytes = values; break;
+		case TagPlanarConfiguration: planar = values[0]; break;
+		case TagPredictor: predictor = values[0]; break;
+		}
+	}
+
+	if (width == 0 || height == 0 || width > 16384 || height > 16384) {
+		error = "bad size";
+		return false;
+	}
+	if (samples != 3 && samples != 4) {
+		error = "only RGB and RGBA are supported";
+		return false;
+	}
+	for (size_t i = 0; i < bits.size(); i++) {
+		if (bits[i] != 8) {
+			error = "only 8 bits per sample is supported";
+			return false;
+		}
+	}
+	if (planar != 1 || (predictor != 1 && predictor != 2)) {
+		error = "only interleaved samples and the horizontal predictor are supported";
+		return false;
+	}
+	if (compression != CompressionNone && compression != CompressionLZW) {
+		error = "only uncompressed and LZW are supported";
+		return false;
+	}
+	if (rowsPerStrip > height)
+		rowsPerStrip = height;
+	size_t stripCount = (height + rowsPerStrip - 1) / rowsPerStrip;
+	if (stripOffsets.size() < stripCount || stripBytes.size() < stripCount) {
+		error = "missing strips";
+		return false;
+	}
+
+	// Decode everything as it's stored, then expand to RGBA
+	size_t rowBytes = (size_t)width * samples;
+	std::vector<uint8_t> stored(rowBytes * height);
+	for (size_t strip = 0; strip < stripCount; strip++) {
+		size_t firstRow = strip * rowsPerStrip;
+		size_t rows = firstRow + rowsPerStrip > height ? height - firstRow : rowsPerStrip;
+		uint8_t* out = stored.data() + firstRow * rowBytes;
+		size_t outBytes = rows * rowBytes;
+
+		if (!reader.Has(stripOffsets[strip], stripBytes[strip])) {
+			error = "strip past the end of the file";
+			return false;
+		}
+		const uint8_t* in = data + stripOffsets[strip];
+		if (compression == CompressionLZW) {
+			if (!DecodeLZW(in, stripBytes[strip], out, outBytes)) {
+				error = "bad LZW data";
+				return false;
+			}
+		} else {
+			if (stripBytes[strip] < outBytes) {
+				error = "short strip";
+				return false;
+			}
+			memcpy(out, in, outBytes);
+		}
+	}
+
+	// Each sample stored as the difference from the one to its left
+	if (predictor == 2) {
+		for (uint32_t y = 0; y < height; y++) {
+			uint8_t* row = stored.data() + y * rowBytes;
+			for (size_t x = samples; x < rowBytes; x++)
+				row[x] = (uint8_t)(row[x] + row[x - samples]);
+		}
+	}
+
+	image.Width = width;
+	image.Height = height;
+	image.HasAlpha = false;
+	image.Pixels.resize((size_t)width * height * 4);
+	for (size_t p = 0; p < (size_t)width * height; p++) {
+		const uint8_t* source = stored.data() + p * samples;
+		uint8_t* dest = image.Pixels.data() + p * 4;
+		dest[0] = source[0];
+		dest[1] = source[1];
+		dest[2] = source[2];
+		dest[3] = samples == 4 ? source[3] : 255;
+		if (dest[3] != 255)
+			image.HasAlpha = true;
+	}
+	return true;
+}
+
+bool ReadTiff(const std::string& path, CookerImage& image, std::string& error) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		error = "can't open " + path;
+		return false;
+	}
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	return ParseTiff(data.data(), data.size(), image, error);
+}
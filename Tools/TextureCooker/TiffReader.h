@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Just enough of TIFF for the project's source textures:
+// 8 bits per sample, RGB or RGBA, interleaved, in strips,
+// either uncompressed or LZW with or without the horizontal
+// predictor.  Anything else is refused rather than guessed.
+// --------------------------------------------------------
+
+struct CookerImage {
+	int Width;
+	int Height;
+	bool HasAlpha;					// Some pixel isn't fully opaque
+	std::vector<uint8_t> Pixels;	// RGBA, rows top to bottom
+};
+
+// Returns false with a reason in error if the file can't be
+// read or uses something unsupported
+bool ReadTiff(const std::string& path, CookerImage& image, std::string& error);
+
+// Same, from a file already in memory
+bool ParseTiff(const uint8_t* data, size_t size, CookerImage& image, std::string& error);
@@ -0,0 +1,166 @@
+#include "TrackGenerator.h"
+#include <algorithm>
+
+TrackGenerator::TrackGenerator(const TrackRules& rules, bool useWorker)
+{
+	this->rules = rules;
+	this->useWorker = useWorker;
+
+	// Small seeds like 1 would make xorshift's first outputs tiny
+	// (every early piece changing lane), so mix the bits first.
+	// xorshift can't start from 0.
+	random = rules.Seed * 0x9E3779B9u;
+	random ^= random >> 16;
+	random *= 0x85EBCA6Bu;
+	random ^= random >> 13;
+	random = random ? random : 0x9E3779B9u;
+	nextSequence = 0;
+	lane = 0;
+
+	ringStart = 0;
+	ringCount = 0;
+	stats = {};
+	quit = false;
+
+	if (useWorker)
+		worker = std::thread(&TrackGenerator::WorkerLoop, this);
+}
+
+TrackGenerator::~TrackGenerator()
+{
+	if (useWorker)
+	{
+		{
+			std::lock_guard<std::mutex> lock(ringMutex);
+			quit = true;
+		}
+		ringLow.notify_all();
+		worker.join();
+	}
+}
+
+// 0 to 1
+float TrackGenerator::NextRandom()
+{
+	random ^= random << 13;
+	random ^= random >> 17;
+	random ^= random << 5;
+	return (random >> 8) * (1.0f / 16777216.0f);
+}
+
+TrackPiece TrackGenerator::Generate()
+{
+	TrackPiece piece = {};
+	piece.Sequence = nextSequence++;
+
+	// Straight line while the player gets going
+	if (piece.Sequence >= rules.EasyCount && rules.LaneCount > 1)
+	{
+		float difficulty = 1.0f;
+		if (rules.HardCount > rules.EasyCount)
+			difficulty = std::min((piece.Sequence - rules.EasyCount) / (float)(rules.HardCount - rules.EasyCount), 1.0f);
+
+		float changeChance = rules.LaneChangeEasy + (rules.LaneChangeHard - rules.LaneChangeEasy) * difficulty;
+		int maxJump = rules.MaxJumpEasy + (int)((rules.MaxJumpHard - rules.MaxJumpEasy) * difficulty + 0.5f);
+		maxJump = std::max(1, std::min(maxJump, rules.LaneCount - 1));
+
+		// Always draw both numbers so one rule can't shift the
+		// sequence the other sees
+		float change = NextRandom();
+		float jumpPick = NextRandom();
+		if (change < changeChance)
+		{
+			// Any lane within reach other than this one
+			int low = std::max(lane - maxJump, 0);
+			int high = std::min(lane + maxJump, rules.LaneCount - 1);
+			int choices = high - low;
+			int pick = low + std::min((int)(jumpPick * choices), choices - 1);
+			lane = pick >= lane ? pick + 1 : pick;
+		}
+	}
+
+	piece.Lane = lane;
+	piece.X = lane * rules.LaneWidth;
+	piece.Y = rules.Height;
+	return piece;
+}
+
+TrackPiece TrackGenerator::TakePiece()
+{
+	if (!useWorker)
+	{
+		stats.Generated++;
+		stats.Taken++;
+		return Generate();
+	}
+
+	std::unique_lock<std::mutex> lock(ringMutex);
+	if (ringCount == 0)
+		stats.Waits++;
+	pieceReady.wait(lock, [this]() { return ringCount > 0; });
+
+	TrackPiece piece = ring[ringStart];
+	ringStart = (ringStart + 1) % LookAhead;
+	ringCount--;
+	stats.Taken++;
+
+	// Top up in batches rather than after every piece
+	if (ringCount <= LookAhead / 2)
+		ringLow.notify_one();
+	return piece;
+}
+
+TrackStats TrackGenerator::GetStats()
+{
+	std::lock_guard<std::mutex> lock(ringMutex);
+	return stats;
+}
+
+void TrackGenerator::WorkerLoop()
+{
+	TrackPiece batch[LookAhead];
+	while (true)
+	{
+		int count;
+		{
+			std::unique_lock<std::mutex> lock(ringMutex);
+			ringLow.wait(lock, [this]() { return quit || ringCount <= LookAhead / 2; });
+			if (quit)
+				return;
+			count = LookAhead - ringCount;
+		}
+
+		// Only the worker generates, so no lock needed here
+		for (int i = 0; i < count; i++)
+			batch[i] = Generate();
+
+		{
+			std::lock_guard<std::mutex> lock(ringMutex);
+			for (int i = 0; i < count; i++)
+				ring[(ringStart + ringCount + i) % LookAhead] = batch[i];
+			ringCount += count;
+			stats.Generated += count;
+		}
+		pieceReady.notify_all();
+	}
+}
+
+// --------------------------------------------------------
+// PlatformPool
+// --------------------------------------------------------
+
+PlatformPool::PlatformPool(int size)
+	: pieces(size)
+{
+	oldest = 0;
+	recycled = 0;
+}
+
+int PlatformPool::Recycle(const TrackPiece& piece)
+{
+	int slot = oldest;
+	pieces[slot] = piece;
+	oldest = (oldest + 1) % GetSize();
+	recycled++;
+	return slot;
+}
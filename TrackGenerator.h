@@ -0,0 +1,119 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// Procedural platform track
+//
+// The generator lays platforms out one after another from a
+// seed, so the same seed always gives the same track.  Each
+// platform sits in one of a few lanes; how often and how far
+// the track changes lanes ramps up with the platform's place
+// in the track, which is also about the score the player has
+// when they reach it.
+// --------------------------------------------------------
+
+struct TrackRules {
+	unsigned int Seed;
+	int LaneCount;
+	float LaneWidth;		// Lane n is at x = n * LaneWidth
+	float Spacing;			// Along z between platforms
+	float Height;			// y of every platform
+	float ViewDistance;		// How far along z platforms exist at once
+
+	// Difficulty ramps from easy to hard between these two
+	// platform numbers
+	int EasyCount;
+	int HardCount;
+	float LaneChangeEasy;	// Chance of leaving the lane
+	float LaneChangeHard;
+	int MaxJumpEasy;		// Most lanes crossed at once
+	int MaxJumpHard;
+};
+
+struct TrackPiece {
+	int Sequence;		// 0 for the first platform
+	int Lane;
+	float X;
+	float Y;
+};
+
+struct TrackStats {
+	long long Generated;
+	long long Taken;
+	int Waits;			// Times TakePiece had to wait for the worker
+};
+
+// --------------------------------------------------------
+// Hands out the track a piece at a time.  With a worker
+// thread the pieces are generated ahead in a small ring, so
+// taking one never does the work itself.
+// --------------------------------------------------------
+class TrackGenerator {
+public:
+	TrackGenerator(const TrackRules& rules, bool useWorker = true);
+	~TrackGenerator();
+
+	const TrackRules& GetRules() { return rules; }
+
+	// Next piece, in order
+	TrackPiece TakePiece();
+
+	TrackStats GetStats();
+
+private:
+	TrackRules rules;
+
+	// Generation state - only the worker touches it when there is one
+	uint32_t random;
+	int nextSequence;
+	int lane;
+
+	float NextRandom();
+	TrackPiece Generate();
+
+	// Look ahead ring, guarded by ringMutex
+	static const int LookAhead = 32;
+	TrackPiece ring[LookAhead];
+	int ringStart;
+	int ringCount;
+	TrackStats stats;
+
+	bool useWorker;
+	bool quit;
+	std::thread worker;
+	std::mutex ringMutex;
+	std::condition_variable ringLow;
+	std::condition_variable pieceReady;
+
+	void WorkerLoop();
+};
+
+// --------------------------------------------------------
+// Ring of platform slots, oldest first.  Recycling hands
+// back the oldest slot with its new piece, which makes it the
+// newest, so slots are reused in order and never allocated.
+// --------------------------------------------------------
+class PlatformPool {
+public:
+	PlatformPool(int size);
+
+	int GetSize() { return (int)pieces.size(); }
+	int GetOldest() { return oldest; }
+	int GetNewest() { return (oldest + GetSize() - 1) % GetSize(); }
+	const TrackPiece& GetPiece(int slot) { return pieces[slot]; }
+
+	int Recycle(const TrackPiece& piece);
+
+	// Recycles past the initial fill of every slot
+	long long GetReuseCount() { return recycled > GetSize() ? recycled - GetSize() : 0; }
+
+private:
+	std::vector<TrackPiece> pieces;
+	int oldest;
+	long long recycled;
+};
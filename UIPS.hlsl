@@ -0,0 +1,20 @@
+// Defines the input to this pixel shader
+// - Should match the output of our corresponding vertex shader
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float2 uv           : TEXCOORD0;
+	float4 color		: TEXCOORD1;
+};
+
+// Textures and such
+Texture2D spriteTexture	: register(t0);
+SamplerState linearClamp	: register(s0);
+
+
+// Entry point for this pixel shader - same as SpriteBatch,
+// textures are treated as premultiplied
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	return spriteTexture.Sample(linearClamp, input.uv) * input.color;
+}
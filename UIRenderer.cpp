@@ -0,0 +1,185 @@
+#include "UIRenderer.h"
+#include <chrono>
+
+UIRenderer::UIRenderer(ID3D11Device* device, SimpleVertexShader* vs, SimplePixelShader* ps)
+{
+	this->device = device;
+	this->vs = vs;
+	this->ps = ps;
+	stats = {};
+
+	// Same states SpriteBatch draws with by default -
+	// premultiplied alpha, no depth, no culling, linear clamp
+	D3D11_BLEND_DESC blend = {};
+	blend.RenderTarget[0].BlendEnable = true;
+	blend.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
+	blend.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+	blend.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+	blend.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+	blend.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+	blend.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	blend.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	device->CreateBlendState(&blend, &blendState);
+
+	D3D11_DEPTH_STENCIL_DESC depth = {};
+	depth.DepthEnable = false;
+	depth.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	depth.DepthFunc = D3D11_COMPARISON_ALWAYS;
+	device->CreateDepthStencilState(&depth, &depthState);
+
+	D3D11_RASTERIZER_DESC raster = {};
+	raster.FillMode = D3D11_FILL_SOLID;
+	raster.CullMode = D3D11_CULL_NONE;
+	raster.DepthClipEnable = true;
+	device->CreateRasterizerState(&raster, &rasterizerState);
+
+	D3D11_SAMPLER_DESC samplerDesc = {};
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	device->CreateSamplerState(&samplerDesc, &sampler);
+}
+
+UIRenderer::~UIRenderer()
+{
+	for (auto& tree : trees)
+	{
+		if (tree.second.StaticBuffer) tree.second.StaticBuffer->Release();
+		if (tree.second.DynamicBuffer) tree.second.DynamicBuffer->Release();
+	}
+
+	blendState->Release();
+	depthState->Release();
+	rasterizerState->Release();
+	sampler->Release();
+}
+
+void UIRenderer::GetTextureSize(ID3D11ShaderResourceView* texture, int& width, int& height)
+{
+	ID3D11Resource* resource = 0;
+	texture->GetResource(&resource);
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	((ID3D11Texture2D*)resource)->GetDesc(&desc);
+	resource->Release();
+
+	width = desc.Width;
+	height = desc.Height;
+}
+
+// --------------------------------------------------------
+// Only layers the tree actually rebuilt are sent to the GPU
+// --------------------------------------------------------
+void UIRenderer::UpdateBuffers(RenderContext* context, UITree* tree, TreeBuffers& buffers)
+{
+	const UILayer& staticLayer = tree->GetStaticLayer();
+	if (buffers.StaticVersion != staticLayer.Version)
+	{
+		if (buffers.StaticBuffer) { buffers.StaticBuffer->Release(); buffers.StaticBuffer = 0; }
+
+		if (!staticLayer.Vertices.empty())
+		{
+			D3D11_BUFFER_DESC vbDesc = {};
+			vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
+			vbDesc.ByteWidth = sizeof(UIVertex) * (UINT)staticLayer.Vertices.size();
+			vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+			D3D11_SUBRESOURCE_DATA initialVertexData = {};
+			initialVertexData.pSysMem = staticLayer.Vertices.data();
+			device->CreateBuffer(&vbDesc, &initialVertexData, &buffers.StaticBuffer);
+			stats.BytesUploaded += vbDesc.ByteWidth;
+		}
+		buffers.StaticVersion = staticLayer.Version;
+	}
+
+	const UILayer& dynamicLayer = tree->GetDynamicLayer();
+	if (buffers.DynamicVersion != dynamicLayer.Version)
+	{
+		int count = (int)dynamicLayer.Vertices.size();
+		if (count > buffers.DynamicCapacity)
+		{
+			// Grow to the next power of two so small changes in
+			// the text length don't recreate it every time
+			int capacity = 256;
+			while (capacity < count)
+				capacity *= 2;
+
+			if (buffers.DynamicBuffer) buffers.DynamicBuffer->Release();
+
+			D3D11_BUFFER_DESC vbDesc = {};
+			vbDesc.Usage = D3D11_USAGE_DYNAMIC;
+			vbDesc.ByteWidth = sizeof(UIVertex) * capacity;
+			vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+			vbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+			device->CreateBuffer(&vbDesc, 0, &buffers.DynamicBuffer);
+			buffers.DynamicCapacity = capacity;
+		}
+
+		if (count > 0)
+		{
+			UINT size = sizeof(UIVertex) * count;
+			context->UpdateDynamicBuffer(buffers.DynamicBuffer, dynamicLayer.Vertices.data(), size);
+			stats.BytesUploaded += size;
+		}
+		buffers.DynamicVersion = dynamicLayer.Version;
+	}
+}
+
+void UIRenderer::Draw(RenderContext* context, UITree* tree, float screenWidth, float screenHeight)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	tree->Build();
+	stats.ElementsTessellated += tree->GetBuildStats().ElementsTessellated;
+
+	auto found = trees.find(tree);
+	if (found == trees.end())
+	{
+		TreeBuffers buffers = {};
+		found = trees.insert(std::make_pair(tree, buffers)).first;
+	}
+	UpdateBuffers(context, tree, found->second);
+
+	float blendFactor[4] = { 0, 0, 0, 0 };
+	context->OMSetBlendState(blendState, blendFactor, 0xFFFFFFFF);
+	context->OMSetDepthStencilState(depthState, 0);
+	context->RSSetState(rasterizerState);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	context->IASetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
+
+	vs->SetFloat2("screenSize", DirectX::XMFLOAT2(screenWidth, screenHeight));
+	context->SetShader(vs);
+	context->CopyAllBufferData(vs);
+	context->SetSamplerState(ps, "linearClamp", sampler);
+	context->SetShader(ps);
+
+	// Static first, changing things on top
+	DrawLayer(context, tree->GetStaticLayer(), found->second.StaticBuffer);
+	DrawLayer(context, tree->GetDynamicLayer(), found->second.DynamicBuffer);
+
+	// Back to the defaults the rest of the frame expects
+	context->OMSetBlendState(0, blendFactor, 0xFFFFFFFF);
+	context->OMSetDepthStencilState(0, 0);
+	context->RSSetState(0);
+
+	stats.CpuMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void UIRenderer::DrawLayer(RenderContext* context, const UILayer& layer, ID3D11Buffer* buffer)
+{
+	if (!buffer || layer.Vertices.empty())
+		return;
+
+	UINT stride = sizeof(UIVertex);
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, &buffer, &stride, &offset);
+
+	for (const UIBatch& batch : layer.Batches)
+	{
+		context->SetShaderResourceView(ps, "spriteTexture", (ID3D11ShaderResourceView*)batch.Texture);
+		context->Draw(batch.VertexCount, batch.StartVertex);
+		stats.Batches++;
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <d3d11.h>
+#include <unordered_map>
+
+#include "SimpleShader.h"
+#include "RenderContext.h"
+#include "UITree.h"
+
+// Cost of the UI, summed over every tree drawn
+struct UIRenderStats {
+	int Batches;
+	int ElementsTessellated;
+	int BytesUploaded;
+	double CpuMilliseconds;		// Building, uploading and submitting
+};
+
+// --------------------------------------------------------
+// Draws UITrees.  A tree's static layer lives in an immutable
+// vertex buffer that is only recreated when the layer is
+// rebuilt; the dynamic layer goes through a dynamic buffer,
+// and is only uploaded when it changes too.  Texture handles
+// in the tree are shader resource views.
+// --------------------------------------------------------
+class UIRenderer {
+public:
+	UIRenderer(ID3D11Device* device, SimpleVertexShader* vs, SimplePixelShader* ps);
+	~UIRenderer();
+
+	// Width and height of a texture, for UITree::SetTextureSize
+	static void GetTextureSize(ID3D11ShaderResourceView* texture, int& width, int& height);
+
+	void Draw(RenderContext* context, UITree* tree, float screenWidth, float screenHeight);
+
+	// Since the last ResetStats
+	UIRenderStats GetStats() { return stats; }
+	void ResetStats() { stats = {}; }
+
+private:
+	struct TreeBuffers {
+		ID3D11Buffer* StaticBuffer;
+		unsigned int StaticVersion;
+		ID3D11Buffer* DynamicBuffer;
+		int DynamicCapacity;		// In vertices
+		unsigned int DynamicVersion;
+	};
+
+	ID3D11Device* device;
+	SimpleVertexShader* vs;
+	SimplePixelShader* ps;
+
+	ID3D11BlendState* blendState;
+	ID3D11DepthStencilState* depthState;
+	ID3D11RasterizerState* rasterizerState;
+	ID3D11SamplerState* sampler;
+
+	std::unordered_map<const UITree*, TreeBuffers> trees;
+	UIRenderStats stats;
+
+	void UpdateBuffers(RenderContext* context, UITree* tree, TreeBuffers& buffers);
+	void DrawLayer(RenderContext* context, const UILayer& layer, ID3D11Buffer* buffer);
+};
@@ -0,0 +1,294 @@
+#include "UITree.h"
+
+UITree::UITree()
+{
+	staticLayer.Version = 0;
+	dynamicLayer.Version = 0;
+	staticDirty = true;
+	dynamicDirty = true;
+	buildStats = {};
+}
+
+UITree::~UITree()
+{
+}
+
+void UITree::SetTextureSize(const void* texture, int width, int height)
+{
+	for (TextureSize& size : textureSizes)
+	{
+		if (size.Texture == texture)
+		{
+			size.Width = width;
+			size.Height = height;
+			return;
+		}
+	}
+
+	TextureSize size = { texture, width, height };
+	textureSizes.push_back(size);
+}
+
+// --------------------------------------------------------
+// Building the tree
+// --------------------------------------------------------
+
+int UITree::Add(const Element& element)
+{
+	elements.push_back(element);
+	int id = (int)elements.size() - 1;
+	MarkDirty(id);
+	return id;
+}
+
+int UITree::AddGroup(int parent, float x, float y)
+{
+	Element element = {};
+	element.Kind = ElementGroup;
+	element.Parent = parent;
+	element.X = x;
+	element.Y = y;
+	element.Static = true;
+	element.Visible = true;
+	return Add(element);
+}
+
+int UITree::AddImage(int parent, const void* texture, float x, float y, float width, float height, bool isStatic)
+{
+	Element element = {};
+	element.Kind = ElementImage;
+	element.Parent = parent;
+	element.X = x;
+	element.Y = y;
+	element.Width = width;
+	element.Height = height;
+	element.Texture = texture;
+	element.Color[0] = element.Color[1] = element.Color[2] = element.Color[3] = 1.0f;
+	element.Static = isStatic;
+	element.Visible = true;
+	return Add(element);
+}
+
+int UITree::AddText(int parent, const void* fontTexture, float x, float y, bool isStatic)
+{
+	Element element = {};
+	element.Kind = ElementText;
+	element.Parent = parent;
+	element.X = x;
+	element.Y = y;
+	element.Texture = fontTexture;
+	element.Color[0] = element.Color[1] = element.Color[2] = element.Color[3] = 1.0f;
+	element.Static = isStatic;
+	element.Visible = true;
+	element.TextScale = 1.0f;
+	return Add(element);
+}
+
+// --------------------------------------------------------
+// Changes only dirty the layers of the elements they affect -
+// the element itself and, for moves and visibility, anything
+// under it.  Groups draw nothing, so they dirty nothing.
+// --------------------------------------------------------
+void UITree::MarkDirty(int element)
+{
+	for (int i = element; i < (int)elements.size(); i++)
+	{
+		int at = i;
+		while (at > element)
+			at = elements[at].Parent;
+		if (at != element || elements[i].Kind == ElementGroup)
+			continue;
+
+		if (elements[i].Static)
+			staticDirty = true;
+		else
+			dynamicDirty = true;
+	}
+}
+
+void UITree::SetPosition(int element, float x, float y)
+{
+	Element& e = elements[element];
+	if (e.X == x && e.Y == y)
+		return;
+
+	e.X = x;
+	e.Y = y;
+	MarkDirty(element);
+}
+
+void UITree::SetVisible(int element, bool visible)
+{
+	if (elements[element].Visible == visible)
+		return;
+
+	elements[element].Visible = visible;
+	MarkDirty(element);
+}
+
+void UITree::SetColor(int element, const float color[4])
+{
+	Element& e = elements[element];
+	for (int i = 0; i < 4; i++)
+		e.Color[i] = color[i];
+
+	if (e.Static) staticDirty = true;
+	else dynamicDirty = true;
+}
+
+void UITree::SetText(int element, const TextRun& run)
+{
+	Element& e = elements[element];
+	e.Quads = run.Quads;
+	e.TextScale = run.Scale;
+	e.Width = run.Width;
+	e.Height = run.Height;
+
+	if (e.Static) staticDirty = true;
+	else dynamicDirty = true;
+}
+
+void UITree::SetHitTestable(int element, bool hitTestable)
+{
+	elements[element].HitTestable = hitTestable;
+}
+
+// --------------------------------------------------------
+// Queries
+// --------------------------------------------------------
+
+bool UITree::IsShown(int element)
+{
+	for (int at = element; at >= 0; at = elements[at].Parent)
+	{
+		if (!elements[at].Visible)
+			return false;
+	}
+	return true;
+}
+
+void UITree::GetWorldPosition(int element, float& x, float& y)
+{
+	x = 0.0f;
+	y = 0.0f;
+	for (int at = element; at >= 0; at = elements[at].Parent)
+	{
+		x += elements[at].X;
+		y += elements[at].Y;
+	}
+}
+
+int UITree::HitTest(float x, float y)
+{
+	// Later elements draw over earlier ones
+	for (int i = (int)elements.size() - 1; i >= 0; i--)
+	{
+		if (!elements[i].HitTestable || !IsShown(i))
+			continue;
+
+		float left, top;
+		GetWorldPosition(i, left, top);
+		if (x >= left && x < left + elements[i].Width &&
+			y >= top && y < top + elements[i].Height)
+			return i;
+	}
+	return -1;
+}
+
+// --------------------------------------------------------
+// Tessellation
+// --------------------------------------------------------
+
+void UITree::Build()
+{
+	buildStats = {};
+
+	if (staticDirty)
+		BuildLayer(true, staticLayer);
+	if (dynamicDirty)
+		BuildLayer(false, dynamicLayer);
+
+	staticDirty = false;
+	dynamicDirty = false;
+}
+
+void UITree::BuildLayer(bool isStatic, UILayer& layer)
+{
+	layer.Vertices.clear();
+	layer.Batches.clear();
+	layer.Version++;
+
+	// Elements come parent first, so tree order is draw order
+	for (int i = 0; i < (int)elements.size(); i++)
+	{
+		const Element& e = elements[i];
+		if (e.Static != isStatic || e.Kind == ElementGroup || !IsShown(i))
+			continue;
+
+		buildStats.ElementsTessellated++;
+
+		float x, y;
+		GetWorldPosition(i, x, y);
+
+		if (e.Kind == ElementImage)
+		{
+			AddQuad(layer, e.Texture, x, y, e.Width, e.Height, 0.0f, 0.0f, 1.0f, 1.0f, e.Color);
+			continue;
+		}
+
+		// Text needs the sheet's size for its texture coordinates
+		float sheetWidth = 0.0f;
+		float sheetHeight = 0.0f;
+		for (const TextureSize& size : textureSizes)
+		{
+			if (size.Texture == e.Texture)
+			{
+				sheetWidth = (float)size.Width;
+				sheetHeight = (float)size.Height;
+			}
+		}
+		if (sheetWidth == 0.0f || sheetHeight == 0.0f)
+			continue;
+
+		for (const TextQuad& quad : e.Quads)
+		{
+			AddQuad(layer, e.Texture,
+				x + quad.X,
+				y + quad.Y,
+				(quad.Right - quad.Left) * e.TextScale,
+				(quad.Bottom - quad.Top) * e.TextScale,
+				quad.Left / sheetWidth,
+				quad.Top / sheetHeight,
+				quad.Right / sheetWidth,
+				quad.Bottom / sheetHeight,
+				e.Color);
+		}
+	}
+
+	buildStats.VerticesBuilt += (int)layer.Vertices.size();
+}
+
+void UITree::AddQuad(UILayer& layer, const void* texture, float x, float y, float width, float height, float u0, float v0, float u1, float v1, const float color[4])
+{
+	// Carry on the last batch if it's the same texture
+	if (layer.Batches.empty() || layer.Batches.back().Texture != texture)
+	{
+		UIBatch batch;
+		batch.Texture = texture;
+		batch.StartVertex = (int)layer.Vertices.size();
+		batch.VertexCount = 0;
+		layer.Batches.push_back(batch);
+	}
+
+	// Two triangles, clockwise
+	UIVertex corners[4] = {
+		{ x, y, u0, v0, { color[0], color[1], color[2], color[3] } },
+		{ x + width, y, u1, v0, { color[0], color[1], color[2], color[3] } },
+		{ x + width, y + height, u1, v1, { color[0], color[1], color[2], color[3] } },
+		{ x, y + height, u0, v1, { color[0], color[1], color[2], color[3] } },
+	};
+	static const int order[6] = { 0, 1, 2, 0, 2, 3 };
+	for (int i = 0; i < 6; i++)
+		layer.Vertices.push_back(corners[order[i]]);
+	layer.Batches.back().VertexCount += 6;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <vector>
+#include "TextLayout.h"
+
+// --------------------------------------------------------
+// Retained UI
+//
+// Screens are built once as a tree of elements - images,
+// text, and plain groups that only position their children -
+// instead of being redrawn sprite by sprite every frame.
+// Each element is either static or dynamic.  Static elements
+// are tessellated into one layer that is only rebuilt when one
+// of them changes, so a screen that doesn't change costs
+// nothing to keep; dynamic ones (the score) go in a second
+// layer drawn on top, rebuilt only when one of them is
+// touched.  The same tree answers which element is under the
+// mouse.
+//
+// Positions are in pixels from the top left, each element's
+// relative to its parent.  Textures are opaque handles; the
+// renderer knows what they really are.
+// --------------------------------------------------------
+
+// One corner of a quad, in pixels
+struct UIVertex {
+	float X;
+	float Y;
+	float U;
+	float V;
+	float Color[4];
+};
+
+// A run of quads with the same texture
+struct UIBatch {
+	const void* Texture;
+	int StartVertex;
+	int VertexCount;
+};
+
+// Tessellated elements, ready to upload.  Version goes up
+// every time the layer is rebuilt.
+struct UILayer {
+	std::vector<UIVertex> Vertices;
+	std::vector<UIBatch> Batches;
+	unsigned int Version;
+};
+
+// What the last Build() had to redo
+struct UIBuildStats {
+	int ElementsTessellated;
+	int VerticesBuilt;
+};
+
+class UITree {
+public:
+	UITree();
+	~UITree();
+
+	// Size of a texture, needed to turn pixel source
+	// rectangles into texture coordinates
+	void SetTextureSize(const void* texture, int width, int height);
+
+	// Each returns the new element's id.  parent is -1 for the
+	// top of the tree, and must be added before its children.
+	int AddGroup(int parent, float x, float y);
+	int AddImage(int parent, const void* texture, float x, float y, float width, float height, bool isStatic = true);
+	int AddText(int parent, const void* fontTexture, float x, float y, bool isStatic = false);
+
+	void SetPosition(int element, float x, float y);
+	void SetVisible(int element, bool visible);
+	void SetColor(int element, const float color[4]);
+	void SetText(int element, const TextRun& run);
+
+	// Elements that hit testing can return
+	void SetHitTestable(int element, bool hitTestable);
+
+	// Topmost visible, hit testable element under the point,
+	// or -1
+	int HitTest(float x, float y);
+
+	// Rebuilds whichever layers have changed
+	void Build();
+
+	const UILayer& GetStaticLayer() { return staticLayer; }
+	const UILayer& GetDynamicLayer() { return dynamicLayer; }
+	UIBuildStats GetBuildStats() { return buildStats; }
+
+private:
+	enum ElementKind {
+		ElementGroup,
+		ElementImage,
+		ElementText,
+	};
+
+	struct Element {
+		ElementKind Kind;
+		int Parent;
+		float X;
+		float Y;
+		float Width;
+		float Height;
+		const void* Texture;
+		float Color[4];
+		bool Static;
+		bool Visible;
+		bool HitTestable;
+		std::vector<TextQuad> Quads;	// Text only
+		float TextScale;
+	};
+
+	struct TextureSize {
+		const void* Texture;
+		int Width;
+		int Height;
+	};
+
+	std::vector<Element> elements;
+	std::vector<TextureSize> textureSizes;
+
+	UILayer staticLayer;
+	UILayer dynamicLayer;
+	bool staticDirty;
+	bool dynamicDirty;
+	UIBuildStats buildStats;
+
+	int Add(const Element& element);
+	void MarkDirty(int element);
+	bool IsShown(int element);
+	void GetWorldPosition(int element, float& x, float& y);
+	void BuildLayer(bool isStatic, UILayer& layer);
+	void AddQuad(UILayer& layer, const void* texture, float x, float y, float width, float height, float u0, float v0, float u1, float v1, const float color[4]);
+};
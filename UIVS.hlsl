@@ -0,0 +1,37 @@
+// Constant buffer for C++ data being passed in
+cbuffer externalData : register(b0)
+{
+	float2 screenSize;
+};
+
+// Describes individual vertex data
+struct VertexShaderInput
+{
+	float2 position		: POSITION;		// In pixels, from the top left
+	float2 uv			: TEXCOORD;
+	float4 color		: COLOR;
+};
+
+// Defines the output data of our vertex shader
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float2 uv           : TEXCOORD0;
+	float4 color		: TEXCOORD1;
+};
+
+// The entry point for our vertex shader
+VertexToPixel main(VertexShaderInput input)
+{
+	// Set up output
+	VertexToPixel output;
+
+	// Pixels to clip space, y going down the screen
+	output.position = float4(input.position / screenSize * 2 - 1, 0, 1);
+	output.position.y *= -1;
+
+	output.uv = input.uv;
+	output.color = input.color;
+
+	return output;
+}
@@ -0,0 +1,32 @@
+cbuffer Data : register(b0)
+{
+	float2 sourceTexelSize;		// 1 / size of the (smaller) level being read
+}
+
+
+// Defines the input to this pixel shader
+// - Should match the output of our corresponding vertex shader
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float2 uv           : TEXCOORD0;
+};
+
+// Textures and such
+Texture2D SourceTex		: register(t0);
+SamplerState Sampler	: register(s0);
+
+// Entry point for this pixel shader
+// - A small tent filter over the smaller level.  The result is added on
+//   top of the larger level by the blend state.
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	float2 halfTexel = sourceTexelSize * 0.5f;
+
+	float4 totalColor = SourceTex.Sample(Sampler, input.uv + float2(-halfTexel.x, -halfTexel.y));
+	totalColor += SourceTex.Sample(Sampler, input.uv + float2( halfTexel.x, -halfTexel.y));
+	totalColor += SourceTex.Sample(Sampler, input.uv + float2(-halfTexel.x,  halfTexel.y));
+	totalColor += SourceTex.Sample(Sampler, input.uv + float2( halfTexel.x,  halfTexel.y));
+
+	return totalColor * 0.25f;
+}
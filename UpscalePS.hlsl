@@ -0,0 +1,57 @@
+cbuffer Data : register(b0)
+{
+	float2 sourceSize;		// Size of the scaled scene in texels
+}
+
+
+// Defines the input to this pixel shader
+// - Should match the output of our corresponding vertex shader
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float2 uv           : TEXCOORD0;
+};
+
+// Textures and such
+Texture2D SourceTex		: register(t0);
+SamplerState Sampler	: register(s0);
+
+// Entry point for this pixel shader
+// - Catmull-Rom upscale of the scaled scene.  The 4x4 texel footprint
+//   is covered with 9 bilinear fetches by merging the two middle texels
+//   of each row and column into one fetch.
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	float2 samplePos = input.uv * sourceSize;
+	float2 texPos1 = floor(samplePos - 0.5f) + 0.5f;
+	float2 f = samplePos - texPos1;
+
+	// Catmull-Rom weights for the 4 texels on each axis
+	float2 w0 = f * (-0.5f + f * (1.0f - 0.5f * f));
+	float2 w1 = 1.0f + f * f * (-2.5f + 1.5f * f);
+	float2 w2 = f * (0.5f + f * (2.0f - 1.5f * f));
+	float2 w3 = f * f * (-0.5f + 0.5f * f);
+
+	float2 w12 = w1 + w2;
+	float2 offset12 = w2 / w12;
+
+	float2 uv0 = (texPos1 - 1.0f) / sourceSize;
+	float2 uv3 = (texPos1 + 2.0f) / sourceSize;
+	float2 uv12 = (texPos1 + offset12) / sourceSize;
+
+	float4 totalColor = float4(0, 0, 0, 0);
+	totalColor += SourceTex.Sample(Sampler, float2(uv0.x,  uv0.y)) * w0.x  * w0.y;
+	totalColor += SourceTex.Sample(Sampler, float2(uv12.x, uv0.y)) * w12.x * w0.y;
+	totalColor += SourceTex.Sample(Sampler, float2(uv3.x,  uv0.y)) * w3.x  * w0.y;
+
+	totalColor += SourceTex.Sample(Sampler, float2(uv0.x,  uv12.y)) * w0.x  * w12.y;
+	totalColor += SourceTex.Sample(Sampler, float2(uv12.x, uv12.y)) * w12.x * w12.y;
+	totalColor += SourceTex.Sample(Sampler, float2(uv3.x,  uv12.y)) * w3.x  * w12.y;
+
+	totalColor += SourceTex.Sample(Sampler, float2(uv0.x,  uv3.y)) * w0.x  * w3.y;
+	totalColor += SourceTex.Sample(Sampler, float2(uv12.x, uv3.y)) * w12.x * w3.y;
+	totalColor += SourceTex.Sample(Sampler, float2(uv3.x,  uv3.y)) * w3.x  * w3.y;
+
+	// Catmull-Rom rings a little below zero on hard edges
+	return max(totalColor, 0.0f);
+}
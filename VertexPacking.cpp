@@ -0,0 +1,254 @@
+#include "VertexPacking.h"
+#include <math.h>
+#include <string.h>
+
+namespace {
+
+float SignNotZero(float value)
+{
+	return value < 0.0f ? -1.0f : 1.0f;
+}
+
+// Same as R16_SNORM reads it back
+float SnormToFloat(int16_t value)
+{
+	float f = value / 32767.0f;
+	return f < -1.0f ? -1.0f : f;
+}
+
+int16_t FloatToSnorm(float value)
+{
+	if (value > 1.0f) value = 1.0f;
+	if (value < -1.0f) value = -1.0f;
+	return (int16_t)floorf(value * 32767.0f + 0.5f);
+}
+
+// atan2 of the cross and dot products stays accurate for
+// tiny angles, where acos of the dot product doesn't
+float AngleBetween(const float* a, const float* b)
+{
+	float cross[3] = {
+		a[1] * b[2] - a[2] * b[1],
+		a[2] * b[0] - a[0] * b[2],
+		a[0] * b[1] - a[1] * b[0] };
+	float sine = sqrtf(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+	float cosine = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	return atan2f(sine, cosine) * (180.0f / 3.14159265f);
+}
+
+}
+
+// --------------------------------------------------------
+// Octahedral encoding
+//
+// Projects the vector onto the octahedron |x|+|y|+|z| = 1,
+// then folds the lower half out over the corners of the
+// upper half's diamond, giving a point in the -1 to 1 square
+// --------------------------------------------------------
+void OctEncode(const float* vector, int16_t* encoded)
+{
+	float v[3] = { vector[0], vector[1], vector[2] };
+	float length = fabsf(v[0]) + fabsf(v[1]) + fabsf(v[2]);
+	if (!(length > 0.0f))
+	{
+		v[0] = 1.0f; v[1] = 0.0f; v[2] = 0.0f;
+		length = 1.0f;
+	}
+
+	float x = v[0] / length;
+	float y = v[1] / length;
+	if (v[2] < 0.0f)
+	{
+		float foldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+		float foldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	// Rounding each axis on its own isn't always closest once
+	// decoded, so try the four neighbours and keep the best.
+	// They're a hair apart - too close for a float dot product
+	// to tell, so compare the distances instead.
+	float unit[3];
+	float unitLength = sqrtf(vector[0] * vector[0] + vector[1] * vector[1] + vector[2] * vector[2]);
+	for (int k = 0; k < 3; k++)
+		unit[k] = unitLength > 0.0f ? vector[k] / unitLength : v[k];
+
+	float baseX = floorf(x * 32767.0f);
+	float baseY = floorf(y * 32767.0f);
+	float bestDistance = 5.0f;
+	for (int i = 0; i < 4; i++)
+	{
+		int16_t candidate[2] = {
+			FloatToSnorm((baseX + (i & 1)) / 32767.0f),
+			FloatToSnorm((baseY + (i >> 1)) / 32767.0f) };
+
+		float decoded[3];
+		OctDecode(candidate, decoded);
+		float d[3] = { decoded[0] - unit[0], decoded[1] - unit[1], decoded[2] - unit[2] };
+		float distance = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+		if (distance < bestDistance)
+		{
+			bestDistance = distance;
+			encoded[0] = candidate[0];
+			encoded[1] = candidate[1];
+		}
+	}
+}
+
+// Matches OctDecode in PackedVertexShader.hlsl
+void OctDecode(const int16_t* encoded, float* vector)
+{
+	float x = SnormToFloat(encoded[0]);
+	float y = SnormToFloat(encoded[1]);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+
+	// Unfold the lower half
+	if (z < 0.0f)
+	{
+		float unfoldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+		float unfoldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+		x = unfoldedX;
+		y = unfoldedY;
+	}
+
+	float length = sqrtf(x * x + y * y + z * z);
+	vector[0] = x / length;
+	vector[1] = y / length;
+	vector[2] = z / length;
+}
+
+// --------------------------------------------------------
+// Half floats
+// --------------------------------------------------------
+uint16_t FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+	uint32_t exponent = (bits >> 23) & 0xFF;
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	// Infinity and NaN (keeping NaN a NaN)
+	if (exponent == 0xFF)
+		return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+
+	int halfExponent = (int)exponent - 127 + 15;
+
+	// Too big for a half
+	if (halfExponent >= 31)
+		return sign | 0x7C00;
+
+	// Too small even for a denormal
+	if (halfExponent < -10)
+		return sign;
+
+	uint32_t shift;
+	if (halfExponent <= 0)
+	{
+		// Denormal - put the implicit one back and shift it down
+		mantissa |= 0x800000;
+		shift = 14 - halfExponent;
+		halfExponent = 0;
+	}
+	else
+	{
+		shift = 13;
+	}
+
+	uint32_t half = ((uint32_t)halfExponent << 10) | (mantissa >> shift);
+
+	// Round to nearest even.  A carry out of the mantissa bumps
+	// the exponent, which is still the right answer.
+	uint32_t remainder = mantissa & ((1u << shift) - 1);
+	uint32_t halfway = 1u << (shift - 1);
+	if (remainder > halfway || (remainder == halfway && (half & 1)))
+		half++;
+
+	return sign | (uint16_t)half;
+}
+
+float HalfToFloat(uint16_t value)
+{
+	uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1F;
+	uint32_t mantissa = value & 0x3FF;
+
+	uint32_t bits;
+	if (exponent == 0x1F)
+	{
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else if (exponent != 0)
+	{
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+	else if (mantissa == 0)
+	{
+		bits = sign;
+	}
+	else
+	{
+		// Denormal - normalize it for the float
+		int e = -1;
+		do
+		{
+			mantissa <<= 1;
+			e++;
+		} while (!(mantissa & 0x400));
+		bits = sign | ((uint32_t)(127 - 15 - e) << 23) | ((mantissa & 0x3FF) << 13);
+	}
+
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+void PackVertices(const float* vertices, int vertexStride, int vertexCount, PackedVertex* packed, VertexPackingStats* stats)
+{
+	VertexPackingStats worst = {};
+	for (int i = 0; i < vertexCount; i++)
+	{
+		const float* vertex = vertices + i * vertexStride;
+		const float* position = vertex;
+		const float* normal = vertex + 3;
+		const float* uv = vertex + 6;
+		const float* tangent = vertex + 8;
+
+		PackedVertex& out = packed[i];
+		memcpy(out.Position, position, sizeof(out.Position));
+		OctEncode(normal, out.Normal);
+		OctEncode(tangent, out.Tangent);
+		out.UV[0] = FloatToHalf(uv[0]);
+		out.UV[1] = FloatToHalf(uv[1]);
+
+		if (!stats)
+			continue;
+
+		float decoded[3];
+		OctDecode(out.Normal, decoded);
+		float normalError = AngleBetween(normal, decoded);
+		if (normalError > worst.MaxNormalError)
+			worst.MaxNormalError = normalError;
+
+		// Zero tangents (no UVs to go on) don't count
+		if (tangent[0] != 0.0f || tangent[1] != 0.0f || tangent[2] != 0.0f)
+		{
+			OctDecode(out.Tangent, decoded);
+			float tangentError = AngleBetween(tangent, decoded);
+			if (tangentError > worst.MaxTangentError)
+				worst.MaxTangentError = tangentError;
+		}
+
+		for (int k = 0; k < 2; k++)
+		{
+			float uvError = fabsf(HalfToFloat(out.UV[k]) - uv[k]);
+			if (uvError > worst.MaxUVError)
+				worst.MaxUVError = uvError;
+		}
+	}
+
+	if (stats)
+		*stats = worst;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+
+// --------------------------------------------------------
+// Smaller vertices for the lit pass
+//
+// A Vertex is 44 bytes, almost half of it unit vectors and
+// UVs stored as full floats.  PackedVertex keeps the
+// position as it is and squeezes the rest:
+//  - Normal and tangent are octahedral encoded - the unit
+//    sphere folded flat onto a square - in two 16 bit signed
+//    normalized numbers each (R16G16_SNORM)
+//  - UVs are half floats (R16G16_FLOAT)
+// which comes to 24 bytes.  The input assembler turns the
+// snorm and half values back into floats, and the vertex
+// shader unfolds the octahedral ones.
+// --------------------------------------------------------
+
+struct PackedVertex {
+	float Position[3];
+	int16_t Normal[2];
+	int16_t Tangent[2];
+	uint16_t UV[2];
+};
+
+// How far the packed vertices came out from the originals
+struct VertexPackingStats {
+	float MaxNormalError;	// Degrees
+	float MaxTangentError;	// Degrees
+	float MaxUVError;		// UV units
+};
+
+// Unit vector to and from its octahedral encoding.  The
+// encoding picks whichever rounding decodes closest.
+void OctEncode(const float* vector, int16_t* encoded);
+void OctDecode(const int16_t* encoded, float* vector);
+
+// IEEE half float, rounding to nearest even
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
+
+// vertices are laid out like Vertex - position, normal, UV,
+// tangent - vertexStride floats apart.  Normals and tangents
+// should be unit length (a zero tangent is packed as +x).
+void PackVertices(const float* vertices, int vertexStride, int vertexCount, PackedVertex* packed, VertexPackingStats* stats = 0);
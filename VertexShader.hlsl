@@ -4,15 +4,18 @@
 //    which will (eventually) hold data from our C++ code
 // - All non-pipeline variables that get their values from 
 //    our C++ code must be defined inside a Constant Buffer
-// - The name of the cbuffer itself is unimportant
-cbuffer externalData : register(b0)
+// - These are split by how often they change, and Renderer
+//    uploads them by name - PerFrame once for the whole pass,
+//    PerObject for every draw (out of ConstantUploadHeap's ring)
+cbuffer PerFrame : register(b0)
 {
-	matrix world;
 	matrix view;
 	matrix projection;
+};
 
-	matrix shadowView;
-	matrix shadowProj;
+cbuffer PerObject : register(b1)
+{
+	matrix world;
 };
 
 // Struct representing a single vertex worth of data
@@ -52,7 +55,7 @@ struct VertexToPixel
 	float2 uv           : TEXCOORD;     // UV co-ordinates
 	float3 tangent		: TANGENT;
 	float3 worldPos		: POSITION;
-	float4 posForShadow	: POSITION1;
+	float viewDepth		: TEXCOORD1;		// Picks the shadow cascade
 };
 
 // --------------------------------------------------------
@@ -74,18 +77,18 @@ VertexToPixel main( VertexShaderInput input )
 	//
 	// First we multiply them together to get a single matrix which represents
 	// all of those transformations (world to view to projection space)
-	matrix worldViewProj = mul(mul(world, view), projection);
+	//
+	// precise keeps the compiler from rearranging any of this, so
+	// the depth pre-pass (ShadowVS) comes out exactly the same
+	precise matrix worldViewProj = mul(mul(world, view), projection);
 
 	// Then we convert our 3-component position vector to a 4-component vector
 	// and multiply it by our final 4x4 matrix.
 	//
 	// The result is essentially the position (XY) of the vertex on our 2D 
 	// screen and the distance (Z) from the camera (the "depth" of the pixel)
-	output.position = mul(float4(input.position, 1.0f), worldViewProj);
-
-	// Calculate the position of this vertex relative to the shadow-casting light
-	matrix shadowWVP = mul(mul(world, shadowView), shadowProj);
-	output.posForShadow = mul(float4(input.position, 1.0f), shadowWVP);
+	precise float4 position = mul(float4(input.position, 1.0f), worldViewProj);
+	output.position = position;
 
 	// Pass the color through 
 	// - The values will be interpolated per-pixel by the rasterizer
@@ -94,6 +97,7 @@ VertexToPixel main( VertexShaderInput input )
 	output.normal = mul(input.normal, (float3x3)world);
 	output.tangent = mul(input.tangent, (float3x3)world);
 	output.worldPos = mul(float4(input.position, 1.0f), world).xyz;
+	output.viewDepth = mul(float4(output.worldPos, 1.0f), view).z;
 	output.uv = input.uv;
 	// Whatever we return will make its way through the pipeline to the
 	// next programmable stage we're using (the pixel shader for now)
@@ -0,0 +1,76 @@
+#include "WaveOutSink.h"
+
+WaveOutSink::WaveOutSink(int sampleRate, int bufferCount)
+{
+	device = 0;
+	next = 0;
+	done = CreateEvent(0, FALSE, FALSE, 0);
+
+	WAVEFORMATEX format = {};
+	format.wFormatTag = WAVE_FORMAT_PCM;
+	format.nChannels = 2;
+	format.nSamplesPerSec = sampleRate;
+	format.wBitsPerSample = 16;
+	format.nBlockAlign = format.nChannels * format.wBitsPerSample / 8;
+	format.nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
+	if (waveOutOpen(&device, WAVE_MAPPER, &format, (DWORD_PTR)done, 0, CALLBACK_EVENT) != MMSYSERR_NOERROR)
+	{
+		device = 0;
+		return;
+	}
+
+	buffers.resize(bufferCount);
+	for (size_t i = 0; i < buffers.size(); i++)
+	{
+		buffers[i].Header = {};
+		buffers[i].Samples.resize(AudioBlockFrames * 2);
+	}
+}
+
+WaveOutSink::~WaveOutSink()
+{
+	if (device)
+	{
+		waveOutReset(device);
+		for (size_t i = 0; i < buffers.size(); i++)
+		{
+			if (buffers[i].Header.dwFlags & WHDR_PREPARED)
+				waveOutUnprepareHeader(device, &buffers[i].Header, sizeof(WAVEHDR));
+		}
+		waveOutClose(device);
+	}
+	CloseHandle(done);
+}
+
+bool WaveOutSink::Write(const float* samples, int frames)
+{
+	if (!device)
+		return false;
+
+	while (frames > 0)
+	{
+		Buffer& buffer = buffers[next];
+
+		// Wait for the oldest buffer to come back.  The event
+		// resets itself, so look at the flag again each time.
+		while ((buffer.Header.dwFlags & WHDR_PREPARED) && !(buffer.Header.dwFlags & WHDR_DONE))
+			WaitForSingleObject(done, INFINITE);
+		if (buffer.Header.dwFlags & WHDR_PREPARED)
+			waveOutUnprepareHeader(device, &buffer.Header, sizeof(WAVEHDR));
+
+		int count = frames < AudioBlockFrames ? frames : AudioBlockFrames;
+		ConvertAudioToInt16(samples, count * 2, buffer.Samples.data());
+
+		buffer.Header = {};
+		buffer.Header.lpData = (LPSTR)buffer.Samples.data();
+		buffer.Header.dwBufferLength = count * 2 * sizeof(short);
+		waveOutPrepareHeader(device, &buffer.Header, sizeof(WAVEHDR));
+		if (waveOutWrite(device, &buffer.Header, sizeof(WAVEHDR)) != MMSYSERR_NOERROR)
+			return false;
+
+		next = (next + 1) % (int)buffers.size();
+		samples += count * 2;
+		frames -= count;
+	}
+	return true;
+}
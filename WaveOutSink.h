@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Windows.h>
+#include <mmsystem.h>
+#include <vector>
+
+#include "AudioSink.h"
+
+#pragma comment(lib, "winmm.lib")
+
+// --------------------------------------------------------
+// Plays through the default output device with waveOut,
+// which needs nothing past Windows itself.  Writes queue up
+// in a few small buffers and block while they're all still
+// playing, which is what paces AudioOutput's thread - the
+// buffers are the latency.
+// --------------------------------------------------------
+class WaveOutSink : public AudioSink {
+public:
+	WaveOutSink(int sampleRate, int bufferCount = 8);
+	~WaveOutSink();
+
+	bool IsOpen() { return device != 0; }
+	bool Write(const float* samples, int frames);
+
+private:
+	struct Buffer {
+		WAVEHDR Header;
+		std::vector<short> Samples;
+	};
+
+	HWAVEOUT device;
+	HANDLE done;		// Signalled by waveOut as each buffer finishes
+	std::vector<Buffer> buffers;
+	int next;
+};